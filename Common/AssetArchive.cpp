@@ -0,0 +1,473 @@
+//***************************************************************************************
+// AssetArchive.cpp
+//***************************************************************************************
+
+#include "AssetArchive.h"
+#include "LZ4Block.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdio>
+#endif
+
+namespace
+{
+	const char ArchiveMagic[4] = { 'A', 'P', 'A', 'K' };
+	const uint32_t ArchiveVersion = 1;
+
+	const uint64_t ChecksumSeed = 0x41504b31;
+
+	// An LZ4 block can't expand by more than this, which bounds what a damaged table of
+	// contents can make a reader allocate.
+	const uint64_t MaxLZ4Ratio = 255;
+
+	struct ArchiveHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t EntryCount;
+		uint32_t Alignment;
+		uint64_t TocOffset;
+		uint64_t NamesOffset;
+		uint64_t NamesSize;
+	};
+	static_assert(sizeof(ArchiveHeader) == 40, "ArchiveHeader is written as is");
+
+	struct TocRecord
+	{
+		uint64_t Offset;
+		uint64_t StoredSize;
+		uint64_t Size;
+		uint64_t Checksum;
+		uint32_t NameOffset;
+		uint32_t NameLength;
+		uint32_t Compression;
+		uint32_t Reserved;
+	};
+	static_assert(sizeof(TocRecord) == 48, "TocRecord is written as is");
+
+	// a + b <= limit, without overflowing.
+	bool FitsWithin(uint64_t a, uint64_t b, uint64_t limit)
+	{
+		return a <= limit && b <= limit - a;
+	}
+
+	void AppendUtf8(std::string& out, uint32_t c)
+	{
+		if(c < 0x80)
+		{
+			out += (char)c;
+		}
+		else if(c < 0x800)
+		{
+			out += (char)(0xc0 | (c >> 6));
+			out += (char)(0x80 | (c & 0x3f));
+		}
+		else if(c < 0x10000)
+		{
+			out += (char)(0xe0 | (c >> 12));
+			out += (char)(0x80 | ((c >> 6) & 0x3f));
+			out += (char)(0x80 | (c & 0x3f));
+		}
+		else
+		{
+			out += (char)(0xf0 | (c >> 18));
+			out += (char)(0x80 | ((c >> 12) & 0x3f));
+			out += (char)(0x80 | ((c >> 6) & 0x3f));
+			out += (char)(0x80 | (c & 0x3f));
+		}
+	}
+
+	std::ofstream OpenOutput(const std::wstring& fileName)
+	{
+#ifdef _WIN32
+		return std::ofstream(fileName, std::ios::binary);
+#else
+		return std::ofstream(NarrowPath(fileName.c_str()), std::ios::binary);
+#endif
+	}
+
+	bool ReplaceFile(const std::wstring& from, const std::wstring& to)
+	{
+#ifdef _WIN32
+		return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return std::rename(NarrowPath(from.c_str()).c_str(), NarrowPath(to.c_str()).c_str()) == 0;
+#endif
+	}
+}
+
+const char* GetAssetArchiveResultName(AssetArchiveResult result)
+{
+	switch(result)
+	{
+	case AssetArchiveResult::Ok:          return "ok";
+	case AssetArchiveResult::NotFound:    return "not found";
+	case AssetArchiveResult::OpenFailed:  return "can't be opened";
+	case AssetArchiveResult::BadFormat:   return "not a valid archive";
+	case AssetArchiveResult::Corrupt:     return "corrupt";
+	case AssetArchiveResult::WriteFailed: return "write failed";
+	}
+	return "unknown";
+}
+
+AssetArchiveResult AssetArchive::Open(const wchar_t* fileName)
+{
+	Close();
+
+	if(!mFile.Open(fileName))
+		return AssetArchiveResult::OpenFailed;
+
+	const uint8_t* data = mFile.GetData();
+	uint64_t size = mFile.GetSize();
+
+	ArchiveHeader header;
+	if(size < sizeof(header))
+	{
+		Close();
+		return AssetArchiveResult::BadFormat;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	bool valid = memcmp(header.Magic, ArchiveMagic, sizeof(ArchiveMagic)) == 0 &&
+		header.Version == ArchiveVersion &&
+		header.TocOffset % alignof(TocRecord) == 0 &&
+		FitsWithin(header.TocOffset, (uint64_t)header.EntryCount * sizeof(TocRecord), size) &&
+		FitsWithin(header.NamesOffset, header.NamesSize, size);
+
+	const char* names = valid ? (const char*)data + header.NamesOffset : nullptr;
+	for(uint32_t i = 0; valid && i < header.EntryCount; ++i)
+	{
+		TocRecord record;
+		memcpy(&record, data + header.TocOffset + (uint64_t)i * sizeof(TocRecord), sizeof(record));
+
+		AssetEntry entry;
+		entry.Compression = (AssetCompression)record.Compression;
+		entry.Offset = record.Offset;
+		entry.StoredSize = record.StoredSize;
+		entry.Size = record.Size;
+		entry.Checksum = record.Checksum;
+
+		valid = FitsWithin(record.NameOffset, record.NameLength, header.NamesSize) &&
+			FitsWithin(record.Offset, record.StoredSize, size) &&
+			record.Size <= (uint64_t)SIZE_MAX;
+
+		if(valid && entry.Compression == AssetCompression::None)
+			valid = record.StoredSize == record.Size;
+		else if(valid && entry.Compression == AssetCompression::LZ4)
+			valid = record.Size / MaxLZ4Ratio <= record.StoredSize;
+		else
+			valid = false;
+
+		if(valid)
+		{
+			entry.Name.assign(names + record.NameOffset, record.NameLength);
+
+			// Find relies on the names being sorted and unique.
+			valid = mEntries.empty() || mEntries.back().Name < entry.Name;
+		}
+
+		mEntries.push_back(std::move(entry));
+	}
+
+	if(!valid)
+	{
+		Close();
+		return AssetArchiveResult::BadFormat;
+	}
+
+	return AssetArchiveResult::Ok;
+}
+
+void AssetArchive::Close()
+{
+	mFile.Close();
+	mEntries.clear();
+}
+
+bool AssetArchive::IsOpen()const
+{
+	return mFile.IsOpen();
+}
+
+int32_t AssetArchive::Find(const std::wstring& name)const
+{
+	std::string key = NormalizeName(name);
+
+	auto it = std::lower_bound(mEntries.begin(), mEntries.end(), key,
+		[](const AssetEntry& entry, const std::string& k) { return entry.Name < k; });
+	if(it == mEntries.end() || it->Name != key)
+		return -1;
+
+	return (int32_t)(it - mEntries.begin());
+}
+
+uint32_t AssetArchive::GetEntryCount()const
+{
+	return (uint32_t)mEntries.size();
+}
+
+const AssetEntry& AssetArchive::GetEntry(uint32_t entry)const
+{
+	return mEntries[entry];
+}
+
+const uint8_t* AssetArchive::GetStoredData(uint32_t entry)const
+{
+	const AssetEntry& e = mEntries[entry];
+	return e.Compression == AssetCompression::None ? mFile.GetData() + e.Offset : nullptr;
+}
+
+AssetArchiveResult AssetArchive::Read(uint32_t entry, void* data)const
+{
+	const AssetEntry& e = mEntries[entry];
+	const uint8_t* stored = mFile.GetData() + e.Offset;
+
+	if(e.Compression == AssetCompression::None)
+	{
+		if(e.Size > 0)
+			memcpy(data, stored, (size_t)e.Size);
+		return AssetArchiveResult::Ok;
+	}
+
+	if(!LZ4DecompressBlock(stored, (size_t)e.StoredSize, (uint8_t*)data, (size_t)e.Size))
+		return AssetArchiveResult::Corrupt;
+
+	return AssetArchiveResult::Ok;
+}
+
+AssetArchiveResult AssetArchive::Read(uint32_t entry, std::vector<uint8_t>& data)const
+{
+	data.resize((size_t)mEntries[entry].Size);
+
+	AssetArchiveResult result = Read(entry, data.data());
+	if(result != AssetArchiveResult::Ok)
+		data.clear();
+
+	return result;
+}
+
+AssetArchiveResult AssetArchive::ReadEntries(const std::vector<uint32_t>& entries,
+	std::vector<std::vector<uint8_t>>& data, ThreadPool* pool)const
+{
+	data.resize(entries.size());
+
+	std::vector<AssetArchiveResult> results(entries.size());
+	ParallelFor(pool, entries.size(), [&](size_t i)
+	{
+		results[i] = Read(entries[i], data[i]);
+	});
+
+	for(AssetArchiveResult result : results)
+	{
+		if(result != AssetArchiveResult::Ok)
+			return result;
+	}
+	return AssetArchiveResult::Ok;
+}
+
+AssetArchiveResult AssetArchive::Verify(ThreadPool* pool)const
+{
+	// Each entry is read and dropped in turn, so only the ones in flight are in memory.
+	std::vector<AssetArchiveResult> results(mEntries.size());
+	ParallelFor(pool, mEntries.size(), [&](size_t i)
+	{
+		std::vector<uint8_t> data;
+		results[i] = Read((uint32_t)i, data);
+		if(results[i] == AssetArchiveResult::Ok &&
+			MurmurHash64(data.data(), data.size(), ChecksumSeed) != mEntries[i].Checksum)
+		{
+			results[i] = AssetArchiveResult::Corrupt;
+		}
+	});
+
+	for(AssetArchiveResult result : results)
+	{
+		if(result != AssetArchiveResult::Ok)
+			return result;
+	}
+	return AssetArchiveResult::Ok;
+}
+
+std::string AssetArchive::NormalizeName(const std::wstring& name)
+{
+	std::string normalized;
+	for(size_t i = 0; i < name.size(); ++i)
+	{
+		uint32_t c = (uint32_t)name[i];
+
+		// A UTF-16 surrogate pair, where wchar_t is 16 bits.
+		if(sizeof(wchar_t) == 2 && c >= 0xd800 && c < 0xdc00 && i + 1 < name.size())
+		{
+			uint32_t low = (uint32_t)name[i + 1];
+			if(low >= 0xdc00 && low < 0xe000)
+			{
+				c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+				++i;
+			}
+		}
+
+		if(c == '\\')
+			c = '/';
+		else if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+
+		// Repeated separators and "./" components don't change the path.
+		if(c == '/' && (normalized.empty() || normalized.back() == '/'))
+			continue;
+		if(c == '/' && normalized == ".")
+		{
+			normalized.clear();
+			continue;
+		}
+		if(c == '/' && normalized.size() >= 2 && normalized.compare(normalized.size() - 2, 2, "/.") == 0)
+		{
+			normalized.pop_back();
+			continue;
+		}
+
+		AppendUtf8(normalized, c);
+	}
+	return normalized;
+}
+
+AssetArchiveWriter::AssetArchiveWriter(uint32_t alignment, float minSavings)
+	: mAlignment(alignment),
+	  mMinSavings(minSavings)
+{
+}
+
+void AssetArchiveWriter::Add(const std::wstring& name, std::vector<uint8_t> data)
+{
+	std::string key = AssetArchive::NormalizeName(name);
+	for(auto& entry : mEntries)
+	{
+		if(entry.Name == key)
+		{
+			entry.Data = std::move(data);
+			return;
+		}
+	}
+
+	PendingEntry entry;
+	entry.Name = key;
+	entry.Data = std::move(data);
+	mEntries.push_back(std::move(entry));
+}
+
+AssetArchiveResult AssetArchiveWriter::Write(const wchar_t* fileName, ThreadPool* pool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	ParallelFor(pool, mEntries.size(), [this](size_t i) { Compress(mEntries[i]); });
+
+	std::sort(mEntries.begin(), mEntries.end(),
+		[](const PendingEntry& a, const PendingEntry& b) { return a.Name < b.Name; });
+
+	mStats = AssetArchiveStats();
+	mStats.EntryCount = (uint32_t)mEntries.size();
+
+	// Lay the file out first: data, then the table of contents, then the names.
+	auto align = [](uint64_t offset, uint64_t alignment) { return (offset + alignment - 1) & ~(alignment - 1); };
+
+	std::vector<TocRecord> toc(mEntries.size());
+	std::string names;
+	uint64_t offset = sizeof(ArchiveHeader);
+	for(size_t i = 0; i < mEntries.size(); ++i)
+	{
+		const PendingEntry& entry = mEntries[i];
+		bool compressed = !entry.Compressed.empty();
+
+		TocRecord& record = toc[i];
+		memset(&record, 0, sizeof(record));
+		record.Offset = align(offset, mAlignment);
+		record.StoredSize = compressed ? entry.Compressed.size() : entry.Data.size();
+		record.Size = entry.Data.size();
+		record.Checksum = MurmurHash64(entry.Data.data(), entry.Data.size(), ChecksumSeed);
+		record.NameOffset = (uint32_t)names.size();
+		record.NameLength = (uint32_t)entry.Name.size();
+		record.Compression = (uint32_t)(compressed ? AssetCompression::LZ4 : AssetCompression::None);
+		names += entry.Name;
+
+		offset = record.Offset + record.StoredSize;
+
+		mStats.CompressedCount += compressed ? 1 : 0;
+		mStats.Size += record.Size;
+		mStats.StoredSize += record.StoredSize;
+	}
+
+	ArchiveHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, ArchiveMagic, sizeof(ArchiveMagic));
+	header.Version = ArchiveVersion;
+	header.EntryCount = (uint32_t)mEntries.size();
+	header.Alignment = mAlignment;
+	header.TocOffset = align(offset, alignof(TocRecord));
+	header.NamesOffset = header.TocOffset + toc.size() * sizeof(TocRecord);
+	header.NamesSize = names.size();
+
+	// Written aside and then moved into place, so a reader never maps half an archive.
+	std::wstring temp = std::wstring(fileName) + L".tmp";
+	{
+		std::ofstream fout = OpenOutput(temp);
+
+		const std::vector<char> padding(std::max<uint32_t>(mAlignment, alignof(TocRecord)), 0);
+		uint64_t position = 0;
+		auto writeAt = [&](uint64_t at, const void* data, size_t size)
+		{
+			fout.write(padding.data(), (std::streamsize)(at - position));
+			fout.write((const char*)data, (std::streamsize)size);
+			position = at + size;
+		};
+
+		writeAt(0, &header, sizeof(header));
+		for(size_t i = 0; i < mEntries.size(); ++i)
+		{
+			const PendingEntry& entry = mEntries[i];
+			const std::vector<uint8_t>& stored = entry.Compressed.empty() ? entry.Data : entry.Compressed;
+			writeAt(toc[i].Offset, stored.data(), stored.size());
+		}
+		writeAt(header.TocOffset, toc.data(), toc.size() * sizeof(TocRecord));
+		writeAt(header.NamesOffset, names.data(), names.size());
+
+		if(!fout || (fout.close(), fout.fail()))
+			return AssetArchiveResult::WriteFailed;
+	}
+
+	if(!ReplaceFile(temp, fileName))
+		return AssetArchiveResult::WriteFailed;
+
+	mStats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return AssetArchiveResult::Ok;
+}
+
+const AssetArchiveStats& AssetArchiveWriter::GetStats()const
+{
+	return mStats;
+}
+
+void AssetArchiveWriter::Compress(PendingEntry& entry)const
+{
+	entry.Compressed.clear();
+	if(entry.Data.empty())
+		return;
+
+	std::vector<uint8_t> compressed(LZ4CompressBound(entry.Data.size()));
+	size_t size = LZ4CompressBlock(entry.Data.data(), entry.Data.size(), compressed.data());
+
+	// Block compressed textures barely shrink; those are stored so they can be used from
+	// the mapping.
+	if((double)size > entry.Data.size() * (1.0 - mMinSavings))
+		return;
+
+	compressed.resize(size);
+	entry.Compressed = std::move(compressed);
+}
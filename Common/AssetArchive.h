@@ -0,0 +1,156 @@
+//***************************************************************************************
+// AssetArchive.h
+//
+// Packs the loose asset files (textures, shader sources, cached bytecode) into one file,
+// so startup opens and maps one file instead of one per asset.
+//   -Entries are named by their path relative to the working directory, normalized to
+//    lower case with forward slashes, so "Textures\Bricks.dds" and "textures/bricks.dds"
+//    are the same entry.  The table of contents is sorted by name and searched by
+//    bisection.
+//   -Each entry is stored either as is or as an LZ4 block, whichever the writer found
+//    worth it, and starts on an alignment boundary (a page by default), so a stored
+//    entry can be used straight from the mapping.
+//   -The reader maps the archive and never writes to it, so any number of threads can
+//    read entries at once; ReadEntries decompresses a list of them across a ThreadPool.
+//
+// Layout: header, entry data, table of contents, name strings.  Integers are little
+// endian.  Nothing here depends on Win32 or Direct3D.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+class ThreadPool;
+
+enum class AssetArchiveResult
+{
+	Ok,
+	NotFound,
+	OpenFailed,
+
+	// Not an archive, a version this code doesn't read, or a table of contents that
+	// points outside the file.
+	BadFormat,
+
+	// An entry that doesn't decompress to its size, or whose contents don't match its
+	// checksum.
+	Corrupt,
+
+	WriteFailed
+};
+
+const char* GetAssetArchiveResultName(AssetArchiveResult result);
+
+enum class AssetCompression : uint32_t
+{
+	None = 0,
+	LZ4 = 1
+};
+
+struct AssetEntry
+{
+	std::string Name;
+	AssetCompression Compression = AssetCompression::None;
+
+	// Offset of the stored bytes in the archive, their count, and the size once they are
+	// decompressed.
+	uint64_t Offset = 0;
+	uint64_t StoredSize = 0;
+	uint64_t Size = 0;
+
+	// MurmurHash64 of the uncompressed contents.
+	uint64_t Checksum = 0;
+};
+
+struct AssetArchiveStats
+{
+	uint32_t EntryCount = 0;
+	uint32_t CompressedCount = 0;
+	uint64_t Size = 0;
+	uint64_t StoredSize = 0;
+	double Seconds = 0.0;
+};
+
+class AssetArchive
+{
+public:
+	AssetArchive() = default;
+	AssetArchive(const AssetArchive& rhs) = delete;
+	AssetArchive& operator=(const AssetArchive& rhs) = delete;
+
+	// Maps the archive and checks its table of contents; the entries themselves are only
+	// touched when they are read.
+	AssetArchiveResult Open(const wchar_t* fileName);
+	void Close();
+
+	bool IsOpen()const;
+
+	// Returns the entry's index, or -1 if there is none by that name.
+	int32_t Find(const std::wstring& name)const;
+
+	uint32_t GetEntryCount()const;
+	const AssetEntry& GetEntry(uint32_t entry)const;
+
+	// The entry's bytes as they are in the mapping, or null if it is compressed.
+	const uint8_t* GetStoredData(uint32_t entry)const;
+
+	// Decompresses the entry into data, which must hold GetEntry(entry).Size bytes.
+	AssetArchiveResult Read(uint32_t entry, void* data)const;
+	AssetArchiveResult Read(uint32_t entry, std::vector<uint8_t>& data)const;
+
+	// Reads every entry listed, in parallel on the pool if there is one.  data is resized
+	// to match; returns the first failure, in list order.
+	AssetArchiveResult ReadEntries(const std::vector<uint32_t>& entries, std::vector<std::vector<uint8_t>>& data,
+		ThreadPool* pool)const;
+
+	// Reads every entry and checks it against its checksum.
+	AssetArchiveResult Verify(ThreadPool* pool)const;
+
+	// The form names are stored and looked up in: UTF-8, lower case, '/' separators and no
+	// leading "./".
+	static std::string NormalizeName(const std::wstring& name);
+
+private:
+	MappedFile mFile;
+	std::vector<AssetEntry> mEntries;
+};
+
+class AssetArchiveWriter
+{
+public:
+	// Entries are aligned to alignment bytes, which must be a power of two.  An entry is
+	// only kept compressed if that saves at least minSavings of it.
+	explicit AssetArchiveWriter(uint32_t alignment = 4096, float minSavings = 0.0625f);
+	AssetArchiveWriter(const AssetArchiveWriter& rhs) = delete;
+	AssetArchiveWriter& operator=(const AssetArchiveWriter& rhs) = delete;
+
+	// Adding a name twice replaces the earlier contents.
+	void Add(const std::wstring& name, std::vector<uint8_t> data);
+
+	// Compresses the entries, in parallel on the pool if there is one, and writes the
+	// archive aside before moving it over fileName.
+	AssetArchiveResult Write(const wchar_t* fileName, ThreadPool* pool);
+
+	const AssetArchiveStats& GetStats()const;
+
+private:
+	struct PendingEntry
+	{
+		std::string Name;
+		std::vector<uint8_t> Data;
+		std::vector<uint8_t> Compressed;
+	};
+
+	void Compress(PendingEntry& entry)const;
+
+private:
+	uint32_t mAlignment = 4096;
+	float mMinSavings = 0.0f;
+	std::vector<PendingEntry> mEntries;
+	AssetArchiveStats mStats;
+};
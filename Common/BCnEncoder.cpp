@@ -0,0 +1,982 @@
+//***************************************************************************************
+// BCnEncoder.cpp
+//***************************************************************************************
+
+#include "BCnEncoder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BCN_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// The pixels of a block, one array per channel, in [0, 255].
+	struct BlockPixels
+	{
+		alignas(16) float C[4][16];
+	};
+
+	// The colours a block can pick from, one array per channel.
+	struct Palette
+	{
+		float C[4][16];
+		int Count = 0;
+	};
+
+	// Weight of the second endpoint for each index.
+	const float BC1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const float BC4Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+	const int BC7Weights2[4] = { 0, 21, 43, 64 };
+	const int BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	int GetRefinePasses(BCQuality quality)
+	{
+		switch(quality)
+		{
+		case BCQuality::Fast:   return 0;
+		case BCQuality::Normal: return 1;
+		default:                return 4;
+		}
+	}
+
+	int ClampByte(int v)
+	{
+		return v < 0 ? 0 : (v > 255 ? 255 : v);
+	}
+
+	void LoadBlock(const uint8_t rgba[64], BlockPixels& px)
+	{
+		for(int i = 0; i < 16; ++i)
+		{
+			for(int c = 0; c < 4; ++c)
+				px.C[c][i] = (float)rgba[i*4 + c];
+		}
+	}
+
+	// Picks the closest palette entry for every pixel, comparing channels
+	// [first, first + count).  Returns the summed squared error.
+	float FindIndices(const BlockPixels& px, const Palette& pal, int first, int count, uint8_t indices[16])
+	{
+#ifdef BCN_USE_SSE2
+		__m128 total = _mm_setzero_ps();
+		for(int i = 0; i < 16; i += 4)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+
+			for(int e = 0; e < pal.Count; ++e)
+			{
+				__m128 error = _mm_setzero_ps();
+				for(int c = first; c < first + count; ++c)
+				{
+					__m128 d = _mm_sub_ps(_mm_load_ps(&px.C[c][i]), _mm_set1_ps(pal.C[c][e]));
+					error = _mm_add_ps(error, _mm_mul_ps(d, d));
+				}
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best));
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(e)), _mm_andnot_si128(closer, bestIndex));
+				best = _mm_min_ps(error, best);
+			}
+
+			total = _mm_add_ps(total, best);
+
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+			for(int k = 0; k < 4; ++k)
+				indices[i + k] = (uint8_t)lanes[k];
+		}
+
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, total);
+		return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+		float total = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			float best = FLT_MAX;
+			int bestIndex = 0;
+			for(int e = 0; e < pal.Count; ++e)
+			{
+				float error = 0.0f;
+				for(int c = first; c < first + count; ++c)
+				{
+					float d = px.C[c][i] - pal.C[c][e];
+					error += d*d;
+				}
+
+				if(error < best)
+				{
+					best = error;
+					bestIndex = e;
+				}
+			}
+
+			indices[i] = (uint8_t)bestIndex;
+			total += best;
+		}
+		return total;
+#endif
+	}
+
+	// Initial endpoints for channels [first, first + count): the bounding box, or the
+	// extent of the pixels along their principal axis.  Both are pulled in a little, as
+	// the extremes are rarely worth matching exactly.
+	void FitEndpoints(const BlockPixels& px, int first, int count, bool principalAxis, float e0[4], float e1[4])
+	{
+		float mean[4] = {};
+		float lo[4] = {};
+		float hi[4] = {};
+		for(int c = first; c < first + count; ++c)
+		{
+			lo[c] = 255.0f;
+			hi[c] = 0.0f;
+			for(int i = 0; i < 16; ++i)
+			{
+				float v = px.C[c][i];
+				mean[c] += v;
+				lo[c] = std::min(lo[c], v);
+				hi[c] = std::max(hi[c], v);
+			}
+			mean[c] /= 16.0f;
+		}
+
+		if(!principalAxis)
+		{
+			for(int c = first; c < first + count; ++c)
+			{
+				float inset = (hi[c] - lo[c]) / 16.0f;
+				e0[c] = lo[c] + inset;
+				e1[c] = hi[c] - inset;
+			}
+			return;
+		}
+
+		float cov[4][4] = {};
+		for(int i = 0; i < 16; ++i)
+		{
+			for(int a = first; a < first + count; ++a)
+			{
+				float da = px.C[a][i] - mean[a];
+				for(int b = first; b < first + count; ++b)
+					cov[a][b] += da*(px.C[b][i] - mean[b]);
+			}
+		}
+
+		// Power iteration, starting from the bounding box diagonal.
+		float axis[4] = {};
+		for(int c = first; c < first + count; ++c)
+			axis[c] = hi[c] - lo[c];
+
+		for(int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float largest = 0.0f;
+			for(int a = first; a < first + count; ++a)
+			{
+				for(int b = first; b < first + count; ++b)
+					next[a] += cov[a][b]*axis[b];
+				largest = std::max(largest, std::fabs(next[a]));
+			}
+
+			if(largest < 1e-6f)
+				break;
+
+			for(int a = first; a < first + count; ++a)
+				axis[a] = next[a] / largest;
+		}
+
+		float length = 0.0f;
+		for(int c = first; c < first + count; ++c)
+			length += axis[c]*axis[c];
+
+		// A flat block: both endpoints on the mean.
+		if(length < 1e-12f)
+		{
+			for(int c = first; c < first + count; ++c)
+				e0[c] = e1[c] = mean[c];
+			return;
+		}
+
+		length = std::sqrt(length);
+		for(int c = first; c < first + count; ++c)
+			axis[c] /= length;
+
+		float tMin = FLT_MAX;
+		float tMax = -FLT_MAX;
+		for(int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for(int c = first; c < first + count; ++c)
+				t += (px.C[c][i] - mean[c])*axis[c];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+
+		float inset = (tMax - tMin) / 16.0f;
+		tMin += inset;
+		tMax -= inset;
+
+		for(int c = first; c < first + count; ++c)
+		{
+			e0[c] = std::min(std::max(mean[c] + axis[c]*tMin, 0.0f), 255.0f);
+			e1[c] = std::min(std::max(mean[c] + axis[c]*tMax, 0.0f), 255.0f);
+		}
+	}
+
+	// Least-squares endpoints for the chosen indices; weights[i] is the share of e1 in
+	// palette entry i.  Returns false if the system is singular (all pixels on one entry).
+	bool RefineEndpoints(const BlockPixels& px, int first, int count, const uint8_t indices[16],
+		const float* weights, float e0[4], float e1[4])
+	{
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for(int i = 0; i < 16; ++i)
+		{
+			float b = weights[indices[i]];
+			float a = 1.0f - b;
+			aa += a*a;
+			bb += b*b;
+			ab += a*b;
+			for(int c = first; c < first + count; ++c)
+			{
+				ax[c] += a*px.C[c][i];
+				bx[c] += b*px.C[c][i];
+			}
+		}
+
+		float det = aa*bb - ab*ab;
+		if(std::fabs(det) < 1e-6f)
+			return false;
+
+		for(int c = first; c < first + count; ++c)
+		{
+			e0[c] = std::min(std::max((ax[c]*bb - bx[c]*ab) / det, 0.0f), 255.0f);
+			e1[c] = std::min(std::max((bx[c]*aa - ax[c]*ab) / det, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	// Writes fields LSB first into a zeroed 16-byte block, as BC7 lays them out.
+	struct BitWriter
+	{
+		uint8_t* Block;
+		uint32_t Position;
+
+		void Write(uint32_t value, uint32_t bitCount)
+		{
+			for(uint32_t b = 0; b < bitCount; ++b, ++Position)
+			{
+				if((value >> b) & 1)
+					Block[Position >> 3] |= (uint8_t)(1 << (Position & 7));
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t* Block;
+		uint32_t Position;
+
+		uint32_t Read(uint32_t bitCount)
+		{
+			uint32_t value = 0;
+			for(uint32_t b = 0; b < bitCount; ++b, ++Position)
+				value |= (uint32_t)((Block[Position >> 3] >> (Position & 7)) & 1) << b;
+			return value;
+		}
+	};
+
+	//
+	// BC1 colour block, also the second half of a BC3 block.
+	//
+
+	uint16_t PackColor565(const float c[4])
+	{
+		int r = std::min(std::max((int)(c[0]*31.0f/255.0f + 0.5f), 0), 31);
+		int g = std::min(std::max((int)(c[1]*63.0f/255.0f + 0.5f), 0), 63);
+		int b = std::min(std::max((int)(c[2]*31.0f/255.0f + 0.5f), 0), 31);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackColor565(uint16_t color, int rgb[3])
+	{
+		int r = (color >> 11) & 31;
+		int g = (color >> 5) & 63;
+		int b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// Four-colour mode palette (c0 > c1), or a single colour when the endpoints match.
+	float EvaluateColorBlock(const BlockPixels& px, uint16_t c0, uint16_t c1, uint8_t indices[16])
+	{
+		int a[3], b[3];
+		UnpackColor565(c0, a);
+		UnpackColor565(c1, b);
+
+		Palette pal;
+		pal.Count = (c0 == c1) ? 1 : 4;
+		for(int c = 0; c < 3; ++c)
+		{
+			pal.C[c][0] = (float)a[c];
+			pal.C[c][1] = (float)b[c];
+			pal.C[c][2] = (float)((2*a[c] + b[c]) / 3);
+			pal.C[c][3] = (float)((a[c] + 2*b[c]) / 3);
+		}
+
+		return FindIndices(px, pal, 0, 3, indices);
+	}
+
+	void EncodeColorBlock(const BlockPixels& px, BCQuality quality, uint8_t* block)
+	{
+		float e0[4] = {};
+		float e1[4] = {};
+		FitEndpoints(px, 0, 3, quality != BCQuality::Fast, e0, e1);
+
+		uint16_t best0 = 0;
+		uint16_t best1 = 0;
+		uint8_t bestIndices[16] = {};
+		float bestError = FLT_MAX;
+
+		int passes = GetRefinePasses(quality);
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			uint16_t c0 = PackColor565(e0);
+			uint16_t c1 = PackColor565(e1);
+			if(c0 < c1)
+			{
+				std::swap(c0, c1);
+				std::swap(e0, e1);
+			}
+
+			uint8_t indices[16];
+			float error = EvaluateColorBlock(px, c0, c1, indices);
+			if(error >= bestError)
+				break;
+
+			best0 = c0;
+			best1 = c1;
+			bestError = error;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+
+			if(error == 0.0f || c0 == c1 || !RefineEndpoints(px, 0, 3, indices, BC1Weights, e0, e1))
+				break;
+		}
+
+		uint32_t bits = 0;
+		for(int i = 0; i < 16; ++i)
+			bits |= (uint32_t)bestIndices[i] << (2*i);
+
+		block[0] = (uint8_t)(best0 & 0xff);
+		block[1] = (uint8_t)(best0 >> 8);
+		block[2] = (uint8_t)(best1 & 0xff);
+		block[3] = (uint8_t)(best1 >> 8);
+		for(int i = 0; i < 4; ++i)
+			block[4 + i] = (uint8_t)(bits >> (8*i));
+	}
+
+	void DecodeColorBlock(const uint8_t* block, uint8_t rgba[64], bool fourColorOnly)
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+		uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+
+		int palette[4][4];
+		UnpackColor565(c0, palette[0]);
+		UnpackColor565(c1, palette[1]);
+		for(int k = 0; k < 4; ++k)
+			palette[k][3] = 255;
+
+		for(int c = 0; c < 3; ++c)
+		{
+			int a = palette[0][c];
+			int b = palette[1][c];
+			if(fourColorOnly || c0 > c1)
+			{
+				palette[2][c] = (2*a + b) / 3;
+				palette[3][c] = (a + 2*b) / 3;
+			}
+			else
+			{
+				palette[2][c] = (a + b) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		if(!fourColorOnly && c0 <= c1)
+			palette[3][3] = 0;
+
+		uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+		for(int i = 0; i < 16; ++i)
+		{
+			const int* p = palette[(bits >> (2*i)) & 3];
+			for(int c = 0; c < 4; ++c)
+				rgba[i*4 + c] = (uint8_t)p[c];
+		}
+	}
+
+	//
+	// BC3 alpha block (BC4 layout), always in eight-value mode.
+	//
+
+	float EvaluateAlphaBlock(const BlockPixels& px, int a0, int a1, uint8_t indices[16])
+	{
+		Palette pal;
+		pal.C[3][0] = (float)a0;
+		pal.C[3][1] = (float)a1;
+		pal.Count = (a0 == a1) ? 1 : 8;
+		for(int k = 1; k < 7; ++k)
+			pal.C[3][k + 1] = (float)(((7 - k)*a0 + k*a1) / 7);
+
+		return FindIndices(px, pal, 3, 1, indices);
+	}
+
+	void EncodeAlphaBlock(const BlockPixels& px, BCQuality quality, uint8_t* block)
+	{
+		// The exact range is the right start here: eight steps cover it finely.
+		float e0[4] = {};
+		float e1[4] = {};
+		e0[3] = 0.0f;
+		e1[3] = 255.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			e0[3] = std::max(e0[3], px.C[3][i]);
+			e1[3] = std::min(e1[3], px.C[3][i]);
+		}
+
+		int best0 = 0;
+		int best1 = 0;
+		uint8_t bestIndices[16] = {};
+		float bestError = FLT_MAX;
+
+		int passes = GetRefinePasses(quality);
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			int a0 = ClampByte((int)(e0[3] + 0.5f));
+			int a1 = ClampByte((int)(e1[3] + 0.5f));
+			if(a0 < a1)
+			{
+				std::swap(a0, a1);
+				std::swap(e0, e1);
+			}
+
+			uint8_t indices[16];
+			float error = EvaluateAlphaBlock(px, a0, a1, indices);
+			if(error >= bestError)
+				break;
+
+			best0 = a0;
+			best1 = a1;
+			bestError = error;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+
+			if(error == 0.0f || a0 == a1 || !RefineEndpoints(px, 3, 1, indices, BC4Weights, e0, e1))
+				break;
+		}
+
+		uint64_t bits = 0;
+		for(int i = 0; i < 16; ++i)
+			bits |= (uint64_t)bestIndices[i] << (3*i);
+
+		block[0] = (uint8_t)best0;
+		block[1] = (uint8_t)best1;
+		for(int i = 0; i < 6; ++i)
+			block[2 + i] = (uint8_t)(bits >> (8*i));
+	}
+
+	void DecodeAlphaBlock(const uint8_t* block, uint8_t rgba[64])
+	{
+		int a0 = block[0];
+		int a1 = block[1];
+
+		int palette[8] = { a0, a1 };
+		if(a0 > a1)
+		{
+			for(int k = 1; k < 7; ++k)
+				palette[k + 1] = ((7 - k)*a0 + k*a1) / 7;
+		}
+		else
+		{
+			for(int k = 1; k < 5; ++k)
+				palette[k + 1] = ((5 - k)*a0 + k*a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t bits = 0;
+		for(int i = 0; i < 6; ++i)
+			bits |= (uint64_t)block[2 + i] << (8*i);
+
+		for(int i = 0; i < 16; ++i)
+			rgba[i*4 + 3] = (uint8_t)palette[(bits >> (3*i)) & 7];
+	}
+
+	//
+	// BC7 mode 6: 7-bit RGBA endpoints, a p-bit each, and 4-bit indices.
+	// BC7 mode 5: 7-bit RGB and 8-bit alpha endpoints, with 2-bit indices for each.
+	//
+
+	int BC7Interpolate(int a, int b, int weight)
+	{
+		return ((64 - weight)*a + weight*b + 32) >> 6;
+	}
+
+	// Picks the p-bit that brings the 7-bit endpoint closest to e.
+	void QuantizeBC7Endpoint(const float e[4], int q[4], int& pbit)
+	{
+		float bestError = FLT_MAX;
+		for(int p = 0; p < 2; ++p)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for(int c = 0; c < 4; ++c)
+			{
+				int v = (int)std::floor((e[c] - (float)p) / 2.0f + 0.5f);
+				candidate[c] = std::min(std::max(v, 0), 127);
+
+				float d = (float)(candidate[c]*2 + p) - e[c];
+				error += d*d;
+			}
+
+			if(error < bestError)
+			{
+				bestError = error;
+				pbit = p;
+				std::memcpy(q, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	void GetBC7Palette(const int q0[4], int p0, const int q1[4], int p1, int palette[16][4])
+	{
+		for(int c = 0; c < 4; ++c)
+		{
+			int a = q0[c]*2 + p0;
+			int b = q1[c]*2 + p1;
+			for(int k = 0; k < 16; ++k)
+				palette[k][c] = BC7Interpolate(a, b, BC7Weights4[k]);
+		}
+	}
+
+	float EncodeBC7Mode6(const BlockPixels& px, BCQuality quality, uint8_t* block)
+	{
+		float e0[4] = {};
+		float e1[4] = {};
+		FitEndpoints(px, 0, 4, quality != BCQuality::Fast, e0, e1);
+
+		float weights[16];
+		for(int k = 0; k < 16; ++k)
+			weights[k] = (float)BC7Weights4[k] / 64.0f;
+
+		int best0[4] = {}, best1[4] = {};
+		int bestP0 = 0, bestP1 = 0;
+		uint8_t bestIndices[16] = {};
+		float bestError = FLT_MAX;
+
+		int passes = GetRefinePasses(quality);
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			int q0[4], q1[4];
+			int p0 = 0, p1 = 0;
+			QuantizeBC7Endpoint(e0, q0, p0);
+			QuantizeBC7Endpoint(e1, q1, p1);
+
+			int palette[16][4];
+			GetBC7Palette(q0, p0, q1, p1, palette);
+
+			Palette pal;
+			pal.Count = 16;
+			for(int k = 0; k < 16; ++k)
+			{
+				for(int c = 0; c < 4; ++c)
+					pal.C[c][k] = (float)palette[k][c];
+			}
+
+			uint8_t indices[16];
+			float error = FindIndices(px, pal, 0, 4, indices);
+			if(error >= bestError)
+				break;
+
+			std::memcpy(best0, q0, sizeof(q0));
+			std::memcpy(best1, q1, sizeof(q1));
+			bestP0 = p0;
+			bestP1 = p1;
+			bestError = error;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+
+			if(error == 0.0f || !RefineEndpoints(px, 0, 4, indices, weights, e0, e1))
+				break;
+		}
+
+		// The first index is stored without its top bit, so it has to be below 8.
+		if(bestIndices[0] & 8)
+		{
+			std::swap(best0, best1);
+			std::swap(bestP0, bestP1);
+			for(int i = 0; i < 16; ++i)
+				bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+		}
+
+		std::memset(block, 0, 16);
+		BitWriter bits = { block, 0 };
+		bits.Write(1 << 6, 7);
+		for(int c = 0; c < 4; ++c)
+		{
+			bits.Write((uint32_t)best0[c], 7);
+			bits.Write((uint32_t)best1[c], 7);
+		}
+		bits.Write((uint32_t)bestP0, 1);
+		bits.Write((uint32_t)bestP1, 1);
+		bits.Write(bestIndices[0], 3);
+		for(int i = 1; i < 16; ++i)
+			bits.Write(bestIndices[i], 4);
+
+		return bestError;
+	}
+
+	// Fits one half of a mode 5 block: channels [first, first + count) quantized to
+	// `bits` bits, four palette entries.
+	float FitBC7Mode5Channels(const BlockPixels& px, BCQuality quality, int first, int count, int bits,
+		int q0[4], int q1[4], uint8_t indices[16])
+	{
+		float e0[4] = {};
+		float e1[4] = {};
+		FitEndpoints(px, first, count, true, e0, e1);
+
+		float weights[4];
+		for(int k = 0; k < 4; ++k)
+			weights[k] = (float)BC7Weights2[k] / 64.0f;
+
+		int maxValue = (1 << bits) - 1;
+		float bestError = FLT_MAX;
+
+		int passes = GetRefinePasses(quality);
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			int a[4] = {}, b[4] = {};
+			Palette pal;
+			pal.Count = 4;
+			for(int c = first; c < first + count; ++c)
+			{
+				a[c] = std::min(std::max((int)(e0[c]*maxValue/255.0f + 0.5f), 0), maxValue);
+				b[c] = std::min(std::max((int)(e1[c]*maxValue/255.0f + 0.5f), 0), maxValue);
+
+				// Expand to 8 bits by repeating the top bits.
+				int ea = (a[c] << (8 - bits)) | (a[c] >> (2*bits - 8));
+				int eb = (b[c] << (8 - bits)) | (b[c] >> (2*bits - 8));
+				for(int k = 0; k < 4; ++k)
+					pal.C[c][k] = (float)BC7Interpolate(ea, eb, BC7Weights2[k]);
+			}
+
+			uint8_t candidate[16];
+			float error = FindIndices(px, pal, first, count, candidate);
+			if(error >= bestError)
+				break;
+
+			std::memcpy(q0, a, sizeof(a));
+			std::memcpy(q1, b, sizeof(b));
+			std::memcpy(indices, candidate, sizeof(candidate));
+			bestError = error;
+
+			if(error == 0.0f || !RefineEndpoints(px, first, count, candidate, weights, e0, e1))
+				break;
+		}
+
+		// The first index is stored without its top bit, so it has to be below 2.
+		if(indices[0] & 2)
+		{
+			for(int c = first; c < first + count; ++c)
+				std::swap(q0[c], q1[c]);
+			for(int i = 0; i < 16; ++i)
+				indices[i] = (uint8_t)(3 - indices[i]);
+		}
+
+		return bestError;
+	}
+
+	float EncodeBC7Mode5(const BlockPixels& px, BCQuality quality, uint8_t* block)
+	{
+		int rgb0[4], rgb1[4], alpha0[4], alpha1[4];
+		uint8_t colorIndices[16], alphaIndices[16];
+		float error = FitBC7Mode5Channels(px, quality, 0, 3, 7, rgb0, rgb1, colorIndices);
+		error += FitBC7Mode5Channels(px, quality, 3, 1, 8, alpha0, alpha1, alphaIndices);
+
+		std::memset(block, 0, 16);
+		BitWriter bits = { block, 0 };
+		bits.Write(1 << 5, 6);
+		bits.Write(0, 2); // no channel rotation
+		for(int c = 0; c < 3; ++c)
+		{
+			bits.Write((uint32_t)rgb0[c], 7);
+			bits.Write((uint32_t)rgb1[c], 7);
+		}
+		bits.Write((uint32_t)alpha0[3], 8);
+		bits.Write((uint32_t)alpha1[3], 8);
+		bits.Write(colorIndices[0], 1);
+		for(int i = 1; i < 16; ++i)
+			bits.Write(colorIndices[i], 2);
+		bits.Write(alphaIndices[0], 1);
+		for(int i = 1; i < 16; ++i)
+			bits.Write(alphaIndices[i], 2);
+
+		return error;
+	}
+
+	void EncodeBC7Block(const BlockPixels& px, BCQuality quality, uint8_t* block)
+	{
+		float error = EncodeBC7Mode6(px, quality, block);
+		if(quality == BCQuality::Fast || error == 0.0f)
+			return;
+
+		// Mode 5 fits alpha on its own, which suits cut-out edges far better.
+		float lo = px.C[3][0], hi = px.C[3][0];
+		for(int i = 1; i < 16; ++i)
+		{
+			lo = std::min(lo, px.C[3][i]);
+			hi = std::max(hi, px.C[3][i]);
+		}
+		if(lo == hi)
+			return;
+
+		uint8_t candidate[16];
+		if(EncodeBC7Mode5(px, quality, candidate) < error)
+			std::memcpy(block, candidate, sizeof(candidate));
+	}
+
+	void DecodeBC7Mode5(const uint8_t* block, uint8_t rgba[64])
+	{
+		BitReader bits = { block, 6 };
+		uint32_t rotation = bits.Read(2);
+
+		int e0[4], e1[4];
+		for(int c = 0; c < 3; ++c)
+		{
+			int a = (int)bits.Read(7);
+			int b = (int)bits.Read(7);
+			e0[c] = (a << 1) | (a >> 6);
+			e1[c] = (b << 1) | (b >> 6);
+		}
+		e0[3] = (int)bits.Read(8);
+		e1[3] = (int)bits.Read(8);
+
+		uint32_t colorIndices[16], alphaIndices[16];
+		for(int i = 0; i < 16; ++i)
+			colorIndices[i] = bits.Read(i == 0 ? 1 : 2);
+		for(int i = 0; i < 16; ++i)
+			alphaIndices[i] = bits.Read(i == 0 ? 1 : 2);
+
+		for(int i = 0; i < 16; ++i)
+		{
+			uint8_t* p = rgba + i*4;
+			for(int c = 0; c < 3; ++c)
+				p[c] = (uint8_t)BC7Interpolate(e0[c], e1[c], BC7Weights2[colorIndices[i]]);
+			p[3] = (uint8_t)BC7Interpolate(e0[3], e1[3], BC7Weights2[alphaIndices[i]]);
+
+			// Rotation swaps alpha with one of the colour channels.
+			if(rotation != 0)
+				std::swap(p[3], p[rotation - 1]);
+		}
+	}
+
+	// Only modes 5 and 6, the ones EncodeBC7Block writes, are decoded; other modes come
+	// out black.
+	void DecodeBC7Block(const uint8_t* block, uint8_t rgba[64])
+	{
+		if((block[0] & 0x3f) == 0x20)
+		{
+			DecodeBC7Mode5(block, rgba);
+			return;
+		}
+
+		if((block[0] & 0x7f) != 0x40)
+		{
+			std::memset(rgba, 0, 64);
+			return;
+		}
+
+		BitReader bits = { block, 7 };
+		int q0[4], q1[4];
+		for(int c = 0; c < 4; ++c)
+		{
+			q0[c] = (int)bits.Read(7);
+			q1[c] = (int)bits.Read(7);
+		}
+		int p0 = (int)bits.Read(1);
+		int p1 = (int)bits.Read(1);
+
+		int palette[16][4];
+		GetBC7Palette(q0, p0, q1, p1, palette);
+
+		for(int i = 0; i < 16; ++i)
+		{
+			uint32_t index = bits.Read(i == 0 ? 3 : 4);
+			for(int c = 0; c < 4; ++c)
+				rgba[i*4 + c] = (uint8_t)palette[index][c];
+		}
+	}
+
+	// Copies a block out of the image, repeating the last row and column past the edges.
+	void GatherBlock(const BCImage& src, uint32_t bx, uint32_t by, uint8_t rgba[64])
+	{
+		for(uint32_t y = 0; y < 4; ++y)
+		{
+			uint32_t sy = std::min(by*4 + y, src.Height - 1);
+			const uint8_t* row = src.Pixels + sy*src.RowPitch;
+			for(uint32_t x = 0; x < 4; ++x)
+			{
+				uint32_t sx = std::min(bx*4 + x, src.Width - 1);
+				std::memcpy(rgba + (y*4 + x)*4, row + sx*4, 4);
+			}
+		}
+	}
+}
+
+double BCErrorStats::GetPsnr()const
+{
+	if(SampleCount == 0 || SquaredError <= 0.0)
+		return std::numeric_limits<double>::infinity();
+
+	double mse = SquaredError / (double)SampleCount;
+	return 10.0*std::log10(255.0*255.0 / mse);
+}
+
+size_t GetBCBlockBytes(BCFormat format)
+{
+	return format == BCFormat::BC1 ? 8 : 16;
+}
+
+size_t GetBCRowPitch(BCFormat format, uint32_t width)
+{
+	return (size_t)std::max((width + 3) / 4, 1u)*GetBCBlockBytes(format);
+}
+
+size_t GetBCImageBytes(BCFormat format, uint32_t width, uint32_t height)
+{
+	return GetBCRowPitch(format, width)*std::max((height + 3) / 4, 1u);
+}
+
+void EncodeBCBlock(BCFormat format, BCQuality quality, const uint8_t rgba[64], uint8_t* block)
+{
+	BlockPixels px;
+	LoadBlock(rgba, px);
+
+	switch(format)
+	{
+	case BCFormat::BC1:
+		EncodeColorBlock(px, quality, block);
+		break;
+
+	case BCFormat::BC3:
+		EncodeAlphaBlock(px, quality, block);
+		EncodeColorBlock(px, quality, block + 8);
+		break;
+
+	case BCFormat::BC7:
+		EncodeBC7Block(px, quality, block);
+		break;
+	}
+}
+
+void DecodeBCBlock(BCFormat format, const uint8_t* block, uint8_t rgba[64])
+{
+	switch(format)
+	{
+	case BCFormat::BC1:
+		DecodeColorBlock(block, rgba, false);
+		break;
+
+	case BCFormat::BC3:
+		DecodeColorBlock(block + 8, rgba, true);
+		DecodeAlphaBlock(block, rgba);
+		break;
+
+	case BCFormat::BC7:
+		DecodeBC7Block(block, rgba);
+		break;
+	}
+}
+
+void CompressBCImage(BCFormat format, BCQuality quality, const BCImage& src, uint8_t* dst, ThreadPool* pool)
+{
+	if(src.Width == 0 || src.Height == 0)
+		return;
+
+	uint32_t blocksX = (src.Width + 3) / 4;
+	uint32_t blocksY = (src.Height + 3) / 4;
+	size_t blockBytes = GetBCBlockBytes(format);
+	size_t rowPitch = GetBCRowPitch(format, src.Width);
+
+	auto compressRows = [=, &src](uint32_t firstRow, uint32_t lastRow)
+	{
+		uint8_t rgba[64];
+		for(uint32_t by = firstRow; by < lastRow; ++by)
+		{
+			uint8_t* block = dst + by*rowPitch;
+			for(uint32_t bx = 0; bx < blocksX; ++bx, block += blockBytes)
+			{
+				GatherBlock(src, bx, by, rgba);
+				EncodeBCBlock(format, quality, rgba, block);
+			}
+		}
+	};
+
+	if(pool == nullptr || blocksY < 2)
+	{
+		compressRows(0, blocksY);
+		return;
+	}
+
+	// A few chunks per thread keeps the threads busy when some rows are slower.
+	uint32_t chunkCount = std::min(blocksY, (uint32_t)pool->GetThreadCount()*4);
+	uint32_t rowsPerChunk = (blocksY + chunkCount - 1) / chunkCount;
+
+	ParallelFor(pool, (blocksY + rowsPerChunk - 1) / rowsPerChunk, [&](size_t chunk)
+	{
+		uint32_t row = (uint32_t)chunk*rowsPerChunk;
+		compressRows(row, std::min(row + rowsPerChunk, blocksY));
+	});
+}
+
+void AccumulateBCError(BCFormat format, const BCImage& src, const uint8_t* blocks, BCErrorStats& stats)
+{
+	uint32_t blocksX = (src.Width + 3) / 4;
+	uint32_t blocksY = (src.Height + 3) / 4;
+	size_t blockBytes = GetBCBlockBytes(format);
+	size_t rowPitch = GetBCRowPitch(format, src.Width);
+	int channels = format == BCFormat::BC1 ? 3 : 4;
+
+	uint8_t rgba[64];
+	for(uint32_t by = 0; by < blocksY; ++by)
+	{
+		for(uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			DecodeBCBlock(format, blocks + by*rowPitch + bx*blockBytes, rgba);
+
+			for(uint32_t y = 0; y < 4 && by*4 + y < src.Height; ++y)
+			{
+				const uint8_t* row = src.Pixels + (by*4 + y)*src.RowPitch;
+				for(uint32_t x = 0; x < 4 && bx*4 + x < src.Width; ++x)
+				{
+					const uint8_t* expected = row + (bx*4 + x)*4;
+					const uint8_t* actual = rgba + (y*4 + x)*4;
+					for(int c = 0; c < channels; ++c)
+					{
+						double d = (double)actual[c] - (double)expected[c];
+						stats.SquaredError += d*d;
+					}
+					stats.SampleCount += channels;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+//***************************************************************************************
+// BCnEncoder.h
+//
+// CPU block compressor for BC1, BC3 and BC7.  Works on 8-bit RGBA images and has no
+// Win32 or Direct3D dependencies, so the offline tools can use it as well.
+//   -Fast takes the endpoints from the block's bounding box.
+//   -Normal fits them along the principal axis and refines them once by least squares.
+//   -High keeps refining while the error goes down, up to a few passes.
+// BC7 blocks use mode 6 (one subset, RGBA endpoints, 16 steps); above Fast, blocks with
+// varying alpha also try mode 5, which fits colour and alpha separately.
+//
+// The palette search, which is most of the work, runs four pixels at a time with SSE2
+// when it is available.  CompressBCImage spreads rows of blocks over a ThreadPool.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+enum class BCFormat
+{
+	BC1,
+	BC3,
+	BC7
+};
+
+enum class BCQuality
+{
+	Fast,
+	Normal,
+	High
+};
+
+// 8-bit RGBA pixels.  Partial blocks at the right and bottom edges are padded by
+// repeating the last column and row.
+struct BCImage
+{
+	const uint8_t* Pixels = nullptr;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	size_t RowPitch = 0;
+};
+
+// Squared error summed over the compared channels; BC1 leaves alpha out.
+struct BCErrorStats
+{
+	double SquaredError = 0.0;
+	uint64_t SampleCount = 0;
+
+	// Peak signal-to-noise ratio in dB; infinite for an exact match.
+	double GetPsnr()const;
+};
+
+size_t GetBCBlockBytes(BCFormat format);
+size_t GetBCRowPitch(BCFormat format, uint32_t width);
+size_t GetBCImageBytes(BCFormat format, uint32_t width, uint32_t height);
+
+// rgba holds the 16 pixels of the block in row order.
+void EncodeBCBlock(BCFormat format, BCQuality quality, const uint8_t rgba[64], uint8_t* block);
+void DecodeBCBlock(BCFormat format, const uint8_t* block, uint8_t rgba[64]);
+
+// dst receives GetBCImageBytes bytes, with rows of blocks GetBCRowPitch apart.  Don't pass
+// the pool the caller is running on: this waits for the rows it submits.
+void CompressBCImage(BCFormat format, BCQuality quality, const BCImage& src, uint8_t* dst,
+	ThreadPool* pool = nullptr);
+
+// Decodes blocks (laid out as CompressBCImage writes them) and adds its error against src.
+void AccumulateBCError(BCFormat format, const BCImage& src, const uint8_t* blocks, BCErrorStats& stats);
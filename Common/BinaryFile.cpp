@@ -0,0 +1,322 @@
+//***************************************************************************************
+// BinaryFile.cpp
+//***************************************************************************************
+
+#include "BinaryFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Largest single read; well inside what ReadFile and read accept.
+	const uint64_t ReadChunkSize = 64ull * 1024 * 1024;
+
+	BinaryFileResult ReadOpenFile(BinaryFile& file, std::vector<uint8_t>& data)
+	{
+		try
+		{
+			data.resize((size_t)file.GetSize());
+		}
+		catch(const std::bad_alloc&)
+		{
+			return BinaryFileResult::TooLarge;
+		}
+		catch(const std::length_error&)
+		{
+			return BinaryFileResult::TooLarge;
+		}
+
+		BinaryFileResult result = file.Read(data.data());
+		if(result != BinaryFileResult::Ok)
+			data.clear();
+
+		return result;
+	}
+}
+
+const char* GetBinaryFileResultName(BinaryFileResult result)
+{
+	switch(result)
+	{
+	case BinaryFileResult::Ok:         return "ok";
+	case BinaryFileResult::NotFound:   return "not found";
+	case BinaryFileResult::OpenFailed: return "can't be opened";
+	case BinaryFileResult::TooLarge:   return "too large";
+	case BinaryFileResult::ReadFailed: return "read failed";
+	}
+	return "unknown";
+}
+
+BinaryFile::BinaryFile()
+{
+}
+
+BinaryFile::~BinaryFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+BinaryFileResult BinaryFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	HANDLE file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		DWORD error = GetLastError();
+		return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ?
+			BinaryFileResult::NotFound : BinaryFileResult::OpenFailed;
+	}
+	mFile = file;
+
+	LARGE_INTEGER fileSize = {};
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < 0)
+	{
+		Close();
+		return BinaryFileResult::OpenFailed;
+	}
+
+	if((uint64_t)fileSize.QuadPart > (uint64_t)SIZE_MAX)
+	{
+		Close();
+		return BinaryFileResult::TooLarge;
+	}
+
+	mSize = (uint64_t)fileSize.QuadPart;
+	return BinaryFileResult::Ok;
+}
+
+void BinaryFile::Close()
+{
+	if(mFile != nullptr)
+		CloseHandle(mFile);
+
+	mFile = nullptr;
+	mSize = 0;
+}
+
+BinaryFileResult BinaryFile::Read(void* data)
+{
+	if(mFile == nullptr)
+		return BinaryFileResult::ReadFailed;
+
+	LARGE_INTEGER start = {};
+	if(!SetFilePointerEx(mFile, start, nullptr, FILE_BEGIN))
+		return BinaryFileResult::ReadFailed;
+
+	uint8_t* dest = static_cast<uint8_t*>(data);
+	for(uint64_t offset = 0; offset < mSize; )
+	{
+		DWORD chunk = (DWORD)std::min(mSize - offset, ReadChunkSize);
+		DWORD bytesRead = 0;
+		if(!ReadFile(mFile, dest + offset, chunk, &bytesRead, nullptr) || bytesRead == 0)
+			return BinaryFileResult::ReadFailed;
+
+		offset += bytesRead;
+	}
+
+	return BinaryFileResult::Ok;
+}
+
+#else
+
+BinaryFileResult BinaryFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	std::string path = NarrowPath(fileName);
+	if(path.empty())
+		return BinaryFileResult::OpenFailed;
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		return errno == ENOENT || errno == ENOTDIR ? BinaryFileResult::NotFound : BinaryFileResult::OpenFailed;
+	mFile = fd;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size < 0)
+	{
+		Close();
+		return BinaryFileResult::OpenFailed;
+	}
+
+	if((uint64_t)info.st_size > (uint64_t)SIZE_MAX)
+	{
+		Close();
+		return BinaryFileResult::TooLarge;
+	}
+
+	mSize = (uint64_t)info.st_size;
+	return BinaryFileResult::Ok;
+}
+
+void BinaryFile::Close()
+{
+	if(mFile >= 0)
+		close(mFile);
+
+	mFile = -1;
+	mSize = 0;
+}
+
+BinaryFileResult BinaryFile::Read(void* data)
+{
+	if(mFile < 0 || lseek(mFile, 0, SEEK_SET) != 0)
+		return BinaryFileResult::ReadFailed;
+
+	uint8_t* dest = static_cast<uint8_t*>(data);
+	for(uint64_t offset = 0; offset < mSize; )
+	{
+		size_t chunk = (size_t)std::min(mSize - offset, ReadChunkSize);
+		ssize_t bytesRead = read(mFile, dest + offset, chunk);
+		if(bytesRead < 0 && errno == EINTR)
+			continue;
+		if(bytesRead <= 0)
+			return BinaryFileResult::ReadFailed;
+
+		offset += (uint64_t)bytesRead;
+	}
+
+	return BinaryFileResult::Ok;
+}
+
+#endif
+
+uint64_t BinaryFile::GetSize()const
+{
+	return mSize;
+}
+
+BinaryFileResult ReadBinaryFile(const wchar_t* fileName, std::vector<uint8_t>& data)
+{
+	data.clear();
+
+	BinaryFile file;
+	BinaryFileResult result = file.Open(fileName);
+	if(result != BinaryFileResult::Ok)
+		return result;
+
+	return ReadOpenFile(file, data);
+}
+
+BinaryFileResult BinaryData::Load(const wchar_t* fileName, uint64_t mapThreshold)
+{
+	Close();
+
+	BinaryFile file;
+	BinaryFileResult result = file.Open(fileName);
+	if(result != BinaryFileResult::Ok)
+		return result;
+
+	// Empty files can't be mapped, so they are always read.
+	if(file.GetSize() == 0 || file.GetSize() < mapThreshold)
+		return ReadOpenFile(file, mBuffer);
+
+	file.Close();
+	if(!mMapping.Open(fileName))
+		return BinaryFileResult::OpenFailed;
+
+	return BinaryFileResult::Ok;
+}
+
+void BinaryData::Close()
+{
+	mMapping.Close();
+	mBuffer.clear();
+	mBuffer.shrink_to_fit();
+}
+
+const uint8_t* BinaryData::GetData()const
+{
+	return mMapping.IsOpen() ? mMapping.GetData() : mBuffer.data();
+}
+
+uint64_t BinaryData::GetSize()const
+{
+	return mMapping.IsOpen() ? mMapping.GetSize() : (uint64_t)mBuffer.size();
+}
+
+bool BinaryData::IsMapped()const
+{
+	return mMapping.IsOpen();
+}
+
+AsyncBinaryReader::AsyncBinaryReader(ThreadPool& pool, uint64_t mapThreshold)
+	: mPool(pool),
+	  mMapThreshold(mapThreshold)
+{
+}
+
+AsyncBinaryReader::~AsyncBinaryReader()
+{
+	// The reads still going call back into this object.
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this]() { return mPending == 0; });
+}
+
+void AsyncBinaryReader::Read(const std::wstring& fileName, Completion onComplete)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		++mPending;
+	}
+
+	mPool.Submit([this, fileName, onComplete]()
+	{
+		std::exception_ptr error;
+		try
+		{
+			auto data = std::make_shared<BinaryData>();
+			BinaryFileResult result = data->Load(fileName.c_str(), mMapThreshold);
+			if(result != BinaryFileResult::Ok)
+				data = nullptr;
+
+			onComplete(result, data);
+		}
+		catch(...)
+		{
+			error = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(error != nullptr && mError == nullptr)
+			mError = error;
+
+		if(--mPending == 0)
+			mIdle.notify_all();
+	});
+}
+
+void AsyncBinaryReader::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this]() { return mPending == 0; });
+
+	if(mError != nullptr)
+	{
+		std::exception_ptr error = mError;
+		mError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+uint32_t AsyncBinaryReader::GetPendingCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPending;
+}
@@ -0,0 +1,128 @@
+//***************************************************************************************
+// BinaryFile.h
+//
+// Whole-file reads for binary assets: shader and pipeline caches, meshes, textures.
+//   -Sizes are 64-bit throughout.  The size comes from the file system, not from
+//    seeking, and is checked before anything is allocated, so a missing or unreadable
+//    file is reported as such instead of turning into a bogus allocation.
+//   -BinaryData memory-maps files at or above a size threshold and reads smaller ones
+//    into memory.
+//   -AsyncBinaryReader reads files on a ThreadPool and calls a completion function with
+//    the result.
+//***************************************************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+class ThreadPool;
+
+enum class BinaryFileResult
+{
+	Ok,
+	NotFound,
+	OpenFailed,
+
+	// Bigger than this process can address, or than memory allows.
+	TooLarge,
+
+	// A read failed or came up short, as when the file shrinks while it's read.
+	ReadFailed
+};
+
+const char* GetBinaryFileResultName(BinaryFileResult result);
+
+// Files this size or larger are mapped rather than read, unless told otherwise.
+const uint64_t BinaryMapThreshold = 4ull * 1024 * 1024;
+
+class BinaryFile
+{
+public:
+	BinaryFile();
+	BinaryFile(const BinaryFile& rhs) = delete;
+	BinaryFile& operator=(const BinaryFile& rhs) = delete;
+	~BinaryFile();
+
+	BinaryFileResult Open(const wchar_t* fileName);
+	void Close();
+
+	uint64_t GetSize()const;
+
+	// Reads the whole file into data, which must hold GetSize() bytes.  Reads in chunks,
+	// so files past 4 GB work where a single read call wouldn't.
+	BinaryFileResult Read(void* data);
+
+private:
+#ifdef _WIN32
+	void* mFile = nullptr;
+#else
+	int mFile = -1;
+#endif
+	uint64_t mSize = 0;
+};
+
+// Reads the whole file into data.
+BinaryFileResult ReadBinaryFile(const wchar_t* fileName, std::vector<uint8_t>& data);
+
+// A file's contents, either read into memory or mapped.
+class BinaryData
+{
+public:
+	BinaryData() = default;
+	BinaryData(const BinaryData& rhs) = delete;
+	BinaryData& operator=(const BinaryData& rhs) = delete;
+
+	// Maps the file if it's at least mapThreshold bytes, otherwise reads it.
+	BinaryFileResult Load(const wchar_t* fileName, uint64_t mapThreshold = BinaryMapThreshold);
+	void Close();
+
+	const uint8_t* GetData()const;
+	uint64_t GetSize()const;
+	bool IsMapped()const;
+
+private:
+	std::vector<uint8_t> mBuffer;
+	MappedFile mMapping;
+};
+
+class AsyncBinaryReader
+{
+public:
+	// Called on a pool thread once the file is loaded, or failed to; data is null unless
+	// result is Ok.
+	typedef std::function<void(BinaryFileResult result, std::shared_ptr<BinaryData> data)> Completion;
+
+	explicit AsyncBinaryReader(ThreadPool& pool, uint64_t mapThreshold = BinaryMapThreshold);
+	AsyncBinaryReader(const AsyncBinaryReader& rhs) = delete;
+	AsyncBinaryReader& operator=(const AsyncBinaryReader& rhs) = delete;
+
+	// Waits for the reads still going.
+	~AsyncBinaryReader();
+
+	// May be called from a completion function.
+	void Read(const std::wstring& fileName, Completion onComplete);
+
+	// Waits until every read has completed, including those started by completion
+	// functions.  Rethrows the first exception a completion function threw.
+	void Wait();
+
+	uint32_t GetPendingCount()const;
+
+private:
+	ThreadPool& mPool;
+	uint64_t mMapThreshold = 0;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mIdle;
+	uint32_t mPending = 0;
+	std::exception_ptr mError;
+};
@@ -0,0 +1,280 @@
+//***************************************************************************************
+// BindingFilter.cpp
+//***************************************************************************************
+
+#include "BindingFilter.h"
+
+#include <cassert>
+
+namespace
+{
+	bool operator==(const VertexBufferBinding& a, const VertexBufferBinding& b)
+	{
+		return a.Location == b.Location && a.Size == b.Size && a.Stride == b.Stride;
+	}
+
+	bool operator==(const IndexBufferBinding& a, const IndexBufferBinding& b)
+	{
+		return a.Location == b.Location && a.Size == b.Size && a.Format == b.Format;
+	}
+}
+
+const char* GetBindingCallName(BindingCall call)
+{
+	switch(call)
+	{
+	case BindingCall::RootSignature: return "RootSignature";
+	case BindingCall::PipelineState: return "PipelineState";
+	case BindingCall::DescriptorHeaps: return "DescriptorHeaps";
+	case BindingCall::RootDescriptorTable: return "RootDescriptorTable";
+	case BindingCall::RootConstantBufferView: return "RootConstantBufferView";
+	case BindingCall::RootShaderResourceView: return "RootShaderResourceView";
+	case BindingCall::RootUnorderedAccessView: return "RootUnorderedAccessView";
+	case BindingCall::RootConstants: return "RootConstants";
+	case BindingCall::VertexBuffers: return "VertexBuffers";
+	case BindingCall::IndexBuffer: return "IndexBuffer";
+	case BindingCall::PrimitiveTopology: return "PrimitiveTopology";
+	default: return "Unknown";
+	}
+}
+
+uint32_t BindingStats::GetIssuedCount()const
+{
+	uint32_t count = 0;
+	for(uint32_t issued : Issued)
+		count += issued;
+	return count;
+}
+
+uint32_t BindingStats::GetElidedCount()const
+{
+	uint32_t count = 0;
+	for(uint32_t elided : Elided)
+		count += elided;
+	return count;
+}
+
+BindingFilter::BindingFilter(BindingBackend& backend)
+	: mBackend(backend)
+{
+}
+
+void BindingFilter::Invalidate()
+{
+	mRootSignatureKnown = false;
+	mPipelineStateKnown = false;
+	mDescriptorHeapsKnown = false;
+	ForgetRootArguments();
+
+	for(bool& known : mVertexBufferKnown)
+		known = false;
+
+	mIndexBufferKnown = false;
+	mTopologyKnown = false;
+}
+
+void BindingFilter::SetRootSignature(const void* rootSignature)
+{
+	bool issue = !mRootSignatureKnown || mRootSignature != rootSignature;
+	Record(BindingCall::RootSignature, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetRootSignature(rootSignature);
+	mRootSignatureKnown = true;
+	mRootSignature = rootSignature;
+	ForgetRootArguments();
+}
+
+void BindingFilter::SetPipelineState(const void* pipelineState)
+{
+	bool issue = !mPipelineStateKnown || mPipelineState != pipelineState;
+	Record(BindingCall::PipelineState, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetPipelineState(pipelineState);
+	mPipelineStateKnown = true;
+	mPipelineState = pipelineState;
+}
+
+void BindingFilter::SetDescriptorHeaps(uint32_t count, const void* const* heaps)
+{
+	assert(count <= 2);
+
+	bool issue = !mDescriptorHeapsKnown || mDescriptorHeapCount != count;
+	for(uint32_t i = 0; i < count && !issue; ++i)
+		issue = mDescriptorHeaps[i] != heaps[i];
+
+	Record(BindingCall::DescriptorHeaps, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetDescriptorHeaps(count, heaps);
+	mDescriptorHeapsKnown = true;
+	mDescriptorHeapCount = count;
+	for(uint32_t i = 0; i < count; ++i)
+		mDescriptorHeaps[i] = heaps[i];
+
+	// The tables point into the heaps that were bound when they were set.
+	for(RootArgument& argument : mRootArguments)
+	{
+		if(argument.Call == BindingCall::RootDescriptorTable)
+			argument.Call = BindingCall::Count;
+	}
+}
+
+void BindingFilter::SetRootDescriptorTable(uint32_t parameter, uint64_t baseDescriptor)
+{
+	assert(parameter < MaxRootParameters);
+
+	RootArgument& argument = mRootArguments[parameter];
+	bool issue = argument.Call != BindingCall::RootDescriptorTable || argument.Value != baseDescriptor;
+	Record(BindingCall::RootDescriptorTable, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetRootDescriptorTable(parameter, baseDescriptor);
+	argument.Call = BindingCall::RootDescriptorTable;
+	argument.Value = baseDescriptor;
+}
+
+void BindingFilter::SetRootView(BindingCall call, uint32_t parameter, uint64_t address)
+{
+	assert(call == BindingCall::RootConstantBufferView || call == BindingCall::RootShaderResourceView ||
+		call == BindingCall::RootUnorderedAccessView);
+	assert(parameter < MaxRootParameters);
+
+	RootArgument& argument = mRootArguments[parameter];
+	bool issue = argument.Call != call || argument.Value != address;
+	Record(call, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetRootView(call, parameter, address);
+	argument.Call = call;
+	argument.Value = address;
+}
+
+void BindingFilter::SetRootConstants(uint32_t parameter, uint32_t count, const uint32_t* values, uint32_t offset)
+{
+	assert(parameter < MaxRootParameters);
+
+	RootArgument& argument = mRootArguments[parameter];
+	if(argument.Call != BindingCall::RootConstants)
+	{
+		argument.Call = BindingCall::RootConstants;
+		argument.Constants.clear();
+		argument.Known.clear();
+	}
+
+	if(argument.Constants.size() < offset + count)
+	{
+		argument.Constants.resize(offset + count, 0);
+		argument.Known.resize(offset + count, false);
+	}
+
+	// Only the span from the first constant that differs to the last is passed on.
+	uint32_t first = count;
+	uint32_t last = 0;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		if(!argument.Known[offset + i] || argument.Constants[offset + i] != values[i])
+		{
+			first = first < i ? first : i;
+			last = i;
+		}
+	}
+
+	bool issue = first < count;
+	Record(BindingCall::RootConstants, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetRootConstants(parameter, last - first + 1, values + first, offset + first);
+	for(uint32_t i = first; i <= last; ++i)
+	{
+		argument.Constants[offset + i] = values[i];
+		argument.Known[offset + i] = true;
+	}
+}
+
+void BindingFilter::SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferBinding* views)
+{
+	assert(startSlot + count <= MaxVertexBuffers);
+
+	uint32_t first = count;
+	uint32_t last = 0;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t slot = startSlot + i;
+		if(!mVertexBufferKnown[slot] || !(mVertexBuffers[slot] == views[i]))
+		{
+			first = first < i ? first : i;
+			last = i;
+		}
+	}
+
+	bool issue = first < count;
+	Record(BindingCall::VertexBuffers, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetVertexBuffers(startSlot + first, last - first + 1, views + first);
+	for(uint32_t i = first; i <= last; ++i)
+	{
+		mVertexBufferKnown[startSlot + i] = true;
+		mVertexBuffers[startSlot + i] = views[i];
+	}
+}
+
+void BindingFilter::SetIndexBuffer(const IndexBufferBinding* view)
+{
+	bool issue = !mIndexBufferKnown || mIndexBufferBound != (view != nullptr) ||
+		(view != nullptr && !(mIndexBuffer == *view));
+	Record(BindingCall::IndexBuffer, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetIndexBuffer(view);
+	mIndexBufferKnown = true;
+	mIndexBufferBound = view != nullptr;
+	if(view != nullptr)
+		mIndexBuffer = *view;
+}
+
+void BindingFilter::SetPrimitiveTopology(uint32_t topology)
+{
+	bool issue = !mTopologyKnown || mTopology != topology;
+	Record(BindingCall::PrimitiveTopology, issue);
+	if(!issue)
+		return;
+
+	mBackend.SetPrimitiveTopology(topology);
+	mTopologyKnown = true;
+	mTopology = topology;
+}
+
+const BindingStats& BindingFilter::GetStats()const
+{
+	return mStats;
+}
+
+void BindingFilter::ResetStats()
+{
+	mStats = BindingStats();
+}
+
+void BindingFilter::ForgetRootArguments()
+{
+	for(RootArgument& argument : mRootArguments)
+		argument.Call = BindingCall::Count;
+}
+
+void BindingFilter::Record(BindingCall call, bool issued)
+{
+	if(issued)
+		mStats.Issued[(int)call]++;
+	else
+		mStats.Elided[(int)call]++;
+}
@@ -0,0 +1,164 @@
+//***************************************************************************************
+// BindingFilter.h
+//
+// Drops binding calls that would set what is already bound.  Draw loops rebind the same
+// vertex buffer, index buffer, topology and root arguments for item after item; the
+// filter remembers the last value set for every root parameter, vertex buffer slot and
+// the rest of the pipeline bindings, and only passes a call on if it changes something.
+//   -Changing the root signature forgets the root arguments, as the command list does.
+//    Setting the one already bound keeps them.
+//   -Changing the descriptor heaps forgets the descriptor tables.
+//   -A call that only partly matches is narrowed: of the vertex buffers or root constants
+//    it sets, only the span from the first to the last that differ is passed on.
+//   -Nothing is known after Invalidate, so the first call of each kind always goes
+//    through.  Call it whenever the list is reset, or something binds behind its back.
+//
+// Issued and elided calls are counted per kind until ResetStats.
+//
+// Like PipelineCache it has no Direct3D dependencies: the calls that get through go to
+// a BindingBackend.  FilteredCommandList is the Direct3D 12 one.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class BindingCall
+{
+	RootSignature,
+	PipelineState,
+	DescriptorHeaps,
+	RootDescriptorTable,
+	RootConstantBufferView,
+	RootShaderResourceView,
+	RootUnorderedAccessView,
+	RootConstants,
+	VertexBuffers,
+	IndexBuffer,
+	PrimitiveTopology,
+
+	Count
+};
+
+const char* GetBindingCallName(BindingCall call);
+
+// Laid out as D3D12_VERTEX_BUFFER_VIEW and D3D12_INDEX_BUFFER_VIEW.
+struct VertexBufferBinding
+{
+	uint64_t Location = 0;
+	uint32_t Size = 0;
+	uint32_t Stride = 0;
+};
+
+struct IndexBufferBinding
+{
+	uint64_t Location = 0;
+	uint32_t Size = 0;
+	uint32_t Format = 0;
+};
+
+class BindingBackend
+{
+public:
+	virtual ~BindingBackend() = default;
+
+	// Root signatures, pipelines and heaps are only compared by address.
+	virtual void SetRootSignature(const void* rootSignature) = 0;
+	virtual void SetPipelineState(const void* pipelineState) = 0;
+	virtual void SetDescriptorHeaps(uint32_t count, const void* const* heaps) = 0;
+
+	virtual void SetRootDescriptorTable(uint32_t parameter, uint64_t baseDescriptor) = 0;
+
+	// call is RootConstantBufferView, RootShaderResourceView or RootUnorderedAccessView.
+	virtual void SetRootView(BindingCall call, uint32_t parameter, uint64_t address) = 0;
+
+	virtual void SetRootConstants(uint32_t parameter, uint32_t count, const uint32_t* values, uint32_t offset) = 0;
+
+	virtual void SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferBinding* views) = 0;
+
+	// view is null to unbind the index buffer.
+	virtual void SetIndexBuffer(const IndexBufferBinding* view) = 0;
+	virtual void SetPrimitiveTopology(uint32_t topology) = 0;
+};
+
+struct BindingStats
+{
+	uint32_t Issued[(int)BindingCall::Count] = {};
+	uint32_t Elided[(int)BindingCall::Count] = {};
+
+	uint32_t GetIssuedCount()const;
+	uint32_t GetElidedCount()const;
+};
+
+class BindingFilter
+{
+public:
+	explicit BindingFilter(BindingBackend& backend);
+	BindingFilter(const BindingFilter& rhs) = delete;
+	BindingFilter& operator=(const BindingFilter& rhs) = delete;
+
+	// Forgets everything bound, so the next call of every kind is passed on.
+	void Invalidate();
+
+	void SetRootSignature(const void* rootSignature);
+	void SetPipelineState(const void* pipelineState);
+	void SetDescriptorHeaps(uint32_t count, const void* const* heaps);
+
+	void SetRootDescriptorTable(uint32_t parameter, uint64_t baseDescriptor);
+	void SetRootView(BindingCall call, uint32_t parameter, uint64_t address);
+	void SetRootConstants(uint32_t parameter, uint32_t count, const uint32_t* values, uint32_t offset);
+
+	void SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferBinding* views);
+	void SetIndexBuffer(const IndexBufferBinding* view);
+	void SetPrimitiveTopology(uint32_t topology);
+
+	const BindingStats& GetStats()const;
+	void ResetStats();
+
+	// The most a command list can have.
+	static const uint32_t MaxRootParameters = 64;
+	static const uint32_t MaxVertexBuffers = 32;
+
+private:
+	struct RootArgument
+	{
+		// Count while nothing is known.
+		BindingCall Call = BindingCall::Count;
+		uint64_t Value = 0;
+
+		// RootConstants only; Known says which of Constants were set.
+		std::vector<uint32_t> Constants;
+		std::vector<bool> Known;
+	};
+
+	void ForgetRootArguments();
+	void Record(BindingCall call, bool issued);
+
+private:
+	BindingBackend& mBackend;
+
+	bool mRootSignatureKnown = false;
+	const void* mRootSignature = nullptr;
+
+	bool mPipelineStateKnown = false;
+	const void* mPipelineState = nullptr;
+
+	bool mDescriptorHeapsKnown = false;
+	uint32_t mDescriptorHeapCount = 0;
+	const void* mDescriptorHeaps[2] = {};
+
+	RootArgument mRootArguments[MaxRootParameters];
+
+	bool mVertexBufferKnown[MaxVertexBuffers] = {};
+	VertexBufferBinding mVertexBuffers[MaxVertexBuffers];
+
+	bool mIndexBufferKnown = false;
+	bool mIndexBufferBound = false;
+	IndexBufferBinding mIndexBuffer;
+
+	bool mTopologyKnown = false;
+	uint32_t mTopology = 0;
+
+	BindingStats mStats;
+};
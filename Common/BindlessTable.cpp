@@ -0,0 +1,20 @@
+//***************************************************************************************
+// BindlessTable.cpp
+//***************************************************************************************
+
+#include "BindlessTable.h"
+
+bool PackDrawIndex(uint32_t objectIndex, uint32_t materialIndex, uint32_t& drawIndex)
+{
+	if(objectIndex >= BindlessMaxObjects || materialIndex >= BindlessMaxMaterials)
+		return false;
+
+	drawIndex = (objectIndex << BindlessMaterialIndexBits) | materialIndex;
+	return true;
+}
+
+void UnpackDrawIndex(uint32_t drawIndex, uint32_t& objectIndex, uint32_t& materialIndex)
+{
+	objectIndex = drawIndex >> BindlessMaterialIndexBits;
+	materialIndex = drawIndex & (BindlessMaxMaterials - 1);
+}
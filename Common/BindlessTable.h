@@ -0,0 +1,25 @@
+//***************************************************************************************
+// BindlessTable.h
+//
+// Index bookkeeping for bindless drawing.  Every texture sits in one shader-visible SRV
+// range that the pixel shader indexes with the material's DiffuseSrvIndex, materials and
+// objects live in structured buffers, and each draw passes a single 32-bit root constant
+// holding both its object and material index.  PackDrawIndex/UnpackDrawIndex build the
+// root constant; color.hlsl and TreeSprite.hlsl unpack it the same way.  The SRV slots
+// come from a DescriptorHeapAllocator.
+//
+// No Win32 or Direct3D dependencies, so it can be tested on its own.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Low bits material, high bits object.  Mirrors the shaders.
+const uint32_t BindlessMaterialIndexBits = 12;
+const uint32_t BindlessMaxMaterials = 1u << BindlessMaterialIndexBits;
+const uint32_t BindlessMaxObjects = 1u << (32 - BindlessMaterialIndexBits);
+
+// Returns false (and leaves drawIndex alone) if either index is out of range.
+bool PackDrawIndex(uint32_t objectIndex, uint32_t materialIndex, uint32_t& drawIndex);
+void UnpackDrawIndex(uint32_t drawIndex, uint32_t& objectIndex, uint32_t& materialIndex);
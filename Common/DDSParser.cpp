@@ -0,0 +1,922 @@
+//--------------------------------------------------------------------------------------
+// File: DDSParser.cpp
+//
+// Split out of DDSTextureLoader.cpp:
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <string.h>
+
+#include "DDSParser.h"
+
+using namespace DirectX;
+
+//--------------------------------------------------------------------------------------
+// Return the BPP for a particular format
+//--------------------------------------------------------------------------------------
+size_t DirectX::BitsPerPixel( DXGI_FORMAT fmt )
+{
+    switch( fmt )
+    {
+    case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    case DXGI_FORMAT_R32G32B32A32_UINT:
+    case DXGI_FORMAT_R32G32B32A32_SINT:
+        return 128;
+
+    case DXGI_FORMAT_R32G32B32_TYPELESS:
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+    case DXGI_FORMAT_R32G32B32_UINT:
+    case DXGI_FORMAT_R32G32B32_SINT:
+        return 96;
+
+    case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R16G16B16A16_UINT:
+    case DXGI_FORMAT_R16G16B16A16_SNORM:
+    case DXGI_FORMAT_R16G16B16A16_SINT:
+    case DXGI_FORMAT_R32G32_TYPELESS:
+    case DXGI_FORMAT_R32G32_FLOAT:
+    case DXGI_FORMAT_R32G32_UINT:
+    case DXGI_FORMAT_R32G32_SINT:
+    case DXGI_FORMAT_R32G8X24_TYPELESS:
+    case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+    case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+    case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+    case DXGI_FORMAT_Y416:
+    case DXGI_FORMAT_Y210:
+    case DXGI_FORMAT_Y216:
+        return 64;
+
+    case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+    case DXGI_FORMAT_R10G10B10A2_UINT:
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+    case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_R8G8B8A8_UINT:
+    case DXGI_FORMAT_R8G8B8A8_SNORM:
+    case DXGI_FORMAT_R8G8B8A8_SINT:
+    case DXGI_FORMAT_R16G16_TYPELESS:
+    case DXGI_FORMAT_R16G16_FLOAT:
+    case DXGI_FORMAT_R16G16_UNORM:
+    case DXGI_FORMAT_R16G16_UINT:
+    case DXGI_FORMAT_R16G16_SNORM:
+    case DXGI_FORMAT_R16G16_SINT:
+    case DXGI_FORMAT_R32_TYPELESS:
+    case DXGI_FORMAT_D32_FLOAT:
+    case DXGI_FORMAT_R32_FLOAT:
+    case DXGI_FORMAT_R32_UINT:
+    case DXGI_FORMAT_R32_SINT:
+    case DXGI_FORMAT_R24G8_TYPELESS:
+    case DXGI_FORMAT_D24_UNORM_S8_UINT:
+    case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+    case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+    case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+    case DXGI_FORMAT_R8G8_B8G8_UNORM:
+    case DXGI_FORMAT_G8R8_G8B8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+    case DXGI_FORMAT_AYUV:
+    case DXGI_FORMAT_Y410:
+    case DXGI_FORMAT_YUY2:
+        return 32;
+
+    case DXGI_FORMAT_P010:
+    case DXGI_FORMAT_P016:
+        return 24;
+
+    case DXGI_FORMAT_R8G8_TYPELESS:
+    case DXGI_FORMAT_R8G8_UNORM:
+    case DXGI_FORMAT_R8G8_UINT:
+    case DXGI_FORMAT_R8G8_SNORM:
+    case DXGI_FORMAT_R8G8_SINT:
+    case DXGI_FORMAT_R16_TYPELESS:
+    case DXGI_FORMAT_R16_FLOAT:
+    case DXGI_FORMAT_D16_UNORM:
+    case DXGI_FORMAT_R16_UNORM:
+    case DXGI_FORMAT_R16_UINT:
+    case DXGI_FORMAT_R16_SNORM:
+    case DXGI_FORMAT_R16_SINT:
+    case DXGI_FORMAT_B5G6R5_UNORM:
+    case DXGI_FORMAT_B5G5R5A1_UNORM:
+    case DXGI_FORMAT_A8P8:
+    case DXGI_FORMAT_B4G4R4A4_UNORM:
+        return 16;
+
+    case DXGI_FORMAT_NV12:
+    case DXGI_FORMAT_420_OPAQUE:
+    case DXGI_FORMAT_NV11:
+        return 12;
+
+    case DXGI_FORMAT_R8_TYPELESS:
+    case DXGI_FORMAT_R8_UNORM:
+    case DXGI_FORMAT_R8_UINT:
+    case DXGI_FORMAT_R8_SNORM:
+    case DXGI_FORMAT_R8_SINT:
+    case DXGI_FORMAT_A8_UNORM:
+    case DXGI_FORMAT_AI44:
+    case DXGI_FORMAT_IA44:
+    case DXGI_FORMAT_P8:
+        return 8;
+
+    case DXGI_FORMAT_R1_UNORM:
+        return 1;
+
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        return 4;
+
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return 8;
+
+    default:
+        return 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+void DirectX::GetSurfaceInfo( size_t width,
+                              size_t height,
+                              DXGI_FORMAT fmt,
+                              size_t* outNumBytes,
+                              size_t* outRowBytes,
+                              size_t* outNumRows )
+{
+    size_t numBytes = 0;
+    size_t rowBytes = 0;
+    size_t numRows = 0;
+
+    bool bc = false;
+    bool packed = false;
+    bool planar = false;
+    size_t bpe = 0;
+    switch (fmt)
+    {
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        bc=true;
+        bpe = 8;
+        break;
+
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        bc = true;
+        bpe = 16;
+        break;
+
+    case DXGI_FORMAT_R8G8_B8G8_UNORM:
+    case DXGI_FORMAT_G8R8_G8B8_UNORM:
+    case DXGI_FORMAT_YUY2:
+        packed = true;
+        bpe = 4;
+        break;
+
+    case DXGI_FORMAT_Y210:
+    case DXGI_FORMAT_Y216:
+        packed = true;
+        bpe = 8;
+        break;
+
+    case DXGI_FORMAT_NV12:
+    case DXGI_FORMAT_420_OPAQUE:
+        planar = true;
+        bpe = 2;
+        break;
+
+    case DXGI_FORMAT_P010:
+    case DXGI_FORMAT_P016:
+        planar = true;
+        bpe = 4;
+        break;
+    }
+
+    if (bc)
+    {
+        size_t numBlocksWide = 0;
+        if (width > 0)
+        {
+            numBlocksWide = std::max<size_t>( 1, (width + 3) / 4 );
+        }
+        size_t numBlocksHigh = 0;
+        if (height > 0)
+        {
+            numBlocksHigh = std::max<size_t>( 1, (height + 3) / 4 );
+        }
+        rowBytes = numBlocksWide * bpe;
+        numRows = numBlocksHigh;
+        numBytes = rowBytes * numBlocksHigh;
+    }
+    else if (packed)
+    {
+        rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+        numRows = height;
+        numBytes = rowBytes * height;
+    }
+    else if ( fmt == DXGI_FORMAT_NV11 )
+    {
+        rowBytes = ( ( width + 3 ) >> 2 ) * 4;
+        numRows = height * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+        numBytes = rowBytes * numRows;
+    }
+    else if (planar)
+    {
+        rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+        numBytes = ( rowBytes * height ) + ( ( rowBytes * height + 1 ) >> 1 );
+        numRows = height + ( ( height + 1 ) >> 1 );
+    }
+    else
+    {
+        size_t bpp = BitsPerPixel( fmt );
+        rowBytes = ( width * bpp + 7 ) / 8; // round up to nearest byte
+        numRows = height;
+        numBytes = rowBytes * height;
+    }
+
+    if (outNumBytes)
+    {
+        *outNumBytes = numBytes;
+    }
+    if (outRowBytes)
+    {
+        *outRowBytes = rowBytes;
+    }
+    if (outNumRows)
+    {
+        *outNumRows = numRows;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
+
+DXGI_FORMAT DirectX::GetDXGIFormat( const DDS_PIXELFORMAT& ddpf )
+{
+    if (ddpf.flags & DDS_RGB)
+    {
+        // Note that sRGB formats are written using the "DX10" extended header
+
+        switch (ddpf.RGBBitCount)
+        {
+        case 32:
+            if (ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0xff000000))
+            {
+                return DXGI_FORMAT_R8G8B8A8_UNORM;
+            }
+
+            if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0xff000000))
+            {
+                return DXGI_FORMAT_B8G8R8A8_UNORM;
+            }
+
+            if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0x00000000))
+            {
+                return DXGI_FORMAT_B8G8R8X8_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
+
+            // Note that many common DDS reader/writers (including D3DX) swap the
+            // the RED/BLUE masks for 10:10:10:2 formats. We assume
+            // below that the 'backwards' header mask is being used since it is most
+            // likely written by D3DX. The more robust solution is to use the 'DX10'
+            // header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
+
+            // For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
+            if (ISBITMASK(0x3ff00000,0x000ffc00,0x000003ff,0xc0000000))
+            {
+                return DXGI_FORMAT_R10G10B10A2_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
+
+            if (ISBITMASK(0x0000ffff,0xffff0000,0x00000000,0x00000000))
+            {
+                return DXGI_FORMAT_R16G16_UNORM;
+            }
+
+            if (ISBITMASK(0xffffffff,0x00000000,0x00000000,0x00000000))
+            {
+                // Only 32-bit color channel format in D3D9 was R32F
+                return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+            }
+            break;
+
+        case 24:
+            // No 24bpp DXGI formats aka D3DFMT_R8G8B8
+            break;
+
+        case 16:
+            if (ISBITMASK(0x7c00,0x03e0,0x001f,0x8000))
+            {
+                return DXGI_FORMAT_B5G5R5A1_UNORM;
+            }
+            if (ISBITMASK(0xf800,0x07e0,0x001f,0x0000))
+            {
+                return DXGI_FORMAT_B5G6R5_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
+
+            if (ISBITMASK(0x0f00,0x00f0,0x000f,0xf000))
+            {
+                return DXGI_FORMAT_B4G4R4A4_UNORM;
+            }
+
+            // No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
+
+            // No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+            break;
+        }
+    }
+    else if (ddpf.flags & DDS_LUMINANCE)
+    {
+        if (8 == ddpf.RGBBitCount)
+        {
+            if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x00000000))
+            {
+                return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
+            }
+
+            // No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+        }
+
+        if (16 == ddpf.RGBBitCount)
+        {
+            if (ISBITMASK(0x0000ffff,0x00000000,0x00000000,0x00000000))
+            {
+                return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
+            }
+            if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x0000ff00))
+            {
+                return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
+            }
+        }
+    }
+    else if (ddpf.flags & DDS_ALPHA)
+    {
+        if (8 == ddpf.RGBBitCount)
+        {
+            return DXGI_FORMAT_A8_UNORM;
+        }
+    }
+    else if (ddpf.flags & DDS_FOURCC)
+    {
+        if (MAKEFOURCC( 'D', 'X', 'T', '1' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC1_UNORM;
+        }
+        if (MAKEFOURCC( 'D', 'X', 'T', '3' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC2_UNORM;
+        }
+        if (MAKEFOURCC( 'D', 'X', 'T', '5' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC3_UNORM;
+        }
+
+        // While pre-multiplied alpha isn't directly supported by the DXGI formats,
+        // they are basically the same as these BC formats so they can be mapped
+        if (MAKEFOURCC( 'D', 'X', 'T', '2' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC2_UNORM;
+        }
+        if (MAKEFOURCC( 'D', 'X', 'T', '4' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC3_UNORM;
+        }
+
+        if (MAKEFOURCC( 'A', 'T', 'I', '1' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC4_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '4', 'U' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC4_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '4', 'S' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC4_SNORM;
+        }
+
+        if (MAKEFOURCC( 'A', 'T', 'I', '2' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC5_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '5', 'U' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC5_UNORM;
+        }
+        if (MAKEFOURCC( 'B', 'C', '5', 'S' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_BC5_SNORM;
+        }
+
+        // BC6H and BC7 are written using the "DX10" extended header
+
+        if (MAKEFOURCC( 'R', 'G', 'B', 'G' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_R8G8_B8G8_UNORM;
+        }
+        if (MAKEFOURCC( 'G', 'R', 'G', 'B' ) == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_G8R8_G8B8_UNORM;
+        }
+
+        if (MAKEFOURCC('Y','U','Y','2') == ddpf.fourCC)
+        {
+            return DXGI_FORMAT_YUY2;
+        }
+
+        // Check for D3DFORMAT enums being set here
+        switch( ddpf.fourCC )
+        {
+        case 36: // D3DFMT_A16B16G16R16
+            return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+        case 110: // D3DFMT_Q16W16V16U16
+            return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+        case 111: // D3DFMT_R16F
+            return DXGI_FORMAT_R16_FLOAT;
+
+        case 112: // D3DFMT_G16R16F
+            return DXGI_FORMAT_R16G16_FLOAT;
+
+        case 113: // D3DFMT_A16B16G16R16F
+            return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+        case 114: // D3DFMT_R32F
+            return DXGI_FORMAT_R32_FLOAT;
+
+        case 115: // D3DFMT_G32R32F
+            return DXGI_FORMAT_R32G32_FLOAT;
+
+        case 116: // D3DFMT_A32B32G32R32F
+            return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        }
+    }
+
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+
+//--------------------------------------------------------------------------------------
+DDS_ALPHA_MODE DirectX::GetAlphaMode( const DDS_HEADER* header )
+{
+    if ( header->ddspf.flags & DDS_FOURCC )
+    {
+        if ( MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC )
+        {
+            auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>( (const char*)header + sizeof(DDS_HEADER) );
+            auto mode = static_cast<DDS_ALPHA_MODE>( d3d10ext->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK );
+            switch( mode )
+            {
+            case DDS_ALPHA_MODE_STRAIGHT:
+            case DDS_ALPHA_MODE_PREMULTIPLIED:
+            case DDS_ALPHA_MODE_OPAQUE:
+            case DDS_ALPHA_MODE_CUSTOM:
+                return mode;
+            }
+        }
+        else if ( ( MAKEFOURCC( 'D', 'X', 'T', '2' ) == header->ddspf.fourCC )
+                  || ( MAKEFOURCC( 'D', 'X', 'T', '4' ) == header->ddspf.fourCC ) )
+        {
+            return DDS_ALPHA_MODE_PREMULTIPLIED;
+        }
+    }
+
+    return DDS_ALPHA_MODE_UNKNOWN;
+}
+
+
+//--------------------------------------------------------------------------------------
+DDS_RESULT DirectX::ParseDDSTexture( const uint8_t* ddsData,
+                                     size_t ddsDataSize,
+                                     DDSTextureDesc& desc )
+{
+    memset( &desc, 0, sizeof(desc) );
+
+    if (!ddsData)
+    {
+        return DDS_RESULT_INVALID_ARG;
+    }
+
+    // Need at least enough data to fill the header and magic number to be a valid DDS
+    if (ddsDataSize < ( sizeof(uint32_t) + sizeof(DDS_HEADER) ) )
+    {
+        return DDS_RESULT_TOO_SMALL;
+    }
+
+    // DDS files always start with the same magic number ("DDS ")
+    uint32_t dwMagicNumber = 0;
+    memcpy( &dwMagicNumber, ddsData, sizeof(uint32_t) );
+    if (dwMagicNumber != DDS_MAGIC)
+    {
+        return DDS_RESULT_BAD_MAGIC;
+    }
+
+    auto header = reinterpret_cast<const DDS_HEADER*>( ddsData + sizeof(uint32_t) );
+
+    // Verify header to validate DDS file
+    if (header->size != sizeof(DDS_HEADER) ||
+        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return DDS_RESULT_BAD_HEADER;
+    }
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+
+    // Check for DX10 extension
+    const DDS_HEADER_DXT10* d3d10ext = nullptr;
+    if ((header->ddspf.flags & DDS_FOURCC) &&
+        (MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC))
+    {
+        // Must be long enough for both headers and magic value
+        if (ddsDataSize < offset + sizeof(DDS_HEADER_DXT10))
+        {
+            return DDS_RESULT_TOO_SMALL;
+        }
+
+        d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>( ddsData + offset );
+        offset += sizeof(DDS_HEADER_DXT10);
+    }
+
+    uint32_t width = header->width;
+    uint32_t height = header->height;
+    uint32_t depth = header->depth;
+
+    DDS_DIMENSION resDim = DDS_DIMENSION_UNKNOWN;
+    uint32_t arraySize = 1;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    bool isCubeMap = false;
+
+    uint32_t mipCount = header->mipMapCount;
+    if (0 == mipCount)
+    {
+        mipCount = 1;
+    }
+
+    if (d3d10ext)
+    {
+        arraySize = d3d10ext->arraySize;
+        if (arraySize == 0)
+        {
+            return DDS_RESULT_INVALID_DATA;
+        }
+
+        switch (d3d10ext->dxgiFormat)
+        {
+        case DXGI_FORMAT_AI44:
+        case DXGI_FORMAT_IA44:
+        case DXGI_FORMAT_P8:
+        case DXGI_FORMAT_A8P8:
+            return DDS_RESULT_NOT_SUPPORTED;
+
+        default:
+            if (BitsPerPixel( d3d10ext->dxgiFormat ) == 0)
+            {
+                return DDS_RESULT_NOT_SUPPORTED;
+            }
+        }
+
+        format = d3d10ext->dxgiFormat;
+
+        switch (d3d10ext->resourceDimension)
+        {
+        case DDS_DIMENSION_TEXTURE1D:
+            // D3DX writes 1D textures with a fixed Height of 1
+            if ((header->flags & DDS_HEIGHT) && height != 1)
+            {
+                return DDS_RESULT_INVALID_DATA;
+            }
+            height = depth = 1;
+            break;
+
+        case DDS_DIMENSION_TEXTURE2D:
+            if (d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+            {
+                // Guard the multiply below; anything this large fails the bounds check anyway.
+                if (arraySize > DDS_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+                {
+                    return DDS_RESULT_NOT_SUPPORTED;
+                }
+                arraySize *= 6;
+                isCubeMap = true;
+            }
+            depth = 1;
+            break;
+
+        case DDS_DIMENSION_TEXTURE3D:
+            if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
+            {
+                return DDS_RESULT_INVALID_DATA;
+            }
+
+            if (arraySize > 1)
+            {
+                return DDS_RESULT_NOT_SUPPORTED;
+            }
+            break;
+
+        default:
+            return DDS_RESULT_NOT_SUPPORTED;
+        }
+
+        resDim = static_cast<DDS_DIMENSION>( d3d10ext->resourceDimension );
+    }
+    else
+    {
+        format = GetDXGIFormat( header->ddspf );
+
+        if (format == DXGI_FORMAT_UNKNOWN)
+        {
+            return DDS_RESULT_NOT_SUPPORTED;
+        }
+
+        if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+        {
+            resDim = DDS_DIMENSION_TEXTURE3D;
+        }
+        else
+        {
+            if (header->caps2 & DDS_CUBEMAP)
+            {
+                // We require all six faces to be defined
+                if ((header->caps2 & DDS_CUBEMAP_ALLFACES ) != DDS_CUBEMAP_ALLFACES)
+                {
+                    return DDS_RESULT_NOT_SUPPORTED;
+                }
+
+                arraySize = 6;
+                isCubeMap = true;
+            }
+
+            depth = 1;
+            resDim = DDS_DIMENSION_TEXTURE2D;
+
+            // Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
+        }
+    }
+
+    // Zero-sized surfaces only come from damaged files.
+    if (width == 0 || height == 0 || depth == 0)
+    {
+        return DDS_RESULT_INVALID_DATA;
+    }
+
+    // Bound sizes (for security purposes we don't trust DDS file metadata larger than the D3D 11.x hardware requirements)
+    if (mipCount > DDS_REQ_MIP_LEVELS)
+    {
+        return DDS_RESULT_NOT_SUPPORTED;
+    }
+
+    switch (resDim)
+    {
+    case DDS_DIMENSION_TEXTURE1D:
+        if ((arraySize > DDS_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION) ||
+            (width > DDS_REQ_TEXTURE1D_U_DIMENSION))
+        {
+            return DDS_RESULT_NOT_SUPPORTED;
+        }
+        break;
+
+    case DDS_DIMENSION_TEXTURE2D:
+        if (isCubeMap)
+        {
+            // This is the right bound because we set arraySize to (NumCubes*6) above
+            if ((arraySize > DDS_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
+                (width > DDS_REQ_TEXTURECUBE_DIMENSION) ||
+                (height > DDS_REQ_TEXTURECUBE_DIMENSION))
+            {
+                return DDS_RESULT_NOT_SUPPORTED;
+            }
+        }
+        else if ((arraySize > DDS_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
+                 (width > DDS_REQ_TEXTURE2D_U_OR_V_DIMENSION) ||
+                 (height > DDS_REQ_TEXTURE2D_U_OR_V_DIMENSION))
+        {
+            return DDS_RESULT_NOT_SUPPORTED;
+        }
+        break;
+
+    case DDS_DIMENSION_TEXTURE3D:
+        if ((arraySize > 1) ||
+            (width > DDS_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
+            (height > DDS_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
+            (depth > DDS_REQ_TEXTURE3D_U_V_OR_W_DIMENSION))
+        {
+            return DDS_RESULT_NOT_SUPPORTED;
+        }
+        break;
+
+    default:
+        return DDS_RESULT_NOT_SUPPORTED;
+    }
+
+    desc.dimension = resDim;
+    desc.width = width;
+    desc.height = height;
+    desc.depth = depth;
+    desc.mipCount = mipCount;
+    desc.arraySize = arraySize;
+    desc.format = format;
+    desc.isCubeMap = isCubeMap;
+    desc.alphaMode = GetAlphaMode( header );
+    desc.dataOffset = offset;
+    desc.dataSize = ddsDataSize - offset;
+
+    return DDS_RESULT_OK;
+}
+
+//--------------------------------------------------------------------------------------
+DDS_RESULT DirectX::GetDDSSubresourceLayout( const DDSTextureDesc& desc,
+                                             size_t maxsize,
+                                             DDSSubresourceLayout* layouts,
+                                             size_t layoutCapacity,
+                                             DDSLayoutInfo& info )
+{
+    memset( &info, 0, sizeof(info) );
+
+    if (!layouts)
+    {
+        return DDS_RESULT_INVALID_ARG;
+    }
+
+    const size_t mipCount = desc.mipCount;
+    const size_t arraySize = desc.arraySize;
+    if (layoutCapacity < mipCount * arraySize)
+    {
+        return DDS_RESULT_BUFFER_TOO_SMALL;
+    }
+
+    // 64-bit so a large volume can't wrap the running offset on 32-bit builds.
+    uint64_t offset = desc.dataOffset;
+    const uint64_t end = (uint64_t)desc.dataOffset + desc.dataSize;
+
+    size_t index = 0;
+    for (size_t j = 0; j < arraySize; j++)
+    {
+        size_t w = desc.width;
+        size_t h = desc.height;
+        size_t d = desc.depth;
+        for (size_t i = 0; i < mipCount; i++)
+        {
+            size_t NumBytes = 0;
+            size_t RowBytes = 0;
+            GetSurfaceInfo( w, h, desc.format, &NumBytes, &RowBytes, nullptr );
+
+            if ((mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize))
+            {
+                if (!info.width)
+                {
+                    info.width = w;
+                    info.height = h;
+                    info.depth = d;
+                }
+
+                layouts[index].offset = static_cast<size_t>( offset );
+                layouts[index].rowPitch = RowBytes;
+                layouts[index].slicePitch = NumBytes;
+                ++index;
+            }
+            else if (!j)
+            {
+                // Count number of skipped mipmaps (first item only)
+                ++info.skipMip;
+            }
+
+            uint64_t surfaceBytes = (uint64_t)NumBytes * d;
+            if (surfaceBytes > end - offset)
+            {
+                return DDS_RESULT_TRUNCATED;
+            }
+
+            offset += surfaceBytes;
+
+            w = std::max<size_t>( w >> 1, 1 );
+            h = std::max<size_t>( h >> 1, 1 );
+            d = std::max<size_t>( d >> 1, 1 );
+        }
+    }
+
+    if (index == 0)
+    {
+        return DDS_RESULT_INVALID_DATA;
+    }
+
+    info.mipCount = mipCount - info.skipMip;
+    info.subresourceCount = index;
+
+    return DDS_RESULT_OK;
+}
+
+//--------------------------------------------------------------------------------------
+void DirectX::WriteDDSHeaders( const DDSTextureDesc& desc, uint8_t* dst )
+{
+    // DDS_HEADER flags and caps that the parser doesn't need.
+    const uint32_t DDSD_CAPS_HEIGHT_WIDTH_PIXELFORMAT = 0x00001007;
+    const uint32_t DDSD_MIPMAPCOUNT = 0x00020000;
+    const uint32_t DDSD_LINEARSIZE  = 0x00080000;
+    const uint32_t DDSCAPS_COMPLEX  = 0x00000008;
+    const uint32_t DDSCAPS_TEXTURE  = 0x00001000;
+    const uint32_t DDSCAPS_MIPMAP   = 0x00400000;
+    const uint32_t DDSCAPS2_VOLUME  = 0x00200000;
+
+    size_t NumBytes = 0;
+    GetSurfaceInfo( desc.width, desc.height, desc.format, &NumBytes, nullptr, nullptr );
+
+    DDS_HEADER header;
+    memset( &header, 0, sizeof(header) );
+    header.size = sizeof(DDS_HEADER);
+    header.flags = DDSD_CAPS_HEIGHT_WIDTH_PIXELFORMAT | DDSD_LINEARSIZE;
+    header.height = desc.height;
+    header.width = desc.width;
+    header.pitchOrLinearSize = static_cast<uint32_t>( NumBytes );
+    header.mipMapCount = desc.mipCount;
+    header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+    header.ddspf.flags = DDS_FOURCC;
+    header.ddspf.fourCC = MAKEFOURCC( 'D', 'X', '1', '0' );
+    header.caps = DDSCAPS_TEXTURE;
+
+    if (desc.mipCount > 1)
+    {
+        header.flags |= DDSD_MIPMAPCOUNT;
+        header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+
+    if (desc.isCubeMap)
+    {
+        header.caps |= DDSCAPS_COMPLEX;
+        header.caps2 = DDS_CUBEMAP_ALLFACES;
+    }
+    else if (desc.dimension == DDS_DIMENSION_TEXTURE3D)
+    {
+        header.flags |= DDS_HEADER_FLAGS_VOLUME;
+        header.caps |= DDSCAPS_COMPLEX;
+        header.caps2 = DDSCAPS2_VOLUME;
+        header.depth = desc.depth;
+    }
+
+    DDS_HEADER_DXT10 d3d10ext;
+    memset( &d3d10ext, 0, sizeof(d3d10ext) );
+    d3d10ext.dxgiFormat = desc.format;
+    d3d10ext.resourceDimension = desc.dimension;
+    d3d10ext.miscFlag = desc.isCubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+    d3d10ext.arraySize = desc.isCubeMap ? desc.arraySize / 6 : desc.arraySize;
+    d3d10ext.miscFlags2 = desc.alphaMode;
+
+    memcpy( dst, &DDS_MAGIC, sizeof(uint32_t) );
+    memcpy( dst + sizeof(uint32_t), &header, sizeof(DDS_HEADER) );
+    memcpy( dst + sizeof(uint32_t) + sizeof(DDS_HEADER), &d3d10ext, sizeof(DDS_HEADER_DXT10) );
+}
@@ -0,0 +1,224 @@
+//--------------------------------------------------------------------------------------
+// File: DDSParser.h
+//
+// Platform-independent part of the DDS loader: header validation, DXGI format mapping
+// and the subresource layout of the file.  It works on a byte span, never allocates
+// and has no Win32 or Direct3D dependencies, so it also builds on Linux for headless
+// asset tools.  DDSTextureLoader uses it to create the Direct3D resources.
+//
+// Split out of DDSTextureLoader.cpp:
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "DXGIFormat.h"
+
+//--------------------------------------------------------------------------------------
+// Macros
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+    #define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+namespace DirectX
+{
+    enum DDS_ALPHA_MODE
+    {
+        DDS_ALPHA_MODE_UNKNOWN       = 0,
+        DDS_ALPHA_MODE_STRAIGHT      = 1,
+        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+        DDS_ALPHA_MODE_OPAQUE        = 3,
+        DDS_ALPHA_MODE_CUSTOM        = 4,
+    };
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#pragma pack(push,1)
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+    uint32_t    size;
+    uint32_t    flags;
+    uint32_t    fourCC;
+    uint32_t    RGBBitCount;
+    uint32_t    RBitMask;
+    uint32_t    GBitMask;
+    uint32_t    BBitMask;
+    uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+                               DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+                               DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+enum DDS_MISC_FLAGS2
+{
+    DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
+};
+
+struct DDS_HEADER
+{
+    uint32_t        size;
+    uint32_t        flags;
+    uint32_t        height;
+    uint32_t        width;
+    uint32_t        pitchOrLinearSize;
+    uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+    uint32_t        mipMapCount;
+    uint32_t        reserved1[11];
+    DDS_PIXELFORMAT ddspf;
+    uint32_t        caps;
+    uint32_t        caps2;
+    uint32_t        caps3;
+    uint32_t        caps4;
+    uint32_t        reserved2;
+};
+
+struct DDS_HEADER_DXT10
+{
+    DXGI_FORMAT     dxgiFormat;
+    uint32_t        resourceDimension;
+    uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+    uint32_t        arraySize;
+    uint32_t        miscFlags2;
+};
+
+#pragma pack(pop)
+
+    // Same values as D3D11_RESOURCE_DIMENSION and D3D12_RESOURCE_DIMENSION.
+    enum DDS_DIMENSION
+    {
+        DDS_DIMENSION_UNKNOWN   = 0,
+        DDS_DIMENSION_TEXTURE1D = 2,
+        DDS_DIMENSION_TEXTURE2D = 3,
+        DDS_DIMENSION_TEXTURE3D = 4,
+    };
+
+    #define DDS_RESOURCE_MISC_TEXTURECUBE 0x4 // D3D11_RESOURCE_MISC_TEXTURECUBE
+
+    // Direct3D 11/12 hardware limits.  Metadata beyond these is rejected.
+    const uint32_t DDS_REQ_MIP_LEVELS                    = 15;
+    const uint32_t DDS_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION = 2048;
+    const uint32_t DDS_REQ_TEXTURE1D_U_DIMENSION         = 16384;
+    const uint32_t DDS_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION = 2048;
+    const uint32_t DDS_REQ_TEXTURE2D_U_OR_V_DIMENSION    = 16384;
+    const uint32_t DDS_REQ_TEXTURECUBE_DIMENSION         = 16384;
+    const uint32_t DDS_REQ_TEXTURE3D_U_V_OR_W_DIMENSION  = 2048;
+
+    enum DDS_RESULT
+    {
+        DDS_RESULT_OK = 0,
+        DDS_RESULT_INVALID_ARG,       // null data
+        DDS_RESULT_TOO_SMALL,         // shorter than the headers
+        DDS_RESULT_BAD_MAGIC,         // not a DDS file
+        DDS_RESULT_BAD_HEADER,        // header or pixel format size is wrong
+        DDS_RESULT_INVALID_DATA,      // inconsistent header fields
+        DDS_RESULT_NOT_SUPPORTED,     // valid DDS, but not something Direct3D can load
+        DDS_RESULT_TRUNCATED,         // the surfaces run past the end of the data
+        DDS_RESULT_BUFFER_TOO_SMALL,  // the layout array can't hold every subresource
+    };
+
+    // What the headers describe.  DataOffset/DataSize locate the surfaces in the span.
+    struct DDSTextureDesc
+    {
+        DDS_DIMENSION   dimension;
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        depth;
+        uint32_t        mipCount;
+        uint32_t        arraySize;    // cube maps count six faces per cube
+        DXGI_FORMAT     format;
+        bool            isCubeMap;
+        DDS_ALPHA_MODE  alphaMode;
+        size_t          dataOffset;
+        size_t          dataSize;
+    };
+
+    // One subresource; offset is from the start of the span passed to ParseDDSTexture.
+    struct DDSSubresourceLayout
+    {
+        size_t          offset;
+        size_t          rowPitch;
+        size_t          slicePitch;
+    };
+
+    // The texture that results once mips larger than maxsize are skipped.
+    struct DDSLayoutInfo
+    {
+        size_t          width;
+        size_t          height;
+        size_t          depth;
+        size_t          mipCount;
+        size_t          skipMip;
+        size_t          subresourceCount;
+    };
+
+    // Validates the headers and fills in desc.
+    DDS_RESULT ParseDDSTexture( const uint8_t* ddsData,
+                                size_t ddsDataSize,
+                                DDSTextureDesc& desc );
+
+    // Fills in one layout per subresource, array slice major, skipping the mips that are
+    // larger than maxsize (0 = no limit).  layouts must hold desc.mipCount * desc.arraySize
+    // entries.
+    DDS_RESULT GetDDSSubresourceLayout( const DDSTextureDesc& desc,
+                                        size_t maxsize,
+                                        DDSSubresourceLayout* layouts,
+                                        size_t layoutCapacity,
+                                        DDSLayoutInfo& info );
+
+    // Magic number, DDS_HEADER and DDS_HEADER_DXT10, as WriteDDSHeaders emits them.
+    const size_t DDS_DX10_HEADERS_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+    // The inverse of ParseDDSTexture for asset tools: writes the magic number and a DX10
+    // header describing desc (dataOffset and dataSize are ignored).  dst must hold
+    // DDS_DX10_HEADERS_SIZE bytes; the surfaces follow, laid out as GetDDSSubresourceLayout
+    // expects.
+    void WriteDDSHeaders( const DDSTextureDesc& desc, uint8_t* dst );
+
+    size_t BitsPerPixel( DXGI_FORMAT fmt );
+
+    void GetSurfaceInfo( size_t width,
+                         size_t height,
+                         DXGI_FORMAT fmt,
+                         size_t* outNumBytes,
+                         size_t* outRowBytes,
+                         size_t* outNumRows );
+
+    DXGI_FORMAT GetDXGIFormat( const DDS_PIXELFORMAT& ddpf );
+
+    DDS_ALPHA_MODE GetAlphaMode( const DDS_HEADER* header );
+}
@@ -24,7 +24,11 @@
 
 #include <wrl.h>
 #include <d3d11_1.h>
+#include <memory>
+#include <vector>
 #include "d3dx12.h"
+#include "MappedFile.h"
+#include "DDSParser.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4005)
@@ -46,15 +50,6 @@
 
 namespace DirectX
 {
-    enum DDS_ALPHA_MODE
-    {
-        DDS_ALPHA_MODE_UNKNOWN       = 0,
-        DDS_ALPHA_MODE_STRAIGHT      = 1,
-        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
-        DDS_ALPHA_MODE_OPAQUE        = 3,
-        DDS_ALPHA_MODE_CUSTOM        = 4,
-    };
-
     // Standard version
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
@@ -92,6 +87,71 @@ namespace DirectX
 		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                               );
 
+	// CreateDDSTextureFromFile12 split in two so textures can be loaded in parallel.
+	// LoadDDSTextureDataFromFile12 reads and validates the file and lays out the
+	// subresources; it does not touch the device and is safe to call from any thread.
+	// MapDDSTextureDataFromFile12 does the same on a memory mapping of the file, so the
+	// subresources point straight at the mapped pages and files over 4GB are accepted.
+	// LoadDDSTextureDataFromMemory12 takes a copy of a DDS file image that is already in
+	// memory, such as one the texture compressor produced.
+	// LoadDDSTextureDataFromBuffer12 takes ownership of a buffer holding the file image
+	// instead of copying it, such as one decompressed from an asset archive.
+	// CreateDDSTextureFromData12 creates the resources and records the upload, so it must
+	// be called from the thread that owns cmdList.  The file data (and mapping) can be
+	// released as soon as it returns.  Given readBarriers, it appends the texture's
+	// transition to PIXEL_SHADER_RESOURCE there instead of recording it, so the caller
+	// can record every texture's in one ResourceBarrier call.
+	struct DDSTextureData12
+	{
+		// Exactly one of these holds the file contents.
+		std::unique_ptr<uint8_t[]> ddsData;
+		std::unique_ptr<MappedFile> mappedFile;
+		size_t ddsDataSize = 0;
+
+		uint32_t resDim = 0;
+		size_t width = 0;
+		size_t height = 0;
+		size_t depth = 0;
+		size_t mipCount = 0;
+		size_t arraySize = 0;
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		bool isCubeMap = false;
+		DDS_ALPHA_MODE alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+
+		// Points into ddsData or mappedFile.
+		std::vector<D3D12_SUBRESOURCE_DATA> initData;
+	};
+
+	HRESULT LoadDDSTextureDataFromFile12(_In_z_ const wchar_t* szFileName,
+		                                 _Out_ DDSTextureData12& data,
+		                                 _In_ size_t maxsize = 0
+		                                 );
+
+	HRESULT MapDDSTextureDataFromFile12(_In_z_ const wchar_t* szFileName,
+		                                _Out_ DDSTextureData12& data,
+		                                _In_ size_t maxsize = 0
+		                                );
+
+	HRESULT LoadDDSTextureDataFromMemory12(_In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+		                                   _In_ size_t ddsDataSize,
+		                                   _Out_ DDSTextureData12& data,
+		                                   _In_ size_t maxsize = 0
+		                                   );
+
+	HRESULT LoadDDSTextureDataFromBuffer12(_In_ std::unique_ptr<uint8_t[]> ddsData,
+		                                   _In_ size_t ddsDataSize,
+		                                   _Out_ DDSTextureData12& data,
+		                                   _In_ size_t maxsize = 0
+		                                   );
+
+	HRESULT CreateDDSTextureFromData12(_In_ ID3D12Device* device,
+		                               _In_ ID3D12GraphicsCommandList* cmdList,
+		                               _In_ const DDSTextureData12& data,
+		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap,
+		                               _Inout_opt_ std::vector<D3D12_RESOURCE_BARRIER>* readBarriers = nullptr
+		                               );
+
     // Standard version with optional auto-gen mipmap support
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -0,0 +1,180 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount)
+	: mPersistentCount(persistentCount),
+	  mTransientCount(transientCount),
+	  mAllocationSizes(persistentCount, 0)
+{
+	if(persistentCount > 0)
+		mFreeRanges.push_back({ 0, persistentCount });
+}
+
+uint32_t DescriptorAllocator::Allocate(uint32_t count)
+{
+	assert(count > 0);
+
+	for(size_t i = 0; i < mFreeRanges.size(); ++i)
+	{
+		Range& r = mFreeRanges[i];
+		if(r.Count < count)
+			continue;
+
+		uint32_t index = r.Index;
+		r.Index += count;
+		r.Count -= count;
+		if(r.Count == 0)
+			mFreeRanges.erase(mFreeRanges.begin() + i);
+
+		mAllocationSizes[index] = count;
+		mAllocated += count;
+		return index;
+	}
+
+	mFailedCount++;
+	return InvalidIndex;
+}
+
+bool DescriptorAllocator::Free(uint32_t index)
+{
+	if(index >= mPersistentCount || mAllocationSizes[index] == 0)
+		return false;
+
+	uint32_t count = mAllocationSizes[index];
+	mAllocationSizes[index] = 0;
+	mAllocated -= count;
+
+	mPendingFrees.push_back({ { index, count }, false, 0 });
+	return true;
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count)
+{
+	assert(count > 0);
+
+	uint64_t position = mTransientHead;
+	uint32_t slot = mTransientCount > 0 ? (uint32_t)(position % mTransientCount) : 0;
+
+	// A run that would wrap starts over at the beginning of the ring instead.
+	if(slot + (uint64_t)count > mTransientCount)
+	{
+		position += mTransientCount - slot;
+		slot = 0;
+	}
+
+	if(position + count - mTransientTail > mTransientCount)
+	{
+		mFailedCount++;
+		return InvalidIndex;
+	}
+
+	mTransientHead = position + count;
+	mTransientPeak = std::max(mTransientPeak, (uint32_t)(mTransientHead - mTransientTail));
+	return mPersistentCount + slot;
+}
+
+void DescriptorAllocator::EndFrame(uint64_t fenceValue)
+{
+	for(PendingFree& p : mPendingFrees)
+	{
+		if(!p.Stamped)
+		{
+			p.Stamped = true;
+			p.FenceValue = fenceValue;
+		}
+	}
+
+	mTransientFrames.push_back({ fenceValue, mTransientHead });
+}
+
+void DescriptorAllocator::Recycle(uint64_t completedValue)
+{
+	// Both queues are in submission order.
+	while(!mPendingFrees.empty() && mPendingFrees.front().Stamped && mPendingFrees.front().FenceValue <= completedValue)
+	{
+		Release(mPendingFrees.front().Slots);
+		mPendingFrees.pop_front();
+	}
+
+	while(!mTransientFrames.empty() && mTransientFrames.front().FenceValue <= completedValue)
+	{
+		mTransientTail = mTransientFrames.front().End;
+		mTransientFrames.pop_front();
+	}
+}
+
+uint32_t DescriptorAllocator::GetPersistentCount()const
+{
+	return mPersistentCount;
+}
+
+uint32_t DescriptorAllocator::GetTransientCount()const
+{
+	return mTransientCount;
+}
+
+uint32_t DescriptorAllocator::GetDescriptorCount()const
+{
+	return mPersistentCount + mTransientCount;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::GetStats()const
+{
+	DescriptorAllocatorStats stats;
+	stats.PersistentCapacity = mPersistentCount;
+	stats.PersistentAllocated = mAllocated;
+
+	for(const PendingFree& p : mPendingFrees)
+		stats.PersistentPendingFree += p.Slots.Count;
+
+	stats.FreeRangeCount = (uint32_t)mFreeRanges.size();
+	for(const Range& r : mFreeRanges)
+	{
+		stats.FreeCount += r.Count;
+		stats.LargestFreeRange = std::max(stats.LargestFreeRange, r.Count);
+	}
+	if(stats.FreeCount > 0)
+		stats.Fragmentation = 1.0f - (float)stats.LargestFreeRange / (float)stats.FreeCount;
+
+	stats.TransientCapacity = mTransientCount;
+	stats.TransientUsed = (uint32_t)(mTransientHead - mTransientTail);
+	stats.TransientPeak = mTransientPeak;
+	stats.FailedCount = mFailedCount;
+	return stats;
+}
+
+void DescriptorAllocator::Release(Range range)
+{
+	auto next = std::lower_bound(mFreeRanges.begin(), mFreeRanges.end(), range.Index,
+		[](const Range& r, uint32_t index) { return r.Index < index; });
+
+	// Merge with the free range that ends where this one starts, and the one that starts
+	// where it ends.
+	bool mergePrev = next != mFreeRanges.begin() && (next - 1)->Index + (next - 1)->Count == range.Index;
+	bool mergeNext = next != mFreeRanges.end() && range.Index + range.Count == next->Index;
+
+	if(mergePrev && mergeNext)
+	{
+		(next - 1)->Count += range.Count + next->Count;
+		mFreeRanges.erase(next);
+	}
+	else if(mergePrev)
+	{
+		(next - 1)->Count += range.Count;
+	}
+	else if(mergeNext)
+	{
+		next->Index = range.Index;
+		next->Count += range.Count;
+	}
+	else
+	{
+		mFreeRanges.insert(next, range);
+	}
+}
@@ -0,0 +1,133 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Hands out slots in a descriptor heap, so views are created wherever there is room
+// rather than at indices fixed up front.  The heap is split in two regions:
+//   -Persistent slots, for views that live until they are freed (a texture's SRV).  Free
+//    ranges are kept sorted by index and merged with their neighbours; Allocate takes
+//    the first range that fits.  A freed range may still be read by frames in flight, so
+//    it only becomes free again once the frame it was freed in has retired.
+//   -Transient slots, for views only one frame uses.  They come from a ring, each frame
+//    taking the next slots; a frame's slots are reused once it retires.  A run of slots
+//    never wraps around the end of the ring.
+// EndFrame stamps what the frame freed and allocated with the fence value it was
+// submitted with, and Recycle releases everything stamped with a value the GPU has
+// completed.
+//
+// Indices are into the whole heap: persistent slots first, then transient ones.  Not
+// thread safe.  No Direct3D dependencies; DescriptorHeapAllocator is the Direct3D 12 side.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct DescriptorAllocatorStats
+{
+	uint32_t PersistentCapacity = 0;
+	uint32_t PersistentAllocated = 0;
+
+	// Freed but waiting for their frame to retire.
+	uint32_t PersistentPendingFree = 0;
+
+	// The free slots, how many runs they are split into and the longest run.
+	uint32_t FreeCount = 0;
+	uint32_t FreeRangeCount = 0;
+	uint32_t LargestFreeRange = 0;
+
+	// 0 when the free slots are one run, approaching 1 as they are split into many small
+	// ones: 1 - LargestFreeRange / FreeCount.
+	float Fragmentation = 0.0f;
+
+	uint32_t TransientCapacity = 0;
+
+	// Transient slots frames in flight still hold, including those skipped so a run
+	// wouldn't wrap, and the most there have been at once.
+	uint32_t TransientUsed = 0;
+	uint32_t TransientPeak = 0;
+
+	// Allocations that didn't fit.
+	uint32_t FailedCount = 0;
+};
+
+class DescriptorAllocator
+{
+public:
+	static const uint32_t InvalidIndex = 0xffffffff;
+
+	DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount);
+	DescriptorAllocator(const DescriptorAllocator& rhs) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator& rhs) = delete;
+
+	// count consecutive persistent slots; returns the first, or InvalidIndex if no free
+	// run is long enough.
+	uint32_t Allocate(uint32_t count = 1);
+
+	// Frees an allocation, given the index Allocate returned.  The slots are reused once
+	// the current frame has retired.  Returns false for an index that isn't allocated.
+	bool Free(uint32_t index);
+
+	// count consecutive transient slots for the current frame, or InvalidIndex if the
+	// frames in flight hold too many.
+	uint32_t AllocateTransient(uint32_t count = 1);
+
+	// Ends the current frame, which was submitted with fenceValue.  Fence values must not
+	// decrease.
+	void EndFrame(uint64_t fenceValue);
+
+	// Releases the slots of every frame whose fence value is at most completedValue.
+	void Recycle(uint64_t completedValue);
+
+	uint32_t GetPersistentCount()const;
+	uint32_t GetTransientCount()const;
+	uint32_t GetDescriptorCount()const;
+
+	DescriptorAllocatorStats GetStats()const;
+
+private:
+	struct Range
+	{
+		uint32_t Index;
+		uint32_t Count;
+	};
+
+	struct PendingFree
+	{
+		Range Slots;
+		bool Stamped;
+		uint64_t FenceValue;
+	};
+
+	struct TransientFrame
+	{
+		uint64_t FenceValue;
+
+		// Ring position after the frame's last allocation.
+		uint64_t End;
+	};
+
+	void Release(Range range);
+
+private:
+	uint32_t mPersistentCount = 0;
+	uint32_t mTransientCount = 0;
+
+	// Sorted by index, never adjacent.
+	std::vector<Range> mFreeRanges;
+
+	// The size of the allocation starting at each persistent slot, 0 where none does.
+	std::vector<uint32_t> mAllocationSizes;
+	uint32_t mAllocated = 0;
+
+	std::deque<PendingFree> mPendingFrees;
+
+	// Positions in the ring only ever grow; the slot is the position modulo its size.
+	uint64_t mTransientHead = 0;
+	uint64_t mTransientTail = 0;
+	std::deque<TransientFrame> mTransientFrames;
+	uint32_t mTransientPeak = 0;
+
+	uint32_t mFailedCount = 0;
+};
@@ -0,0 +1,84 @@
+//***************************************************************************************
+// DescriptorHeapAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorHeapAllocator.h"
+
+DescriptorHeapAllocator::DescriptorHeapAllocator(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+	UINT persistentCount, UINT transientCount, bool shaderVisible)
+	: md3dDevice(device),
+	  mAllocator(persistentCount, transientCount)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = persistentCount + transientCount;
+	heapDesc.Type = type;
+	heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(mHeap.GetAddressOf())));
+
+	mDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(type);
+}
+
+ID3D12DescriptorHeap* DescriptorHeapAllocator::GetHeap()const
+{
+	return mHeap.Get();
+}
+
+UINT DescriptorHeapAllocator::Allocate(UINT count)
+{
+	uint32_t index = mAllocator.Allocate(count);
+	if(index == DescriptorAllocator::InvalidIndex)
+		ThrowIfFailed(E_OUTOFMEMORY);
+	return index;
+}
+
+void DescriptorHeapAllocator::Free(UINT index)
+{
+	bool freed = mAllocator.Free(index);
+	assert(freed);
+	(void)freed;
+}
+
+UINT DescriptorHeapAllocator::AllocateTransient(UINT count)
+{
+	uint32_t index = mAllocator.AllocateTransient(count);
+	if(index == DescriptorAllocator::InvalidIndex)
+		ThrowIfFailed(E_OUTOFMEMORY);
+	return index;
+}
+
+UINT DescriptorHeapAllocator::CreateSrv(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+{
+	UINT index = Allocate();
+	md3dDevice->CreateShaderResourceView(resource, desc, GetCpuHandle(index));
+	return index;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeapAllocator::GetCpuHandle(UINT index)const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), (INT)index, mDescriptorSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeapAllocator::GetGpuHandle(UINT index)const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), (INT)index, mDescriptorSize);
+}
+
+void DescriptorHeapAllocator::BeginFrame(UINT64 completedValue)
+{
+	mAllocator.Recycle(completedValue);
+}
+
+void DescriptorHeapAllocator::EndFrame(UINT64 submittedValue)
+{
+	mAllocator.EndFrame(submittedValue);
+}
+
+UINT DescriptorHeapAllocator::GetPersistentCount()const
+{
+	return mAllocator.GetPersistentCount();
+}
+
+DescriptorAllocatorStats DescriptorHeapAllocator::GetStats()const
+{
+	return mAllocator.GetStats();
+}
@@ -0,0 +1,53 @@
+//***************************************************************************************
+// DescriptorHeapAllocator.h
+//
+// A descriptor heap whose slots are handed out by a DescriptorAllocator.  CreateSrv
+// allocates a persistent slot and writes the view to it, so a texture gets its index
+// when its view is created instead of at a slot chosen up front.
+//
+// Call BeginFrame once the frame's fence wait is done and EndFrame once its commands are
+// submitted; slots freed or taken for a frame are reused once its fence completes.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeapAllocator
+{
+public:
+	DescriptorHeapAllocator(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type,
+		UINT persistentCount, UINT transientCount, bool shaderVisible);
+	DescriptorHeapAllocator(const DescriptorHeapAllocator& rhs) = delete;
+	DescriptorHeapAllocator& operator=(const DescriptorHeapAllocator& rhs) = delete;
+
+	ID3D12DescriptorHeap* GetHeap()const;
+
+	// Throws if the persistent slots are used up.
+	UINT Allocate(UINT count = 1);
+	void Free(UINT index);
+
+	// Throws if the frames in flight hold every transient slot.
+	UINT AllocateTransient(UINT count = 1);
+
+	// Allocates a persistent slot and creates the view in it.
+	UINT CreateSrv(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(UINT index)const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(UINT index)const;
+
+	// completedValue is the frame fence's completed value, submittedValue the value the
+	// frame's commands signal.
+	void BeginFrame(UINT64 completedValue);
+	void EndFrame(UINT64 submittedValue);
+
+	UINT GetPersistentCount()const;
+	DescriptorAllocatorStats GetStats()const;
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+	UINT mDescriptorSize = 0;
+	DescriptorAllocator mAllocator;
+};
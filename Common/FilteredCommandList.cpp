@@ -0,0 +1,181 @@
+//***************************************************************************************
+// FilteredCommandList.cpp
+//***************************************************************************************
+
+#include "FilteredCommandList.h"
+
+#include <cstddef>
+
+// The views are passed through as they are.
+static_assert(sizeof(VertexBufferBinding) == sizeof(D3D12_VERTEX_BUFFER_VIEW) &&
+	offsetof(VertexBufferBinding, Location) == offsetof(D3D12_VERTEX_BUFFER_VIEW, BufferLocation) &&
+	offsetof(VertexBufferBinding, Size) == offsetof(D3D12_VERTEX_BUFFER_VIEW, SizeInBytes) &&
+	offsetof(VertexBufferBinding, Stride) == offsetof(D3D12_VERTEX_BUFFER_VIEW, StrideInBytes),
+	"VertexBufferBinding must match D3D12_VERTEX_BUFFER_VIEW");
+static_assert(sizeof(IndexBufferBinding) == sizeof(D3D12_INDEX_BUFFER_VIEW) &&
+	offsetof(IndexBufferBinding, Location) == offsetof(D3D12_INDEX_BUFFER_VIEW, BufferLocation) &&
+	offsetof(IndexBufferBinding, Size) == offsetof(D3D12_INDEX_BUFFER_VIEW, SizeInBytes) &&
+	offsetof(IndexBufferBinding, Format) == offsetof(D3D12_INDEX_BUFFER_VIEW, Format),
+	"IndexBufferBinding must match D3D12_INDEX_BUFFER_VIEW");
+
+FilteredCommandList::FilteredCommandList()
+	: mFilter(mBackend)
+{
+}
+
+void FilteredCommandList::Begin(ID3D12GraphicsCommandList* cmdList)
+{
+	mBackend.CommandList = cmdList;
+	mFilter.Invalidate();
+	mFilter.ResetStats();
+}
+
+ID3D12GraphicsCommandList* FilteredCommandList::Get()const
+{
+	return mBackend.CommandList;
+}
+
+ID3D12GraphicsCommandList* FilteredCommandList::operator->()const
+{
+	return mBackend.CommandList;
+}
+
+void FilteredCommandList::Invalidate()
+{
+	mFilter.Invalidate();
+}
+
+void FilteredCommandList::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+	mFilter.SetRootSignature(rootSignature);
+}
+
+void FilteredCommandList::SetPipelineState(ID3D12PipelineState* pipelineState)
+{
+	mFilter.SetPipelineState(pipelineState);
+}
+
+void FilteredCommandList::SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)
+{
+	const void* pointers[2] = {};
+	for(UINT i = 0; i < count && i < 2; ++i)
+		pointers[i] = heaps[i];
+	mFilter.SetDescriptorHeaps(count, pointers);
+}
+
+void FilteredCommandList::SetGraphicsRootDescriptorTable(UINT parameter, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	mFilter.SetRootDescriptorTable(parameter, baseDescriptor.ptr);
+}
+
+void FilteredCommandList::SetGraphicsRootConstantBufferView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	mFilter.SetRootView(BindingCall::RootConstantBufferView, parameter, address);
+}
+
+void FilteredCommandList::SetGraphicsRootShaderResourceView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	mFilter.SetRootView(BindingCall::RootShaderResourceView, parameter, address);
+}
+
+void FilteredCommandList::SetGraphicsRootUnorderedAccessView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	mFilter.SetRootView(BindingCall::RootUnorderedAccessView, parameter, address);
+}
+
+void FilteredCommandList::SetGraphicsRoot32BitConstant(UINT parameter, UINT value, UINT offset)
+{
+	uint32_t constant = value;
+	mFilter.SetRootConstants(parameter, 1, &constant, offset);
+}
+
+void FilteredCommandList::SetGraphicsRoot32BitConstants(UINT parameter, UINT count, const void* values, UINT offset)
+{
+	mFilter.SetRootConstants(parameter, count, (const uint32_t*)values, offset);
+}
+
+void FilteredCommandList::IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+	mFilter.SetVertexBuffers(startSlot, count, (const VertexBufferBinding*)views);
+}
+
+void FilteredCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+	mFilter.SetIndexBuffer((const IndexBufferBinding*)view);
+}
+
+void FilteredCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	mFilter.SetPrimitiveTopology((uint32_t)topology);
+}
+
+const BindingStats& FilteredCommandList::GetStats()const
+{
+	return mFilter.GetStats();
+}
+
+void FilteredCommandList::Backend::SetRootSignature(const void* rootSignature)
+{
+	CommandList->SetGraphicsRootSignature((ID3D12RootSignature*)rootSignature);
+}
+
+void FilteredCommandList::Backend::SetPipelineState(const void* pipelineState)
+{
+	CommandList->SetPipelineState((ID3D12PipelineState*)pipelineState);
+}
+
+void FilteredCommandList::Backend::SetDescriptorHeaps(uint32_t count, const void* const* heaps)
+{
+	ID3D12DescriptorHeap* d3dHeaps[2] = {};
+	for(uint32_t i = 0; i < count; ++i)
+		d3dHeaps[i] = (ID3D12DescriptorHeap*)heaps[i];
+	CommandList->SetDescriptorHeaps(count, d3dHeaps);
+}
+
+void FilteredCommandList::Backend::SetRootDescriptorTable(uint32_t parameter, uint64_t baseDescriptor)
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE handle;
+	handle.ptr = baseDescriptor;
+	CommandList->SetGraphicsRootDescriptorTable(parameter, handle);
+}
+
+void FilteredCommandList::Backend::SetRootView(BindingCall call, uint32_t parameter, uint64_t address)
+{
+	switch(call)
+	{
+	case BindingCall::RootConstantBufferView:
+		CommandList->SetGraphicsRootConstantBufferView(parameter, address);
+		break;
+	case BindingCall::RootShaderResourceView:
+		CommandList->SetGraphicsRootShaderResourceView(parameter, address);
+		break;
+	case BindingCall::RootUnorderedAccessView:
+		CommandList->SetGraphicsRootUnorderedAccessView(parameter, address);
+		break;
+	default:
+		break;
+	}
+}
+
+void FilteredCommandList::Backend::SetRootConstants(uint32_t parameter, uint32_t count, const uint32_t* values, uint32_t offset)
+{
+	if(count == 1)
+		CommandList->SetGraphicsRoot32BitConstant(parameter, values[0], offset);
+	else
+		CommandList->SetGraphicsRoot32BitConstants(parameter, count, values, offset);
+}
+
+void FilteredCommandList::Backend::SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferBinding* views)
+{
+	CommandList->IASetVertexBuffers(startSlot, count, (const D3D12_VERTEX_BUFFER_VIEW*)views);
+}
+
+void FilteredCommandList::Backend::SetIndexBuffer(const IndexBufferBinding* view)
+{
+	CommandList->IASetIndexBuffer((const D3D12_INDEX_BUFFER_VIEW*)view);
+}
+
+void FilteredCommandList::Backend::SetPrimitiveTopology(uint32_t topology)
+{
+	CommandList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)topology);
+}
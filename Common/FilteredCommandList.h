@@ -0,0 +1,69 @@
+//***************************************************************************************
+// FilteredCommandList.h
+//
+// Direct3D 12 backend for BindingFilter: a command list whose binding calls go through
+// the filter, so repeated bindings never reach the list.  Draws and everything else are
+// made on the list itself, through operator->.  Binding behind the filter's back that
+// way leaves it out of date; call Invalidate afterwards.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "BindingFilter.h"
+
+class FilteredCommandList
+{
+public:
+	FilteredCommandList();
+	FilteredCommandList(const FilteredCommandList& rhs) = delete;
+	FilteredCommandList& operator=(const FilteredCommandList& rhs) = delete;
+
+	// Starts filtering cmdList, which has just been reset, so nothing is bound.  The
+	// counts start again too: they cover one recording.
+	void Begin(ID3D12GraphicsCommandList* cmdList);
+
+	ID3D12GraphicsCommandList* Get()const;
+	ID3D12GraphicsCommandList* operator->()const;
+
+	void Invalidate();
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature);
+	void SetPipelineState(ID3D12PipelineState* pipelineState);
+	void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps);
+
+	void SetGraphicsRootDescriptorTable(UINT parameter, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+	void SetGraphicsRootConstantBufferView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetGraphicsRootShaderResourceView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetGraphicsRootUnorderedAccessView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address);
+	void SetGraphicsRoot32BitConstant(UINT parameter, UINT value, UINT offset);
+	void SetGraphicsRoot32BitConstants(UINT parameter, UINT count, const void* values, UINT offset);
+
+	void IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views);
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view);
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+
+	const BindingStats& GetStats()const;
+
+private:
+	// Passes on what gets through the filter.
+	class Backend : public BindingBackend
+	{
+	public:
+		void SetRootSignature(const void* rootSignature)override;
+		void SetPipelineState(const void* pipelineState)override;
+		void SetDescriptorHeaps(uint32_t count, const void* const* heaps)override;
+		void SetRootDescriptorTable(uint32_t parameter, uint64_t baseDescriptor)override;
+		void SetRootView(BindingCall call, uint32_t parameter, uint64_t address)override;
+		void SetRootConstants(uint32_t parameter, uint32_t count, const uint32_t* values, uint32_t offset)override;
+		void SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferBinding* views)override;
+		void SetIndexBuffer(const IndexBufferBinding* view)override;
+		void SetPrimitiveTopology(uint32_t topology)override;
+
+		ID3D12GraphicsCommandList* CommandList = nullptr;
+	};
+
+private:
+	Backend mBackend;
+	BindingFilter mFilter;
+};
@@ -0,0 +1,72 @@
+//***************************************************************************************
+// FrameLatencyController.cpp
+//***************************************************************************************
+
+#include "FrameLatencyController.h"
+#include <algorithm>
+
+FrameLatencyController::FrameLatencyController(int initialLatency, const FrameLatencySettings& settings)
+	: mSettings(settings)
+{
+	mSettings.MinLatency = std::max(mSettings.MinLatency, 1);
+	mSettings.MaxLatency = std::max(mSettings.MaxLatency, mSettings.MinLatency);
+	mSettings.WindowFrames = std::max(mSettings.WindowFrames, 1);
+
+	mLatency = std::min(std::max(initialLatency, mSettings.MinLatency), mSettings.MaxLatency);
+}
+
+int FrameLatencyController::AddFrame(double cpuWaitMs)
+{
+	mWindowFrameCount++;
+
+	if(cpuWaitMs > 0.0)
+		mWindowWaitCount++;
+
+	if(cpuWaitMs > mSettings.StallThresholdMs)
+		mWindowStallCount++;
+
+	if(mWindowFrameCount >= mSettings.WindowFrames)
+		EvaluateWindow();
+
+	return mLatency;
+}
+
+int FrameLatencyController::GetLatency()const
+{
+	return mLatency;
+}
+
+const FrameLatencySettings& FrameLatencyController::GetSettings()const
+{
+	return mSettings;
+}
+
+void FrameLatencyController::EvaluateWindow()
+{
+	double stallFraction = (double)mWindowStallCount / mWindowFrameCount;
+
+	if(stallFraction > mSettings.RaiseStallFraction)
+	{
+		// The GPU is the bottleneck and the CPU keeps blocking; give it more room.
+		mQuietWindowCount = 0;
+		mLatency = std::min(mLatency + 1, mSettings.MaxLatency);
+	}
+	else if(mWindowWaitCount == 0)
+	{
+		// The CPU never waited, so the extra queued frames only add latency.  Require a
+		// few quiet windows in a row so we do not oscillate right after raising.
+		if(++mQuietWindowCount >= mSettings.QuietWindowsToLower)
+		{
+			mQuietWindowCount = 0;
+			mLatency = std::max(mLatency - 1, mSettings.MinLatency);
+		}
+	}
+	else
+	{
+		mQuietWindowCount = 0;
+	}
+
+	mWindowFrameCount = 0;
+	mWindowWaitCount = 0;
+	mWindowStallCount = 0;
+}
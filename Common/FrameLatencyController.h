@@ -0,0 +1,57 @@
+//***************************************************************************************
+// FrameLatencyController.h
+//
+// Chooses how many frames the CPU may queue ahead of the GPU.
+//   -When the CPU never had to wait on the fence for several windows of frames, the
+//    GPU is keeping up and the queue depth is lowered to cut input latency.
+//   -When too many frames in a window stall on the fence for longer than a threshold,
+//    the queue depth is raised again to recover throughput.
+//
+// It only consumes per-frame wait times, so it can be driven by a simulation.
+//***************************************************************************************
+
+#pragma once
+
+struct FrameLatencySettings
+{
+	// Bounds on the queue depth.  MaxLatency should not exceed the number of frame resources.
+	int MinLatency = 1;
+	int MaxLatency = 3;
+
+	// Number of frames evaluated before a decision is made.
+	int WindowFrames = 120;
+
+	// A frame counts as stalled when it waited longer than this.
+	double StallThresholdMs = 1.0;
+
+	// Raise the queue depth when more than this fraction of the window stalled.
+	double RaiseStallFraction = 0.1;
+
+	// Lower the queue depth only after this many consecutive windows without any wait.
+	int QuietWindowsToLower = 4;
+};
+
+class FrameLatencyController
+{
+public:
+	FrameLatencyController(int initialLatency, const FrameLatencySettings& settings);
+
+	// Records the CPU wait time of one frame and returns the queue depth to use from now on.
+	int AddFrame(double cpuWaitMs);
+
+	int GetLatency()const;
+	const FrameLatencySettings& GetSettings()const;
+
+private:
+	void EvaluateWindow();
+
+private:
+	FrameLatencySettings mSettings;
+
+	int mLatency = 1;
+
+	int mWindowFrameCount = 0;
+	int mWindowWaitCount = 0;
+	int mWindowStallCount = 0;
+	int mQuietWindowCount = 0;
+};
@@ -0,0 +1,106 @@
+//***************************************************************************************
+// FramePacer.cpp
+//***************************************************************************************
+
+#include "FramePacer.h"
+
+FramePacer::FramePacer(UINT maxFrameLatency, UINT eventPoolSize)
+{
+	SetMaxFrameLatency(maxFrameLatency);
+
+	__int64 countsPerSec;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	mSecondsPerCount = 1.0 / (double)countsPerSec;
+
+	eventPoolSize = MathHelper::Max(eventPoolSize, 1u);
+	for(UINT i = 0; i < eventPoolSize; ++i)
+	{
+		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+		if(eventHandle == nullptr)
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+		mWaitEvents.push_back(eventHandle);
+	}
+}
+
+FramePacer::~FramePacer()
+{
+	for(HANDLE eventHandle : mWaitEvents)
+		CloseHandle(eventHandle);
+}
+
+UINT FramePacer::GetMaxFrameLatency()const
+{
+	return mMaxFrameLatency;
+}
+
+void FramePacer::SetMaxFrameLatency(UINT maxFrameLatency)
+{
+	// A latency of zero would mean never recording a frame.
+	mMaxFrameLatency = MathHelper::Max(maxFrameLatency, 1u);
+}
+
+void FramePacer::WaitForFrame(ID3D12Fence* fence, UINT64 frameFence, UINT64 submittedFence)
+{
+	UINT64 completedFence = fence->GetCompletedValue();
+
+	mLastFrameStats = FramePacingStats();
+	mLastFrameStats.GpuFramesAhead = submittedFence > completedFence ? submittedFence - completedFence : 0;
+	mLastFrameStats.WaitFenceValue = FramePacingPolicy::RequiredFenceValue(
+		frameFence, submittedFence, completedFence, mMaxFrameLatency);
+
+	mFrameCount++;
+
+	if(mLastFrameStats.WaitFenceValue == 0)
+		return;
+
+	__int64 startTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+
+	HANDLE eventHandle = NextWaitEvent();
+	ThrowIfFailed(fence->SetEventOnCompletion(mLastFrameStats.WaitFenceValue, eventHandle));
+	WaitForSingleObject(eventHandle, INFINITE);
+
+	__int64 endTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+
+	mLastFrameStats.CpuWaitMs = (endTime - startTime)*mSecondsPerCount*1000.0;
+
+	mStalledFrameCount++;
+	mTotalCpuWaitMs += mLastFrameStats.CpuWaitMs;
+}
+
+const FramePacingStats& FramePacer::GetLastFrameStats()const
+{
+	return mLastFrameStats;
+}
+
+UINT64 FramePacer::GetFrameCount()const
+{
+	return mFrameCount;
+}
+
+UINT64 FramePacer::GetStalledFrameCount()const
+{
+	return mStalledFrameCount;
+}
+
+double FramePacer::GetTotalCpuWaitMs()const
+{
+	return mTotalCpuWaitMs;
+}
+
+void FramePacer::ResetTotals()
+{
+	mFrameCount = 0;
+	mStalledFrameCount = 0;
+	mTotalCpuWaitMs = 0.0;
+}
+
+HANDLE FramePacer::NextWaitEvent()
+{
+	HANDLE eventHandle = mWaitEvents[mNextWaitEvent];
+	mNextWaitEvent = (mNextWaitEvent + 1) % (UINT)mWaitEvents.size();
+
+	return eventHandle;
+}
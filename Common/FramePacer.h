@@ -0,0 +1,70 @@
+//***************************************************************************************
+// FramePacer.h
+//
+// Paces the CPU against the GPU fence.
+//   -It keeps no more than a configurable number of frames queued on the GPU.
+//   -It owns a small pool of wait events that are reused every frame instead of
+//    creating and closing a kernel object whenever the CPU has to block.
+//   -It records how long the CPU was blocked and how far ahead of the GPU it was.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FramePacingPolicy.h"
+
+// Telemetry gathered for a single frame.
+struct FramePacingStats
+{
+	// Time the CPU spent blocked on the fence before it could start the frame.
+	double CpuWaitMs = 0.0;
+
+	// Number of submitted frames the GPU had not finished when the frame started.
+	UINT64 GpuFramesAhead = 0;
+
+	// Fence value the CPU waited on, or 0 if the frame did not have to wait.
+	UINT64 WaitFenceValue = 0;
+};
+
+class FramePacer
+{
+public:
+	FramePacer(UINT maxFrameLatency, UINT eventPoolSize = 2);
+	FramePacer(const FramePacer& rhs) = delete;
+	FramePacer& operator=(const FramePacer& rhs) = delete;
+	~FramePacer();
+
+	UINT GetMaxFrameLatency()const;
+	void SetMaxFrameLatency(UINT maxFrameLatency);
+
+	// Blocks until the GPU is done with the frame resource whose fence is frameFence and
+	// the frame latency limit is respected.  submittedFence is the last value signalled
+	// on the queue.
+	void WaitForFrame(ID3D12Fence* fence, UINT64 frameFence, UINT64 submittedFence);
+
+	// Stats for the most recent call to WaitForFrame.
+	const FramePacingStats& GetLastFrameStats()const;
+
+	// Running totals since construction (or the last ResetTotals call).
+	UINT64 GetFrameCount()const;
+	UINT64 GetStalledFrameCount()const;
+	double GetTotalCpuWaitMs()const;
+	void ResetTotals();
+
+private:
+	HANDLE NextWaitEvent();
+
+private:
+	UINT mMaxFrameLatency = 1;
+
+	// Auto-reset events created once and handed out round-robin.
+	std::vector<HANDLE> mWaitEvents;
+	UINT mNextWaitEvent = 0;
+
+	double mSecondsPerCount = 0.0;
+
+	FramePacingStats mLastFrameStats;
+	UINT64 mFrameCount = 0;
+	UINT64 mStalledFrameCount = 0;
+	double mTotalCpuWaitMs = 0.0;
+};
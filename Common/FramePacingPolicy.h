@@ -0,0 +1,37 @@
+//***************************************************************************************
+// FramePacingPolicy.h
+//
+// The pacing decision FramePacer makes, on its own.  It only looks at fence values, so
+// it can be driven by a simulated fence without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class FramePacingPolicy
+{
+public:
+	// Returns the fence value that must be complete before the CPU may start recording
+	// into a frame resource last submitted at frameFence, when submittedFence is the most
+	// recently signalled value and completedFence the value the GPU has reached.  At most
+	// maxFrameLatency frames (including the one about to be recorded) may be in flight.
+	// Returns 0 when no wait is needed.
+	static uint64_t RequiredFenceValue(uint64_t frameFence, uint64_t submittedFence,
+		uint64_t completedFence, uint32_t maxFrameLatency)
+	{
+		uint64_t required = frameFence;
+
+		if(maxFrameLatency > 0 && submittedFence >= maxFrameLatency)
+		{
+			uint64_t latencyFence = submittedFence - maxFrameLatency + 1;
+			if(latencyFence > required)
+				required = latencyFence;
+		}
+
+		if(required == 0 || completedFence >= required)
+			return 0;
+
+		return required;
+	}
+};
@@ -8,11 +8,36 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCo
 
     //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
     PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    MaterialBuffer = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, false);
+    ObjectBuffer = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, false);
 }
 
 FrameResource::~FrameResource()
 {
 
+}
+
+template<typename T>
+static void ReserveUploadBuffer(ID3D12Device* device, std::unique_ptr<UploadBuffer<T>>& buffer,
+    UINT& capacity, UINT count)
+{
+    // Keep at least one element so the root SRV always points at a live resource.
+    count = MathHelper::Max(count, 1u);
+    if(buffer != nullptr && count <= capacity)
+        return;
+
+    capacity = MathHelper::Max(count, capacity * 2);
+    buffer = std::make_unique<UploadBuffer<T>>(device, capacity, false);
+}
+
+void FrameResource::ReserveClusterBuffers(ID3D12Device* device, UINT lightCount, UINT clusterCount, UINT indexCount)
+{
+    ReserveUploadBuffer(device, ClusterLightBuffer, ClusterLightCapacity, lightCount);
+    ReserveUploadBuffer(device, ClusterRangeBuffer, ClusterRangeCapacity, clusterCount);
+    ReserveUploadBuffer(device, ClusterIndexBuffer, ClusterIndexCapacity, indexCount);
+}
+
+void FrameResource::ReserveIndirectDrawBuffer(ID3D12Device* device, UINT commandCount)
+{
+    ReserveUploadBuffer(device, IndirectDrawBuffer, IndirectDrawCapacity, commandCount);
 }
\ No newline at end of file
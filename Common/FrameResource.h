@@ -3,6 +3,8 @@
 #include "d3dUtil.h"
 #include "MathHelper.h"
 #include "UploadBuffer.h"
+#include "LightClusterGrid.h"
+#include "IndirectDrawBuilder.h"
 
 
 struct ObjectConstants
@@ -36,6 +38,16 @@ struct PassConstants
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light Lights[MaxLights];
+
+    // Point and spot lights are not in Lights[]; they live in a structured buffer and are
+    // looked up through the light cluster grid.  These let the pixel shader find its cluster.
+    UINT ClusterTilesX = 1;
+    UINT ClusterTilesY = 1;
+    UINT ClusterSlices = 1;
+    UINT ClusterPointLightCount = 0;
+    DirectX::XMFLOAT2 ClusterTileSize = { 1.0f, 1.0f };
+    float ClusterSliceScale = 0.0f;
+    float ClusterSliceBias = 0.0f;
 };
 
 struct Vertex
@@ -64,8 +76,30 @@ public:
     // that reference it.  So each frame needs their own cbuffers.
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+
+    // Materials and objects are structured buffers indexed by the per-draw root constant.
+    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialBuffer = nullptr;
+    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectBuffer = nullptr;
+
+    // Clustered lighting buffers.  They grow on demand, so the light count is not capped.
+    std::unique_ptr<UploadBuffer<Light>> ClusterLightBuffer = nullptr;
+    std::unique_ptr<UploadBuffer<ClusterRange>> ClusterRangeBuffer = nullptr;
+    std::unique_ptr<UploadBuffer<UINT>> ClusterIndexBuffer = nullptr;
+    UINT ClusterLightCapacity = 0;
+    UINT ClusterRangeCapacity = 0;
+    UINT ClusterIndexCapacity = 0;
+
+    // Grows the clustered lighting buffers to hold at least the given counts.  Only call
+    // once the GPU has finished with this frame resource.
+    void ReserveClusterBuffers(ID3D12Device* device, UINT lightCount, UINT clusterCount, UINT indexCount);
+
+    // The opaque layer's ExecuteIndirect arguments, written by the CPU each frame.  It
+    // grows on demand like the cluster buffers.
+    std::unique_ptr<UploadBuffer<IndirectDrawCommand>> IndirectDrawBuffer = nullptr;
+    UINT IndirectDrawCapacity = 0;
+
+    // Only call once the GPU has finished with this frame resource.
+    void ReserveIndirectDrawBuffer(ID3D12Device* device, UINT commandCount);
 
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
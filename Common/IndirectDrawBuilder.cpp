@@ -0,0 +1,150 @@
+//***************************************************************************************
+// IndirectDrawBuilder.cpp
+//***************************************************************************************
+
+#include "IndirectDrawBuilder.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	bool IsVisible(const IndirectDrawItem& item, const IndirectDrawFrustum& frustum)
+	{
+		for(const float* plane : frustum.Planes)
+		{
+			// The box is outside if even its corner furthest along the plane's normal is.
+			float distance = plane[0]*item.Center[0] + plane[1]*item.Center[1] + plane[2]*item.Center[2] + plane[3];
+			float radius = fabsf(plane[0])*item.Extents[0] + fabsf(plane[1])*item.Extents[1] +
+				fabsf(plane[2])*item.Extents[2];
+			if(distance < -radius)
+				return false;
+		}
+		return true;
+	}
+}
+
+IndirectDrawFrustum IndirectDrawFrustum::FromViewProj(const float viewProj[16])
+{
+	// A point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w in clip space,
+	// where each clip coordinate is the point dotted with a column of the matrix.
+	auto column = [viewProj](int c, float* out)
+	{
+		for(int r = 0; r < 4; ++r)
+			out[r] = viewProj[r*4 + c];
+	};
+
+	float x[4], y[4], z[4], w[4];
+	column(0, x);
+	column(1, y);
+	column(2, z);
+	column(3, w);
+
+	IndirectDrawFrustum frustum;
+	for(int i = 0; i < 4; ++i)
+	{
+		frustum.Planes[0][i] = w[i] + x[i];
+		frustum.Planes[1][i] = w[i] - x[i];
+		frustum.Planes[2][i] = w[i] + y[i];
+		frustum.Planes[3][i] = w[i] - y[i];
+		frustum.Planes[4][i] = z[i];
+		frustum.Planes[5][i] = w[i] - z[i];
+	}
+	return frustum;
+}
+
+uint32_t IndirectDrawBuilder::Build(const std::vector<IndirectDrawItem>& items, const IndirectDrawFrustum* frustum,
+	ThreadPool* pool, IndirectDrawCommand* commands)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	uint32_t itemCount = (uint32_t)items.size();
+	uint32_t chunkCount = itemCount / MinItemsPerChunk;
+	if(pool == nullptr)
+		chunkCount = 1;
+	else if(chunkCount > pool->GetThreadCount() + 1)
+		chunkCount = pool->GetThreadCount() + 1;
+	if(chunkCount == 0)
+		chunkCount = 1;
+
+	mChunks.assign(chunkCount, Chunk());
+	for(uint32_t i = 0; i < chunkCount; ++i)
+	{
+		mChunks[i].Begin = (uint32_t)((uint64_t)itemCount*i / chunkCount);
+		mChunks[i].End = (uint32_t)((uint64_t)itemCount*(i + 1) / chunkCount);
+	}
+	mVisible.resize(itemCount);
+
+	ParallelFor(pool, chunkCount, [&](size_t i) { CullChunk(mChunks[i], items, frustum); });
+
+	uint32_t drawCount = 0;
+	for(Chunk& chunk : mChunks)
+	{
+		chunk.FirstCommand = drawCount;
+		drawCount += chunk.Count;
+	}
+	mDrawnItems.resize(drawCount);
+
+	ParallelFor(pool, chunkCount, [&](size_t i) { WriteChunk(mChunks[i], items, commands); });
+
+	mStats.ItemCount = itemCount;
+	mStats.DrawCount = drawCount;
+	mStats.CulledCount = itemCount - drawCount;
+	mStats.ChunkCount = chunkCount;
+	mStats.Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return drawCount;
+}
+
+const std::vector<uint32_t>& IndirectDrawBuilder::GetDrawnItems()const
+{
+	return mDrawnItems;
+}
+
+const IndirectDrawStats& IndirectDrawBuilder::GetStats()const
+{
+	return mStats;
+}
+
+void IndirectDrawBuilder::CullChunk(Chunk& chunk, const std::vector<IndirectDrawItem>& items,
+	const IndirectDrawFrustum* frustum)
+{
+	uint32_t count = 0;
+	for(uint32_t i = chunk.Begin; i < chunk.End; ++i)
+	{
+		bool visible = frustum == nullptr || IsVisible(items[i], *frustum);
+		mVisible[i] = visible ? 1 : 0;
+		count += visible ? 1 : 0;
+	}
+	chunk.Count = count;
+}
+
+void IndirectDrawBuilder::WriteChunk(const Chunk& chunk, const std::vector<IndirectDrawItem>& items,
+	IndirectDrawCommand* commands)
+{
+	uint32_t next = chunk.FirstCommand;
+	for(uint32_t i = chunk.Begin; i < chunk.End; ++i)
+	{
+		if(mVisible[i] == 0)
+			continue;
+
+		const IndirectDrawItem& item = items[i];
+
+		// Filled in a local and stored whole: the destination is usually write-combined
+		// upload memory, which should only be written, in order.
+		IndirectDrawCommand command;
+		command.VertexBuffer = item.VertexBuffer;
+		command.IndexBuffer = item.IndexBuffer;
+		command.DrawIndex = item.DrawIndex;
+		command.IndexCountPerInstance = item.IndexCount;
+		command.InstanceCount = 1;
+		command.StartIndexLocation = item.StartIndexLocation;
+		command.BaseVertexLocation = item.BaseVertexLocation;
+		command.StartInstanceLocation = 0;
+		commands[next] = command;
+
+		mDrawnItems[next] = i;
+		next++;
+	}
+}
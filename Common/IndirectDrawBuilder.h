@@ -0,0 +1,122 @@
+//***************************************************************************************
+// IndirectDrawBuilder.h
+//
+// Builds the argument buffer for drawing a whole layer with one ExecuteIndirect.  Every
+// item that survives culling becomes one IndirectDrawCommand: its vertex and index
+// buffers, its draw index (the root constant the shaders look their object and material
+// up with) and the DrawIndexedInstanced arguments.
+//   -Items are culled against the view frustum by their world space bounds, if a frustum
+//    is given.
+//   -The commands are written compactly and in item order, straight into the caller's
+//    buffer, so the GPU reads them from the frame's upload buffer with no copy.
+//   -Large item lists are split into chunks run on the pool in two passes: each chunk
+//    culls and counts its items, the counts are summed into each chunk's first command,
+//    then each chunk writes its commands.  Lists of less than MinItemsPerChunk items run
+//    on the calling thread.
+//
+// Not thread safe.  No Direct3D dependencies; the command layout matches the command
+// signature the app creates (see IndirectDrawCommand).
+//***************************************************************************************
+
+#pragma once
+
+#include "BindingFilter.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+struct IndirectDrawItem
+{
+	// World space axis-aligned bounds.
+	float Center[3] = { 0.0f, 0.0f, 0.0f };
+	float Extents[3] = { 0.0f, 0.0f, 0.0f };
+
+	uint32_t DrawIndex = 0;
+	VertexBufferBinding VertexBuffer;
+	IndexBufferBinding IndexBuffer;
+
+	uint32_t IndexCount = 0;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+};
+
+// The arguments of one indirect draw, in command signature order: a vertex buffer view,
+// an index buffer view, one root constant and the D3D12_DRAW_INDEXED_ARGUMENTS.  The
+// signature's byte stride is sizeof(IndirectDrawCommand).
+struct IndirectDrawCommand
+{
+	VertexBufferBinding VertexBuffer;
+	IndexBufferBinding IndexBuffer;
+	uint32_t DrawIndex;
+
+	uint32_t IndexCountPerInstance;
+	uint32_t InstanceCount;
+	uint32_t StartIndexLocation;
+	int32_t BaseVertexLocation;
+	uint32_t StartInstanceLocation;
+};
+
+// Six planes (a, b, c, d), inside where a*x + b*y + c*z + d >= 0.  They needn't be
+// normalized.
+struct IndirectDrawFrustum
+{
+	float Planes[6][4];
+
+	// The planes of a row-major view-projection matrix that transforms row vectors (the
+	// DirectXMath convention), with depth from 0 to w.
+	static IndirectDrawFrustum FromViewProj(const float viewProj[16]);
+};
+
+struct IndirectDrawStats
+{
+	uint32_t ItemCount = 0;
+	uint32_t DrawCount = 0;
+	uint32_t CulledCount = 0;
+
+	// How many chunks the items were split into; 1 when they ran on the calling thread.
+	uint32_t ChunkCount = 0;
+
+	double Seconds = 0.0;
+};
+
+class IndirectDrawBuilder
+{
+public:
+	static const uint32_t MinItemsPerChunk = 1024;
+
+	IndirectDrawBuilder() = default;
+	IndirectDrawBuilder(const IndirectDrawBuilder& rhs) = delete;
+	IndirectDrawBuilder& operator=(const IndirectDrawBuilder& rhs) = delete;
+
+	// Writes the commands of the visible items to commands, which must have room for
+	// items.size() of them, and returns how many were written.  frustum and pool may be
+	// null: nothing is culled, or everything runs on the calling thread.
+	uint32_t Build(const std::vector<IndirectDrawItem>& items, const IndirectDrawFrustum* frustum,
+		ThreadPool* pool, IndirectDrawCommand* commands);
+
+	// The indices into items of the commands the last Build wrote, in the same order.
+	const std::vector<uint32_t>& GetDrawnItems()const;
+
+	const IndirectDrawStats& GetStats()const;
+
+private:
+	struct Chunk
+	{
+		uint32_t Begin = 0;
+		uint32_t End = 0;
+		uint32_t FirstCommand = 0;
+		uint32_t Count = 0;
+	};
+
+	// Flags the chunk's visible items in mVisible and counts them.
+	void CullChunk(Chunk& chunk, const std::vector<IndirectDrawItem>& items, const IndirectDrawFrustum* frustum);
+	void WriteChunk(const Chunk& chunk, const std::vector<IndirectDrawItem>& items, IndirectDrawCommand* commands);
+
+private:
+	std::vector<Chunk> mChunks;
+	std::vector<uint8_t> mVisible;
+	std::vector<uint32_t> mDrawnItems;
+	IndirectDrawStats mStats;
+};
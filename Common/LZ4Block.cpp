@@ -0,0 +1,215 @@
+//***************************************************************************************
+// LZ4Block.cpp
+//***************************************************************************************
+
+#include "LZ4Block.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const size_t MinMatch = 4;
+
+	// The format ends every block with at least this many literals, and no match may
+	// start within MatchStartLimit bytes of the end.
+	const size_t LastLiterals = 5;
+	const size_t MatchStartLimit = 12;
+
+	const size_t MaxOffset = 65535;
+
+	const int HashBits = 16;
+
+	uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t HashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Lengths past 15 continue in bytes of 255 and a final byte below it.
+	uint8_t* WriteLength(uint8_t* out, size_t length)
+	{
+		for(; length >= 255; length -= 255)
+			*out++ = 255;
+		*out++ = (uint8_t)length;
+		return out;
+	}
+
+	uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals, size_t literalLength,
+		size_t offset, size_t matchLength)
+	{
+		uint8_t* token = out++;
+		if(literalLength >= 15)
+		{
+			*token = 15 << 4;
+			out = WriteLength(out, literalLength - 15);
+		}
+		else
+		{
+			*token = (uint8_t)(literalLength << 4);
+		}
+
+		if(literalLength > 0)
+			memcpy(out, literals, literalLength);
+		out += literalLength;
+
+		// The last sequence is literals only.
+		if(matchLength == 0)
+			return out;
+
+		*out++ = (uint8_t)(offset & 0xff);
+		*out++ = (uint8_t)(offset >> 8);
+
+		size_t length = matchLength - MinMatch;
+		if(length >= 15)
+		{
+			*token |= 15;
+			out = WriteLength(out, length - 15);
+		}
+		else
+		{
+			*token |= (uint8_t)length;
+		}
+
+		return out;
+	}
+
+	// Reads the bytes that continue a length of 15.  Fails on running out of input or past
+	// limit, which keeps the sum from overflowing.
+	bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t limit, size_t& length)
+	{
+		uint8_t byte = 255;
+		while(byte == 255)
+		{
+			if(in == end)
+				return false;
+
+			byte = *in++;
+			length += byte;
+			if(length > limit)
+				return false;
+		}
+		return true;
+	}
+}
+
+size_t LZ4CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t LZ4CompressBlock(const uint8_t* src, size_t size, uint8_t* dest)
+{
+	uint8_t* out = dest;
+	size_t anchor = 0;
+
+	if(size > MatchStartLimit)
+	{
+		std::vector<uint32_t> table((size_t)1 << HashBits, 0);
+
+		// Positions are kept in 32 bits; past 4 GB the table just stops finding matches
+		// that are in range, so larger blocks still compress, only worse.
+		size_t position = 0;
+		while(position + MatchStartLimit <= size)
+		{
+			uint32_t sequence = Read32(src + position);
+			uint32_t hash = HashSequence(sequence);
+			size_t candidate = table[hash];
+			table[hash] = (uint32_t)position;
+
+			if(candidate >= position || position - candidate > MaxOffset || Read32(src + candidate) != sequence)
+			{
+				// Step further the longer nothing has matched, so incompressible data
+				// passes quickly.
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			while(position > anchor && candidate > 0 && src[position - 1] == src[candidate - 1])
+			{
+				--position;
+				--candidate;
+			}
+
+			size_t length = MinMatch;
+			while(position + length < size - LastLiterals && src[candidate + length] == src[position + length])
+				++length;
+
+			out = WriteSequence(out, src + anchor, position - anchor, position - candidate, length);
+
+			position += length;
+			anchor = position;
+		}
+	}
+
+	out = WriteSequence(out, src + anchor, size - anchor, 0, 0);
+	return (size_t)(out - dest);
+}
+
+bool LZ4DecompressBlock(const uint8_t* src, size_t srcSize, uint8_t* dest, size_t destSize)
+{
+	const uint8_t* in = src;
+	const uint8_t* inEnd = src + srcSize;
+	uint8_t* out = dest;
+	uint8_t* outEnd = dest + destSize;
+
+	for(;;)
+	{
+		if(in == inEnd)
+			return false;
+
+		uint8_t token = *in++;
+
+		size_t literalLength = token >> 4;
+		if(literalLength == 15 && !ReadLength(in, inEnd, destSize, literalLength))
+			return false;
+
+		if(literalLength > (size_t)(inEnd - in) || literalLength > (size_t)(outEnd - out))
+			return false;
+
+		if(literalLength > 0)
+			memcpy(out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// Only the last sequence ends without a match.
+		if(in == inEnd)
+			return out == outEnd;
+
+		if(inEnd - in < 2)
+			return false;
+
+		size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+		in += 2;
+		if(offset == 0 || offset > (size_t)(out - dest))
+			return false;
+
+		size_t matchLength = token & 15;
+		if(matchLength == 15 && !ReadLength(in, inEnd, destSize, matchLength))
+			return false;
+		matchLength += MinMatch;
+
+		if(matchLength > (size_t)(outEnd - out))
+			return false;
+
+		// A match closer than its length repeats the bytes it is still writing, so it has
+		// to be copied forwards one byte at a time.
+		const uint8_t* match = out - offset;
+		if(offset >= matchLength)
+		{
+			memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			for(size_t i = 0; i < matchLength; ++i)
+				*out++ = match[i];
+		}
+	}
+}
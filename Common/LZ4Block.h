@@ -0,0 +1,29 @@
+//***************************************************************************************
+// LZ4Block.h
+//
+// Compressor and decompressor for the LZ4 block format: runs of literals, each followed
+// by a match of at least 4 bytes copied from up to 64 KB back.  The output is a plain
+// LZ4 block, so other LZ4 decoders read it, but there is no frame, block checksum or
+// size header; the caller keeps the uncompressed size.
+//
+// The compressor is the greedy single-pass one with a hash table of 4-byte sequences.
+// It favours speed over ratio, as decompression is what runs at load time.  Neither
+// function depends on Win32, so the offline tools can use them as well.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Largest block LZ4CompressBlock writes for size input bytes, which is what incompressible
+// input grows to.
+size_t LZ4CompressBound(size_t size);
+
+// Returns the compressed size; dest must hold LZ4CompressBound(size) bytes.
+size_t LZ4CompressBlock(const uint8_t* src, size_t size, uint8_t* dest);
+
+// Decompresses a block that expands to exactly destSize bytes.  Returns false if the
+// block is malformed or doesn't come to destSize; nothing is read or written outside the
+// two buffers either way.
+bool LZ4DecompressBlock(const uint8_t* src, size_t srcSize, uint8_t* dest, size_t destSize);
@@ -0,0 +1,310 @@
+//***************************************************************************************
+// LightClusterBinner.cpp
+//***************************************************************************************
+
+#include "LightClusterBinner.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define LIGHTBINNER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Distance from v to the interval [lo, hi]; 0 inside it.
+	float DistanceOutside(float v, float lo, float hi)
+	{
+		return std::max(lo - v, 0.0f) + std::max(v - hi, 0.0f);
+	}
+}
+
+LightClusterBinner::LightClusterBinner(uint32_t tilesX, uint32_t tilesY, uint32_t slices)
+	: mTilesX(std::max(tilesX, 1u)),
+	  mTilesY(std::max(tilesY, 1u)),
+	  mSlices(std::max(slices, 1u))
+{
+	mColumnStride = (mTilesX + 3) & ~3u;
+	mClusterRanges.resize(GetClusterCount());
+}
+
+void LightClusterBinner::Resize(uint32_t width, uint32_t height, float proj00, float proj11, float nearZ, float farZ)
+{
+	mWidth = (float)std::max(width, 1u);
+	mHeight = (float)std::max(height, 1u);
+	mTileSizeX = ceilf(mWidth / mTilesX);
+	mTileSizeY = ceilf(mHeight / mTilesY);
+
+	mNearZ = nearZ;
+	mFarZ = farZ;
+	mProj00 = proj00;
+	mProj11 = proj11;
+
+	// slice = log(z/near) / log(far/near) * slices, rewritten as log(z)*scale - bias
+	// so the shader only needs one log per pixel.
+	float logRatio = logf(mFarZ / mNearZ);
+	mSliceScale = mSlices / logRatio;
+	mSliceBias = mSlices * logf(mNearZ) / logRatio;
+
+	// Padding columns get an empty interval so they never pass the test.
+	mColumnMinX.assign(mSlices * mColumnStride, FLT_MAX);
+	mColumnMaxX.assign(mSlices * mColumnStride, -FLT_MAX);
+	mRowMinY.resize(mSlices * mTilesY);
+	mRowMaxY.resize(mSlices * mTilesY);
+	mSliceNearZ.resize(mSlices);
+	mSliceFarZ.resize(mSlices);
+	mClusterRanges.assign(GetClusterCount(), ClusterRange());
+
+	for(uint32_t z = 0; z < mSlices; ++z)
+	{
+		float zn = mNearZ * powf(mFarZ / mNearZ, (float)z / mSlices);
+		float zf = mNearZ * powf(mFarZ / mNearZ, (float)(z + 1) / mSlices);
+		mSliceNearZ[z] = zn;
+		mSliceFarZ[z] = zf;
+
+		// The tile's side planes go through the eye, so the extremes of the cluster lie
+		// on its near and far faces.
+		for(uint32_t y = 0; y < mTilesY; ++y)
+		{
+			// Tiles count down from the top of the screen; NDC y points up.
+			float ndcTop = 1.0f - 2.0f * (y * mTileSizeY) / mHeight;
+			float ndcBottom = 1.0f - 2.0f * std::min((y + 1) * mTileSizeY, mHeight) / mHeight;
+
+			mRowMinY[z * mTilesY + y] = std::min({ ndcBottom * zn, ndcBottom * zf, ndcTop * zn, ndcTop * zf }) / mProj11;
+			mRowMaxY[z * mTilesY + y] = std::max({ ndcBottom * zn, ndcBottom * zf, ndcTop * zn, ndcTop * zf }) / mProj11;
+		}
+
+		for(uint32_t x = 0; x < mTilesX; ++x)
+		{
+			float ndcLeft = 2.0f * (x * mTileSizeX) / mWidth - 1.0f;
+			float ndcRight = 2.0f * std::min((x + 1) * mTileSizeX, mWidth) / mWidth - 1.0f;
+
+			mColumnMinX[z * mColumnStride + x] = std::min({ ndcLeft * zn, ndcLeft * zf, ndcRight * zn, ndcRight * zf }) / mProj00;
+			mColumnMaxX[z * mColumnStride + x] = std::max({ ndcLeft * zn, ndcLeft * zf, ndcRight * zn, ndcRight * zf }) / mProj00;
+		}
+	}
+}
+
+void LightClusterBinner::Build(const LightSphere* lights, uint32_t lightCount)
+{
+	mClusterRanges.assign(GetClusterCount(), ClusterRange());
+	mLightBoxes.resize(lightCount);
+	mHitMasks.clear();
+
+	// Test every light once, counting the hits per cluster and keeping the masks.
+	for(uint32_t lightIndex = 0; lightIndex < lightCount; ++lightIndex)
+	{
+		const LightSphere& light = lights[lightIndex];
+		LightBox& box = mLightBoxes[lightIndex];
+		box = ComputeLightBox(light);
+		if(!box.Visible)
+			continue;
+
+		float radiusSq = light.Radius * light.Radius;
+		for(uint32_t z = box.Z0; z <= box.Z1; ++z)
+		{
+			float dz = DistanceOutside(light.Z, mSliceNearZ[z], mSliceFarZ[z]);
+			for(uint32_t y = box.Y0; y <= box.Y1; ++y)
+			{
+				float dy = DistanceOutside(light.Y, mRowMinY[z * mTilesY + y], mRowMaxY[z * mTilesY + y]);
+				float rowDistSq = dy * dy + dz * dz;
+
+				ClusterRange* row = &mClusterRanges[(z * mTilesY + y) * mTilesX];
+				for(uint32_t group = box.X0 & ~3u; group <= box.X1; group += 4)
+				{
+					// Only the columns in the light's tile range count.
+					uint32_t mask = TestGroup(z, group, light.X, rowDistSq, radiusSq);
+					for(uint32_t i = 0; i < 4; ++i)
+					{
+						if(group + i < box.X0 || group + i > box.X1)
+							mask &= ~(1u << i);
+					}
+
+					mHitMasks.push_back((uint8_t)mask);
+					for(uint32_t i = 0; i < 4; ++i)
+					{
+						if(mask & (1u << i))
+							row[group + i].Count++;
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t offset = 0;
+	mWriteCursor.resize(GetClusterCount());
+	for(uint32_t i = 0; i < GetClusterCount(); ++i)
+	{
+		mClusterRanges[i].Offset = offset;
+		mWriteCursor[i] = offset;
+		offset += mClusterRanges[i].Count;
+	}
+
+	// Replay the masks in the same order to fill the index list.
+	mLightIndices.resize(offset);
+	const uint8_t* mask = mHitMasks.data();
+	for(uint32_t lightIndex = 0; lightIndex < lightCount; ++lightIndex)
+	{
+		const LightBox& box = mLightBoxes[lightIndex];
+		if(!box.Visible)
+			continue;
+
+		for(uint32_t z = box.Z0; z <= box.Z1; ++z)
+		{
+			for(uint32_t y = box.Y0; y <= box.Y1; ++y)
+			{
+				uint32_t* cursor = &mWriteCursor[(z * mTilesY + y) * mTilesX];
+				for(uint32_t group = box.X0 & ~3u; group <= box.X1; group += 4, ++mask)
+				{
+					for(uint32_t i = 0; i < 4; ++i)
+					{
+						if(*mask & (1u << i))
+							mLightIndices[cursor[group + i]++] = lightIndex;
+					}
+				}
+			}
+		}
+	}
+}
+
+uint32_t LightClusterBinner::GetTilesX()const
+{
+	return mTilesX;
+}
+
+uint32_t LightClusterBinner::GetTilesY()const
+{
+	return mTilesY;
+}
+
+uint32_t LightClusterBinner::GetSlices()const
+{
+	return mSlices;
+}
+
+uint32_t LightClusterBinner::GetClusterCount()const
+{
+	return mTilesX * mTilesY * mSlices;
+}
+
+float LightClusterBinner::GetTileSizeX()const
+{
+	return mTileSizeX;
+}
+
+float LightClusterBinner::GetTileSizeY()const
+{
+	return mTileSizeY;
+}
+
+float LightClusterBinner::GetSliceScale()const
+{
+	return mSliceScale;
+}
+
+float LightClusterBinner::GetSliceBias()const
+{
+	return mSliceBias;
+}
+
+const std::vector<ClusterRange>& LightClusterBinner::GetClusterRanges()const
+{
+	return mClusterRanges;
+}
+
+const std::vector<uint32_t>& LightClusterBinner::GetLightIndices()const
+{
+	return mLightIndices;
+}
+
+LightClusterBinner::LightBox LightClusterBinner::ComputeLightBox(const LightSphere& light)const
+{
+	LightBox box;
+
+	// Depth range test against the whole frustum.
+	float r = light.Radius;
+	if(light.Z + r < mNearZ || light.Z - r > mFarZ)
+		return box;
+
+	box.Z0 = ComputeSlice(std::max(light.Z - r, mNearZ));
+	box.Z1 = ComputeSlice(std::min(light.Z + r, mFarZ));
+	box.X1 = mTilesX - 1;
+	box.Y1 = mTilesY - 1;
+
+	// If the sphere is entirely in front of the eye, project its view-space box to get
+	// a conservative tile range.  x/z is monotonic in x and z, so the extremes are at
+	// the box corners.  Otherwise fall back to every tile in the slice range.
+	float zMin = light.Z - r;
+	float zMax = light.Z + r;
+	if(zMin > 0.0f)
+	{
+		float xMin = light.X - r;
+		float xMax = light.X + r;
+		float yMin = light.Y - r;
+		float yMax = light.Y + r;
+
+		float ndcMinX = mProj00 * (xMin < 0.0f ? xMin / zMin : xMin / zMax);
+		float ndcMaxX = mProj00 * (xMax > 0.0f ? xMax / zMin : xMax / zMax);
+		float ndcMinY = mProj11 * (yMin < 0.0f ? yMin / zMin : yMin / zMax);
+		float ndcMaxY = mProj11 * (yMax > 0.0f ? yMax / zMin : yMax / zMax);
+
+		if(ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f)
+			return box;
+
+		box.X0 = TileFromNdcX(ndcMinX);
+		box.X1 = TileFromNdcX(ndcMaxX);
+		box.Y0 = TileFromNdcY(ndcMaxY);
+		box.Y1 = TileFromNdcY(ndcMinY);
+	}
+
+	box.Visible = true;
+	return box;
+}
+
+uint32_t LightClusterBinner::TestGroup(uint32_t slice, uint32_t firstColumn, float centerX, float rowDistSq,
+	float radiusSq)const
+{
+	const float* minX = &mColumnMinX[slice * mColumnStride + firstColumn];
+	const float* maxX = &mColumnMaxX[slice * mColumnStride + firstColumn];
+
+	// Squared distance from the center to each cluster's box, compared with the radius.
+#ifdef LIGHTBINNER_USE_SSE2
+	__m128 zero = _mm_setzero_ps();
+	__m128 center = _mm_set1_ps(centerX);
+	__m128 dx = _mm_add_ps(
+		_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX), center), zero),
+		_mm_max_ps(_mm_sub_ps(center, _mm_loadu_ps(maxX)), zero));
+	__m128 distSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_set1_ps(rowDistSq));
+	return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(distSq, _mm_set1_ps(radiusSq)));
+#else
+	uint32_t mask = 0;
+	for(uint32_t i = 0; i < 4; ++i)
+	{
+		float dx = DistanceOutside(centerX, minX[i], maxX[i]);
+		if(dx * dx + rowDistSq <= radiusSq)
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
+uint32_t LightClusterBinner::ComputeSlice(float viewZ)const
+{
+	float slice = logf(viewZ) * mSliceScale - mSliceBias;
+	return (uint32_t)std::min(std::max(slice, 0.0f), (float)(mSlices - 1));
+}
+
+uint32_t LightClusterBinner::TileFromNdcX(float ndcX)const
+{
+	float px = (ndcX * 0.5f + 0.5f) * mWidth;
+	return (uint32_t)std::min(std::max(px / mTileSizeX, 0.0f), (float)(mTilesX - 1));
+}
+
+uint32_t LightClusterBinner::TileFromNdcY(float ndcY)const
+{
+	float py = (0.5f - ndcY * 0.5f) * mHeight;
+	return (uint32_t)std::min(std::max(py / mTileSizeY, 0.0f), (float)(mTilesY - 1));
+}
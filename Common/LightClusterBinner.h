@@ -0,0 +1,124 @@
+//***************************************************************************************
+// LightClusterBinner.h
+//
+// The light binning behind LightClusterGrid, on plain view space spheres.
+//   -Resize caches the view space bounds of every cluster.  A cluster's y and z bounds
+//    only depend on its row (tile row and depth slice) and its x bounds only on its
+//    column and slice, so they are kept per row and per column rather than per cluster.
+//   -Build tests each light against the clusters its projected bounds cover, four
+//    clusters of a row at a time with SSE where available.  The first pass counts the
+//    hits per cluster and keeps one 4-bit hit mask per group of four clusters tested;
+//    the second replays the masks to write the compact index list, so every test is
+//    done once and no (cluster, light) pairs are stored.
+//
+// Not thread safe.  No Direct3D dependencies.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Where a cluster's lights live in the light index list.  Mirrors uint2 in the shader.
+struct ClusterRange
+{
+	uint32_t Offset = 0;
+	uint32_t Count = 0;
+};
+
+// A light as the binner sees it: a sphere in view space (+z into the screen).
+struct LightSphere
+{
+	float X = 0.0f;
+	float Y = 0.0f;
+	float Z = 0.0f;
+	float Radius = 0.0f;
+};
+
+class LightClusterBinner
+{
+public:
+	LightClusterBinner(uint32_t tilesX = 16, uint32_t tilesY = 9, uint32_t slices = 24);
+
+	// Rebuilds the cached cluster bounds.  proj00 and proj11 are the x and y scales of
+	// the projection matrix.
+	void Resize(uint32_t width, uint32_t height, float proj00, float proj11, float nearZ, float farZ);
+
+	// Bins the lights into clusters; indices in GetLightIndices refer to lights[].
+	void Build(const LightSphere* lights, uint32_t lightCount);
+
+	uint32_t GetTilesX()const;
+	uint32_t GetTilesY()const;
+	uint32_t GetSlices()const;
+	uint32_t GetClusterCount()const;
+
+	// Parameters the shader needs to find the cluster of a pixel.
+	float GetTileSizeX()const;
+	float GetTileSizeY()const;
+	float GetSliceScale()const;
+	float GetSliceBias()const;
+
+	const std::vector<ClusterRange>& GetClusterRanges()const;
+	const std::vector<uint32_t>& GetLightIndices()const;
+
+private:
+	// The clusters a light may touch, from its depth range and projected bounds.
+	struct LightBox
+	{
+		bool Visible = false;
+		uint32_t X0 = 0;
+		uint32_t X1 = 0;
+		uint32_t Y0 = 0;
+		uint32_t Y1 = 0;
+		uint32_t Z0 = 0;
+		uint32_t Z1 = 0;
+	};
+
+	// Not Visible if the light is outside the frustum.
+	LightBox ComputeLightBox(const LightSphere& light)const;
+
+	// Bit i is set if the sphere touches the cluster in column firstColumn + i.  rowDistSq
+	// is the squared distance from the center to the row's y and z bounds.
+	uint32_t TestGroup(uint32_t slice, uint32_t firstColumn, float centerX, float rowDistSq, float radiusSq)const;
+
+	uint32_t ComputeSlice(float viewZ)const;
+	uint32_t TileFromNdcX(float ndcX)const;
+	uint32_t TileFromNdcY(float ndcY)const;
+
+private:
+	uint32_t mTilesX = 0;
+	uint32_t mTilesY = 0;
+	uint32_t mSlices = 0;
+
+	// mTilesX rounded up to a whole number of groups of four.
+	uint32_t mColumnStride = 0;
+
+	float mWidth = 1.0f;
+	float mHeight = 1.0f;
+	float mTileSizeX = 1.0f;
+	float mTileSizeY = 1.0f;
+
+	float mNearZ = 1.0f;
+	float mFarZ = 1000.0f;
+	float mProj00 = 1.0f;
+	float mProj11 = 1.0f;
+	float mSliceScale = 0.0f;
+	float mSliceBias = 0.0f;
+
+	// View space bounds: x indexed by slice*mColumnStride + x, with the padding columns
+	// empty; y by slice*mTilesY + y; z by slice.
+	std::vector<float> mColumnMinX;
+	std::vector<float> mColumnMaxX;
+	std::vector<float> mRowMinY;
+	std::vector<float> mRowMaxY;
+	std::vector<float> mSliceNearZ;
+	std::vector<float> mSliceFarZ;
+
+	std::vector<ClusterRange> mClusterRanges;
+	std::vector<uint32_t> mLightIndices;
+
+	// Scratch storage reused between builds.
+	std::vector<LightBox> mLightBoxes;
+	std::vector<uint8_t> mHitMasks;
+	std::vector<uint32_t> mWriteCursor;
+};
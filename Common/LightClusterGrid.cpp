@@ -0,0 +1,109 @@
+//***************************************************************************************
+// LightClusterGrid.cpp
+//***************************************************************************************
+
+#include "LightClusterGrid.h"
+
+#include <chrono>
+
+using namespace DirectX;
+
+LightClusterGrid::LightClusterGrid(UINT tilesX, UINT tilesY, UINT slices)
+	: mBinner(tilesX, tilesY, slices)
+{
+}
+
+void LightClusterGrid::Resize(UINT width, UINT height, const XMFLOAT4X4& proj, float nearZ, float farZ)
+{
+	mBinner.Resize(width, height, proj(0, 0), proj(1, 1), nearZ, farZ);
+}
+
+void LightClusterGrid::Build(const XMFLOAT4X4& viewMatrix,
+	const Light* pointLights, UINT numPointLights,
+	const Light* spotLights, UINT numSpotLights)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	mPointLightCount = numPointLights;
+	mLights.assign(pointLights, pointLights + numPointLights);
+	mLights.insert(mLights.end(), spotLights, spotLights + numSpotLights);
+
+	XMMATRIX view = XMLoadFloat4x4(&viewMatrix);
+
+	mSpheres.resize(mLights.size());
+	for(size_t i = 0; i < mLights.size(); ++i)
+	{
+		XMFLOAT3 c;
+		XMStoreFloat3(&c, XMVector3TransformCoord(XMLoadFloat3(&mLights[i].Position), view));
+
+		mSpheres[i].X = c.x;
+		mSpheres[i].Y = c.y;
+		mSpheres[i].Z = c.z;
+		mSpheres[i].Radius = mLights[i].FalloffEnd;
+	}
+
+	mBinner.Build(mSpheres.data(), (uint32_t)mSpheres.size());
+
+	mLastBuildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+UINT LightClusterGrid::GetTilesX()const
+{
+	return mBinner.GetTilesX();
+}
+
+UINT LightClusterGrid::GetTilesY()const
+{
+	return mBinner.GetTilesY();
+}
+
+UINT LightClusterGrid::GetSlices()const
+{
+	return mBinner.GetSlices();
+}
+
+UINT LightClusterGrid::GetClusterCount()const
+{
+	return mBinner.GetClusterCount();
+}
+
+XMFLOAT2 LightClusterGrid::GetTileSize()const
+{
+	return XMFLOAT2(mBinner.GetTileSizeX(), mBinner.GetTileSizeY());
+}
+
+float LightClusterGrid::GetSliceScale()const
+{
+	return mBinner.GetSliceScale();
+}
+
+float LightClusterGrid::GetSliceBias()const
+{
+	return mBinner.GetSliceBias();
+}
+
+UINT LightClusterGrid::GetPointLightCount()const
+{
+	return mPointLightCount;
+}
+
+const std::vector<Light>& LightClusterGrid::GetLights()const
+{
+	return mLights;
+}
+
+const std::vector<ClusterRange>& LightClusterGrid::GetClusterRanges()const
+{
+	return mBinner.GetClusterRanges();
+}
+
+const std::vector<uint32_t>& LightClusterGrid::GetLightIndices()const
+{
+	return mBinner.GetLightIndices();
+}
+
+double LightClusterGrid::GetLastBuildMs()const
+{
+	return mLastBuildMs;
+}
@@ -0,0 +1,61 @@
+//***************************************************************************************
+// LightClusterGrid.h
+//
+// Clustered forward light assignment done on the CPU.
+//   -The view frustum is split into screen tiles and exponentially spaced depth slices
+//    ("froxels").  The view-space bounds of every cluster are cached on Resize.
+//   -Build bins point and spot lights, treated as spheres of radius FalloffEnd, into the
+//    clusters they touch and produces a compact light index list per cluster.
+//   -The pixel shader looks up its cluster and only loops over those lights, so the
+//    number of lights in the scene is no longer capped by the pass constant buffer.
+// The binning itself is done by LightClusterBinner on the lights' view space spheres.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "LightClusterBinner.h"
+
+class LightClusterGrid
+{
+public:
+	LightClusterGrid(UINT tilesX = 16, UINT tilesY = 9, UINT slices = 24);
+
+	// Rebuilds the cached cluster bounds.  Call whenever the viewport or projection changes.
+	void Resize(UINT width, UINT height, const DirectX::XMFLOAT4X4& proj, float nearZ, float farZ);
+
+	// Bins the lights into clusters.  Lights are stored point lights first, then spot
+	// lights, and indices in GetLightIndices refer to that combined list.
+	void Build(const DirectX::XMFLOAT4X4& view,
+		const Light* pointLights, UINT numPointLights,
+		const Light* spotLights, UINT numSpotLights);
+
+	UINT GetTilesX()const;
+	UINT GetTilesY()const;
+	UINT GetSlices()const;
+	UINT GetClusterCount()const;
+
+	// Parameters the shader needs to find the cluster of a pixel.
+	DirectX::XMFLOAT2 GetTileSize()const;
+	float GetSliceScale()const;
+	float GetSliceBias()const;
+
+	UINT GetPointLightCount()const;
+	const std::vector<Light>& GetLights()const;
+	const std::vector<ClusterRange>& GetClusterRanges()const;
+	const std::vector<uint32_t>& GetLightIndices()const;
+
+	// CPU time spent in the last call to Build.
+	double GetLastBuildMs()const;
+
+private:
+	LightClusterBinner mBinner;
+
+	UINT mPointLightCount = 0;
+	std::vector<Light> mLights;
+
+	// The lights in view space, reused between builds.
+	std::vector<LightSphere> mSpheres;
+
+	double mLastBuildMs = 0.0;
+};
@@ -0,0 +1,189 @@
+//***************************************************************************************
+// LightStore.cpp
+//***************************************************************************************
+
+#include "LightStore.h"
+
+using namespace DirectX;
+
+LightStore::LightStore()
+{
+}
+
+void LightStore::LoadFromFile(const std::wstring& filename)
+{
+	std::ifstream fin(filename);
+	if(!fin)
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+	Clear();
+
+	std::string line;
+	while(std::getline(fin, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream tokens(line);
+		std::string typeName;
+		if(!(tokens >> typeName))
+			continue;
+
+		if(typeName == "ambient")
+		{
+			XMFLOAT4 ambient;
+			if(!(tokens >> ambient.x >> ambient.y >> ambient.z >> ambient.w))
+				ThrowIfFailed(E_INVALIDARG);
+
+			SetAmbient(ambient);
+			continue;
+		}
+
+		LightType type;
+		if(typeName == "directional")
+			type = LightType::Directional;
+		else if(typeName == "point")
+			type = LightType::Point;
+		else if(typeName == "spot")
+			type = LightType::Spot;
+		else
+			ThrowIfFailed(E_INVALIDARG);
+
+		Light light;
+		std::string key;
+		while(tokens >> key)
+		{
+			bool ok = true;
+			if(key == "strength")
+				ok = (bool)(tokens >> light.Strength.x >> light.Strength.y >> light.Strength.z);
+			else if(key == "direction")
+				ok = (bool)(tokens >> light.Direction.x >> light.Direction.y >> light.Direction.z);
+			else if(key == "position")
+				ok = (bool)(tokens >> light.Position.x >> light.Position.y >> light.Position.z);
+			else if(key == "falloff")
+				ok = (bool)(tokens >> light.FalloffStart >> light.FalloffEnd);
+			else if(key == "spotpower")
+				ok = (bool)(tokens >> light.SpotPower);
+			else
+				ok = false;
+
+			if(!ok)
+				ThrowIfFailed(E_INVALIDARG);
+		}
+
+		Add(type, light);
+	}
+}
+
+void LightStore::Clear()
+{
+	mAmbient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	mTypes.clear();
+	mPositions.clear();
+	mDirections.clear();
+	mStrengths.clear();
+	mFalloffStarts.clear();
+	mFalloffEnds.clear();
+	mSpotPowers.clear();
+
+	mVersion++;
+}
+
+UINT LightStore::Add(LightType type, const Light& light)
+{
+	mTypes.push_back(type);
+	mPositions.push_back(light.Position);
+	mDirections.push_back(light.Direction);
+	mStrengths.push_back(light.Strength);
+	mFalloffStarts.push_back(light.FalloffStart);
+	mFalloffEnds.push_back(light.FalloffEnd);
+	mSpotPowers.push_back(light.SpotPower);
+
+	mVersion++;
+
+	return (UINT)mTypes.size() - 1;
+}
+
+UINT LightStore::GetCount()const
+{
+	return (UINT)mTypes.size();
+}
+
+LightType LightStore::GetType(UINT index)const
+{
+	return mTypes[index];
+}
+
+XMFLOAT4 LightStore::GetAmbient()const
+{
+	return mAmbient;
+}
+
+XMFLOAT3 LightStore::GetPosition(UINT index)const
+{
+	return mPositions[index];
+}
+
+XMFLOAT3 LightStore::GetDirection(UINT index)const
+{
+	return mDirections[index];
+}
+
+XMFLOAT3 LightStore::GetStrength(UINT index)const
+{
+	return mStrengths[index];
+}
+
+void LightStore::SetAmbient(const XMFLOAT4& ambient)
+{
+	mAmbient = ambient;
+	mVersion++;
+}
+
+void LightStore::SetPosition(UINT index, const XMFLOAT3& position)
+{
+	mPositions[index] = position;
+	mVersion++;
+}
+
+void LightStore::SetDirection(UINT index, const XMFLOAT3& direction)
+{
+	mDirections[index] = direction;
+	mVersion++;
+}
+
+void LightStore::SetStrength(UINT index, const XMFLOAT3& strength)
+{
+	mStrengths[index] = strength;
+	mVersion++;
+}
+
+void LightStore::SetFalloff(UINT index, float falloffStart, float falloffEnd)
+{
+	mFalloffStarts[index] = falloffStart;
+	mFalloffEnds[index] = falloffEnd;
+	mVersion++;
+}
+
+UINT64 LightStore::GetVersion()const
+{
+	return mVersion;
+}
+
+void LightStore::Gather(LightType type, std::vector<Light>& out)const
+{
+	for(UINT i = 0; i < (UINT)mTypes.size(); ++i)
+	{
+		if(mTypes[i] != type)
+			continue;
+
+		Light light;
+		light.Strength = mStrengths[i];
+		light.FalloffStart = mFalloffStarts[i];
+		light.Direction = mDirections[i];
+		light.FalloffEnd = mFalloffEnds[i];
+		light.Position = mPositions[i];
+		light.SpotPower = mSpotPowers[i];
+		out.push_back(light);
+	}
+}
@@ -0,0 +1,73 @@
+//***************************************************************************************
+// LightStore.h
+//
+// Scene lights stored as parallel arrays (positions, directions, strengths, falloffs)
+// instead of one Light struct per entry, loaded from a small text scene file.
+//   -Every edit bumps a version number, so consumers can tell cheaply whether anything
+//    changed since they last looked and skip re-uploading light data otherwise.
+//   -Gather converts the lights of one type back to the shader's Light layout.
+//
+// Scene file format, one entry per line ('#' starts a comment):
+//   ambient     r g b a
+//   directional strength r g b  direction x y z
+//   point       strength r g b  position x y z  [falloff start end]
+//   spot        strength r g b  position x y z  direction x y z  [spotpower p]  [falloff start end]
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+enum class LightType : int
+{
+	Directional = 0,
+	Point,
+	Spot
+};
+
+class LightStore
+{
+public:
+	LightStore();
+
+	// Replaces the contents of the store with the lights in a scene file.
+	void LoadFromFile(const std::wstring& filename);
+
+	void Clear();
+
+	// Appends a light and returns its index.
+	UINT Add(LightType type, const Light& light);
+
+	UINT GetCount()const;
+	LightType GetType(UINT index)const;
+
+	DirectX::XMFLOAT4 GetAmbient()const;
+	DirectX::XMFLOAT3 GetPosition(UINT index)const;
+	DirectX::XMFLOAT3 GetDirection(UINT index)const;
+	DirectX::XMFLOAT3 GetStrength(UINT index)const;
+
+	void SetAmbient(const DirectX::XMFLOAT4& ambient);
+	void SetPosition(UINT index, const DirectX::XMFLOAT3& position);
+	void SetDirection(UINT index, const DirectX::XMFLOAT3& direction);
+	void SetStrength(UINT index, const DirectX::XMFLOAT3& strength);
+	void SetFalloff(UINT index, float falloffStart, float falloffEnd);
+
+	// Incremented by every change to the store.
+	UINT64 GetVersion()const;
+
+	// Appends every light of the given type to out, in the order they were added.
+	void Gather(LightType type, std::vector<Light>& out)const;
+
+private:
+	DirectX::XMFLOAT4 mAmbient = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	std::vector<LightType> mTypes;
+	std::vector<DirectX::XMFLOAT3> mPositions;
+	std::vector<DirectX::XMFLOAT3> mDirections;
+	std::vector<DirectX::XMFLOAT3> mStrengths;
+	std::vector<float> mFalloffStarts;
+	std::vector<float> mFalloffEnds;
+	std::vector<float> mSpotPowers;
+
+	UINT64 mVersion = 0;
+};
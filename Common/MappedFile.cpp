@@ -0,0 +1,164 @@
+//***************************************************************************************
+// MappedFile.cpp
+//***************************************************************************************
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cwchar>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	// Close the handles without losing the error that made us give up.
+	auto fail = [this](DWORD error)
+	{
+		Close();
+		SetLastError(error);
+		return false;
+	};
+
+	HANDLE file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+	mFile = file;
+
+	LARGE_INTEGER fileSize = {};
+	if(!GetFileSizeEx(file, &fileSize))
+		return fail(GetLastError());
+
+	// Empty files can't be mapped, and a 32-bit process can't view more than SIZE_MAX.
+	if(fileSize.QuadPart == 0 || (uint64_t)fileSize.QuadPart > (uint64_t)SIZE_MAX)
+		return fail(ERROR_FILE_INVALID);
+
+	mMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mMapping == nullptr)
+		return fail(GetLastError());
+
+	mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if(mData == nullptr)
+		return fail(GetLastError());
+
+	mSize = (uint64_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		UnmapViewOfFile(mData);
+	if(mMapping != nullptr)
+		CloseHandle(mMapping);
+	if(mFile != nullptr)
+		CloseHandle(mFile);
+
+	mData = nullptr;
+	mMapping = nullptr;
+	mFile = nullptr;
+	mSize = 0;
+}
+
+#else
+
+std::string NarrowPath(const wchar_t* fileName)
+{
+	std::mbstate_t state = std::mbstate_t();
+	const wchar_t* src = fileName;
+	size_t length = std::wcsrtombs(nullptr, &src, 0, &state);
+	if(length == (size_t)-1)
+		return std::string();
+
+	std::string path(length, '\0');
+	src = fileName;
+	std::wcsrtombs(&path[0], &src, length, &state);
+	return path;
+}
+
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	std::string path = NarrowPath(fileName);
+	if(path.empty())
+		return false;
+
+	// Close the descriptor without losing the error that made us give up.
+	auto fail = [](int fd, int error)
+	{
+		close(fd);
+		errno = error;
+		return false;
+	};
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0)
+		return fail(fd, errno);
+
+	// Empty files can't be mapped, and a 32-bit process can't view more than SIZE_MAX.
+	if(info.st_size == 0 || (uint64_t)info.st_size > (uint64_t)SIZE_MAX)
+		return fail(fd, EINVAL);
+
+	void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED)
+		return fail(fd, errno);
+
+	// The mapping keeps its own reference to the file.
+	close(fd);
+
+	madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	mData = static_cast<const uint8_t*>(data);
+	mSize = (uint64_t)info.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		munmap(const_cast<uint8_t*>(mData), (size_t)mSize);
+
+	mData = nullptr;
+	mSize = 0;
+}
+
+#endif
+
+bool MappedFile::IsOpen()const
+{
+	return mData != nullptr;
+}
+
+const uint8_t* MappedFile::GetData()const
+{
+	return mData;
+}
+
+uint64_t MappedFile::GetSize()const
+{
+	return mSize;
+}
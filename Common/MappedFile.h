@@ -0,0 +1,49 @@
+//***************************************************************************************
+// MappedFile.h
+//
+// Read-only memory mapping of a whole file: MapViewOfFile on Windows, mmap elsewhere.
+// The file contents are paged in on demand instead of being copied into a heap buffer,
+// and sizes are 64-bit.  The view stays valid until Close or destruction.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#ifndef _WIN32
+#include <string>
+#endif
+
+class MappedFile
+{
+public:
+	MappedFile();
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	~MappedFile();
+
+	// Returns false if the file could not be opened or mapped.  On Windows the reason is
+	// left in GetLastError(), elsewhere in errno.
+	bool Open(const wchar_t* fileName);
+	void Close();
+
+	bool IsOpen()const;
+	const uint8_t* GetData()const;
+	uint64_t GetSize()const;
+
+private:
+	const uint8_t* mData = nullptr;
+	uint64_t mSize = 0;
+
+#ifdef _WIN32
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
+
+#ifndef _WIN32
+// fileName in the locale's multibyte encoding, for the POSIX calls: paths are passed
+// around as wide strings to match the Windows side.  Empty if it can't be converted.
+std::string NarrowPath(const wchar_t* fileName);
+#endif
@@ -0,0 +1,208 @@
+//***************************************************************************************
+// MaterialAnimator.cpp
+//***************************************************************************************
+
+#include "MaterialAnimator.h"
+
+#include <chrono>
+
+using namespace DirectX;
+
+void MaterialAnimator::AddLinearTrack(Material* material, MaterialChannel channel,
+	const XMFLOAT4& base, const XMFLOAT4& rate)
+{
+	mLinearTargets.push_back(material);
+	mLinearChannels.push_back(channel);
+	mLinearBase.push_back(XMFLOAT4A(base.x, base.y, base.z, base.w));
+	mLinearRate.push_back(XMFLOAT4A(rate.x, rate.y, rate.z, rate.w));
+	mLinearValues.push_back(XMFLOAT4A(base.x, base.y, base.z, base.w));
+
+	mStats.TrackCount = GetTrackCount();
+}
+
+void MaterialAnimator::AddKeyframeTrack(Material* material, MaterialChannel channel,
+	const std::vector<MaterialKey>& keys, bool loop)
+{
+	if(keys.empty())
+		ThrowIfFailed(E_INVALIDARG);
+
+	// SampleKeys divides by the time between neighbouring keys.
+	for(size_t i = 1; i < keys.size(); ++i)
+	{
+		if(!(keys[i].Time > keys[i - 1].Time))
+			ThrowIfFailed(E_INVALIDARG);
+	}
+
+	mKeyedTargets.push_back(material);
+	mKeyedChannels.push_back(channel);
+	mKeyBegin.push_back((UINT)mKeyTimes.size());
+	mKeyCount.push_back((UINT)keys.size());
+	mKeyLoop.push_back(loop);
+	mKeyCursor.push_back(0);
+	mKeyedValues.push_back(XMFLOAT4A(keys[0].Value.x, keys[0].Value.y, keys[0].Value.z, keys[0].Value.w));
+
+	for(const auto& key : keys)
+	{
+		mKeyTimes.push_back(key.Time);
+		mKeyValues.push_back(XMFLOAT4A(key.Value.x, key.Value.y, key.Value.z, key.Value.w));
+	}
+
+	mStats.TrackCount = GetTrackCount();
+}
+
+void MaterialAnimator::Clear()
+{
+	mLinearTargets.clear();
+	mLinearChannels.clear();
+	mLinearBase.clear();
+	mLinearRate.clear();
+	mLinearValues.clear();
+
+	mKeyedTargets.clear();
+	mKeyedChannels.clear();
+	mKeyBegin.clear();
+	mKeyCount.clear();
+	mKeyLoop.clear();
+	mKeyCursor.clear();
+	mKeyedValues.clear();
+	mKeyTimes.clear();
+	mKeyValues.clear();
+
+	mStats.TrackCount = 0;
+}
+
+void MaterialAnimator::Evaluate(float totalTime)
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	// Evaluate all the tracks first, touching only the track arrays...
+	XMVECTOR t = XMVectorReplicate(totalTime);
+	for(size_t i = 0; i < mLinearBase.size(); ++i)
+	{
+		XMVECTOR base = XMLoadFloat4A(&mLinearBase[i]);
+		XMVECTOR rate = XMLoadFloat4A(&mLinearRate[i]);
+		XMStoreFloat4A(&mLinearValues[i], XMVectorMultiplyAdd(rate, t, base));
+	}
+
+	for(UINT i = 0; i < (UINT)mKeyedValues.size(); ++i)
+		XMStoreFloat4A(&mKeyedValues[i], SampleKeys(i, totalTime));
+
+	// ...then write them to the materials.
+	mTouched.clear();
+	for(size_t i = 0; i < mLinearTargets.size(); ++i)
+	{
+		if(Apply(mLinearTargets[i], mLinearChannels[i], XMLoadFloat4A(&mLinearValues[i])))
+			mTouched.push_back(mLinearTargets[i]);
+	}
+
+	for(size_t i = 0; i < mKeyedTargets.size(); ++i)
+	{
+		if(Apply(mKeyedTargets[i], mKeyedChannels[i], XMLoadFloat4A(&mKeyedValues[i])))
+			mTouched.push_back(mKeyedTargets[i]);
+	}
+
+	// Several tracks may drive the same material.
+	std::sort(mTouched.begin(), mTouched.end());
+	mStats.MaterialsTouched = (UINT)(std::unique(mTouched.begin(), mTouched.end()) - mTouched.begin());
+
+	mStats.LastEvaluateMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+UINT MaterialAnimator::GetTrackCount()const
+{
+	return (UINT)(mLinearTargets.size() + mKeyedTargets.size());
+}
+
+const MaterialAnimatorStats& MaterialAnimator::GetStats()const
+{
+	return mStats;
+}
+
+XMVECTOR MaterialAnimator::SampleKeys(UINT track, float t)
+{
+	const float* times = &mKeyTimes[mKeyBegin[track]];
+	const XMFLOAT4A* values = &mKeyValues[mKeyBegin[track]];
+	UINT count = mKeyCount[track];
+
+	float duration = times[count - 1];
+	if(mKeyLoop[track] && duration > 0.0f)
+		t = fmodf(t, duration);
+
+	if(count == 1 || t <= times[0])
+		return XMLoadFloat4A(&values[0]);
+	if(t >= duration)
+		return XMLoadFloat4A(&values[count - 1]);
+
+	// Time usually moves forward a little each frame, so start from the last segment.
+	UINT k = mKeyCursor[track];
+	if(k >= count - 1 || times[k] > t)
+		k = 0;
+	while(times[k + 1] < t)
+		++k;
+	mKeyCursor[track] = k;
+
+	float s = (t - times[k]) / (times[k + 1] - times[k]);
+	return XMVectorLerp(XMLoadFloat4A(&values[k]), XMLoadFloat4A(&values[k + 1]), s);
+}
+
+bool MaterialAnimator::Apply(Material* material, MaterialChannel channel, FXMVECTOR value)
+{
+	XMVECTOR current;
+	XMVECTOR mask;
+	switch(channel)
+	{
+	case MaterialChannel::TexOffset:
+		current = XMVectorSet(material->MatTransform(3, 0), material->MatTransform(3, 1), 0.0f, 0.0f);
+		mask = g_XMSelect1100;
+		break;
+	case MaterialChannel::TexScale:
+		current = XMVectorSet(material->MatTransform(0, 0), material->MatTransform(1, 1), 0.0f, 0.0f);
+		mask = g_XMSelect1100;
+		break;
+	case MaterialChannel::DiffuseAlbedo:
+		current = XMLoadFloat4(&material->DiffuseAlbedo);
+		mask = g_XMSelect1111;
+		break;
+	case MaterialChannel::FresnelR0:
+		current = XMLoadFloat3(&material->FresnelR0);
+		mask = g_XMSelect1110;
+		break;
+	default:
+		current = XMVectorSetX(XMVectorZero(), material->Roughness);
+		mask = g_XMSelect1000;
+		break;
+	}
+
+	// Lanes the channel doesn't use keep their current value, so they compare equal.
+	XMVECTOR result = XMVectorSelect(current, value, mask);
+	if(XMVector4Equal(result, current))
+		return false;
+
+	XMFLOAT4 v;
+	XMStoreFloat4(&v, result);
+	switch(channel)
+	{
+	case MaterialChannel::TexOffset:
+		material->MatTransform(3, 0) = v.x;
+		material->MatTransform(3, 1) = v.y;
+		break;
+	case MaterialChannel::TexScale:
+		material->MatTransform(0, 0) = v.x;
+		material->MatTransform(1, 1) = v.y;
+		break;
+	case MaterialChannel::DiffuseAlbedo:
+		material->DiffuseAlbedo = v;
+		break;
+	case MaterialChannel::FresnelR0:
+		material->FresnelR0 = XMFLOAT3(v.x, v.y, v.z);
+		break;
+	default:
+		material->Roughness = v.x;
+		break;
+	}
+
+	// Material has changed, so need to update cbuffer.
+	material->NumFramesDirty = gNumFrameResources;
+	return true;
+}
@@ -0,0 +1,91 @@
+//***************************************************************************************
+// MaterialAnimator.h
+//
+// Animates material constants from tracks instead of hand-written per-material code.
+//   -A linear track drives a channel as base + rate*t.
+//   -A keyframe track interpolates linearly between keys, optionally looping.
+//   -Tracks are stored in contiguous arrays and evaluated as one batch of XMVECTORs
+//    per frame, then written back to the materials.
+//   -A material is only marked dirty (NumFramesDirty) if a track actually changed it.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+enum class MaterialChannel : int
+{
+	TexOffset = 0,	// MatTransform translation (u, v).
+	TexScale,		// MatTransform scale (u, v).
+	DiffuseAlbedo,	// rgba
+	FresnelR0,		// rgb
+	Roughness		// x
+};
+
+struct MaterialKey
+{
+	float Time = 0.0f;
+	DirectX::XMFLOAT4 Value = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+struct MaterialAnimatorStats
+{
+	// CPU time of the last Evaluate call.
+	double LastEvaluateMs = 0.0;
+
+	UINT TrackCount = 0;
+	UINT MaterialsTouched = 0;
+};
+
+class MaterialAnimator
+{
+public:
+	MaterialAnimator() = default;
+
+	// The value is base + rate*t, with t the total time passed to Evaluate.
+	void AddLinearTrack(Material* material, MaterialChannel channel,
+		const DirectX::XMFLOAT4& base, const DirectX::XMFLOAT4& rate);
+
+	// Key times must strictly increase; keys that are empty, out of order or share a time
+	// throw.  A looping track repeats with a period equal to the time of its last key;
+	// otherwise it holds the last value.
+	void AddKeyframeTrack(Material* material, MaterialChannel channel,
+		const std::vector<MaterialKey>& keys, bool loop);
+
+	void Clear();
+
+	// Evaluates every track at totalTime and writes the results to the materials.
+	void Evaluate(float totalTime);
+
+	UINT GetTrackCount()const;
+	const MaterialAnimatorStats& GetStats()const;
+
+private:
+	DirectX::XMVECTOR SampleKeys(UINT track, float t);
+	bool Apply(Material* material, MaterialChannel channel, DirectX::FXMVECTOR value);
+
+private:
+	// Linear tracks.
+	std::vector<Material*> mLinearTargets;
+	std::vector<MaterialChannel> mLinearChannels;
+	std::vector<DirectX::XMFLOAT4A> mLinearBase;
+	std::vector<DirectX::XMFLOAT4A> mLinearRate;
+	std::vector<DirectX::XMFLOAT4A> mLinearValues;
+
+	// Keyframe tracks; the keys of all tracks share one pair of arrays.
+	std::vector<Material*> mKeyedTargets;
+	std::vector<MaterialChannel> mKeyedChannels;
+	std::vector<UINT> mKeyBegin;
+	std::vector<UINT> mKeyCount;
+	std::vector<bool> mKeyLoop;
+	std::vector<UINT> mKeyCursor;
+	std::vector<DirectX::XMFLOAT4A> mKeyedValues;
+
+	std::vector<float> mKeyTimes;
+	std::vector<DirectX::XMFLOAT4A> mKeyValues;
+
+	// Materials already counted as touched this frame.
+	std::vector<Material*> mTouched;
+
+	MaterialAnimatorStats mStats;
+};
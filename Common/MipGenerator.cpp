@@ -0,0 +1,448 @@
+//***************************************************************************************
+// MipGenerator.cpp
+//***************************************************************************************
+
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIPGEN_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	const float Pi = 3.1415926535f;
+
+	// Kaiser window: half width in destination texels, and its shape parameter.
+	const float KaiserWidth = 3.0f;
+	const float KaiserAlpha = 4.0f;
+
+	// Roughly how many texels one task filters.
+	const uint32_t TexelsPerTask = 16384;
+
+	// The taps of a 1D resampling filter, TapCount of them per destination texel.  Indices
+	// are clamped to the source, so edge texels repeat; unused taps have zero weight.
+	struct FilterTaps
+	{
+		uint32_t TapCount = 0;
+		std::vector<uint32_t> Index;
+		std::vector<float> Weight;
+	};
+
+	bool IsSRGB(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ||
+			format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+			format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+	}
+
+	float DecodeSrgbValue(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	// Byte to linear value, the linear values halfway between consecutive bytes, and for
+	// each 1/4096 step of linear value, the byte at its start.
+	struct ColorTables
+	{
+		float SrgbToLinear[256];
+		float LinearToSrgb[255];
+		uint8_t FirstByte[4097];
+
+		ColorTables()
+		{
+			for(int i = 0; i < 256; ++i)
+				SrgbToLinear[i] = DecodeSrgbValue(i / 255.0f);
+
+			for(int i = 0; i < 255; ++i)
+				LinearToSrgb[i] = DecodeSrgbValue((i + 0.5f) / 255.0f);
+
+			int byte = 0;
+			for(int j = 0; j <= 4096; ++j)
+			{
+				while(byte < 255 && LinearToSrgb[byte] < j / 4096.0f)
+					++byte;
+				FirstByte[j] = (uint8_t)byte;
+			}
+		}
+	};
+
+	const ColorTables& GetColorTables()
+	{
+		static const ColorTables tables;
+		return tables;
+	}
+
+	// The byte whose linear value is nearest in sRGB, for v in [0, 1].  The table gets
+	// within a step or two, and the thresholds settle it exactly.
+	inline uint8_t EncodeSrgb(const ColorTables& tables, float v)
+	{
+		int byte = tables.FirstByte[(int)(v*4096.0f)];
+		while(byte < 255 && tables.LinearToSrgb[byte] < v)
+			++byte;
+		return (uint8_t)byte;
+	}
+
+	uint8_t EncodeUnorm(float v)
+	{
+		return (uint8_t)(std::min(std::max(v, 0.0f), 1.0f)*255.0f + 0.5f);
+	}
+
+	float BesselI0(float x)
+	{
+		// Power series; converges quickly for the small arguments used here.
+		float sum = 1.0f;
+		float term = 1.0f;
+		for(int k = 1; k < 20; ++k)
+		{
+			term *= (x*0.5f / k)*(x*0.5f / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	float KaiserSinc(float t)
+	{
+		if(std::fabs(t) >= KaiserWidth)
+			return 0.0f;
+
+		float u = t / KaiserWidth;
+		float window = BesselI0(KaiserAlpha*std::sqrt(1.0f - u*u)) / BesselI0(KaiserAlpha);
+		float sinc = t == 0.0f ? 1.0f : std::sin(Pi*t) / (Pi*t);
+		return sinc*window;
+	}
+
+	FilterTaps BuildFilterTaps(MipFilter filter, uint32_t srcSize, uint32_t dstSize)
+	{
+		float scale = (float)srcSize / (float)dstSize;
+		float radius = filter == MipFilter::Box ? 0.5f*scale : KaiserWidth*scale;
+
+		FilterTaps taps;
+		taps.TapCount = (uint32_t)std::ceil(2.0f*radius) + 1;
+		taps.Index.resize((size_t)dstSize*taps.TapCount);
+		taps.Weight.resize((size_t)dstSize*taps.TapCount);
+
+		for(uint32_t x = 0; x < dstSize; ++x)
+		{
+			uint32_t* index = &taps.Index[(size_t)x*taps.TapCount];
+			float* weight = &taps.Weight[(size_t)x*taps.TapCount];
+
+			float center = (x + 0.5f)*scale;
+			int first = (int)std::floor(center - radius);
+
+			float total = 0.0f;
+			for(uint32_t k = 0; k < taps.TapCount; ++k)
+			{
+				int i = first + (int)k;
+
+				float w;
+				if(filter == MipFilter::Box)
+				{
+					// The part of texel i inside [x*scale, (x + 1)*scale].
+					float lo = std::max((float)i, x*scale);
+					float hi = std::min((float)(i + 1), (x + 1)*scale);
+					w = std::max(hi - lo, 0.0f);
+				}
+				else
+				{
+					w = KaiserSinc((i + 0.5f - center) / scale);
+				}
+
+				index[k] = (uint32_t)std::min(std::max(i, 0), (int)srcSize - 1);
+				weight[k] = w;
+				total += w;
+			}
+
+			for(uint32_t k = 0; k < taps.TapCount; ++k)
+				weight[k] /= total;
+		}
+
+		return taps;
+	}
+
+	// dst = sum of weight[k]*src[index[k]] over whole RGBA texels.
+	inline void FilterTexel(const float* src, const uint32_t* index, const float* weight,
+		uint32_t tapCount, float* dst)
+	{
+#ifdef MIPGEN_USE_SSE2
+		__m128 sum = _mm_setzero_ps();
+		for(uint32_t k = 0; k < tapCount; ++k)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src + index[k]*4), _mm_set1_ps(weight[k])));
+		_mm_storeu_ps(dst, sum);
+#else
+		float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for(uint32_t k = 0; k < tapCount; ++k)
+		{
+			const float* texel = src + index[k]*4;
+			for(int c = 0; c < 4; ++c)
+				sum[c] += texel[c]*weight[k];
+		}
+		std::memcpy(dst, sum, sizeof(sum));
+#endif
+	}
+
+	// dst += w*src over count floats, a multiple of four.
+	inline void AddScaledRow(const float* src, float w, uint32_t count, float* dst)
+	{
+#ifdef MIPGEN_USE_SSE2
+		__m128 weight = _mm_set1_ps(w);
+		for(uint32_t i = 0; i < count; i += 4)
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), weight)));
+#else
+		for(uint32_t i = 0; i < count; ++i)
+			dst[i] += src[i]*w;
+#endif
+	}
+
+	// Clamps count floats, a multiple of four, to [0, 1].  The Kaiser filter overshoots
+	// at hard edges, and the next level shouldn't build on that.
+	inline void SaturateRow(float* row, uint32_t count)
+	{
+#ifdef MIPGEN_USE_SSE2
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		for(uint32_t i = 0; i < count; i += 4)
+			_mm_storeu_ps(row + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + i), zero), one));
+#else
+		for(uint32_t i = 0; i < count; ++i)
+			row[i] = std::min(std::max(row[i], 0.0f), 1.0f);
+#endif
+	}
+
+	void DecodeRow(const uint8_t* src, uint32_t width, bool srgb, float* dst)
+	{
+		const float* toLinear = GetColorTables().SrgbToLinear;
+		for(uint32_t x = 0; x < width; ++x, src += 4, dst += 4)
+		{
+			for(int c = 0; c < 3; ++c)
+				dst[c] = srgb ? toLinear[src[c]] : src[c] / 255.0f;
+			dst[3] = src[3] / 255.0f;
+		}
+	}
+
+	void EncodeRow(const float* src, uint32_t width, bool srgb, uint8_t* dst)
+	{
+		const ColorTables& tables = GetColorTables();
+		for(uint32_t x = 0; x < width; ++x, src += 4, dst += 4)
+		{
+			for(int c = 0; c < 3; ++c)
+				dst[c] = srgb ? EncodeSrgb(tables, src[c]) : EncodeUnorm(src[c]);
+			dst[3] = EncodeUnorm(src[3]);
+		}
+	}
+
+	// Runs work(slice, firstRow, lastRow) over rows [0, rows) of every slice, in bands of
+	// about TexelsPerTask texels, and waits for all of them.
+	void ForEachRowBand(ThreadPool* pool, uint32_t sliceCount, uint32_t rows, uint32_t width,
+		const std::function<void(uint32_t, uint32_t, uint32_t)>& work)
+	{
+		uint32_t rowsPerBand = std::max(TexelsPerTask / std::max(width, 1u), 1u);
+
+		if(pool == nullptr || (sliceCount == 1 && rows <= rowsPerBand))
+		{
+			for(uint32_t slice = 0; slice < sliceCount; ++slice)
+				work(slice, 0, rows);
+			return;
+		}
+
+		uint32_t bandsPerSlice = (rows + rowsPerBand - 1) / rowsPerBand;
+		ParallelFor(pool, (size_t)sliceCount*bandsPerSlice, [&](size_t band)
+		{
+			uint32_t slice = (uint32_t)(band / bandsPerSlice);
+			uint32_t row = (uint32_t)(band % bandsPerSlice)*rowsPerBand;
+			work(slice, row, std::min(row + rowsPerBand, rows));
+		});
+	}
+}
+
+uint32_t GetFullMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while(width > 1 || height > 1)
+	{
+		width = std::max(width >> 1, 1u);
+		height = std::max(height >> 1, 1u);
+		++count;
+	}
+	return count;
+}
+
+bool IsMipGeneratable(DXGI_FORMAT format)
+{
+	switch(format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void GenerateMips(MipFilter filter, bool srgb, MipSurface* surfaces, uint32_t mipCount,
+	uint32_t arraySize, ThreadPool* pool, MipGenerateStats& stats)
+{
+	stats = MipGenerateStats();
+	if(mipCount == 0 || arraySize == 0)
+		return;
+
+	uint32_t width = surfaces[0].Width;
+	uint32_t height = surfaces[0].Height;
+
+	stats.Width = width;
+	stats.Height = height;
+	stats.MipCount = mipCount;
+	stats.ArraySize = arraySize;
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Every slice keeps the current level in linear floats, plus the horizontally
+	// filtered rows of the next one.
+	std::vector<std::vector<float>> levels(arraySize);
+	std::vector<std::vector<float>> scratch(arraySize);
+	for(auto& level : levels)
+		level.resize((size_t)width*height*4);
+
+	ForEachRowBand(pool, arraySize, height, width, [&](uint32_t slice, uint32_t firstRow, uint32_t lastRow)
+	{
+		const MipSurface& top = surfaces[slice*mipCount];
+		for(uint32_t y = firstRow; y < lastRow; ++y)
+			DecodeRow(top.Pixels + y*top.RowPitch, width, srgb, &levels[slice][(size_t)y*width*4]);
+	});
+
+	uint64_t texels = 0;
+	for(uint32_t mip = 1; mip < mipCount; ++mip)
+	{
+		uint32_t dstWidth = std::max(width >> 1, 1u);
+		uint32_t dstHeight = std::max(height >> 1, 1u);
+
+		FilterTaps tapsX = BuildFilterTaps(filter, width, dstWidth);
+		FilterTaps tapsY = BuildFilterTaps(filter, height, dstHeight);
+
+		for(auto& rows : scratch)
+			rows.resize((size_t)dstWidth*height*4);
+
+		ForEachRowBand(pool, arraySize, height, dstWidth, [&](uint32_t slice, uint32_t firstRow, uint32_t lastRow)
+		{
+			for(uint32_t y = firstRow; y < lastRow; ++y)
+			{
+				const float* src = &levels[slice][(size_t)y*width*4];
+				float* dst = &scratch[slice][(size_t)y*dstWidth*4];
+				for(uint32_t x = 0; x < dstWidth; ++x)
+				{
+					size_t tap = (size_t)x*tapsX.TapCount;
+					FilterTexel(src, &tapsX.Index[tap], &tapsX.Weight[tap], tapsX.TapCount, dst + x*4);
+				}
+			}
+		});
+
+		std::vector<std::vector<float>> next(arraySize);
+		for(auto& level : next)
+			level.assign((size_t)dstWidth*dstHeight*4, 0.0f);
+
+		ForEachRowBand(pool, arraySize, dstHeight, dstWidth, [&](uint32_t slice, uint32_t firstRow, uint32_t lastRow)
+		{
+			const MipSurface& surface = surfaces[slice*mipCount + mip];
+			uint32_t rowFloats = dstWidth*4;
+			for(uint32_t y = firstRow; y < lastRow; ++y)
+			{
+				float* dst = &next[slice][(size_t)y*rowFloats];
+				for(uint32_t k = 0; k < tapsY.TapCount; ++k)
+				{
+					size_t tap = (size_t)y*tapsY.TapCount + k;
+					if(tapsY.Weight[tap] != 0.0f)
+						AddScaledRow(&scratch[slice][(size_t)tapsY.Index[tap]*rowFloats], tapsY.Weight[tap], rowFloats, dst);
+				}
+
+				SaturateRow(dst, rowFloats);
+				EncodeRow(dst, dstWidth, srgb, surface.Pixels + y*surface.RowPitch);
+			}
+		});
+
+		levels.swap(next);
+		width = dstWidth;
+		height = dstHeight;
+		texels += (uint64_t)width*height*arraySize;
+	}
+
+	stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.MegapixelsPerSecond = stats.Seconds > 0.0 ? (double)texels / 1e6 / stats.Seconds : 0.0;
+}
+
+DDS_RESULT GenerateDDSMips(const uint8_t* ddsData, size_t ddsDataSize,
+	MipFilter filter, bool treatAsSrgb, ThreadPool* pool,
+	std::vector<uint8_t>& output, MipGenerateStats& stats)
+{
+	output.clear();
+	stats = MipGenerateStats();
+
+	DDSTextureDesc desc;
+	DDS_RESULT result = ParseDDSTexture(ddsData, ddsDataSize, desc);
+	if(result != DDS_RESULT_OK)
+		return result;
+
+	if(desc.dimension != DDS_DIMENSION_TEXTURE2D || !IsMipGeneratable(desc.format))
+		return DDS_RESULT_NOT_SUPPORTED;
+
+	std::vector<DDSSubresourceLayout> srcLayouts(desc.mipCount*desc.arraySize);
+	DDSLayoutInfo info;
+	result = GetDDSSubresourceLayout(desc, 0, srcLayouts.data(), srcLayouts.size(), info);
+	if(result != DDS_RESULT_OK)
+		return result;
+
+	DDSTextureDesc outDesc = desc;
+	outDesc.mipCount = GetFullMipCount(desc.width, desc.height);
+	outDesc.dataOffset = DDS_DX10_HEADERS_SIZE;
+	outDesc.dataSize = 0;
+	for(uint32_t mip = 0; mip < outDesc.mipCount; ++mip)
+	{
+		size_t numBytes = 0;
+		GetSurfaceInfo(std::max(desc.width >> mip, 1u), std::max(desc.height >> mip, 1u), desc.format,
+			&numBytes, nullptr, nullptr);
+		outDesc.dataSize += numBytes*desc.arraySize;
+	}
+
+	output.resize(DDS_DX10_HEADERS_SIZE + outDesc.dataSize);
+	WriteDDSHeaders(outDesc, output.data());
+
+	std::vector<DDSSubresourceLayout> dstLayouts(outDesc.mipCount*outDesc.arraySize);
+	result = GetDDSSubresourceLayout(outDesc, 0, dstLayouts.data(), dstLayouts.size(), info);
+	if(result != DDS_RESULT_OK)
+		return result;
+
+	std::vector<MipSurface> surfaces(dstLayouts.size());
+	for(uint32_t slice = 0; slice < outDesc.arraySize; ++slice)
+	{
+		for(uint32_t mip = 0; mip < outDesc.mipCount; ++mip)
+		{
+			MipSurface& surface = surfaces[slice*outDesc.mipCount + mip];
+			surface.Pixels = output.data() + dstLayouts[slice*outDesc.mipCount + mip].offset;
+			surface.Width = std::max(desc.width >> mip, 1u);
+			surface.Height = std::max(desc.height >> mip, 1u);
+			surface.RowPitch = dstLayouts[slice*outDesc.mipCount + mip].rowPitch;
+		}
+
+		// The rows of a 32-bit format are packed, so the top level copies over whole.
+		const DDSSubresourceLayout& top = srcLayouts[slice*desc.mipCount];
+		std::memcpy(surfaces[slice*outDesc.mipCount].Pixels, ddsData + top.offset, top.slicePitch);
+	}
+
+	bool srgb = IsSRGB(desc.format) || treatAsSrgb;
+	GenerateMips(filter, srgb, surfaces.data(), outDesc.mipCount, outDesc.arraySize, pool, stats);
+
+	return DDS_RESULT_OK;
+}
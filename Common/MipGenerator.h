@@ -0,0 +1,73 @@
+//***************************************************************************************
+// MipGenerator.h
+//
+// Builds the mip chain of 8-bit RGBA (or BGRA) textures on the CPU.  Filtering is done in
+// linear light: sRGB texels are converted on the way in and back on the way out, so dark
+// and bright detail keep their balance down the chain.  Alpha is always linear.
+//   -Box averages the source texels each destination texel covers.  Odd sizes weight
+//    the straddling texels by the area they contribute.
+//   -Kaiser is a Kaiser-windowed sinc spanning three destination texels on each side.  It
+//    keeps more detail than Box at the cost of some ringing around hard edges.
+// The filters are separable and work on whole RGBA texels, four floats at a time with
+// SSE2 when it is available.  Each level is filtered from the float copy of the level
+// above it rather than from its 8-bit version.
+//
+// Like DDSParser it has no Win32 or Direct3D dependencies.
+//***************************************************************************************
+
+#pragma once
+
+#include <vector>
+
+#include "DDSParser.h"
+
+class ThreadPool;
+
+enum class MipFilter
+{
+	Box,
+	Kaiser
+};
+
+// One level of one array slice.
+struct MipSurface
+{
+	uint8_t* Pixels = nullptr;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	size_t RowPitch = 0;
+};
+
+struct MipGenerateStats
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 0;
+	uint32_t ArraySize = 0;
+
+	// Time spent filtering, and the texels written per second of it.
+	double Seconds = 0.0;
+	double MegapixelsPerSecond = 0.0;
+};
+
+// Levels down to 1x1.
+uint32_t GetFullMipCount(uint32_t width, uint32_t height);
+
+// 8-bit RGBA, BGRA and BGRX textures, linear or sRGB.
+bool IsMipGeneratable(DXGI_FORMAT format);
+
+// surfaces holds mipCount levels per slice, slice major, with level 0 of each slice filled
+// in.  Fills in the other levels.  Slices and row bands go to pool when there is one;
+// don't pass the pool the caller is running on.
+void GenerateMips(MipFilter filter, bool srgb, MipSurface* surfaces, uint32_t mipCount,
+	uint32_t arraySize, ThreadPool* pool, MipGenerateStats& stats);
+
+// Rewrites a 2D DDS texture, texture array or cube map with a full mip chain built from
+// its top level; mips already in the file are replaced.  Colour in _SRGB formats is always
+// filtered in linear light.  Most UNORM colour textures are authored in sRGB as well, so
+// treatAsSrgb filters those the same way (leave it off for normal maps and masks); the
+// format in the file is kept either way.  Fails with DDS_RESULT_NOT_SUPPORTED for volumes
+// and the formats IsMipGeneratable rejects.
+DirectX::DDS_RESULT GenerateDDSMips(const uint8_t* ddsData, size_t ddsDataSize,
+	MipFilter filter, bool treatAsSrgb, ThreadPool* pool,
+	std::vector<uint8_t>& output, MipGenerateStats& stats);
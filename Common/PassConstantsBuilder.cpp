@@ -0,0 +1,138 @@
+//***************************************************************************************
+// PassConstantsBuilder.cpp
+//***************************************************************************************
+
+#include "PassConstantsBuilder.h"
+
+using namespace DirectX;
+
+PassConstantsBuilder::PassConstantsBuilder()
+{
+	__int64 countsPerSec;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	mSecondsPerCount = 1.0 / (double)countsPerSec;
+}
+
+void PassConstantsBuilder::BeginFrame()
+{
+	QueryPerformanceCounter((LARGE_INTEGER*)&mFrameStartTime);
+	mStats.Frames++;
+}
+
+bool PassConstantsBuilder::SetCamera(const XMFLOAT4X4& view, const XMFLOAT4X4& proj, const XMFLOAT3& eyePosW)
+{
+	bool changed = mCameraChanged ||
+		memcmp(&view, &mView, sizeof(XMFLOAT4X4)) != 0 ||
+		memcmp(&proj, &mProj, sizeof(XMFLOAT4X4)) != 0 ||
+		memcmp(&eyePosW, &mConstants.EyePosW, sizeof(XMFLOAT3)) != 0;
+
+	mCameraChanged = false;
+	if(!changed)
+		return false;
+
+	mView = view;
+	mProj = proj;
+	mConstants.EyePosW = eyePosW;
+	RebuildCamera();
+
+	return true;
+}
+
+void PassConstantsBuilder::SetRenderTarget(float width, float height, float nearZ, float farZ)
+{
+	if(mConstants.RenderTargetSize.x == width && mConstants.RenderTargetSize.y == height &&
+		mConstants.NearZ == nearZ && mConstants.FarZ == farZ)
+		return;
+
+	mConstants.RenderTargetSize = XMFLOAT2(width, height);
+	mConstants.InvRenderTargetSize = XMFLOAT2(1.0f / width, 1.0f / height);
+	mConstants.NearZ = nearZ;
+	mConstants.FarZ = farZ;
+
+	mCameraFramesDirty = gNumFrameResources;
+}
+
+void PassConstantsBuilder::SetTime(float totalTime, float deltaTime)
+{
+	mConstants.TotalTime = totalTime;
+	mConstants.DeltaTime = deltaTime;
+}
+
+bool PassConstantsBuilder::SetLights(const LightStore& lights)
+{
+	if(mHasLights && lights.GetVersion() == mLightVersion)
+		return false;
+
+	mHasLights = true;
+	mLightVersion = lights.GetVersion();
+
+	mConstants.AmbientLight = lights.GetAmbient();
+
+	// Only directional lights live in the constant buffer; point and spot lights go
+	// through the light clusters.
+	mDirectionalLights.clear();
+	lights.Gather(LightType::Directional, mDirectionalLights);
+
+	// The unused entries get no strength: a shader variant that reads more directional
+	// lights than the store has then adds nothing for them.
+	Light unused;
+	unused.Strength = { 0.0f, 0.0f, 0.0f };
+
+	UINT count = MathHelper::Min((UINT)mDirectionalLights.size(), (UINT)MaxLights);
+	for(UINT i = 0; i < MaxLights; ++i)
+		mConstants.Lights[i] = i < count ? mDirectionalLights[i] : unused;
+
+	mLightFramesDirty = gNumFrameResources;
+	mStats.LightRebuilds++;
+
+	return true;
+}
+
+void PassConstantsBuilder::SetClusters(const LightClusterGrid& clusters)
+{
+	mConstants.ClusterTilesX = clusters.GetTilesX();
+	mConstants.ClusterTilesY = clusters.GetTilesY();
+	mConstants.ClusterSlices = clusters.GetSlices();
+	mConstants.ClusterPointLightCount = clusters.GetPointLightCount();
+	mConstants.ClusterTileSize = clusters.GetTileSize();
+	mConstants.ClusterSliceScale = clusters.GetSliceScale();
+	mConstants.ClusterSliceBias = clusters.GetSliceBias();
+}
+
+const PassConstants& PassConstantsBuilder::GetConstants()const
+{
+	return mConstants;
+}
+
+const PassConstantsStats& PassConstantsBuilder::GetStats()const
+{
+	return mStats;
+}
+
+void PassConstantsBuilder::RebuildCamera()
+{
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
+	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+
+	XMStoreFloat4x4(&mConstants.View, XMMatrixTranspose(view));
+	XMStoreFloat4x4(&mConstants.InvView, XMMatrixTranspose(invView));
+	XMStoreFloat4x4(&mConstants.Proj, XMMatrixTranspose(proj));
+	XMStoreFloat4x4(&mConstants.InvProj, XMMatrixTranspose(invProj));
+	XMStoreFloat4x4(&mConstants.ViewProj, XMMatrixTranspose(viewProj));
+	XMStoreFloat4x4(&mConstants.InvViewProj, XMMatrixTranspose(invViewProj));
+
+	mCameraFramesDirty = gNumFrameResources;
+	mStats.CameraRebuilds++;
+}
+
+void PassConstantsBuilder::EndUpload()
+{
+	__int64 endTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+	mStats.LastUpdateMs = (endTime - mFrameStartTime)*mSecondsPerCount*1000.0;
+}
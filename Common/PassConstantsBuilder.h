@@ -0,0 +1,110 @@
+//***************************************************************************************
+// PassConstantsBuilder.h
+//
+// Builds the main pass constants and uploads only what changed.
+//   -The view/projection inverses are only recomputed when the camera, projection or
+//    render target changed.
+//   -The ambient term and light array are only rebuilt when the LightStore version moved.
+//   -Each block is tracked per frame resource (like NumFramesDirty), so an unchanged block
+//    is not copied into the frame's constant buffer at all.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrameResource.h"
+#include "LightStore.h"
+#include "LightClusterGrid.h"
+#include <cstddef>
+
+struct PassConstantsStats
+{
+	// CPU time from BeginFrame to the end of Upload.
+	double LastUpdateMs = 0.0;
+
+	UINT64 Frames = 0;
+	UINT64 CameraRebuilds = 0;
+	UINT64 CameraUploads = 0;
+	UINT64 LightRebuilds = 0;
+	UINT64 LightUploads = 0;
+};
+
+class PassConstantsBuilder
+{
+public:
+	PassConstantsBuilder();
+
+	void BeginFrame();
+
+	// Returns true if the camera or projection differs from the previous frame.
+	bool SetCamera(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj,
+		const DirectX::XMFLOAT3& eyePosW);
+	void SetRenderTarget(float width, float height, float nearZ, float farZ);
+	void SetTime(float totalTime, float deltaTime);
+
+	// Returns true if the lights changed since the previous call.
+	bool SetLights(const LightStore& lights);
+	void SetClusters(const LightClusterGrid& clusters);
+
+	// Copies the blocks that are stale for the current frame resource into passCB, which
+	// is an UploadBuffer<PassConstants> or anything with its partial CopyData.
+	template<typename Buffer>
+	void Upload(Buffer* passCB, int elementIndex);
+
+	const PassConstants& GetConstants()const;
+	const PassConstantsStats& GetStats()const;
+
+private:
+	// Byte ranges of the blocks in PassConstants that are tracked separately.
+	static const UINT CameraBlockBegin = (UINT)offsetof(PassConstants, View);
+	static const UINT CameraBlockEnd = (UINT)offsetof(PassConstants, TotalTime);
+	static const UINT TimeBlockEnd = (UINT)offsetof(PassConstants, AmbientLight);
+	static const UINT LightBlockEnd = (UINT)offsetof(PassConstants, ClusterTilesX);
+
+	void RebuildCamera();
+	void EndUpload();
+
+private:
+	PassConstants mConstants;
+
+	DirectX::XMFLOAT4X4 mView = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mProj = MathHelper::Identity4x4();
+	bool mCameraChanged = true;
+
+	UINT64 mLightVersion = 0;
+	bool mHasLights = false;
+	std::vector<Light> mDirectionalLights;
+
+	// Number of frame resources that still hold a stale copy of each block.
+	int mCameraFramesDirty = gNumFrameResources;
+	int mLightFramesDirty = gNumFrameResources;
+
+	double mSecondsPerCount = 0.0;
+	__int64 mFrameStartTime = 0;
+	PassConstantsStats mStats;
+};
+
+template<typename Buffer>
+void PassConstantsBuilder::Upload(Buffer* passCB, int elementIndex)
+{
+	if(mCameraFramesDirty > 0)
+	{
+		passCB->CopyData(elementIndex, mConstants, CameraBlockBegin, CameraBlockEnd - CameraBlockBegin);
+		mCameraFramesDirty--;
+		mStats.CameraUploads++;
+	}
+
+	// Time changes every frame.
+	passCB->CopyData(elementIndex, mConstants, CameraBlockEnd, TimeBlockEnd - CameraBlockEnd);
+
+	if(mLightFramesDirty > 0)
+	{
+		passCB->CopyData(elementIndex, mConstants, TimeBlockEnd, LightBlockEnd - TimeBlockEnd);
+		mLightFramesDirty--;
+		mStats.LightUploads++;
+	}
+
+	// The cluster parameters are a handful of words; not worth tracking.
+	passCB->CopyData(elementIndex, mConstants, LightBlockEnd, (UINT)sizeof(PassConstants) - LightBlockEnd);
+
+	EndUpload();
+}
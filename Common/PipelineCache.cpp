@@ -0,0 +1,254 @@
+//***************************************************************************************
+// PipelineCache.cpp
+//***************************************************************************************
+
+#include "PipelineCache.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	const uint64_t HashSeed = 0x50534f4b45594831ull;
+	const uint64_t CheckSeed = 0xc2b2ae3d27d4eb4full;
+	const uint64_t BlobSeed = 0x165667b19e3779f9ull;
+
+	// Tags keep a string or blob from hashing the same as plain bytes that happen to match.
+	const uint8_t NullStringTag = 0;
+	const uint8_t StringTag = 1;
+	const uint8_t BlobTag = 2;
+}
+
+void PipelineKeyBuilder::AddBytes(const void* data, size_t size)
+{
+	mMaterial.append((const char*)data, size);
+}
+
+void PipelineKeyBuilder::AddString(const char* str)
+{
+	if(str == nullptr)
+	{
+		Add(NullStringTag);
+		return;
+	}
+
+	uint64_t size = std::strlen(str);
+	Add(StringTag);
+	Add(size);
+	AddBytes(str, (size_t)size);
+}
+
+void PipelineKeyBuilder::AddBlob(const void* data, size_t size)
+{
+	uint64_t blobSize = size;
+	uint64_t hash = size != 0 ? MurmurHash64(data, size, BlobSeed) : 0;
+
+	Add(BlobTag);
+	Add(blobSize);
+	Add(hash);
+}
+
+PipelineKey PipelineKeyBuilder::GetKey()const
+{
+	PipelineKey key;
+	key.Hash = MurmurHash64(mMaterial.data(), mMaterial.size(), HashSeed);
+	key.Check = MurmurHash64(mMaterial.data(), mMaterial.size(), CheckSeed);
+	return key;
+}
+
+std::wstring PipelineKeyBuilder::GetName(const PipelineKey& key)
+{
+	const wchar_t digits[] = L"0123456789abcdef";
+
+	std::wstring name(32, L'0');
+	for(int i = 0; i < 16; ++i)
+	{
+		name[15 - i] = digits[(key.Hash >> (4*i)) & 0xf];
+		name[31 - i] = digits[(key.Check >> (4*i)) & 0xf];
+	}
+
+	return name;
+}
+
+PipelineCache::PipelineCache(PipelineCacheBackend& backend)
+	: mBackend(backend)
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+	// The tasks call into the backend and write into mPipelines.
+	for(auto& p : mPipelines)
+	{
+		if(p->Task.valid())
+			p->Task.wait();
+	}
+}
+
+uint32_t PipelineCache::Request(const PipelineKey& key, bool deferred, bool& added)
+{
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	++mStats.Requests;
+
+	auto it = mIndex.find(key);
+	if(it != mIndex.end())
+	{
+		Pipeline* p = mPipelines[it->second].get();
+		if(!deferred && p->State == Queued)
+			p->Deferred = false;
+
+		added = false;
+		return it->second;
+	}
+
+	auto p = std::make_unique<Pipeline>();
+	p->Key = key;
+	p->Deferred = deferred;
+	p->State = Queued;
+
+	uint32_t index = (uint32_t)mPipelines.size();
+	mPipelines.push_back(std::move(p));
+	mIndex[key] = index;
+
+	added = true;
+	return index;
+}
+
+bool PipelineCache::CreatePipelines(ThreadPool* pool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<Pipeline*> immediate;
+	for(uint32_t i = 0; i < (uint32_t)mPipelines.size(); ++i)
+	{
+		Pipeline* p = mPipelines[i].get();
+		if(p->State != Queued)
+			continue;
+
+		if(pool == nullptr)
+		{
+			if(!p->Deferred)
+			{
+				p->State = Creating;
+				immediate.push_back(p);
+				CreatePipeline(i, p);
+			}
+			continue;
+		}
+
+		p->State = Creating;
+		p->Task = pool->Submit([this, i, p]()
+		{
+			CreatePipeline(i, p);
+		}).share();
+
+		if(!p->Deferred)
+			immediate.push_back(p);
+	}
+
+	// Every pipeline is waited for before an exception from one of them is let out.
+	for(Pipeline* p : immediate)
+	{
+		if(p->Task.valid())
+			p->Task.wait();
+	}
+	for(Pipeline* p : immediate)
+	{
+		if(p->Task.valid())
+			p->Task.get();
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	bool created = true;
+	for(Pipeline* p : immediate)
+	{
+		if(p->State != Ready)
+			created = false;
+	}
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mStats.ImmediateMs += ms;
+	return created;
+}
+
+bool PipelineCache::IsReady(uint32_t pipeline)const
+{
+	return mPipelines[pipeline]->State == Ready;
+}
+
+bool PipelineCache::Wait(uint32_t pipeline)
+{
+	Pipeline* p = mPipelines[pipeline].get();
+
+	if(p->State == Queued)
+	{
+		p->State = Creating;
+		CreatePipeline(pipeline, p);
+	}
+	else if(p->Task.valid())
+	{
+		p->Task.get();
+	}
+
+	return p->State == Ready;
+}
+
+void PipelineCache::WaitAll()
+{
+	for(uint32_t i = 0; i < (uint32_t)mPipelines.size(); ++i)
+		Wait(i);
+}
+
+uint32_t PipelineCache::GetPipelineCount()const
+{
+	return (uint32_t)mPipelines.size();
+}
+
+const PipelineKey& PipelineCache::GetKey(uint32_t pipeline)const
+{
+	return mPipelines[pipeline]->Key;
+}
+
+PipelineCacheStats PipelineCache::GetStats()const
+{
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+
+	PipelineCacheStats stats = mStats;
+	stats.Pipelines = (uint32_t)mPipelines.size();
+	for(const auto& p : mPipelines)
+	{
+		if(p->Deferred)
+			++stats.Deferred;
+	}
+
+	return stats;
+}
+
+void PipelineCache::CreatePipeline(uint32_t index, Pipeline* pipeline)
+{
+	PipelineSource source = PipelineSource::Failed;
+	try
+	{
+		source = mBackend.Create(index, pipeline->Key);
+	}
+	catch(...)
+	{
+		pipeline->State = Failed;
+
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		++mStats.Failed;
+		throw;
+	}
+
+	pipeline->State = source == PipelineSource::Failed ? Failed : Ready;
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	if(source == PipelineSource::Loaded)
+		++mStats.Loaded;
+	else if(source == PipelineSource::Created)
+		++mStats.Created;
+	else
+		++mStats.Failed;
+}
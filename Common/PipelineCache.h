@@ -0,0 +1,169 @@
+//***************************************************************************************
+// PipelineCache.h
+//
+// Names pipeline states by a hash of everything that goes into them, so identical
+// requests share one pipeline, and creates them on a thread pool.
+//   -PipelineKeyBuilder hashes a description field by field.  Shader bytecode and other
+//    blobs are hashed by content, never by address, so the same pipeline gets the same
+//    key in every run and the key can name it in a library kept on disk.
+//   -PipelineCache hands out one index per distinct key.  CreatePipelines creates the
+//    pipelines the first frame needs on the pool and waits for them; deferred ones are
+//    left running on the pool, and Wait blocks only if one is used before it's done.
+//
+// Like ShaderCache it has no Direct3D dependencies: creating a pipeline goes through a
+// PipelineCacheBackend.  PipelineStateCache is the Direct3D 12 backend.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "ShaderCache.h"
+
+class ThreadPool;
+
+struct PipelineKey
+{
+	uint64_t Hash = 0;
+
+	// A second, unrelated hash; two descriptions only share a key if both match.
+	uint64_t Check = 0;
+
+	bool operator==(const PipelineKey& rhs)const { return Hash == rhs.Hash && Check == rhs.Check; }
+	bool operator!=(const PipelineKey& rhs)const { return !(*this == rhs); }
+};
+
+struct PipelineKeyHasher
+{
+	size_t operator()(const PipelineKey& key)const { return (size_t)key.Hash; }
+};
+
+class PipelineKeyBuilder
+{
+public:
+	// Plain state, added as its bytes.  Structures with padding must be added field by
+	// field, or their padding is hashed too.
+	void AddBytes(const void* data, size_t size);
+
+	template<typename T>
+	void Add(const T& value)
+	{
+		AddBytes(&value, sizeof(T));
+	}
+
+	// A null string is distinct from an empty one.
+	void AddString(const char* str);
+
+	// Shader bytecode and the like: the key gets the blob's size and a hash of its bytes.
+	void AddBlob(const void* data, size_t size);
+
+	PipelineKey GetKey()const;
+
+	// 32 hex digits, for naming the pipeline outside the process.
+	static std::wstring GetName(const PipelineKey& key);
+
+private:
+	std::string mMaterial;
+};
+
+enum class PipelineSource
+{
+	Failed,
+
+	// Found among the pipelines an earlier run saved.
+	Loaded,
+
+	Created
+};
+
+class PipelineCacheBackend
+{
+public:
+	virtual ~PipelineCacheBackend() = default;
+
+	// Creates pipeline, the index PipelineCache::Request returned for key.  Called from
+	// the pool's threads, several at once.
+	virtual PipelineSource Create(uint32_t pipeline, const PipelineKey& key) = 0;
+};
+
+struct PipelineCacheStats
+{
+	// Requests made, and the distinct pipelines they named.
+	uint32_t Requests = 0;
+	uint32_t Pipelines = 0;
+
+	uint32_t Deferred = 0;
+
+	uint32_t Loaded = 0;
+	uint32_t Created = 0;
+	uint32_t Failed = 0;
+
+	// Time CreatePipelines spent waiting for the pipelines that weren't deferred.
+	double ImmediateMs = 0.0;
+};
+
+class PipelineCache
+{
+public:
+	explicit PipelineCache(PipelineCacheBackend& backend);
+	PipelineCache(const PipelineCache& rhs) = delete;
+	PipelineCache& operator=(const PipelineCache& rhs) = delete;
+
+	// Waits for any pipeline still being created.
+	~PipelineCache();
+
+	// Returns the index of the pipeline with key; added is true if no earlier request
+	// named it.  A pipeline requested both deferred and not is not deferred, unless its
+	// creation has already started.
+	uint32_t Request(const PipelineKey& key, bool deferred, bool& added);
+
+	// Starts every requested pipeline that hasn't been, and waits for those that aren't
+	// deferred.  Without a pool, deferred pipelines are created by the first Wait for
+	// them.  Returns false if a pipeline that isn't deferred failed.
+	bool CreatePipelines(ThreadPool* pool);
+
+	bool IsReady(uint32_t pipeline)const;
+
+	// Waits for the pipeline to be created; false if it failed.  An exception thrown by
+	// the backend is rethrown here.
+	bool Wait(uint32_t pipeline);
+	void WaitAll();
+
+	uint32_t GetPipelineCount()const;
+	const PipelineKey& GetKey(uint32_t pipeline)const;
+
+	PipelineCacheStats GetStats()const;
+
+private:
+	enum PipelineState
+	{
+		Queued,
+		Creating,
+		Ready,
+		Failed
+	};
+
+	struct Pipeline
+	{
+		PipelineKey Key;
+		bool Deferred = false;
+		std::atomic<int> State;
+		std::shared_future<void> Task;
+	};
+
+	void CreatePipeline(uint32_t index, Pipeline* pipeline);
+
+private:
+	PipelineCacheBackend& mBackend;
+
+	// Only the calling thread adds pipelines; a task holds a pointer to its own.
+	std::vector<std::unique_ptr<Pipeline>> mPipelines;
+	std::unordered_map<PipelineKey, uint32_t, PipelineKeyHasher> mIndex;
+
+	mutable std::mutex mStatsMutex;
+	PipelineCacheStats mStats;
+};
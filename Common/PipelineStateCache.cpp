@@ -0,0 +1,290 @@
+//***************************************************************************************
+// PipelineStateCache.cpp
+//***************************************************************************************
+
+#include "PipelineStateCache.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	const uint64_t RootSignatureSeed = 0x524f4f545349474eull;
+
+	void AddShader(PipelineKeyBuilder& builder, const D3D12_SHADER_BYTECODE& shader)
+	{
+		builder.AddBlob(shader.pShaderBytecode, shader.pShaderBytecode != nullptr ? shader.BytecodeLength : 0);
+	}
+
+	// D3D12_RENDER_TARGET_BLEND_DESC and D3D12_DEPTH_STENCIL_DESC end their UINT8 fields
+	// with padding, so those two go in field by field.
+	void AddBlendState(PipelineKeyBuilder& builder, const D3D12_BLEND_DESC& blend)
+	{
+		builder.Add(blend.AlphaToCoverageEnable);
+		builder.Add(blend.IndependentBlendEnable);
+		for(const D3D12_RENDER_TARGET_BLEND_DESC& rt : blend.RenderTarget)
+		{
+			builder.Add(rt.BlendEnable);
+			builder.Add(rt.LogicOpEnable);
+			builder.Add(rt.SrcBlend);
+			builder.Add(rt.DestBlend);
+			builder.Add(rt.BlendOp);
+			builder.Add(rt.SrcBlendAlpha);
+			builder.Add(rt.DestBlendAlpha);
+			builder.Add(rt.BlendOpAlpha);
+			builder.Add(rt.LogicOp);
+			builder.Add(rt.RenderTargetWriteMask);
+		}
+	}
+
+	void AddDepthStencilState(PipelineKeyBuilder& builder, const D3D12_DEPTH_STENCIL_DESC& depthStencil)
+	{
+		builder.Add(depthStencil.DepthEnable);
+		builder.Add(depthStencil.DepthWriteMask);
+		builder.Add(depthStencil.DepthFunc);
+		builder.Add(depthStencil.StencilEnable);
+		builder.Add(depthStencil.StencilReadMask);
+		builder.Add(depthStencil.StencilWriteMask);
+		builder.Add(depthStencil.FrontFace);
+		builder.Add(depthStencil.BackFace);
+	}
+
+	void AddInputLayout(PipelineKeyBuilder& builder, const D3D12_INPUT_LAYOUT_DESC& inputLayout)
+	{
+		builder.Add(inputLayout.NumElements);
+		for(UINT i = 0; i < inputLayout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = inputLayout.pInputElementDescs[i];
+			builder.AddString(element.SemanticName);
+			builder.Add(element.SemanticIndex);
+			builder.Add(element.Format);
+			builder.Add(element.InputSlot);
+			builder.Add(element.AlignedByteOffset);
+			builder.Add(element.InputSlotClass);
+			builder.Add(element.InstanceDataStepRate);
+		}
+	}
+
+	void AddStreamOutput(PipelineKeyBuilder& builder, const D3D12_STREAM_OUTPUT_DESC& streamOutput)
+	{
+		builder.Add(streamOutput.NumEntries);
+		for(UINT i = 0; i < streamOutput.NumEntries; ++i)
+		{
+			const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+			builder.Add(entry.Stream);
+			builder.AddString(entry.SemanticName);
+			builder.Add(entry.SemanticIndex);
+			builder.Add(entry.StartComponent);
+			builder.Add(entry.ComponentCount);
+			builder.Add(entry.OutputSlot);
+		}
+
+		builder.Add(streamOutput.NumStrides);
+		for(UINT i = 0; i < streamOutput.NumStrides; ++i)
+			builder.Add(streamOutput.pBufferStrides[i]);
+		builder.Add(streamOutput.RasterizedStream);
+	}
+}
+
+PipelineStateCache::PipelineStateCache(ID3D12Device* device, const std::wstring& filename)
+	: md3dDevice(device),
+	  mFilename(filename),
+	  mCache(*this)
+{
+	D3D12_FEATURE_DATA_SHADER_CACHE shaderCache = {};
+	bool librarySupported =
+		SUCCEEDED(md3dDevice->CheckFeatureSupport(D3D12_FEATURE_SHADER_CACHE, &shaderCache, sizeof(shaderCache))) &&
+		(shaderCache.SupportFlags & D3D12_SHADER_CACHE_SUPPORT_LIBRARY) != 0;
+
+	if(mFilename.empty() || !librarySupported ||
+		FAILED(md3dDevice->QueryInterface(IID_PPV_ARGS(md3dDevice1.GetAddressOf()))))
+	{
+		md3dDevice1 = nullptr;
+		return;
+	}
+
+	// A large library is mapped rather than copied into memory.
+	if(mLibraryData.Load(mFilename.c_str()) != BinaryFileResult::Ok)
+		return;
+
+	// A library from another driver or adapter, or a damaged file, fails here; every
+	// pipeline is then compiled and Save replaces the file.
+	HRESULT hr = md3dDevice1->CreatePipelineLibrary(mLibraryData.GetData(),
+		(SIZE_T)mLibraryData.GetSize(), IID_PPV_ARGS(mLibrary.GetAddressOf()));
+	if(FAILED(hr))
+	{
+		mLibrary = nullptr;
+		mLibraryData.Close();
+	}
+}
+
+void PipelineStateCache::AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized)
+{
+	mRootSignatureHashes[rootSignature] =
+		MurmurHash64(serialized->GetBufferPointer(), serialized->GetBufferSize(), RootSignatureSeed);
+}
+
+uint32_t PipelineStateCache::Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, bool deferred)
+{
+	bool added = false;
+	uint32_t index = mCache.Request(ComputeKey(desc), deferred, added);
+
+	if(added)
+	{
+		auto pipeline = std::make_unique<Pipeline>();
+		pipeline->Desc = desc;
+		pipeline->Desc.CachedPSO = {};
+
+		std::lock_guard<std::mutex> lock(mPipelinesMutex);
+		mPipelines.push_back(std::move(pipeline));
+	}
+
+	return index;
+}
+
+void PipelineStateCache::CreatePipelines(ThreadPool* pool)
+{
+	if(!mCache.CreatePipelines(pool))
+	{
+		// Report the first failure's HRESULT.
+		for(uint32_t i = 0; i < mCache.GetPipelineCount(); ++i)
+		{
+			Pipeline* pipeline = GetPipeline(i);
+			if(mCache.IsReady(i) || pipeline->Result == S_OK)
+				continue;
+
+			ThrowIfFailed(pipeline->Result);
+		}
+
+		ThrowIfFailed(E_FAIL);
+	}
+}
+
+ID3D12PipelineState* PipelineStateCache::Get(uint32_t pipeline)
+{
+	Pipeline* p = GetPipeline(pipeline);
+
+	if(!mCache.IsReady(pipeline) && !mCache.Wait(pipeline))
+		ThrowIfFailed(FAILED(p->Result) ? p->Result : E_FAIL);
+
+	return p->State.Get();
+}
+
+bool PipelineStateCache::Save()
+{
+	if(md3dDevice1 == nullptr)
+		return true;
+
+	mCache.WaitAll();
+
+	PipelineCacheStats stats = mCache.GetStats();
+	if(stats.Created == 0 && mLibrary != nullptr)
+		return true;
+
+	ComPtr<ID3D12PipelineLibrary> library;
+	if(FAILED(md3dDevice1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(library.GetAddressOf()))))
+		return false;
+
+	for(uint32_t i = 0; i < mCache.GetPipelineCount(); ++i)
+	{
+		Pipeline* pipeline = GetPipeline(i);
+		if(pipeline->State == nullptr)
+			continue;
+
+		std::wstring name = PipelineKeyBuilder::GetName(mCache.GetKey(i));
+		if(FAILED(library->StorePipeline(name.c_str(), pipeline->State.Get())))
+			return false;
+	}
+
+	std::vector<uint8_t> data(library->GetSerializedSize());
+	if(FAILED(library->Serialize(data.data(), data.size())))
+		return false;
+
+	// Written aside and then moved into place, so the next run never reads half a library.
+	std::wstring temp = mFilename + L".tmp";
+	{
+		std::ofstream fout(temp, std::ios::binary);
+		fout.write((const char*)data.data(), data.size());
+		if(fout.fail())
+			return false;
+	}
+
+	// The old library may be mapped, which would keep the file from being replaced.  The
+	// pipelines loaded from it don't need it any more.
+	mLibrary = nullptr;
+	mLibraryData.Close();
+
+	return MoveFileExW(temp.c_str(), mFilename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+PipelineCacheStats PipelineStateCache::GetStats()const
+{
+	return mCache.GetStats();
+}
+
+PipelineKey PipelineStateCache::ComputeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)const
+{
+	PipelineKeyBuilder builder;
+
+	uint64_t rootSignature = 0;
+	if(desc.pRootSignature != nullptr)
+	{
+		auto it = mRootSignatureHashes.find(desc.pRootSignature);
+		if(it == mRootSignatureHashes.end())
+			ThrowIfFailed(E_INVALIDARG);
+		rootSignature = it->second;
+	}
+	builder.Add(rootSignature);
+
+	AddShader(builder, desc.VS);
+	AddShader(builder, desc.PS);
+	AddShader(builder, desc.DS);
+	AddShader(builder, desc.HS);
+	AddShader(builder, desc.GS);
+	AddStreamOutput(builder, desc.StreamOutput);
+	AddBlendState(builder, desc.BlendState);
+	builder.Add(desc.SampleMask);
+
+	// D3D12_RASTERIZER_DESC is all 32-bit fields, so has no padding.
+	builder.Add(desc.RasterizerState);
+	AddDepthStencilState(builder, desc.DepthStencilState);
+	AddInputLayout(builder, desc.InputLayout);
+	builder.Add(desc.IBStripCutValue);
+	builder.Add(desc.PrimitiveTopologyType);
+	builder.Add(desc.NumRenderTargets);
+	builder.Add(desc.RTVFormats);
+	builder.Add(desc.DSVFormat);
+	builder.Add(desc.SampleDesc);
+	builder.Add(desc.NodeMask);
+	builder.Add(desc.Flags);
+
+	return builder.GetKey();
+}
+
+PipelineSource PipelineStateCache::Create(uint32_t pipeline, const PipelineKey& key)
+{
+	Pipeline* p = GetPipeline(pipeline);
+
+	// The library's loads are free-threaded; a description that doesn't match what was
+	// stored under the name fails to load and is compiled instead.
+	if(mLibrary != nullptr)
+	{
+		std::wstring name = PipelineKeyBuilder::GetName(key);
+		if(SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &p->Desc, IID_PPV_ARGS(p->State.GetAddressOf()))))
+			return PipelineSource::Loaded;
+	}
+
+	p->Result = md3dDevice->CreateGraphicsPipelineState(&p->Desc, IID_PPV_ARGS(p->State.GetAddressOf()));
+	if(FAILED(p->Result))
+	{
+		p->State = nullptr;
+		return PipelineSource::Failed;
+	}
+
+	return PipelineSource::Created;
+}
+
+PipelineStateCache::Pipeline* PipelineStateCache::GetPipeline(uint32_t pipeline)
+{
+	std::lock_guard<std::mutex> lock(mPipelinesMutex);
+	return mPipelines[pipeline].get();
+}
@@ -0,0 +1,82 @@
+//***************************************************************************************
+// PipelineStateCache.h
+//
+// Direct3D 12 backend for PipelineCache.
+//   -A graphics pipeline description is keyed by every field that affects the pipeline.
+//    Shader bytecode is hashed by content and the root signature by its serialized
+//    form, so the key is the same in every run.
+//   -Pipelines are kept between runs in an ID3D12PipelineLibrary, named by their keys.
+//    A pipeline the library has is loaded rather than compiled.  A library written by
+//    another driver or adapter is ignored and rewritten.
+//   -Save writes a library holding only this run's pipelines, so ones that are no longer
+//    requested drop out the next time it's written.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "BinaryFile.h"
+#include "PipelineCache.h"
+
+class PipelineStateCache : public PipelineCacheBackend
+{
+public:
+	// filename is the library kept between runs; empty, or a device without pipeline
+	// library support, keeps nothing.
+	PipelineStateCache(ID3D12Device* device, const std::wstring& filename);
+	PipelineStateCache(const PipelineStateCache& rhs) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache& rhs) = delete;
+
+	// Root signatures are keyed by their serialized form, so each one a pipeline uses must
+	// be added before it's requested.
+	void AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized);
+
+	// Identical descriptions share one pipeline.  What desc points at (root signature,
+	// shaders, input layout, stream output) must stay valid until the pipeline has been
+	// created.  Deferred pipelines are left to finish on the pool after CreatePipelines.
+	uint32_t Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, bool deferred = false);
+
+	// Throws if a pipeline that isn't deferred can't be created.
+	void CreatePipelines(ThreadPool* pool);
+
+	// Waits for a deferred pipeline that is still being created.  Throws if it couldn't be.
+	ID3D12PipelineState* Get(uint32_t pipeline);
+
+	// Waits for every pipeline and writes the library if any had to be compiled.  Returns
+	// false if it couldn't be written.
+	bool Save();
+
+	PipelineCacheStats GetStats()const;
+
+	PipelineKey ComputeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)const;
+
+	PipelineSource Create(uint32_t pipeline, const PipelineKey& key) override;
+
+private:
+	struct Pipeline
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> State;
+		HRESULT Result = S_OK;
+	};
+
+	Pipeline* GetPipeline(uint32_t pipeline);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Device1> md3dDevice1;
+	std::wstring mFilename;
+
+	// The library reads from the file data for as long as it lives.
+	BinaryData mLibraryData;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+
+	std::unordered_map<ID3D12RootSignature*, uint64_t> mRootSignatureHashes;
+
+	// Added to by Request while the pool creates earlier pipelines.
+	mutable std::mutex mPipelinesMutex;
+	std::vector<std::unique_ptr<Pipeline>> mPipelines;
+
+	// Declared last: it waits for the pipelines still being created, which use the above.
+	PipelineCache mCache;
+};
@@ -0,0 +1,580 @@
+//***************************************************************************************
+// PixelFormatConverter.cpp
+//***************************************************************************************
+
+#include "PixelFormatConverter.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIXCONV_USE_SIMD
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// MSVC lets any function use any instruction set; GCC and Clang want the ones beyond
+// the build's baseline named on the function.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PIXCONV_TARGET(isa)
+#else
+#define PIXCONV_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// Roughly how many texels one task converts.
+	const uint32_t TexelsPerTask = 65536;
+
+	enum class LayoutKernel
+	{
+		// 8 or 16-bit texels with arbitrary channel masks.
+		Packed,
+
+		// 24 or 32-bit texels with whole byte channels.
+		Shuffle
+	};
+
+	enum class LayoutGroup
+	{
+		Always,
+		Packed16,
+		Luminance
+	};
+
+	struct LegacyLayout
+	{
+		const char* Name;
+		uint32_t Flags;
+		uint32_t BitCount;
+
+		// Red, green, blue and alpha; luminance is in the red mask.
+		uint32_t Masks[4];
+
+		LayoutKernel Kernel;
+		LayoutGroup Group;
+	};
+
+	const LegacyLayout Layouts[] =
+	{
+		{ "R8G8B8",   DDS_RGB,       24, { 0xff0000, 0x00ff00, 0x0000ff, 0 },      LayoutKernel::Shuffle, LayoutGroup::Always },
+		{ "B8G8R8",   DDS_RGB,       24, { 0x0000ff, 0x00ff00, 0xff0000, 0 },      LayoutKernel::Shuffle, LayoutGroup::Always },
+		{ "X8B8G8R8", DDS_RGB,       32, { 0x0000ff, 0x00ff00, 0xff0000, 0 },      LayoutKernel::Shuffle, LayoutGroup::Always },
+		{ "X1R5G5B5", DDS_RGB,       16, { 0x7c00, 0x03e0, 0x001f, 0 },            LayoutKernel::Packed,  LayoutGroup::Always },
+		{ "X4R4G4B4", DDS_RGB,       16, { 0x0f00, 0x00f0, 0x000f, 0 },            LayoutKernel::Packed,  LayoutGroup::Always },
+		{ "A8R3G3B2", DDS_RGB,       16, { 0x00e0, 0x001c, 0x0003, 0xff00 },       LayoutKernel::Packed,  LayoutGroup::Always },
+		{ "R3G3B2",   DDS_RGB,        8, { 0xe0, 0x1c, 0x03, 0 },                  LayoutKernel::Packed,  LayoutGroup::Always },
+		{ "A4L4",     DDS_LUMINANCE,  8, { 0x0f, 0, 0, 0xf0 },                     LayoutKernel::Packed,  LayoutGroup::Always },
+		{ "B5G6R5",   DDS_RGB,       16, { 0xf800, 0x07e0, 0x001f, 0 },            LayoutKernel::Packed,  LayoutGroup::Packed16 },
+		{ "B5G5R5A1", DDS_RGB,       16, { 0x7c00, 0x03e0, 0x001f, 0x8000 },       LayoutKernel::Packed,  LayoutGroup::Packed16 },
+		{ "B4G4R4A4", DDS_RGB,       16, { 0x0f00, 0x00f0, 0x000f, 0xf000 },       LayoutKernel::Packed,  LayoutGroup::Packed16 },
+		{ "L8",       DDS_LUMINANCE,  8, { 0xff, 0, 0, 0 },                        LayoutKernel::Packed,  LayoutGroup::Luminance },
+		{ "A8L8",     DDS_LUMINANCE, 16, { 0x00ff, 0, 0, 0xff00 },                 LayoutKernel::Packed,  LayoutGroup::Luminance },
+	};
+
+	// (c*Scale + Bias) >> 6 equals round(c*255/max) for every c of a channel with that
+	// many bits, and stays within 16 bits; index 0 is unused.
+	const uint16_t ExpandScale[9] = { 0, 16257, 5419, 2330, 1084, 527, 259, 129, 64 };
+	const uint16_t ExpandBias[9] = { 0, 63, 63, 36, 60, 23, 33, 0, 0 };
+
+	// How the SIMD kernels get one output channel out of a texel.  A channel the layout
+	// lacks has a zero mask and scale, and its constant value in the bias.
+	struct ExpandChannel
+	{
+		uint32_t Shift = 0;
+		uint16_t Mask = 0;
+		uint16_t Scale = 0;
+		uint16_t Bias = 0;
+	};
+
+	struct ConvertParams
+	{
+		const LegacyLayout* Layout = nullptr;
+		uint32_t Bytes = 0;
+		bool Luminance = false;
+
+		ExpandChannel Channels[4];
+
+		// Shuffle kernel: for each byte of four output texels, the input byte it comes
+		// from, or -1 for alpha.
+		int8_t Shuffle[16];
+	};
+
+	uint32_t LowestBit(uint32_t mask)
+	{
+		uint32_t shift = 0;
+		while(shift < 31 && !(mask & (1u << shift)))
+			++shift;
+		return shift;
+	}
+
+	uint32_t CountBits(uint32_t mask)
+	{
+		uint32_t bits = 0;
+		for(; mask != 0; mask &= mask - 1)
+			++bits;
+		return bits;
+	}
+
+	const LegacyLayout* FindLayout(const DDS_PIXELFORMAT& ddpf, const PixelConvertOptions& options)
+	{
+		// Same precedence as GetDXGIFormat.
+		uint32_t flags = 0;
+		if(ddpf.flags & DDS_RGB)
+			flags = DDS_RGB;
+		else if(ddpf.flags & DDS_LUMINANCE)
+			flags = DDS_LUMINANCE;
+		else
+			return nullptr;
+
+		for(const LegacyLayout& layout : Layouts)
+		{
+			if(layout.Flags != flags || layout.BitCount != ddpf.RGBBitCount ||
+				layout.Masks[0] != ddpf.RBitMask || layout.Masks[1] != ddpf.GBitMask ||
+				layout.Masks[2] != ddpf.BBitMask || layout.Masks[3] != ddpf.ABitMask)
+			{
+				continue;
+			}
+
+			if((layout.Group == LayoutGroup::Packed16 && !options.ExpandPacked16) ||
+				(layout.Group == LayoutGroup::Luminance && !options.ExpandLuminance))
+			{
+				return nullptr;
+			}
+
+			return &layout;
+		}
+
+		return nullptr;
+	}
+
+	ConvertParams BuildParams(const LegacyLayout& layout)
+	{
+		ConvertParams params;
+		params.Layout = &layout;
+		params.Bytes = layout.BitCount / 8;
+		params.Luminance = layout.Flags == DDS_LUMINANCE;
+
+		for(int c = 0; c < 4; ++c)
+		{
+			// Luminance goes to red, green and blue.
+			uint32_t mask = params.Luminance && c < 3 ? layout.Masks[0] : layout.Masks[c];
+
+			ExpandChannel& channel = params.Channels[c];
+			if(mask == 0)
+			{
+				channel.Bias = c == 3 ? 255 << 6 : 0;
+				continue;
+			}
+
+			uint32_t bits = std::min(CountBits(mask), 8u);
+			channel.Shift = LowestBit(mask);
+			channel.Mask = (uint16_t)(mask >> channel.Shift);
+			channel.Scale = ExpandScale[bits];
+			channel.Bias = ExpandBias[bits];
+		}
+
+		for(int texel = 0; texel < 4; ++texel)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				uint32_t mask = layout.Masks[c];
+				params.Shuffle[texel*4 + c] = mask == 0 ? (int8_t)-1 :
+					(int8_t)(texel*params.Bytes + LowestBit(mask) / 8);
+			}
+		}
+
+		return params;
+	}
+
+	// The reference conversion, one texel at a time with an exact division per channel.
+	// The SIMD kernels hand it the texels left over at the end of a run.
+	void ConvertScalar(const ConvertParams& params, const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		const uint32_t* masks = params.Layout->Masks;
+
+		for(size_t i = 0; i < count; ++i, src += params.Bytes, dst += 4)
+		{
+			uint32_t texel = 0;
+			for(uint32_t b = 0; b < params.Bytes; ++b)
+				texel |= (uint32_t)src[b] << (8*b);
+
+			for(int c = 0; c < 4; ++c)
+			{
+				uint32_t mask = params.Luminance && c < 3 ? masks[0] : masks[c];
+				if(mask == 0)
+				{
+					dst[c] = c == 3 ? 255 : 0;
+					continue;
+				}
+
+				uint32_t shift = LowestBit(mask);
+				uint32_t max = mask >> shift;
+				uint32_t value = (texel & mask) >> shift;
+				dst[c] = (uint8_t)((value*255 + max / 2) / max);
+			}
+		}
+	}
+
+#if defined(PIXCONV_USE_SIMD)
+	struct CpuFeatures
+	{
+		bool Ssse3 = false;
+		bool Avx2 = false;
+
+		CpuFeatures()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			Ssse3 = (info[2] & (1 << 9)) != 0;
+
+			// AVX2 also needs the OS to save the upper halves of the registers.
+			bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			if(maxLeaf >= 7 && osAvx)
+			{
+				__cpuidex(info, 7, 0);
+				Avx2 = (info[1] & (1 << 5)) != 0;
+			}
+#else
+			__builtin_cpu_init();
+			Ssse3 = __builtin_cpu_supports("ssse3") != 0;
+			Avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+	};
+
+	const CpuFeatures& GetCpuFeatures()
+	{
+		static const CpuFeatures features;
+		return features;
+	}
+
+	inline __m128i ExpandSSE2(__m128i texels, const ExpandChannel& channel)
+	{
+		__m128i value = _mm_and_si128(_mm_srl_epi16(texels, _mm_cvtsi32_si128((int)channel.Shift)),
+			_mm_set1_epi16((short)channel.Mask));
+		value = _mm_mullo_epi16(value, _mm_set1_epi16((short)channel.Scale));
+		return _mm_srli_epi16(_mm_add_epi16(value, _mm_set1_epi16((short)channel.Bias)), 6);
+	}
+
+	// 8 texels at a time, each channel in a 16-bit lane.
+	void ConvertPackedSSE2(const ConvertParams& params, const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			__m128i texels = params.Bytes == 2 ?
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*2)) :
+				_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)), _mm_setzero_si128());
+
+			__m128i r = ExpandSSE2(texels, params.Channels[0]);
+			__m128i g = ExpandSSE2(texels, params.Channels[1]);
+			__m128i b = ExpandSSE2(texels, params.Channels[2]);
+			__m128i a = ExpandSSE2(texels, params.Channels[3]);
+
+			__m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+			__m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i*4), _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i*4 + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+
+		ConvertScalar(params, src + i*params.Bytes, dst + i*4, count - i);
+	}
+
+	// 4 texels at a time.  Each load is 16 bytes, which runs past the 12 a 24-bit
+	// group needs, so the loop stops while the load is still inside the run.
+	PIXCONV_TARGET("ssse3")
+	void ConvertShuffleSSSE3(const ConvertParams& params, const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(params.Shuffle));
+		const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+		size_t i = 0;
+		for(; i*params.Bytes + 16 <= count*params.Bytes; i += 4)
+		{
+			__m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*params.Bytes));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i*4),
+				_mm_or_si128(_mm_shuffle_epi8(texels, shuffle), alpha));
+		}
+
+		ConvertScalar(params, src + i*params.Bytes, dst + i*4, count - i);
+	}
+
+	PIXCONV_TARGET("avx2")
+	inline __m256i ExpandAVX2(__m256i texels, const ExpandChannel& channel)
+	{
+		__m256i value = _mm256_and_si256(_mm256_srl_epi16(texels, _mm_cvtsi32_si128((int)channel.Shift)),
+			_mm256_set1_epi16((short)channel.Mask));
+		value = _mm256_mullo_epi16(value, _mm256_set1_epi16((short)channel.Scale));
+		return _mm256_srli_epi16(_mm256_add_epi16(value, _mm256_set1_epi16((short)channel.Bias)), 6);
+	}
+
+	// 16 texels at a time.  The unpacks work within each 128-bit half, so the halves
+	// are swapped back into texel order on the way out.
+	PIXCONV_TARGET("avx2")
+	void ConvertPackedAVX2(const ConvertParams& params, const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		size_t i = 0;
+		for(; i + 16 <= count; i += 16)
+		{
+			__m256i texels = params.Bytes == 2 ?
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i*2)) :
+				_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+
+			__m256i r = ExpandAVX2(texels, params.Channels[0]);
+			__m256i g = ExpandAVX2(texels, params.Channels[1]);
+			__m256i b = ExpandAVX2(texels, params.Channels[2]);
+			__m256i a = ExpandAVX2(texels, params.Channels[3]);
+
+			__m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+			__m256i ba = _mm256_or_si256(b, _mm256_slli_epi16(a, 8));
+			__m256i lo = _mm256_unpacklo_epi16(rg, ba);
+			__m256i hi = _mm256_unpackhi_epi16(rg, ba);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i*4), _mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i*4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+
+		ConvertScalar(params, src + i*params.Bytes, dst + i*4, count - i);
+	}
+
+	// 8 texels at a time, as two groups of four loaded into the halves of a register.
+	PIXCONV_TARGET("avx2")
+	void ConvertShuffleAVX2(const ConvertParams& params, const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		const __m128i shuffle128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(params.Shuffle));
+		const __m256i shuffle = _mm256_inserti128_si256(_mm256_castsi128_si256(shuffle128), shuffle128, 1);
+		const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+
+		size_t i = 0;
+		for(; (i + 4)*params.Bytes + 16 <= count*params.Bytes; i += 8)
+		{
+			__m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i*params.Bytes));
+			__m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i + 4)*params.Bytes));
+			__m256i texels = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i*4),
+				_mm256_or_si256(_mm256_shuffle_epi8(texels, shuffle), alpha));
+		}
+
+		ConvertScalar(params, src + i*params.Bytes, dst + i*4, count - i);
+	}
+#endif
+
+	typedef void (*ConvertFunction)(const ConvertParams&, const uint8_t*, uint8_t*, size_t);
+
+	ConvertFunction SelectKernel(const ConvertParams& params, PixelConvertPath path)
+	{
+#if defined(PIXCONV_USE_SIMD)
+		bool packed = params.Layout->Kernel == LayoutKernel::Packed;
+		if(path == PixelConvertPath::AVX2)
+			return packed ? ConvertPackedAVX2 : ConvertShuffleAVX2;
+
+		if(path == PixelConvertPath::SSE)
+		{
+			if(packed)
+				return ConvertPackedSSE2;
+			if(GetCpuFeatures().Ssse3)
+				return ConvertShuffleSSSE3;
+		}
+#else
+		(void)params;
+		(void)path;
+#endif
+		return ConvertScalar;
+	}
+
+	// A run of whole rows of one subresource; rows are packed in both the file and the
+	// output, so a band is one run of texels.
+	struct ConvertBand
+	{
+		const uint8_t* Src = nullptr;
+		uint8_t* Dst = nullptr;
+		size_t Count = 0;
+	};
+}
+
+PixelConvertPath GetPixelConvertPath(PixelConvertPath path)
+{
+#if defined(PIXCONV_USE_SIMD)
+	if(path == PixelConvertPath::Scalar)
+		return PixelConvertPath::Scalar;
+
+	if((path == PixelConvertPath::AVX2 || path == PixelConvertPath::Best) && GetCpuFeatures().Avx2)
+		return PixelConvertPath::AVX2;
+
+	// SSE2 is part of every x64 CPU and of the x86 builds this code targets.
+	return PixelConvertPath::SSE;
+#else
+	(void)path;
+	return PixelConvertPath::Scalar;
+#endif
+}
+
+const char* GetPixelConvertPathName(PixelConvertPath path)
+{
+	switch(path)
+	{
+	case PixelConvertPath::Scalar: return "scalar";
+	case PixelConvertPath::SSE:    return "SSE";
+	case PixelConvertPath::AVX2:   return "AVX2";
+	default:                       return "best";
+	}
+}
+
+DDS_RESULT ConvertLegacyDDS(const uint8_t* ddsData, size_t ddsDataSize,
+	const PixelConvertOptions& options, ThreadPool* pool,
+	std::vector<uint8_t>& output, PixelConvertStats& stats)
+{
+	output.clear();
+	stats = PixelConvertStats();
+
+	if(ddsData == nullptr)
+		return DDS_RESULT_INVALID_ARG;
+
+	const size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+	if(ddsDataSize < headerSize)
+		return DDS_RESULT_TOO_SMALL;
+
+	uint32_t magic = 0;
+	std::memcpy(&magic, ddsData, sizeof(uint32_t));
+	if(magic != DDS_MAGIC)
+		return DDS_RESULT_BAD_MAGIC;
+
+	DDS_HEADER header;
+	std::memcpy(&header, ddsData + sizeof(uint32_t), sizeof(DDS_HEADER));
+	if(header.size != sizeof(DDS_HEADER) || header.ddspf.size != sizeof(DDS_PIXELFORMAT))
+		return DDS_RESULT_BAD_HEADER;
+
+	// DX10 and FourCC files, and everything else the loader can take as it is.
+	if(header.ddspf.flags & DDS_FOURCC)
+		return DDS_RESULT_NOT_SUPPORTED;
+
+	const LegacyLayout* layout = FindLayout(header.ddspf, options);
+	if(layout == nullptr)
+		return DDS_RESULT_NOT_SUPPORTED;
+
+	DDSTextureDesc desc = {};
+	desc.width = header.width;
+	desc.height = header.height;
+	desc.depth = 1;
+	desc.mipCount = std::max(header.mipMapCount, 1u);
+	desc.arraySize = 1;
+	desc.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.alphaMode = layout->Masks[3] == 0 ? DDS_ALPHA_MODE_OPAQUE : DDS_ALPHA_MODE_UNKNOWN;
+
+	uint32_t maxSize = DDS_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+	if(header.flags & DDS_HEADER_FLAGS_VOLUME)
+	{
+		desc.dimension = DDS_DIMENSION_TEXTURE3D;
+		desc.depth = header.depth;
+		maxSize = DDS_REQ_TEXTURE3D_U_V_OR_W_DIMENSION;
+	}
+	else
+	{
+		desc.dimension = DDS_DIMENSION_TEXTURE2D;
+		if(header.caps2 & DDS_CUBEMAP)
+		{
+			if((header.caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+				return DDS_RESULT_NOT_SUPPORTED;
+
+			desc.arraySize = 6;
+			desc.isCubeMap = true;
+			maxSize = DDS_REQ_TEXTURECUBE_DIMENSION;
+		}
+	}
+
+	if(desc.width == 0 || desc.height == 0 || desc.depth == 0)
+		return DDS_RESULT_INVALID_DATA;
+
+	if(desc.mipCount > DDS_REQ_MIP_LEVELS || desc.width > maxSize || desc.height > maxSize || desc.depth > maxSize)
+		return DDS_RESULT_NOT_SUPPORTED;
+
+	// Legacy files pack their rows, slices, mips and then faces one after another.
+	uint64_t texels = 0;
+	for(uint32_t mip = 0; mip < desc.mipCount; ++mip)
+	{
+		texels += (uint64_t)std::max(desc.width >> mip, 1u)*std::max(desc.height >> mip, 1u)*
+			std::max(desc.depth >> mip, 1u);
+	}
+	texels *= desc.arraySize;
+
+	const uint32_t bytes = layout->BitCount / 8;
+	if(texels*bytes > ddsDataSize - headerSize)
+		return DDS_RESULT_TRUNCATED;
+
+	if(texels*4 > std::numeric_limits<size_t>::max() - DDS_DX10_HEADERS_SIZE)
+		return DDS_RESULT_NOT_SUPPORTED;
+
+	desc.dataOffset = DDS_DX10_HEADERS_SIZE;
+	desc.dataSize = (size_t)(texels*4);
+
+	output.resize(DDS_DX10_HEADERS_SIZE + desc.dataSize);
+	WriteDDSHeaders(desc, output.data());
+
+	std::vector<DDSSubresourceLayout> dstLayouts(desc.mipCount*desc.arraySize);
+	DDSLayoutInfo info;
+	DDS_RESULT result = GetDDSSubresourceLayout(desc, 0, dstLayouts.data(), dstLayouts.size(), info);
+	if(result != DDS_RESULT_OK)
+	{
+		output.clear();
+		return result;
+	}
+
+	// Every subresource is cut into bands of whole rows, so the small mips run alongside
+	// the bands of the large ones.
+	std::vector<ConvertBand> bands;
+	const uint8_t* src = ddsData + headerSize;
+	for(uint32_t slice = 0; slice < desc.arraySize; ++slice)
+	{
+		for(uint32_t mip = 0; mip < desc.mipCount; ++mip)
+		{
+			uint32_t width = std::max(desc.width >> mip, 1u);
+			uint32_t rows = std::max(desc.height >> mip, 1u)*std::max(desc.depth >> mip, 1u);
+			uint32_t rowsPerBand = std::max(TexelsPerTask / width, 1u);
+			uint8_t* dst = output.data() + dstLayouts[slice*desc.mipCount + mip].offset;
+
+			for(uint32_t row = 0; row < rows; row += rowsPerBand)
+			{
+				ConvertBand band;
+				band.Src = src + (size_t)row*width*bytes;
+				band.Dst = dst + (size_t)row*width*4;
+				band.Count = (size_t)(std::min(row + rowsPerBand, rows) - row)*width;
+				bands.push_back(band);
+			}
+
+			src += (size_t)rows*width*bytes;
+		}
+	}
+
+	const ConvertParams params = BuildParams(*layout);
+	const PixelConvertPath path = GetPixelConvertPath(options.Path);
+	const ConvertFunction convert = SelectKernel(params, path);
+
+	auto start = std::chrono::steady_clock::now();
+
+	ParallelFor(pool, bands.size(), [&](size_t i)
+	{
+		convert(params, bands[i].Src, bands[i].Dst, bands[i].Count);
+	});
+
+	stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.MegapixelsPerSecond = stats.Seconds > 0.0 ? (double)texels / 1e6 / stats.Seconds : 0.0;
+	stats.Width = desc.width;
+	stats.Height = desc.height;
+	stats.MipCount = desc.mipCount;
+	stats.ArraySize = desc.arraySize;
+	stats.SourceLayout = layout->Name;
+	stats.Path = path;
+
+	return DDS_RESULT_OK;
+}
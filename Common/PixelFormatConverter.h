@@ -0,0 +1,80 @@
+//***************************************************************************************
+// PixelFormatConverter.h
+//
+// Converts legacy (Direct3D 9 style) uncompressed DDS textures that have no DXGI format,
+// or one the device can't sample, to R8G8B8A8_UNORM:
+//   -24-bit R8G8B8 in either byte order, and X8B8G8R8.
+//   -The packed 8 and 16-bit layouts: X1R5G5B5, X4R4G4B4, A8R3G3B2, R3G3B2 and A4L4.
+//   -Optionally B5G6R5, B5G5R5A1 and B4G4R4A4, which DXGI only lists as optional for
+//    sampling, and L8 and A8L8, which otherwise load as R8 and R8G8 and sample as red.
+// Channels are expanded to 8 bits as round(c*255/max); luminance is copied to red, green
+// and blue, and a layout without alpha gets an opaque one.
+//
+// The packed layouts share one kernel that shifts, masks and rescales each channel in
+// 16-bit lanes, 8 texels at a time with SSE2 or 16 with AVX2.  24 and 32-bit texels are
+// rearranged with byte shuffles (SSSE3 or AVX2).  The instruction set is picked at run
+// time from what the CPU reports, and every path produces the same bytes as the scalar
+// reference.
+//
+// Like DDSParser it has no Win32 or Direct3D dependencies.
+//***************************************************************************************
+
+#pragma once
+
+#include <vector>
+
+#include "DDSParser.h"
+
+class ThreadPool;
+
+enum class PixelConvertPath
+{
+	Scalar,
+	SSE,
+	AVX2,
+
+	// AVX2 if the CPU has it, otherwise SSE.
+	Best
+};
+
+struct PixelConvertOptions
+{
+	// Also convert B5G6R5, B5G5R5A1 and B4G4R4A4.
+	bool ExpandPacked16 = false;
+
+	// Also convert L8 and A8L8.
+	bool ExpandLuminance = true;
+
+	PixelConvertPath Path = PixelConvertPath::Best;
+};
+
+struct PixelConvertStats
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 0;
+	uint32_t ArraySize = 0;
+
+	// The layout found in the file, e.g. "R8G8B8", and the path that converted it.
+	const char* SourceLayout = "";
+	PixelConvertPath Path = PixelConvertPath::Scalar;
+
+	// Time spent converting, and the texels of every mip and slice per second of it.
+	double Seconds = 0.0;
+	double MegapixelsPerSecond = 0.0;
+};
+
+// What a request for path resolves to on this CPU.  Paths the CPU lacks fall back to the
+// next one down.
+PixelConvertPath GetPixelConvertPath(PixelConvertPath path);
+
+const char* GetPixelConvertPathName(PixelConvertPath path);
+
+// Rewrites a legacy DDS texture, array of cube faces or volume as R8G8B8A8_UNORM with a
+// DX10 header, keeping its mips.  Fails with DDS_RESULT_NOT_SUPPORTED for DX10 and FourCC
+// files and for layouts that options leave out, so the caller can load those as they are.
+// Mips and row bands go to pool when there is one; don't pass the pool the caller is
+// running on.
+DirectX::DDS_RESULT ConvertLegacyDDS(const uint8_t* ddsData, size_t ddsDataSize,
+	const PixelConvertOptions& options, ThreadPool* pool,
+	std::vector<uint8_t>& output, PixelConvertStats& stats);
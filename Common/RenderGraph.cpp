@@ -0,0 +1,463 @@
+//***************************************************************************************
+// RenderGraph.cpp
+//***************************************************************************************
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool IsSingleWriteState(RenderStates states)
+	{
+		return (states & RenderStates_Write) == states && states != 0 && (states & (states - 1)) == 0;
+	}
+
+	bool IsReadState(RenderStates states)
+	{
+		return (states & RenderStates_Read) == states && states != 0;
+	}
+}
+
+RenderGraph::ResourceId RenderGraph::ImportResource(const std::string& name, RenderStates initialState,
+	RenderStates finalState)
+{
+	Resource r;
+	r.Name = name;
+	r.Imported = true;
+	r.InitialState = initialState;
+	r.FinalState = finalState;
+	mResources.push_back(r);
+	mCompiled = false;
+	return (ResourceId)mResources.size() - 1;
+}
+
+RenderGraph::ResourceId RenderGraph::CreateTransient(const std::string& name, uint64_t size, uint64_t alignment)
+{
+	Resource r;
+	r.Name = name;
+	r.Size = size;
+	r.Alignment = std::max<uint64_t>(alignment, 1);
+	mResources.push_back(r);
+	mCompiled = false;
+	return (ResourceId)mResources.size() - 1;
+}
+
+RenderGraph::PassId RenderGraph::AddPass(const std::string& name, std::function<void()> execute)
+{
+	Pass p;
+	p.Name = name;
+	p.Execute = std::move(execute);
+	mPasses.push_back(std::move(p));
+	mCompiled = false;
+	return (PassId)mPasses.size() - 1;
+}
+
+void RenderGraph::Read(PassId pass, ResourceId resource, RenderStates states)
+{
+	assert(pass < mPasses.size() && resource < mResources.size());
+
+	Access a;
+	a.Resource = resource;
+	a.States = states;
+	a.Write = false;
+	mPasses[pass].Accesses.push_back(a);
+	mCompiled = false;
+}
+
+void RenderGraph::Write(PassId pass, ResourceId resource, RenderState state)
+{
+	assert(pass < mPasses.size() && resource < mResources.size());
+
+	Access a;
+	a.Resource = resource;
+	a.States = state;
+	a.Write = true;
+	mPasses[pass].Accesses.push_back(a);
+	mCompiled = false;
+}
+
+void RenderGraph::SetSideEffects(PassId pass)
+{
+	mPasses[pass].SideEffects = true;
+	mCompiled = false;
+}
+
+RenderGraphResult RenderGraph::Compile()
+{
+	mCompiled = false;
+	mStats = RenderGraphStats();
+	mFinalBarriers.clear();
+	mHeapSize = 0;
+	mHeapAlignment = 1;
+	for(auto& p : mPasses)
+	{
+		p.Culled = false;
+		p.Barriers.clear();
+		p.Activations.clear();
+	}
+	for(auto& r : mResources)
+	{
+		r.Allocated = false;
+		r.Offset = 0;
+		r.CreateState = 0;
+	}
+
+	RenderGraphResult result = Validate();
+	if(result != RenderGraphResult::Ok)
+		return result;
+
+	CullPasses();
+
+	result = PlaceBarriers();
+	if(result != RenderGraphResult::Ok)
+		return result;
+
+	// Aliasing barriers go first in each batch: a transient has to be the active one in
+	// its memory before it can be transitioned.
+	std::vector<std::vector<RenderBarrier>> aliasing(mPasses.size());
+	PlaceTransients(aliasing);
+	for(size_t i = 0; i < mPasses.size(); ++i)
+		mPasses[i].Barriers.insert(mPasses[i].Barriers.begin(), aliasing[i].begin(), aliasing[i].end());
+
+	mStats.PassCount = (uint32_t)mPasses.size();
+	for(const auto& p : mPasses)
+	{
+		mStats.CulledPassCount += p.Culled ? 1 : 0;
+		mStats.BarrierCount += (uint32_t)p.Barriers.size();
+		mStats.BatchCount += p.Barriers.empty() ? 0 : 1;
+	}
+	mStats.BarrierCount += (uint32_t)mFinalBarriers.size();
+	mStats.BatchCount += mFinalBarriers.empty() ? 0 : 1;
+
+	mCompiled = true;
+	return RenderGraphResult::Ok;
+}
+
+void RenderGraph::Execute(const BarrierRecorder& recordBarriers)const
+{
+	assert(mCompiled);
+
+	for(const auto& p : mPasses)
+	{
+		if(p.Culled)
+			continue;
+
+		if(!p.Barriers.empty() || !p.Activations.empty())
+			recordBarriers(p.Barriers, p.Activations);
+
+		if(p.Execute)
+			p.Execute();
+	}
+
+	if(!mFinalBarriers.empty())
+		recordBarriers(mFinalBarriers, std::vector<ResourceId>());
+}
+
+uint32_t RenderGraph::GetPassCount()const
+{
+	return (uint32_t)mPasses.size();
+}
+
+uint32_t RenderGraph::GetResourceCount()const
+{
+	return (uint32_t)mResources.size();
+}
+
+const std::string& RenderGraph::GetPassName(PassId pass)const
+{
+	return mPasses[pass].Name;
+}
+
+const std::string& RenderGraph::GetResourceName(ResourceId resource)const
+{
+	return mResources[resource].Name;
+}
+
+bool RenderGraph::IsImported(ResourceId resource)const
+{
+	return mResources[resource].Imported;
+}
+
+bool RenderGraph::IsCulled(PassId pass)const
+{
+	return mPasses[pass].Culled;
+}
+
+const std::vector<RenderBarrier>& RenderGraph::GetBarriers(PassId pass)const
+{
+	return mPasses[pass].Barriers;
+}
+
+const std::vector<RenderGraph::ResourceId>& RenderGraph::GetActivations(PassId pass)const
+{
+	return mPasses[pass].Activations;
+}
+
+const std::vector<RenderBarrier>& RenderGraph::GetFinalBarriers()const
+{
+	return mFinalBarriers;
+}
+
+bool RenderGraph::IsAllocated(ResourceId resource)const
+{
+	return mResources[resource].Allocated;
+}
+
+uint64_t RenderGraph::GetTransientOffset(ResourceId resource)const
+{
+	return mResources[resource].Offset;
+}
+
+RenderStates RenderGraph::GetTransientCreateState(ResourceId resource)const
+{
+	return mResources[resource].CreateState;
+}
+
+uint64_t RenderGraph::GetTransientHeapSize()const
+{
+	return mHeapSize;
+}
+
+uint64_t RenderGraph::GetTransientHeapAlignment()const
+{
+	return mHeapAlignment;
+}
+
+const RenderGraphStats& RenderGraph::GetStats()const
+{
+	return mStats;
+}
+
+RenderGraphResult RenderGraph::Validate()const
+{
+	std::vector<PassId> lastPass(mResources.size(), (PassId)-1);
+	for(PassId i = 0; i < (PassId)mPasses.size(); ++i)
+	{
+		for(const Access& a : mPasses[i].Accesses)
+		{
+			if(a.Write ? !IsSingleWriteState(a.States) : !IsReadState(a.States))
+				return RenderGraphResult::InvalidState;
+
+			if(lastPass[a.Resource] == i)
+				return RenderGraphResult::ConflictingAccess;
+			lastPass[a.Resource] = i;
+		}
+	}
+	return RenderGraphResult::Ok;
+}
+
+void RenderGraph::CullPasses()
+{
+	// Walking backwards, a resource is needed if a kept pass later on reads it.  Imported
+	// resources are always needed, as whatever the graph leaves in them is its output.
+	// A kept pass's writes leave the resource needed: without a way to say a write covers
+	// all of it, the earlier contents may still show through.
+	std::vector<bool> needed(mResources.size());
+	for(size_t r = 0; r < mResources.size(); ++r)
+		needed[r] = mResources[r].Imported;
+
+	for(size_t i = mPasses.size(); i-- > 0; )
+	{
+		Pass& p = mPasses[i];
+
+		bool keep = p.SideEffects;
+		for(const Access& a : p.Accesses)
+			keep = keep || (a.Write && needed[a.Resource]);
+
+		p.Culled = !keep;
+		if(!keep)
+			continue;
+
+		for(const Access& a : p.Accesses)
+		{
+			if(!a.Write)
+				needed[a.Resource] = true;
+		}
+	}
+}
+
+RenderGraphResult RenderGraph::PlaceBarriers()
+{
+	// Each resource's kept accesses in pass order, grouped: a write on its own, or a run
+	// of reads with their states combined.
+	struct Group
+	{
+		PassId FirstPass;
+		PassId LastPass;
+		RenderStates States;
+		bool Write;
+	};
+
+	std::vector<std::vector<Group>> groups(mResources.size());
+	for(PassId i = 0; i < (PassId)mPasses.size(); ++i)
+	{
+		const Pass& p = mPasses[i];
+		if(p.Culled)
+			continue;
+
+		for(const Access& a : p.Accesses)
+		{
+			std::vector<Group>& g = groups[a.Resource];
+			if(!a.Write && !g.empty() && !g.back().Write)
+			{
+				g.back().States |= a.States;
+				g.back().LastPass = i;
+			}
+			else
+			{
+				g.push_back({ i, i, a.States, a.Write });
+			}
+		}
+	}
+
+	for(ResourceId r = 0; r < (ResourceId)mResources.size(); ++r)
+	{
+		Resource& resource = mResources[r];
+		const std::vector<Group>& g = groups[r];
+
+		if(!resource.Imported)
+		{
+			if(g.empty())
+				continue;
+
+			if(!g.front().Write)
+				return RenderGraphResult::ReadBeforeWrite;
+
+			// Created in the state it's left in, so repeated runs chain without an extra
+			// transition back at the end.
+			resource.Allocated = true;
+			resource.FirstPass = g.front().FirstPass;
+			resource.LastPass = g.back().LastPass;
+			resource.CreateState = g.back().States;
+			mPasses[resource.FirstPass].Activations.push_back(r);
+		}
+
+		RenderStates current = resource.Imported ? resource.InitialState : resource.CreateState;
+		for(size_t i = 0; i < g.size(); ++i)
+		{
+			RenderBarrier b;
+			b.Resource = r;
+			if(g[i].States != current)
+			{
+				b.Type = RenderBarrier::Transition;
+				b.Before = current;
+				b.After = g[i].States;
+				mPasses[g[i].FirstPass].Barriers.push_back(b);
+			}
+			else if(i > 0 && g[i].Write && g[i - 1].Write && g[i].States == RenderState_UnorderedAccess)
+			{
+				b.Type = RenderBarrier::UnorderedAccess;
+				mPasses[g[i].FirstPass].Barriers.push_back(b);
+			}
+
+			current = g[i].States;
+		}
+
+		if(resource.Imported && current != resource.FinalState)
+		{
+			RenderBarrier b;
+			b.Type = RenderBarrier::Transition;
+			b.Resource = r;
+			b.Before = current;
+			b.After = resource.FinalState;
+			mFinalBarriers.push_back(b);
+		}
+	}
+
+	return RenderGraphResult::Ok;
+}
+
+void RenderGraph::PlaceTransients(std::vector<std::vector<RenderBarrier>>& aliasing)
+{
+	std::vector<ResourceId> transients;
+	for(ResourceId r = 0; r < (ResourceId)mResources.size(); ++r)
+	{
+		if(mResources[r].Allocated)
+		{
+			transients.push_back(r);
+			mStats.UnaliasedSize = AlignUp(mStats.UnaliasedSize, mResources[r].Alignment) + mResources[r].Size;
+			mHeapAlignment = std::max(mHeapAlignment, mResources[r].Alignment);
+		}
+	}
+	mStats.TransientCount = (uint32_t)transients.size();
+
+	// Largest first, each at the lowest offset that doesn't overlap the memory of one
+	// already placed whose lifetime overlaps its own.
+	std::stable_sort(transients.begin(), transients.end(), [this](ResourceId a, ResourceId b)
+	{
+		return mResources[a].Size > mResources[b].Size;
+	});
+
+	auto livesOverlap = [this](const Resource& a, const Resource& b)
+	{
+		return a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass;
+	};
+
+	std::vector<ResourceId> placed;
+	for(ResourceId r : transients)
+	{
+		Resource& resource = mResources[r];
+
+		std::vector<const Resource*> conflicts;
+		for(ResourceId other : placed)
+		{
+			if(livesOverlap(resource, mResources[other]))
+				conflicts.push_back(&mResources[other]);
+		}
+		std::sort(conflicts.begin(), conflicts.end(), [](const Resource* a, const Resource* b)
+		{
+			return a->Offset < b->Offset;
+		});
+
+		uint64_t offset = 0;
+		for(const Resource* c : conflicts)
+		{
+			if(offset + resource.Size <= c->Offset)
+				break;
+			offset = std::max(offset, AlignUp(c->Offset + c->Size, resource.Alignment));
+		}
+
+		resource.Offset = offset;
+		mHeapSize = std::max(mHeapSize, offset + resource.Size);
+		placed.push_back(r);
+	}
+	mStats.TransientHeapSize = mHeapSize;
+
+	// A transient shares memory with every other one whose range overlaps its own.  The
+	// one that used the memory last goes in the aliasing barrier; with none before it in
+	// this run, that's the last to use it in the previous run.
+	for(ResourceId r : transients)
+	{
+		const Resource& resource = mResources[r];
+
+		ResourceId before = InvalidResource;
+		ResourceId latest = InvalidResource;
+		for(ResourceId other : transients)
+		{
+			const Resource& o = mResources[other];
+			if(other == r || o.Offset >= resource.Offset + resource.Size || resource.Offset >= o.Offset + o.Size)
+				continue;
+
+			if(o.LastPass < resource.FirstPass && (before == InvalidResource || o.LastPass > mResources[before].LastPass))
+				before = other;
+			if(latest == InvalidResource || o.LastPass > mResources[latest].LastPass)
+				latest = other;
+		}
+
+		if(latest == InvalidResource)
+			continue;
+
+		RenderBarrier b;
+		b.Type = RenderBarrier::Aliasing;
+		b.Resource = r;
+		b.AliasedResource = before != InvalidResource ? before : latest;
+		aliasing[resource.FirstPass].push_back(b);
+	}
+}
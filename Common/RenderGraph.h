@@ -0,0 +1,226 @@
+//***************************************************************************************
+// RenderGraph.h
+//
+// Describes a frame as passes that declare the resources they read and write, and
+// compiles that into the barriers between them.
+//   -Resources are either imported (the back buffer, the depth buffer: anything owned
+//    outside the graph, with the state it starts in and must be left in) or transient
+//    (owned by the graph, only alive between their first and last use).
+//   -Compile drops passes nothing needs: a pass is kept if it has side effects, or writes
+//    an imported resource or a transient that a kept pass reads later.
+//   -Each resource's accesses are walked in pass order.  A run of reads is merged into
+//    one combined read state, so a resource read by several passes is transitioned once.
+//    Writes in the state the resource is already in need no transition; back to back
+//    unordered-access writes get a UAV barrier instead.  Every barrier a pass needs goes
+//    into one batch, recorded before it.
+//   -Transients are placed in one heap.  Those whose lifetimes don't overlap share
+//    memory; the first pass of one that shares starts with an aliasing barrier, and
+//    must write all of it (clear, discard or copy) before anything reads it.
+//
+// Passes run in the order they were added.  The graph knows nothing about Direct3D:
+// states are RenderState flags and transients are a size and alignment, so it compiles
+// anywhere.  RenderGraphRecorder records a compiled graph on a command list.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// The resource states a pass can declare, named after their D3D12_RESOURCE_STATES
+// counterparts.  Read states can be combined; a write is always a single state.
+enum RenderState : uint32_t
+{
+	RenderState_VertexAndConstantBuffer = 1 << 0,
+	RenderState_IndexBuffer = 1 << 1,
+	RenderState_NonPixelShaderResource = 1 << 2,
+	RenderState_PixelShaderResource = 1 << 3,
+	RenderState_DepthRead = 1 << 4,
+	RenderState_IndirectArgument = 1 << 5,
+	RenderState_CopySource = 1 << 6,
+
+	RenderState_RenderTarget = 1 << 7,
+	RenderState_UnorderedAccess = 1 << 8,
+	RenderState_DepthWrite = 1 << 9,
+	RenderState_CopyDest = 1 << 10,
+
+	// Only for the start and end states of imported resources.
+	RenderState_Present = 1 << 11
+};
+
+typedef uint32_t RenderStates;
+
+const RenderStates RenderStates_Read = RenderState_VertexAndConstantBuffer | RenderState_IndexBuffer |
+	RenderState_NonPixelShaderResource | RenderState_PixelShaderResource | RenderState_DepthRead |
+	RenderState_IndirectArgument | RenderState_CopySource;
+
+const RenderStates RenderStates_Write = RenderState_RenderTarget | RenderState_UnorderedAccess |
+	RenderState_DepthWrite | RenderState_CopyDest;
+
+enum class RenderGraphResult
+{
+	Ok,
+
+	// A state that isn't a read state passed to Read, or more or less than one write state
+	// passed to Write.
+	InvalidState,
+
+	// A pass that declares the same resource twice.
+	ConflictingAccess,
+
+	// A transient whose first use is a read, so it would be read uninitialized.
+	ReadBeforeWrite
+};
+
+struct RenderBarrier
+{
+	enum BarrierType
+	{
+		Transition,
+		UnorderedAccess,
+		Aliasing
+	};
+
+	BarrierType Type = Transition;
+	uint32_t Resource = 0;
+
+	// Transition only.
+	RenderStates Before = 0;
+	RenderStates After = 0;
+
+	// Aliasing only: the transient that last used the memory.
+	uint32_t AliasedResource = 0xffffffff;
+};
+
+struct RenderGraphStats
+{
+	uint32_t PassCount = 0;
+	uint32_t CulledPassCount = 0;
+	uint32_t BarrierCount = 0;
+
+	// Passes (and the end of the graph) that need any barrier; one ResourceBarrier call each.
+	uint32_t BatchCount = 0;
+
+	uint32_t TransientCount = 0;
+	uint64_t TransientHeapSize = 0;
+
+	// What the transients would take without sharing memory.
+	uint64_t UnaliasedSize = 0;
+};
+
+class RenderGraph
+{
+public:
+	typedef uint32_t ResourceId;
+	typedef uint32_t PassId;
+
+	static const ResourceId InvalidResource = 0xffffffff;
+
+	// Called before each pass that needs barriers, and once at the end for those that
+	// return the imported resources to their final states (with no activations).
+	// activations are the transients the pass is the first to use.
+	typedef std::function<void(const std::vector<RenderBarrier>& barriers,
+		const std::vector<ResourceId>& activations)> BarrierRecorder;
+
+	RenderGraph() = default;
+	RenderGraph(const RenderGraph& rhs) = delete;
+	RenderGraph& operator=(const RenderGraph& rhs) = delete;
+
+	ResourceId ImportResource(const std::string& name, RenderStates initialState, RenderStates finalState);
+	ResourceId CreateTransient(const std::string& name, uint64_t size, uint64_t alignment);
+
+	PassId AddPass(const std::string& name, std::function<void()> execute);
+	void Read(PassId pass, ResourceId resource, RenderStates states);
+	void Write(PassId pass, ResourceId resource, RenderState state);
+
+	// Keeps the pass even if nothing reads what it writes.
+	void SetSideEffects(PassId pass);
+
+	// Compiles the passes and resources added so far.  The graph can be executed any
+	// number of times afterwards; adding to it again needs another Compile.
+	RenderGraphResult Compile();
+
+	// Runs the passes that weren't culled, in order, with their barriers.
+	void Execute(const BarrierRecorder& recordBarriers)const;
+
+	uint32_t GetPassCount()const;
+	uint32_t GetResourceCount()const;
+	const std::string& GetPassName(PassId pass)const;
+	const std::string& GetResourceName(ResourceId resource)const;
+	bool IsImported(ResourceId resource)const;
+
+	// After Compile.
+	bool IsCulled(PassId pass)const;
+	const std::vector<RenderBarrier>& GetBarriers(PassId pass)const;
+	const std::vector<ResourceId>& GetActivations(PassId pass)const;
+	const std::vector<RenderBarrier>& GetFinalBarriers()const;
+
+	// A transient no kept pass uses isn't allocated.  The others are placed at their
+	// offset in a heap of GetTransientHeapSize() bytes aligned to GetTransientHeapAlignment(),
+	// and are created in the state the graph leaves them in, so every run starts
+	// from where the last one ended.
+	bool IsAllocated(ResourceId resource)const;
+	uint64_t GetTransientOffset(ResourceId resource)const;
+	RenderStates GetTransientCreateState(ResourceId resource)const;
+	uint64_t GetTransientHeapSize()const;
+	uint64_t GetTransientHeapAlignment()const;
+
+	const RenderGraphStats& GetStats()const;
+
+private:
+	struct Access
+	{
+		ResourceId Resource = 0;
+		RenderStates States = 0;
+		bool Write = false;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		std::function<void()> Execute;
+		std::vector<Access> Accesses;
+		bool SideEffects = false;
+
+		// Compiled.
+		bool Culled = false;
+		std::vector<RenderBarrier> Barriers;
+		std::vector<ResourceId> Activations;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		bool Imported = false;
+		RenderStates InitialState = 0;
+		RenderStates FinalState = 0;
+		uint64_t Size = 0;
+		uint64_t Alignment = 1;
+
+		// Compiled; passes are indices into mPasses.
+		bool Allocated = false;
+		PassId FirstPass = 0;
+		PassId LastPass = 0;
+		uint64_t Offset = 0;
+		RenderStates CreateState = 0;
+	};
+
+	RenderGraphResult Validate()const;
+	void CullPasses();
+	RenderGraphResult PlaceBarriers();
+
+	// Fills aliasing with each pass's aliasing barriers.
+	void PlaceTransients(std::vector<std::vector<RenderBarrier>>& aliasing);
+
+private:
+	std::vector<Pass> mPasses;
+	std::vector<Resource> mResources;
+
+	std::vector<RenderBarrier> mFinalBarriers;
+	uint64_t mHeapSize = 0;
+	uint64_t mHeapAlignment = 1;
+	RenderGraphStats mStats;
+	bool mCompiled = false;
+};
@@ -0,0 +1,141 @@
+//***************************************************************************************
+// RenderGraphRecorder.cpp
+//***************************************************************************************
+
+#include "RenderGraphRecorder.h"
+
+RenderGraphRecorder::RenderGraphRecorder(ID3D12Device* device)
+	: md3dDevice(device)
+{
+}
+
+RenderGraph::ResourceId RenderGraphRecorder::CreateTransient(RenderGraph& graph, const std::string& name,
+	const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue)
+{
+	D3D12_RESOURCE_ALLOCATION_INFO info = md3dDevice->GetResourceAllocationInfo(0, 1, &desc);
+	RenderGraph::ResourceId id = graph.CreateTransient(name, info.SizeInBytes, info.Alignment);
+
+	if(mTransientDescs.size() <= id)
+		mTransientDescs.resize(id + 1);
+
+	TransientDesc& t = mTransientDescs[id];
+	t.Desc = desc;
+	t.HasClearValue = clearValue != nullptr;
+	if(clearValue != nullptr)
+		t.ClearValue = *clearValue;
+
+	return id;
+}
+
+void RenderGraphRecorder::Allocate(const RenderGraph& graph)
+{
+	mTransients.clear();
+	mHeap = nullptr;
+
+	mResources.resize(graph.GetResourceCount(), nullptr);
+	mTransients.resize(graph.GetResourceCount());
+
+	if(graph.GetTransientHeapSize() == 0)
+		return;
+
+	// Buffers, textures and render targets in one heap need resource heap tier 2.
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = graph.GetTransientHeapSize();
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	heapDesc.Alignment = graph.GetTransientHeapAlignment() > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ?
+		D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+	ThrowIfFailed(md3dDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(mHeap.GetAddressOf())));
+
+	for(RenderGraph::ResourceId id = 0; id < graph.GetResourceCount(); ++id)
+	{
+		if(graph.IsImported(id) || !graph.IsAllocated(id))
+			continue;
+
+		const TransientDesc& t = mTransientDescs[id];
+		ThrowIfFailed(md3dDevice->CreatePlacedResource(
+			mHeap.Get(),
+			graph.GetTransientOffset(id),
+			&t.Desc,
+			GetD3DStates(graph.GetTransientCreateState(id)),
+			t.HasClearValue ? &t.ClearValue : nullptr,
+			IID_PPV_ARGS(mTransients[id].GetAddressOf())));
+
+		mResources[id] = mTransients[id].Get();
+	}
+}
+
+void RenderGraphRecorder::SetResource(RenderGraph::ResourceId id, ID3D12Resource* resource)
+{
+	if(mResources.size() <= id)
+		mResources.resize(id + 1, nullptr);
+	mResources[id] = resource;
+}
+
+ID3D12Resource* RenderGraphRecorder::GetResource(RenderGraph::ResourceId id)const
+{
+	return id < mResources.size() ? mResources[id] : nullptr;
+}
+
+void RenderGraphRecorder::Record(const RenderGraph& graph, ID3D12GraphicsCommandList* cmdList)
+{
+	graph.Execute([this, cmdList](const std::vector<RenderBarrier>& barriers,
+		const std::vector<RenderGraph::ResourceId>& activations)
+	{
+		mBarriers.clear();
+		for(const RenderBarrier& b : barriers)
+		{
+			ID3D12Resource* resource = GetResource(b.Resource);
+			switch(b.Type)
+			{
+			case RenderBarrier::Transition:
+				mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource,
+					GetD3DStates(b.Before), GetD3DStates(b.After)));
+				break;
+			case RenderBarrier::UnorderedAccess:
+				mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+				break;
+			case RenderBarrier::Aliasing:
+				mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(GetResource(b.AliasedResource), resource));
+				break;
+			}
+		}
+
+		if(!mBarriers.empty())
+			cmdList->ResourceBarrier((UINT)mBarriers.size(), mBarriers.data());
+
+		for(RenderGraph::ResourceId id : activations)
+		{
+			const D3D12_RESOURCE_DESC& desc = mTransientDescs[id].Desc;
+			if(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+				cmdList->DiscardResource(GetResource(id), nullptr);
+		}
+	});
+}
+
+D3D12_RESOURCE_STATES RenderGraphRecorder::GetD3DStates(RenderStates states)
+{
+	static const D3D12_RESOURCE_STATES d3dStates[] =
+	{
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+		D3D12_RESOURCE_STATE_INDEX_BUFFER,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_DEPTH_READ,
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+		D3D12_RESOURCE_STATE_COPY_SOURCE,
+		D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_RESOURCE_STATE_PRESENT
+	};
+
+	D3D12_RESOURCE_STATES result = D3D12_RESOURCE_STATE_COMMON;
+	for(UINT i = 0; i < _countof(d3dStates); ++i)
+	{
+		if(states & (1u << i))
+			result |= d3dStates[i];
+	}
+	return result;
+}
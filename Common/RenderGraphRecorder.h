@@ -0,0 +1,61 @@
+//***************************************************************************************
+// RenderGraphRecorder.h
+//
+// Direct3D 12 backend for RenderGraph.
+//   -CreateTransient sizes a transient from its resource description; Allocate then
+//    creates one heap for the compiled graph and places every allocated transient in it,
+//    in the state the graph leaves it in.
+//   -Imported resources are set each frame (the back buffer changes every frame).
+//   -Record executes the graph, recording each pass's barriers with one ResourceBarrier
+//    call.  Render targets and depth buffers a pass is the first to use are discarded
+//    after their aliasing barrier, since whatever memory they share holds another
+//    transient's contents.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "RenderGraph.h"
+
+class RenderGraphRecorder
+{
+public:
+	explicit RenderGraphRecorder(ID3D12Device* device);
+	RenderGraphRecorder(const RenderGraphRecorder& rhs) = delete;
+	RenderGraphRecorder& operator=(const RenderGraphRecorder& rhs) = delete;
+
+	// clearValue is only for render targets and depth buffers, as for CreatePlacedResource.
+	RenderGraph::ResourceId CreateTransient(RenderGraph& graph, const std::string& name,
+		const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+	// Creates the heap and the placed transients for a compiled graph, replacing any
+	// from before.  The GPU must be done with the old ones.
+	void Allocate(const RenderGraph& graph);
+
+	void SetResource(RenderGraph::ResourceId id, ID3D12Resource* resource);
+	ID3D12Resource* GetResource(RenderGraph::ResourceId id)const;
+
+	void Record(const RenderGraph& graph, ID3D12GraphicsCommandList* cmdList);
+
+	static D3D12_RESOURCE_STATES GetD3DStates(RenderStates states);
+
+private:
+	struct TransientDesc
+	{
+		D3D12_RESOURCE_DESC Desc;
+		bool HasClearValue = false;
+		D3D12_CLEAR_VALUE ClearValue;
+	};
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12Heap> mHeap;
+	std::vector<TransientDesc> mTransientDescs;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mTransients;
+
+	// Indexed by ResourceId; the imported ones point at resources owned elsewhere.
+	std::vector<ID3D12Resource*> mResources;
+
+	std::vector<D3D12_RESOURCE_BARRIER> mBarriers;
+};
@@ -0,0 +1,224 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	const uint32_t EntryMagic = 0x43444853; // "SHDC"
+	const uint32_t EntryVersion = 1;
+
+	// Magic, version, check hash and bytecode size.
+	const size_t EntryHeaderSize = 2*sizeof(uint32_t) + 2*sizeof(uint64_t);
+
+	const uint64_t NameSeed = 0x5348414445524e4dull;
+	const uint64_t CheckSeed = 0x9e3779b97f4a7c15ull;
+
+	// Length prefixed, so no two different requests run together into the same bytes.
+	void AppendField(std::string& key, const std::string& field)
+	{
+		uint64_t size = field.size();
+		key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+		key.append(field);
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+uint64_t MurmurHash64(const void* data, size_t size, uint64_t seed)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ull;
+	const int r = 47;
+
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint64_t h = seed ^ (size*m);
+
+	size_t blocks = size / 8;
+	for(size_t i = 0; i < blocks; ++i)
+	{
+		uint64_t k;
+		std::memcpy(&k, bytes + i*8, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	const uint8_t* tail = bytes + blocks*8;
+	size_t rest = size & 7;
+	if(rest != 0)
+	{
+		for(size_t i = 0; i < rest; ++i)
+			h ^= (uint64_t)tail[i] << (8*i);
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
+
+ShaderCache::ShaderCache(ShaderCacheBackend& backend, const std::wstring& directory)
+	: mBackend(backend),
+	  mDirectory(directory),
+	  mCompilerId(backend.GetCompilerId())
+{
+}
+
+bool ShaderCache::GetBytecode(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+{
+	bytecode.clear();
+
+	// Counted here and added to mStats once, so concurrent calls only meet at the end.
+	ShaderCacheStats stats;
+
+	auto start = std::chrono::steady_clock::now();
+	std::string source;
+	bool preprocessed = mBackend.Preprocess(request, source);
+	stats.PreprocessMs = MillisecondsSince(start);
+
+	ShaderCacheKey key;
+	std::wstring path;
+	EntryResult entry = EntryResult::Missing;
+	if(preprocessed)
+	{
+		key = ComputeKey(request, source, mCompilerId);
+		path = GetEntryPath(key);
+
+		start = std::chrono::steady_clock::now();
+		entry = ReadEntry(path, key, bytecode);
+		stats.LoadMs = MillisecondsSince(start);
+
+		stats.Hits = entry == EntryResult::Loaded ? 1 : 0;
+		stats.Misses = entry == EntryResult::Loaded ? 0 : 1;
+		stats.Rejected = entry == EntryResult::Rejected ? 1 : 0;
+	}
+	else
+	{
+		stats.Uncached = 1;
+	}
+
+	bool compiled = false;
+	if(entry != EntryResult::Loaded)
+	{
+		start = std::chrono::steady_clock::now();
+		compiled = mBackend.Compile(request, bytecode);
+		stats.CompileMs = MillisecondsSince(start);
+
+		if(compiled && preprocessed)
+			WriteEntry(path, key, bytecode);
+	}
+
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mStats.Hits += stats.Hits;
+	mStats.Misses += stats.Misses;
+	mStats.Rejected += stats.Rejected;
+	mStats.Uncached += stats.Uncached;
+	mStats.PreprocessMs += stats.PreprocessMs;
+	mStats.LoadMs += stats.LoadMs;
+	mStats.CompileMs += stats.CompileMs;
+
+	return entry == EntryResult::Loaded || compiled;
+}
+
+ShaderCacheKey ShaderCache::ComputeKey(const ShaderCompileRequest& request,
+	const std::string& preprocessedSource, const std::string& compilerId)
+{
+	std::string material;
+	material.reserve(preprocessedSource.size() + 256);
+
+	AppendField(material, compilerId);
+	AppendField(material, request.Target);
+	AppendField(material, request.EntryPoint);
+	AppendField(material, std::to_string(request.Flags));
+	AppendField(material, std::to_string(request.Defines.size()));
+	for(const auto& define : request.Defines)
+	{
+		AppendField(material, define.first);
+		AppendField(material, define.second);
+	}
+	AppendField(material, preprocessedSource);
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(material.data());
+
+	ShaderCacheKey key;
+	key.Name = MurmurHash64(data, material.size(), NameSeed);
+	key.Check = MurmurHash64(data, material.size(), CheckSeed);
+	return key;
+}
+
+std::wstring ShaderCache::GetEntryPath(const ShaderCacheKey& key)const
+{
+	const wchar_t digits[] = L"0123456789abcdef";
+
+	std::wstring name(16, L'0');
+	for(int i = 0; i < 16; ++i)
+		name[15 - i] = digits[(key.Name >> (4*i)) & 0xf];
+
+	if(mDirectory.empty())
+		return name + L".cso";
+
+	return mDirectory + L"/" + name + L".cso";
+}
+
+ShaderCacheStats ShaderCache::GetStats()const
+{
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	return mStats;
+}
+
+ShaderCache::EntryResult ShaderCache::ReadEntry(const std::wstring& path, const ShaderCacheKey& key,
+	std::vector<uint8_t>& bytecode)
+{
+	std::vector<uint8_t> data;
+	if(!mBackend.Load(path, data))
+		return EntryResult::Missing;
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t check = 0;
+	uint64_t size = 0;
+	if(data.size() >= EntryHeaderSize)
+	{
+		std::memcpy(&magic, data.data(), sizeof(magic));
+		std::memcpy(&version, data.data() + 4, sizeof(version));
+		std::memcpy(&check, data.data() + 8, sizeof(check));
+		std::memcpy(&size, data.data() + 16, sizeof(size));
+	}
+
+	if(magic != EntryMagic || version != EntryVersion || check != key.Check ||
+		size == 0 || size != data.size() - EntryHeaderSize)
+	{
+		return EntryResult::Rejected;
+	}
+
+	bytecode.assign(data.begin() + EntryHeaderSize, data.end());
+	return EntryResult::Loaded;
+}
+
+void ShaderCache::WriteEntry(const std::wstring& path, const ShaderCacheKey& key, const std::vector<uint8_t>& bytecode)
+{
+	std::vector<uint8_t> data(EntryHeaderSize + bytecode.size());
+
+	uint64_t size = bytecode.size();
+	std::memcpy(data.data(), &EntryMagic, sizeof(EntryMagic));
+	std::memcpy(data.data() + 4, &EntryVersion, sizeof(EntryVersion));
+	std::memcpy(data.data() + 8, &key.Check, sizeof(key.Check));
+	std::memcpy(data.data() + 16, &size, sizeof(size));
+	if(!bytecode.empty())
+		std::memcpy(data.data() + EntryHeaderSize, bytecode.data(), bytecode.size());
+
+	// A failed write only costs a compile next time.
+	mBackend.Store(path, data);
+}
@@ -0,0 +1,120 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Keeps compiled shader bytecode on disk so unchanged shaders are not compiled again.
+//   -An entry is keyed by a hash of the preprocessed source, with every #include pulled
+//    in, together with the defines, entry point, target, compile flags and compiler
+//    version.  Editing a shader or anything it includes changes the key; the stale
+//    entry is simply never asked for again.
+//   -Each entry file starts with a small header holding a second hash of the key and
+//    the bytecode size.  A file that doesn't match is treated as a miss and rewritten.
+//   -If the source can't be preprocessed, the shader is compiled without the cache so
+//    the compiler reports the error.
+//
+// The cache knows nothing about Direct3D: preprocessing, compiling and file access go
+// through a ShaderCacheBackend, so the cache logic can be driven by a stub compiler in
+// tests.  d3dUtil::CompileShader wraps it around D3DCompile.  GetBytecode may be
+// called from several threads at once, so the backend must allow that too.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// MurmurHash64A.  Different seeds give unrelated hashes of the same bytes.
+uint64_t MurmurHash64(const void* data, size_t size, uint64_t seed);
+
+struct ShaderCompileRequest
+{
+	std::wstring Filename;
+	std::vector<std::pair<std::string, std::string>> Defines;
+	std::string EntryPoint;
+	std::string Target;
+	uint32_t Flags = 0;
+};
+
+class ShaderCacheBackend
+{
+public:
+	virtual ~ShaderCacheBackend() = default;
+
+	// Names the compiler and its version; bytecode from another compiler never hits.
+	virtual std::string GetCompilerId() = 0;
+
+	// Fills source with the request's file after includes and macros are expanded.
+	virtual bool Preprocess(const ShaderCompileRequest& request, std::string& source) = 0;
+
+	virtual bool Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode) = 0;
+
+	// Whole file reads and writes.  Load returns false if the file isn't there.
+	virtual bool Load(const std::wstring& path, std::vector<uint8_t>& data) = 0;
+	virtual bool Store(const std::wstring& path, const std::vector<uint8_t>& data) = 0;
+};
+
+struct ShaderCacheKey
+{
+	// Names the entry file.
+	uint64_t Name = 0;
+
+	// Stored in the entry and checked on load.
+	uint64_t Check = 0;
+};
+
+struct ShaderCacheStats
+{
+	uint32_t Hits = 0;
+	uint32_t Misses = 0;
+
+	// Entries whose header didn't match their key, and so were compiled again.
+	uint32_t Rejected = 0;
+
+	// Shaders compiled without the cache because preprocessing failed.
+	uint32_t Uncached = 0;
+
+	double PreprocessMs = 0.0;
+	double LoadMs = 0.0;
+	double CompileMs = 0.0;
+};
+
+class ShaderCache
+{
+public:
+	// directory must exist, or the backend's Store must create it.
+	ShaderCache(ShaderCacheBackend& backend, const std::wstring& directory);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+	// Fills bytecode from the cache, or compiles it and adds it to the cache.  Returns
+	// false only if the shader fails to compile.
+	bool GetBytecode(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode);
+
+	static ShaderCacheKey ComputeKey(const ShaderCompileRequest& request,
+		const std::string& preprocessedSource, const std::string& compilerId);
+
+	std::wstring GetEntryPath(const ShaderCacheKey& key)const;
+
+	ShaderCacheStats GetStats()const;
+
+private:
+	enum class EntryResult
+	{
+		Missing,
+		Rejected,
+		Loaded
+	};
+
+	EntryResult ReadEntry(const std::wstring& path, const ShaderCacheKey& key, std::vector<uint8_t>& bytecode);
+	void WriteEntry(const std::wstring& path, const ShaderCacheKey& key, const std::vector<uint8_t>& bytecode);
+
+private:
+	ShaderCacheBackend& mBackend;
+	std::wstring mDirectory;
+	std::string mCompilerId;
+
+	mutable std::mutex mStatsMutex;
+	ShaderCacheStats mStats;
+};
@@ -0,0 +1,180 @@
+//***************************************************************************************
+// ShaderPermutations.cpp
+//***************************************************************************************
+
+#include "ShaderPermutations.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+namespace
+{
+	const uint32_t ProgramShift = 0;
+	const uint32_t StageShift = 4;
+	const uint32_t DirLightShift = 6;
+	const uint32_t PointLightShift = 9;
+	const uint32_t SpotLightShift = 14;
+	const uint32_t FogShift = 19;
+	const uint32_t AlphaTestShift = 20;
+
+	const char* const EntryPoints[] = { "VS", "GS", "PS" };
+	const char* const TargetPrefixes[] = { "vs_", "gs_", "ps_" };
+
+	uint64_t HashBytecode(const std::vector<uint8_t>& bytecode)
+	{
+		// FNV-1a; a match is confirmed by comparing the bytes.
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for(uint8_t b : bytecode)
+		{
+			hash ^= b;
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+}
+
+bool MakePermutationKey(const ShaderPermutation& permutation, ShaderPermutationKey& key)
+{
+	if(permutation.Program >= ShaderMaxPrograms ||
+		permutation.NumDirLights > ShaderMaxDirLights ||
+		permutation.NumPointLights > ShaderMaxPointLights ||
+		permutation.NumSpotLights > ShaderMaxSpotLights)
+	{
+		return false;
+	}
+
+	key = (permutation.Program << ProgramShift) |
+		((uint32_t)permutation.Stage << StageShift) |
+		(permutation.NumDirLights << DirLightShift) |
+		(permutation.NumPointLights << PointLightShift) |
+		(permutation.NumSpotLights << SpotLightShift) |
+		((permutation.Fog ? 1u : 0u) << FogShift) |
+		((permutation.AlphaTest ? 1u : 0u) << AlphaTestShift);
+	return true;
+}
+
+ShaderPermutation GetPermutation(ShaderPermutationKey key)
+{
+	ShaderPermutation permutation;
+	permutation.Program = (key >> ProgramShift) & 0xf;
+	permutation.Stage = (ShaderStage)((key >> StageShift) & 0x3);
+	permutation.NumDirLights = (key >> DirLightShift) & 0x7;
+	permutation.NumPointLights = (key >> PointLightShift) & 0x1f;
+	permutation.NumSpotLights = (key >> SpotLightShift) & 0x1f;
+	permutation.Fog = ((key >> FogShift) & 1) != 0;
+	permutation.AlphaTest = ((key >> AlphaTestShift) & 1) != 0;
+	return permutation;
+}
+
+ShaderLibrary::ShaderLibrary(const std::vector<std::wstring>& programs, const std::string& shaderModel)
+	: mPrograms(programs),
+	  mShaderModel(shaderModel)
+{
+}
+
+ShaderCompileRequest ShaderLibrary::GetCompileRequest(ShaderPermutationKey key)const
+{
+	ShaderPermutation permutation = GetPermutation(key);
+	uint32_t stage = std::min((uint32_t)permutation.Stage, 2u);
+
+	ShaderCompileRequest request;
+	if(permutation.Program < mPrograms.size())
+		request.Filename = mPrograms[permutation.Program];
+	request.EntryPoint = EntryPoints[stage];
+	request.Target = TargetPrefixes[stage] + mShaderModel;
+
+	request.Defines.emplace_back("NUM_DIR_LIGHTS", std::to_string(permutation.NumDirLights));
+	request.Defines.emplace_back("NUM_POINT_LIGHTS", std::to_string(permutation.NumPointLights));
+	request.Defines.emplace_back("NUM_SPOT_LIGHTS", std::to_string(permutation.NumSpotLights));
+	if(permutation.Fog)
+		request.Defines.emplace_back("FOG", "1");
+	if(permutation.AlphaTest)
+		request.Defines.emplace_back("ALPHA_TEST", "1");
+
+	return request;
+}
+
+bool ShaderLibrary::Build(const std::vector<ShaderPermutationKey>& manifest, const CompileFunction& compile,
+	ThreadPool* pool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<ShaderPermutationKey> keys;
+	std::unordered_set<ShaderPermutationKey> listed;
+	for(ShaderPermutationKey key : manifest)
+	{
+		if(mIndex.count(key) == 0 && listed.insert(key).second)
+		{
+			if(GetPermutation(key).Program >= mPrograms.size())
+				return false;
+			keys.push_back(key);
+		}
+	}
+
+	std::vector<std::vector<uint8_t>> results(keys.size());
+	std::vector<char> compiled(keys.size(), 0);
+
+	ParallelFor(pool, keys.size(), [&](size_t i)
+	{
+		compiled[i] = compile(GetCompileRequest(keys[i]), results[i]) ? 1 : 0;
+	});
+
+	for(char ok : compiled)
+	{
+		if(!ok)
+			return false;
+	}
+
+	std::unordered_map<uint64_t, std::vector<uint32_t>> blobsByHash;
+	for(uint32_t i = 0; i < (uint32_t)mBytecode.size(); ++i)
+		blobsByHash[HashBytecode(mBytecode[i])].push_back(i);
+
+	for(size_t i = 0; i < keys.size(); ++i)
+	{
+		std::vector<uint32_t>& candidates = blobsByHash[HashBytecode(results[i])];
+
+		uint32_t index = (uint32_t)mBytecode.size();
+		for(uint32_t candidate : candidates)
+		{
+			if(mBytecode[candidate] == results[i])
+			{
+				index = candidate;
+				break;
+			}
+		}
+
+		if(index == mBytecode.size())
+		{
+			candidates.push_back(index);
+			mBytecode.push_back(std::move(results[i]));
+		}
+
+		mIndex[keys[i]] = index;
+	}
+
+	mStats.PermutationCount = (uint32_t)mIndex.size();
+	mStats.UniqueCount = (uint32_t)mBytecode.size();
+	mStats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+ShaderBytecodeView ShaderLibrary::GetBytecode(ShaderPermutationKey key)const
+{
+	ShaderBytecodeView view;
+
+	auto it = mIndex.find(key);
+	if(it != mIndex.end())
+	{
+		view.Data = mBytecode[it->second].data();
+		view.Size = mBytecode[it->second].size();
+	}
+
+	return view;
+}
+
+const ShaderLibraryStats& ShaderLibrary::GetStats()const
+{
+	return mStats;
+}
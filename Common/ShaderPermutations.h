@@ -0,0 +1,109 @@
+//***************************************************************************************
+// ShaderPermutations.h
+//
+// The lighting shaders are specialized at compile time by NUM_DIR_LIGHTS,
+// NUM_POINT_LIGHTS, NUM_SPOT_LIGHTS, FOG and ALPHA_TEST.  A ShaderPermutation names one
+// such variant of one stage of one program (source file), and packs into a 32-bit key.
+//
+// ShaderLibrary compiles a manifest of keys, the variants a scene needs, on a thread
+// pool and keeps the bytecode by key.  Variants whose bytecode comes out identical (a
+// vertex shader that never reads FOG, say) share one copy.
+//
+// Like ShaderCache it has no Direct3D dependencies; compiling goes through a function
+// the caller supplies.
+//***************************************************************************************
+
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+
+#include "ShaderCache.h"
+
+class ThreadPool;
+
+enum class ShaderStage
+{
+	Vertex,
+	Geometry,
+	Pixel
+};
+
+struct ShaderPermutation
+{
+	// Index into the programs the library was created with.
+	uint32_t Program = 0;
+	ShaderStage Stage = ShaderStage::Vertex;
+
+	uint32_t NumDirLights = 0;
+	uint32_t NumPointLights = 0;
+	uint32_t NumSpotLights = 0;
+	bool Fog = false;
+	bool AlphaTest = false;
+};
+
+typedef uint32_t ShaderPermutationKey;
+
+// Bits of the key, low to high: program 4, stage 2, directional lights 3, point lights 5,
+// spot lights 5, fog 1, alpha test 1.
+const uint32_t ShaderMaxPrograms = 16;
+const uint32_t ShaderMaxDirLights = 7;
+const uint32_t ShaderMaxPointLights = 31;
+const uint32_t ShaderMaxSpotLights = 31;
+
+// Returns false if a field doesn't fit in its bits.
+bool MakePermutationKey(const ShaderPermutation& permutation, ShaderPermutationKey& key);
+ShaderPermutation GetPermutation(ShaderPermutationKey key);
+
+struct ShaderBytecodeView
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+};
+
+struct ShaderLibraryStats
+{
+	// Distinct keys in the library, and the bytecode blobs they share.
+	uint32_t PermutationCount = 0;
+	uint32_t UniqueCount = 0;
+
+	// Wall clock time of the last Build.
+	double Seconds = 0.0;
+};
+
+class ShaderLibrary
+{
+public:
+	// Fills bytecode for request; returns false if it doesn't compile.  Called from the
+	// pool's threads.
+	typedef std::function<bool(const ShaderCompileRequest&, std::vector<uint8_t>&)> CompileFunction;
+
+	// programs[i] is the source file of program i.  Every program has VS, GS and PS entry
+	// points as needed, compiled for the given shader model ("5_1").
+	ShaderLibrary(const std::vector<std::wstring>& programs, const std::string& shaderModel);
+	ShaderLibrary(const ShaderLibrary& rhs) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary& rhs) = delete;
+
+	ShaderCompileRequest GetCompileRequest(ShaderPermutationKey key)const;
+
+	// Compiles the keys in manifest that the library doesn't have yet; a key listed twice
+	// compiles once.  Each compile is a task on pool when there is one; don't pass the pool
+	// the caller is running on.  Returns false if any of them failed, in which case none
+	// of the manifest is added.
+	bool Build(const std::vector<ShaderPermutationKey>& manifest, const CompileFunction& compile, ThreadPool* pool);
+
+	// Empty if the key hasn't been built.  The bytecode stays put for the life of the
+	// library, so views can be kept.
+	ShaderBytecodeView GetBytecode(ShaderPermutationKey key)const;
+
+	const ShaderLibraryStats& GetStats()const;
+
+private:
+	std::vector<std::wstring> mPrograms;
+	std::string mShaderModel;
+
+	std::vector<std::vector<uint8_t>> mBytecode;
+	std::unordered_map<ShaderPermutationKey, uint32_t> mIndex;
+
+	ShaderLibraryStats mStats;
+};
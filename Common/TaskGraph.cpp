@@ -0,0 +1,161 @@
+//***************************************************************************************
+// TaskGraph.cpp
+//***************************************************************************************
+
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+
+#include <cassert>
+
+namespace
+{
+	double MillisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+TaskGraph::TaskId TaskGraph::AddTask(const std::string& name, TaskThread thread,
+	const std::vector<TaskId>& dependencies, std::function<void()> task)
+{
+	TaskId id = (TaskId)mTasks.size();
+
+	Task t;
+	t.Function = std::move(task);
+	t.DependencyCount = (uint32_t)dependencies.size();
+	mTasks.push_back(std::move(t));
+
+	for(TaskId dependency : dependencies)
+	{
+		assert(dependency < id);
+		mTasks[dependency].Dependents.push_back(id);
+	}
+
+	TaskTiming timing;
+	timing.Name = name;
+	timing.Thread = thread;
+	mTimings.push_back(timing);
+
+	return id;
+}
+
+void TaskGraph::Run(ThreadPool* pool)
+{
+	mStart = std::chrono::steady_clock::now();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mPool = pool;
+	mMainQueue.clear();
+	mRunningWorkers = 0;
+	mError = nullptr;
+
+	mWaiting.resize(mTasks.size());
+	for(TaskId id = 0; id < (TaskId)mTasks.size(); ++id)
+	{
+		mWaiting[id] = mTasks[id].DependencyCount;
+		mTimings[id].Ran = false;
+	}
+
+	for(TaskId id = 0; id < (TaskId)mTasks.size(); ++id)
+	{
+		if(mWaiting[id] == 0)
+			Schedule(id);
+	}
+
+	// Main tasks run here as they become ready.  Once nothing is queued and no worker is
+	// running, no task is left that could make another one ready.
+	for(;;)
+	{
+		mChanged.wait(lock, [this]() { return !mMainQueue.empty() || mRunningWorkers == 0; });
+
+		if(mError != nullptr)
+			mMainQueue.clear();
+
+		if(!mMainQueue.empty())
+		{
+			TaskId id = mMainQueue.front();
+			mMainQueue.pop_front();
+
+			lock.unlock();
+			Execute(id);
+			lock.lock();
+		}
+		else if(mRunningWorkers == 0)
+		{
+			break;
+		}
+	}
+
+	mTotalMs = MillisecondsBetween(mStart, std::chrono::steady_clock::now());
+
+	if(mError != nullptr)
+		std::rethrow_exception(mError);
+}
+
+const std::vector<TaskTiming>& TaskGraph::GetTimings()const
+{
+	return mTimings;
+}
+
+double TaskGraph::GetTotalMs()const
+{
+	return mTotalMs;
+}
+
+void TaskGraph::Schedule(TaskId id)
+{
+	if(mTimings[id].Thread == TaskThread::Main || mPool == nullptr)
+	{
+		mMainQueue.push_back(id);
+		mChanged.notify_all();
+		return;
+	}
+
+	++mRunningWorkers;
+	mPool->Submit([this, id]()
+	{
+		Execute(id);
+	});
+}
+
+void TaskGraph::Execute(TaskId id)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::exception_ptr error;
+	try
+	{
+		mTasks[id].Function();
+	}
+	catch(...)
+	{
+		error = std::current_exception();
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	TaskTiming& timing = mTimings[id];
+	timing.StartMs = MillisecondsBetween(mStart, start);
+	timing.Ms = MillisecondsBetween(start, end);
+	timing.Ran = true;
+
+	if(error != nullptr && mError == nullptr)
+		mError = error;
+
+	if(mError == nullptr)
+	{
+		for(TaskId dependent : mTasks[id].Dependents)
+		{
+			if(--mWaiting[dependent] == 0)
+				Schedule(dependent);
+		}
+	}
+
+	bool worker = timing.Thread == TaskThread::Worker && mPool != nullptr;
+	if(worker)
+		--mRunningWorkers;
+
+	mChanged.notify_all();
+}
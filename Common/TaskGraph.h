@@ -0,0 +1,90 @@
+//***************************************************************************************
+// TaskGraph.h
+//
+// Runs a set of tasks, each once, as soon as the tasks it depends on have finished.
+// Worker tasks go to a ThreadPool; main tasks run on the thread that calls Run, in the
+// order they become ready.  Anything that records on a command list, or waits on the pool
+// itself, belongs on the main thread.
+//
+// If a task throws, no task that hasn't started yet is started, and Run rethrows the
+// first exception once the running ones are done.
+//***************************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+enum class TaskThread
+{
+	Worker,
+	Main
+};
+
+struct TaskTiming
+{
+	std::string Name;
+	TaskThread Thread = TaskThread::Worker;
+
+	// Milliseconds from the start of Run.
+	double StartMs = 0.0;
+	double Ms = 0.0;
+
+	bool Ran = false;
+};
+
+class TaskGraph
+{
+public:
+	typedef uint32_t TaskId;
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph& rhs) = delete;
+	TaskGraph& operator=(const TaskGraph& rhs) = delete;
+
+	// dependencies must already have been added, so the graph can't have a cycle.
+	TaskId AddTask(const std::string& name, TaskThread thread, const std::vector<TaskId>& dependencies,
+		std::function<void()> task);
+
+	// Without a pool every task runs on the calling thread.
+	void Run(ThreadPool* pool);
+
+	const std::vector<TaskTiming>& GetTimings()const;
+	double GetTotalMs()const;
+
+private:
+	struct Task
+	{
+		std::function<void()> Function;
+		std::vector<TaskId> Dependents;
+		uint32_t DependencyCount = 0;
+	};
+
+	// Called with mMutex held.
+	void Schedule(TaskId id);
+	void Execute(TaskId id);
+
+private:
+	std::vector<Task> mTasks;
+	std::vector<TaskTiming> mTimings;
+	double mTotalMs = 0.0;
+
+	// State of the current Run.
+	ThreadPool* mPool = nullptr;
+	std::chrono::steady_clock::time_point mStart;
+	std::mutex mMutex;
+	std::condition_variable mChanged;
+	std::vector<uint32_t> mWaiting;
+	std::deque<TaskId> mMainQueue;
+	uint32_t mRunningWorkers = 0;
+	std::exception_ptr mError;
+};
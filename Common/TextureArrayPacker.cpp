@@ -0,0 +1,86 @@
+//***************************************************************************************
+// TextureArrayPacker.cpp
+//***************************************************************************************
+
+#include "TextureArrayPacker.h"
+
+#include <cstring>
+
+using namespace DirectX;
+
+bool CanShareDDSTextureArray(const DDSTextureDesc& a, const DDSTextureDesc& b)
+{
+	return a.dimension == DDS_DIMENSION_TEXTURE2D && b.dimension == DDS_DIMENSION_TEXTURE2D &&
+		!a.isCubeMap && !b.isCubeMap &&
+		a.arraySize == 1 && b.arraySize == 1 &&
+		a.width == b.width && a.height == b.height &&
+		a.format == b.format && a.mipCount == b.mipCount;
+}
+
+std::vector<std::vector<size_t>> GroupDDSTexturesForArrays(const DDSTextureDesc* descs, size_t count)
+{
+	std::vector<std::vector<size_t>> groups;
+	for(size_t i = 0; i < count; ++i)
+	{
+		bool placed = false;
+		for(auto& group : groups)
+		{
+			if(CanShareDDSTextureArray(descs[group[0]], descs[i]))
+			{
+				group.push_back(i);
+				placed = true;
+				break;
+			}
+		}
+
+		if(!placed)
+			groups.push_back(std::vector<size_t>(1, i));
+	}
+
+	return groups;
+}
+
+DDS_RESULT PackDDSTextureArray(const DDSFileView* files, size_t count, std::vector<uint8_t>& output)
+{
+	output.clear();
+	if(files == nullptr || count == 0)
+		return DDS_RESULT_INVALID_ARG;
+
+	std::vector<DDSTextureDesc> descs(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		DDS_RESULT result = ParseDDSTexture(files[i].Data, files[i].Size, descs[i]);
+		if(result != DDS_RESULT_OK)
+			return result;
+
+		if(!CanShareDDSTextureArray(descs[0], descs[i]))
+			return DDS_RESULT_NOT_SUPPORTED;
+	}
+
+	// A single-slice file is its mip chain with nothing after it, and an array is its
+	// slices one after another, so the surfaces copy over whole.
+	std::vector<DDSSubresourceLayout> layouts(descs[0].mipCount);
+	size_t sliceBytes = 0;
+	for(size_t i = 0; i < count; ++i)
+	{
+		DDSLayoutInfo info;
+		DDS_RESULT result = GetDDSSubresourceLayout(descs[i], 0, layouts.data(), layouts.size(), info);
+		if(result != DDS_RESULT_OK)
+			return result;
+
+		const DDSSubresourceLayout& last = layouts[descs[i].mipCount - 1];
+		sliceBytes = last.offset + last.slicePitch - descs[i].dataOffset;
+	}
+
+	DDSTextureDesc desc = descs[0];
+	desc.arraySize = (uint32_t)count;
+
+	output.resize(DDS_DX10_HEADERS_SIZE + sliceBytes*count);
+	WriteDDSHeaders(desc, output.data());
+
+	uint8_t* dst = output.data() + DDS_DX10_HEADERS_SIZE;
+	for(size_t i = 0; i < count; ++i, dst += sliceBytes)
+		std::memcpy(dst, files[i].Data + descs[i].dataOffset, sliceBytes);
+
+	return DDS_RESULT_OK;
+}
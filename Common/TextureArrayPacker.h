@@ -0,0 +1,35 @@
+//***************************************************************************************
+// TextureArrayPacker.h
+//
+// Packs single 2D DDS textures of the same size, format and mip count into one texture
+// array, the way treeArray.dds was authored.  Materials that used to point at separate
+// textures then share one descriptor and pick their texture with an array slice index,
+// so a run of draws needs one descriptor table change per array instead of one per
+// texture.
+//
+// Like DDSParser it has no Win32 or Direct3D dependencies.
+//***************************************************************************************
+
+#pragma once
+
+#include <vector>
+
+#include "DDSParser.h"
+
+// A DDS file in memory (or a mapping of one).
+struct DDSFileView
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+};
+
+// True if both are single-slice 2D textures that could be slices of the same array.
+bool CanShareDDSTextureArray(const DirectX::DDSTextureDesc& a, const DirectX::DDSTextureDesc& b);
+
+// Splits [0, count) into groups of textures that can share an array, keeping the input
+// order within and between groups.  Textures without a match form a group of one.
+std::vector<std::vector<size_t>> GroupDDSTexturesForArrays(const DirectX::DDSTextureDesc* descs, size_t count);
+
+// Writes a DDS texture array with one slice per file, in order.  Fails with
+// DDS_RESULT_NOT_SUPPORTED unless every pair passes CanShareDDSTextureArray.
+DirectX::DDS_RESULT PackDDSTextureArray(const DDSFileView* files, size_t count, std::vector<uint8_t>& output);
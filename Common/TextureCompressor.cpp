@@ -0,0 +1,163 @@
+//***************************************************************************************
+// TextureCompressor.cpp
+//***************************************************************************************
+
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace DirectX;
+
+namespace
+{
+	bool IsSRGB(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ||
+			format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+			format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+	}
+
+	bool IsBGR(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+			format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+	}
+
+	bool HasNoAlpha(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+	}
+}
+
+bool IsBCCompressible(DXGI_FORMAT format)
+{
+	switch(format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+DXGI_FORMAT GetBCDXGIFormat(BCFormat format, bool srgb)
+{
+	switch(format)
+	{
+	case BCFormat::BC1: return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case BCFormat::BC3: return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	default:            return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	}
+}
+
+DDS_RESULT CompressDDSTexture(const uint8_t* ddsData, size_t ddsDataSize,
+	BCFormat format, BCQuality quality, ThreadPool* pool,
+	std::vector<uint8_t>& output, TextureCompressStats& stats)
+{
+	output.clear();
+	stats = TextureCompressStats();
+
+	DDSTextureDesc desc;
+	DDS_RESULT result = ParseDDSTexture(ddsData, ddsDataSize, desc);
+	if(result != DDS_RESULT_OK)
+		return result;
+
+	if(desc.dimension != DDS_DIMENSION_TEXTURE2D || !IsBCCompressible(desc.format))
+		return DDS_RESULT_NOT_SUPPORTED;
+
+	std::vector<DDSSubresourceLayout> layouts(desc.mipCount*desc.arraySize);
+	DDSLayoutInfo info;
+	result = GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info);
+	if(result != DDS_RESULT_OK)
+		return result;
+
+	size_t surfaceBytes = 0;
+	for(uint32_t mip = 0; mip < desc.mipCount; ++mip)
+	{
+		uint32_t w = std::max(desc.width >> mip, 1u);
+		uint32_t h = std::max(desc.height >> mip, 1u);
+		surfaceBytes += GetBCImageBytes(format, w, h);
+	}
+
+	bool opaque = format == BCFormat::BC1 || HasNoAlpha(desc.format);
+
+	DDSTextureDesc outDesc = desc;
+	outDesc.format = GetBCDXGIFormat(format, IsSRGB(desc.format));
+	outDesc.alphaMode = opaque ? DDS_ALPHA_MODE_OPAQUE : desc.alphaMode;
+
+	output.resize(DDS_DX10_HEADERS_SIZE + surfaceBytes*desc.arraySize);
+
+	uint8_t* dst = output.data();
+	WriteDDSHeaders(outDesc, dst);
+	dst += DDS_DX10_HEADERS_SIZE;
+
+	// BGR surfaces are swizzled into RGBA here first; RGBA ones are read in place.
+	bool convert = IsBGR(desc.format);
+	std::vector<uint8_t> rgba;
+
+	BCErrorStats error;
+	uint64_t texels = 0;
+	double seconds = 0.0;
+
+	for(uint32_t slice = 0; slice < desc.arraySize; ++slice)
+	{
+		for(uint32_t mip = 0; mip < desc.mipCount; ++mip)
+		{
+			const DDSSubresourceLayout& layout = layouts[slice*desc.mipCount + mip];
+
+			BCImage image;
+			image.Width = std::max(desc.width >> mip, 1u);
+			image.Height = std::max(desc.height >> mip, 1u);
+			image.Pixels = ddsData + layout.offset;
+			image.RowPitch = layout.rowPitch;
+
+			if(convert)
+			{
+				rgba.resize((size_t)image.Width*image.Height*4);
+				for(uint32_t y = 0; y < image.Height; ++y)
+				{
+					const uint8_t* src = image.Pixels + y*image.RowPitch;
+					uint8_t* row = rgba.data() + (size_t)y*image.Width*4;
+					for(uint32_t x = 0; x < image.Width; ++x, src += 4, row += 4)
+					{
+						row[0] = src[2];
+						row[1] = src[1];
+						row[2] = src[0];
+						row[3] = HasNoAlpha(desc.format) ? 255 : src[3];
+					}
+				}
+
+				image.Pixels = rgba.data();
+				image.RowPitch = (size_t)image.Width*4;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			CompressBCImage(format, quality, image, dst, pool);
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			AccumulateBCError(format, image, dst, error);
+
+			dst += GetBCImageBytes(format, image.Width, image.Height);
+			texels += (uint64_t)image.Width*image.Height;
+			stats.InputBytes += layout.slicePitch;
+		}
+	}
+
+	stats.Width = desc.width;
+	stats.Height = desc.height;
+	stats.MipCount = desc.mipCount;
+	stats.ArraySize = desc.arraySize;
+	stats.OutputBytes = surfaceBytes*desc.arraySize;
+	stats.Seconds = seconds;
+	stats.MegapixelsPerSecond = seconds > 0.0 ? (double)texels / 1e6 / seconds : 0.0;
+	stats.Psnr = error.GetPsnr();
+
+	return DDS_RESULT_OK;
+}
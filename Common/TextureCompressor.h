@@ -0,0 +1,45 @@
+//***************************************************************************************
+// TextureCompressor.h
+//
+// Turns an uncompressed 32-bit DDS texture into a BC1, BC3 or BC7 one.  Every mip and
+// array slice goes through BCnEncoder, and the result is a complete DDS file with a DX10
+// header.  Like DDSParser it has no Win32 or Direct3D dependencies; the loader uses it on
+// load and AssetTool -compress uses it for batch conversion.
+//***************************************************************************************
+
+#pragma once
+
+#include <vector>
+
+#include "BCnEncoder.h"
+#include "DDSParser.h"
+
+struct TextureCompressStats
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 0;
+	uint32_t ArraySize = 0;
+
+	// Surface data only, without the headers.
+	uint64_t InputBytes = 0;
+	uint64_t OutputBytes = 0;
+
+	// Time spent compressing, and the texels of every mip and slice per second of it.
+	double Seconds = 0.0;
+	double MegapixelsPerSecond = 0.0;
+
+	// Over every mip and slice.
+	double Psnr = 0.0;
+};
+
+// The 8-bit RGBA, BGRA and BGRX formats, linear or sRGB.
+bool IsBCCompressible(DXGI_FORMAT format);
+
+DXGI_FORMAT GetBCDXGIFormat(BCFormat format, bool srgb);
+
+// Fails with DDS_RESULT_NOT_SUPPORTED for volume textures and for formats that
+// IsBCCompressible rejects.  Pass a pool that the caller isn't running on, or nullptr.
+DirectX::DDS_RESULT CompressDDSTexture(const uint8_t* ddsData, size_t ddsDataSize,
+	BCFormat format, BCQuality quality, ThreadPool* pool,
+	std::vector<uint8_t>& output, TextureCompressStats& stats);
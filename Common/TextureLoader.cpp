@@ -0,0 +1,294 @@
+//***************************************************************************************
+// TextureLoader.cpp
+//***************************************************************************************
+
+#include "TextureLoader.h"
+
+using namespace DirectX;
+
+TextureLoader::TextureLoader(ThreadPool& pool, bool memoryMapped)
+	: mPool(pool),
+	  mMemoryMapped(memoryMapped)
+{
+	__int64 countsPerSec;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	mSecondsPerCount = 1.0 / (double)countsPerSec;
+}
+
+TextureLoader::~TextureLoader()
+{
+	// The workers write into mPending, so they must be done before it goes away.
+	WaitForLoads();
+}
+
+void TextureLoader::SetPixelConversion(ID3D12Device* device)
+{
+	mConvertPixels = true;
+	mPixelOptions.ExpandPacked16 = false;
+
+	const DXGI_FORMAT packedFormats[] =
+	{
+		DXGI_FORMAT_B5G6R5_UNORM,
+		DXGI_FORMAT_B5G5R5A1_UNORM,
+		DXGI_FORMAT_B4G4R4A4_UNORM
+	};
+
+	for(DXGI_FORMAT format : packedFormats)
+	{
+		D3D12_FEATURE_DATA_FORMAT_SUPPORT support = { format };
+		if(FAILED(device->CheckFeatureSupport(D3D12_FEATURE_FORMAT_SUPPORT, &support, sizeof(support))) ||
+			!(support.Support1 & D3D12_FORMAT_SUPPORT1_SHADER_SAMPLE))
+		{
+			mPixelOptions.ExpandPacked16 = true;
+		}
+	}
+}
+
+void TextureLoader::SetMipGeneration(MipFilter filter, bool treatAsSrgb)
+{
+	mGenerateMips = true;
+	mMipFilter = filter;
+	mMipTreatAsSrgb = treatAsSrgb;
+}
+
+void TextureLoader::SetCompression(BCFormat format, BCQuality quality)
+{
+	mCompress = true;
+	mCompressFormat = format;
+	mCompressQuality = quality;
+}
+
+void TextureLoader::SetAssetArchive(const AssetArchive* archive)
+{
+	mArchive = archive;
+}
+
+void TextureLoader::Enqueue(Texture* tex, size_t maxsize)
+{
+	if(mPending.empty())
+		QueryPerformanceCounter((LARGE_INTEGER*)&mStartTime);
+
+	auto pending = std::make_unique<PendingTexture>();
+	pending->Tex = tex;
+	pending->MaxSize = maxsize;
+	pending->ConvertPixels = mConvertPixels;
+	pending->PixelOptions = mPixelOptions;
+	pending->GenerateMips = mGenerateMips;
+	pending->MipFilterType = mMipFilter;
+	pending->MipTreatAsSrgb = mMipTreatAsSrgb;
+	pending->Compress = mCompress;
+	pending->CompressFormat = mCompressFormat;
+	pending->CompressQuality = mCompressQuality;
+	if(mArchive != nullptr)
+	{
+		pending->Archive = mArchive;
+		pending->ArchiveEntry = mArchive->Find(tex->Filename);
+	}
+
+	PendingTexture* p = pending.get();
+	bool memoryMapped = mMemoryMapped;
+	p->Done = mPool.Submit([p, memoryMapped]()
+	{
+		if(p->ArchiveEntry >= 0)
+			p->Result = LoadArchivedTexture(*p);
+		else if(memoryMapped)
+			p->Result = MapDDSTextureDataFromFile12(p->Tex->Filename.c_str(), p->Data, p->MaxSize);
+		else
+			p->Result = LoadDDSTextureDataFromFile12(p->Tex->Filename.c_str(), p->Data, p->MaxSize);
+
+		if(p->ConvertPixels && (SUCCEEDED(p->Result) || p->Result == HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED)))
+			ConvertPixelFormat(*p);
+
+		if(SUCCEEDED(p->Result) && p->GenerateMips)
+			GenerateTextureMips(*p);
+
+		if(SUCCEEDED(p->Result) && p->Compress)
+			CompressTexture(*p);
+	});
+
+	mPending.push_back(std::move(pending));
+}
+
+void TextureLoader::Finish(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+{
+	WaitForLoads();
+
+	__int64 loadedTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&loadedTime);
+
+	// Take the queue first so a failure below doesn't leave it half processed.
+	std::vector<std::unique_ptr<PendingTexture>> pending;
+	pending.swap(mPending);
+
+	mStats.ConvertedCount = 0;
+	mStats.ConvertMs = 0.0;
+	mStats.MipGeneratedCount = 0;
+	mStats.MipGenerateMs = 0.0;
+	mStats.CompressedCount = 0;
+	mStats.CompressMs = 0.0;
+
+	// Every texture's transition out of COPY_DEST, recorded together once the copies are.
+	std::vector<D3D12_RESOURCE_BARRIER> readBarriers;
+	readBarriers.reserve(pending.size());
+
+	for(auto& p : pending)
+	{
+		ThrowIfFailed(p->Result);
+		ThrowIfFailed(CreateDDSTextureFromData12(device, cmdList, p->Data,
+			p->Tex->Resource, p->Tex->UploadHeap, &readBarriers));
+
+		// The bits are in the upload heap now; drop the file data (or unmap it).
+		p->Data = DDSTextureData12();
+
+		if(p->Converted)
+		{
+			const PixelConvertStats& cs = p->ConvertStats;
+			std::wstring text = L"Converted " + p->Tex->Filename + L" from " + AnsiToWString(cs.SourceLayout) +
+				L" (" + AnsiToWString(GetPixelConvertPathName(cs.Path)) + L"): " +
+				std::to_wstring(cs.MegapixelsPerSecond) + L" MP/s\n";
+			OutputDebugString(text.c_str());
+
+			mStats.ConvertedCount++;
+			mStats.ConvertMs += cs.Seconds*1000.0;
+		}
+
+		if(p->MipsGenerated)
+		{
+			const MipGenerateStats& ms = p->MipStats;
+			std::wstring text = L"Generated " + std::to_wstring(ms.MipCount) + L" mips for " +
+				p->Tex->Filename + L": " + std::to_wstring(ms.MegapixelsPerSecond) + L" MP/s\n";
+			OutputDebugString(text.c_str());
+
+			mStats.MipGeneratedCount++;
+			mStats.MipGenerateMs += ms.Seconds*1000.0;
+		}
+
+		if(p->Compressed)
+		{
+			const TextureCompressStats& cs = p->CompressStats;
+			std::wstring text = L"Compressed " + p->Tex->Filename + L": " +
+				std::to_wstring(cs.InputBytes / 1024) + L" KB to " + std::to_wstring(cs.OutputBytes / 1024) +
+				L" KB, " + std::to_wstring(cs.MegapixelsPerSecond) + L" MP/s, PSNR " +
+				std::to_wstring(cs.Psnr) + L" dB\n";
+			OutputDebugString(text.c_str());
+
+			mStats.CompressedCount++;
+			mStats.CompressMs += cs.Seconds*1000.0;
+		}
+	}
+
+	if(!readBarriers.empty())
+		cmdList->ResourceBarrier((UINT)readBarriers.size(), readBarriers.data());
+
+	__int64 endTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+
+	mStats.TextureCount = (UINT)pending.size();
+	mStats.LoadMs = (loadedTime - mStartTime)*mSecondsPerCount*1000.0;
+	mStats.CreateMs = (endTime - loadedTime)*mSecondsPerCount*1000.0;
+	mStats.TotalMs = (endTime - mStartTime)*mSecondsPerCount*1000.0;
+}
+
+const TextureLoadStats& TextureLoader::GetStats()const
+{
+	return mStats;
+}
+
+HRESULT TextureLoader::LoadArchivedTexture(PendingTexture& p)
+{
+	// Decompressed straight into the buffer the texture data keeps.
+	size_t size = (size_t)p.Archive->GetEntry((uint32_t)p.ArchiveEntry).Size;
+	std::unique_ptr<uint8_t[]> ddsData(new (std::nothrow) uint8_t[size]);
+	if(!ddsData)
+		return E_OUTOFMEMORY;
+
+	if(p.Archive->Read((uint32_t)p.ArchiveEntry, ddsData.get()) != AssetArchiveResult::Ok)
+		return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+
+	return LoadDDSTextureDataFromBuffer12(std::move(ddsData), size, p.Data, p.MaxSize);
+}
+
+void TextureLoader::ConvertPixelFormat(PendingTexture& p)
+{
+	// A file the parser rejected leaves nothing to convert from in Data, so it is mapped
+	// (or read from the archive) again here.
+	MappedFile file;
+	std::vector<uint8_t> archived;
+	const uint8_t* ddsData = nullptr;
+	size_t ddsDataSize = 0;
+	if(SUCCEEDED(p.Result))
+	{
+		ddsData = p.Data.ddsData ? p.Data.ddsData.get() : p.Data.mappedFile->GetData();
+		ddsDataSize = p.Data.ddsDataSize;
+	}
+	else if(p.ArchiveEntry >= 0)
+	{
+		if(p.Archive->Read((uint32_t)p.ArchiveEntry, archived) != AssetArchiveResult::Ok)
+			return;
+		ddsData = archived.data();
+		ddsDataSize = archived.size();
+	}
+	else
+	{
+		if(!file.Open(p.Tex->Filename.c_str()))
+			return;
+		ddsData = file.GetData();
+		ddsDataSize = (size_t)file.GetSize();
+	}
+
+	// Single threaded for the same reason as CompressTexture.
+	std::vector<uint8_t> converted;
+	DDS_RESULT result = ConvertLegacyDDS(ddsData, ddsDataSize, p.PixelOptions, nullptr, converted, p.ConvertStats);
+	if(result != DDS_RESULT_OK)
+		return;
+
+	p.Result = LoadDDSTextureDataFromMemory12(converted.data(), converted.size(), p.Data, p.MaxSize);
+	p.Converted = SUCCEEDED(p.Result);
+}
+
+void TextureLoader::GenerateTextureMips(PendingTexture& p)
+{
+	if(!IsMipGeneratable(p.Data.format) || p.Data.mipCount >= GetFullMipCount((uint32_t)p.Data.width, (uint32_t)p.Data.height))
+		return;
+
+	// Single threaded for the same reason as CompressTexture.
+	const uint8_t* ddsData = p.Data.ddsData ? p.Data.ddsData.get() : p.Data.mappedFile->GetData();
+
+	std::vector<uint8_t> mipmapped;
+	DDS_RESULT result = GenerateDDSMips(ddsData, p.Data.ddsDataSize, p.MipFilterType,
+		p.MipTreatAsSrgb, nullptr, mipmapped, p.MipStats);
+	if(result != DDS_RESULT_OK)
+		return;
+
+	p.Result = LoadDDSTextureDataFromMemory12(mipmapped.data(), mipmapped.size(), p.Data, p.MaxSize);
+	p.MipsGenerated = SUCCEEDED(p.Result);
+}
+
+void TextureLoader::CompressTexture(PendingTexture& p)
+{
+	// Direct3D wants the top level of a block compressed texture in whole blocks.
+	if(!IsBCCompressible(p.Data.format) || p.Data.width % 4 != 0 || p.Data.height % 4 != 0)
+		return;
+
+	// This already runs on the pool, so compress on this thread; the other workers
+	// are busy with the other files.
+	const uint8_t* ddsData = p.Data.ddsData ? p.Data.ddsData.get() : p.Data.mappedFile->GetData();
+
+	std::vector<uint8_t> compressed;
+	DDS_RESULT result = CompressDDSTexture(ddsData, p.Data.ddsDataSize, p.CompressFormat,
+		p.CompressQuality, nullptr, compressed, p.CompressStats);
+	if(result != DDS_RESULT_OK)
+		return;
+
+	p.Result = LoadDDSTextureDataFromMemory12(compressed.data(), compressed.size(), p.Data, p.MaxSize);
+	p.Compressed = SUCCEEDED(p.Result);
+}
+
+void TextureLoader::WaitForLoads()
+{
+	for(auto& p : mPending)
+	{
+		if(p->Done.valid())
+			p->Done.wait();
+	}
+}
@@ -0,0 +1,143 @@
+//***************************************************************************************
+// TextureLoader.h
+//
+// Loads DDS textures in parallel.  Enqueue hands the file read, header validation and
+// subresource layout to a ThreadPool; Finish waits for them and then creates the
+// resources and records the uploads on the calling thread, in the order the textures
+// were queued.
+//
+// By default the files are memory mapped rather than read into a heap buffer, and each
+// mapping is released as soon as its upload has been recorded.
+//
+// With SetPixelConversion, legacy layouts that have no DXGI format the device can sample
+// (24-bit RGB, X1R5G5B5, luminance and the like) are expanded to RGBA8 on the worker
+// first, so they load instead of failing.  With SetMipGeneration, uncompressed 32-bit
+// textures that lack a full mip chain get one built on the worker that loaded them, and
+// with SetCompression they are then block compressed there too, before they are uploaded.
+//
+// With SetAssetArchive, textures the archive holds are decompressed from it on the worker
+// instead of being read from their own files.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ThreadPool.h"
+#include "TextureCompressor.h"
+#include "MipGenerator.h"
+#include "PixelFormatConverter.h"
+#include "AssetArchive.h"
+
+struct TextureLoadStats
+{
+	UINT TextureCount = 0;
+
+	// From the first Enqueue until every file was read and parsed.
+	double LoadMs = 0.0;
+
+	// Resource creation and upload recording on the calling thread.
+	double CreateMs = 0.0;
+
+	double TotalMs = 0.0;
+
+	// Textures converted from a legacy pixel layout on load, and the worker time that took.
+	UINT ConvertedCount = 0;
+	double ConvertMs = 0.0;
+
+	// Textures given a full mip chain on load, and the worker time that took.
+	UINT MipGeneratedCount = 0;
+	double MipGenerateMs = 0.0;
+
+	// Textures block compressed on load, and the worker time that took.
+	UINT CompressedCount = 0;
+	double CompressMs = 0.0;
+};
+
+class TextureLoader
+{
+public:
+	explicit TextureLoader(ThreadPool& pool, bool memoryMapped = true);
+	TextureLoader(const TextureLoader& rhs) = delete;
+	TextureLoader& operator=(const TextureLoader& rhs) = delete;
+	~TextureLoader();
+
+	// These apply to the textures queued after the call.  SetPixelConversion asks the
+	// device which of the packed 16-bit formats it can sample and expands the rest.  See
+	// GenerateDDSMips for treatAsSrgb.
+	void SetPixelConversion(ID3D12Device* device);
+	void SetMipGeneration(MipFilter filter, bool treatAsSrgb);
+	void SetCompression(BCFormat format, BCQuality quality);
+
+	// The archive is only read from, and must stay open until Finish.
+	void SetAssetArchive(const AssetArchive* archive);
+
+	// Starts reading tex->Filename on a worker thread.  tex must stay alive until Finish.
+	void Enqueue(Texture* tex, size_t maxsize = 0);
+
+	// Waits for the queued files, then fills in Resource and UploadHeap of each texture.
+	// The upload heaps must be kept alive until cmdList has executed.  The textures are
+	// all made shader resources by one ResourceBarrier call after the last copy.
+	void Finish(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+
+	const TextureLoadStats& GetStats()const;
+
+private:
+	struct PendingTexture
+	{
+		Texture* Tex = nullptr;
+		size_t MaxSize = 0;
+		DirectX::DDSTextureData12 Data;
+		HRESULT Result = E_PENDING;
+		std::future<void> Done;
+
+		// Tex->Filename's entry in the archive, or -1 to read the file itself.
+		const AssetArchive* Archive = nullptr;
+		int32_t ArchiveEntry = -1;
+
+		bool ConvertPixels = false;
+		PixelConvertOptions PixelOptions;
+		bool Converted = false;
+		PixelConvertStats ConvertStats;
+
+		bool GenerateMips = false;
+		MipFilter MipFilterType = MipFilter::Box;
+		bool MipTreatAsSrgb = false;
+		bool MipsGenerated = false;
+		MipGenerateStats MipStats;
+
+		bool Compress = false;
+		BCFormat CompressFormat = BCFormat::BC7;
+		BCQuality CompressQuality = BCQuality::Normal;
+		bool Compressed = false;
+		TextureCompressStats CompressStats;
+	};
+
+	static HRESULT LoadArchivedTexture(PendingTexture& p);
+	static void ConvertPixelFormat(PendingTexture& p);
+	static void GenerateTextureMips(PendingTexture& p);
+	static void CompressTexture(PendingTexture& p);
+
+	void WaitForLoads();
+
+private:
+	ThreadPool& mPool;
+	bool mMemoryMapped = true;
+	const AssetArchive* mArchive = nullptr;
+
+	bool mConvertPixels = false;
+	PixelConvertOptions mPixelOptions;
+
+	bool mGenerateMips = false;
+	MipFilter mMipFilter = MipFilter::Box;
+	bool mMipTreatAsSrgb = false;
+
+	bool mCompress = false;
+	BCFormat mCompressFormat = BCFormat::BC7;
+	BCQuality mCompressQuality = BCQuality::Normal;
+
+	std::vector<std::unique_ptr<PendingTexture>> mPending;
+
+	double mSecondsPerCount = 0.0;
+	__int64 mStartTime = 0;
+	TextureLoadStats mStats;
+};
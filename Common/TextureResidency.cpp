@@ -0,0 +1,182 @@
+//***************************************************************************************
+// TextureResidency.cpp
+//***************************************************************************************
+
+#include "TextureResidency.h"
+
+#include <algorithm>
+
+TextureResidencyManager::TextureResidencyManager(const TextureResidencySettings& settings)
+	: mSettings(settings)
+{
+}
+
+uint32_t TextureResidencyManager::AddTexture(const std::vector<uint64_t>& mipBytes, uint32_t tailMip,
+	const std::vector<uint32_t>& baseMips)
+{
+	TextureState state;
+	state.MipBytes = mipBytes;
+	if(state.MipBytes.empty())
+		state.MipBytes.push_back(0);
+
+	uint32_t mipCount = (uint32_t)state.MipBytes.size();
+
+	// Dropping a mip never makes the resource start at a more detailed one.
+	state.BaseMips.resize(mipCount);
+	for(uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		uint32_t base = mip < baseMips.size() ? std::min(baseMips[mip], mip) : mip;
+		state.BaseMips[mip] = mip > 0 ? std::max(base, state.BaseMips[mip - 1]) : base;
+	}
+
+	state.TailMip = std::min(tailMip, mipCount - 1);
+	state.ResidentMip = state.TailMip;
+	state.LastUsedFrame = mFrame;
+
+	mTextures.push_back(state);
+
+	uint32_t id = (uint32_t)mTextures.size() - 1;
+	mStats.CommittedBytes += GetCommittedBytes(id, state.ResidentMip);
+	return id;
+}
+
+void TextureResidencyManager::SetBudget(uint64_t bytes)
+{
+	mSettings.BudgetBytes = bytes;
+}
+
+void TextureResidencyManager::BeginFrame()
+{
+	++mFrame;
+}
+
+void TextureResidencyManager::MarkUsed(uint32_t texture)
+{
+	mTextures[texture].LastUsedFrame = mFrame;
+}
+
+void TextureResidencyManager::SetResidentMip(uint32_t texture, uint32_t mip)
+{
+	TextureState& t = mTextures[texture];
+	mip = std::min(mip, t.TailMip);
+
+	mStats.CommittedBytes = mStats.CommittedBytes - GetCommittedBytes(texture, t.ResidentMip) +
+		GetCommittedBytes(texture, mip);
+
+	if(mip > t.ResidentMip)
+	{
+		mStats.MipsEvicted += mip - t.ResidentMip;
+		if(mip == t.TailMip)
+			mStats.TexturesEvicted++;
+	}
+
+	t.ResidentMip = mip;
+}
+
+bool TextureResidencyManager::PlanEvictions(std::vector<TextureEviction>& evictions)const
+{
+	return Plan(0, (uint32_t)mTextures.size(), evictions);
+}
+
+bool TextureResidencyManager::PlanEvictions(uint32_t texture, uint32_t mip, std::vector<TextureEviction>& evictions)const
+{
+	const TextureState& t = mTextures[texture];
+	uint64_t extra = mip < t.ResidentMip ?
+		GetCommittedBytes(texture, mip) - GetCommittedBytes(texture, t.ResidentMip) : 0;
+
+	return Plan(extra, texture, evictions);
+}
+
+uint32_t TextureResidencyManager::GetTextureCount()const
+{
+	return (uint32_t)mTextures.size();
+}
+
+uint32_t TextureResidencyManager::GetResidentMip(uint32_t texture)const
+{
+	return mTextures[texture].ResidentMip;
+}
+
+uint64_t TextureResidencyManager::GetLastUsedFrame(uint32_t texture)const
+{
+	return mTextures[texture].LastUsedFrame;
+}
+
+uint64_t TextureResidencyManager::GetFrame()const
+{
+	return mFrame;
+}
+
+uint64_t TextureResidencyManager::GetBudget()const
+{
+	return mSettings.BudgetBytes;
+}
+
+const TextureResidencyStats& TextureResidencyManager::GetStats()const
+{
+	return mStats;
+}
+
+bool TextureResidencyManager::Plan(uint64_t extraBytes, uint32_t keepTexture, std::vector<TextureEviction>& evictions)const
+{
+	evictions.clear();
+
+	uint64_t needed = mStats.CommittedBytes + extraBytes;
+	if(mSettings.BudgetBytes == 0 || needed <= mSettings.BudgetBytes)
+		return true;
+
+	mCandidates.clear();
+	for(uint32_t i = 0; i < (uint32_t)mTextures.size(); ++i)
+	{
+		const TextureState& t = mTextures[i];
+		if(i != keepTexture && t.ResidentMip < t.TailMip &&
+			mFrame - t.LastUsedFrame >= mSettings.MinIdleFrames)
+		{
+			mCandidates.push_back(i);
+		}
+	}
+
+	// Least recently used first; the id breaks ties so the order is deterministic.
+	std::sort(mCandidates.begin(), mCandidates.end(), [this](uint32_t a, uint32_t b)
+	{
+		if(mTextures[a].LastUsedFrame != mTextures[b].LastUsedFrame)
+			return mTextures[a].LastUsedFrame < mTextures[b].LastUsedFrame;
+		return a < b;
+	});
+
+	for(uint32_t i : mCandidates)
+	{
+		// The most detailed mip is the largest, so it goes first.  Dropping a mip frees
+		// nothing while the resource still has to start at it.
+		const TextureState& t = mTextures[i];
+		uint32_t mip = t.ResidentMip;
+		uint64_t committed = GetCommittedBytes(i, mip);
+		while(mip < t.TailMip && needed > mSettings.BudgetBytes)
+		{
+			uint64_t remaining = GetCommittedBytes(i, ++mip);
+			needed -= committed - remaining;
+			committed = remaining;
+		}
+
+		TextureEviction eviction;
+		eviction.Texture = i;
+		eviction.Mip = mip;
+		evictions.push_back(eviction);
+
+		if(needed <= mSettings.BudgetBytes)
+			return true;
+	}
+
+	return false;
+}
+
+uint64_t TextureResidencyManager::GetCommittedBytes(uint32_t texture, uint32_t mip)const
+{
+	const TextureState& t = mTextures[texture];
+
+	uint64_t bytes = 0;
+	for(uint32_t m = t.BaseMips[mip]; m < (uint32_t)t.MipBytes.size(); ++m)
+		bytes += t.MipBytes[m];
+
+	return bytes;
+}
@@ -0,0 +1,113 @@
+//***************************************************************************************
+// TextureResidency.h
+//
+// Keeps the streamed textures within a memory budget.
+//   -A texture's committed bytes are the sizes of the mips its resource holds added up.
+//    That is usually the resident mips, but a block-compressed resource has to start at
+//    a mip that is whole blocks, so it may hold a few more.  The caller marks a texture
+//    used in every frame that draws it.
+//   -When the resident mips would go over the budget, the least recently used textures
+//    give up mips, most detailed first, down to the mip tail they were loaded with.
+//    Evicting a texture whole leaves only that tail, so its views always have
+//    something to sample, and the streamer brings the rest back once it is drawn again.
+//   -Textures used within the last MinIdleFrames frames are never evicted.  If the
+//    budget can't be met without them, the upload that needed the room waits.
+//   -Ties on the last used frame go to the lower texture id, so a given access trace
+//    always evicts the same mips.
+//
+// Like TextureStreamer it knows nothing about Direct3D, so the policy can be driven by
+// a simulated access trace.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct TextureResidencySettings
+{
+	// 0 means no budget.
+	uint64_t BudgetBytes = 0;
+
+	// A texture may lose mips once this many frames have passed since it was last used.
+	uint32_t MinIdleFrames = 2;
+};
+
+struct TextureEviction
+{
+	uint32_t Texture = 0;
+
+	// Most detailed mip left resident.
+	uint32_t Mip = 0;
+};
+
+struct TextureResidencyStats
+{
+	uint64_t CommittedBytes = 0;
+	uint32_t MipsEvicted = 0;
+
+	// Evictions that left a texture with only its mip tail.
+	uint32_t TexturesEvicted = 0;
+};
+
+class TextureResidencyManager
+{
+public:
+	explicit TextureResidencyManager(const TextureResidencySettings& settings = TextureResidencySettings());
+
+	// mipBytes[i] is the size of mip i over every array slice.  The texture starts with
+	// mips [tailMip, mipBytes.size()) resident and never drops below them.  If given,
+	// baseMips[i] is the most detailed mip the resource holds while mip i is (no more
+	// than i); without it the resource holds exactly the resident mips.  Returns the same
+	// id TextureStreamer::AddTexture does if textures are added in the same order.
+	uint32_t AddTexture(const std::vector<uint64_t>& mipBytes, uint32_t tailMip,
+		const std::vector<uint32_t>& baseMips = std::vector<uint32_t>());
+
+	void SetBudget(uint64_t bytes);
+
+	// Call once per frame, before the textures drawn in it are marked.
+	void BeginFrame();
+	void MarkUsed(uint32_t texture);
+
+	// Records that mips [mip, MipCount) of the texture are now resident, after an
+	// upload started or an eviction went through.
+	void SetResidentMip(uint32_t texture, uint32_t mip);
+
+	// Fills evictions with the mips that have to go, in eviction order, for the resident
+	// set to fit in the budget.  The second form makes room for mips [mip, current) of
+	// texture as well and never evicts from that texture.  Returns false if evicting
+	// every idle texture down to its tail is still not enough; evictions then lists all
+	// of them anyway.
+	bool PlanEvictions(std::vector<TextureEviction>& evictions)const;
+	bool PlanEvictions(uint32_t texture, uint32_t mip, std::vector<TextureEviction>& evictions)const;
+
+	uint32_t GetTextureCount()const;
+	uint32_t GetResidentMip(uint32_t texture)const;
+	uint64_t GetLastUsedFrame(uint32_t texture)const;
+	uint64_t GetFrame()const;
+	uint64_t GetBudget()const;
+	const TextureResidencyStats& GetStats()const;
+
+private:
+	bool Plan(uint64_t extraBytes, uint32_t keepTexture, std::vector<TextureEviction>& evictions)const;
+	// What the texture commits while mips [mip, MipCount) are resident.
+	uint64_t GetCommittedBytes(uint32_t texture, uint32_t mip)const;
+
+private:
+	struct TextureState
+	{
+		std::vector<uint64_t> MipBytes;
+		std::vector<uint32_t> BaseMips;
+		uint32_t TailMip = 0;
+		uint32_t ResidentMip = 0;
+		uint64_t LastUsedFrame = 0;
+	};
+
+	TextureResidencySettings mSettings;
+	uint64_t mFrame = 0;
+
+	std::vector<TextureState> mTextures;
+	mutable std::vector<uint32_t> mCandidates;
+
+	TextureResidencyStats mStats;
+};
@@ -0,0 +1,581 @@
+//***************************************************************************************
+// TextureStreamUploader.cpp
+//***************************************************************************************
+
+#include "TextureStreamUploader.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace DirectX;
+
+TextureStreamUploader::TextureStreamUploader(ID3D12Device* device, ID3D12CommandQueue* queue, ThreadPool& pool)
+	: md3dDevice(device),
+	  mCommandQueue(queue),
+	  mPool(pool)
+{
+	ThrowIfFailed(md3dDevice->CreateCommandAllocator(
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		IID_PPV_ARGS(mCmdListAlloc.GetAddressOf())));
+
+	ThrowIfFailed(md3dDevice->CreateCommandList(
+		0,
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		mCmdListAlloc.Get(),
+		nullptr,
+		IID_PPV_ARGS(mCommandList.GetAddressOf())));
+
+	// Start off in a closed state; Flush resets it when there is something to copy.
+	mCommandList->Close();
+
+	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+}
+
+TextureStreamUploader::~TextureStreamUploader()
+{
+	// The workers write into the upload buffers and the GPU reads from them, so both
+	// must be done before the buffers go away.
+	for(auto& u : mUploads)
+	{
+		if(u->Copied.valid())
+			u->Copied.wait();
+	}
+
+	if(mFence != nullptr && mFence->GetCompletedValue() < mCurrentFence)
+	{
+		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
+		if(eventHandle != nullptr)
+		{
+			if(SUCCEEDED(mFence->SetEventOnCompletion(mCurrentFence, eventHandle)))
+				WaitForSingleObject(eventHandle, INFINITE);
+			CloseHandle(eventHandle);
+		}
+	}
+}
+
+uint32_t TextureStreamUploader::LoadTexture(ID3D12GraphicsCommandList* cmdList, Texture* tex, UINT tailSize)
+{
+	auto t = std::make_unique<StreamedTexture>();
+	t->Tex = tex;
+
+	// The whole chain is laid out; only the tail is read now.
+	ThrowIfFailed(MapDDSTextureDataFromFile12(tex->Filename.c_str(), t->Data));
+
+	return CreateTexture(cmdList, std::move(t), tailSize);
+}
+
+uint32_t TextureStreamUploader::LoadTexture(ID3D12GraphicsCommandList* cmdList, Texture* tex,
+	const uint8_t* ddsData, size_t ddsDataSize, UINT tailSize)
+{
+	auto t = std::make_unique<StreamedTexture>();
+	t->Tex = tex;
+
+	ThrowIfFailed(LoadDDSTextureDataFromMemory12(ddsData, ddsDataSize, t->Data));
+
+	return CreateTexture(cmdList, std::move(t), tailSize);
+}
+
+uint32_t TextureStreamUploader::CreateTexture(ID3D12GraphicsCommandList* cmdList,
+	std::unique_ptr<StreamedTexture> t, UINT tailSize)
+{
+	Texture* tex = t->Tex;
+	const DDSTextureData12& data = t->Data;
+	if(data.resDim != D3D12_RESOURCE_DIMENSION_TEXTURE2D || data.depth > 1 || data.isCubeMap)
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+
+	D3D12_RESOURCE_DESC& texDesc = t->FullDesc;
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Alignment = 0;
+	texDesc.Width = data.width;
+	texDesc.Height = (UINT)data.height;
+	texDesc.DepthOrArraySize = (UINT16)data.arraySize;
+	texDesc.MipLevels = (UINT16)data.mipCount;
+	texDesc.Format = data.format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	// The tail starts at the first mip that fits in tailSize.
+	UINT mipCount = (UINT)data.mipCount;
+	UINT tailMip = 0;
+	while(tailMip + 1 < mipCount &&
+		MathHelper::Max(data.width >> tailMip, data.height >> tailMip) > (size_t)tailSize)
+	{
+		++tailMip;
+	}
+
+	t->Desc.Width = (uint32_t)data.width;
+	t->Desc.Height = (uint32_t)data.height;
+	t->Desc.MipCount = mipCount;
+	t->Desc.ResidentMip = tailMip;
+	t->ArraySize = (UINT)data.arraySize;
+	t->MinMip = tailMip;
+
+	// A mip's upload footprint doesn't depend on which resource holds it.
+	t->MipBytes.assign(mipCount, 0);
+	for(UINT slice = 0; slice < t->ArraySize; ++slice)
+	{
+		for(UINT mip = 0; mip < mipCount; ++mip)
+		{
+			UINT64 bytes = 0;
+			md3dDevice->GetCopyableFootprints(&texDesc, D3D12CalcSubresource(mip, slice, 0, mipCount, t->ArraySize),
+				1, 0, nullptr, nullptr, nullptr, &bytes);
+			t->MipBytes[mip] += bytes;
+		}
+	}
+
+	CreateResource(*t, GetResourceBaseMip(*t, tailMip));
+
+	uint32_t id = (uint32_t)mTextures.size();
+	mTextures.push_back(std::move(t));
+
+	auto upload = PrepareUpload(id, tailMip, mipCount - 1);
+	CopyUpload(*mTextures[id], *upload);
+	RecordCopies(cmdList, *upload);
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(tex->Resource.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	tex->UploadHeap = upload->Buffer;
+
+	// Nothing left to stream: release the mapping now.
+	if(tailMip == 0)
+		mTextures[id]->Data = DDSTextureData12();
+
+	return id;
+}
+
+const StreamedTextureDesc& TextureStreamUploader::GetDesc(uint32_t texture)const
+{
+	return mTextures[texture]->Desc;
+}
+
+const std::vector<uint64_t>& TextureStreamUploader::GetMipBytes(uint32_t texture)const
+{
+	return mTextures[texture]->MipBytes;
+}
+
+std::vector<uint32_t> TextureStreamUploader::GetResourceBaseMips(uint32_t texture)const
+{
+	const StreamedTexture& t = *mTextures[texture];
+
+	std::vector<uint32_t> baseMips(t.Desc.MipCount);
+	for(UINT mip = 0; mip < t.Desc.MipCount; ++mip)
+		baseMips[mip] = GetResourceBaseMip(t, mip);
+
+	return baseMips;
+}
+
+void TextureStreamUploader::SetSrvHeap(DescriptorHeapAllocator* heap)
+{
+	mSrvHeap = heap;
+}
+
+void TextureStreamUploader::CreateSrvs(uint32_t texture)
+{
+	StreamedTexture& t = *mTextures[texture];
+	UINT slot = mSrvHeap->Allocate();
+	t.SrvSlots[0] = slot;
+	t.SrvSlots[1] = mSrvHeap->Allocate();
+	t.ActiveSlot = 0;
+	t.SpareSlotFence = 0;
+
+	WriteSrv(t, slot, t.MinMip);
+
+	for(Material* mat : t.Materials)
+	{
+		mat->DiffuseSrvHeapIndex = (int)slot;
+		mat->NumFramesDirty = gNumFrameResources;
+	}
+}
+
+void TextureStreamUploader::BindMaterial(uint32_t texture, Material* mat)
+{
+	StreamedTexture& t = *mTextures[texture];
+	t.Materials.push_back(mat);
+	mat->DiffuseSrvHeapIndex = (int)t.SrvSlots[t.ActiveSlot];
+	mat->NumFramesDirty = gNumFrameResources;
+}
+
+void TextureStreamUploader::SetFrameFence(ID3D12Fence* fence, UINT64 lastSubmittedValue)
+{
+	mFrameFence = fence;
+	mLastSubmittedFrame = lastSubmittedValue;
+}
+
+void TextureStreamUploader::Flush()
+{
+	ReleaseRetiredResources();
+
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+	for(auto& u : mUploads)
+	{
+		if(u->Recorded || u->Copied.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
+
+		// A mip the resource doesn't hold needs a bigger resource, and with it a view
+		// switch.
+		StreamedTexture& t = *mTextures[u->Texture];
+		bool grow = u->FirstMip < t.ResourceMip;
+		if(grow && !IsSpareSlotFree(t))
+			continue;
+
+		if(!BeginRecording())
+			return;
+
+		// Rethrows anything the copy threw.
+		u->Copied.get();
+
+		if(grow)
+		{
+			MoveTexture(t, GetResourceBaseMip(t, u->FirstMip));
+			SwitchView(t, t.MinMip);
+		}
+
+		// Only the subresources being written leave the shader resource state.  The
+		// texture's views are clamped above them, so draws can keep sampling it.
+		ID3D12Resource* resource = t.Tex->Resource.Get();
+
+		barriers.clear();
+		for(UINT sub : u->Subresources)
+		{
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource,
+				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST,
+				GetResourceSubresource(t, sub)));
+		}
+		mCommandList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+
+		RecordCopies(mCommandList.Get(), *u);
+
+		for(auto& b : barriers)
+			std::swap(b.Transition.StateBefore, b.Transition.StateAfter);
+		mCommandList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+
+		u->Recorded = true;
+		u->Fence = mCurrentFence + 1;
+	}
+
+	// Evictions may have recorded moves even if no upload was ready.
+	if(!mRecording)
+		return;
+
+	ThrowIfFailed(mCommandList->Close());
+	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), ++mCurrentFence));
+	mRecording = false;
+}
+
+bool TextureStreamUploader::BeginMipUpload(uint32_t texture, uint32_t mip)
+{
+	auto upload = PrepareUpload(texture, mip, mip);
+
+	const StreamedTexture* t = mTextures[texture].get();
+	const MipUpload* u = upload.get();
+	upload->Copied = mPool.Submit([t, u]()
+	{
+		CopyUpload(*t, *u);
+	});
+
+	mUploads.push_back(std::move(upload));
+	return true;
+}
+
+bool TextureStreamUploader::IsMipUploadComplete(uint32_t texture, uint32_t mip)
+{
+	for(auto it = mUploads.begin(); it != mUploads.end(); ++it)
+	{
+		const MipUpload& u = **it;
+		if(u.Texture != texture || u.FirstMip != mip)
+			continue;
+
+		if(!u.Recorded || mFence->GetCompletedValue() < u.Fence)
+			return false;
+
+		// The GPU is done with the upload buffer.
+		mUploads.erase(it);
+		return true;
+	}
+
+	return false;
+}
+
+bool TextureStreamUploader::SetMinResidentMip(uint32_t texture, uint32_t mip)
+{
+	if(mSrvHeap == nullptr || mFrameFence == nullptr)
+		return false;
+
+	StreamedTexture& t = *mTextures[texture];
+	if(!IsSpareSlotFree(t))
+		return false;
+
+	SwitchView(t, mip);
+	return true;
+}
+
+bool TextureStreamUploader::EvictMips(uint32_t texture, uint32_t mip)
+{
+	if(mSrvHeap == nullptr || mFrameFence == nullptr)
+		return false;
+
+	// Pending uploads may be for the mips being dropped.
+	StreamedTexture& t = *mTextures[texture];
+	if(HasUploads(texture) || !IsSpareSlotFree(t))
+		return false;
+
+	// Block-compressed textures may have to keep a few more mips than asked for; the
+	// view is clamped to mip either way.
+	UINT baseMip = GetResourceBaseMip(t, mip);
+	if(baseMip > t.ResourceMip)
+	{
+		if(!BeginRecording())
+			return false;
+
+		MoveTexture(t, baseMip);
+	}
+
+	SwitchView(t, mip);
+	return true;
+}
+
+std::unique_ptr<TextureStreamUploader::MipUpload> TextureStreamUploader::PrepareUpload(
+	uint32_t texture, UINT firstMip, UINT lastMip)
+{
+	const StreamedTexture& t = *mTextures[texture];
+
+	auto upload = std::make_unique<MipUpload>();
+	upload->Texture = texture;
+	upload->FirstMip = firstMip;
+	upload->LastMip = lastMip;
+
+	// Footprints of the full chain, so they line up with the file data.
+	const D3D12_RESOURCE_DESC& desc = t.FullDesc;
+
+	UINT64 size = 0;
+	for(UINT slice = 0; slice < t.ArraySize; ++slice)
+	{
+		for(UINT mip = firstMip; mip <= lastMip; ++mip)
+		{
+			UINT sub = D3D12CalcSubresource(mip, slice, 0, t.Desc.MipCount, t.ArraySize);
+
+			UINT64 offset = (size + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) &
+				~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+			UINT numRows = 0;
+			UINT64 rowSize = 0;
+			UINT64 bytes = 0;
+			md3dDevice->GetCopyableFootprints(&desc, sub, 1, offset, &footprint, &numRows, &rowSize, &bytes);
+
+			upload->Subresources.push_back(sub);
+			upload->Footprints.push_back(footprint);
+			upload->NumRows.push_back(numRows);
+			upload->RowSizes.push_back(rowSize);
+
+			size = offset + bytes;
+		}
+	}
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&upload->Buffer)));
+
+	// Upload heaps can stay mapped; the buffer is released once the GPU is done with it.
+	ThrowIfFailed(upload->Buffer->Map(0, nullptr, reinterpret_cast<void**>(&upload->MappedData)));
+
+	return upload;
+}
+
+void TextureStreamUploader::CopyUpload(const StreamedTexture& t, const MipUpload& upload)
+{
+	for(size_t i = 0; i < upload.Subresources.size(); ++i)
+	{
+		// The file data covers the full chain, so it is indexed like the resource.
+		const D3D12_SUBRESOURCE_DATA& src = t.Data.initData[upload.Subresources[i]];
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = upload.Footprints[i];
+
+		D3D12_MEMCPY_DEST dest;
+		dest.pData = upload.MappedData + layout.Offset;
+		dest.RowPitch = layout.Footprint.RowPitch;
+		dest.SlicePitch = (SIZE_T)layout.Footprint.RowPitch * upload.NumRows[i];
+
+		MemcpySubresource(&dest, &src, (SIZE_T)upload.RowSizes[i], upload.NumRows[i], layout.Footprint.Depth);
+	}
+}
+
+void TextureStreamUploader::RecordCopies(ID3D12GraphicsCommandList* cmdList, const MipUpload& upload)const
+{
+	const StreamedTexture& t = *mTextures[upload.Texture];
+	ID3D12Resource* resource = t.Tex->Resource.Get();
+
+	for(size_t i = 0; i < upload.Subresources.size(); ++i)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION dst(resource, GetResourceSubresource(t, upload.Subresources[i]));
+		CD3DX12_TEXTURE_COPY_LOCATION src(upload.Buffer.Get(), upload.Footprints[i]);
+		cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+}
+
+void TextureStreamUploader::WriteSrv(const StreamedTexture& t, UINT slot, UINT minMip)
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = t.FullDesc.Format;
+
+	// Mips are numbered from the resource's most detailed one.
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = t.Desc.MipCount - t.ResourceMip;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = t.ArraySize;
+	srvDesc.Texture2DArray.ResourceMinLODClamp = (float)(minMip - t.ResourceMip);
+
+	md3dDevice->CreateShaderResourceView(t.Tex->Resource.Get(), &srvDesc, mSrvHeap->GetCpuHandle(slot));
+}
+
+bool TextureStreamUploader::BeginRecording()
+{
+	if(mRecording)
+		return true;
+
+	// The allocator can only be reset once the previous batch has executed.
+	if(mFence->GetCompletedValue() < mCurrentFence)
+		return false;
+
+	ThrowIfFailed(mCmdListAlloc->Reset());
+	ThrowIfFailed(mCommandList->Reset(mCmdListAlloc.Get(), nullptr));
+	mRecording = true;
+	return true;
+}
+
+void TextureStreamUploader::CreateResource(StreamedTexture& t, UINT baseMip)
+{
+	D3D12_RESOURCE_DESC desc = t.FullDesc;
+	desc.Width = MathHelper::Max(t.FullDesc.Width >> baseMip, (UINT64)1);
+	desc.Height = MathHelper::Max(t.FullDesc.Height >> baseMip, 1u);
+	desc.MipLevels = (UINT16)(t.FullDesc.MipLevels - baseMip);
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(t.Tex->Resource.ReleaseAndGetAddressOf())));
+
+	t.ResourceMip = baseMip;
+}
+
+void TextureStreamUploader::MoveTexture(StreamedTexture& t, UINT baseMip)
+{
+	// Recorded on the uploader's command list, which must be open.
+	Microsoft::WRL::ComPtr<ID3D12Resource> old = t.Tex->Resource;
+	UINT oldBaseMip = t.ResourceMip;
+
+	CreateResource(t, baseMip);
+	ID3D12Resource* resource = t.Tex->Resource.Get();
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(old.Get(),
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+	// Mips the old resource didn't hold are left to their uploads.
+	for(UINT slice = 0; slice < t.ArraySize; ++slice)
+	{
+		for(UINT mip = MathHelper::Max(oldBaseMip, baseMip); mip < t.Desc.MipCount; ++mip)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION dst(resource,
+				D3D12CalcSubresource(mip - baseMip, slice, 0, t.Desc.MipCount - baseMip, t.ArraySize));
+			CD3DX12_TEXTURE_COPY_LOCATION src(old.Get(),
+				D3D12CalcSubresource(mip - oldBaseMip, slice, 0, t.Desc.MipCount - oldBaseMip, t.ArraySize));
+			mCommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+	}
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	// Frames submitted so far sample the old resource through the active slot.  The
+	// caller switches the views, so later frames only see the new one.
+	RetiredResource retired;
+	retired.Resource = old;
+	retired.FrameFence = mLastSubmittedFrame;
+	retired.CopyFence = mCurrentFence + 1;
+	mRetired.push_back(retired);
+}
+
+bool TextureStreamUploader::IsSpareSlotFree(const StreamedTexture& t)const
+{
+	// Frames that may still read the spare slot must retire before it is rewritten.
+	return mFrameFence != nullptr && mFrameFence->GetCompletedValue() >= t.SpareSlotFence;
+}
+
+void TextureStreamUploader::SwitchView(StreamedTexture& t, UINT minMip)
+{
+	UINT spare = 1 - t.ActiveSlot;
+	WriteSrv(t, t.SrvSlots[spare], minMip);
+
+	// Everything submitted so far may have used the old slot.
+	t.SpareSlotFence = mLastSubmittedFrame;
+	t.ActiveSlot = spare;
+	t.MinMip = minMip;
+
+	// The slot index reaches the shader through the material buffer, which is per frame
+	// resource, so frames already recorded keep reading the old slot.
+	for(Material* mat : t.Materials)
+	{
+		mat->DiffuseSrvHeapIndex = (int)t.SrvSlots[spare];
+		mat->NumFramesDirty = gNumFrameResources;
+	}
+}
+
+bool TextureStreamUploader::HasUploads(uint32_t texture)const
+{
+	for(const auto& u : mUploads)
+	{
+		if(u->Texture == texture)
+			return true;
+	}
+
+	return false;
+}
+
+void TextureStreamUploader::ReleaseRetiredResources()
+{
+	UINT64 framesDone = mFrameFence != nullptr ? mFrameFence->GetCompletedValue() : 0;
+	UINT64 copiesDone = mFence->GetCompletedValue();
+
+	mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(), [=](const RetiredResource& r)
+	{
+		return framesDone >= r.FrameFence && copiesDone >= r.CopyFence;
+	}), mRetired.end());
+}
+
+UINT TextureStreamUploader::GetResourceSubresource(const StreamedTexture& t, UINT subresource)
+{
+	UINT mip = subresource % t.Desc.MipCount;
+	UINT slice = subresource / t.Desc.MipCount;
+
+	return D3D12CalcSubresource(mip - t.ResourceMip, slice, 0, t.Desc.MipCount - t.ResourceMip, t.ArraySize);
+}
+
+UINT TextureStreamUploader::GetResourceBaseMip(const StreamedTexture& t, UINT mip)
+{
+	// The most detailed mip of a block-compressed resource has to be whole blocks.
+	DXGI_FORMAT format = t.FullDesc.Format;
+	bool blockCompressed = (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+		(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+	if(!blockCompressed)
+		return mip;
+
+	while(mip > 0 && (((t.Desc.Width >> mip) & 3) != 0 || ((t.Desc.Height >> mip) & 3) != 0))
+		--mip;
+
+	return mip;
+}
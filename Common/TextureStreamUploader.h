@@ -0,0 +1,170 @@
+//***************************************************************************************
+// TextureStreamUploader.h
+//
+// Direct3D 12 backend for TextureStreamer.
+//   -LoadTexture maps the DDS file (or copies a DDS file already in memory, such as a
+//    packed texture array), creates the texture with only its mip tail (mips no larger
+//    than tailSize) and records the upload of the tail on the caller's command list.
+//    The other mips stay in the file data until they are streamed.
+//   -BeginMipUpload copies a mip into an upload buffer on the ThreadPool.  Flush then
+//    records the copies of every finished mip on the uploader's own command list and
+//    submits them to the queue.
+//   -A texture's resource only holds its resident mips.  Streaming a more detailed mip
+//    in, or evicting mips, moves the texture into a new resource of the right size with
+//    a GPU copy of the mips both share; the old one is released once the frames and
+//    copies that used it have retired.  The file data stays mapped, so evicted mips can
+//    be streamed in again.
+//   -Each streamed texture has two SRV slots, both Texture2DArray views so single
+//    textures and packed arrays bind the same way.  When the clamp or the resource
+//    changes, the new view is written to the slot no frame is using and the bound
+//    materials are switched to it.  A slot is rewritten only after the frames that used
+//    it have retired.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "ThreadPool.h"
+#include "TextureStreamer.h"
+#include "DescriptorHeapAllocator.h"
+
+class TextureStreamUploader : public TextureStreamingBackend
+{
+public:
+	TextureStreamUploader(ID3D12Device* device, ID3D12CommandQueue* queue, ThreadPool& pool);
+	TextureStreamUploader(const TextureStreamUploader& rhs) = delete;
+	TextureStreamUploader& operator=(const TextureStreamUploader& rhs) = delete;
+	~TextureStreamUploader();
+
+	// Fills in tex->Resource and tex->UploadHeap; the upload heap must be kept alive until
+	// cmdList has executed.  Returns the texture's id, which is also the id the matching
+	// TextureStreamer::AddTexture call returns if textures are added in load order.
+	uint32_t LoadTexture(ID3D12GraphicsCommandList* cmdList, Texture* tex, UINT tailSize = 64);
+	uint32_t LoadTexture(ID3D12GraphicsCommandList* cmdList, Texture* tex,
+		const uint8_t* ddsData, size_t ddsDataSize, UINT tailSize = 64);
+
+	const StreamedTextureDesc& GetDesc(uint32_t texture)const;
+
+	// Size of each mip over every array slice, as laid out in an upload buffer.
+	const std::vector<uint64_t>& GetMipBytes(uint32_t texture)const;
+
+	// For each mip, the most detailed mip the texture's resource holds while that one is
+	// the most detailed resident.  Differs from the mip only for block-compressed
+	// textures, whose resource has to start at a mip that is whole blocks.
+	std::vector<uint32_t> GetResourceBaseMips(uint32_t texture)const;
+
+	// Allocates the texture's two slots from heap, writes the initial view to one and
+	// keeps the other for the next clamp change.  Bound materials have DiffuseSrvHeapIndex
+	// pointed at whichever slot is current and are marked dirty whenever it changes.
+	void SetSrvHeap(DescriptorHeapAllocator* heap);
+	void CreateSrvs(uint32_t texture);
+	void BindMaterial(uint32_t texture, Material* mat);
+
+	// The app's frame fence and the last value submitted on it.  Call every frame before
+	// TextureStreamer::Update.
+	void SetFrameFence(ID3D12Fence* fence, UINT64 lastSubmittedValue);
+
+	// Records and submits the copies of every mip that has finished loading.  Call after
+	// TextureStreamer::Update.
+	void Flush();
+
+	// TextureStreamingBackend
+	virtual bool BeginMipUpload(uint32_t texture, uint32_t mip)override;
+	virtual bool IsMipUploadComplete(uint32_t texture, uint32_t mip)override;
+	virtual bool SetMinResidentMip(uint32_t texture, uint32_t mip)override;
+	virtual bool EvictMips(uint32_t texture, uint32_t mip)override;
+
+private:
+	struct StreamedTexture
+	{
+		Texture* Tex = nullptr;
+		DirectX::DDSTextureData12 Data;
+		StreamedTextureDesc Desc;
+		UINT ArraySize = 1;
+
+		// The full chain, which the file data and upload footprints are indexed by.
+		// Tex->Resource holds mips [ResourceMip, MipCount) of it.
+		D3D12_RESOURCE_DESC FullDesc = {};
+		UINT ResourceMip = 0;
+		std::vector<uint64_t> MipBytes;
+
+		UINT SrvSlots[2] = { 0, 0 };
+		UINT ActiveSlot = 0;
+		UINT64 SpareSlotFence = 0;
+		UINT MinMip = 0;
+		std::vector<Material*> Materials;
+	};
+
+	// One upload buffer holding mips [FirstMip, LastMip] of every array slice.
+	struct MipUpload
+	{
+		uint32_t Texture = 0;
+		UINT FirstMip = 0;
+		UINT LastMip = 0;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+		BYTE* MappedData = nullptr;
+		std::vector<UINT> Subresources;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Footprints;
+		std::vector<UINT> NumRows;
+		std::vector<UINT64> RowSizes;
+
+		std::future<void> Copied;
+		bool Recorded = false;
+		UINT64 Fence = 0;
+	};
+
+	// A resource a texture moved out of.  Frames up to FrameFence may still sample it
+	// and the copy out of it completes at CopyFence.
+	struct RetiredResource
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 FrameFence = 0;
+		UINT64 CopyFence = 0;
+	};
+
+	uint32_t CreateTexture(ID3D12GraphicsCommandList* cmdList, std::unique_ptr<StreamedTexture> t, UINT tailSize);
+	std::unique_ptr<MipUpload> PrepareUpload(uint32_t texture, UINT firstMip, UINT lastMip);
+	void RecordCopies(ID3D12GraphicsCommandList* cmdList, const MipUpload& upload)const;
+	void WriteSrv(const StreamedTexture& t, UINT slot, UINT minMip);
+
+	// Resets the uploader's command list unless it is already recording.  Returns false
+	// while the previous batch is still executing.
+	bool BeginRecording();
+
+	void CreateResource(StreamedTexture& t, UINT baseMip);
+	void MoveTexture(StreamedTexture& t, UINT baseMip);
+	bool IsSpareSlotFree(const StreamedTexture& t)const;
+	void SwitchView(StreamedTexture& t, UINT minMip);
+	bool HasUploads(uint32_t texture)const;
+	void ReleaseRetiredResources();
+
+	// Maps a subresource of the full chain to the one holding it in Tex->Resource.
+	static UINT GetResourceSubresource(const StreamedTexture& t, UINT subresource);
+
+	// The most detailed mip a resource holding mip can start at.
+	static UINT GetResourceBaseMip(const StreamedTexture& t, UINT mip);
+
+	// Runs on the thread pool; touches only the texture's file data and the upload buffer.
+	static void CopyUpload(const StreamedTexture& t, const MipUpload& upload);
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+	ID3D12CommandQueue* mCommandQueue = nullptr;
+	ThreadPool& mPool;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mCmdListAlloc;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+	UINT64 mCurrentFence = 0;
+	bool mRecording = false;
+
+	DescriptorHeapAllocator* mSrvHeap = nullptr;
+
+	ID3D12Fence* mFrameFence = nullptr;
+	UINT64 mLastSubmittedFrame = 0;
+
+	std::vector<std::unique_ptr<StreamedTexture>> mTextures;
+	std::vector<std::unique_ptr<MipUpload>> mUploads;
+	std::vector<RetiredResource> mRetired;
+};
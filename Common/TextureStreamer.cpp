@@ -0,0 +1,175 @@
+//***************************************************************************************
+// TextureStreamer.cpp
+//***************************************************************************************
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(TextureStreamingBackend& backend, uint32_t maxUploadsInFlight)
+	: mBackend(backend),
+	  mMaxUploadsInFlight(std::max(maxUploadsInFlight, 1u))
+{
+}
+
+uint32_t TextureStreamer::AddTexture(const StreamedTextureDesc& desc)
+{
+	TextureState state;
+	state.Desc = desc;
+	state.Desc.MipCount = std::max(desc.MipCount, 1u);
+	state.Desc.ResidentMip = std::min(desc.ResidentMip, state.Desc.MipCount - 1);
+	state.LoadedMip = state.Desc.ResidentMip;
+	state.VisibleMip = state.Desc.ResidentMip;
+
+	mTextures.push_back(state);
+	return (uint32_t)mTextures.size() - 1;
+}
+
+void TextureStreamer::SetResidencyManager(TextureResidencyManager* residency)
+{
+	mResidency = residency;
+}
+
+void TextureStreamer::BeginFrame()
+{
+	for(auto& t : mTextures)
+		t.Footprint = 0.0f;
+}
+
+void TextureStreamer::AddFootprint(uint32_t texture, float pixels)
+{
+	TextureState& t = mTextures[texture];
+	t.Footprint = std::max(t.Footprint, pixels);
+}
+
+void TextureStreamer::Update()
+{
+	mStats.UploadsInFlight = 0;
+	mStats.TexturesWaiting = 0;
+	mStats.UploadsOverBudget = 0;
+
+	mCandidates.clear();
+	for(uint32_t i = 0; i < (uint32_t)mTextures.size(); ++i)
+	{
+		TextureState& t = mTextures[i];
+
+		if(t.UploadInFlight && mBackend.IsMipUploadComplete(i, t.UploadMip))
+		{
+			t.UploadInFlight = false;
+			t.LoadedMip = t.UploadMip;
+			mStats.UploadsCompleted++;
+		}
+
+		// Only expose a mip once it is on the GPU.
+		if(t.VisibleMip > t.LoadedMip && mBackend.SetMinResidentMip(i, t.LoadedMip))
+			t.VisibleMip = t.LoadedMip;
+
+		if(t.UploadInFlight)
+		{
+			mStats.UploadsInFlight++;
+			mStats.TexturesWaiting++;
+		}
+		else if(ComputeWantedMip(i) < t.LoadedMip)
+		{
+			mCandidates.push_back(i);
+			mStats.TexturesWaiting++;
+		}
+	}
+
+	// Gets back under the budget if it was lowered; what can't be evicted yet is
+	// retried on the next Update.
+	if(mResidency != nullptr)
+	{
+		mResidency->PlanEvictions(mEvictions);
+		ApplyEvictions();
+	}
+
+	// Biggest on screen first.
+	std::sort(mCandidates.begin(), mCandidates.end(), [this](uint32_t a, uint32_t b)
+	{
+		return mTextures[a].Footprint > mTextures[b].Footprint;
+	});
+
+	for(uint32_t i : mCandidates)
+	{
+		if(mStats.UploadsInFlight >= mMaxUploadsInFlight)
+			break;
+
+		// Mips are streamed one level at a time, so the loaded range stays contiguous.
+		TextureState& t = mTextures[i];
+		uint32_t mip = t.LoadedMip - 1;
+
+		// A smaller texture further down may still fit.
+		if(mResidency != nullptr &&
+			(!mResidency->PlanEvictions(i, mip, mEvictions) || !ApplyEvictions()))
+		{
+			mStats.UploadsOverBudget++;
+			continue;
+		}
+
+		if(!mBackend.BeginMipUpload(i, mip))
+			break;
+
+		// The memory is committed once the upload is under way.
+		if(mResidency != nullptr)
+			mResidency->SetResidentMip(i, mip);
+
+		t.UploadInFlight = true;
+		t.UploadMip = mip;
+		mStats.UploadsStarted++;
+		mStats.UploadsInFlight++;
+	}
+}
+
+uint32_t TextureStreamer::GetTextureCount()const
+{
+	return (uint32_t)mTextures.size();
+}
+
+uint32_t TextureStreamer::GetResidentMip(uint32_t texture)const
+{
+	return mTextures[texture].VisibleMip;
+}
+
+uint32_t TextureStreamer::GetWantedMip(uint32_t texture)const
+{
+	return ComputeWantedMip(texture);
+}
+
+const TextureStreamerStats& TextureStreamer::GetStats()const
+{
+	return mStats;
+}
+
+bool TextureStreamer::ApplyEvictions()
+{
+	for(const TextureEviction& e : mEvictions)
+	{
+		// A texture whose upload is still in flight is in use, so it keeps its mips.
+		TextureState& t = mTextures[e.Texture];
+		if(t.UploadInFlight || e.Mip <= t.LoadedMip || !mBackend.EvictMips(e.Texture, e.Mip))
+			return false;
+
+		t.LoadedMip = e.Mip;
+		t.VisibleMip = e.Mip;
+		mResidency->SetResidentMip(e.Texture, e.Mip);
+	}
+
+	return true;
+}
+
+uint32_t TextureStreamer::ComputeWantedMip(uint32_t texture)const
+{
+	const TextureState& t = mTextures[texture];
+
+	// Not visible this frame: keep what we have.
+	if(t.Footprint <= 0.0f)
+		return t.LoadedMip;
+
+	// The mip whose size is closest to, but not below, the footprint.
+	float size = (float)std::max(t.Desc.Width, t.Desc.Height);
+	float mip = std::floor(std::log2(std::max(size / t.Footprint, 1.0f)));
+
+	return std::min((uint32_t)mip, t.Desc.MipCount - 1);
+}
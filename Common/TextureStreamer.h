@@ -0,0 +1,127 @@
+//***************************************************************************************
+// TextureStreamer.h
+//
+// Decides which mip levels to stream in, and in what order.
+//   -Each texture starts with only its mip tail resident.
+//   -Every frame the caller reports how many pixels each texture covers on screen.  A
+//    texture wants the mip whose size matches that footprint, and the textures that are
+//    furthest below their wanted mip (largest footprint first) get the upload slots.
+//   -Mips arrive one at a time, most detailed last, and the clamp is only lowered to a
+//    mip after its upload has completed.
+//
+// The streamer knows nothing about Direct3D: all work goes through a
+// TextureStreamingBackend, so the scheduling can be driven by a fake backend in tests.
+// Resident mips are only evicted when a TextureResidencyManager is attached; it picks
+// the mips that have to go to keep the streamed textures within its budget.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TextureResidency.h"
+
+struct StreamedTextureDesc
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 1;
+
+	// Most detailed mip that is resident after the initial load.
+	uint32_t ResidentMip = 0;
+};
+
+class TextureStreamingBackend
+{
+public:
+	virtual ~TextureStreamingBackend() = default;
+
+	// Starts streaming one mip level (every array slice) of a texture.  Returns false if
+	// the backend can't take another upload right now; the streamer retries later.
+	virtual bool BeginMipUpload(uint32_t texture, uint32_t mip) = 0;
+
+	// True once an upload started by BeginMipUpload can be sampled by the GPU.
+	virtual bool IsMipUploadComplete(uint32_t texture, uint32_t mip) = 0;
+
+	// Lets the GPU sample the texture from mip onwards.  Returns false if the change can't
+	// be applied yet; the streamer retries on the next Update.
+	virtual bool SetMinResidentMip(uint32_t texture, uint32_t mip) = 0;
+
+	// Releases every mip more detailed than mip and clamps the texture to it.  Returns
+	// false if the texture can't shrink right now.  Backends that never free memory can
+	// keep the default.
+	virtual bool EvictMips(uint32_t /*texture*/, uint32_t /*mip*/) { return false; }
+};
+
+struct TextureStreamerStats
+{
+	uint32_t UploadsStarted = 0;
+	uint32_t UploadsCompleted = 0;
+	uint32_t UploadsInFlight = 0;
+
+	// Textures that want a more detailed mip than they have, including those in flight.
+	uint32_t TexturesWaiting = 0;
+
+	// Uploads held back because the budget couldn't be met.
+	uint32_t UploadsOverBudget = 0;
+};
+
+class TextureStreamer
+{
+public:
+	explicit TextureStreamer(TextureStreamingBackend& backend, uint32_t maxUploadsInFlight = 2);
+
+	// Returns the id the backend is called with for this texture.
+	uint32_t AddTexture(const StreamedTextureDesc& desc);
+
+	// Optional.  Its textures must be added in the same order as the streamer's.
+	void SetResidencyManager(TextureResidencyManager* residency);
+
+	// Call once per frame before reporting the footprints.
+	void BeginFrame();
+
+	// Reports that a texture covers `pixels` texels' worth of screen along its larger axis.
+	// A texture seen several times keeps its largest footprint.
+	void AddFootprint(uint32_t texture, float pixels);
+
+	// Retires finished uploads, lowers clamps and starts new uploads in priority order.
+	void Update();
+
+	uint32_t GetTextureCount()const;
+	uint32_t GetResidentMip(uint32_t texture)const;
+	uint32_t GetWantedMip(uint32_t texture)const;
+	const TextureStreamerStats& GetStats()const;
+
+private:
+	uint32_t ComputeWantedMip(uint32_t texture)const;
+	bool ApplyEvictions();
+
+private:
+	struct TextureState
+	{
+		StreamedTextureDesc Desc;
+
+		// Most detailed mip whose data is on the GPU.
+		uint32_t LoadedMip = 0;
+
+		// Most detailed mip the GPU is allowed to sample.
+		uint32_t VisibleMip = 0;
+
+		bool UploadInFlight = false;
+		uint32_t UploadMip = 0;
+
+		float Footprint = 0.0f;
+	};
+
+	TextureStreamingBackend& mBackend;
+	uint32_t mMaxUploadsInFlight = 2;
+
+	std::vector<TextureState> mTextures;
+	std::vector<uint32_t> mCandidates;
+
+	TextureResidencyManager* mResidency = nullptr;
+	std::vector<TextureEviction> mEvictions;
+
+	TextureStreamerStats mStats;
+};
@@ -0,0 +1,118 @@
+//***************************************************************************************
+// ThreadPool.cpp
+//***************************************************************************************
+
+#include "ThreadPool.h"
+
+#include <exception>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if(threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	mWorkers.reserve(threadCount);
+	for(unsigned int i = 0; i < threadCount; ++i)
+		mWorkers.emplace_back(&ThreadPool::WorkerMain, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+
+	// Workers drain the queue before they exit.
+	for(auto& worker : mWorkers)
+		worker.join();
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task)
+{
+	std::packaged_task<void()> packaged(std::move(task));
+	std::future<void> result = packaged.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTasks.push(std::move(packaged));
+	}
+	mWake.notify_one();
+
+	return result;
+}
+
+unsigned int ThreadPool::GetThreadCount()const
+{
+	return (unsigned int)mWorkers.size();
+}
+
+void ParallelFor(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task)
+{
+	std::vector<std::future<void>> done;
+	if(pool != nullptr && count > 1)
+	{
+		done.reserve(count - 1);
+		for(size_t i = 1; i < count; ++i)
+			done.push_back(pool->Submit([&task, i]() { task(i); }));
+	}
+
+	std::exception_ptr error;
+	auto keepFirst = [&error]()
+	{
+		if(error == nullptr)
+			error = std::current_exception();
+	};
+
+	size_t here = done.empty() ? count : 1;
+	for(size_t i = 0; i < here; ++i)
+	{
+		try
+		{
+			task(i);
+		}
+		catch(...)
+		{
+			keepFirst();
+		}
+	}
+
+	for(auto& d : done)
+	{
+		try
+		{
+			d.get();
+		}
+		catch(...)
+		{
+			keepFirst();
+		}
+	}
+
+	if(error != nullptr)
+		std::rethrow_exception(error);
+}
+
+void ThreadPool::WorkerMain()
+{
+	for(;;)
+	{
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this]{ return mStopping || !mTasks.empty(); });
+
+			if(mTasks.empty())
+				return;
+
+			task = std::move(mTasks.front());
+			mTasks.pop();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,49 @@
+//***************************************************************************************
+// ThreadPool.h
+//
+// A fixed set of worker threads pulling tasks from one queue.  Submit returns a future
+// that becomes ready when the task has run; an exception thrown by a task is stored in
+// the future and rethrown by get().  ParallelFor runs a loop's iterations across a pool.
+//***************************************************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// threadCount = 0 uses one thread per hardware thread, less one for the main thread.
+	explicit ThreadPool(unsigned int threadCount = 0);
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+	~ThreadPool();
+
+	std::future<void> Submit(std::function<void()> task);
+
+	unsigned int GetThreadCount()const;
+
+private:
+	void WorkerMain();
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::queue<std::packaged_task<void()>> mTasks;
+	bool mStopping = false;
+};
+
+// Runs task(0) .. task(count - 1) and waits for all of them: task(0) on the calling
+// thread and the rest on the pool, or all on the calling thread if pool is null.  Every
+// task runs even if another throws; once all have finished, the first exception one
+// threw is rethrown, so no task is still using the caller's locals when it unwinds.
+void ParallelFor(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task);
@@ -55,6 +55,29 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copies only part of an element, e.g. a block of constants that changed.
+    void CopyData(int elementIndex, const T& data, UINT byteOffset, UINT byteCount)
+    {
+        const BYTE* src = reinterpret_cast<const BYTE*>(&data) + byteOffset;
+        memcpy(&mMappedData[elementIndex*mElementByteSize + byteOffset], src, byteCount);
+    }
+
+    // Copies a contiguous run of elements in one go.  Only valid for buffers that are
+    // not constant buffers, where elements are tightly packed.
+    void CopyData(int startIndex, const T* data, UINT count)
+    {
+        assert(!mIsConstantBuffer);
+        memcpy(&mMappedData[startIndex*mElementByteSize], data, sizeof(T)*count);
+    }
+
+    // The mapped elements, for writing them in place.  Only valid for buffers that are
+    // not constant buffers.
+    T* MappedData()
+    {
+        assert(!mIsConstantBuffer);
+        return reinterpret_cast<T*>(mMappedData);
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
@@ -1,10 +1,209 @@
 
 #include "d3dUtil.h"
+#include "BinaryFile.h"
+#include "AssetArchive.h"
 #include <comdef.h>
 #include <fstream>
+#include <iterator>
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+	// Set by d3dUtil::SetAssetArchive; files it holds are read from it instead of their own.
+	const AssetArchive* gAssetArchive = nullptr;
+
+	int32_t FindArchived(const std::wstring& path)
+	{
+		return gAssetArchive != nullptr ? gAssetArchive->Find(path) : -1;
+	}
+
+	bool ReadText(const std::wstring& path, std::string& text)
+	{
+		int32_t entry = FindArchived(path);
+		if(entry >= 0)
+		{
+			text.resize((size_t)gAssetArchive->GetEntry((uint32_t)entry).Size);
+			return gAssetArchive->Read((uint32_t)entry, &text[0]) == AssetArchiveResult::Ok;
+		}
+
+		std::ifstream fin(path, std::ios::binary);
+		if(!fin)
+			return false;
+
+		text.assign((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// Resolves #include "file" against the directory of the shader being preprocessed.
+	class ShaderInclude : public ID3DInclude
+	{
+	public:
+		explicit ShaderInclude(const std::wstring& directory)
+			: mDirectory(directory)
+		{
+		}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR fileName, LPCVOID, LPCVOID* data, UINT* bytes) override
+		{
+			std::string text;
+			if(!ReadText(mDirectory + AnsiToWString(fileName), text))
+				return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+			char* copy = new char[text.size() + 1];
+			memcpy(copy, text.c_str(), text.size() + 1);
+
+			*data = copy;
+			*bytes = (UINT)text.size();
+			return S_OK;
+		}
+
+		HRESULT __stdcall Close(LPCVOID data) override
+		{
+			delete[] static_cast<const char*>(data);
+			return S_OK;
+		}
+
+	private:
+		std::wstring mDirectory;
+	};
+
+	class D3DShaderCacheBackend : public ShaderCacheBackend
+	{
+	public:
+		std::string GetCompilerId() override
+		{
+			return "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION);
+		}
+
+		bool Preprocess(const ShaderCompileRequest& request, std::string& source) override
+		{
+			std::string text;
+			if(!ReadText(request.Filename, text))
+				return false;
+
+			ShaderInclude include(GetDirectory(request.Filename));
+
+			std::vector<D3D_SHADER_MACRO> macros = GetMacros(request);
+			std::string sourceName = WideToAnsi(request.Filename);
+
+			ComPtr<ID3DBlob> output;
+			ComPtr<ID3DBlob> errors;
+			HRESULT hr = D3DPreprocess(text.data(), text.size(), sourceName.c_str(), macros.data(),
+				&include, &output, &errors);
+			if(FAILED(hr))
+				return false;
+
+			source.assign((const char*)output->GetBufferPointer(), output->GetBufferSize());
+			return true;
+		}
+
+		bool Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode) override
+		{
+			// Compiled from the text rather than the file, so the source and its includes
+			// come from the asset archive when there is one.
+			std::string text;
+			if(!ReadText(request.Filename, text))
+				ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+			ShaderInclude include(GetDirectory(request.Filename));
+
+			std::vector<D3D_SHADER_MACRO> macros = GetMacros(request);
+			std::string sourceName = WideToAnsi(request.Filename);
+
+			ComPtr<ID3DBlob> byteCode = nullptr;
+			ComPtr<ID3DBlob> errors;
+			HRESULT hr = D3DCompile(text.data(), text.size(), sourceName.c_str(), macros.data(), &include,
+				request.EntryPoint.c_str(), request.Target.c_str(), request.Flags, 0, &byteCode, &errors);
+
+			if(errors != nullptr)
+				OutputDebugStringA((char*)errors->GetBufferPointer());
+
+			ThrowIfFailed(hr);
+
+			const uint8_t* data = (const uint8_t*)byteCode->GetBufferPointer();
+			bytecode.assign(data, data + byteCode->GetBufferSize());
+			return true;
+		}
+
+		bool Load(const std::wstring& path, std::vector<uint8_t>& data) override
+		{
+			// An entry that can't be read is a miss like one that isn't there.  Entries packed
+			// into the asset archive are keyed the same way, so they are as good as loose ones.
+			int32_t entry = FindArchived(path);
+			if(entry >= 0)
+				return gAssetArchive->Read((uint32_t)entry, data) == AssetArchiveResult::Ok;
+
+			return ReadBinaryFile(path.c_str(), data) == BinaryFileResult::Ok;
+		}
+
+		bool Store(const std::wstring& path, const std::vector<uint8_t>& data) override
+		{
+			size_t slash = path.find_last_of(L"\\/");
+			if(slash != std::wstring::npos)
+				CreateDirectoryW(path.substr(0, slash).c_str(), nullptr);
+
+			// Written aside and then moved into place, so a reader never sees half an entry.
+			std::wstring temp = path + L".tmp";
+			{
+				std::ofstream fout(temp, std::ios::binary);
+				fout.write((const char*)data.data(), data.size());
+				if(fout.fail())
+					return false;
+			}
+
+			return MoveFileExW(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+		}
+
+	private:
+		static std::wstring GetDirectory(const std::wstring& filename)
+		{
+			size_t slash = filename.find_last_of(L"\\/");
+			return slash == std::wstring::npos ? L"" : filename.substr(0, slash + 1);
+		}
+
+		static std::vector<D3D_SHADER_MACRO> GetMacros(const ShaderCompileRequest& request)
+		{
+			std::vector<D3D_SHADER_MACRO> macros;
+			for(const auto& define : request.Defines)
+				macros.push_back({ define.first.c_str(), define.second.c_str() });
+			macros.push_back({ nullptr, nullptr });
+			return macros;
+		}
+
+		static std::string WideToAnsi(const std::wstring& str)
+		{
+			char buffer[512];
+			WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, buffer, 512, nullptr, nullptr);
+			return std::string(buffer);
+		}
+	};
+
+	struct ShaderCacheState
+	{
+		D3DShaderCacheBackend Backend;
+		std::unique_ptr<ShaderCache> Cache;
+	};
+
+	HRESULT GetBinaryFileHResult(BinaryFileResult result)
+	{
+		switch(result)
+		{
+		case BinaryFileResult::Ok:         return S_OK;
+		case BinaryFileResult::NotFound:   return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+		case BinaryFileResult::TooLarge:   return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+		case BinaryFileResult::ReadFailed: return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+		default:                           return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+		}
+	}
+
+	ShaderCacheState& GetShaderCacheState()
+	{
+		static ShaderCacheState state;
+		return state;
+	}
+}
+
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
     FunctionName(functionName),
@@ -20,17 +219,25 @@ bool d3dUtil::IsKeyDown(int vkeyCode)
 
 ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
 {
-    std::ifstream fin(filename, std::ios::binary);
+    int32_t entry = FindArchived(filename);
+    if(entry >= 0)
+    {
+        ComPtr<ID3DBlob> blob;
+        ThrowIfFailed(D3DCreateBlob((SIZE_T)gAssetArchive->GetEntry((uint32_t)entry).Size, blob.GetAddressOf()));
+        if(gAssetArchive->Read((uint32_t)entry, blob->GetBufferPointer()) != AssetArchiveResult::Ok)
+            ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT));
 
-    fin.seekg(0, std::ios_base::end);
-    std::ifstream::pos_type size = (int)fin.tellg();
-    fin.seekg(0, std::ios_base::beg);
+        return blob;
+    }
 
-    ComPtr<ID3DBlob> blob;
-    ThrowIfFailed(D3DCreateBlob(size, blob.GetAddressOf()));
+    // The size is checked before the blob is allocated, and a file that can't be read
+    // throws rather than returning a blob of garbage.
+    BinaryFile file;
+    ThrowIfFailed(GetBinaryFileHResult(file.Open(filename.c_str())));
 
-    fin.read((char*)blob->GetBufferPointer(), size);
-    fin.close();
+    ComPtr<ID3DBlob> blob;
+    ThrowIfFailed(D3DCreateBlob((SIZE_T)file.GetSize(), blob.GetAddressOf()));
+    ThrowIfFailed(GetBinaryFileHResult(file.Read(blob->GetBufferPointer())));
 
     return blob;
 }
@@ -41,6 +248,22 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     const void* initData,
     UINT64 byteSize,
     Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+{
+    std::vector<D3D12_RESOURCE_BARRIER> readBarriers;
+    ComPtr<ID3D12Resource> defaultBuffer = CreateDefaultBuffer(device, cmdList, initData, byteSize,
+        uploadBuffer, readBarriers);
+	cmdList->ResourceBarrier((UINT)readBarriers.size(), readBarriers.data());
+
+    return defaultBuffer;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
+    ID3D12Device* device,
+    ID3D12GraphicsCommandList* cmdList,
+    const void* initData,
+    UINT64 byteSize,
+    Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+    std::vector<D3D12_RESOURCE_BARRIER>& readBarriers)
 {
     ComPtr<ID3D12Resource> defaultBuffer;
 
@@ -72,11 +295,10 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
 
     // Schedule to copy the data to the default buffer resource.  At a high level, the helper function UpdateSubresources
     // will copy the CPU memory into the intermediate upload heap.  Then, using ID3D12CommandList::CopySubresourceRegion,
-    // the intermediate upload heap data will be copied to mBuffer.
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), 
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+    // the intermediate upload heap data will be copied to mBuffer.  The copy implicitly
+    // promotes the buffer from COMMON to COPY_DEST, so only the transition after it is needed.
     UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+	readBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
 		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
 
     // Note: uploadBuffer has to be kept alive after the above function calls because
@@ -93,24 +315,56 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	const std::string& entrypoint,
 	const std::string& target)
 {
-	UINT compileFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)  
-	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+	ShaderCompileRequest request;
+	request.Filename = filename;
+	for(const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; ++define)
+		request.Defines.emplace_back(define->Name, define->Definition != nullptr ? define->Definition : "");
+	request.EntryPoint = entrypoint;
+	request.Target = target;
 
-	HRESULT hr = S_OK;
+	std::vector<uint8_t> bytecode;
+	CompileShader(request, bytecode);
 
 	ComPtr<ID3DBlob> byteCode = nullptr;
-	ComPtr<ID3DBlob> errors;
-	hr = D3DCompileFromFile(filename.c_str(), defines, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		entrypoint.c_str(), target.c_str(), compileFlags, 0, &byteCode, &errors);
+	ThrowIfFailed(D3DCreateBlob(bytecode.size(), byteCode.GetAddressOf()));
+	memcpy(byteCode->GetBufferPointer(), bytecode.data(), bytecode.size());
 
-	if(errors != nullptr)
-		OutputDebugStringA((char*)errors->GetBufferPointer());
+	return byteCode;
+}
 
-	ThrowIfFailed(hr);
+void d3dUtil::CompileShader(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+{
+	ShaderCompileRequest flagged = request;
+#if defined(DEBUG) || defined(_DEBUG)  
+	flagged.Flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
 
-	return byteCode;
+	// The backend throws with the compiler's HRESULT if the shader doesn't compile.
+	ShaderCacheState& state = GetShaderCacheState();
+	if(state.Cache != nullptr)
+		state.Cache->GetBytecode(flagged, bytecode);
+	else
+		state.Backend.Compile(flagged, bytecode);
+}
+
+void d3dUtil::SetShaderCacheDirectory(const std::wstring& directory)
+{
+	ShaderCacheState& state = GetShaderCacheState();
+	if(directory.empty())
+		state.Cache = nullptr;
+	else
+		state.Cache = std::make_unique<ShaderCache>(state.Backend, directory);
+}
+
+void d3dUtil::SetAssetArchive(const AssetArchive* archive)
+{
+	gAssetArchive = archive;
+}
+
+ShaderCacheStats d3dUtil::GetShaderCacheStats()
+{
+	ShaderCacheState& state = GetShaderCacheState();
+	return state.Cache != nullptr ? state.Cache->GetStats() : ShaderCacheStats();
 }
 
 std::wstring DxException::ToString()const
@@ -24,8 +24,13 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "ShaderCache.h"
 
-extern const int gNumFrameResources;
+// Number of frame resources the app cycles through.  It is chosen once at startup,
+// before any frame resource, render item or material is created, and must lie in
+// [1, gMaxNumFrameResources].
+extern int gNumFrameResources;
+const int gMaxNumFrameResources = 4;
 
 inline void d3dSetDebugName(IDXGIObject* obj, const char* name)
 {
@@ -84,6 +89,8 @@ inline std::wstring AnsiToWString(const std::string& str)
 #endif
 	*/
 
+class AssetArchive;
+
 class d3dUtil
 {
 public:
@@ -108,6 +115,8 @@ public:
 		return (byteSize + 255) & ~255;
 	}
 
+	// Throws if the file is missing or can't be read.  BinaryFile.h has readers that
+	// report errors instead, map large files and read asynchronously.
 	static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
 
 	static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
@@ -117,11 +126,38 @@ public:
 		UINT64 byteSize,
 		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
+	// The same, but the buffer's transition to GENERIC_READ is appended to readBarriers
+	// rather than recorded, so uploading many buffers can end in one ResourceBarrier call.
+	// The copy needs no barrier before it: a buffer in COMMON is promoted to COPY_DEST.
+	static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+		ID3D12Device* device,
+		ID3D12GraphicsCommandList* cmdList,
+		const void* initData,
+		UINT64 byteSize,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+		std::vector<D3D12_RESOURCE_BARRIER>& readBarriers);
+
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
 		const D3D_SHADER_MACRO* defines,
 		const std::string& entrypoint,
 		const std::string& target);
+
+	// The same for a request built elsewhere, such as a ShaderLibrary permutation; the
+	// debug flags are added here.  Throws if the shader doesn't compile.
+	static void CompileShader(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode);
+
+	// Makes CompileShader keep its bytecode in directory (created when first written)
+	// and reuse it while the preprocessed source is unchanged.  See ShaderCache.h.  An
+	// empty directory turns the cache off.
+	static void SetShaderCacheDirectory(const std::wstring& directory);
+	static ShaderCacheStats GetShaderCacheStats();
+
+	// Makes LoadBinary, CompileShader (the sources and their includes) and the shader
+	// cache read the files archive holds from it rather than from disk.  The archive must
+	// stay open until it is replaced or set to null; set it before anything is loaded, as
+	// the loads don't lock.
+	static void SetAssetArchive(const AssetArchive* archive);
 };
 
 class DxException
@@ -260,6 +296,12 @@ struct MaterialConstants
 
 	// Used in texture mapping.
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// Slot of the diffuse texture in the bindless SRV range, and its array slice.
+	UINT DiffuseSrvIndex = 0;
+	UINT DiffuseArraySlice = 0;
+	UINT MatPad0 = 0;
+	UINT MatPad1 = 0;
 };
 
 // Simple struct to represent a material for our demos.  A production 3D engine
@@ -272,9 +314,14 @@ struct Material
 	// Index into constant buffer corresponding to this material.
 	int MatCBIndex = -1;
 
-	// Index into SRV heap for diffuse texture.
+	// Name of the diffuse texture, and the index of its SRV in the heap once the views
+	// have been created.
+	std::string DiffuseTexture;
 	int DiffuseSrvHeapIndex = -1;
 
+	// Slice of the diffuse texture when it was packed into an array with others.
+	int DiffuseArraySlice = 0;
+
 	// Index into SRV heap for normal texture.
 	int NormalSrvHeapIndex = -1;
 
@@ -300,6 +347,10 @@ struct Texture
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
+
+	// Slot of its SRV in the shader-visible heap, -1 until one is created.  Streamed
+	// textures have theirs managed by the uploader instead.
+	int SrvHeapIndex = -1;
 };
 
 #ifndef ThrowIfFailed
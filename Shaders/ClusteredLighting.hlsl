@@ -0,0 +1,50 @@
+//***************************************************************************************
+// ClusteredLighting.hlsl
+//
+// Point and spot light evaluation for the clustered forward path.  The CPU bins the
+// lights into screen tile x depth slice clusters (see LightClusterGrid), and each pixel
+// only loops over the lights that touch its own cluster.
+//
+// Include after LightingUtil.hlsl and after the cbPass declaration, which provides the
+// gCluster* constants.
+//***************************************************************************************
+
+// Point lights first, then spot lights.
+StructuredBuffer<Light> gClusterLights        : register(t1);
+
+// (offset, count) into gClusterLightIndices for every cluster.
+StructuredBuffer<uint2> gClusterRanges        : register(t2);
+StructuredBuffer<uint>  gClusterLightIndices  : register(t3);
+
+uint ComputeClusterIndex(float2 screenPos, float viewZ)
+{
+    // Exponential depth slicing: slice = log(z/near) / log(far/near) * slices.
+    uint slice = (uint)max(log(viewZ) * gClusterSliceScale - gClusterSliceBias, 0.0f);
+    slice = min(slice, gClusterSlices - 1);
+
+    uint2 tile = min((uint2)(screenPos / gClusterTileSize), uint2(gClusterTilesX - 1, gClusterTilesY - 1));
+
+    return (slice * gClusterTilesY + tile.y) * gClusterTilesX + tile.x;
+}
+
+// screenPos is SV_Position.xy and viewZ is SV_Position.w of the fragment.
+float3 ComputeClusteredLighting(Material mat, float2 screenPos, float viewZ,
+    float3 pos, float3 normal, float3 toEye)
+{
+    uint2 range = gClusterRanges[ComputeClusterIndex(screenPos, viewZ)];
+
+    float3 result = 0.0f;
+
+    for (uint i = 0; i < range.y; ++i)
+    {
+        uint lightIndex = gClusterLightIndices[range.x + i];
+        Light L = gClusterLights[lightIndex];
+
+        if (lightIndex < gClusterPointLightCount)
+            result += ComputePointLight(L, mat, pos, normal, toEye);
+        else
+            result += ComputeSpotLight(L, mat, pos, normal, toEye);
+    }
+
+    return result;
+}
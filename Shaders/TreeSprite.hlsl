@@ -2,23 +2,25 @@
 // TreeSprite.hlsl.
 //***************************************************************************************
 
-// Defaults for number of lights.
+// Defaults for number of lights.  Point and spot lights go through the clustered
+// path (ClusteredLighting.hlsl), so only directional lights use gLights.
 #ifndef NUM_DIR_LIGHTS
     #define NUM_DIR_LIGHTS 1
 #endif
 
 #ifndef NUM_POINT_LIGHTS
-    #define NUM_POINT_LIGHTS 7
+    #define NUM_POINT_LIGHTS 0
 #endif
 
 #ifndef NUM_SPOT_LIGHTS
-    #define NUM_SPOT_LIGHTS 1
+    #define NUM_SPOT_LIGHTS 0
 #endif
 
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 //step5
-Texture2DArray gTreeMapArray : register(t0);
+// Every texture in the SRV heap; the material picks treeArray.
+Texture2DArray gTextureMaps[] : register(t0, space1);
 
 //you can use dynamic indexing as well. Pay attention how we changed the sampler!
 //Texture2D gTreeMapArray[3] : register(t0);
@@ -31,12 +33,10 @@ SamplerState gsamLinearClamp      : register(s3);
 SamplerState gsamAnisotropicWrap  : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 
-// Constant data that varies per frame.
-cbuffer cbPerObject : register(b0)
+// Object index in the high bits, material index in the low 12 (see BindlessTable.h).
+cbuffer cbDraw : register(b0)
 {
-    float4x4 gWorld;
-	float4x4 tWorld;
-	float4x4 gTexTransform;
+    uint gDrawIndex;
 };
 
 // Constant data that varies per material.
@@ -58,25 +58,36 @@ cbuffer cbPass : register(b1)
     float gDeltaTime;
     float4 gAmbientLight;
 
-	float4 gFogColor;
-	float gFogStart;
-	float gFogRange;
-	float2 cbPerObjectPad2;
-
     // Indices [0, NUM_DIR_LIGHTS) are directional lights;
     // indices [NUM_DIR_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHTS) are point lights;
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light gLights[MaxLights];
+
+    uint gClusterTilesX;
+    uint gClusterTilesY;
+    uint gClusterSlices;
+    uint gClusterPointLightCount;
+    float2 gClusterTileSize;
+    float gClusterSliceScale;
+    float gClusterSliceBias;
 };
 
-cbuffer cbMaterial : register(b2)
+#include "ClusteredLighting.hlsl"
+
+struct MaterialData
 {
-	float4   gDiffuseAlbedo;
-    float3   gFresnelR0;
-    float    gRoughness;
-	float4x4 gMatTransform;
+	float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+	float4x4 MatTransform;
+    uint     DiffuseSrvIndex;
+    uint     DiffuseArraySlice;
+    uint     MatPad0;
+    uint     MatPad1;
 };
+
+StructuredBuffer<MaterialData> gMaterialData : register(t4);
  
 struct VertexIn
 {
@@ -171,8 +182,10 @@ void GS(point VertexOut gin[1], //PrimitiveType InputVertexType InputName[NumEle
 //step6
 float4 PS(GeoOut pin) : SV_Target
 {
+	MaterialData matData = gMaterialData[gDrawIndex & 0xFFF];
+
 	float3 uvw = float3(pin.TexC, pin.PrimID%3);
-    float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * gDiffuseAlbedo;
+    float4 diffuseAlbedo = gTextureMaps[matData.DiffuseSrvIndex].Sample(gsamAnisotropicWrap, uvw) * matData.DiffuseAlbedo;
 
     //using dynamic indexing
     //float4 diffuseAlbedo = gTreeMapArray[pin.PrimID % 3].Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
@@ -196,19 +209,16 @@ float4 PS(GeoOut pin) : SV_Target
     // Light terms.
     float4 ambient = gAmbientLight*diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
         pin.NormalW, toEyeW, shadowFactor);
+    directLight.rgb += ComputeClusteredLighting(mat, pin.PosH.xy, pin.PosH.w,
+        pin.PosW, pin.NormalW, toEyeW);
 
     float4 litColor = ambient + directLight;
 
-#ifdef FOG
-	float fogAmount = saturate((distToEye - gFogStart) / gFogRange);
-	litColor = lerp(litColor, gFogColor, fogAmount);
-#endif
-
     // Common convention to take alpha from diffuse albedo.
     litColor.a = diffuseAlbedo.a;
 
@@ -4,23 +4,26 @@
 // 
 //***************************************************************************************
 
-// Defaults for number of lights.
+// Defaults for number of lights.  Point and spot lights go through the clustered
+// path (ClusteredLighting.hlsl), so only directional lights use gLights.
 #ifndef NUM_DIR_LIGHTS
 #define NUM_DIR_LIGHTS 1
 #endif
 
 #ifndef NUM_POINT_LIGHTS
-#define NUM_POINT_LIGHTS 9
+#define NUM_POINT_LIGHTS 0
 #endif
 
 #ifndef NUM_SPOT_LIGHTS
-#define NUM_SPOT_LIGHTS 1
+#define NUM_SPOT_LIGHTS 0
 #endif
 
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
-Texture2D    gDiffuseMap : register(t0);
+// Every texture in the SRV heap.  Single textures are bound as one-slice arrays; the
+// material picks the texture and the slice.
+Texture2DArray gTextureMaps[] : register(t0, space1);
 
 
 SamplerState gsamPointWrap        : register(s0);
@@ -30,14 +33,34 @@ SamplerState gsamLinearClamp      : register(s3);
 SamplerState gsamAnisotropicWrap  : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 
-// Constant data that varies per frame.
-cbuffer cbPerObject : register(b0)
+// Object index in the high bits, material index in the low 12 (see BindlessTable.h).
+cbuffer cbDraw : register(b0)
 {
-    float4x4 gWorld;
-    float4x4 tWorld;
-    float4x4 gTexTransform;
+    uint gDrawIndex;
 };
 
+struct ObjectData
+{
+    float4x4 World;
+    float4x4 TWorld;
+    float4x4 TexTransform;
+};
+
+struct MaterialData
+{
+    float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+    float4x4 MatTransform;
+    uint     DiffuseSrvIndex;
+    uint     DiffuseArraySlice;
+    uint     MatPad0;
+    uint     MatPad1;
+};
+
+StructuredBuffer<MaterialData> gMaterialData : register(t4);
+StructuredBuffer<ObjectData> gObjectData : register(t5);
+
 // Constant data that varies per material.
 cbuffer cbPass : register(b1)
 {
@@ -62,16 +85,18 @@ cbuffer cbPass : register(b1)
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light gLights[MaxLights];
-};
 
-cbuffer cbMaterial : register(b2)
-{
-    float4   gDiffuseAlbedo;
-    float3   gFresnelR0;
-    float    gRoughness;
-    float4x4 gMatTransform;
+    uint gClusterTilesX;
+    uint gClusterTilesY;
+    uint gClusterSlices;
+    uint gClusterPointLightCount;
+    float2 gClusterTileSize;
+    float gClusterSliceScale;
+    float gClusterSliceBias;
 };
 
+#include "ClusteredLighting.hlsl"
+
 struct VertexIn
 {
     float3 PosL    : POSITION;
@@ -91,26 +116,33 @@ VertexOut VS(VertexIn vin)
 {
     VertexOut vout = (VertexOut)0.0f;
 
+    ObjectData objData = gObjectData[gDrawIndex >> 12];
+    MaterialData matData = gMaterialData[gDrawIndex & 0xFFF];
+
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), objData.World);
     vout.PosW = posW.xyz;
      
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)tWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)objData.TWorld);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
 
     // Output vertex attributes for interpolation across triangle.
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-    vout.TexC = mul(texC, gMatTransform).xy;
+    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), objData.TexTransform);
+    vout.TexC = mul(texC, matData.MatTransform).xy;
 
     return vout;
 }
 
 float4 PS(VertexOut pin) : SV_Target
 {
-    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+    MaterialData matData = gMaterialData[gDrawIndex & 0xFFF];
+
+    // The index is the same for the whole draw, so it needs no NonUniformResourceIndex.
+    float4 diffuseAlbedo = gTextureMaps[matData.DiffuseSrvIndex].Sample(gsamAnisotropicWrap,
+        float3(pin.TexC, matData.DiffuseArraySlice)) * matData.DiffuseAlbedo;
 
 #ifdef ALPHA_TEST
     // Discard pixel if texture alpha < 0.1.  We do this test as soon 
@@ -130,11 +162,13 @@ float4 PS(VertexOut pin) : SV_Target
     // Light terms.
     float4 ambient = gAmbientLight * diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
         pin.NormalW, toEyeW, shadowFactor);
+    directLight.rgb += ComputeClusteredLighting(mat, pin.PosH.xy, pin.PosH.w,
+        pin.PosW, pin.NormalW, toEyeW);
 
     float4 litColor = ambient + directLight;
 
@@ -0,0 +1,198 @@
+//***************************************************************************************
+// ArchiveReadBench.cpp
+//
+// CommonBench ArchiveReads [archive]
+// Reads every file in an asset archive through it, opening the archive and decompressing
+// on a ThreadPool, and then each from its loose file, one after another as startup used
+// to.  The archive's entries name the loose files from the working directory, so run it
+// where the demo runs; the names are stored in lower case, so where file names are case
+// sensitive the loose files have to be too.  Without an archive it writes a set of files
+// like the demo's assets, and their archive, to a temporary directory.
+//
+// The first pass of each is reported on its own; it's a cold read only if the files
+// aren't in the file cache yet, after a reboot say.  The later passes are warm and the
+// best is kept.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "AssetArchive.h"
+#include "BinaryFile.h"
+#include "DDSTestFiles.h"
+#include "TempDirectory.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// About what the demo loads: a few mipped RGBA8 textures, a block compressed texture
+	// array (noise, as LZ4 can't shrink those either), shader sources and cached bytecode.
+	bool WriteAssets(const TempDirectory& directory)
+	{
+		bool written = true;
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			std::vector<uint8_t> texture = MakeRGBA8DDSFile(512, 512, 10, 1,
+				[i](uint32_t x, uint32_t y, uint32_t mip, uint32_t, uint8_t* rgba)
+				{
+					uint32_t cell = ((x >> 4) + (y >> 4) + i) & 7;
+					rgba[0] = (uint8_t)(cell * 30 + mip);
+					rgba[1] = (uint8_t)(x ^ y);
+					rgba[2] = (uint8_t)(cell * 11);
+					rgba[3] = 255;
+				});
+			written = written && directory.WriteFile("textures/texture" + std::to_string(i) + ".dds", texture);
+		}
+
+		std::mt19937 rng(46);
+		std::vector<uint8_t> noise(4 * 1024 * 1024);
+		for(auto& b : noise)
+			b = (uint8_t)rng();
+		written = written && directory.WriteFile("textures/treearray2.dds", noise);
+
+		std::string source;
+		for(int i = 0; i < 300; ++i)
+			source += "float4 PS(VertexOut pin) : SV_Target { return ComputeLighting(gLights, mat, pin.PosW, bumpedNormalW); }\n";
+		for(const char* name : { "shaders/color.hlsl", "shaders/treesprite.hlsl", "shaders/lightingutil.hlsl" })
+			written = written && directory.WriteFile(name, std::vector<uint8_t>(source.begin(), source.end()));
+
+		for(uint32_t i = 0; i < 6; ++i)
+		{
+			std::vector<uint8_t> bytecode(20000 + i * 3000);
+			for(size_t b = 0; b < bytecode.size(); ++b)
+				bytecode[b] = (uint8_t)((b % 64 < 16) ? rng() : b / 64);
+			written = written && directory.WriteFile("shadercache/shader" + std::to_string(i) + ".cso", bytecode);
+		}
+		return written;
+	}
+
+	bool PackAssets(const TempDirectory& directory, const std::wstring& archiveFile)
+	{
+		AssetArchiveWriter writer;
+		std::error_code error;
+		for(std::filesystem::recursive_directory_iterator it(directory.GetPath(), error), end; !error && it != end;
+			it.increment(error))
+		{
+			std::vector<uint8_t> data;
+			if(!it->is_regular_file(error))
+				continue;
+			if(ReadBinaryFile(it->path().wstring().c_str(), data) != BinaryFileResult::Ok)
+				return false;
+			writer.Add(std::filesystem::relative(it->path(), directory.GetPath()).wstring(), std::move(data));
+		}
+
+		ThreadPool pool;
+		return writer.Write(archiveFile.c_str(), &pool) == AssetArchiveResult::Ok;
+	}
+}
+
+BENCHMARK(ArchiveReads)
+{
+	const int passes = 4;
+
+	// The loose files are named relative to root.
+	TempDirectory directory("ArchiveReadBench");
+	std::filesystem::path root;
+	std::wstring archiveFile;
+	if(!args.empty())
+	{
+		archiveFile = std::filesystem::path(args[0]).wstring();
+	}
+	else
+	{
+		archiveFile = directory.GetFile("Assets.pak");
+		root = directory.GetPath();
+		if(!WriteAssets(directory) || !PackAssets(directory, archiveFile))
+		{
+			std::printf("Can't write the assets to the temporary directory.\n");
+			return 1;
+		}
+	}
+
+	ThreadPool pool;
+
+	// Opening the archive is part of what startup pays for, so every pass reopens it.
+	std::vector<std::wstring> looseFiles;
+	uint64_t bytes = 0;
+	auto readArchive = [&]()
+	{
+		AssetArchive archive;
+		if(archive.Open(archiveFile.c_str()) != AssetArchiveResult::Ok)
+			return false;
+
+		std::vector<uint32_t> entries;
+		looseFiles.clear();
+		for(uint32_t i = 0; i < archive.GetEntryCount(); ++i)
+		{
+			entries.push_back(i);
+			looseFiles.push_back((root / std::filesystem::u8path(archive.GetEntry(i).Name)).wstring());
+		}
+
+		std::vector<std::vector<uint8_t>> data;
+		if(archive.ReadEntries(entries, data, &pool) != AssetArchiveResult::Ok)
+			return false;
+
+		bytes = 0;
+		for(const auto& d : data)
+			bytes += d.size();
+		return true;
+	};
+
+	auto readLoose = [&]()
+	{
+		for(const auto& file : looseFiles)
+		{
+			std::vector<uint8_t> data;
+			if(ReadBinaryFile(file.c_str(), data) != BinaryFileResult::Ok)
+				return false;
+		}
+		return true;
+	};
+
+	// The first pass, then the best of the others.
+	double archiveMs[2] = { 1e30, 1e30 };
+	double looseMs[2] = { 1e30, 1e30 };
+	bool archiveOk = true;
+	bool looseOk = true;
+	for(int pass = 0; pass < passes && archiveOk && looseOk; ++pass)
+	{
+		int slot = pass == 0 ? 0 : 1;
+
+		Clock::time_point start = Clock::now();
+		archiveOk = readArchive();
+		archiveMs[slot] = std::min(archiveMs[slot], MillisecondsSince(start));
+
+		start = Clock::now();
+		looseOk = readLoose();
+		looseMs[slot] = std::min(looseMs[slot], MillisecondsSince(start));
+	}
+
+	if(!archiveOk)
+	{
+		std::printf("The archive can't be read.\n");
+		return 1;
+	}
+	if(!looseOk)
+	{
+		std::printf("The loose files can't all be read.\n");
+		return 1;
+	}
+
+	std::printf("%zu files, %llu KB, archive decompressed on %u threads\n", looseFiles.size(),
+		(unsigned long long)(bytes / 1024), pool.GetThreadCount());
+	std::printf("%12s %12s %12s\n", "", "archive ms", "loose ms");
+	std::printf("%12s %12.2f %12.2f\n", "first pass", archiveMs[0], looseMs[0]);
+	std::printf("%12s %12.2f %12.2f\n", "warm", archiveMs[1], looseMs[1]);
+	return 0;
+}
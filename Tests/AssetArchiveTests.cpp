@@ -0,0 +1,245 @@
+//***************************************************************************************
+// AssetArchiveTests.cpp
+//
+// Packs files shaped like the demo's assets into an archive in a temporary directory and
+// reads them back: lookups by any spelling of the path, stored and compressed entries,
+// alignment, parallel reads, and archives that are damaged or aren't archives at all.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "AssetArchive.h"
+#include "BinaryFile.h"
+#include "DDSTestFiles.h"
+#include "TempDirectory.h"
+#include "ThreadPool.h"
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Compressible RGBA8 textures, shader source, and noise standing in for block
+	// compressed textures, which LZ4 can't shrink.
+	std::map<std::wstring, std::vector<uint8_t>> MakeAssets()
+	{
+		std::map<std::wstring, std::vector<uint8_t>> assets;
+		assets[L"Textures\\bricks.dds"] = MakeRGBA8DDSFile(64, 64, 7, 1,
+			[](uint32_t x, uint32_t y, uint32_t, uint32_t, uint8_t* rgba)
+			{
+				rgba[0] = (uint8_t)((x / 8 + y / 8) % 2 ? 200 : 90);
+				rgba[1] = 60;
+				rgba[2] = 40;
+				rgba[3] = 255;
+			});
+		assets[L"Textures\\WireFence.dds"] = MakeRGBA8DDSFile(32, 32, 1, 1,
+			[](uint32_t x, uint32_t y, uint32_t, uint32_t, uint8_t* rgba)
+			{
+				rgba[0] = rgba[1] = rgba[2] = 128;
+				rgba[3] = (x + y) % 4 == 0 ? 255 : 0;
+			});
+
+		std::string shader;
+		for(int i = 0; i < 200; ++i)
+			shader += "float4 PS(VertexOut pin) : SV_Target { return gDiffuseMap.Sample(gsamLinearWrap, pin.TexC); }\n";
+		assets[L"Shaders\\color.hlsl"] = std::vector<uint8_t>(shader.begin(), shader.end());
+
+		std::mt19937 rng(46);
+		std::vector<uint8_t> noise(50000);
+		for(auto& b : noise)
+			b = (uint8_t)rng();
+		assets[L"Textures\\treeArray2.dds"] = noise;
+
+		assets[L"ShaderCache\\empty.cso"] = {};
+		return assets;
+	}
+
+	AssetArchiveResult Pack(const std::wstring& fileName, const std::map<std::wstring, std::vector<uint8_t>>& assets,
+		ThreadPool* pool, uint32_t alignment = 4096)
+	{
+		AssetArchiveWriter writer(alignment);
+		for(const auto& asset : assets)
+			writer.Add(asset.first, asset.second);
+		return writer.Write(fileName.c_str(), pool);
+	}
+}
+
+TEST(AssetArchive, NormalizesNames)
+{
+	CHECK(AssetArchive::NormalizeName(L"Textures\\Bricks.dds") == "textures/bricks.dds");
+	CHECK(AssetArchive::NormalizeName(L"./textures//bricks.DDS") == "textures/bricks.dds");
+	CHECK(AssetArchive::NormalizeName(L"Shaders/./color.hlsl") == "shaders/color.hlsl");
+	CHECK(AssetArchive::NormalizeName(L"Textures\\Été.dds") == "textures/\xc3\x89t\xc3\xa9.dds");
+}
+
+TEST(AssetArchive, ReadsBackWhatWasPacked)
+{
+	TempDirectory directory("AssetArchiveTests");
+	std::wstring fileName = directory.GetFile("Assets.pak");
+	std::map<std::wstring, std::vector<uint8_t>> assets = MakeAssets();
+
+	ThreadPool pool(2);
+	AssetArchiveWriter writer;
+	for(const auto& asset : assets)
+		writer.Add(asset.first, asset.second);
+	CHECK(writer.Write(fileName.c_str(), &pool) == AssetArchiveResult::Ok);
+
+	const AssetArchiveStats& stats = writer.GetStats();
+	CHECK(stats.EntryCount == 5);
+	CHECK(stats.CompressedCount == 3);
+	CHECK(stats.StoredSize < stats.Size);
+
+	AssetArchive archive;
+	CHECK(archive.Open(fileName.c_str()) == AssetArchiveResult::Ok);
+	CHECK(archive.GetEntryCount() == 5);
+	CHECK(archive.Verify(&pool) == AssetArchiveResult::Ok);
+
+	for(const auto& asset : assets)
+	{
+		int32_t entry = archive.Find(asset.first);
+		CHECK(entry >= 0);
+		if(entry < 0)
+			continue;
+
+		std::vector<uint8_t> data;
+		CHECK(archive.Read((uint32_t)entry, data) == AssetArchiveResult::Ok);
+		CHECK(data == asset.second);
+		CHECK(archive.GetEntry((uint32_t)entry).Offset % 4096 == 0);
+	}
+
+	// Any spelling of the path finds the entry; other paths don't.
+	CHECK(archive.Find(L"textures/bricks.dds") == archive.Find(L"Textures\\bricks.dds"));
+	CHECK(archive.Find(L"./SHADERS/color.hlsl") >= 0);
+	CHECK(archive.Find(L"Textures\\bricks") == -1);
+	CHECK(archive.Find(L"Textures\\bricks.dds.tmp") == -1);
+
+	// The names come back sorted.
+	for(uint32_t i = 1; i < archive.GetEntryCount(); ++i)
+		CHECK(archive.GetEntry(i - 1).Name < archive.GetEntry(i).Name);
+}
+
+TEST(AssetArchive, StoredEntriesAreUsableFromTheMapping)
+{
+	TempDirectory directory("AssetArchiveTests");
+	std::wstring fileName = directory.GetFile("Assets.pak");
+	std::map<std::wstring, std::vector<uint8_t>> assets = MakeAssets();
+	CHECK(Pack(fileName, assets, nullptr) == AssetArchiveResult::Ok);
+
+	AssetArchive archive;
+	CHECK(archive.Open(fileName.c_str()) == AssetArchiveResult::Ok);
+
+	// Noise doesn't compress, so it stays as is, page aligned in the mapping.
+	uint32_t noise = (uint32_t)archive.Find(L"Textures\\treeArray2.dds");
+	const AssetEntry& stored = archive.GetEntry(noise);
+	CHECK(stored.Compression == AssetCompression::None);
+	CHECK(stored.StoredSize == stored.Size);
+	const uint8_t* data = archive.GetStoredData(noise);
+	CHECK(data != nullptr && ((uintptr_t)data % 4096) == 0);
+	CHECK(std::vector<uint8_t>(data, data + stored.Size) == assets[L"Textures\\treeArray2.dds"]);
+
+	uint32_t shader = (uint32_t)archive.Find(L"Shaders\\color.hlsl");
+	CHECK(archive.GetEntry(shader).Compression == AssetCompression::LZ4);
+	CHECK(archive.GetEntry(shader).StoredSize < archive.GetEntry(shader).Size / 4);
+	CHECK(archive.GetStoredData(shader) == nullptr);
+
+	// A smaller alignment packs tighter.
+	std::wstring tight = directory.GetFile("Tight.pak");
+	CHECK(Pack(tight, assets, nullptr, 16) == AssetArchiveResult::Ok);
+	AssetArchive tightArchive;
+	CHECK(tightArchive.Open(tight.c_str()) == AssetArchiveResult::Ok);
+	for(uint32_t i = 0; i < tightArchive.GetEntryCount(); ++i)
+		CHECK(tightArchive.GetEntry(i).Offset % 16 == 0);
+	CHECK(tightArchive.Verify(nullptr) == AssetArchiveResult::Ok);
+}
+
+TEST(AssetArchive, ParallelReadsMatchSerialOnes)
+{
+	TempDirectory directory("AssetArchiveTests");
+	std::wstring fileName = directory.GetFile("Assets.pak");
+	CHECK(Pack(fileName, MakeAssets(), nullptr) == AssetArchiveResult::Ok);
+
+	AssetArchive archive;
+	CHECK(archive.Open(fileName.c_str()) == AssetArchiveResult::Ok);
+
+	std::vector<uint32_t> entries = { 4, 0, 3, 1, 2, 0 };
+	std::vector<std::vector<uint8_t>> serial;
+	std::vector<std::vector<uint8_t>> pooled;
+	ThreadPool pool(3);
+	CHECK(archive.ReadEntries(entries, serial, nullptr) == AssetArchiveResult::Ok);
+	CHECK(archive.ReadEntries(entries, pooled, &pool) == AssetArchiveResult::Ok);
+	CHECK(serial.size() == entries.size());
+	CHECK(serial == pooled);
+	CHECK(pooled[1] == pooled[5]);
+}
+
+TEST(AssetArchive, AddingANameAgainReplacesIt)
+{
+	TempDirectory directory("AssetArchiveTests");
+	std::wstring fileName = directory.GetFile("Assets.pak");
+
+	AssetArchiveWriter writer;
+	writer.Add(L"Shaders\\color.hlsl", { 1, 2, 3 });
+	writer.Add(L"shaders/COLOR.hlsl", { 4, 5 });
+	CHECK(writer.Write(fileName.c_str(), nullptr) == AssetArchiveResult::Ok);
+	CHECK(writer.GetStats().EntryCount == 1);
+
+	AssetArchive archive;
+	CHECK(archive.Open(fileName.c_str()) == AssetArchiveResult::Ok);
+	std::vector<uint8_t> data;
+	CHECK(archive.Read(0, data) == AssetArchiveResult::Ok);
+	CHECK(data == std::vector<uint8_t>({ 4, 5 }));
+
+	// Writing over an open archive's file isn't allowed to disturb the reader on Windows,
+	// so the writer goes through a temporary that it renames; none is left behind.
+	std::vector<uint8_t> leftover;
+	CHECK(ReadBinaryFile((fileName + L".tmp").c_str(), leftover) == BinaryFileResult::NotFound);
+}
+
+TEST(AssetArchive, RefusesDamagedArchives)
+{
+	TempDirectory directory("AssetArchiveTests");
+	std::wstring fileName = directory.GetFile("Assets.pak");
+	CHECK(Pack(fileName, MakeAssets(), nullptr) == AssetArchiveResult::Ok);
+
+	std::vector<uint8_t> good;
+	CHECK(ReadBinaryFile(fileName.c_str(), good) == BinaryFileResult::Ok);
+
+	AssetArchive archive;
+	CHECK(archive.Open(directory.GetFile("Missing.pak").c_str()) == AssetArchiveResult::OpenFailed);
+	CHECK(!archive.IsOpen());
+
+	// Not an archive, and an archive cut off inside its table of contents.
+	CHECK(directory.WriteFile("Shader.pak", std::vector<uint8_t>(100, 'x')));
+	CHECK(archive.Open(directory.GetFile("Shader.pak").c_str()) == AssetArchiveResult::BadFormat);
+	CHECK(directory.WriteFile("Cut.pak", std::vector<uint8_t>(good.begin(), good.end() - 60)));
+	CHECK(archive.Open(directory.GetFile("Cut.pak").c_str()) == AssetArchiveResult::BadFormat);
+
+	// A table of contents whose second entry (the shader) runs past the end of the file.
+	std::vector<uint8_t> bad = good;
+	uint64_t tocOffset = 0;
+	std::memcpy(&tocOffset, bad.data() + 16, sizeof(tocOffset));
+	uint64_t nearEnd = bad.size() - 8;
+	std::memcpy(bad.data() + tocOffset + 48, &nearEnd, sizeof(nearEnd));
+	CHECK(directory.WriteFile("Toc.pak", bad));
+	CHECK(archive.Open(directory.GetFile("Toc.pak").c_str()) == AssetArchiveResult::BadFormat);
+
+	// A damaged entry opens, since entries are only read on demand, but doesn't verify.
+	CHECK(archive.Open(fileName.c_str()) == AssetArchiveResult::Ok);
+	uint32_t shader = (uint32_t)archive.Find(L"Shaders\\color.hlsl");
+	uint32_t noise = (uint32_t)archive.Find(L"Textures\\treeArray2.dds");
+	uint64_t shaderOffset = archive.GetEntry(shader).Offset;
+	uint64_t noiseOffset = archive.GetEntry(noise).Offset;
+	archive.Close();
+
+	for(uint64_t offset : { shaderOffset + 40, noiseOffset + 1000 })
+	{
+		std::vector<uint8_t> damaged = good;
+		damaged[(size_t)offset] ^= 0x5a;
+		CHECK(directory.WriteFile("Damaged.pak", damaged));
+		CHECK(archive.Open(directory.GetFile("Damaged.pak").c_str()) == AssetArchiveResult::Ok);
+		CHECK(archive.Verify(nullptr) == AssetArchiveResult::Corrupt);
+		archive.Close();
+	}
+}
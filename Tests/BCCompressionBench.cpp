@@ -0,0 +1,81 @@
+//***************************************************************************************
+// BCCompressionBench.cpp
+//
+// CommonBench BCCompression [size]
+// Compresses a size x size image (512 by default) of gradients and noise to every format
+// at every quality, on the calling thread and on a ThreadPool, and prints the
+// megapixels per second and the PSNR of each.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "BCnEncoder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+BENCHMARK(BCCompression)
+{
+	uint32_t size = args.empty() ? 512 : (uint32_t)std::max(std::atoi(args[0].c_str()), 4);
+
+	std::mt19937 rng(35);
+	std::vector<uint8_t> pixels(size * size * 4);
+	for(uint32_t y = 0; y < size; ++y)
+	{
+		for(uint32_t x = 0; x < size; ++x)
+		{
+			uint8_t* p = &pixels[(y * size + x) * 4];
+			p[0] = (uint8_t)(255 * x / size);
+			p[1] = (uint8_t)(255 * y / size);
+			p[2] = (uint8_t)(rng() & 0xff);
+			p[3] = (uint8_t)(255 - (x + y) * 127 / size);
+		}
+	}
+
+	BCImage image;
+	image.Pixels = pixels.data();
+	image.Width = size;
+	image.Height = size;
+	image.RowPitch = size * 4;
+
+	ThreadPool pool;
+	std::printf("%ux%u, %u worker threads\n", size, size, pool.GetThreadCount());
+	std::printf("%8s %8s %12s %12s %10s\n", "format", "quality", "serial MP/s", "pool MP/s", "PSNR");
+
+	const char* formatNames[] = { "BC1", "BC3", "BC7" };
+	const char* qualityNames[] = { "fast", "normal", "high" };
+	double megapixels = size * (double)size / 1.0e6;
+	int failures = 0;
+	for(int f = 0; f < 3; ++f)
+	{
+		for(int q = 0; q < 3; ++q)
+		{
+			typedef std::chrono::steady_clock Clock;
+			BCFormat format = (BCFormat)f;
+			BCQuality quality = (BCQuality)q;
+
+			std::vector<uint8_t> serial(GetBCImageBytes(format, size, size));
+			Clock::time_point start = Clock::now();
+			CompressBCImage(format, quality, image, serial.data(), nullptr);
+			double serialSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			std::vector<uint8_t> pooled(serial.size());
+			start = Clock::now();
+			CompressBCImage(format, quality, image, pooled.data(), &pool);
+			double poolSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			if(pooled != serial)
+				failures++;
+
+			BCErrorStats error;
+			AccumulateBCError(format, image, serial.data(), error);
+			std::printf("%8s %8s %12.2f %12.2f %10.2f\n", formatNames[f], qualityNames[q],
+				megapixels / serialSeconds, megapixels / poolSeconds, error.GetPsnr());
+		}
+	}
+	return failures;
+}
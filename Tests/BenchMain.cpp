@@ -0,0 +1,30 @@
+//***************************************************************************************
+// BenchMain.cpp
+//
+// CommonBench NAME [args ...]
+// Benchmarks time the code in Common on synthetic data, or on files given as arguments,
+// and print their results.  The exit code is the number of failures.
+//***************************************************************************************
+
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char* argv[])
+{
+	if(argc >= 2)
+	{
+		for(const BenchmarkCase& benchmark : GetBenchmarks())
+		{
+			if(std::strcmp(argv[1], benchmark.Name) == 0)
+				return benchmark.Run(std::vector<std::string>(argv + 2, argv + argc));
+		}
+		std::printf("No benchmark named %s.\n", argv[1]);
+	}
+
+	std::printf("Usage: CommonBench NAME [args ...]\nBenchmarks:\n");
+	for(const BenchmarkCase& benchmark : GetBenchmarks())
+		std::printf("  %s\n", benchmark.Name);
+	return 1;
+}
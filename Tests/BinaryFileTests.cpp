@@ -0,0 +1,212 @@
+//***************************************************************************************
+// BinaryFileTests.cpp
+//
+// Reads files written to a temporary directory through ReadBinaryFile, BinaryData and
+// AsyncBinaryReader, including the missing and empty files d3dUtil::LoadBinary used to
+// turn into garbage sizes.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "BinaryFile.h"
+#include "TempDirectory.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	std::vector<uint8_t> MakeContents(size_t size, uint32_t seed)
+	{
+		std::vector<uint8_t> data(size);
+		uint32_t state = seed * 2654435761u + 1;
+		for(auto& b : data)
+		{
+			state = state * 1664525u + 1013904223u;
+			b = (uint8_t)(state >> 24);
+		}
+		return data;
+	}
+
+	bool Matches(const BinaryData& data, const std::vector<uint8_t>& expected)
+	{
+		return data.GetSize() == expected.size() &&
+			(expected.empty() || std::equal(expected.begin(), expected.end(), data.GetData()));
+	}
+}
+
+TEST(BinaryFile, ReadsWholeFiles)
+{
+	TempDirectory directory("BinaryFileTests");
+	std::vector<uint8_t> contents = MakeContents(300000, 1);
+	CHECK(directory.WriteFile("shader.cso", contents));
+
+	std::vector<uint8_t> data;
+	CHECK(ReadBinaryFile(directory.GetFile("shader.cso").c_str(), data) == BinaryFileResult::Ok);
+	CHECK(data == contents);
+
+	BinaryFile file;
+	CHECK(file.Open(directory.GetFile("shader.cso").c_str()) == BinaryFileResult::Ok);
+	CHECK(file.GetSize() == contents.size());
+
+	// Reading again starts over at the beginning.
+	std::vector<uint8_t> twice(contents.size());
+	CHECK(file.Read(twice.data()) == BinaryFileResult::Ok);
+	CHECK(file.Read(twice.data()) == BinaryFileResult::Ok);
+	CHECK(twice == contents);
+
+	file.Close();
+	CHECK(file.GetSize() == 0);
+	CHECK(file.Read(twice.data()) == BinaryFileResult::ReadFailed);
+}
+
+TEST(BinaryFile, ErrorsAllocateNothing)
+{
+	TempDirectory directory("BinaryFileTests");
+
+	// Left over from an earlier read, and cleared rather than kept or resized.
+	std::vector<uint8_t> data(64, 0xcd);
+	CHECK(ReadBinaryFile(directory.GetFile("missing.cso").c_str(), data) == BinaryFileResult::NotFound);
+	CHECK(data.empty());
+
+	CHECK(ReadBinaryFile(directory.GetFile("missing/shader.cso").c_str(), data) == BinaryFileResult::NotFound);
+
+	BinaryFile file;
+	CHECK(file.Open(directory.GetFile("missing.cso").c_str()) == BinaryFileResult::NotFound);
+	CHECK(file.GetSize() == 0);
+
+	BinaryData mapped;
+	CHECK(mapped.Load(directory.GetFile("missing.cso").c_str()) == BinaryFileResult::NotFound);
+	CHECK(mapped.GetSize() == 0);
+
+	// An empty file is fine, and isn't mapped even when asked to be.
+	CHECK(directory.WriteFile("empty.cso", {}));
+	CHECK(ReadBinaryFile(directory.GetFile("empty.cso").c_str(), data) == BinaryFileResult::Ok);
+	CHECK(data.empty());
+	CHECK(mapped.Load(directory.GetFile("empty.cso").c_str(), 0) == BinaryFileResult::Ok);
+	CHECK(mapped.GetSize() == 0);
+	CHECK(!mapped.IsMapped());
+
+	CHECK(std::string(GetBinaryFileResultName(BinaryFileResult::NotFound)) == "not found");
+}
+
+TEST(BinaryFile, MapsFilesFromTheThreshold)
+{
+	TempDirectory directory("BinaryFileTests");
+	std::vector<uint8_t> contents = MakeContents(100000, 2);
+	CHECK(directory.WriteFile("mesh.bin", contents));
+	std::wstring fileName = directory.GetFile("mesh.bin");
+
+	BinaryData data;
+	CHECK(data.Load(fileName.c_str(), contents.size() + 1) == BinaryFileResult::Ok);
+	CHECK(!data.IsMapped());
+	CHECK(Matches(data, contents));
+
+	CHECK(data.Load(fileName.c_str(), contents.size()) == BinaryFileResult::Ok);
+	CHECK(data.IsMapped());
+	CHECK(Matches(data, contents));
+
+	// The default threshold is well above this file.
+	CHECK(data.Load(fileName.c_str()) == BinaryFileResult::Ok);
+	CHECK(!data.IsMapped());
+
+	data.Close();
+	CHECK(data.GetSize() == 0);
+	CHECK(!data.IsMapped());
+}
+
+TEST(BinaryFile, AsyncReadsCompleteOnThePool)
+{
+	TempDirectory directory("BinaryFileTests");
+	std::vector<std::vector<uint8_t>> contents;
+	for(uint32_t i = 0; i < 12; ++i)
+	{
+		contents.push_back(MakeContents(1000 + i * 20000, i));
+		CHECK(directory.WriteFile("file" + std::to_string(i), contents.back()));
+	}
+
+	ThreadPool pool(3);
+	AsyncBinaryReader reader(pool, 100000);
+
+	std::mutex mutex;
+	std::vector<int> seen(contents.size() + 1, 0);
+	int mapped = 0;
+	std::atomic<int> onCaller(0);
+	std::thread::id caller = std::this_thread::get_id();
+
+	for(uint32_t i = 0; i <= contents.size(); ++i)
+	{
+		// The last one doesn't exist.
+		reader.Read(directory.GetFile("file" + std::to_string(i)),
+			[&, i](BinaryFileResult result, std::shared_ptr<BinaryData> data)
+		{
+			if(std::this_thread::get_id() == caller)
+				onCaller++;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if(i == contents.size())
+				seen[i] = result == BinaryFileResult::NotFound && data == nullptr ? 1 : -1;
+			else
+				seen[i] = result == BinaryFileResult::Ok && Matches(*data, contents[i]) ? 1 : -1;
+			if(data != nullptr && data->IsMapped())
+				mapped++;
+		});
+	}
+	reader.Wait();
+
+	CHECK(reader.GetPendingCount() == 0);
+	CHECK(onCaller == 0);
+	for(int s : seen)
+		CHECK(s == 1);
+
+	// Files of 101000 bytes and up.
+	CHECK(mapped == 7);
+}
+
+TEST(BinaryFile, WaitCoversChainedReadsAndRethrows)
+{
+	TempDirectory directory("BinaryFileTests");
+	CHECK(directory.WriteFile("first", MakeContents(10, 3)));
+	CHECK(directory.WriteFile("second", MakeContents(20, 4)));
+
+	ThreadPool pool(2);
+	AsyncBinaryReader reader(pool);
+
+	// A completion that starts the next read, the way a mesh names its material file.
+	std::atomic<uint64_t> secondSize(0);
+	reader.Read(directory.GetFile("first"), [&](BinaryFileResult, std::shared_ptr<BinaryData>)
+	{
+		reader.Read(directory.GetFile("second"), [&](BinaryFileResult, std::shared_ptr<BinaryData> data)
+		{
+			if(data != nullptr)
+				secondSize = data->GetSize();
+		});
+	});
+	reader.Wait();
+	CHECK(secondSize == 20);
+
+	reader.Read(directory.GetFile("first"), [](BinaryFileResult, std::shared_ptr<BinaryData>)
+	{
+		throw std::runtime_error("bad mesh");
+	});
+
+	bool threw = false;
+	try
+	{
+		reader.Wait();
+	}
+	catch(const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	// The error is reported once.
+	reader.Wait();
+	CHECK(reader.GetPendingCount() == 0);
+}
@@ -0,0 +1,309 @@
+//***************************************************************************************
+// BindingFilterTests.cpp
+//
+// Feeds BindingFilter the calls a draw loop makes and checks, against a backend that
+// logs what reaches it, which calls get through and how partial ones are narrowed.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "BindingFilter.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Logs every call as a line like "RootConstants 3 +2 7 8": the parameter or first
+	// slot, then the offset if there is one, then the values.
+	class RecordingBindingBackend : public BindingBackend
+	{
+	public:
+		void SetRootSignature(const void* rootSignature)override
+		{
+			Log("RootSignature " + Name(rootSignature));
+		}
+
+		void SetPipelineState(const void* pipelineState)override
+		{
+			Log("PipelineState " + Name(pipelineState));
+		}
+
+		void SetDescriptorHeaps(uint32_t count, const void* const* heaps)override
+		{
+			std::string line = "DescriptorHeaps";
+			for(uint32_t i = 0; i < count; ++i)
+				line += " " + Name(heaps[i]);
+			Log(line);
+		}
+
+		void SetRootDescriptorTable(uint32_t parameter, uint64_t baseDescriptor)override
+		{
+			Log("RootDescriptorTable " + std::to_string(parameter) + " " + std::to_string(baseDescriptor));
+		}
+
+		void SetRootView(BindingCall call, uint32_t parameter, uint64_t address)override
+		{
+			Log(std::string(GetBindingCallName(call)) + " " + std::to_string(parameter) + " " + std::to_string(address));
+		}
+
+		void SetRootConstants(uint32_t parameter, uint32_t count, const uint32_t* values, uint32_t offset)override
+		{
+			std::string line = "RootConstants " + std::to_string(parameter) + " +" + std::to_string(offset);
+			for(uint32_t i = 0; i < count; ++i)
+				line += " " + std::to_string(values[i]);
+			Log(line);
+		}
+
+		void SetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferBinding* views)override
+		{
+			std::string line = "VertexBuffers " + std::to_string(startSlot);
+			for(uint32_t i = 0; i < count; ++i)
+				line += " " + std::to_string(views[i].Location);
+			Log(line);
+		}
+
+		void SetIndexBuffer(const IndexBufferBinding* view)override
+		{
+			Log(view != nullptr ? "IndexBuffer " + std::to_string(view->Location) : "IndexBuffer null");
+		}
+
+		void SetPrimitiveTopology(uint32_t topology)override
+		{
+			Log("PrimitiveTopology " + std::to_string(topology));
+		}
+
+		// Returns the calls since the last Take and forgets them.
+		std::vector<std::string> Take()
+		{
+			std::vector<std::string> calls;
+			calls.swap(Calls);
+			return calls;
+		}
+
+		// Names the few objects the tests bind by address.
+		const void* Objects[4] = { &Objects[0], &Objects[1], &Objects[2], &Objects[3] };
+
+	private:
+		void Log(const std::string& line)
+		{
+			Calls.push_back(line);
+		}
+
+		std::string Name(const void* object)const
+		{
+			for(int i = 0; i < 4; ++i)
+			{
+				if(Objects[i] == object)
+					return std::to_string(i);
+			}
+			return "?";
+		}
+
+		std::vector<std::string> Calls;
+	};
+
+	VertexBufferBinding MakeVertexBuffer(uint64_t location)
+	{
+		VertexBufferBinding view;
+		view.Location = location;
+		view.Size = 1024;
+		view.Stride = 32;
+		return view;
+	}
+
+	IndexBufferBinding MakeIndexBuffer(uint64_t location)
+	{
+		IndexBufferBinding view;
+		view.Location = location;
+		view.Size = 256;
+		view.Format = 42;
+		return view;
+	}
+
+	typedef std::vector<std::string> Calls;
+}
+
+TEST(BindingFilter, DropsWhatIsAlreadyBound)
+{
+	RecordingBindingBackend backend;
+	BindingFilter filter(backend);
+
+	// The demo's draw loop: every item sets its geometry and object constants, and most
+	// share the geometry with the one before.
+	VertexBufferBinding vb = MakeVertexBuffer(1000);
+	IndexBufferBinding ib = MakeIndexBuffer(2000);
+	for(uint64_t item = 0; item < 3; ++item)
+	{
+		filter.SetVertexBuffers(0, 1, &vb);
+		filter.SetIndexBuffer(&ib);
+		filter.SetPrimitiveTopology(4);
+		filter.SetRootView(BindingCall::RootConstantBufferView, 1, 5000);
+		filter.SetRootDescriptorTable(0, 100 + item);
+	}
+	CHECK(backend.Take() == Calls({ "VertexBuffers 0 1000", "IndexBuffer 2000", "PrimitiveTopology 4",
+		"RootConstantBufferView 1 5000", "RootDescriptorTable 0 100", "RootDescriptorTable 0 101",
+		"RootDescriptorTable 0 102" }));
+
+	const BindingStats& stats = filter.GetStats();
+	CHECK(stats.Issued[(int)BindingCall::VertexBuffers] == 1 && stats.Elided[(int)BindingCall::VertexBuffers] == 2);
+	CHECK(stats.Issued[(int)BindingCall::IndexBuffer] == 1 && stats.Elided[(int)BindingCall::IndexBuffer] == 2);
+	CHECK(stats.Issued[(int)BindingCall::PrimitiveTopology] == 1);
+	CHECK(stats.Elided[(int)BindingCall::RootConstantBufferView] == 2);
+	CHECK(stats.Issued[(int)BindingCall::RootDescriptorTable] == 3);
+	CHECK(stats.GetIssuedCount() == 7 && stats.GetElidedCount() == 8);
+
+	// Anything that differs goes through: a new buffer, an unbind, the same address as
+	// another kind of view.
+	IndexBufferBinding other = MakeIndexBuffer(3000);
+	filter.SetIndexBuffer(&other);
+	filter.SetIndexBuffer(nullptr);
+	filter.SetIndexBuffer(nullptr);
+	filter.SetRootView(BindingCall::RootShaderResourceView, 1, 5000);
+	filter.SetPrimitiveTopology(5);
+	CHECK(backend.Take() == Calls({ "IndexBuffer 3000", "IndexBuffer null", "RootShaderResourceView 1 5000",
+		"PrimitiveTopology 5" }));
+
+	filter.ResetStats();
+	CHECK(filter.GetStats().GetIssuedCount() == 0 && filter.GetStats().GetElidedCount() == 0);
+}
+
+TEST(BindingFilter, NarrowsPartialCalls)
+{
+	RecordingBindingBackend backend;
+	BindingFilter filter(backend);
+
+	const uint32_t constants[] = { 1, 2, 3, 4, 5, 6 };
+	filter.SetRootConstants(2, 6, constants, 0);
+
+	// Only the span from the first change to the last, with what's between.
+	const uint32_t changed[] = { 1, 9, 3, 9, 5, 6 };
+	filter.SetRootConstants(2, 6, changed, 0);
+	filter.SetRootConstants(2, 6, changed, 0);
+
+	// At an offset, over some known and some never set.
+	const uint32_t tail[] = { 5, 6, 7 };
+	filter.SetRootConstants(2, 3, tail, 4);
+	filter.SetRootConstants(2, 2, tail, 4);
+	CHECK(backend.Take() == Calls({ "RootConstants 2 +0 1 2 3 4 5 6", "RootConstants 2 +1 9 3 9",
+		"RootConstants 2 +6 7" }));
+
+	VertexBufferBinding views[] = { MakeVertexBuffer(10), MakeVertexBuffer(20), MakeVertexBuffer(30) };
+	filter.SetVertexBuffers(0, 3, views);
+	views[2] = MakeVertexBuffer(31);
+	filter.SetVertexBuffers(0, 3, views);
+	filter.SetVertexBuffers(1, 2, views + 1);
+
+	// A stride change counts as a change.
+	views[0].Stride = 16;
+	filter.SetVertexBuffers(0, 3, views);
+	CHECK(backend.Take() == Calls({ "VertexBuffers 0 10 20 30", "VertexBuffers 2 31", "VertexBuffers 0 10" }));
+	CHECK(filter.GetStats().Elided[(int)BindingCall::VertexBuffers] == 1);
+}
+
+TEST(BindingFilter, RootSignatureChangeForgetsRootArguments)
+{
+	RecordingBindingBackend backend;
+	BindingFilter filter(backend);
+	const uint32_t constants[] = { 7, 8 };
+
+	auto bindArguments = [&filter, &constants]()
+	{
+		filter.SetRootDescriptorTable(0, 100);
+		filter.SetRootView(BindingCall::RootConstantBufferView, 1, 5000);
+		filter.SetRootConstants(2, 2, constants, 0);
+	};
+
+	filter.SetRootSignature(backend.Objects[0]);
+	bindArguments();
+	backend.Take();
+
+	// The same signature again keeps them.
+	filter.SetRootSignature(backend.Objects[0]);
+	bindArguments();
+	CHECK(backend.Take().empty());
+
+	// Another one doesn't: the command list drops them.
+	filter.SetRootSignature(backend.Objects[1]);
+	bindArguments();
+	CHECK(backend.Take() == Calls({ "RootSignature 1", "RootDescriptorTable 0 100", "RootConstantBufferView 1 5000",
+		"RootConstants 2 +0 7 8" }));
+
+	// Pipelines, heaps and geometry are not root arguments.
+	VertexBufferBinding vb = MakeVertexBuffer(1000);
+	filter.SetPipelineState(backend.Objects[2]);
+	filter.SetVertexBuffers(0, 1, &vb);
+	filter.SetPrimitiveTopology(4);
+	backend.Take();
+	filter.SetRootSignature(backend.Objects[0]);
+	filter.SetPipelineState(backend.Objects[2]);
+	filter.SetVertexBuffers(0, 1, &vb);
+	filter.SetPrimitiveTopology(4);
+	CHECK(backend.Take() == Calls({ "RootSignature 0" }));
+}
+
+TEST(BindingFilter, HeapChangeForgetsTables)
+{
+	RecordingBindingBackend backend;
+	BindingFilter filter(backend);
+	const void* heaps[] = { backend.Objects[0], backend.Objects[1] };
+
+	filter.SetDescriptorHeaps(2, heaps);
+	filter.SetRootDescriptorTable(0, 100);
+	filter.SetRootView(BindingCall::RootConstantBufferView, 1, 5000);
+	backend.Take();
+
+	filter.SetDescriptorHeaps(2, heaps);
+	filter.SetRootDescriptorTable(0, 100);
+	CHECK(backend.Take().empty());
+
+	// The same offset in another heap is another descriptor; root views don't point
+	// into heaps, so they stay.
+	const void* otherHeaps[] = { backend.Objects[2], backend.Objects[1] };
+	filter.SetDescriptorHeaps(2, otherHeaps);
+	filter.SetRootDescriptorTable(0, 100);
+	filter.SetRootView(BindingCall::RootConstantBufferView, 1, 5000);
+	CHECK(backend.Take() == Calls({ "DescriptorHeaps 2 1", "RootDescriptorTable 0 100" }));
+
+	// Fewer heaps is a change too.
+	filter.SetDescriptorHeaps(1, otherHeaps);
+	CHECK(backend.Take() == Calls({ "DescriptorHeaps 2" }));
+}
+
+TEST(BindingFilter, InvalidatePassesTheNextCallOfEachKind)
+{
+	RecordingBindingBackend backend;
+	BindingFilter filter(backend);
+	const void* heaps[] = { backend.Objects[3] };
+	const uint32_t constants[] = { 7 };
+	VertexBufferBinding vb = MakeVertexBuffer(1000);
+	IndexBufferBinding ib = MakeIndexBuffer(2000);
+
+	auto bindAll = [&]()
+	{
+		filter.SetRootSignature(backend.Objects[0]);
+		filter.SetPipelineState(backend.Objects[1]);
+		filter.SetDescriptorHeaps(1, heaps);
+		filter.SetRootDescriptorTable(0, 100);
+		filter.SetRootView(BindingCall::RootUnorderedAccessView, 1, 5000);
+		filter.SetRootConstants(2, 1, constants, 0);
+		filter.SetVertexBuffers(3, 1, &vb);
+		filter.SetIndexBuffer(&ib);
+		filter.SetPrimitiveTopology(4);
+	};
+
+	Calls all = { "RootSignature 0", "PipelineState 1", "DescriptorHeaps 3", "RootDescriptorTable 0 100",
+		"RootUnorderedAccessView 1 5000", "RootConstants 2 +0 7", "VertexBuffers 3 1000", "IndexBuffer 2000",
+		"PrimitiveTopology 4" };
+
+	bindAll();
+	CHECK(backend.Take() == all);
+	bindAll();
+	CHECK(backend.Take().empty());
+
+	// As after resetting the command list.
+	filter.Invalidate();
+	bindAll();
+	CHECK(backend.Take() == all);
+	CHECK(filter.GetStats().GetIssuedCount() == 18);
+	CHECK(filter.GetStats().GetElidedCount() == 9);
+}
@@ -0,0 +1,51 @@
+//***************************************************************************************
+// BindlessTableTests.cpp
+//
+// Checks the draw index root constant against the way color.hlsl and TreeSprite.hlsl
+// unpack it.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "BindlessTable.h"
+
+#include <random>
+
+TEST(BindlessTable, RoundTripsEveryIndexInRange)
+{
+	std::mt19937 rng(38);
+	for(int i = 0; i < 10000; ++i)
+	{
+		uint32_t objectIndex = rng() % BindlessMaxObjects;
+		uint32_t materialIndex = rng() % BindlessMaxMaterials;
+		if(i < 4)
+		{
+			// The corners.
+			objectIndex = i & 1 ? BindlessMaxObjects - 1 : 0;
+			materialIndex = i & 2 ? BindlessMaxMaterials - 1 : 0;
+		}
+
+		uint32_t drawIndex = 0;
+		CHECK(PackDrawIndex(objectIndex, materialIndex, drawIndex));
+
+		uint32_t object = 0;
+		uint32_t material = 0;
+		UnpackDrawIndex(drawIndex, object, material);
+		CHECK(object == objectIndex && material == materialIndex);
+
+		// What the shaders do with gDrawIndex.
+		CHECK((drawIndex >> 12) == objectIndex);
+		CHECK((drawIndex & 0xFFF) == materialIndex);
+	}
+}
+
+TEST(BindlessTable, RejectsIndicesThatDontFit)
+{
+	uint32_t drawIndex = 1234;
+	CHECK(!PackDrawIndex(BindlessMaxObjects, 0, drawIndex));
+	CHECK(!PackDrawIndex(0, BindlessMaxMaterials, drawIndex));
+	CHECK(!PackDrawIndex(0xffffffff, 0xffffffff, drawIndex));
+	CHECK(drawIndex == 1234);
+
+	CHECK(BindlessMaxMaterials == 4096);
+	CHECK((uint64_t)BindlessMaxObjects * BindlessMaxMaterials == (1ull << 32));
+}
@@ -0,0 +1,10 @@
+//***************************************************************************************
+// D3DGlobals.cpp
+//
+// Globals that d3dUtil.h declares and the app defines, for the tests and benchmarks
+// linked with CommonD3D.
+//***************************************************************************************
+
+#include "d3dUtil.h"
+
+int gNumFrameResources = 3;
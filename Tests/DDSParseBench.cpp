@@ -0,0 +1,73 @@
+//***************************************************************************************
+// DDSParseBench.cpp
+//
+// CommonBench DDSParsing [directory [iterations]]
+// Validates the headers and lays out the subresources of every .dds file in directory
+// (Textures by default), from memory, over and over, and prints files per second.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "BinaryFile.h"
+#include "DDSParser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+using namespace DirectX;
+
+BENCHMARK(DDSParsing)
+{
+	std::filesystem::path directory = args.empty() ? "Textures" : args[0];
+	int iterations = args.size() < 2 ? 20000 : std::max(std::atoi(args[1].c_str()), 1);
+
+	std::vector<std::vector<uint8_t>> files;
+	std::error_code error;
+	for(const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		std::vector<uint8_t> data;
+		if(entry.path().extension() == ".dds" && ReadBinaryFile(entry.path().wstring().c_str(), data) == BinaryFileResult::Ok)
+			files.push_back(std::move(data));
+	}
+	if(files.empty())
+	{
+		std::printf("No .dds files in %s.\n", directory.string().c_str());
+		return 1;
+	}
+
+	// The layout array is sized once for the largest file, as a loader would keep it.
+	std::vector<DDSSubresourceLayout> layouts;
+	int failures = 0;
+	for(const auto& file : files)
+	{
+		DDSTextureDesc desc;
+		if(ParseDDSTexture(file.data(), file.size(), desc) != DDS_RESULT_OK)
+			failures++;
+		layouts.resize(std::max(layouts.size(), (size_t)desc.mipCount * desc.arraySize));
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	size_t subresources = 0;
+	for(int i = 0; i < iterations; ++i)
+	{
+		for(const auto& file : files)
+		{
+			DDSTextureDesc desc;
+			DDSLayoutInfo info;
+			if(ParseDDSTexture(file.data(), file.size(), desc) == DDS_RESULT_OK &&
+				GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info) == DDS_RESULT_OK)
+			{
+				subresources += info.subresourceCount;
+			}
+		}
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	double parsed = (double)files.size() * iterations;
+	std::printf("%zu files x %d: %.0f files/s, %.0f ns/file, %zu subresources laid out, %d files rejected\n",
+		files.size(), iterations, parsed / seconds, seconds * 1.0e9 / parsed, subresources, failures);
+	return failures;
+}
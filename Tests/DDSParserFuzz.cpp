@@ -0,0 +1,58 @@
+//***************************************************************************************
+// DDSParserFuzz.cpp
+//***************************************************************************************
+
+#include "DDSParserFuzz.h"
+#include "DDSParser.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	bool CheckLayout(const uint8_t* data, size_t size, const DDSTextureDesc& desc, size_t maxsize)
+	{
+		std::vector<DDSSubresourceLayout> layouts((size_t)desc.mipCount * desc.arraySize);
+		DDSLayoutInfo info;
+		if(GetDDSSubresourceLayout(desc, maxsize, layouts.data(), layouts.size(), info) != DDS_RESULT_OK)
+			return true;
+
+		if(info.subresourceCount == 0 || info.subresourceCount > layouts.size() ||
+			info.mipCount + info.skipMip != desc.mipCount)
+		{
+			return false;
+		}
+
+		// Reading the first and last byte of each surface lets a sanitizer catch reads the
+		// checks above miss.
+		volatile uint8_t sink = 0;
+		for(size_t i = 0; i < info.subresourceCount; ++i)
+		{
+			const DDSSubresourceLayout& layout = layouts[i];
+			if(layout.offset < desc.dataOffset || layout.offset > size || layout.slicePitch > size - layout.offset)
+				return false;
+
+			if(layout.slicePitch > 0)
+				sink = sink + data[layout.offset] + data[layout.offset + layout.slicePitch - 1];
+		}
+		return true;
+	}
+}
+
+bool FuzzDDSParser(const uint8_t* data, size_t size)
+{
+	DDSTextureDesc desc;
+	if(ParseDDSTexture(data, size, desc) != DDS_RESULT_OK)
+		return true;
+
+	if(desc.width == 0 || desc.height == 0 || desc.depth == 0 || desc.arraySize == 0 ||
+		desc.mipCount == 0 || desc.mipCount > DDS_REQ_MIP_LEVELS)
+	{
+		return false;
+	}
+	if(desc.dataOffset > size || desc.dataSize > size - desc.dataOffset)
+		return false;
+
+	return CheckLayout(data, size, desc, 0) && CheckLayout(data, size, desc, 64);
+}
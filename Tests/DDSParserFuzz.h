@@ -0,0 +1,17 @@
+//***************************************************************************************
+// DDSParserFuzz.h
+//
+// The body of the DDS parser fuzzer, shared by the libFuzzer entry point
+// (DDSParserFuzzer.cpp, built with SHAPES_BUILD_FUZZERS) and the DDSParser tests, which
+// run it over mutated headers on every build.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Parses data and lays out its subresources with and without a mip size limit, touching
+// every subresource the parser hands back.  Returns false if a result breaks what the
+// loaders rely on: that an accepted file's surfaces lie inside data.
+bool FuzzDDSParser(const uint8_t* data, size_t size);
@@ -0,0 +1,19 @@
+//***************************************************************************************
+// DDSParserFuzzer.cpp
+//
+// libFuzzer entry point for the DDS parser.  Built with SHAPES_BUILD_FUZZERS=ON and
+// clang; seed it with the files in Textures:
+//
+//   DDSParserFuzzer -max_len=65536 corpus ../Textures
+//***************************************************************************************
+
+#include "DDSParserFuzz.h"
+
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if(!FuzzDDSParser(data, size))
+		std::abort();
+	return 0;
+}
@@ -0,0 +1,202 @@
+//***************************************************************************************
+// DDSParserTests.cpp
+//
+// Round trips headers through WriteDDSHeaders and ParseDDSTexture, checks the errors
+// for broken files, and runs the fuzzer body over a few thousand mutated headers.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSParser.h"
+#include "DDSParserFuzz.h"
+#include "DDSTestFiles.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A DXT1 file with the old header only, the way most tools still write them.
+	std::vector<uint8_t> MakeLegacyDXT1(uint32_t width, uint32_t height, uint32_t mipCount)
+	{
+		DDSTextureDesc desc = MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC1_UNORM, width, height, 1, mipCount, 1, false);
+
+		DDS_HEADER header = {};
+		header.size = sizeof(DDS_HEADER);
+		header.flags = 0x00021007;
+		header.width = width;
+		header.height = height;
+		header.mipMapCount = mipCount;
+		header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+		header.ddspf.flags = DDS_FOURCC;
+		header.ddspf.fourCC = MAKEFOURCC('D', 'X', 'T', '1');
+		header.caps = 0x00401008;
+
+		std::vector<uint8_t> file(sizeof(uint32_t) + sizeof(DDS_HEADER) + GetDDSSurfaceBytes(desc));
+		std::memcpy(file.data(), &DDS_MAGIC, sizeof(uint32_t));
+		std::memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+		return file;
+	}
+
+	std::vector<std::vector<uint8_t>> MakeSeeds()
+	{
+		return
+		{
+			MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 7, 1, false)),
+			MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC7_UNORM_SRGB, 32, 16, 1, 6, 4, false)),
+			MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC1_UNORM, 16, 16, 1, 5, 6, true)),
+			MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE3D, DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 8, 4, 1, false)),
+			MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE1D, DXGI_FORMAT_R16G16B16A16_FLOAT, 128, 1, 1, 8, 2, false)),
+			MakeLegacyDXT1(64, 32, 7)
+		};
+	}
+}
+
+TEST(DDSParser, WrittenHeadersParseBack)
+{
+	for(const DDSTextureDesc& written : {
+		MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 7, 1, false),
+		MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC3_UNORM, 40, 24, 1, 3, 3, false),
+		MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC1_UNORM, 16, 16, 1, 5, 6, true),
+		MakeDDSDesc(DDS_DIMENSION_TEXTURE3D, DXGI_FORMAT_R8G8B8A8_UNORM, 8, 4, 8, 4, 1, false) })
+	{
+		std::vector<uint8_t> file = MakeDDSFile(written);
+
+		DDSTextureDesc desc;
+		CHECK(ParseDDSTexture(file.data(), file.size(), desc) == DDS_RESULT_OK);
+		CHECK(desc.dimension == written.dimension);
+		CHECK(desc.format == written.format);
+		CHECK(desc.width == written.width && desc.height == written.height && desc.depth == written.depth);
+		CHECK(desc.mipCount == written.mipCount);
+		CHECK(desc.arraySize == written.arraySize);
+		CHECK(desc.isCubeMap == written.isCubeMap);
+		CHECK(desc.dataOffset == DDS_DX10_HEADERS_SIZE);
+		CHECK(desc.dataSize == GetDDSSurfaceBytes(written));
+
+		// The surfaces follow each other with no gaps.
+		std::vector<DDSSubresourceLayout> layouts(desc.mipCount * desc.arraySize);
+		DDSLayoutInfo info;
+		CHECK(GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info) == DDS_RESULT_OK);
+		CHECK(info.subresourceCount == layouts.size());
+		CHECK(layouts[0].offset == DDS_DX10_HEADERS_SIZE);
+		for(size_t i = 1; i < layouts.size(); ++i)
+		{
+			uint32_t mip = (uint32_t)((i - 1) % desc.mipCount);
+			size_t previousDepth = std::max(desc.depth >> mip, 1u);
+			CHECK(layouts[i].offset == layouts[i - 1].offset + layouts[i - 1].slicePitch * previousDepth);
+		}
+	}
+}
+
+TEST(DDSParser, ReadsLegacyHeaders)
+{
+	std::vector<uint8_t> file = MakeLegacyDXT1(64, 32, 7);
+
+	DDSTextureDesc desc;
+	CHECK(ParseDDSTexture(file.data(), file.size(), desc) == DDS_RESULT_OK);
+	CHECK(desc.format == DXGI_FORMAT_BC1_UNORM);
+	CHECK(desc.dimension == DDS_DIMENSION_TEXTURE2D);
+	CHECK(desc.mipCount == 7);
+	CHECK(desc.dataOffset == sizeof(uint32_t) + sizeof(DDS_HEADER));
+}
+
+TEST(DDSParser, RejectsBrokenFiles)
+{
+	std::vector<uint8_t> file = MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 7, 1, false));
+	DDSTextureDesc desc;
+
+	CHECK(ParseDDSTexture(nullptr, file.size(), desc) == DDS_RESULT_INVALID_ARG);
+	CHECK(ParseDDSTexture(file.data(), 16, desc) == DDS_RESULT_TOO_SMALL);
+
+	std::vector<uint8_t> badMagic = file;
+	badMagic[0] = 'X';
+	CHECK(ParseDDSTexture(badMagic.data(), badMagic.size(), desc) == DDS_RESULT_BAD_MAGIC);
+
+	std::vector<uint8_t> badSize = file;
+	badSize[4] = 0;
+	CHECK(ParseDDSTexture(badSize.data(), badSize.size(), desc) == DDS_RESULT_BAD_HEADER);
+
+	// Cut off in the last mip: the headers parse, but the layout doesn't fit.
+	DDS_RESULT result = ParseDDSTexture(file.data(), file.size() - 1, desc);
+	if(result == DDS_RESULT_OK)
+	{
+		std::vector<DDSSubresourceLayout> layouts(desc.mipCount * desc.arraySize);
+		DDSLayoutInfo info;
+		result = GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info);
+	}
+	CHECK(result == DDS_RESULT_TRUNCATED);
+
+	// Too little room for the layouts.
+	CHECK(ParseDDSTexture(file.data(), file.size(), desc) == DDS_RESULT_OK);
+	DDSSubresourceLayout layout;
+	DDSLayoutInfo info;
+	CHECK(GetDDSSubresourceLayout(desc, 0, &layout, 1, info) == DDS_RESULT_BUFFER_TOO_SMALL);
+}
+
+TEST(DDSParser, MaxSizeSkipsTheLargeMips)
+{
+	std::vector<uint8_t> file = MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8B8A8_UNORM, 256, 256, 1, 9, 2, false));
+
+	DDSTextureDesc desc;
+	CHECK(ParseDDSTexture(file.data(), file.size(), desc) == DDS_RESULT_OK);
+
+	std::vector<DDSSubresourceLayout> layouts(desc.mipCount * desc.arraySize);
+	DDSLayoutInfo info;
+	CHECK(GetDDSSubresourceLayout(desc, 64, layouts.data(), layouts.size(), info) == DDS_RESULT_OK);
+	CHECK(info.skipMip == 2);
+	CHECK(info.mipCount == 7);
+	CHECK(info.width == 64 && info.height == 64);
+	CHECK(info.subresourceCount == 14);
+	CHECK(layouts[0].slicePitch == 64 * 64 * 4);
+}
+
+TEST(DDSParser, SurvivesMutatedHeaders)
+{
+	// The values that tend to break size arithmetic.
+	const uint32_t edges[] = { 0, 1, 2, 3, 6, 15, 16, 2048, 16384, 16385, 0x7fffffff, 0x80000000, 0xffffffff };
+
+	std::mt19937 rng(33);
+	int failures = 0;
+	for(const std::vector<uint8_t>& seed : MakeSeeds())
+	{
+		CHECK(FuzzDDSParser(seed.data(), seed.size()));
+
+		for(int i = 0; i < 3000; ++i)
+		{
+			std::vector<uint8_t> file = seed;
+			size_t headerBytes = std::min(file.size(), DDS_DX10_HEADERS_SIZE);
+
+			int mutations = 1 + (int)(rng() % 4);
+			for(int m = 0; m < mutations; ++m)
+			{
+				switch(rng() % 3)
+				{
+				case 0:
+					file[rng() % headerBytes] ^= (uint8_t)(1u << (rng() % 8));
+					break;
+				case 1:
+				{
+					uint32_t value = edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+					std::memcpy(&file[(rng() % (headerBytes / 4)) * 4], &value, sizeof(value));
+					break;
+				}
+				default:
+					file.resize(rng() % (file.size() + 1));
+					headerBytes = std::min(file.size(), headerBytes);
+					break;
+				}
+				if(headerBytes < 4)
+					break;
+			}
+
+			// An exact-size copy, so a sanitizer sees any read past the end.
+			std::vector<uint8_t> exact(file.begin(), file.end());
+			if(!FuzzDDSParser(exact.empty() ? nullptr : exact.data(), exact.size()))
+				failures++;
+		}
+	}
+	CHECK(failures == 0);
+}
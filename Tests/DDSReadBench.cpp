@@ -0,0 +1,198 @@
+//***************************************************************************************
+// DDSReadBench.cpp
+//
+// CommonBench DDSReads [file or directory ...]
+// Loads DDS files (those in Textures by default) the two ways TextureLoader can: read
+// into a heap buffer with ifstream, or memory mapped and parsed in place.  Like
+// TextureLoader, every file stays loaded until all are, then each is copied out as
+// the upload would be and released.  Prints the best time of a few passes and the most
+// memory each way had resident above what the process started the pass with.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSParser.h"
+#include "MappedFile.h"
+#include "ProcessMemory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+using namespace DirectX;
+
+namespace
+{
+	// One loaded file: the bytes either live in Buffer or in Mapping.
+	struct LoadedFile
+	{
+		std::vector<uint8_t> Buffer;
+		MappedFile Mapping;
+		const uint8_t* Data = nullptr;
+		size_t Size = 0;
+	};
+
+	bool ReadWithStream(const std::wstring& fileName, LoadedFile& file)
+	{
+		std::ifstream in(std::filesystem::path(fileName), std::ios::binary);
+		in.seekg(0, std::ios_base::end);
+		std::streamoff size = in ? (std::streamoff)in.tellg() : -1;
+		if(size < 0)
+			return false;
+		in.seekg(0, std::ios_base::beg);
+
+		file.Buffer.resize((size_t)size);
+		in.read(reinterpret_cast<char*>(file.Buffer.data()), size);
+		file.Data = file.Buffer.data();
+		file.Size = file.Buffer.size();
+		return !in.fail();
+	}
+
+	bool Map(const std::wstring& fileName, LoadedFile& file)
+	{
+		if(!file.Mapping.Open(fileName.c_str()))
+			return false;
+		file.Data = file.Mapping.GetData();
+		file.Size = (size_t)file.Mapping.GetSize();
+		return true;
+	}
+
+	// Copies the file's subresources into upload, as recording the upload would, and
+	// returns the bytes copied; 0 if it isn't a DDS file the parser takes.
+	uint64_t Upload(const LoadedFile& file, std::vector<uint8_t>& upload)
+	{
+		DDSTextureDesc desc;
+		if(ParseDDSTexture(file.Data, file.Size, desc) != DDS_RESULT_OK)
+			return 0;
+
+		std::vector<DDSSubresourceLayout> layouts((size_t)desc.mipCount * desc.arraySize);
+		DDSLayoutInfo info;
+		if(GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info) != DDS_RESULT_OK)
+			return 0;
+
+		upload.resize(std::max(upload.size(), desc.dataSize));
+		uint64_t copied = 0;
+		for(size_t i = 0; i < info.subresourceCount; ++i)
+		{
+			size_t size = std::min(layouts[i].slicePitch, desc.dataSize - (size_t)copied);
+			std::memcpy(upload.data() + copied, file.Data + layouts[i].offset, size);
+			copied += size;
+		}
+		return copied;
+	}
+
+	struct ReadRun
+	{
+		bool Ok = true;
+		uint64_t FileBytes = 0;
+		uint64_t UploadBytes = 0;
+		double Ms = 0.0;
+		uint64_t PeakResidentBytes = 0;
+	};
+
+	ReadRun LoadAll(const std::vector<std::wstring>& fileNames, bool mapped)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		ReadRun run;
+		uint64_t baseline = GetResidentBytes();
+		auto sample = [&run, baseline]()
+		{
+			uint64_t resident = GetResidentBytes();
+			if(resident > baseline)
+				run.PeakResidentBytes = std::max(run.PeakResidentBytes, resident - baseline);
+		};
+
+		Clock::time_point start = Clock::now();
+
+		std::vector<std::unique_ptr<LoadedFile>> files;
+		for(const auto& fileName : fileNames)
+		{
+			auto file = std::make_unique<LoadedFile>();
+			run.Ok = run.Ok && (mapped ? Map(fileName, *file) : ReadWithStream(fileName, *file));
+			run.FileBytes += file->Size;
+			files.push_back(std::move(file));
+		}
+
+		std::vector<uint8_t> upload;
+		for(auto& file : files)
+		{
+			uint64_t copied = Upload(*file, upload);
+			run.Ok = run.Ok && copied > 0;
+			run.UploadBytes += copied;
+
+			// The file is resident now, and released right after.
+			sample();
+			file.reset();
+		}
+
+		run.Ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		return run;
+	}
+}
+
+BENCHMARK(DDSReads)
+{
+	std::vector<std::wstring> fileNames;
+	std::vector<std::string> paths = args.empty() ? std::vector<std::string>{ "Textures" } : args;
+	for(const auto& path : paths)
+	{
+		std::error_code error;
+		if(!std::filesystem::is_directory(path, error))
+		{
+			fileNames.push_back(std::filesystem::path(path).wstring());
+			continue;
+		}
+
+		for(const auto& entry : std::filesystem::directory_iterator(path, error))
+		{
+			if(entry.path().extension() == ".dds")
+				fileNames.push_back(entry.path().wstring());
+		}
+	}
+	if(fileNames.empty())
+	{
+		std::printf("No DDS files to read.\n");
+		return 1;
+	}
+
+	const int passes = 3;
+	int failures = 0;
+	std::printf("%zu files\n", fileNames.size());
+	std::printf("%10s %10s %12s %12s %16s\n", "method", "MB", "best ms", "MB/s", "peak MB resident");
+	for(bool mapped : { false, true })
+	{
+		ReadRun best;
+		best.Ms = 1e30;
+		uint64_t peak = 0;
+		for(int pass = 0; pass < passes; ++pass)
+		{
+			ReadRun run = LoadAll(fileNames, mapped);
+			if(!run.Ok)
+			{
+				best = run;
+				break;
+			}
+			if(run.Ms < best.Ms)
+				best = run;
+			peak = std::max(peak, run.PeakResidentBytes);
+		}
+
+		if(!best.Ok)
+		{
+			std::printf("%10s failed to load every file\n", mapped ? "mapped" : "ifstream");
+			failures++;
+			continue;
+		}
+
+		double megabytes = best.FileBytes / (1024.0 * 1024.0);
+		std::printf("%10s %10.1f %12.2f %12.1f %16.1f\n", mapped ? "mapped" : "ifstream", megabytes, best.Ms,
+			megabytes / (best.Ms / 1000.0), peak / (1024.0 * 1024.0));
+	}
+
+	std::printf("Process peak resident: %.1f MB\n", GetPeakResidentBytes() / (1024.0 * 1024.0));
+	return failures;
+}
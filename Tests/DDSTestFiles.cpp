@@ -0,0 +1,83 @@
+//***************************************************************************************
+// DDSTestFiles.cpp
+//***************************************************************************************
+
+#include "DDSTestFiles.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+using namespace DirectX;
+
+DDSTextureDesc MakeDDSDesc(DDS_DIMENSION dimension, DXGI_FORMAT format, uint32_t width, uint32_t height,
+	uint32_t depth, uint32_t mipCount, uint32_t arraySize, bool isCubeMap)
+{
+	DDSTextureDesc desc = {};
+	desc.dimension = dimension;
+	desc.format = format;
+	desc.width = width;
+	desc.height = height;
+	desc.depth = depth;
+	desc.mipCount = mipCount;
+	desc.arraySize = arraySize;
+	desc.isCubeMap = isCubeMap;
+	return desc;
+}
+
+size_t GetDDSSurfaceBytes(const DDSTextureDesc& desc)
+{
+	size_t total = 0;
+	for(uint32_t slice = 0; slice < desc.arraySize; ++slice)
+	{
+		for(uint32_t mip = 0; mip < desc.mipCount; ++mip)
+		{
+			size_t bytes = 0;
+			size_t rowBytes = 0;
+			GetSurfaceInfo(std::max(desc.width >> mip, 1u), std::max(desc.height >> mip, 1u), desc.format,
+				&bytes, &rowBytes, nullptr);
+			total += bytes * std::max(desc.depth >> mip, 1u);
+		}
+	}
+	return total;
+}
+
+std::vector<uint8_t> MakeDDSFile(const DDSTextureDesc& desc)
+{
+	std::vector<uint8_t> file(DDS_DX10_HEADERS_SIZE + GetDDSSurfaceBytes(desc));
+	WriteDDSHeaders(desc, file.data());
+	for(size_t i = DDS_DX10_HEADERS_SIZE; i < file.size(); ++i)
+		file[i] = (uint8_t)(i * 7);
+	return file;
+}
+
+std::vector<uint8_t> MakeLegacyDDSFile(const DDS_PIXELFORMAT& ddpf, uint32_t width, uint32_t height,
+	uint32_t depth, uint32_t mipCount, bool cubeMap, uint32_t seed)
+{
+	DDS_HEADER header = {};
+	header.size = sizeof(DDS_HEADER);
+	header.flags = 0x00021007 | (depth > 1 ? DDS_HEADER_FLAGS_VOLUME : 0);
+	header.width = width;
+	header.height = height;
+	header.depth = depth;
+	header.mipMapCount = mipCount;
+	header.ddspf = ddpf;
+	header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+	header.caps = 0x00401008;
+	header.caps2 = cubeMap ? DDS_CUBEMAP_ALLFACES : 0;
+
+	size_t texels = 0;
+	for(uint32_t mip = 0; mip < mipCount; ++mip)
+		texels += (size_t)std::max(width >> mip, 1u) * std::max(height >> mip, 1u) * std::max(depth >> mip, 1u);
+	texels *= cubeMap ? 6 : 1;
+
+	const size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+	std::vector<uint8_t> file(headerSize + texels * ddpf.RGBBitCount / 8);
+	std::memcpy(file.data(), &DDS_MAGIC, sizeof(uint32_t));
+	std::memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+
+	std::mt19937 rng(seed);
+	for(size_t i = headerSize; i < file.size(); ++i)
+		file[i] = (uint8_t)rng();
+	return file;
+}
@@ -0,0 +1,52 @@
+//***************************************************************************************
+// DDSTestFiles.h
+//
+// Builds DDS files in memory for the tests of the code that reads them.
+//***************************************************************************************
+
+#pragma once
+
+#include "DDSParser.h"
+
+#include <vector>
+
+DirectX::DDSTextureDesc MakeDDSDesc(DirectX::DDS_DIMENSION dimension, DXGI_FORMAT format, uint32_t width,
+	uint32_t height, uint32_t depth, uint32_t mipCount, uint32_t arraySize, bool isCubeMap);
+
+// The bytes of every surface, in file order.
+size_t GetDDSSurfaceBytes(const DirectX::DDSTextureDesc& desc);
+
+// A whole file for desc with DX10 headers and a recognisable pattern in the surfaces.
+std::vector<uint8_t> MakeDDSFile(const DirectX::DDSTextureDesc& desc);
+
+// A legacy file (no DX10 header) of ddpf texels with random contents.  Faces, mips and
+// rows follow each other the way the old tools wrote them.
+std::vector<uint8_t> MakeLegacyDDSFile(const DirectX::DDS_PIXELFORMAT& ddpf, uint32_t width, uint32_t height,
+	uint32_t depth, uint32_t mipCount, bool cubeMap, uint32_t seed);
+
+// A 2D RGBA8 file whose texel (x, y) of each mip and slice is pixel(x, y, mip, slice,
+// rgba); rgba receives the four channels.
+template<typename Pixel>
+std::vector<uint8_t> MakeRGBA8DDSFile(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t arraySize,
+	Pixel pixel)
+{
+	DirectX::DDSTextureDesc desc = MakeDDSDesc(DirectX::DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_R8G8B8A8_UNORM,
+		width, height, 1, mipCount, arraySize, false);
+	std::vector<uint8_t> file = MakeDDSFile(desc);
+
+	uint8_t* texel = file.data() + DirectX::DDS_DX10_HEADERS_SIZE;
+	for(uint32_t slice = 0; slice < arraySize; ++slice)
+	{
+		for(uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			uint32_t mipWidth = width >> mip > 0 ? width >> mip : 1;
+			uint32_t mipHeight = height >> mip > 0 ? height >> mip : 1;
+			for(uint32_t y = 0; y < mipHeight; ++y)
+			{
+				for(uint32_t x = 0; x < mipWidth; ++x, texel += 4)
+					pixel(x, y, mip, slice, texel);
+			}
+		}
+	}
+	return file;
+}
@@ -0,0 +1,342 @@
+//***************************************************************************************
+// DescriptorAllocatorTests.cpp
+//
+// Checks first fit, merging and fence-gated reuse of persistent slots and the transient
+// ring on small heaps by hand, then runs a few thousand random frames against a model
+// that tracks every slot.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const uint32_t Invalid = DescriptorAllocator::InvalidIndex;
+
+	// What the allocator should know about each persistent slot.
+	class PersistentModel
+	{
+	public:
+		enum SlotState { SlotFree, SlotAllocated, SlotPending };
+
+		explicit PersistentModel(uint32_t count)
+			: States(count, SlotFree), Sizes(count, 0)
+		{
+		}
+
+		// The start of the first free run of at least count slots.
+		uint32_t FirstFit(uint32_t count)const
+		{
+			uint32_t run = 0;
+			for(uint32_t i = 0; i < States.size(); ++i)
+			{
+				run = States[i] == SlotFree ? run + 1 : 0;
+				if(run == count)
+					return i + 1 - count;
+			}
+			return Invalid;
+		}
+
+		void Allocate(uint32_t index, uint32_t count)
+		{
+			std::fill(States.begin() + index, States.begin() + index + count, SlotAllocated);
+			Sizes[index] = count;
+			Live.push_back(index);
+		}
+
+		void Free(uint32_t index)
+		{
+			std::fill(States.begin() + index, States.begin() + index + Sizes[index], SlotPending);
+			Frees.push_back({ index, Sizes[index], false, 0 });
+			Sizes[index] = 0;
+			Live.erase(std::find(Live.begin(), Live.end(), index));
+		}
+
+		void EndFrame(uint64_t fenceValue)
+		{
+			for(PendingFree& p : Frees)
+			{
+				if(!p.Stamped)
+				{
+					p.Stamped = true;
+					p.FenceValue = fenceValue;
+				}
+			}
+		}
+
+		void Recycle(uint64_t completedValue)
+		{
+			for(auto i = Frees.begin(); i != Frees.end();)
+			{
+				if(i->Stamped && i->FenceValue <= completedValue)
+				{
+					std::fill(States.begin() + i->Index, States.begin() + i->Index + i->Count, SlotFree);
+					i = Frees.erase(i);
+				}
+				else
+				{
+					++i;
+				}
+			}
+		}
+
+		// Fills in the persistent fields of DescriptorAllocatorStats.
+		DescriptorAllocatorStats GetStats()const
+		{
+			DescriptorAllocatorStats stats;
+			uint32_t run = 0;
+			for(SlotState s : States)
+			{
+				stats.PersistentAllocated += s == SlotAllocated;
+				stats.PersistentPendingFree += s == SlotPending;
+				if(s == SlotFree)
+				{
+					stats.FreeCount++;
+					stats.FreeRangeCount += run == 0;
+					run++;
+					stats.LargestFreeRange = std::max(stats.LargestFreeRange, run);
+				}
+				else
+				{
+					run = 0;
+				}
+			}
+			if(stats.FreeCount > 0)
+				stats.Fragmentation = 1.0f - (float)stats.LargestFreeRange / (float)stats.FreeCount;
+			return stats;
+		}
+
+		std::vector<uint32_t> Live;
+
+	private:
+		struct PendingFree
+		{
+			uint32_t Index;
+			uint32_t Count;
+			bool Stamped;
+			uint64_t FenceValue;
+		};
+
+		std::vector<SlotState> States;
+		std::vector<uint32_t> Sizes;
+		std::vector<PendingFree> Frees;
+	};
+
+	bool SamePersistentStats(const DescriptorAllocatorStats& a, const DescriptorAllocatorStats& b)
+	{
+		return a.PersistentAllocated == b.PersistentAllocated && a.PersistentPendingFree == b.PersistentPendingFree &&
+			a.FreeCount == b.FreeCount && a.FreeRangeCount == b.FreeRangeCount &&
+			a.LargestFreeRange == b.LargestFreeRange && std::fabs(a.Fragmentation - b.Fragmentation) < 1e-6f;
+	}
+}
+
+TEST(DescriptorAllocator, FirstFitAndMerging)
+{
+	DescriptorAllocator allocator(10, 0);
+	CHECK(allocator.GetDescriptorCount() == 10);
+
+	CHECK(allocator.Allocate(3) == 0);
+	CHECK(allocator.Allocate(2) == 3);
+	CHECK(allocator.Allocate(4) == 5);
+	CHECK(allocator.Allocate(2) == Invalid);
+	CHECK(allocator.GetStats().FailedCount == 1);
+
+	// Only the index Allocate returned frees, and only once.
+	CHECK(!allocator.Free(4));
+	CHECK(!allocator.Free(10));
+	CHECK(allocator.Free(3));
+	CHECK(!allocator.Free(3));
+
+	allocator.EndFrame(1);
+	allocator.Recycle(1);
+
+	// Free: [3,5) and [9,10).  The first run that fits wins, not the tightest.
+	DescriptorAllocatorStats stats = allocator.GetStats();
+	CHECK(stats.FreeCount == 3 && stats.FreeRangeCount == 2 && stats.LargestFreeRange == 2);
+	CHECK(std::fabs(stats.Fragmentation - 1.0f / 3.0f) < 1e-6f);
+	CHECK(allocator.Allocate(1) == 3);
+	CHECK(allocator.Allocate(1) == 4);
+	CHECK(allocator.Allocate(1) == 9);
+
+	// Released in this order, 5-8 merges with the run after it, 3 with the one before
+	// and 4 with both, leaving one run.
+	for(uint32_t index : { 0u, 9u, 5u, 3u, 4u })
+		CHECK(allocator.Free(index));
+	allocator.EndFrame(2);
+	allocator.Recycle(2);
+	stats = allocator.GetStats();
+	CHECK(stats.FreeCount == 10 && stats.FreeRangeCount == 1 && stats.Fragmentation == 0.0f);
+	CHECK(stats.PersistentAllocated == 0);
+	CHECK(allocator.Allocate(10) == 0);
+}
+
+TEST(DescriptorAllocator, FreedSlotsWaitForTheirFrame)
+{
+	DescriptorAllocator allocator(4, 0);
+	uint32_t a = allocator.Allocate(2);
+	uint32_t b = allocator.Allocate(2);
+
+	// Not stamped yet: no completed value releases it.
+	allocator.Free(a);
+	allocator.Recycle(1000);
+	CHECK(allocator.GetStats().PersistentPendingFree == 2);
+	CHECK(allocator.Allocate(1) == Invalid);
+
+	allocator.EndFrame(5);
+	allocator.Free(b);
+	allocator.EndFrame(6);
+
+	allocator.Recycle(4);
+	CHECK(allocator.GetStats().PersistentPendingFree == 4);
+	allocator.Recycle(5);
+	CHECK(allocator.GetStats().PersistentPendingFree == 2);
+	CHECK(allocator.Allocate(3) == Invalid);
+	allocator.Recycle(6);
+	CHECK(allocator.Allocate(3) == 0);
+	CHECK(allocator.GetStats().FailedCount == 2);
+}
+
+TEST(DescriptorAllocator, TransientRunsNeverWrap)
+{
+	DescriptorAllocator allocator(4, 8);
+
+	// Indices follow the persistent slots.
+	CHECK(allocator.AllocateTransient(3) == 4);
+	CHECK(allocator.AllocateTransient(3) == 7);
+	allocator.EndFrame(1);
+
+	// Slots 6-7 are free but 3 don't fit there, and the start is still in use.
+	CHECK(allocator.AllocateTransient(3) == Invalid);
+	CHECK(allocator.GetStats().FailedCount == 1);
+
+	// Once frame 1 retires the run starts over at the beginning; the two skipped slots
+	// count as used until this frame retires.
+	allocator.Recycle(1);
+	CHECK(allocator.AllocateTransient(3) == 4);
+	CHECK(allocator.GetStats().TransientUsed == 5);
+	CHECK(allocator.AllocateTransient(4) == Invalid);
+	CHECK(allocator.AllocateTransient(3) == 7);
+	CHECK(allocator.AllocateTransient(1) == Invalid);
+	allocator.EndFrame(2);
+	CHECK(allocator.GetStats().TransientPeak == 8);
+
+	// Even an empty ring can't give a run longer than what's left before its end.
+	allocator.Recycle(2);
+	CHECK(allocator.GetStats().TransientUsed == 0);
+	CHECK(allocator.AllocateTransient(8) == Invalid);
+	CHECK(allocator.AllocateTransient(2) == 10);
+	allocator.EndFrame(3);
+	allocator.Recycle(3);
+	CHECK(allocator.AllocateTransient(8) == 4);
+	CHECK(allocator.GetStats().FailedCount == 4);
+}
+
+TEST(DescriptorAllocator, RandomFramesMatchTheModel)
+{
+	const uint32_t persistentCount = 256;
+	const uint32_t transientCount = 64;
+	DescriptorAllocator allocator(persistentCount, transientCount);
+	PersistentModel model(persistentCount);
+
+	struct TransientRun
+	{
+		uint32_t Slot;
+		uint32_t Count;
+		uint64_t FenceValue;
+	};
+	std::vector<TransientRun> inFlight;
+	uint32_t headSlot = 0;
+	uint32_t failed = 0;
+	uint32_t mismatches = 0;
+	float worstFragmentation = 0.0f;
+
+	std::mt19937 rng(49);
+	uint64_t fence = 0;
+	uint64_t completed = 0;
+	for(int frame = 0; frame < 3000; ++frame)
+	{
+		// Persistent: mostly small allocations, the odd large one, and frees.
+		int operations = (int)(rng() % 8);
+		for(int i = 0; i < operations; ++i)
+		{
+			if(rng() % 2 == 0 || model.Live.empty())
+			{
+				uint32_t count = rng() % 10 == 0 ? 16 + rng() % 32 : 1 + rng() % 4;
+				uint32_t expected = model.FirstFit(count);
+				uint32_t index = allocator.Allocate(count);
+				mismatches += index != expected;
+				if(index == Invalid)
+					failed++;
+				else
+					model.Allocate(index, count);
+			}
+			else
+			{
+				uint32_t index = model.Live[rng() % model.Live.size()];
+				mismatches += !allocator.Free(index);
+				model.Free(index);
+			}
+		}
+
+		// Transient: a few runs a frame, none of which may overlap a frame in flight.
+		operations = (int)(rng() % 5);
+		for(int i = 0; i < operations; ++i)
+		{
+			uint32_t count = 1 + rng() % 12;
+			uint32_t skip = headSlot + count > transientCount ? transientCount - headSlot : 0;
+			bool fits = allocator.GetStats().TransientUsed + skip + count <= transientCount;
+
+			uint32_t index = allocator.AllocateTransient(count);
+			if(index == Invalid)
+			{
+				mismatches += fits;
+				failed++;
+				continue;
+			}
+
+			uint32_t slot = index - persistentCount;
+			mismatches += !fits || slot != (skip > 0 ? 0 : headSlot) || slot + count > transientCount;
+			for(const TransientRun& run : inFlight)
+				mismatches += slot < run.Slot + run.Count && run.Slot < slot + count;
+			inFlight.push_back({ slot, count, fence + 1 });
+			headSlot = (slot + count) % transientCount;
+		}
+
+		allocator.EndFrame(++fence);
+		model.EndFrame(fence);
+
+		// The GPU runs up to three frames behind.
+		completed = std::max(completed, fence - std::min<uint64_t>(fence, rng() % 4));
+		allocator.Recycle(completed);
+		model.Recycle(completed);
+		inFlight.erase(std::remove_if(inFlight.begin(), inFlight.end(),
+			[completed](const TransientRun& run) { return run.FenceValue <= completed; }), inFlight.end());
+
+		DescriptorAllocatorStats stats = allocator.GetStats();
+		mismatches += !SamePersistentStats(stats, model.GetStats());
+		mismatches += stats.FailedCount != failed;
+		worstFragmentation = std::max(worstFragmentation, stats.Fragmentation);
+	}
+	CHECK(mismatches == 0);
+
+	// The run exercised what it was meant to.
+	CHECK(failed > 0);
+	CHECK(worstFragmentation > 0.5f);
+	CHECK(allocator.GetStats().TransientPeak > transientCount / 2);
+
+	// Everything freed and retired is one run again.
+	for(uint32_t index : std::vector<uint32_t>(model.Live))
+	{
+		allocator.Free(index);
+		model.Free(index);
+	}
+	allocator.EndFrame(++fence);
+	allocator.Recycle(fence);
+	DescriptorAllocatorStats stats = allocator.GetStats();
+	CHECK(stats.FreeRangeCount == 1 && stats.FreeCount == persistentCount && stats.TransientUsed == 0);
+}
@@ -0,0 +1,183 @@
+//***************************************************************************************
+// FileReadBench.cpp
+//
+// CommonBench FileReads [file ...]
+// Reads each file the way d3dUtil::LoadBinary used to (ifstream), with ReadBinaryFile and
+// mapped through BinaryData, then all of them at once with AsyncBinaryReader on a
+// ThreadPool.  Without files it writes a few of different sizes to a temporary directory.
+// Every method runs a few times and the best is kept, so after the first pass the files
+// come from the file cache; the numbers compare the read paths, not the disk.  Fails if a
+// file can't be read or the methods disagree about its contents.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "BinaryFile.h"
+#include "TempDirectory.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const int Passes = 3;
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// Reading every byte makes the mapped reads page the whole file in.
+	uint64_t Checksum(const uint8_t* data, uint64_t size)
+	{
+		uint64_t sum = 0;
+		for(uint64_t i = 0; i < size; ++i)
+			sum = sum*31 + data[i];
+		return sum;
+	}
+
+	double MegabytesPerSecond(uint64_t bytes, double seconds)
+	{
+		return seconds > 0.0 ? bytes / (1024.0*1024.0) / seconds : 0.0;
+	}
+}
+
+BENCHMARK(FileReads)
+{
+	std::vector<std::wstring> files;
+	for(const auto& arg : args)
+		files.push_back(std::filesystem::path(arg).wstring());
+
+	TempDirectory directory("FileReadBench");
+	if(files.empty())
+	{
+		for(uint32_t megabytes : { 1u, 16u, 64u })
+		{
+			std::string name = std::to_string(megabytes) + "MB.bin";
+			std::vector<uint8_t> data((size_t)megabytes * 1024 * 1024);
+			for(size_t i = 0; i < data.size(); ++i)
+				data[i] = (uint8_t)(i * 7 + i / 4096);
+			if(!directory.WriteFile(name, data))
+			{
+				std::printf("Can't write %s to the temporary directory.\n", name.c_str());
+				return 1;
+			}
+			files.push_back(directory.GetFile(name));
+		}
+	}
+
+	std::printf("%24s %10s %14s %14s %14s\n", "file", "MB", "ifstream MB/s", "ReadBinaryFile", "mapped MB/s");
+
+	int failures = 0;
+	uint64_t totalBytes = 0;
+	uint64_t totalSum = 0;
+	double sequentialSeconds = 0.0;
+	for(const auto& file : files)
+	{
+		std::string name = std::filesystem::path(file).filename().string();
+
+		// The way d3dUtil::LoadBinary used to read, with the size kept 64-bit.
+		double streamSeconds = 1e30;
+		uint64_t streamSum = 0;
+		for(int pass = 0; pass < Passes; ++pass)
+		{
+			Clock::time_point start = Clock::now();
+			std::ifstream fin(std::filesystem::path(file), std::ios::binary);
+			fin.seekg(0, std::ios_base::end);
+			std::streamoff size = fin ? (std::streamoff)fin.tellg() : 0;
+			fin.seekg(0, std::ios_base::beg);
+			std::vector<uint8_t> data((size_t)std::max<std::streamoff>(size, 0));
+			fin.read(reinterpret_cast<char*>(data.data()), data.size());
+			streamSum = Checksum(data.data(), data.size());
+			streamSeconds = std::min(streamSeconds, SecondsSince(start));
+		}
+
+		double readSeconds = 1e30;
+		uint64_t readSum = 0;
+		uint64_t size = 0;
+		BinaryFileResult result = BinaryFileResult::Ok;
+		for(int pass = 0; pass < Passes && result == BinaryFileResult::Ok; ++pass)
+		{
+			Clock::time_point start = Clock::now();
+			std::vector<uint8_t> data;
+			result = ReadBinaryFile(file.c_str(), data);
+			readSum = Checksum(data.data(), data.size());
+			size = data.size();
+			readSeconds = std::min(readSeconds, SecondsSince(start));
+		}
+
+		double mapSeconds = 1e30;
+		uint64_t mapSum = 0;
+		for(int pass = 0; pass < Passes && result == BinaryFileResult::Ok; ++pass)
+		{
+			Clock::time_point start = Clock::now();
+			BinaryData data;
+			result = data.Load(file.c_str(), 1);
+			mapSum = Checksum(data.GetData(), data.GetSize());
+			mapSeconds = std::min(mapSeconds, SecondsSince(start));
+		}
+
+		if(result != BinaryFileResult::Ok)
+		{
+			std::printf("%24s %s\n", name.c_str(), GetBinaryFileResultName(result));
+			failures++;
+		}
+		else if(readSum != streamSum || mapSum != readSum)
+		{
+			std::printf("%24s the reads don't agree\n", name.c_str());
+			failures++;
+		}
+		else
+		{
+			std::printf("%24s %10.1f %14.1f %14.1f %14.1f\n", name.c_str(), size / (1024.0*1024.0),
+				MegabytesPerSecond(size, streamSeconds), MegabytesPerSecond(size, readSeconds),
+				MegabytesPerSecond(size, mapSeconds));
+			totalBytes += size;
+			totalSum += readSum;
+			sequentialSeconds += readSeconds;
+		}
+	}
+
+	if(failures == 0)
+	{
+		ThreadPool pool;
+		AsyncBinaryReader reader(pool);
+
+		double asyncSeconds = 1e30;
+		for(int pass = 0; pass < Passes; ++pass)
+		{
+			std::atomic<uint64_t> sum(0);
+			Clock::time_point start = Clock::now();
+			for(const auto& file : files)
+			{
+				reader.Read(file, [&sum](BinaryFileResult, std::shared_ptr<BinaryData> data)
+				{
+					if(data != nullptr)
+						sum += Checksum(data->GetData(), data->GetSize());
+				});
+			}
+			reader.Wait();
+			asyncSeconds = std::min(asyncSeconds, SecondsSince(start));
+
+			if(sum != totalSum)
+			{
+				std::printf("AsyncBinaryReader's reads don't agree\n");
+				failures++;
+				break;
+			}
+		}
+
+		std::printf("All files: ReadBinaryFile one after another %.1f MB/s, AsyncBinaryReader on %u threads %.1f MB/s\n",
+			MegabytesPerSecond(totalBytes, sequentialSeconds), pool.GetThreadCount(),
+			MegabytesPerSecond(totalBytes, asyncSeconds));
+	}
+
+	return failures;
+}
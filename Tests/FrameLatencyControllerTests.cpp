@@ -0,0 +1,188 @@
+//***************************************************************************************
+// FrameLatencyControllerTests.cpp
+//
+// Feeds FrameLatencyController wait times, either directly or from a simulated frame
+// loop: the CPU records a frame in cpuMs, the GPU draws each in gpuMs once it is
+// submitted, and the CPU waits before recording whenever the latency in use would be
+// exceeded.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FrameLatencyController.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// gMaxNumFrameResources in d3dUtil.h; the app never lets the latency go past it.
+	const int gMaxLatency = 4;
+
+	FrameLatencySettings MakeSettings()
+	{
+		FrameLatencySettings settings;
+		settings.MinLatency = 1;
+		settings.MaxLatency = gMaxLatency;
+		return settings;
+	}
+
+	struct FrameLoopRun
+	{
+		int FinalLatency = 0;
+		int MinLatencySeen = 1000;
+		int MaxLatencySeen = 0;
+	};
+
+	// cpuMs and gpuMs give each frame's times; the loop runs as many frames as cpuMs has.
+	FrameLoopRun RunFrameLoop(FrameLatencyController& controller, const std::vector<double>& cpuMs,
+		const std::vector<double>& gpuMs)
+	{
+		FrameLoopRun run;
+		double cpuTime = 0.0;
+		double gpuFreeTime = 0.0;
+		std::vector<double> gpuDoneTime;
+
+		int latency = controller.GetLatency();
+		for(size_t frame = 0; frame < cpuMs.size(); ++frame)
+		{
+			// At most latency frames in flight, counting the one about to be recorded.
+			double waitMs = 0.0;
+			if(frame >= (size_t)latency)
+				waitMs = std::max(gpuDoneTime[frame - latency] - cpuTime, 0.0);
+			cpuTime += waitMs;
+
+			latency = controller.AddFrame(waitMs);
+			run.MinLatencySeen = std::min(run.MinLatencySeen, latency);
+			run.MaxLatencySeen = std::max(run.MaxLatencySeen, latency);
+
+			cpuTime += cpuMs[frame];
+			gpuFreeTime = std::max(gpuFreeTime, cpuTime) + gpuMs[frame];
+			gpuDoneTime.push_back(gpuFreeTime);
+		}
+
+		run.FinalLatency = latency;
+		return run;
+	}
+
+	std::vector<double> Constant(size_t frames, double ms)
+	{
+		return std::vector<double>(frames, ms);
+	}
+}
+
+TEST(FrameLatencyController, InitialLatencyIsClamped)
+{
+	FrameLatencySettings settings = MakeSettings();
+	CHECK(FrameLatencyController(0, settings).GetLatency() == 1);
+	CHECK(FrameLatencyController(9, settings).GetLatency() == gMaxLatency);
+	CHECK(FrameLatencyController(2, settings).GetLatency() == 2);
+
+	// Nonsensical settings are repaired rather than trusted.
+	settings.MinLatency = 0;
+	settings.MaxLatency = -3;
+	FrameLatencyController repaired(2, settings);
+	CHECK(repaired.GetSettings().MinLatency == 1);
+	CHECK(repaired.GetSettings().MaxLatency == 1);
+	CHECK(repaired.GetLatency() == 1);
+}
+
+TEST(FrameLatencyController, LowersAfterQuietWindows)
+{
+	FrameLatencySettings settings = MakeSettings();
+	FrameLatencyController controller(3, settings);
+
+	// One window short of the quiet windows needed keeps the latency.
+	int framesToLower = settings.WindowFrames*settings.QuietWindowsToLower;
+	for(int i = 0; i < framesToLower - 1; ++i)
+		controller.AddFrame(0.0);
+	CHECK(controller.GetLatency() == 3);
+
+	CHECK(controller.AddFrame(0.0) == 2);
+
+	for(int i = 0; i < framesToLower*4; ++i)
+		controller.AddFrame(0.0);
+	CHECK(controller.GetLatency() == 1);
+}
+
+TEST(FrameLatencyController, AnyWaitResetsTheQuietCount)
+{
+	FrameLatencySettings settings = MakeSettings();
+	FrameLatencyController controller(3, settings);
+
+	// A short wait every window: not a stall, but not quiet either.
+	for(int window = 0; window < settings.QuietWindowsToLower*3; ++window)
+	{
+		for(int i = 0; i < settings.WindowFrames; ++i)
+			controller.AddFrame(i == 0 ? settings.StallThresholdMs*0.5 : 0.0);
+	}
+	CHECK(controller.GetLatency() == 3);
+}
+
+TEST(FrameLatencyController, RaisesWhenStallsPassTheFraction)
+{
+	FrameLatencySettings settings = MakeSettings();
+	FrameLatencyController controller(1, settings);
+
+	// Exactly the fraction doesn't raise; one more stall does.
+	int stalls = (int)(settings.RaiseStallFraction*settings.WindowFrames);
+	for(int i = 0; i < settings.WindowFrames; ++i)
+		controller.AddFrame(i < stalls ? settings.StallThresholdMs*2.0 : 0.0);
+	CHECK(controller.GetLatency() == 1);
+
+	for(int i = 0; i < settings.WindowFrames; ++i)
+		controller.AddFrame(i <= stalls ? settings.StallThresholdMs*2.0 : 0.0);
+	CHECK(controller.GetLatency() == 2);
+}
+
+TEST(FrameLatencyController, DropsLatencyUnderSustainedGpuSlack)
+{
+	// A 16 ms CPU frame and a 0.5 ms GPU frame: the GPU is idle most of the time.
+	FrameLatencyController controller(3, MakeSettings());
+	FrameLoopRun run = RunFrameLoop(controller, Constant(5000, 16.0), Constant(5000, 0.5));
+
+	CHECK(run.FinalLatency == 1);
+	CHECK(run.MaxLatencySeen == 3);
+}
+
+TEST(FrameLatencyController, RaisesLatencyUnderStalls)
+{
+	// The GPU takes longer than the CPU, so the CPU keeps blocking on the fence.
+	FrameLatencyController controller(1, MakeSettings());
+	FrameLoopRun run = RunFrameLoop(controller, Constant(5000, 10.0), Constant(5000, 14.0));
+
+	CHECK(run.FinalLatency == gMaxLatency);
+	CHECK(run.MaxLatencySeen == gMaxLatency);
+}
+
+TEST(FrameLatencyController, RecoversAfterALoadSpike)
+{
+	// Slack, then a stretch where the GPU is the bottleneck, then slack again.
+	FrameLatencyController controller(3, MakeSettings());
+	CHECK(RunFrameLoop(controller, Constant(3000, 16.0), Constant(3000, 0.5)).FinalLatency == 1);
+	CHECK(RunFrameLoop(controller, Constant(3000, 16.0), Constant(3000, 20.0)).FinalLatency == gMaxLatency);
+	CHECK(RunFrameLoop(controller, Constant(3000, 16.0), Constant(3000, 0.5)).FinalLatency == 1);
+}
+
+TEST(FrameLatencyController, StaysInRangeOnRandomTimes)
+{
+	for(uint32_t seed = 1; seed <= 20; ++seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<double> cpu(2.0, 20.0);
+		std::uniform_real_distribution<double> gpu(0.0, 25.0);
+
+		std::vector<double> cpuMs(4000);
+		std::vector<double> gpuMs(4000);
+		for(size_t i = 0; i < cpuMs.size(); ++i)
+		{
+			cpuMs[i] = cpu(rng);
+			gpuMs[i] = gpu(rng);
+		}
+
+		FrameLatencyController controller((int)(seed % 6), MakeSettings());
+		FrameLoopRun run = RunFrameLoop(controller, cpuMs, gpuMs);
+		CHECK(run.MinLatencySeen >= 1);
+		CHECK(run.MaxLatencySeen <= gMaxLatency);
+	}
+}
@@ -0,0 +1,127 @@
+//***************************************************************************************
+// FramePacingPolicyTests.cpp
+//
+// Drives FramePacingPolicy with a simulated fence: the CPU cycles through its frame
+// resources, the GPU completes submitted frames at its own pace, and waiting for a fence
+// value makes the GPU reach it.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "FramePacingPolicy.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct SimulatedFence
+	{
+		uint64_t Submitted = 0;
+		uint64_t Completed = 0;
+	};
+
+	struct PacingRun
+	{
+		uint32_t WaitCount = 0;
+		bool ResourceReusedEarly = false;
+		bool LatencyExceeded = false;
+	};
+
+	// While the CPU records a frame the GPU completes between minGpuFrames and
+	// maxGpuFrames of those submitted, at random.
+	PacingRun Simulate(uint32_t frameResources, uint32_t maxFrameLatency, uint32_t minGpuFrames,
+		uint32_t maxGpuFrames, uint32_t frameCount, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<uint32_t> gpuFrames(minGpuFrames, maxGpuFrames);
+
+		SimulatedFence fence;
+		std::vector<uint64_t> frameFences(frameResources, 0);
+
+		PacingRun run;
+		for(uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			uint64_t& frameFence = frameFences[frame % frameResources];
+			uint64_t wait = FramePacingPolicy::RequiredFenceValue(frameFence, fence.Submitted,
+				fence.Completed, maxFrameLatency);
+			if(wait != 0)
+			{
+				run.WaitCount++;
+				fence.Completed = wait;
+			}
+
+			if(fence.Completed < frameFence)
+				run.ResourceReusedEarly = true;
+			if(fence.Submitted - fence.Completed >= maxFrameLatency)
+				run.LatencyExceeded = true;
+
+			frameFence = ++fence.Submitted;
+
+			uint64_t completed = fence.Completed + gpuFrames(rng);
+			fence.Completed = completed < fence.Submitted ? completed : fence.Submitted;
+		}
+		return run;
+	}
+}
+
+TEST(FramePacingPolicy, NothingSubmittedNeverWaits)
+{
+	CHECK(FramePacingPolicy::RequiredFenceValue(0, 0, 0, 1) == 0);
+	CHECK(FramePacingPolicy::RequiredFenceValue(0, 0, 0, 3) == 0);
+}
+
+TEST(FramePacingPolicy, WaitsForFrameResourceInUse)
+{
+	// The resource was last submitted at 5 and the GPU is at 4.
+	CHECK(FramePacingPolicy::RequiredFenceValue(5, 7, 4, 3) == 5);
+
+	// Done with it.
+	CHECK(FramePacingPolicy::RequiredFenceValue(5, 7, 5, 3) == 0);
+}
+
+TEST(FramePacingPolicy, LatencyTighterThanFrameResources)
+{
+	// Frame resource 1 finished long ago, but at most one frame may be in flight, so the
+	// CPU waits for the last one submitted.
+	CHECK(FramePacingPolicy::RequiredFenceValue(1, 10, 8, 1) == 10);
+
+	// With two in flight allowed, the one before it is enough.
+	CHECK(FramePacingPolicy::RequiredFenceValue(1, 10, 8, 2) == 9);
+	CHECK(FramePacingPolicy::RequiredFenceValue(1, 10, 9, 2) == 0);
+}
+
+TEST(FramePacingPolicy, ZeroLatencyOnlyGuardsTheResource)
+{
+	CHECK(FramePacingPolicy::RequiredFenceValue(3, 10, 2, 0) == 3);
+	CHECK(FramePacingPolicy::RequiredFenceValue(3, 10, 3, 0) == 0);
+}
+
+TEST(FramePacingPolicy, SimulatedFenceKeepsInvariants)
+{
+	for(uint32_t frameResources = 1; frameResources <= 4; ++frameResources)
+	{
+		for(uint32_t latency = 1; latency <= frameResources; ++latency)
+		{
+			for(uint32_t maxGpuFrames = 0; maxGpuFrames <= 3; ++maxGpuFrames)
+			{
+				PacingRun run = Simulate(frameResources, latency, 0, maxGpuFrames, 2000, frameResources*100 + latency);
+				CHECK(!run.ResourceReusedEarly);
+				CHECK(!run.LatencyExceeded);
+			}
+		}
+	}
+}
+
+TEST(FramePacingPolicy, WaitsOnlyWhenTheGpuFallsBehind)
+{
+	// A GPU that finishes each frame while the next is recorded never holds the CPU up.
+	CHECK(Simulate(3, 3, 1, 2, 1000, 1).WaitCount == 0);
+
+	// One that sometimes falls behind does, some of the time.
+	PacingRun uneven = Simulate(3, 2, 0, 2, 1000, 1);
+	CHECK(uneven.WaitCount > 0 && uneven.WaitCount < 1000);
+
+	// A GPU that never gets ahead on its own makes the CPU wait for every frame once two
+	// are queued.
+	CHECK(Simulate(3, 2, 0, 0, 1000, 1).WaitCount == 1000 - 2);
+}
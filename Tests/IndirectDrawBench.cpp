@@ -0,0 +1,144 @@
+//***************************************************************************************
+// IndirectDrawBench.cpp
+//
+// CommonBench IndirectDraws [items]
+// Builds the indirect draw arguments for a grid of boxes (100k by default) seen by a
+// camera like the demo's, on the calling thread and on the pool, and prints the best of
+// a few passes.  Fails if the two builds wrote different commands.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "IndirectDrawBuilder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	void Normalize(float v[3])
+	{
+		float length = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+		for(int i = 0; i < 3; ++i)
+			v[i] /= length;
+	}
+
+	void Cross(const float a[3], const float b[3], float out[3])
+	{
+		out[0] = a[1]*b[2] - a[2]*b[1];
+		out[1] = a[2]*b[0] - a[0]*b[2];
+		out[2] = a[0]*b[1] - a[1]*b[0];
+	}
+
+	float Dot(const float a[3], const float b[3])
+	{
+		return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+	}
+
+	// XMMatrixLookAtLH(eye, origin, +y) * XMMatrixPerspectiveFovLH(fovY, aspect, zn, zf),
+	// row-major for row vectors.
+	void MakeViewProj(const float eye[3], float fovY, float aspect, float zn, float zf, float viewProj[16])
+	{
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+		float z[3] = { -eye[0], -eye[1], -eye[2] };
+		Normalize(z);
+		float x[3];
+		Cross(up, z, x);
+		Normalize(x);
+		float y[3];
+		Cross(z, x, y);
+
+		float view[16] =
+		{
+			x[0], y[0], z[0], 0.0f,
+			x[1], y[1], z[1], 0.0f,
+			x[2], y[2], z[2], 0.0f,
+			-Dot(x, eye), -Dot(y, eye), -Dot(z, eye), 1.0f
+		};
+
+		float yScale = 1.0f / tanf(0.5f*fovY);
+		float range = zf / (zf - zn);
+		float proj[16] =
+		{
+			yScale / aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range*zn, 0.0f
+		};
+
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				float sum = 0.0f;
+				for(int k = 0; k < 4; ++k)
+					sum += view[r*4 + k] * proj[k*4 + c];
+				viewProj[r*4 + c] = sum;
+			}
+		}
+	}
+}
+
+BENCHMARK(IndirectDraws)
+{
+	const int passes = 5;
+	uint32_t itemCount = args.empty() ? 100000 : (uint32_t)std::max(std::atoi(args[0].c_str()), 1);
+
+	uint32_t side = (uint32_t)ceilf(sqrtf((float)itemCount));
+	std::vector<IndirectDrawItem> items(itemCount);
+	for(uint32_t i = 0; i < itemCount; ++i)
+	{
+		IndirectDrawItem& item = items[i];
+		item.Center[0] = 4.0f*((float)(i % side) - 0.5f*side);
+		item.Center[1] = 1.0f;
+		item.Center[2] = 4.0f*((float)(i / side) - 0.5f*side);
+		item.Extents[0] = item.Extents[1] = item.Extents[2] = 1.0f;
+		item.DrawIndex = i;
+		item.IndexCount = 36;
+		item.BaseVertexLocation = (int)(i % 8)*24;
+	}
+
+	const float eye[3] = { 0.0f, 40.0f, -90.0f };
+	float viewProj[16];
+	MakeViewProj(eye, 0.25f*3.14159265f, 16.0f/9.0f, 1.0f, 1000.0f, viewProj);
+	IndirectDrawFrustum frustum = IndirectDrawFrustum::FromViewProj(viewProj);
+
+	ThreadPool pool;
+	IndirectDrawBuilder builder;
+	std::vector<IndirectDrawCommand> serialCommands(itemCount);
+	std::vector<IndirectDrawCommand> poolCommands(itemCount);
+
+	double serialSeconds = 1e30;
+	double poolSeconds = 1e30;
+	uint32_t serialCount = 0;
+	uint32_t poolCount = 0;
+	uint32_t chunkCount = 0;
+	for(int pass = 0; pass < passes; ++pass)
+	{
+		serialCount = builder.Build(items, &frustum, nullptr, serialCommands.data());
+		serialSeconds = std::min(serialSeconds, builder.GetStats().Seconds);
+
+		poolCount = builder.Build(items, &frustum, &pool, poolCommands.data());
+		poolSeconds = std::min(poolSeconds, builder.GetStats().Seconds);
+		chunkCount = builder.GetStats().ChunkCount;
+	}
+
+	std::printf("%u items, %u drawn\n", itemCount, serialCount);
+	if(serialCount != poolCount ||
+		std::memcmp(serialCommands.data(), poolCommands.data(), sizeof(IndirectDrawCommand)*serialCount) != 0)
+	{
+		std::printf("The pool's commands differ from the calling thread's.\n");
+		return 1;
+	}
+
+	auto rate = [itemCount](double seconds) { return seconds > 0.0 ? itemCount / 1e6 / seconds : 0.0; };
+	std::printf("%16s %8s %10s %14s\n", "", "chunks", "best ms", "M items/s");
+	std::printf("%16s %8u %10.3f %14.1f\n", "calling thread", 1u, serialSeconds*1000.0, rate(serialSeconds));
+	std::printf("%13s %2u %8u %10.3f %14.1f\n", "pool of", pool.GetThreadCount(), chunkCount, poolSeconds*1000.0,
+		rate(poolSeconds));
+	return 0;
+}
@@ -0,0 +1,180 @@
+//***************************************************************************************
+// IndirectDrawBuilderTests.cpp
+//
+// Checks the commands written for visible items, culling against frusta taken from
+// simple view-projection matrices, and that splitting a large list across the pool
+// writes exactly what the calling thread does.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "IndirectDrawBuilder.h"
+#include "ThreadPool.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	IndirectDrawItem MakeItem(float x, float y, float z, float extent, uint32_t drawIndex)
+	{
+		IndirectDrawItem item;
+		item.Center[0] = x;
+		item.Center[1] = y;
+		item.Center[2] = z;
+		item.Extents[0] = item.Extents[1] = item.Extents[2] = extent;
+		item.DrawIndex = drawIndex;
+		item.VertexBuffer.Location = 0x10000 + drawIndex;
+		item.VertexBuffer.Size = 768;
+		item.VertexBuffer.Stride = 32;
+		item.IndexBuffer.Location = 0x20000 + drawIndex;
+		item.IndexBuffer.Size = 72;
+		item.IndexBuffer.Format = 57;
+		item.IndexCount = 36;
+		item.StartIndexLocation = drawIndex * 3;
+		item.BaseVertexLocation = -(int32_t)drawIndex;
+		return item;
+	}
+
+	// Clip space is world space: inside is -1 <= x, y <= 1 and 0 <= z <= 1.
+	IndirectDrawFrustum MakeUnitFrustum()
+	{
+		const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		return IndirectDrawFrustum::FromViewProj(identity);
+	}
+
+	// A camera at the origin looking down +z with a 90 degree field of view, as
+	// XMMatrixPerspectiveFovLH(pi / 2, 1, zn, zf) makes it.
+	IndirectDrawFrustum MakePerspectiveFrustum(float zn, float zf)
+	{
+		float range = zf / (zf - zn);
+		const float proj[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, range, 1, 0, 0, -range*zn, 0 };
+		return IndirectDrawFrustum::FromViewProj(proj);
+	}
+
+	std::vector<uint32_t> Drawn(IndirectDrawBuilder& builder, const std::vector<IndirectDrawItem>& items,
+		const IndirectDrawFrustum& frustum)
+	{
+		std::vector<IndirectDrawCommand> commands(items.size());
+		builder.Build(items, &frustum, nullptr, commands.data());
+		return builder.GetDrawnItems();
+	}
+}
+
+TEST(IndirectDrawBuilder, WritesOneCommandPerItem)
+{
+	std::vector<IndirectDrawItem> items;
+	for(uint32_t i = 0; i < 5; ++i)
+		items.push_back(MakeItem(1000.0f * i, 0.0f, 0.0f, 1.0f, 7 + i));
+
+	IndirectDrawBuilder builder;
+	std::vector<IndirectDrawCommand> commands(items.size());
+	CHECK(builder.Build(items, nullptr, nullptr, commands.data()) == 5);
+	CHECK(builder.GetDrawnItems() == std::vector<uint32_t>({ 0, 1, 2, 3, 4 }));
+
+	bool same = true;
+	for(uint32_t i = 0; i < 5; ++i)
+	{
+		const IndirectDrawCommand& c = commands[i];
+		const IndirectDrawItem& item = items[i];
+		same = same && c.VertexBuffer.Location == item.VertexBuffer.Location &&
+			c.VertexBuffer.Size == item.VertexBuffer.Size && c.VertexBuffer.Stride == item.VertexBuffer.Stride &&
+			c.IndexBuffer.Location == item.IndexBuffer.Location && c.IndexBuffer.Size == item.IndexBuffer.Size &&
+			c.IndexBuffer.Format == item.IndexBuffer.Format && c.DrawIndex == item.DrawIndex &&
+			c.IndexCountPerInstance == 36 && c.InstanceCount == 1 &&
+			c.StartIndexLocation == item.StartIndexLocation && c.BaseVertexLocation == item.BaseVertexLocation &&
+			c.StartInstanceLocation == 0;
+	}
+	CHECK(same);
+
+	const IndirectDrawStats& stats = builder.GetStats();
+	CHECK(stats.ItemCount == 5 && stats.DrawCount == 5 && stats.CulledCount == 0 && stats.ChunkCount == 1);
+
+	// Nothing to draw is fine too.
+	CHECK(builder.Build(std::vector<IndirectDrawItem>(), nullptr, nullptr, commands.data()) == 0);
+	CHECK(builder.GetDrawnItems().empty());
+}
+
+TEST(IndirectDrawBuilder, CullsByBounds)
+{
+	std::vector<IndirectDrawItem> items =
+	{
+		MakeItem(0.0f, 0.0f, 0.5f, 0.1f, 0),    // inside
+		MakeItem(-3.0f, 0.0f, 0.5f, 1.0f, 1),   // left
+		MakeItem(3.0f, 0.0f, 0.5f, 1.0f, 2),    // right
+		MakeItem(0.0f, -3.0f, 0.5f, 1.0f, 3),   // below
+		MakeItem(0.0f, 3.0f, 0.5f, 1.0f, 4),    // above
+		MakeItem(0.0f, 0.0f, -2.0f, 1.0f, 5),   // in front of the near plane
+		MakeItem(0.0f, 0.0f, 3.0f, 1.0f, 6),    // past the far plane
+		MakeItem(1.9f, 0.0f, 0.5f, 1.0f, 7),    // straddling the right plane
+		MakeItem(0.0f, 0.0f, -0.9f, 1.0f, 8),   // straddling the near plane
+		MakeItem(5.0f, 5.0f, 0.5f, 1000.0f, 9)  // centered outside but big enough
+	};
+
+	IndirectDrawBuilder builder;
+	CHECK(Drawn(builder, items, MakeUnitFrustum()) == std::vector<uint32_t>({ 0, 7, 8, 9 }));
+	CHECK(builder.GetStats().DrawCount == 4 && builder.GetStats().CulledCount == 6);
+}
+
+TEST(IndirectDrawBuilder, FrustumFromPerspective)
+{
+	std::vector<IndirectDrawItem> items =
+	{
+		MakeItem(0.0f, 0.0f, 10.0f, 0.5f, 0),   // straight ahead
+		MakeItem(9.0f, 0.0f, 10.0f, 0.5f, 1),   // just inside the 45 degree side
+		MakeItem(12.0f, 0.0f, 10.0f, 0.5f, 2),  // outside it
+		MakeItem(0.0f, -12.0f, 10.0f, 0.5f, 3), // below
+		MakeItem(0.0f, 0.0f, -10.0f, 0.5f, 4),  // behind the camera
+		MakeItem(0.0f, 0.0f, 0.2f, 0.1f, 5),    // closer than the near plane
+		MakeItem(0.0f, 0.0f, 150.0f, 1.0f, 6),  // past the far plane
+		MakeItem(0.0f, 0.0f, 99.5f, 1.0f, 7)    // across the far plane
+	};
+
+	IndirectDrawBuilder builder;
+	CHECK(Drawn(builder, items, MakePerspectiveFrustum(1.0f, 100.0f)) == std::vector<uint32_t>({ 0, 1, 7 }));
+
+	// The planes needn't be normalized: scaling the matrix changes nothing.
+	const float scaled[16] = { 3, 0, 0, 0, 0, 3, 0, 0, 0, 0, 3 * 100.0f / 99.0f, 3, 0, 0, -3 * 100.0f / 99.0f, 0 };
+	CHECK(Drawn(builder, items, IndirectDrawFrustum::FromViewProj(scaled)) == std::vector<uint32_t>({ 0, 1, 7 }));
+}
+
+TEST(IndirectDrawBuilder, PoolWritesWhatTheCallingThreadDoes)
+{
+	// A random field of boxes around the unit frustum, about half of them visible.
+	std::mt19937 rng(50);
+	std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+	std::vector<IndirectDrawItem> items;
+	for(uint32_t i = 0; i < 20000; ++i)
+		items.push_back(MakeItem(position(rng), position(rng), position(rng), 0.05f, i));
+	IndirectDrawFrustum frustum = MakeUnitFrustum();
+
+	ThreadPool pool(2);
+	IndirectDrawBuilder builder;
+
+	std::vector<IndirectDrawCommand> serial(items.size());
+	uint32_t serialCount = builder.Build(items, &frustum, nullptr, serial.data());
+	std::vector<uint32_t> serialDrawn = builder.GetDrawnItems();
+	CHECK(builder.GetStats().ChunkCount == 1);
+	CHECK(serialCount > 1000 && serialCount < 10000);
+
+	// Untouched past the last command.
+	IndirectDrawCommand marker = {};
+	marker.DrawIndex = 0xcdcdcdcd;
+	std::vector<IndirectDrawCommand> pooled(items.size(), marker);
+	CHECK(builder.Build(items, &frustum, &pool, pooled.data()) == serialCount);
+	CHECK(builder.GetStats().ChunkCount == 3);
+	CHECK(builder.GetDrawnItems() == serialDrawn);
+	CHECK(std::memcmp(serial.data(), pooled.data(), sizeof(IndirectDrawCommand) * serialCount) == 0);
+	CHECK(pooled[serialCount].DrawIndex == marker.DrawIndex);
+
+	// In item order.
+	bool ordered = true;
+	for(size_t i = 1; i < serialDrawn.size(); ++i)
+		ordered = ordered && serialDrawn[i - 1] < serialDrawn[i];
+	CHECK(ordered);
+
+	// Short lists stay on the calling thread even with a pool.
+	std::vector<IndirectDrawItem> few(items.begin(), items.begin() + IndirectDrawBuilder::MinItemsPerChunk - 1);
+	builder.Build(few, &frustum, &pool, pooled.data());
+	CHECK(builder.GetStats().ChunkCount == 1);
+}
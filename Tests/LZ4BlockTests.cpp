@@ -0,0 +1,153 @@
+//***************************************************************************************
+// LZ4BlockTests.cpp
+//
+// Round trips inputs that hit the format's edges through LZ4CompressBlock and
+// LZ4DecompressBlock, decodes blocks written by hand as another encoder would, and feeds
+// the decompressor damaged blocks.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "LZ4Block.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::vector<uint8_t> Compress(const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> block(LZ4CompressBound(data.size()));
+		block.resize(LZ4CompressBlock(data.data(), data.size(), block.data()));
+		return block;
+	}
+
+	// Decompresses into a buffer of exactly size bytes, so nothing past it goes unseen.
+	bool Decompress(const std::vector<uint8_t>& block, size_t size, std::vector<uint8_t>& data)
+	{
+		data.assign(size, 0);
+		return LZ4DecompressBlock(block.data(), block.size(), data.data(), data.size());
+	}
+
+	std::vector<uint8_t> MakeText(size_t size, uint32_t seed)
+	{
+		// Words from a small vocabulary, like shader source.
+		const char* const words[] = { "float4 ", "gDiffuseMap", ".Sample(", "gsamAnisotropicWrap, ", "pin.TexC);\n",
+			"cbuffer ", "cbPass ", ": register(b1)\n{\n", "    float4x4 gView;\n", "#define ", "NUM_DIR_LIGHTS 3\n" };
+		std::mt19937 rng(seed);
+		std::vector<uint8_t> data;
+		while(data.size() < size)
+		{
+			const char* word = words[rng() % (sizeof(words) / sizeof(words[0]))];
+			data.insert(data.end(), word, word + std::char_traits<char>::length(word));
+		}
+		data.resize(size);
+		return data;
+	}
+
+	std::vector<uint8_t> MakeNoise(size_t size, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<uint8_t> data(size);
+		for(auto& b : data)
+			b = (uint8_t)rng();
+		return data;
+	}
+}
+
+TEST(LZ4Block, RoundTripsEdgeSizes)
+{
+	std::vector<std::vector<uint8_t>> inputs;
+	for(size_t size : { 0, 1, 4, 5, 12, 13, 14, 15, 16, 19, 20, 270, 271, 65535, 65536, 65537, 300000 })
+	{
+		inputs.push_back(MakeText(size, (uint32_t)size));
+		inputs.push_back(MakeNoise(size, (uint32_t)size));
+		inputs.push_back(std::vector<uint8_t>(size, 0x41));
+	}
+
+	// A repeat further back than a match can reach, then one just within it.
+	std::vector<uint8_t> far = MakeNoise(70000, 1);
+	far.insert(far.end(), far.begin(), far.begin() + 1000);
+	inputs.push_back(far);
+	std::vector<uint8_t> near = MakeNoise(65535, 2);
+	near.insert(near.end(), near.begin(), near.begin() + 1000);
+	inputs.push_back(near);
+
+	for(const auto& input : inputs)
+	{
+		std::vector<uint8_t> block = Compress(input);
+		CHECK(block.size() <= LZ4CompressBound(input.size()));
+
+		std::vector<uint8_t> output;
+		CHECK(Decompress(block, input.size(), output));
+		CHECK(output == input);
+	}
+
+	// Only worth having if it actually shrinks what the archive holds.
+	std::vector<uint8_t> text = MakeText(100000, 3);
+	CHECK(Compress(text).size() < text.size() / 3);
+	CHECK(Compress(std::vector<uint8_t>(100000, 0)).size() < 500);
+}
+
+TEST(LZ4Block, ReadsBlocksFromOtherEncoders)
+{
+	// 4 literals, an 8 byte match 4 back overlapping itself, then 5 closing literals.
+	std::vector<uint8_t> overlapping = { 0x44, 'a', 'b', 'c', 'd', 4, 0, 0x50, 'e', 'f', 'g', 'h', 'i' };
+	std::vector<uint8_t> output;
+	CHECK(Decompress(overlapping, 17, output));
+	CHECK(std::string(output.begin(), output.end()) == "abcdabcdabcdefghi");
+
+	// A run of one byte: a literal then a 1-back match of 15 + 10 + 4 bytes.
+	std::vector<uint8_t> run = { 0x1f, 'z', 1, 0, 10, 0x50, '1', '2', '3', '4', '5' };
+	CHECK(Decompress(run, 35, output));
+	CHECK(std::string(output.begin(), output.end()) == std::string(30, 'z') + "12345");
+
+	// 20 literals, the length carried on past the token.
+	std::vector<uint8_t> literals = { 0xf0, 5 };
+	for(int i = 0; i < 20; ++i)
+		literals.push_back((uint8_t)('A' + i));
+	CHECK(Decompress(literals, 20, output));
+	CHECK(output[19] == 'T');
+}
+
+TEST(LZ4Block, RejectsDamagedBlocks)
+{
+	std::vector<uint8_t> output;
+
+	// The wrong size either way, an offset of 0, an offset before the start of the output
+	// and a block cut off inside a literal run.
+	std::vector<uint8_t> overlapping = { 0x44, 'a', 'b', 'c', 'd', 4, 0, 0x50, 'e', 'f', 'g', 'h', 'i' };
+	CHECK(!Decompress(overlapping, 16, output));
+	CHECK(!Decompress(overlapping, 18, output));
+
+	std::vector<uint8_t> zeroOffset = overlapping;
+	zeroOffset[5] = 0;
+	CHECK(!Decompress(zeroOffset, 17, output));
+
+	std::vector<uint8_t> farOffset = overlapping;
+	farOffset[5] = 5;
+	CHECK(!Decompress(farOffset, 17, output));
+
+	std::vector<uint8_t> cut(overlapping.begin(), overlapping.end() - 2);
+	CHECK(!Decompress(cut, 17, output));
+
+	// Random damage: the decoder may accept a block whose literals were hit, which the
+	// archive's checksum catches, but must stay within the buffers and refuse most of it.
+	std::vector<uint8_t> input = MakeText(20000, 4);
+	std::vector<uint8_t> block = Compress(input);
+	std::mt19937 rng(46);
+	int rejected = 0;
+	for(int i = 0; i < 3000; ++i)
+	{
+		std::vector<uint8_t> damaged = block;
+		int flips = 1 + (int)(rng() % 3);
+		for(int f = 0; f < flips; ++f)
+			damaged[rng() % damaged.size()] ^= (uint8_t)(1u << (rng() % 8));
+		if(rng() % 4 == 0)
+			damaged.resize(rng() % damaged.size());
+
+		if(!Decompress(damaged, input.size(), output))
+			rejected++;
+	}
+	CHECK(rejected > 1500);
+}
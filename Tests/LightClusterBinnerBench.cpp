@@ -0,0 +1,62 @@
+//***************************************************************************************
+// LightClusterBinnerBench.cpp
+//
+// CommonBench LightClusterBinning [iterations]
+// Bins 1k, 10k and 100k random lights into the app's 16x9x24 grid at 1280x720 and
+// prints the time per build.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "LightClusterBinner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+BENCHMARK(LightClusterBinning)
+{
+	int iterations = args.empty() ? 20 : std::max(std::atoi(args[0].c_str()), 1);
+
+	const uint32_t width = 1280;
+	const uint32_t height = 720;
+	const float proj11 = 1.0f / tanf(0.125f * 3.14159265f);
+	const float proj00 = proj11 * height / width;
+
+	LightClusterBinner binner;
+	binner.Resize(width, height, proj00, proj11, 1.0f, 1000.0f);
+
+	std::printf("%10s %12s %14s %14s\n", "lights", "ms/build", "indices", "ns/light");
+	for(uint32_t lightCount : { 1000u, 10000u, 100000u })
+	{
+		// Small lights spread through the near part of the frustum, like a lit scene.
+		std::mt19937 rng(lightCount);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> depth(1.0f, 300.0f);
+		std::uniform_real_distribution<float> radius(1.0f, 10.0f);
+
+		std::vector<LightSphere> lights(lightCount);
+		for(LightSphere& light : lights)
+		{
+			light.Z = depth(rng);
+			light.X = unit(rng) * light.Z / proj00;
+			light.Y = unit(rng) * light.Z / proj11;
+			light.Radius = radius(rng);
+		}
+
+		// One build to size the scratch storage, then the timed ones.
+		binner.Build(lights.data(), lightCount);
+
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point start = Clock::now();
+		for(int i = 0; i < iterations; ++i)
+			binner.Build(lights.data(), lightCount);
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+
+		std::printf("%10u %12.3f %14zu %14.1f\n", lightCount, ms, binner.GetLightIndices().size(),
+			ms * 1.0e6 / lightCount);
+	}
+	return 0;
+}
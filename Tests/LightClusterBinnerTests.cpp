@@ -0,0 +1,225 @@
+//***************************************************************************************
+// LightClusterBinnerTests.cpp
+//
+// Checks the binned lists against a brute force sphere vs cluster box test, and checks
+// that points inside a light land, the way the shader finds them, in a cluster that
+// lists it.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "LightClusterBinner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const uint32_t gWidth = 1280;
+	const uint32_t gHeight = 720;
+	const float gNearZ = 1.0f;
+	const float gFarZ = 1000.0f;
+
+	// A 45 degree vertical field of view.
+	const float gProj11 = 1.0f / tanf(0.125f * 3.14159265f);
+	const float gProj00 = gProj11 * gHeight / gWidth;
+
+	struct Box
+	{
+		float Min[3];
+		float Max[3];
+	};
+
+	// The view space box of a cluster, worked out directly from its tile and slice.
+	Box ClusterBox(const LightClusterBinner& binner, uint32_t cluster)
+	{
+		uint32_t x = cluster % binner.GetTilesX();
+		uint32_t y = (cluster / binner.GetTilesX()) % binner.GetTilesY();
+		uint32_t z = cluster / (binner.GetTilesX() * binner.GetTilesY());
+
+		float zn = gNearZ * powf(gFarZ / gNearZ, (float)z / binner.GetSlices());
+		float zf = gNearZ * powf(gFarZ / gNearZ, (float)(z + 1) / binner.GetSlices());
+
+		float left = 2.0f * (x * binner.GetTileSizeX()) / gWidth - 1.0f;
+		float right = 2.0f * std::min((x + 1) * binner.GetTileSizeX(), (float)gWidth) / gWidth - 1.0f;
+		float top = 1.0f - 2.0f * (y * binner.GetTileSizeY()) / gHeight;
+		float bottom = 1.0f - 2.0f * std::min((y + 1) * binner.GetTileSizeY(), (float)gHeight) / gHeight;
+
+		Box box;
+		box.Min[0] = std::min({ left * zn, left * zf, right * zn, right * zf }) / gProj00;
+		box.Max[0] = std::max({ left * zn, left * zf, right * zn, right * zf }) / gProj00;
+		box.Min[1] = std::min({ bottom * zn, bottom * zf, top * zn, top * zf }) / gProj11;
+		box.Max[1] = std::max({ bottom * zn, bottom * zf, top * zn, top * zf }) / gProj11;
+		box.Min[2] = zn;
+		box.Max[2] = zf;
+		return box;
+	}
+
+	bool Touches(const LightSphere& light, const Box& box)
+	{
+		const float center[3] = { light.X, light.Y, light.Z };
+		float distSq = 0.0f;
+		for(int i = 0; i < 3; ++i)
+		{
+			float d = std::max(box.Min[i] - center[i], 0.0f) + std::max(center[i] - box.Max[i], 0.0f);
+			distSq += d * d;
+		}
+		return distSq <= light.Radius * light.Radius * 1.0001f;
+	}
+
+	// ComputeClusterIndex in ClusteredLighting.hlsl, from a view space position.
+	uint32_t FindCluster(const LightClusterBinner& binner, float x, float y, float z)
+	{
+		float ndcX = gProj00 * x / z;
+		float ndcY = gProj11 * y / z;
+		float px = (ndcX * 0.5f + 0.5f) * gWidth;
+		float py = (0.5f - ndcY * 0.5f) * gHeight;
+
+		uint32_t slice = (uint32_t)std::max(logf(z) * binner.GetSliceScale() - binner.GetSliceBias(), 0.0f);
+		slice = std::min(slice, binner.GetSlices() - 1);
+		uint32_t tileX = std::min((uint32_t)(px / binner.GetTileSizeX()), binner.GetTilesX() - 1);
+		uint32_t tileY = std::min((uint32_t)(py / binner.GetTileSizeY()), binner.GetTilesY() - 1);
+
+		return (slice * binner.GetTilesY() + tileY) * binner.GetTilesX() + tileX;
+	}
+
+	std::vector<LightSphere> RandomLights(uint32_t count, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> unit(-1.2f, 1.2f);
+		std::uniform_real_distribution<float> depth(-20.0f, 400.0f);
+		std::uniform_real_distribution<float> radius(0.5f, 40.0f);
+
+		std::vector<LightSphere> lights(count);
+		for(LightSphere& light : lights)
+		{
+			// Spread over a little more than the frustum, some behind the eye.
+			light.Z = depth(rng);
+			float z = std::max(light.Z, gNearZ);
+			light.X = unit(rng) * z / gProj00;
+			light.Y = unit(rng) * z / gProj11;
+			light.Radius = radius(rng);
+		}
+		return lights;
+	}
+
+	bool Lists(const LightClusterBinner& binner, uint32_t cluster, uint32_t light)
+	{
+		const ClusterRange& range = binner.GetClusterRanges()[cluster];
+		const uint32_t* first = binner.GetLightIndices().data() + range.Offset;
+		return std::binary_search(first, first + range.Count, light);
+	}
+
+	void CheckAgainstReference(uint32_t tilesX, uint32_t tilesY, uint32_t slices, uint32_t seed)
+	{
+		LightClusterBinner binner(tilesX, tilesY, slices);
+		binner.Resize(gWidth, gHeight, gProj00, gProj11, gNearZ, gFarZ);
+
+		std::vector<LightSphere> lights = RandomLights(300, seed);
+		binner.Build(lights.data(), (uint32_t)lights.size());
+
+		// The ranges tile the index list, and each cluster lists its lights in order.
+		const std::vector<ClusterRange>& ranges = binner.GetClusterRanges();
+		const std::vector<uint32_t>& indices = binner.GetLightIndices();
+		CHECK(ranges.size() == binner.GetClusterCount());
+
+		uint32_t offset = 0;
+		bool contiguous = true;
+		bool sorted = true;
+		bool touching = true;
+		for(uint32_t cluster = 0; cluster < ranges.size(); ++cluster)
+		{
+			contiguous = contiguous && ranges[cluster].Offset == offset;
+			offset += ranges[cluster].Count;
+
+			Box box = ClusterBox(binner, cluster);
+			for(uint32_t i = 0; i < ranges[cluster].Count; ++i)
+			{
+				uint32_t light = indices[ranges[cluster].Offset + i];
+				if(i > 0 && indices[ranges[cluster].Offset + i - 1] >= light)
+					sorted = false;
+				if(light >= lights.size() || !Touches(lights[light], box))
+					touching = false;
+			}
+		}
+		CHECK(contiguous);
+		CHECK(offset == indices.size());
+		CHECK(sorted);
+		CHECK(touching);
+
+		// Points inside each light, in the frustum, must find it in their cluster.
+		std::mt19937 rng(seed + 1000);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		bool covered = true;
+		uint32_t samples = 0;
+		for(uint32_t light = 0; light < lights.size(); ++light)
+		{
+			for(int i = 0; i < 64; ++i)
+			{
+				// Slightly inside the sphere, so rounding at cluster edges can't matter.
+				float p[3] = { unit(rng), unit(rng), unit(rng) };
+				float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+				if(length > 1.0f || length == 0.0f)
+					continue;
+
+				float x = lights[light].X + p[0] * lights[light].Radius * 0.99f;
+				float y = lights[light].Y + p[1] * lights[light].Radius * 0.99f;
+				float z = lights[light].Z + p[2] * lights[light].Radius * 0.99f;
+				if(z < gNearZ || z > gFarZ || fabsf(gProj00 * x / z) > 1.0f || fabsf(gProj11 * y / z) > 1.0f)
+					continue;
+
+				samples++;
+				if(!Lists(binner, FindCluster(binner, x, y, z), light))
+					covered = false;
+			}
+		}
+		CHECK(samples > 1000);
+		CHECK(covered);
+	}
+}
+
+TEST(LightClusterBinner, MatchesReferenceOnRandomLights)
+{
+	CheckAgainstReference(16, 9, 24, 1);
+	CheckAgainstReference(16, 9, 24, 2);
+}
+
+TEST(LightClusterBinner, HandlesRowsThatAreNotWholeGroups)
+{
+	// 15 and 7 columns leave padding in the last group of four.
+	CheckAgainstReference(15, 9, 24, 3);
+	CheckAgainstReference(7, 5, 8, 4);
+	CheckAgainstReference(1, 1, 1, 5);
+}
+
+TEST(LightClusterBinner, SkipsLightsOutsideTheFrustum)
+{
+	LightClusterBinner binner;
+	binner.Resize(gWidth, gHeight, gProj00, gProj11, gNearZ, gFarZ);
+
+	LightSphere lights[4];
+	lights[0].Z = -10.0f;
+	lights[0].Radius = 5.0f;
+	lights[1].Z = gFarZ + 10.0f;
+	lights[1].Radius = 5.0f;
+	lights[2].X = 500.0f;
+	lights[2].Z = 50.0f;
+	lights[2].Radius = 1.0f;
+	lights[3].Z = 50.0f;
+	lights[3].Radius = 1.0f;
+
+	binner.Build(lights, 4);
+
+	// Only the light straight ahead is binned.
+	const std::vector<uint32_t>& indices = binner.GetLightIndices();
+	CHECK(!indices.empty());
+	CHECK(std::all_of(indices.begin(), indices.end(), [](uint32_t light) { return light == 3; }));
+	CHECK(Lists(binner, FindCluster(binner, 0.0f, 0.0f, 50.0f), 3));
+
+	// Rebuilding with nothing clears the lists.
+	binner.Build(nullptr, 0);
+	CHECK(binner.GetLightIndices().empty());
+	CHECK(std::all_of(binner.GetClusterRanges().begin(), binner.GetClusterRanges().end(),
+		[](const ClusterRange& range) { return range.Count == 0; }));
+}
@@ -0,0 +1,82 @@
+//***************************************************************************************
+// MaterialAnimatorTests.cpp
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "MaterialAnimator.h"
+
+namespace
+{
+	MaterialKey Key(float time, float value)
+	{
+		MaterialKey key;
+		key.Time = time;
+		key.Value = DirectX::XMFLOAT4(value, value, value, value);
+		return key;
+	}
+
+	bool Throws(MaterialAnimator& animator, Material* material, const std::vector<MaterialKey>& keys)
+	{
+		try
+		{
+			animator.AddKeyframeTrack(material, MaterialChannel::Roughness, keys, false);
+		}
+		catch(const DxException&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+TEST(MaterialAnimator, RejectsKeysThatDontAdvance)
+{
+	Material material;
+	MaterialAnimator animator;
+
+	CHECK(Throws(animator, &material, {}));
+	CHECK(Throws(animator, &material, { Key(0.0f, 0.0f), Key(1.0f, 1.0f), Key(1.0f, 2.0f) }));
+	CHECK(Throws(animator, &material, { Key(0.0f, 0.0f), Key(2.0f, 1.0f), Key(1.0f, 2.0f) }));
+	CHECK(animator.GetTrackCount() == 0);
+
+	CHECK(!Throws(animator, &material, { Key(0.0f, 0.0f), Key(1.0f, 1.0f), Key(1.5f, 2.0f) }));
+	CHECK(animator.GetTrackCount() == 1);
+}
+
+TEST(MaterialAnimator, InterpolatesAndLoops)
+{
+	Material material;
+	MaterialAnimator animator;
+	animator.AddKeyframeTrack(&material, MaterialChannel::Roughness,
+		{ Key(0.0f, 0.0f), Key(1.0f, 1.0f), Key(2.0f, 0.5f) }, true);
+
+	animator.Evaluate(0.5f);
+	CHECK(material.Roughness == 0.5f);
+	animator.Evaluate(1.5f);
+	CHECK(material.Roughness == 0.75f);
+
+	// One period later, and back in time, give the same values.
+	animator.Evaluate(2.5f);
+	CHECK(material.Roughness == 0.5f);
+	animator.Evaluate(0.25f);
+	CHECK(material.Roughness == 0.25f);
+}
+
+TEST(MaterialAnimator, OnlyDirtiesChangedMaterials)
+{
+	Material still;
+	Material moving;
+	MaterialAnimator animator;
+	animator.AddLinearTrack(&still, MaterialChannel::TexOffset,
+		DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f), DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+	animator.AddLinearTrack(&moving, MaterialChannel::TexOffset,
+		DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f), DirectX::XMFLOAT4(0.1f, 0.0f, 0.0f, 0.0f));
+
+	still.NumFramesDirty = 0;
+	moving.NumFramesDirty = 0;
+	animator.Evaluate(1.0f);
+
+	CHECK(still.NumFramesDirty == 0);
+	CHECK(moving.NumFramesDirty == gNumFrameResources);
+	CHECK(animator.GetStats().MaterialsTouched == 1);
+}
@@ -0,0 +1,67 @@
+//***************************************************************************************
+// MipGenerationBench.cpp
+//
+// CommonBench MipGeneration [size]
+// Builds the mip chain of a size x size image (2048 by default) with each filter, in
+// linear and sRGB space, on the calling thread and on a ThreadPool, and prints the
+// megapixels written per second.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+BENCHMARK(MipGeneration)
+{
+	uint32_t size = args.empty() ? 2048 : (uint32_t)std::max(std::atoi(args[0].c_str()), 1);
+	uint32_t mipCount = GetFullMipCount(size, size);
+
+	std::vector<std::vector<uint8_t>> levels(mipCount);
+	std::vector<MipSurface> surfaces(mipCount);
+	for(uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		MipSurface& surface = surfaces[mip];
+		surface.Width = std::max(size >> mip, 1u);
+		surface.Height = surface.Width;
+		surface.RowPitch = surface.Width * 4;
+		levels[mip].resize(surface.RowPitch * surface.Height);
+		surface.Pixels = levels[mip].data();
+	}
+
+	std::mt19937 rng(36);
+	for(uint8_t& byte : levels[0])
+		byte = (uint8_t)(rng() & 0xff);
+
+	ThreadPool pool;
+	std::printf("%ux%u, %u mips, %u worker threads\n", size, size, mipCount, pool.GetThreadCount());
+	std::printf("%8s %8s %12s %12s\n", "filter", "space", "serial MP/s", "pool MP/s");
+
+	for(MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		for(bool srgb : { false, true })
+		{
+			// The best of a few runs each way.
+			double serial = 0.0;
+			double pooled = 0.0;
+			for(int pass = 0; pass < 3; ++pass)
+			{
+				MipGenerateStats stats;
+				GenerateMips(filter, srgb, surfaces.data(), mipCount, 1, nullptr, stats);
+				serial = std::max(serial, stats.MegapixelsPerSecond);
+
+				GenerateMips(filter, srgb, surfaces.data(), mipCount, 1, &pool, stats);
+				pooled = std::max(pooled, stats.MegapixelsPerSecond);
+			}
+
+			std::printf("%8s %8s %12.1f %12.1f\n", filter == MipFilter::Box ? "box" : "kaiser",
+				srgb ? "srgb" : "linear", serial, pooled);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,186 @@
+//***************************************************************************************
+// MipGeneratorTests.cpp
+//
+// Checks the mip chains GenerateMips and GenerateDDSMips build: their sizes, that flat
+// images stay flat, that averaging happens in linear light, and that the pool writes the
+// same texels as the calling thread.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSTestFiles.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Every level of every slice, slice major, each in its own tightly packed buffer.
+	struct MipChain
+	{
+		std::vector<std::vector<uint8_t>> Levels;
+		std::vector<MipSurface> Surfaces;
+	};
+
+	template<typename Pixel>
+	MipChain MakeChain(uint32_t width, uint32_t height, uint32_t arraySize, Pixel pixel)
+	{
+		MipChain chain;
+		uint32_t mipCount = GetFullMipCount(width, height);
+		chain.Levels.resize(mipCount * arraySize);
+		chain.Surfaces.resize(mipCount * arraySize);
+		for(uint32_t slice = 0; slice < arraySize; ++slice)
+		{
+			for(uint32_t mip = 0; mip < mipCount; ++mip)
+			{
+				uint32_t i = slice * mipCount + mip;
+				MipSurface& surface = chain.Surfaces[i];
+				surface.Width = std::max(width >> mip, 1u);
+				surface.Height = std::max(height >> mip, 1u);
+				surface.RowPitch = surface.Width * 4;
+				chain.Levels[i].assign(surface.RowPitch * surface.Height, 0);
+				surface.Pixels = chain.Levels[i].data();
+			}
+
+			std::vector<uint8_t>& top = chain.Levels[slice * mipCount];
+			for(uint32_t y = 0; y < height; ++y)
+			{
+				for(uint32_t x = 0; x < width; ++x)
+					pixel(x, y, slice, &top[(y * width + x) * 4]);
+			}
+		}
+		return chain;
+	}
+
+	// The largest difference from rgba over every texel of every level.
+	int MaxErrorFrom(const MipChain& chain, const uint8_t rgba[4])
+	{
+		int maxError = 0;
+		for(const auto& level : chain.Levels)
+		{
+			for(size_t i = 0; i < level.size(); ++i)
+				maxError = std::max(maxError, std::abs(level[i] - rgba[i % 4]));
+		}
+		return maxError;
+	}
+}
+
+TEST(MipGenerator, CountsLevelsDownToOneTexel)
+{
+	CHECK(GetFullMipCount(1, 1) == 1);
+	CHECK(GetFullMipCount(256, 256) == 9);
+	CHECK(GetFullMipCount(300, 17) == 9);
+	CHECK(GetFullMipCount(1, 1024) == 11);
+}
+
+TEST(MipGenerator, FlatImagesStayFlat)
+{
+	const uint8_t colour[4] = { 200, 90, 30, 128 };
+	auto flat = [&colour](uint32_t, uint32_t, uint32_t, uint8_t* rgba) { std::memcpy(rgba, colour, 4); };
+
+	// Odd sizes make the box filter straddle texels, and Kaiser reaches past the edges.
+	for(MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		for(bool srgb : { false, true })
+		{
+			MipChain chain = MakeChain(37, 20, 2, flat);
+			MipGenerateStats stats;
+			GenerateMips(filter, srgb, chain.Surfaces.data(), GetFullMipCount(37, 20), 2, nullptr, stats);
+			CHECK(MaxErrorFrom(chain, colour) <= 1);
+			CHECK(stats.MipCount == 6 && stats.ArraySize == 2);
+		}
+	}
+}
+
+TEST(MipGenerator, AveragesInLinearLight)
+{
+	// Black and white columns: a linear average is mid grey, which sRGB encodes as 188.
+	auto stripes = [](uint32_t x, uint32_t, uint32_t, uint8_t* rgba)
+	{
+		uint8_t value = x % 2 == 0 ? 0 : 255;
+		rgba[0] = rgba[1] = rgba[2] = value;
+		rgba[3] = value;
+	};
+
+	for(bool srgb : { false, true })
+	{
+		MipChain chain = MakeChain(2, 2, 1, stripes);
+		MipGenerateStats stats;
+		GenerateMips(MipFilter::Box, srgb, chain.Surfaces.data(), 2, 1, nullptr, stats);
+
+		const uint8_t* texel = chain.Surfaces[1].Pixels;
+		int expected = srgb ? 188 : 128;
+		for(int c = 0; c < 3; ++c)
+			CHECK(std::abs(texel[c] - expected) <= 1);
+
+		// Alpha is never gamma corrected.
+		CHECK(std::abs(texel[3] - 128) <= 1);
+	}
+}
+
+TEST(MipGenerator, PoolMatchesTheCallingThread)
+{
+	auto noise = [](uint32_t x, uint32_t y, uint32_t slice, uint8_t* rgba)
+	{
+		uint32_t h = (x * 73856093u) ^ (y * 19349663u) ^ (slice * 83492791u);
+		std::memcpy(rgba, &h, 4);
+	};
+
+	ThreadPool pool;
+	for(MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+	{
+		MipChain serial = MakeChain(130, 67, 3, noise);
+		MipChain pooled = MakeChain(130, 67, 3, noise);
+		MipGenerateStats stats;
+		GenerateMips(filter, true, serial.Surfaces.data(), GetFullMipCount(130, 67), 3, nullptr, stats);
+		GenerateMips(filter, true, pooled.Surfaces.data(), GetFullMipCount(130, 67), 3, &pool, stats);
+		CHECK(serial.Levels == pooled.Levels);
+	}
+}
+
+TEST(MipGenerator, RebuildsTheChainOfWholeFiles)
+{
+	std::vector<uint8_t> file = MakeRGBA8DDSFile(64, 32, 1, 3,
+		[](uint32_t x, uint32_t y, uint32_t, uint32_t slice, uint8_t* rgba)
+		{
+			rgba[0] = (uint8_t)(x * 4);
+			rgba[1] = (uint8_t)(y * 8);
+			rgba[2] = (uint8_t)(slice * 80);
+			rgba[3] = 255;
+		});
+
+	std::vector<uint8_t> output;
+	MipGenerateStats stats;
+	CHECK(GenerateDDSMips(file.data(), file.size(), MipFilter::Kaiser, true, nullptr, output, stats) == DDS_RESULT_OK);
+
+	DDSTextureDesc desc;
+	CHECK(ParseDDSTexture(output.data(), output.size(), desc) == DDS_RESULT_OK);
+	CHECK(desc.format == DXGI_FORMAT_R8G8B8A8_UNORM);
+	CHECK(desc.width == 64 && desc.height == 32);
+	CHECK(desc.mipCount == 7);
+	CHECK(desc.arraySize == 3);
+	CHECK(desc.dataSize == GetDDSSurfaceBytes(desc));
+
+	// The top level of every slice is copied as it was.
+	std::vector<DDSSubresourceLayout> layouts(desc.mipCount * desc.arraySize);
+	DDSLayoutInfo info;
+	CHECK(GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info) == DDS_RESULT_OK);
+	for(uint32_t slice = 0; slice < 3; ++slice)
+	{
+		size_t sourceOffset = DDS_DX10_HEADERS_SIZE + slice * 64 * 32 * 4;
+		CHECK(std::memcmp(output.data() + layouts[slice * 7].offset, file.data() + sourceOffset, 64 * 32 * 4) == 0);
+	}
+
+	std::vector<uint8_t> bc1 = MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, DXGI_FORMAT_BC1_UNORM,
+		16, 16, 1, 1, 1, false));
+	CHECK(GenerateDDSMips(bc1.data(), bc1.size(), MipFilter::Box, true, nullptr, output, stats) == DDS_RESULT_NOT_SUPPORTED);
+
+	std::vector<uint8_t> volume = MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE3D, DXGI_FORMAT_R8G8B8A8_UNORM,
+		8, 8, 8, 1, 1, false));
+	CHECK(GenerateDDSMips(volume.data(), volume.size(), MipFilter::Box, true, nullptr, output, stats) == DDS_RESULT_NOT_SUPPORTED);
+}
@@ -0,0 +1,260 @@
+//***************************************************************************************
+// PassConstantsBuilderTests.cpp
+//
+// Loads light scene files into a LightStore, and checks which blocks of the pass
+// constants PassConstantsBuilder copies frame after frame, against a buffer that
+// records every copy.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "PassConstantsBuilder.h"
+#include "TempDirectory.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Stands in for the frame's UploadBuffer<PassConstants>: keeps one element and the
+	// byte ranges copied into it.
+	class RecordingPassBuffer
+	{
+	public:
+		void CopyData(int elementIndex, const PassConstants& data, UINT byteOffset, UINT byteCount)
+		{
+			std::memcpy(reinterpret_cast<BYTE*>(&Element) + byteOffset,
+				reinterpret_cast<const BYTE*>(&data) + byteOffset, byteCount);
+			Copies.push_back({ byteOffset, byteCount });
+			LastElementIndex = elementIndex;
+		}
+
+		// Whether the last Upload copied the block starting at member offset.
+		bool Copied(size_t offset)const
+		{
+			for(const auto& copy : Copies)
+			{
+				if(copy.first == offset)
+					return true;
+			}
+			return false;
+		}
+
+		PassConstants Element;
+		std::vector<std::pair<UINT, UINT>> Copies;
+		int LastElementIndex = -1;
+	};
+
+	void LoadScene(LightStore& store, const std::string& text)
+	{
+		TempDirectory directory("LightStore");
+		directory.WriteFile("Lights.txt", std::vector<uint8_t>(text.begin(), text.end()));
+		store.LoadFromFile(directory.GetFile("Lights.txt"));
+	}
+
+	bool LoadFails(const std::string& text)
+	{
+		LightStore store;
+		try
+		{
+			LoadScene(store, text);
+		}
+		catch(const DxException&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	bool Equal(const XMFLOAT3& a, float x, float y, float z)
+	{
+		return a.x == x && a.y == y && a.z == z;
+	}
+
+	// One Upload for a frame with an unchanged camera.
+	void RunFrame(PassConstantsBuilder& builder, const LightStore& store, RecordingPassBuffer& buffer)
+	{
+		buffer.Copies.clear();
+		builder.BeginFrame();
+		builder.SetCamera(MathHelper::Identity4x4(), MathHelper::Identity4x4(), XMFLOAT3(0.0f, 1.0f, 2.0f));
+		builder.SetRenderTarget(1280.0f, 720.0f, 1.0f, 1000.0f);
+		builder.SetTime(1.0f, 0.016f);
+		builder.SetLights(store);
+		builder.Upload(&buffer, 0);
+	}
+}
+
+TEST(PassConstantsBuilder, LoadsSceneFiles)
+{
+	LightStore store;
+	LoadScene(store,
+		"# A comment line, then a blank one.\n"
+		"\n"
+		"ambient     0.1 0.2 0.3 0.5   # and a trailing comment\n"
+		"directional strength 0.8 0.5 0.3  direction -0.5 -0.35 0.5\n"
+		"point       strength 2 1 0  position 1 2 3\n"
+		"point       strength 1 1 1  position 4 5 6  falloff 2 30\n"
+		"spot        strength 3 3 3  position 0 5 0  direction 0 -1 0  falloff 1 20  spotpower 8\n");
+
+	CHECK(store.GetCount() == 4);
+	CHECK(store.GetAmbient().x == 0.1f && store.GetAmbient().w == 0.5f);
+	CHECK(store.GetType(0) == LightType::Directional);
+	CHECK(store.GetType(3) == LightType::Spot);
+
+	std::vector<Light> points;
+	store.Gather(LightType::Point, points);
+	CHECK(points.size() == 2);
+
+	// Without a falloff the defaults stay; with one it's taken.
+	CHECK(Equal(points[0].Position, 1.0f, 2.0f, 3.0f));
+	CHECK(points[0].FalloffStart == 1.0f && points[0].FalloffEnd == 10.0f);
+	CHECK(points[1].FalloffStart == 2.0f && points[1].FalloffEnd == 30.0f);
+
+	std::vector<Light> spots;
+	store.Gather(LightType::Spot, spots);
+	CHECK(spots.size() == 1);
+	CHECK(spots[0].SpotPower == 8.0f && spots[0].FalloffEnd == 20.0f);
+	CHECK(Equal(spots[0].Direction, 0.0f, -1.0f, 0.0f));
+
+	// Loading again replaces what was there, ambient included.
+	LoadScene(store, "point strength 1 1 1 position 0 0 0\n");
+	CHECK(store.GetCount() == 1);
+	CHECK(store.GetAmbient().x == 0.0f && store.GetAmbient().w == 1.0f);
+}
+
+TEST(PassConstantsBuilder, RejectsBadSceneLines)
+{
+	CHECK(!LoadFails("point strength 1 1 1 position 0 0 0\n"));
+	CHECK(LoadFails("area strength 1 1 1\n"));
+	CHECK(LoadFails("ambient 0.1 0.2\n"));
+	CHECK(LoadFails("point strength 1 1 position 0 0 0\n"));
+	CHECK(LoadFails("point strength 1 1 1 color 0 0 0\n"));
+	CHECK(LoadFails("spot strength 1 1 1 spotpower\n"));
+
+	LightStore store;
+	bool threw = false;
+	try
+	{
+		store.LoadFromFile(L"NoSuchDirectory/Lights.txt");
+	}
+	catch(const DxException&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST(PassConstantsBuilder, EveryEditBumpsTheVersion)
+{
+	LightStore store;
+	UINT64 version = store.GetVersion();
+	auto bumped = [&store, &version]()
+	{
+		bool moved = store.GetVersion() > version;
+		version = store.GetVersion();
+		return moved;
+	};
+
+	UINT index = store.Add(LightType::Point, Light());
+	CHECK(bumped());
+	store.SetAmbient(XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f));
+	CHECK(bumped());
+	store.SetPosition(index, XMFLOAT3(1.0f, 0.0f, 0.0f));
+	CHECK(bumped());
+	store.SetDirection(index, XMFLOAT3(0.0f, 0.0f, 1.0f));
+	CHECK(bumped());
+	store.SetStrength(index, XMFLOAT3(2.0f, 2.0f, 2.0f));
+	CHECK(bumped());
+	store.SetFalloff(index, 2.0f, 5.0f);
+	CHECK(bumped());
+	store.Clear();
+	CHECK(bumped());
+
+	// Reading doesn't.
+	std::vector<Light> lights;
+	store.Gather(LightType::Point, lights);
+	store.GetCount();
+	CHECK(!bumped());
+}
+
+TEST(PassConstantsBuilder, UploadsBlocksWhileTheyAreDirty)
+{
+	LightStore store;
+	Light sun;
+	sun.Strength = XMFLOAT3(0.8f, 0.5f, 0.3f);
+	store.Add(LightType::Directional, sun);
+	store.Add(LightType::Point, Light());
+
+	PassConstantsBuilder builder;
+	RecordingPassBuffer buffer;
+	const size_t camera = offsetof(PassConstants, View);
+	const size_t time = offsetof(PassConstants, TotalTime);
+	const size_t lights = offsetof(PassConstants, AmbientLight);
+	const size_t clusters = offsetof(PassConstants, ClusterTilesX);
+
+	// Every frame resource gets the camera and lights once, then only what changes
+	// every frame is copied.
+	for(int frame = 0; frame < gNumFrameResources; ++frame)
+	{
+		RunFrame(builder, store, buffer);
+		CHECK(buffer.Copied(camera) && buffer.Copied(time) && buffer.Copied(lights) && buffer.Copied(clusters));
+	}
+	UINT covered = 0;
+	for(const auto& copy : buffer.Copies)
+		covered += copy.second;
+	CHECK(covered == sizeof(PassConstants));
+	CHECK(buffer.LastElementIndex == 0);
+	RunFrame(builder, store, buffer);
+	CHECK(!buffer.Copied(camera) && !buffer.Copied(lights));
+	CHECK(buffer.Copied(time) && buffer.Copied(clusters));
+
+	// A light edit dirties only the light block, for every frame resource again.
+	store.SetStrength(0, XMFLOAT3(1.0f, 1.0f, 1.0f));
+	for(int frame = 0; frame < gNumFrameResources; ++frame)
+	{
+		RunFrame(builder, store, buffer);
+		CHECK(buffer.Copied(lights) && !buffer.Copied(camera));
+	}
+	RunFrame(builder, store, buffer);
+	CHECK(!buffer.Copied(lights));
+	CHECK(Equal(buffer.Element.Lights[0].Strength, 1.0f, 1.0f, 1.0f));
+
+	// So does a render target resize for the camera block.
+	buffer.Copies.clear();
+	builder.BeginFrame();
+	builder.SetRenderTarget(1920.0f, 1080.0f, 1.0f, 1000.0f);
+	builder.Upload(&buffer, 0);
+	CHECK(buffer.Copied(camera));
+	CHECK(buffer.Element.RenderTargetSize.x == 1920.0f);
+
+	const PassConstantsStats& stats = builder.GetStats();
+	CHECK(stats.CameraRebuilds == 1);
+	CHECK(stats.CameraUploads == (UINT64)gNumFrameResources + 1);
+	CHECK(stats.LightRebuilds == 2);
+	CHECK(stats.LightUploads == 2 * (UINT64)gNumFrameResources);
+}
+
+TEST(PassConstantsBuilder, UnusedLightsHaveNoStrength)
+{
+	LightStore store;
+	Light sun;
+	sun.Strength = XMFLOAT3(0.8f, 0.5f, 0.3f);
+	store.Add(LightType::Directional, sun);
+
+	// Point lights go through the clusters, not Lights[].
+	store.Add(LightType::Point, Light());
+
+	PassConstantsBuilder builder;
+	RecordingPassBuffer buffer;
+	RunFrame(builder, store, buffer);
+
+	CHECK(Equal(buffer.Element.Lights[0].Strength, 0.8f, 0.5f, 0.3f));
+	bool dark = true;
+	for(int i = 1; i < MaxLights; ++i)
+		dark = dark && Equal(buffer.Element.Lights[i].Strength, 0.0f, 0.0f, 0.0f);
+	CHECK(dark);
+}
@@ -0,0 +1,301 @@
+//***************************************************************************************
+// PipelineCacheTests.cpp
+//
+// Checks that pipeline keys depend on what the description holds and nothing else, and
+// drives PipelineCache with a stub backend whose pipelines can be held back until the
+// test lets them finish.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "PipelineCache.h"
+#include "ThreadPool.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	// A cut down pipeline description: the shader bytecode, the input layout semantic
+	// names and a few state values, added the way PipelineStateCache adds them.
+	struct StubPipelineDesc
+	{
+		StubPipelineDesc()
+		{
+			const uint8_t vs[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4 };
+			const uint8_t ps[] = { 0x44, 0x58, 0x42, 0x43, 5, 6, 7, 8, 9 };
+			VS.assign(vs, vs + sizeof(vs));
+			PS.assign(ps, ps + sizeof(ps));
+		}
+
+		std::vector<uint8_t> VS;
+		std::vector<uint8_t> PS;
+		const char* Semantics[3] = { "POSITION", "NORMAL", "TEXCOORD" };
+		uint32_t CullMode = 3;
+		uint32_t RenderTargetFormat = 28;
+		uint32_t SampleCount = 1;
+	};
+
+	PipelineKey MakeKey(const StubPipelineDesc& desc)
+	{
+		PipelineKeyBuilder builder;
+		builder.AddBlob(desc.VS.data(), desc.VS.size());
+		builder.AddBlob(desc.PS.data(), desc.PS.size());
+		for(const char* semantic : desc.Semantics)
+			builder.AddString(semantic);
+		builder.Add(desc.CullMode);
+		builder.Add(desc.RenderTargetFormat);
+		builder.Add(desc.SampleCount);
+		return builder.GetKey();
+	}
+
+	PipelineKey MakeKey(uint32_t variant)
+	{
+		StubPipelineDesc desc;
+		desc.RenderTargetFormat = variant;
+		return MakeKey(desc);
+	}
+
+	class StubPipelineBackend : public PipelineCacheBackend
+	{
+	public:
+		PipelineSource Create(uint32_t pipeline, const PipelineKey& key)override
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mOpened.wait(lock, [this, pipeline]() { return Held.count(pipeline) == 0; });
+
+			Created.push_back(pipeline);
+			if(Throws.count(pipeline) != 0)
+				throw std::runtime_error("device removed");
+			if(Fails.count(pipeline) != 0)
+				return PipelineSource::Failed;
+			return Saved.count(key.Hash) != 0 ? PipelineSource::Loaded : PipelineSource::Created;
+		}
+
+		void Hold(uint32_t pipeline)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			Held.insert(pipeline);
+		}
+
+		void Release()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				Held.clear();
+			}
+			mOpened.notify_all();
+		}
+
+		size_t GetCreateCount()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return Created.size();
+		}
+
+		std::set<uint32_t> Fails;
+		std::set<uint32_t> Throws;
+
+		// Key hashes found in the library an earlier run saved.
+		std::set<uint64_t> Saved;
+
+	private:
+		std::mutex mMutex;
+		std::condition_variable mOpened;
+		std::set<uint32_t> Held;
+		std::vector<uint32_t> Created;
+	};
+}
+
+TEST(PipelineCache, KeyIsStableAcrossRuns)
+{
+	// The key names the pipeline in the library saved on disk, so a fixed description
+	// must always give the same one.
+	PipelineKey key = MakeKey(StubPipelineDesc());
+	CHECK(PipelineKeyBuilder::GetName(key) == L"8bf85f1f25bb67fd82fbb10773244bf9");
+
+	// Bytecode counts by content: a copy somewhere else in memory is the same pipeline.
+	StubPipelineDesc copy;
+	std::vector<uint8_t> moved(copy.VS);
+	copy.VS.swap(moved);
+	CHECK(MakeKey(copy) == key);
+}
+
+TEST(PipelineCache, KeyChangesWithEveryField)
+{
+	StubPipelineDesc base;
+	std::vector<StubPipelineDesc> variants(6, base);
+	variants[0].VS.back() ^= 1;
+	variants[1].PS.pop_back();
+	variants[2].Semantics[1] = "NORMAL1";
+	variants[3].Semantics[2] = nullptr;
+	variants[4].CullMode = 2;
+	variants[5].SampleCount = 4;
+
+	std::vector<PipelineKey> keys = { MakeKey(base) };
+	for(const auto& desc : variants)
+		keys.push_back(MakeKey(desc));
+
+	for(size_t i = 0; i < keys.size(); ++i)
+	{
+		for(size_t j = i + 1; j < keys.size(); ++j)
+		{
+			CHECK(keys[i].Hash != keys[j].Hash);
+			CHECK(keys[i] != keys[j]);
+		}
+	}
+
+	// Strings can't run into each other, and a null one isn't an empty one.
+	PipelineKeyBuilder ab;
+	ab.AddString("ab");
+	ab.AddString("c");
+	PipelineKeyBuilder bc;
+	bc.AddString("a");
+	bc.AddString("bc");
+	CHECK(ab.GetKey() != bc.GetKey());
+
+	PipelineKeyBuilder empty;
+	empty.AddString("");
+	PipelineKeyBuilder null;
+	null.AddString(nullptr);
+	CHECK(empty.GetKey() != null.GetKey());
+}
+
+TEST(PipelineCache, IdenticalRequestsShareAPipeline)
+{
+	StubPipelineBackend backend;
+	PipelineCache cache(backend);
+
+	bool added = false;
+	uint32_t opaque = cache.Request(MakeKey(28), false, added);
+	CHECK(added);
+	uint32_t transparent = cache.Request(MakeKey(29), false, added);
+	CHECK(added);
+
+	// The same description built again, by another material.
+	CHECK(cache.Request(MakeKey(28), false, added) == opaque);
+	CHECK(!added);
+	CHECK(opaque != transparent);
+
+	ThreadPool pool(2);
+	CHECK(cache.CreatePipelines(&pool));
+	CHECK(backend.GetCreateCount() == 2);
+	CHECK(cache.IsReady(opaque) && cache.IsReady(transparent));
+
+	PipelineCacheStats stats = cache.GetStats();
+	CHECK(stats.Requests == 3);
+	CHECK(stats.Pipelines == 2);
+	CHECK(stats.Created == 2);
+	CHECK(cache.GetKey(opaque) == MakeKey(28));
+
+	// Asked for again after creation: no second pipeline.
+	CHECK(cache.Request(MakeKey(29), false, added) == transparent);
+	CHECK(cache.CreatePipelines(&pool));
+	CHECK(backend.GetCreateCount() == 2);
+}
+
+TEST(PipelineCache, DeferredPipelinesFinishBehindTheFirstFrame)
+{
+	StubPipelineBackend backend;
+	PipelineCache cache(backend);
+
+	bool added = false;
+	uint32_t first = cache.Request(MakeKey(1), false, added);
+	uint32_t later = cache.Request(MakeKey(2), true, added);
+	uint32_t last = cache.Request(MakeKey(3), false, added);
+
+	// The deferred pipeline can't finish, yet CreatePipelines returns with the others.
+	backend.Hold(later);
+	ThreadPool pool(2);
+	CHECK(cache.CreatePipelines(&pool));
+	CHECK(cache.IsReady(first) && cache.IsReady(last));
+	CHECK(!cache.IsReady(later));
+	CHECK(cache.GetStats().Deferred == 1);
+
+	backend.Release();
+	CHECK(cache.Wait(later));
+	CHECK(cache.IsReady(later));
+	CHECK(cache.GetStats().Created == 3);
+}
+
+TEST(PipelineCache, WithoutAPoolWaitCreatesDeferredPipelines)
+{
+	StubPipelineBackend backend;
+	PipelineCache cache(backend);
+
+	bool added = false;
+	uint32_t now = cache.Request(MakeKey(1), false, added);
+	uint32_t later = cache.Request(MakeKey(2), true, added);
+
+	// Requested deferred, then needed on the first frame after all.
+	uint32_t promoted = cache.Request(MakeKey(3), true, added);
+	cache.Request(MakeKey(3), false, added);
+
+	CHECK(cache.CreatePipelines(nullptr));
+	CHECK(cache.IsReady(now) && cache.IsReady(promoted));
+	CHECK(!cache.IsReady(later));
+	CHECK(backend.GetCreateCount() == 2);
+
+	CHECK(cache.Wait(later));
+	CHECK(backend.GetCreateCount() == 3);
+	CHECK(cache.Wait(later));
+	CHECK(backend.GetCreateCount() == 3);
+}
+
+TEST(PipelineCache, CountsSavedPipelinesAndFailures)
+{
+	StubPipelineBackend backend;
+	backend.Saved.insert(MakeKey(1).Hash);
+	PipelineCache cache(backend);
+
+	bool added = false;
+	uint32_t saved = cache.Request(MakeKey(1), false, added);
+	uint32_t fresh = cache.Request(MakeKey(2), false, added);
+	uint32_t broken = cache.Request(MakeKey(3), true, added);
+	backend.Fails.insert(broken);
+
+	// A deferred failure doesn't fail the first frame; its Wait reports it.
+	ThreadPool pool(2);
+	CHECK(cache.CreatePipelines(&pool));
+	CHECK(cache.Wait(saved) && cache.Wait(fresh));
+	CHECK(!cache.Wait(broken));
+
+	PipelineCacheStats stats = cache.GetStats();
+	CHECK(stats.Loaded == 1);
+	CHECK(stats.Created == 1);
+	CHECK(stats.Failed == 1);
+
+	// One that isn't deferred does.
+	uint32_t needed = cache.Request(MakeKey(4), false, added);
+	backend.Fails.insert(needed);
+	CHECK(!cache.CreatePipelines(&pool));
+	CHECK(!cache.IsReady(needed));
+}
+
+TEST(PipelineCache, WaitRethrowsWhatTheBackendThrew)
+{
+	StubPipelineBackend backend;
+	PipelineCache cache(backend);
+
+	bool added = false;
+	uint32_t pipeline = cache.Request(MakeKey(1), true, added);
+	backend.Throws.insert(pipeline);
+
+	ThreadPool pool(1);
+	CHECK(cache.CreatePipelines(&pool));
+
+	bool threw = false;
+	try
+	{
+		cache.Wait(pipeline);
+	}
+	catch(const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK(!cache.IsReady(pipeline));
+	CHECK(cache.GetStats().Failed == 1);
+}
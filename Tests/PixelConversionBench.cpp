@@ -0,0 +1,98 @@
+//***************************************************************************************
+// PixelConversionBench.cpp
+//
+// CommonBench PixelConversion [size]
+// Converts a size x size legacy texture (1024 by default) of a few representative layouts
+// to RGBA8 with each path on the calling thread, and with the best path on a ThreadPool,
+// and prints the megapixels per second of each.  Every path has to match the scalar one.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSTestFiles.h"
+#include "PixelFormatConverter.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct BenchLayout
+	{
+		const char* Name;
+		uint32_t Flags;
+		uint32_t BitCount;
+		uint32_t Masks[4];
+	};
+
+	// One of each kernel: byte shuffles, packed 16-bit, packed 8-bit and luminance.
+	const BenchLayout gLayouts[] =
+	{
+		{ "R8G8B8",   DDS_RGB,       24, { 0xff0000, 0x00ff00, 0x0000ff, 0 } },
+		{ "X8B8G8R8", DDS_RGB,       32, { 0x0000ff, 0x00ff00, 0xff0000, 0 } },
+		{ "B5G6R5",   DDS_RGB,       16, { 0xf800, 0x07e0, 0x001f, 0 } },
+		{ "A8R3G3B2", DDS_RGB,       16, { 0x00e0, 0x001c, 0x0003, 0xff00 } },
+		{ "R3G3B2",   DDS_RGB,        8, { 0xe0, 0x1c, 0x03, 0 } },
+		{ "A8L8",     DDS_LUMINANCE, 16, { 0x00ff, 0, 0, 0xff00 } }
+	};
+
+	// The best of a few conversions, in MP/s; 0 if it failed or differs from reference.
+	double Measure(const std::vector<uint8_t>& file, PixelConvertPath path, ThreadPool* pool,
+		const std::vector<uint8_t>* reference, std::vector<uint8_t>& output)
+	{
+		PixelConvertOptions options;
+		options.ExpandPacked16 = true;
+		options.Path = path;
+
+		double best = 0.0;
+		for(int pass = 0; pass < 3; ++pass)
+		{
+			PixelConvertStats stats;
+			if(ConvertLegacyDDS(file.data(), file.size(), options, pool, output, stats) != DDS_RESULT_OK)
+				return 0.0;
+			best = std::max(best, stats.MegapixelsPerSecond);
+		}
+		return reference == nullptr || output == *reference ? best : 0.0;
+	}
+}
+
+BENCHMARK(PixelConversion)
+{
+	uint32_t size = args.empty() ? 1024 : (uint32_t)std::max(std::atoi(args[0].c_str()), 1);
+
+	ThreadPool pool;
+	std::printf("%ux%u, SSE resolves to %s, AVX2 to %s, %u worker threads\n", size, size,
+		GetPixelConvertPathName(GetPixelConvertPath(PixelConvertPath::SSE)),
+		GetPixelConvertPathName(GetPixelConvertPath(PixelConvertPath::AVX2)), pool.GetThreadCount());
+	std::printf("%10s %12s %12s %12s %12s\n", "layout", "scalar MP/s", "SSE MP/s", "AVX2 MP/s", "pool MP/s");
+
+	int failures = 0;
+	for(const BenchLayout& layout : gLayouts)
+	{
+		DDS_PIXELFORMAT ddpf = {};
+		ddpf.flags = layout.Flags | (layout.Masks[3] != 0 ? DDS_ALPHA : 0);
+		ddpf.RGBBitCount = layout.BitCount;
+		ddpf.RBitMask = layout.Masks[0];
+		ddpf.GBitMask = layout.Masks[1];
+		ddpf.BBitMask = layout.Masks[2];
+		ddpf.ABitMask = layout.Masks[3];
+		std::vector<uint8_t> file = MakeLegacyDDSFile(ddpf, size, size, 1, 1, false, 40);
+
+		std::vector<uint8_t> reference;
+		std::vector<uint8_t> output;
+		double scalar = Measure(file, PixelConvertPath::Scalar, nullptr, nullptr, reference);
+		double sse = Measure(file, PixelConvertPath::SSE, nullptr, &reference, output);
+		double avx2 = Measure(file, PixelConvertPath::AVX2, nullptr, &reference, output);
+		double pooled = Measure(file, PixelConvertPath::Best, &pool, &reference, output);
+
+		if(scalar == 0.0 || sse == 0.0 || avx2 == 0.0 || pooled == 0.0)
+			failures++;
+
+		std::printf("%10s %12.1f %12.1f %12.1f %12.1f\n", layout.Name, scalar, sse, avx2, pooled);
+	}
+	return failures;
+}
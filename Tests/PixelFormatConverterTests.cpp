@@ -0,0 +1,191 @@
+//***************************************************************************************
+// PixelFormatConverterTests.cpp
+//
+// Converts legacy files of every layout with every path and checks the texels against a
+// reference written from the channel masks, so the SIMD paths and the scalar one are
+// both held to round(c*255/max).
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSTestFiles.h"
+#include "PixelFormatConverter.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct TestLayout
+	{
+		const char* Name;
+		uint32_t Flags;
+		uint32_t BitCount;
+		uint32_t Masks[4];
+	};
+
+	const TestLayout gLayouts[] =
+	{
+		{ "R8G8B8",   DDS_RGB,       24, { 0xff0000, 0x00ff00, 0x0000ff, 0 } },
+		{ "B8G8R8",   DDS_RGB,       24, { 0x0000ff, 0x00ff00, 0xff0000, 0 } },
+		{ "X8B8G8R8", DDS_RGB,       32, { 0x0000ff, 0x00ff00, 0xff0000, 0 } },
+		{ "X1R5G5B5", DDS_RGB,       16, { 0x7c00, 0x03e0, 0x001f, 0 } },
+		{ "X4R4G4B4", DDS_RGB,       16, { 0x0f00, 0x00f0, 0x000f, 0 } },
+		{ "A8R3G3B2", DDS_RGB,       16, { 0x00e0, 0x001c, 0x0003, 0xff00 } },
+		{ "R3G3B2",   DDS_RGB,        8, { 0xe0, 0x1c, 0x03, 0 } },
+		{ "A4L4",     DDS_LUMINANCE,  8, { 0x0f, 0, 0, 0xf0 } },
+		{ "B5G6R5",   DDS_RGB,       16, { 0xf800, 0x07e0, 0x001f, 0 } },
+		{ "B5G5R5A1", DDS_RGB,       16, { 0x7c00, 0x03e0, 0x001f, 0x8000 } },
+		{ "B4G4R4A4", DDS_RGB,       16, { 0x0f00, 0x00f0, 0x000f, 0xf000 } },
+		{ "L8",       DDS_LUMINANCE,  8, { 0xff, 0, 0, 0 } },
+		{ "A8L8",     DDS_LUMINANCE, 16, { 0x00ff, 0, 0, 0xff00 } }
+	};
+
+	std::vector<uint8_t> MakeLegacyFile(const TestLayout& layout, uint32_t width, uint32_t height,
+		uint32_t depth, uint32_t mipCount, bool cubeMap, uint32_t seed)
+	{
+		DDS_PIXELFORMAT ddpf = {};
+		ddpf.flags = layout.Flags | (layout.Masks[3] != 0 ? DDS_ALPHA : 0);
+		ddpf.RGBBitCount = layout.BitCount;
+		ddpf.RBitMask = layout.Masks[0];
+		ddpf.GBitMask = layout.Masks[1];
+		ddpf.BBitMask = layout.Masks[2];
+		ddpf.ABitMask = layout.Masks[3];
+		return MakeLegacyDDSFile(ddpf, width, height, depth, mipCount, cubeMap, seed);
+	}
+
+	uint8_t Expand(uint32_t texel, uint32_t mask)
+	{
+		uint32_t shift = 0;
+		while(((mask >> shift) & 1) == 0)
+			++shift;
+		uint32_t max = mask >> shift;
+		uint32_t value = (texel & mask) >> shift;
+		return (uint8_t)((value * 255 + max / 2) / max);
+	}
+
+	// What every path has to write for the file's texels.
+	std::vector<uint8_t> Reference(const TestLayout& layout, const std::vector<uint8_t>& file)
+	{
+		const uint32_t bytes = layout.BitCount / 8;
+		const uint8_t* src = file.data() + sizeof(uint32_t) + sizeof(DDS_HEADER);
+		size_t texels = (file.size() - sizeof(uint32_t) - sizeof(DDS_HEADER)) / bytes;
+
+		std::vector<uint8_t> rgba(texels * 4);
+		for(size_t i = 0; i < texels; ++i)
+		{
+			uint32_t texel = 0;
+			std::memcpy(&texel, src + i * bytes, bytes);
+
+			uint8_t* dst = &rgba[i * 4];
+			for(int c = 0; c < 3; ++c)
+			{
+				uint32_t mask = layout.Flags == DDS_LUMINANCE ? layout.Masks[0] : layout.Masks[c];
+				dst[c] = Expand(texel, mask);
+			}
+			dst[3] = layout.Masks[3] != 0 ? Expand(texel, layout.Masks[3]) : 255;
+		}
+		return rgba;
+	}
+
+	PixelConvertOptions AllLayouts(PixelConvertPath path)
+	{
+		PixelConvertOptions options;
+		options.ExpandPacked16 = true;
+		options.ExpandLuminance = true;
+		options.Path = path;
+		return options;
+	}
+}
+
+TEST(PixelFormatConverter, EveryPathMatchesTheMasks)
+{
+	ThreadPool pool;
+	uint32_t seed = 40;
+	for(const TestLayout& layout : gLayouts)
+	{
+		// Widths that leave partial vectors at the end of every row.
+		std::vector<uint8_t> file = MakeLegacyFile(layout, 37, 19, 1, 4, false, seed++);
+		std::vector<uint8_t> expected = Reference(layout, file);
+
+		for(PixelConvertPath path : { PixelConvertPath::Scalar, PixelConvertPath::SSE, PixelConvertPath::AVX2 })
+		{
+			for(ThreadPool* p : { (ThreadPool*)nullptr, &pool })
+			{
+				std::vector<uint8_t> output;
+				PixelConvertStats stats;
+				CHECK(ConvertLegacyDDS(file.data(), file.size(), AllLayouts(path), p, output, stats) == DDS_RESULT_OK);
+				CHECK(std::strcmp(stats.SourceLayout, layout.Name) == 0);
+				CHECK(stats.Path == GetPixelConvertPath(path));
+
+				DDSTextureDesc desc;
+				CHECK(ParseDDSTexture(output.data(), output.size(), desc) == DDS_RESULT_OK);
+				CHECK(desc.format == DXGI_FORMAT_R8G8B8A8_UNORM);
+				CHECK(desc.width == 37 && desc.height == 19 && desc.mipCount == 4);
+				CHECK(output.size() == DDS_DX10_HEADERS_SIZE + expected.size() &&
+					std::memcmp(output.data() + DDS_DX10_HEADERS_SIZE, expected.data(), expected.size()) == 0);
+			}
+		}
+	}
+}
+
+TEST(PixelFormatConverter, KeepsCubeFacesAndVolumeSlices)
+{
+	const TestLayout& layout = gLayouts[0];
+
+	std::vector<uint8_t> cube = MakeLegacyFile(layout, 16, 16, 1, 5, true, 1);
+	std::vector<uint8_t> output;
+	PixelConvertStats stats;
+	CHECK(ConvertLegacyDDS(cube.data(), cube.size(), AllLayouts(PixelConvertPath::Best), nullptr, output, stats) == DDS_RESULT_OK);
+
+	DDSTextureDesc desc;
+	CHECK(ParseDDSTexture(output.data(), output.size(), desc) == DDS_RESULT_OK);
+	CHECK(desc.isCubeMap && desc.arraySize == 6 && desc.mipCount == 5);
+	std::vector<uint8_t> expected = Reference(layout, cube);
+	CHECK(output.size() == DDS_DX10_HEADERS_SIZE + expected.size());
+
+	std::vector<uint8_t> volume = MakeLegacyFile(layout, 8, 8, 4, 3, false, 2);
+	CHECK(ConvertLegacyDDS(volume.data(), volume.size(), AllLayouts(PixelConvertPath::Best), nullptr, output, stats) == DDS_RESULT_OK);
+	CHECK(ParseDDSTexture(output.data(), output.size(), desc) == DDS_RESULT_OK);
+	CHECK(desc.dimension == DDS_DIMENSION_TEXTURE3D && desc.depth == 4 && desc.mipCount == 3);
+	expected = Reference(layout, volume);
+	CHECK(output.size() == DDS_DX10_HEADERS_SIZE + expected.size() &&
+		std::memcmp(output.data() + DDS_DX10_HEADERS_SIZE, expected.data(), expected.size()) == 0);
+}
+
+TEST(PixelFormatConverter, LeavesWhatTheOptionsExclude)
+{
+	std::vector<uint8_t> output;
+	PixelConvertStats stats;
+
+	PixelConvertOptions options;
+	options.ExpandPacked16 = false;
+	options.ExpandLuminance = false;
+	for(const TestLayout& layout : gLayouts)
+	{
+		std::string name = layout.Name;
+		bool optional = name == "B5G6R5" || name == "B5G5R5A1" || name == "B4G4R4A4" || name == "L8" || name == "A8L8";
+
+		std::vector<uint8_t> file = MakeLegacyFile(layout, 4, 4, 1, 1, false, 3);
+		DDS_RESULT result = ConvertLegacyDDS(file.data(), file.size(), options, nullptr, output, stats);
+		CHECK(result == (optional ? DDS_RESULT_NOT_SUPPORTED : DDS_RESULT_OK));
+	}
+
+	// 32-bit RGBA loads as it is.
+	TestLayout rgba = { "A8B8G8R8", DDS_RGB, 32, { 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 } };
+	std::vector<uint8_t> file = MakeLegacyFile(rgba, 4, 4, 1, 1, false, 4);
+	CHECK(ConvertLegacyDDS(file.data(), file.size(), options, nullptr, output, stats) == DDS_RESULT_NOT_SUPPORTED);
+
+	// Missing its last texel.
+	file = MakeLegacyFile(gLayouts[0], 4, 4, 1, 3, false, 5);
+	file.pop_back();
+	CHECK(ConvertLegacyDDS(file.data(), file.size(), options, nullptr, output, stats) == DDS_RESULT_TRUNCATED);
+
+	CHECK(ConvertLegacyDDS(nullptr, 0, options, nullptr, output, stats) == DDS_RESULT_INVALID_ARG);
+	CHECK(ConvertLegacyDDS(file.data(), 8, options, nullptr, output, stats) == DDS_RESULT_TOO_SMALL);
+	CHECK(output.empty());
+}
@@ -0,0 +1,65 @@
+//***************************************************************************************
+// ProcessMemory.cpp
+//***************************************************************************************
+
+#include "ProcessMemory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+#ifdef _WIN32
+
+uint64_t GetResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+}
+
+uint64_t GetPeakResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+}
+
+#else
+
+uint64_t GetResidentBytes()
+{
+	// The second field of statm is the resident set in pages.
+	FILE* file = std::fopen("/proc/self/statm", "r");
+	if(file == nullptr)
+		return 0;
+
+	unsigned long long size = 0;
+	unsigned long long resident = 0;
+	int fields = std::fscanf(file, "%llu %llu", &size, &resident);
+	std::fclose(file);
+
+	return fields == 2 ? resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+uint64_t GetPeakResidentBytes()
+{
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	// Kilobytes on Linux, bytes on macOS.
+#ifdef __APPLE__
+	return (uint64_t)usage.ru_maxrss;
+#else
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+#endif
@@ -0,0 +1,17 @@
+//***************************************************************************************
+// ProcessMemory.h
+//
+// The process's resident memory, for the benchmarks that compare how much memory two
+// ways of doing the same thing need: the working set on Windows, the resident set
+// elsewhere.  Mapped file pages count once they've been touched.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Resident bytes now, or 0 if the platform can't say.
+uint64_t GetResidentBytes();
+
+// The most the process has had resident so far, or 0 if the platform can't say.
+uint64_t GetPeakResidentBytes();
@@ -0,0 +1,327 @@
+//***************************************************************************************
+// RenderGraphTests.cpp
+//
+// Compiles small frames shaped like the demo's and checks the passes kept, the barriers
+// placed before each and the transient heap layout, then runs them through a recorder
+// that logs what a command list would see.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "RenderGraph.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	RenderBarrier MakeTransition(RenderGraph::ResourceId resource, RenderStates before, RenderStates after)
+	{
+		RenderBarrier b;
+		b.Type = RenderBarrier::Transition;
+		b.Resource = resource;
+		b.Before = before;
+		b.After = after;
+		return b;
+	}
+
+	RenderBarrier MakeUAVBarrier(RenderGraph::ResourceId resource)
+	{
+		RenderBarrier b;
+		b.Type = RenderBarrier::UnorderedAccess;
+		b.Resource = resource;
+		return b;
+	}
+
+	RenderBarrier MakeAliasing(RenderGraph::ResourceId resource, RenderGraph::ResourceId aliased)
+	{
+		RenderBarrier b;
+		b.Type = RenderBarrier::Aliasing;
+		b.Resource = resource;
+		b.AliasedResource = aliased;
+		return b;
+	}
+
+	bool Equal(const std::vector<RenderBarrier>& a, const std::vector<RenderBarrier>& b)
+	{
+		if(a.size() != b.size())
+			return false;
+		for(size_t i = 0; i < a.size(); ++i)
+		{
+			if(a[i].Type != b[i].Type || a[i].Resource != b[i].Resource || a[i].Before != b[i].Before ||
+				a[i].After != b[i].After || a[i].AliasedResource != b[i].AliasedResource)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST(RenderGraph, BackBufferFrame)
+{
+	RenderGraph graph;
+	std::vector<std::string> log;
+
+	RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+	RenderGraph::ResourceId depth = graph.ImportResource("DepthStencil", RenderState_DepthWrite, RenderState_DepthWrite);
+
+	RenderGraph::PassId opaque = graph.AddPass("Opaque", [&log]() { log.push_back("Opaque"); });
+	graph.Write(opaque, backBuffer, RenderState_RenderTarget);
+	graph.Write(opaque, depth, RenderState_DepthWrite);
+	RenderGraph::PassId transparent = graph.AddPass("Transparent", [&log]() { log.push_back("Transparent"); });
+	graph.Write(transparent, backBuffer, RenderState_RenderTarget);
+	graph.Read(transparent, depth, RenderState_DepthRead);
+
+	CHECK(graph.Compile() == RenderGraphResult::Ok);
+
+	// The back buffer goes to render target once and back once; the depth buffer is
+	// returned to the state it was imported in.
+	CHECK(Equal(graph.GetBarriers(opaque), { MakeTransition(backBuffer, RenderState_Present, RenderState_RenderTarget) }));
+	CHECK(Equal(graph.GetBarriers(transparent), { MakeTransition(depth, RenderState_DepthWrite, RenderState_DepthRead) }));
+	CHECK(Equal(graph.GetFinalBarriers(), { MakeTransition(backBuffer, RenderState_RenderTarget, RenderState_Present),
+		MakeTransition(depth, RenderState_DepthRead, RenderState_DepthWrite) }));
+	CHECK(graph.GetStats().BarrierCount == 4);
+	CHECK(graph.GetStats().BatchCount == 3);
+
+	graph.Execute([&log](const std::vector<RenderBarrier>& barriers, const std::vector<RenderGraph::ResourceId>&)
+	{
+		log.push_back("barriers " + std::to_string(barriers.size()));
+	});
+	std::vector<std::string> expected = { "barriers 1", "Opaque", "barriers 1", "Transparent", "barriers 2" };
+	CHECK(log == expected);
+}
+
+TEST(RenderGraph, CullsPassesNothingNeeds)
+{
+	RenderGraph graph;
+	RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+	RenderGraph::ResourceId shadowMap = graph.CreateTransient("ShadowMap", 1 << 20, 65536);
+	RenderGraph::ResourceId debugView = graph.CreateTransient("DebugView", 1 << 20, 65536);
+	RenderGraph::ResourceId overlay = graph.CreateTransient("Overlay", 1 << 20, 65536);
+	RenderGraph::ResourceId counters = graph.CreateTransient("Counters", 256, 256);
+
+	std::vector<std::string> ran;
+	auto record = [&ran](const char* name) { return [&ran, name]() { ran.push_back(name); }; };
+
+	RenderGraph::PassId shadow = graph.AddPass("Shadow", record("Shadow"));
+	graph.Write(shadow, shadowMap, RenderState_DepthWrite);
+
+	// A chain that ends in something nobody reads: both go.
+	RenderGraph::PassId debug = graph.AddPass("Debug", record("Debug"));
+	graph.Read(debug, shadowMap, RenderState_PixelShaderResource);
+	graph.Write(debug, debugView, RenderState_RenderTarget);
+	RenderGraph::PassId debugOverlay = graph.AddPass("DebugOverlay", record("DebugOverlay"));
+	graph.Read(debugOverlay, debugView, RenderState_PixelShaderResource);
+	graph.Write(debugOverlay, overlay, RenderState_RenderTarget);
+
+	// Writes only a transient no one reads, but is marked as having side effects.
+	RenderGraph::PassId stats = graph.AddPass("Stats", record("Stats"));
+	graph.Write(stats, counters, RenderState_UnorderedAccess);
+	graph.SetSideEffects(stats);
+
+	RenderGraph::PassId opaque = graph.AddPass("Opaque", record("Opaque"));
+	graph.Read(opaque, shadowMap, RenderState_PixelShaderResource);
+	graph.Write(opaque, backBuffer, RenderState_RenderTarget);
+
+	CHECK(graph.Compile() == RenderGraphResult::Ok);
+	CHECK(!graph.IsCulled(shadow));
+	CHECK(graph.IsCulled(debug));
+	CHECK(graph.IsCulled(debugOverlay));
+	CHECK(!graph.IsCulled(stats));
+	CHECK(!graph.IsCulled(opaque));
+	CHECK(graph.GetStats().CulledPassCount == 2);
+
+	// What only culled passes used gets no memory and no barriers.
+	CHECK(graph.IsAllocated(shadowMap));
+	CHECK(!graph.IsAllocated(debugView));
+	CHECK(!graph.IsAllocated(overlay));
+	CHECK(graph.IsAllocated(counters));
+	CHECK(graph.GetStats().TransientCount == 2);
+	CHECK(graph.GetBarriers(debug).empty());
+
+	graph.Execute([](const std::vector<RenderBarrier>&, const std::vector<RenderGraph::ResourceId>&) {});
+	std::vector<std::string> expected = { "Shadow", "Stats", "Opaque" };
+	CHECK(ran == expected);
+}
+
+TEST(RenderGraph, MergesRunsOfReads)
+{
+	RenderGraph graph;
+	RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+	RenderGraph::ResourceId shadowMap = graph.CreateTransient("ShadowMap", 4096, 4096);
+
+	RenderGraph::PassId shadow = graph.AddPass("Shadow", nullptr);
+	graph.Write(shadow, shadowMap, RenderState_DepthWrite);
+	RenderGraph::PassId cluster = graph.AddPass("LightCulling", nullptr);
+	graph.Read(cluster, shadowMap, RenderState_NonPixelShaderResource);
+	graph.SetSideEffects(cluster);
+	RenderGraph::PassId opaque = graph.AddPass("Opaque", nullptr);
+	graph.Read(opaque, shadowMap, RenderState_PixelShaderResource);
+	graph.Write(opaque, backBuffer, RenderState_RenderTarget);
+
+	CHECK(graph.Compile() == RenderGraphResult::Ok);
+
+	// Both readers are covered by the one transition before the first; the transient is
+	// created in that combined state, so the next run starts from it.
+	RenderStates read = RenderState_NonPixelShaderResource | RenderState_PixelShaderResource;
+	CHECK(graph.GetTransientCreateState(shadowMap) == read);
+	CHECK(Equal(graph.GetBarriers(shadow), { MakeTransition(shadowMap, read, RenderState_DepthWrite) }));
+	CHECK(Equal(graph.GetBarriers(cluster), { MakeTransition(shadowMap, RenderState_DepthWrite, read) }));
+	CHECK(Equal(graph.GetBarriers(opaque), { MakeTransition(backBuffer, RenderState_Present, RenderState_RenderTarget) }));
+
+	// A write in between splits the run.
+	RenderGraph::PassId redraw = graph.AddPass("ShadowAgain", nullptr);
+	graph.Write(redraw, shadowMap, RenderState_DepthWrite);
+	RenderGraph::PassId reread = graph.AddPass("Transparent", nullptr);
+	graph.Read(reread, shadowMap, RenderState_PixelShaderResource);
+	graph.Write(reread, backBuffer, RenderState_RenderTarget);
+
+	CHECK(graph.Compile() == RenderGraphResult::Ok);
+	CHECK(Equal(graph.GetBarriers(redraw), { MakeTransition(shadowMap, read, RenderState_DepthWrite) }));
+	CHECK(Equal(graph.GetBarriers(reread), { MakeTransition(shadowMap, RenderState_DepthWrite, RenderState_PixelShaderResource) }));
+}
+
+TEST(RenderGraph, UAVBarriersBetweenUnorderedWrites)
+{
+	RenderGraph graph;
+	RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+	RenderGraph::ResourceId particles = graph.ImportResource("Particles", RenderState_UnorderedAccess,
+		RenderState_UnorderedAccess);
+
+	RenderGraph::PassId simulate = graph.AddPass("Simulate", nullptr);
+	graph.Write(simulate, particles, RenderState_UnorderedAccess);
+	RenderGraph::PassId sort = graph.AddPass("Sort", nullptr);
+	graph.Write(sort, particles, RenderState_UnorderedAccess);
+	RenderGraph::PassId draw = graph.AddPass("Draw", nullptr);
+	graph.Read(draw, particles, RenderState_VertexAndConstantBuffer);
+	graph.Write(draw, backBuffer, RenderState_RenderTarget);
+	RenderGraph::PassId compact = graph.AddPass("Compact", nullptr);
+	graph.Write(compact, particles, RenderState_UnorderedAccess);
+
+	CHECK(graph.Compile() == RenderGraphResult::Ok);
+
+	// Already in the state: nothing before the first write, a UAV barrier before the
+	// second, and a transition (not a UAV barrier) after the reads.
+	CHECK(graph.GetBarriers(simulate).empty());
+	CHECK(Equal(graph.GetBarriers(sort), { MakeUAVBarrier(particles) }));
+	CHECK(Equal(graph.GetBarriers(draw), { MakeTransition(backBuffer, RenderState_Present, RenderState_RenderTarget),
+		MakeTransition(particles, RenderState_UnorderedAccess, RenderState_VertexAndConstantBuffer) }));
+	CHECK(Equal(graph.GetBarriers(compact), { MakeTransition(particles, RenderState_VertexAndConstantBuffer,
+		RenderState_UnorderedAccess) }));
+
+	// Render target writes in a row need nothing between them.
+	CHECK(Equal(graph.GetFinalBarriers(), { MakeTransition(backBuffer, RenderState_RenderTarget, RenderState_Present) }));
+}
+
+TEST(RenderGraph, AliasesTransientsThatDontOverlap)
+{
+	RenderGraph graph;
+	RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+	RenderGraph::ResourceId a = graph.CreateTransient("HDR", 1000, 256);
+	RenderGraph::ResourceId b = graph.CreateTransient("BloomDown", 600, 256);
+	RenderGraph::ResourceId c = graph.CreateTransient("BloomUp", 400, 256);
+
+	// A lives over passes 0-1, B over 1-2, C over 2-3.
+	RenderGraph::PassId scene = graph.AddPass("Scene", nullptr);
+	graph.Write(scene, a, RenderState_RenderTarget);
+	RenderGraph::PassId down = graph.AddPass("Downsample", nullptr);
+	graph.Read(down, a, RenderState_PixelShaderResource);
+	graph.Write(down, b, RenderState_RenderTarget);
+	RenderGraph::PassId up = graph.AddPass("Upsample", nullptr);
+	graph.Read(up, b, RenderState_PixelShaderResource);
+	graph.Write(up, c, RenderState_RenderTarget);
+	RenderGraph::PassId tonemap = graph.AddPass("Tonemap", nullptr);
+	graph.Read(tonemap, c, RenderState_PixelShaderResource);
+	graph.Write(tonemap, backBuffer, RenderState_RenderTarget);
+
+	CHECK(graph.Compile() == RenderGraphResult::Ok);
+
+	// Largest first: A at 0, B after A as they're alive together, C back at 0 as A is done.
+	CHECK(graph.GetTransientOffset(a) == 0);
+	CHECK(graph.GetTransientOffset(b) == 1024);
+	CHECK(graph.GetTransientOffset(c) == 0);
+	CHECK(graph.GetTransientHeapSize() == 1624);
+	CHECK(graph.GetTransientHeapAlignment() == 256);
+	CHECK(graph.GetStats().UnaliasedSize == 2192);
+
+	CHECK(graph.GetActivations(scene) == std::vector<RenderGraph::ResourceId>({ a }));
+	CHECK(graph.GetActivations(down) == std::vector<RenderGraph::ResourceId>({ b }));
+	CHECK(graph.GetActivations(up) == std::vector<RenderGraph::ResourceId>({ c }));
+
+	// C takes A's memory, the aliasing barrier ahead of the transitions in its batch.
+	// A takes it back from C in the next run; B shares with nothing.
+	RenderStates read = RenderState_PixelShaderResource;
+	CHECK(Equal(graph.GetBarriers(up), { MakeAliasing(c, a), MakeTransition(b, RenderState_RenderTarget, read),
+		MakeTransition(c, read, RenderState_RenderTarget) }));
+	CHECK(Equal(graph.GetBarriers(scene), { MakeAliasing(a, c), MakeTransition(a, read, RenderState_RenderTarget) }));
+	CHECK(Equal(graph.GetBarriers(down), { MakeTransition(a, RenderState_RenderTarget, read),
+		MakeTransition(b, read, RenderState_RenderTarget) }));
+
+	// A and C share memory; B, alive alongside both, overlaps neither.
+	CHECK(graph.GetTransientOffset(a) + 1000 <= graph.GetTransientOffset(b));
+	CHECK(graph.GetTransientOffset(c) + 400 <= graph.GetTransientOffset(b));
+}
+
+TEST(RenderGraph, RejectsBadDeclarations)
+{
+	{
+		RenderGraph graph;
+		RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+		RenderGraph::PassId pass = graph.AddPass("Opaque", nullptr);
+		graph.Read(pass, backBuffer, RenderState_RenderTarget);
+		CHECK(graph.Compile() == RenderGraphResult::InvalidState);
+	}
+	{
+		RenderGraph graph;
+		RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+		RenderGraph::PassId pass = graph.AddPass("Opaque", nullptr);
+		graph.Write(pass, backBuffer, (RenderState)(RenderState_RenderTarget | RenderState_CopyDest));
+		CHECK(graph.Compile() == RenderGraphResult::InvalidState);
+	}
+	{
+		RenderGraph graph;
+		RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+		RenderGraph::PassId pass = graph.AddPass("Opaque", nullptr);
+		graph.Write(pass, backBuffer, RenderState_PixelShaderResource);
+		CHECK(graph.Compile() == RenderGraphResult::InvalidState);
+
+		RenderGraph other;
+		backBuffer = other.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+		pass = other.AddPass("Opaque", nullptr);
+		other.Read(pass, backBuffer, 0);
+		CHECK(other.Compile() == RenderGraphResult::InvalidState);
+	}
+	{
+		// Reading and writing the same resource in one pass.
+		RenderGraph graph;
+		RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+		RenderGraph::PassId pass = graph.AddPass("Opaque", nullptr);
+		graph.Read(pass, backBuffer, RenderState_PixelShaderResource);
+		graph.Write(pass, backBuffer, RenderState_RenderTarget);
+		CHECK(graph.Compile() == RenderGraphResult::ConflictingAccess);
+	}
+	{
+		// A transient read before anything wrote it.  An imported one is fine.
+		RenderGraph graph;
+		RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+		RenderGraph::ResourceId history = graph.CreateTransient("History", 4096, 4096);
+		RenderGraph::PassId pass = graph.AddPass("Resolve", nullptr);
+		graph.Read(pass, history, RenderState_PixelShaderResource);
+		graph.Write(pass, backBuffer, RenderState_RenderTarget);
+		RenderGraph::PassId store = graph.AddPass("Store", nullptr);
+		graph.Write(store, history, RenderState_CopyDest);
+		graph.SetSideEffects(store);
+		CHECK(graph.Compile() == RenderGraphResult::ReadBeforeWrite);
+	}
+	{
+		RenderGraph graph;
+		RenderGraph::ResourceId backBuffer = graph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+		RenderGraph::ResourceId texture = graph.ImportResource("Texture", RenderState_PixelShaderResource,
+			RenderState_PixelShaderResource);
+		RenderGraph::PassId pass = graph.AddPass("Opaque", nullptr);
+		graph.Read(pass, texture, RenderState_PixelShaderResource);
+		graph.Write(pass, backBuffer, RenderState_RenderTarget);
+		CHECK(graph.Compile() == RenderGraphResult::Ok);
+		CHECK(graph.GetStats().BarrierCount == 2);
+	}
+}
@@ -0,0 +1,284 @@
+//***************************************************************************************
+// ShaderCacheTests.cpp
+//
+// Drives ShaderCache with a stub backend: the "files" are strings in memory, the
+// preprocessor pastes in #include lines, and the compiler turns the source it was
+// given into bytes and counts how often it ran.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "ShaderCache.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+	class StubShaderBackend : public ShaderCacheBackend
+	{
+	public:
+		std::string GetCompilerId()override
+		{
+			return CompilerId;
+		}
+
+		// Expands each #include "name" line with that file; unknown files fail.
+		bool Preprocess(const ShaderCompileRequest& request, std::string& source)override
+		{
+			return Expand(request.Filename, source, 0);
+		}
+
+		bool Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)override
+		{
+			Compiles++;
+			std::string source;
+			if(!Expand(request.Filename, source, 0) || source.find("error") != std::string::npos)
+				return false;
+
+			std::string text = request.EntryPoint + "/" + request.Target + ":" + source;
+			bytecode.assign(text.begin(), text.end());
+			return true;
+		}
+
+		bool Load(const std::wstring& path, std::vector<uint8_t>& data)override
+		{
+			auto it = Disk.find(path);
+			if(it == Disk.end())
+				return false;
+			data = it->second;
+			return true;
+		}
+
+		bool Store(const std::wstring& path, const std::vector<uint8_t>& data)override
+		{
+			Stores++;
+			Disk[path] = data;
+			return true;
+		}
+
+		std::string CompilerId = "stub 1.0";
+		std::map<std::wstring, std::string> Sources;
+		std::map<std::wstring, std::vector<uint8_t>> Disk;
+		int Compiles = 0;
+		int Stores = 0;
+
+	private:
+		bool Expand(const std::wstring& filename, std::string& out, int depth)
+		{
+			auto it = Sources.find(filename);
+			if(it == Sources.end() || depth > 8)
+				return false;
+
+			const std::string& text = it->second;
+			size_t start = 0;
+			while(start < text.size())
+			{
+				size_t end = text.find('\n', start);
+				if(end == std::string::npos)
+					end = text.size();
+
+				std::string line = text.substr(start, end - start);
+				const std::string include = "#include \"";
+				if(line.compare(0, include.size(), include) == 0)
+				{
+					std::string name = line.substr(include.size(), line.size() - include.size() - 1);
+					if(!Expand(std::wstring(name.begin(), name.end()), out, depth + 1))
+						return false;
+				}
+				else
+				{
+					out += line;
+					out += '\n';
+				}
+				start = end + 1;
+			}
+			return true;
+		}
+	};
+
+	void AddDemoSources(StubShaderBackend& backend)
+	{
+		backend.Sources[L"color.hlsl"] = "#include \"LightingUtil.hlsl\"\nfloat4 PS() { return Light(); }";
+		backend.Sources[L"LightingUtil.hlsl"] = "float4 Light() { return 1; }";
+	}
+
+	ShaderCompileRequest MakeRequest()
+	{
+		ShaderCompileRequest request;
+		request.Filename = L"color.hlsl";
+		request.Defines = { { "ALPHA_TEST", "1" }, { "FOG", "1" } };
+		request.EntryPoint = "PS";
+		request.Target = "ps_5_1";
+		request.Flags = 1;
+		return request;
+	}
+}
+
+TEST(ShaderCache, KeyIsStableAcrossRuns)
+{
+	StubShaderBackend backend;
+	AddDemoSources(backend);
+	std::string source;
+	CHECK(backend.Preprocess(MakeRequest(), source));
+
+	// Entries written by an earlier build have to keep being found, so the key of a
+	// fixed request may never change: not with the process, the platform or the compiler.
+	ShaderCacheKey key = ShaderCache::ComputeKey(MakeRequest(), source, "stub 1.0");
+	CHECK(key.Name == 0xf01150c0d1597e82ull);
+	CHECK(key.Check == 0x0537404be6fbcf75ull);
+
+	ShaderCache cache(backend, L"cache");
+	CHECK(cache.GetEntryPath(key) == L"cache/f01150c0d1597e82.cso");
+}
+
+TEST(ShaderCache, SecondRunLoadsWhatTheFirstCompiled)
+{
+	StubShaderBackend backend;
+	AddDemoSources(backend);
+
+	std::vector<uint8_t> compiled;
+	{
+		ShaderCache cache(backend, L"cache");
+		CHECK(cache.GetBytecode(MakeRequest(), compiled));
+		CHECK(cache.GetStats().Misses == 1);
+		CHECK(backend.Compiles == 1);
+		CHECK(backend.Disk.size() == 1);
+	}
+
+	ShaderCache cache(backend, L"cache");
+	std::vector<uint8_t> loaded;
+	CHECK(cache.GetBytecode(MakeRequest(), loaded));
+	CHECK(loaded == compiled);
+	CHECK(cache.GetStats().Hits == 1);
+	CHECK(cache.GetStats().Misses == 0);
+	CHECK(backend.Compiles == 1);
+}
+
+TEST(ShaderCache, IdenticalRequestsShareAnEntry)
+{
+	StubShaderBackend backend;
+	AddDemoSources(backend);
+	ShaderCache cache(backend, L"cache");
+
+	std::vector<uint8_t> bytecode;
+	for(int i = 0; i < 4; ++i)
+		CHECK(cache.GetBytecode(MakeRequest(), bytecode));
+
+	CHECK(backend.Compiles == 1);
+	CHECK(backend.Stores == 1);
+	CHECK(cache.GetStats().Hits == 3);
+}
+
+TEST(ShaderCache, EditingAnIncludeInvalidates)
+{
+	StubShaderBackend backend;
+	AddDemoSources(backend);
+	ShaderCache cache(backend, L"cache");
+
+	std::vector<uint8_t> before;
+	CHECK(cache.GetBytecode(MakeRequest(), before));
+
+	// Only the included file changes, yet the shader is compiled again.
+	backend.Sources[L"LightingUtil.hlsl"] = "float4 Light() { return 0.5; }";
+	std::vector<uint8_t> after;
+	CHECK(cache.GetBytecode(MakeRequest(), after));
+	CHECK(backend.Compiles == 2);
+	CHECK(after != before);
+	CHECK(backend.Disk.size() == 2);
+
+	// Undoing the edit finds the first entry again.
+	backend.Sources[L"LightingUtil.hlsl"] = "float4 Light() { return 1; }";
+	std::vector<uint8_t> undone;
+	CHECK(cache.GetBytecode(MakeRequest(), undone));
+	CHECK(undone == before);
+	CHECK(backend.Compiles == 2);
+}
+
+TEST(ShaderCache, EveryRequestFieldIsInTheKey)
+{
+	StubShaderBackend backend;
+	AddDemoSources(backend);
+	std::string source;
+	CHECK(backend.Preprocess(MakeRequest(), source));
+
+	ShaderCompileRequest base = MakeRequest();
+	std::vector<ShaderCompileRequest> variants(6, base);
+	variants[1].Defines.pop_back();
+	variants[2].Defines[1].second = "0";
+	variants[3].EntryPoint = "VS";
+	variants[4].Target = "ps_5_0";
+	variants[5].Flags = 0;
+
+	std::vector<uint64_t> names;
+	for(const auto& request : variants)
+		names.push_back(ShaderCache::ComputeKey(request, source, "stub 1.0").Name);
+	names.push_back(ShaderCache::ComputeKey(base, source, "stub 2.0").Name);
+	names.push_back(ShaderCache::ComputeKey(base, source + " ", "stub 1.0").Name);
+
+	for(size_t i = 0; i < names.size(); ++i)
+	{
+		for(size_t j = i + 1; j < names.size(); ++j)
+			CHECK(names[i] != names[j]);
+	}
+
+	// A define's name and value can't run together into another define.
+	ShaderCompileRequest joined = base;
+	joined.Defines = { { "AB", "C" } };
+	ShaderCompileRequest split = base;
+	split.Defines = { { "A", "BC" } };
+	CHECK(ShaderCache::ComputeKey(joined, source, "stub 1.0").Name != ShaderCache::ComputeKey(split, source, "stub 1.0").Name);
+}
+
+TEST(ShaderCache, RewritesEntriesThatDontMatch)
+{
+	StubShaderBackend backend;
+	AddDemoSources(backend);
+	ShaderCache cache(backend, L"cache");
+
+	std::vector<uint8_t> compiled;
+	CHECK(cache.GetBytecode(MakeRequest(), compiled));
+
+	// Corrupt the stored check hash, then truncate the bytecode.
+	for(int damage = 0; damage < 2; ++damage)
+	{
+		std::vector<uint8_t>& entry = backend.Disk.begin()->second;
+		if(damage == 0)
+			entry[8] ^= 0xff;
+		else
+			entry.pop_back();
+
+		std::vector<uint8_t> bytecode;
+		CHECK(cache.GetBytecode(MakeRequest(), bytecode));
+		CHECK(bytecode == compiled);
+	}
+	CHECK(cache.GetStats().Rejected == 2);
+	CHECK(backend.Compiles == 3);
+
+	// The rewritten entry is good again.
+	std::vector<uint8_t> bytecode;
+	CHECK(cache.GetBytecode(MakeRequest(), bytecode));
+	CHECK(cache.GetStats().Hits == 1);
+}
+
+TEST(ShaderCache, FailuresAreNeverCached)
+{
+	StubShaderBackend backend;
+	AddDemoSources(backend);
+	ShaderCache cache(backend, L"cache");
+
+	// A missing include: compiled without the cache so the compiler reports it.
+	backend.Sources.erase(L"LightingUtil.hlsl");
+	std::vector<uint8_t> bytecode;
+	CHECK(!cache.GetBytecode(MakeRequest(), bytecode));
+	CHECK(cache.GetStats().Uncached == 1);
+	CHECK(backend.Compiles == 1);
+
+	// A compile error: a miss, and nothing is stored.
+	backend.Sources[L"LightingUtil.hlsl"] = "error";
+	CHECK(!cache.GetBytecode(MakeRequest(), bytecode));
+	CHECK(!cache.GetBytecode(MakeRequest(), bytecode));
+	CHECK(cache.GetStats().Misses == 2);
+	CHECK(backend.Compiles == 3);
+	CHECK(backend.Stores == 0);
+}
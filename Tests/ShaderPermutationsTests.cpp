@@ -0,0 +1,233 @@
+//***************************************************************************************
+// ShaderPermutationsTests.cpp
+//
+// Packs and unpacks permutation keys, and builds ShaderLibrary manifests with a stub
+// compiler that writes the request it was given out as the bytecode.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "ShaderPermutations.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// The bytecode spells out the request, less any define the stage ignores: vertex
+	// shaders don't read FOG, so their fog and fogless variants come out identical.
+	bool StubCompile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+	{
+		std::string text(request.Filename.begin(), request.Filename.end());
+		text += " " + request.EntryPoint + " " + request.Target;
+		for(const auto& define : request.Defines)
+		{
+			if(define.first == "FOG" && request.EntryPoint == "VS")
+				continue;
+			text += " " + define.first + "=" + define.second;
+		}
+		bytecode.assign(text.begin(), text.end());
+		return true;
+	}
+
+	ShaderPermutationKey MakeKey(uint32_t program, ShaderStage stage, uint32_t dirLights, bool fog, bool alphaTest)
+	{
+		ShaderPermutation permutation;
+		permutation.Program = program;
+		permutation.Stage = stage;
+		permutation.NumDirLights = dirLights;
+		permutation.Fog = fog;
+		permutation.AlphaTest = alphaTest;
+
+		ShaderPermutationKey key = 0;
+		MakePermutationKey(permutation, key);
+		return key;
+	}
+
+	// What the demo's scene needs: both programs, every stage they have, with and
+	// without fog and alpha test.
+	std::vector<ShaderPermutationKey> MakeManifest()
+	{
+		std::vector<ShaderPermutationKey> manifest;
+		for(int fog = 0; fog < 2; ++fog)
+		{
+			for(int alphaTest = 0; alphaTest < 2; ++alphaTest)
+			{
+				manifest.push_back(MakeKey(0, ShaderStage::Vertex, 3, fog != 0, alphaTest != 0));
+				manifest.push_back(MakeKey(0, ShaderStage::Pixel, 3, fog != 0, alphaTest != 0));
+				manifest.push_back(MakeKey(1, ShaderStage::Vertex, 3, fog != 0, alphaTest != 0));
+				manifest.push_back(MakeKey(1, ShaderStage::Geometry, 3, fog != 0, alphaTest != 0));
+				manifest.push_back(MakeKey(1, ShaderStage::Pixel, 3, fog != 0, alphaTest != 0));
+			}
+		}
+		return manifest;
+	}
+
+	std::string ToString(ShaderBytecodeView view)
+	{
+		return std::string(reinterpret_cast<const char*>(view.Data), view.Size);
+	}
+}
+
+TEST(ShaderPermutations, KeysRoundTrip)
+{
+	for(uint32_t program : { 0u, 1u, ShaderMaxPrograms - 1 })
+	{
+		for(ShaderStage stage : { ShaderStage::Vertex, ShaderStage::Geometry, ShaderStage::Pixel })
+		{
+			for(uint32_t lights : { 0u, 1u, 3u, ShaderMaxDirLights })
+			{
+				ShaderPermutation permutation;
+				permutation.Program = program;
+				permutation.Stage = stage;
+				permutation.NumDirLights = lights;
+				permutation.NumPointLights = ShaderMaxPointLights - lights;
+				permutation.NumSpotLights = lights * 4;
+				permutation.Fog = (lights & 1) != 0;
+				permutation.AlphaTest = program == 1;
+
+				ShaderPermutationKey key = 0;
+				CHECK(MakePermutationKey(permutation, key));
+
+				ShaderPermutation unpacked = GetPermutation(key);
+				CHECK(unpacked.Program == permutation.Program);
+				CHECK(unpacked.Stage == permutation.Stage);
+				CHECK(unpacked.NumDirLights == permutation.NumDirLights);
+				CHECK(unpacked.NumPointLights == permutation.NumPointLights);
+				CHECK(unpacked.NumSpotLights == permutation.NumSpotLights);
+				CHECK(unpacked.Fog == permutation.Fog);
+				CHECK(unpacked.AlphaTest == permutation.AlphaTest);
+			}
+		}
+	}
+
+	// Fields that don't fit their bits are refused rather than spilling into the next.
+	ShaderPermutationKey key = 0;
+	ShaderPermutation tooMany;
+	tooMany.NumDirLights = ShaderMaxDirLights + 1;
+	CHECK(!MakePermutationKey(tooMany, key));
+	tooMany = ShaderPermutation();
+	tooMany.NumPointLights = ShaderMaxPointLights + 1;
+	CHECK(!MakePermutationKey(tooMany, key));
+	tooMany = ShaderPermutation();
+	tooMany.NumSpotLights = ShaderMaxSpotLights + 1;
+	CHECK(!MakePermutationKey(tooMany, key));
+	tooMany = ShaderPermutation();
+	tooMany.Program = ShaderMaxPrograms;
+	CHECK(!MakePermutationKey(tooMany, key));
+}
+
+TEST(ShaderPermutations, RequestsNameTheVariant)
+{
+	ShaderLibrary library({ L"Shaders\\color.hlsl", L"Shaders\\TreeSprite.hlsl" }, "5_1");
+
+	ShaderCompileRequest request = library.GetCompileRequest(MakeKey(1, ShaderStage::Geometry, 3, true, false));
+	CHECK(request.Filename == L"Shaders\\TreeSprite.hlsl");
+	CHECK(request.EntryPoint == "GS");
+	CHECK(request.Target == "gs_5_1");
+
+	std::vector<std::pair<std::string, std::string>> defines = {
+		{ "NUM_DIR_LIGHTS", "3" }, { "NUM_POINT_LIGHTS", "0" }, { "NUM_SPOT_LIGHTS", "0" }, { "FOG", "1" } };
+	CHECK(request.Defines == defines);
+
+	request = library.GetCompileRequest(MakeKey(0, ShaderStage::Pixel, 1, false, true));
+	CHECK(request.Target == "ps_5_1");
+	CHECK(request.Defines.back() == std::make_pair(std::string("ALPHA_TEST"), std::string("1")));
+}
+
+TEST(ShaderPermutations, SharesIdenticalBytecode)
+{
+	ShaderLibrary library({ L"color.hlsl", L"TreeSprite.hlsl" }, "5_1");
+	std::vector<ShaderPermutationKey> manifest = MakeManifest();
+	CHECK(library.Build(manifest, StubCompile, nullptr));
+
+	// 20 variants, but the vertex shaders only differ by alpha test.
+	CHECK(library.GetStats().PermutationCount == 20);
+	CHECK(library.GetStats().UniqueCount == 16);
+
+	ShaderBytecodeView fog = library.GetBytecode(MakeKey(0, ShaderStage::Vertex, 3, true, false));
+	ShaderBytecodeView noFog = library.GetBytecode(MakeKey(0, ShaderStage::Vertex, 3, false, false));
+	CHECK(fog.Data == noFog.Data);
+
+	ShaderBytecodeView pixel = library.GetBytecode(MakeKey(0, ShaderStage::Pixel, 3, true, false));
+	CHECK(ToString(pixel) == "color.hlsl PS ps_5_1 NUM_DIR_LIGHTS=3 NUM_POINT_LIGHTS=0 NUM_SPOT_LIGHTS=0 FOG=1");
+
+	CHECK(library.GetBytecode(MakeKey(0, ShaderStage::Pixel, 2, true, false)).Data == nullptr);
+}
+
+TEST(ShaderPermutations, PoolBuildsTheSameLibrary)
+{
+	ShaderLibrary serial({ L"color.hlsl", L"TreeSprite.hlsl" }, "5_1");
+	ShaderLibrary pooled({ L"color.hlsl", L"TreeSprite.hlsl" }, "5_1");
+	std::vector<ShaderPermutationKey> manifest = MakeManifest();
+
+	ThreadPool pool(4);
+	std::atomic<int> compiles(0);
+	auto counted = [&compiles](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+	{
+		compiles++;
+		return StubCompile(request, bytecode);
+	};
+
+	// Listed twice, compiled once.
+	std::vector<ShaderPermutationKey> doubled = manifest;
+	doubled.insert(doubled.end(), manifest.begin(), manifest.end());
+
+	CHECK(serial.Build(manifest, StubCompile, nullptr));
+	CHECK(pooled.Build(doubled, counted, &pool));
+	CHECK(compiles == (int)manifest.size());
+
+	CHECK(pooled.GetStats().PermutationCount == serial.GetStats().PermutationCount);
+	CHECK(pooled.GetStats().UniqueCount == serial.GetStats().UniqueCount);
+	for(ShaderPermutationKey key : manifest)
+		CHECK(ToString(pooled.GetBytecode(key)) == ToString(serial.GetBytecode(key)));
+}
+
+TEST(ShaderPermutations, LaterBuildsOnlyCompileWhatsNew)
+{
+	ShaderLibrary library({ L"color.hlsl", L"TreeSprite.hlsl" }, "5_1");
+	int compiles = 0;
+	auto counted = [&compiles](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+	{
+		compiles++;
+		return StubCompile(request, bytecode);
+	};
+
+	std::vector<ShaderPermutationKey> first = { MakeKey(0, ShaderStage::Vertex, 3, false, false),
+		MakeKey(0, ShaderStage::Pixel, 3, false, false) };
+	CHECK(library.Build(first, counted, nullptr));
+	ShaderBytecodeView kept = library.GetBytecode(first[1]);
+
+	// The fog vertex shader is new but comes out like the first one.
+	std::vector<ShaderPermutationKey> second = { first[0], first[1], MakeKey(0, ShaderStage::Vertex, 3, true, false),
+		MakeKey(0, ShaderStage::Pixel, 3, true, false) };
+	CHECK(library.Build(second, counted, nullptr));
+	CHECK(compiles == 4);
+	CHECK(library.GetStats().PermutationCount == 4);
+	CHECK(library.GetStats().UniqueCount == 3);
+
+	// Views taken before stay valid.
+	CHECK(library.GetBytecode(first[1]).Data == kept.Data);
+	CHECK(ToString(kept) == "color.hlsl PS ps_5_1 NUM_DIR_LIGHTS=3 NUM_POINT_LIGHTS=0 NUM_SPOT_LIGHTS=0");
+}
+
+TEST(ShaderPermutations, FailedBuildAddsNothing)
+{
+	ShaderLibrary library({ L"color.hlsl", L"TreeSprite.hlsl" }, "5_1");
+	auto failsTreePixel = [](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+	{
+		return !(request.Filename == L"TreeSprite.hlsl" && request.EntryPoint == "PS") && StubCompile(request, bytecode);
+	};
+
+	ThreadPool pool(2);
+	CHECK(!library.Build(MakeManifest(), failsTreePixel, &pool));
+	CHECK(library.GetStats().PermutationCount == 0);
+	CHECK(library.GetBytecode(MakeKey(0, ShaderStage::Vertex, 3, false, false)).Data == nullptr);
+
+	// A program the library wasn't given.
+	CHECK(!library.Build({ MakeKey(2, ShaderStage::Pixel, 3, false, false) }, StubCompile, nullptr));
+
+	CHECK(library.Build(MakeManifest(), StubCompile, &pool));
+	CHECK(library.GetStats().PermutationCount == 20);
+}
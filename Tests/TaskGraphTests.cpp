@@ -0,0 +1,229 @@
+//***************************************************************************************
+// TaskGraphTests.cpp
+//
+// Runs small graphs shaped like ShapesApp::Initialize and checks the order tasks ran in,
+// the threads they ran on, the overlap of independent ones and what a throwing task
+// stops.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Records the order tasks finish in, from any thread.
+	class FinishLog
+	{
+	public:
+		void Finished(TaskGraph::TaskId id)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mOrder.push_back(id);
+		}
+
+		// Position of id in the log, or -1 if it never finished.
+		int IndexOf(TaskGraph::TaskId id)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			for(size_t i = 0; i < mOrder.size(); ++i)
+			{
+				if(mOrder[i] == id)
+					return (int)i;
+			}
+			return -1;
+		}
+
+		size_t GetCount()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mOrder.size();
+		}
+
+	private:
+		std::mutex mMutex;
+		std::vector<TaskGraph::TaskId> mOrder;
+	};
+
+	// Two tasks each wait here for the other; they only both get through if they run at
+	// the same time.
+	class Rendezvous
+	{
+	public:
+		bool Meet()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			++mArrived;
+			mChanged.notify_all();
+			return mChanged.wait_for(lock, std::chrono::seconds(10), [this]() { return mArrived >= 2; });
+		}
+
+	private:
+		std::mutex mMutex;
+		std::condition_variable mChanged;
+		int mArrived = 0;
+	};
+
+	struct InitGraph
+	{
+		TaskGraph::TaskId Textures, Shaders, Geometry, Trees, RootSignature, Heaps, PSOs, Upload;
+	};
+
+	// The initialization steps: loading and compiling on workers, the steps that record
+	// or create on the main thread.
+	InitGraph BuildInitGraph(TaskGraph& graph, FinishLog& log, std::thread::id mainThread, std::atomic<int>& wrongThread)
+	{
+		InitGraph g;
+		auto task = [&graph, &log, &wrongThread, mainThread](const char* name, TaskThread thread,
+			const std::vector<TaskGraph::TaskId>& dependencies)
+		{
+			TaskGraph::TaskId id = (TaskGraph::TaskId)graph.GetTimings().size();
+			return graph.AddTask(name, thread, dependencies, [&log, &wrongThread, mainThread, thread, id]()
+			{
+				if(thread == TaskThread::Main && std::this_thread::get_id() != mainThread)
+					wrongThread++;
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				log.Finished(id);
+			});
+		};
+
+		g.Textures = task("LoadTextures", TaskThread::Worker, {});
+		g.Shaders = task("BuildShadersAndInputLayout", TaskThread::Worker, {});
+		g.Geometry = task("BuildShapeGeometry", TaskThread::Worker, {});
+		g.Trees = task("BuildTreeSpritesGeometry", TaskThread::Worker, {});
+		g.RootSignature = task("BuildRootSignature", TaskThread::Main, {});
+		g.Heaps = task("BuildDescriptorHeaps", TaskThread::Main, { g.Textures, g.RootSignature });
+		g.PSOs = task("BuildPSOs", TaskThread::Main, { g.Shaders, g.RootSignature });
+		g.Upload = task("ExecuteCommandList", TaskThread::Main, { g.Heaps, g.PSOs, g.Geometry, g.Trees });
+		return g;
+	}
+}
+
+TEST(TaskGraph, RunsEveryTaskAfterItsDependencies)
+{
+	for(int pooled = 0; pooled < 2; ++pooled)
+	{
+		TaskGraph graph;
+		FinishLog log;
+		std::atomic<int> wrongThread(0);
+		InitGraph g = BuildInitGraph(graph, log, std::this_thread::get_id(), wrongThread);
+
+		ThreadPool pool(3);
+		graph.Run(pooled != 0 ? &pool : nullptr);
+
+		CHECK(log.GetCount() == 8);
+		CHECK(log.IndexOf(g.Heaps) > log.IndexOf(g.Textures));
+		CHECK(log.IndexOf(g.Heaps) > log.IndexOf(g.RootSignature));
+		CHECK(log.IndexOf(g.PSOs) > log.IndexOf(g.Shaders));
+		CHECK(log.IndexOf(g.Upload) == 7);
+		CHECK(wrongThread == 0);
+
+		// The timings agree: nothing started before what it depends on had finished.
+		const std::vector<TaskTiming>& timings = graph.GetTimings();
+		CHECK(timings[g.PSOs].Name == "BuildPSOs");
+		CHECK(timings[g.PSOs].Thread == TaskThread::Main);
+		for(const TaskTiming& timing : timings)
+		{
+			CHECK(timing.Ran);
+			CHECK(timing.Ms > 0.0);
+			CHECK(timing.StartMs + timing.Ms <= graph.GetTotalMs());
+		}
+		const TaskTiming& upload = timings[g.Upload];
+		for(TaskGraph::TaskId dependency : { g.Heaps, g.PSOs, g.Geometry, g.Trees })
+			CHECK(timings[dependency].StartMs + timings[dependency].Ms <= upload.StartMs);
+	}
+}
+
+TEST(TaskGraph, IndependentWorkerTasksOverlap)
+{
+	TaskGraph graph;
+	Rendezvous rendezvous;
+	std::atomic<int> met(0);
+
+	auto meet = [&rendezvous, &met]()
+	{
+		if(rendezvous.Meet())
+			met++;
+	};
+	graph.AddTask("LoadTextures", TaskThread::Worker, {}, meet);
+	graph.AddTask("BuildShadersAndInputLayout", TaskThread::Worker, {}, meet);
+
+	ThreadPool pool(2);
+	graph.Run(&pool);
+	CHECK(met == 2);
+}
+
+TEST(TaskGraph, MainTasksRunWhileWorkersDo)
+{
+	// A main task meets a worker task that is running at the same time.
+	TaskGraph graph;
+	Rendezvous rendezvous;
+	std::atomic<int> met(0);
+	std::thread::id mainThread;
+
+	graph.AddTask("LoadTextures", TaskThread::Worker, {}, [&]() { met += rendezvous.Meet() ? 1 : 0; });
+	graph.AddTask("BuildRootSignature", TaskThread::Main, {}, [&]()
+	{
+		mainThread = std::this_thread::get_id();
+		met += rendezvous.Meet() ? 1 : 0;
+	});
+
+	ThreadPool pool(1);
+	graph.Run(&pool);
+	CHECK(met == 2);
+	CHECK(mainThread == std::this_thread::get_id());
+}
+
+TEST(TaskGraph, ThrowingTaskStopsWhatDependsOnIt)
+{
+	TaskGraph graph;
+	FinishLog log;
+	std::atomic<int> wrongThread(0);
+	InitGraph g = BuildInitGraph(graph, log, std::this_thread::get_id(), wrongThread);
+	TaskGraph::TaskId broken = graph.AddTask("BuildMaterials", TaskThread::Worker, { g.Textures }, []()
+	{
+		throw std::runtime_error("missing texture");
+	});
+	TaskGraph::TaskId after = graph.AddTask("BuildRenderItems", TaskThread::Main, { broken }, [&log]()
+	{
+		log.Finished(100);
+	});
+
+	ThreadPool pool(2);
+	bool threw = false;
+	try
+	{
+		graph.Run(&pool);
+	}
+	catch(const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	const std::vector<TaskTiming>& timings = graph.GetTimings();
+	CHECK(timings[broken].Ran);
+	CHECK(!timings[after].Ran);
+	CHECK(log.IndexOf(100) == -1);
+
+	// Running again starts over, and the same task throws again.
+	threw = false;
+	try
+	{
+		graph.Run(nullptr);
+	}
+	catch(const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK(!graph.GetTimings()[after].Ran);
+}
@@ -0,0 +1,49 @@
+//***************************************************************************************
+// TempDirectory.cpp
+//***************************************************************************************
+
+#include "TempDirectory.h"
+
+#include <chrono>
+#include <fstream>
+#include <random>
+
+TempDirectory::TempDirectory(const std::string& name)
+{
+	// Runs of the tests may overlap, so the directory gets a random suffix.
+	std::mt19937_64 rng((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+	std::error_code error;
+	for(int attempt = 0; attempt < 16; ++attempt)
+	{
+		mPath = std::filesystem::temp_directory_path(error) / (name + "-" + std::to_string(rng() % 1000000000));
+		if(std::filesystem::create_directories(mPath, error))
+			break;
+	}
+}
+
+TempDirectory::~TempDirectory()
+{
+	std::error_code error;
+	std::filesystem::remove_all(mPath, error);
+}
+
+const std::filesystem::path& TempDirectory::GetPath()const
+{
+	return mPath;
+}
+
+std::wstring TempDirectory::GetFile(const std::string& fileName)const
+{
+	return (mPath / fileName).wstring();
+}
+
+bool TempDirectory::WriteFile(const std::string& fileName, const std::vector<uint8_t>& data)const
+{
+	std::filesystem::path path = mPath / fileName;
+	std::error_code error;
+	std::filesystem::create_directories(path.parent_path(), error);
+
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(data.data()), data.size());
+	return !out.fail();
+}
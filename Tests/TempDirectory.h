@@ -0,0 +1,35 @@
+//***************************************************************************************
+// TempDirectory.h
+//
+// A directory of its own under the system's temporary directory, for the tests and
+// benchmarks of the code that reads files.  It and everything in it is removed again
+// when the TempDirectory goes away.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class TempDirectory
+{
+public:
+	// name becomes part of the directory's name, to tell whose it is.
+	explicit TempDirectory(const std::string& name);
+	TempDirectory(const TempDirectory& rhs) = delete;
+	TempDirectory& operator=(const TempDirectory& rhs) = delete;
+	~TempDirectory();
+
+	const std::filesystem::path& GetPath()const;
+
+	// The full path of fileName in the directory.
+	std::wstring GetFile(const std::string& fileName)const;
+
+	// Writes data to fileName, making the directories on its way; false if it can't.
+	bool WriteFile(const std::string& fileName, const std::vector<uint8_t>& data)const;
+
+private:
+	std::filesystem::path mPath;
+};
@@ -0,0 +1,53 @@
+//***************************************************************************************
+// TestFramework.cpp
+//***************************************************************************************
+
+#include "TestFramework.h"
+
+#include <cstdio>
+
+namespace
+{
+	int gFailureCount = 0;
+}
+
+std::vector<TestCase>& GetTests()
+{
+	// Function statics, so registrars in other files can run first.
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+std::vector<BenchmarkCase>& GetBenchmarks()
+{
+	static std::vector<BenchmarkCase> benchmarks;
+	return benchmarks;
+}
+
+TestRegistrar::TestRegistrar(const char* suite, const char* name, void (*run)())
+{
+	TestCase test;
+	test.Suite = suite;
+	test.Name = name;
+	test.Run = run;
+	GetTests().push_back(test);
+}
+
+BenchmarkRegistrar::BenchmarkRegistrar(const char* name, int (*run)(const std::vector<std::string>& args))
+{
+	BenchmarkCase benchmark;
+	benchmark.Name = name;
+	benchmark.Run = run;
+	GetBenchmarks().push_back(benchmark);
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	std::printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+	gFailureCount++;
+}
+
+int GetFailureCount()
+{
+	return gFailureCount;
+}
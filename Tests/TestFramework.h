@@ -0,0 +1,58 @@
+//***************************************************************************************
+// TestFramework.h
+//
+// The little the tests and benchmarks need: registration and checks.
+//   -TEST(Suite, Name) { ... } defines a test.  CHECK(expr) records a failure and carries
+//    on, so one run reports every broken expectation.
+//   -BENCHMARK(Name) { ... } defines a benchmark.  It is given the command line arguments
+//    after its name, prints its results and returns the number of failures.
+// CommonTests runs every test, or those of the suites named on its command line.
+// CommonBench runs the benchmarks named on its command line, or lists them.
+//***************************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct TestCase
+{
+	const char* Suite = nullptr;
+	const char* Name = nullptr;
+	void (*Run)() = nullptr;
+};
+
+struct BenchmarkCase
+{
+	const char* Name = nullptr;
+	int (*Run)(const std::vector<std::string>& args) = nullptr;
+};
+
+std::vector<TestCase>& GetTests();
+std::vector<BenchmarkCase>& GetBenchmarks();
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* suite, const char* name, void (*run)());
+};
+
+struct BenchmarkRegistrar
+{
+	BenchmarkRegistrar(const char* name, int (*run)(const std::vector<std::string>& args));
+};
+
+void ReportFailure(const char* file, int line, const char* expression);
+int GetFailureCount();
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static TestRegistrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+#define BENCHMARK(name) \
+	static int name##_benchmark(const std::vector<std::string>& args); \
+	static BenchmarkRegistrar name##_registrar(#name, name##_benchmark); \
+	static int name##_benchmark(const std::vector<std::string>& args)
+
+#define CHECK(expression) \
+	do { if(!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while(0)
@@ -0,0 +1,44 @@
+//***************************************************************************************
+// TestMain.cpp
+//
+// CommonTests [suite ...]
+//***************************************************************************************
+
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+int main(int argc, char* argv[])
+{
+	int testCount = 0;
+	int failedCount = 0;
+	for(const TestCase& test : GetTests())
+	{
+		bool selected = argc < 2;
+		for(int i = 1; i < argc && !selected; ++i)
+			selected = std::strcmp(argv[i], test.Suite) == 0;
+		if(!selected)
+			continue;
+
+		int failuresBefore = GetFailureCount();
+		try
+		{
+			test.Run();
+		}
+		catch(const std::exception& e)
+		{
+			std::printf("%s.%s threw: %s\n", test.Suite, test.Name, e.what());
+			ReportFailure(__FILE__, __LINE__, "no exception");
+		}
+
+		bool passed = GetFailureCount() == failuresBefore;
+		std::printf("%s %s.%s\n", passed ? "[ ok ]" : "[FAIL]", test.Suite, test.Name);
+		testCount++;
+		failedCount += passed ? 0 : 1;
+	}
+
+	std::printf("%d tests, %d failed\n", testCount, failedCount);
+	return testCount == 0 || failedCount != 0 ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+//***************************************************************************************
+// TextureArrayPackerTests.cpp
+//
+// Checks which textures may share an array, how they are grouped, and that a packed
+// array holds each file's mips as its slice.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSTestFiles.h"
+#include "TextureArrayPacker.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	DDSTextureDesc MakeTexture(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipCount)
+	{
+		return MakeDDSDesc(DDS_DIMENSION_TEXTURE2D, format, width, height, 1, mipCount, 1, false);
+	}
+}
+
+TEST(TextureArrayPacker, OnlyMatchingSingleTexturesShare)
+{
+	DDSTextureDesc base = MakeTexture(DXGI_FORMAT_BC1_UNORM, 256, 256, 9);
+	CHECK(CanShareDDSTextureArray(base, base));
+
+	DDSTextureDesc other = base;
+	other.width = 128;
+	CHECK(!CanShareDDSTextureArray(base, other));
+
+	other = base;
+	other.format = DXGI_FORMAT_BC3_UNORM;
+	CHECK(!CanShareDDSTextureArray(base, other));
+
+	other = base;
+	other.mipCount = 8;
+	CHECK(!CanShareDDSTextureArray(base, other));
+
+	other = base;
+	other.arraySize = 3;
+	CHECK(!CanShareDDSTextureArray(base, other));
+	CHECK(!CanShareDDSTextureArray(other, base));
+
+	other = base;
+	other.isCubeMap = true;
+	CHECK(!CanShareDDSTextureArray(base, other));
+
+	other = base;
+	other.dimension = DDS_DIMENSION_TEXTURE3D;
+	CHECK(!CanShareDDSTextureArray(base, other));
+}
+
+TEST(TextureArrayPacker, GroupsKeepTheInputOrder)
+{
+	const DDSTextureDesc descs[] =
+	{
+		MakeTexture(DXGI_FORMAT_BC1_UNORM, 256, 256, 9),
+		MakeTexture(DXGI_FORMAT_BC3_UNORM, 256, 256, 9),
+		MakeTexture(DXGI_FORMAT_BC1_UNORM, 256, 256, 9),
+		MakeTexture(DXGI_FORMAT_BC1_UNORM, 512, 512, 10),
+		MakeTexture(DXGI_FORMAT_BC3_UNORM, 256, 256, 9),
+		MakeTexture(DXGI_FORMAT_BC1_UNORM, 256, 256, 9)
+	};
+
+	std::vector<std::vector<size_t>> groups = GroupDDSTexturesForArrays(descs, 6);
+	CHECK(groups.size() == 3);
+	CHECK(groups[0] == std::vector<size_t>({ 0, 2, 5 }));
+	CHECK(groups[1] == std::vector<size_t>({ 1, 4 }));
+	CHECK(groups[2] == std::vector<size_t>({ 3 }));
+
+	CHECK(GroupDDSTexturesForArrays(descs, 0).empty());
+}
+
+TEST(TextureArrayPacker, EachFileBecomesASlice)
+{
+	std::vector<std::vector<uint8_t>> files;
+	for(uint32_t i = 0; i < 3; ++i)
+	{
+		files.push_back(MakeRGBA8DDSFile(32, 16, 6, 1,
+			[i](uint32_t x, uint32_t y, uint32_t mip, uint32_t, uint8_t* rgba)
+			{
+				rgba[0] = (uint8_t)x;
+				rgba[1] = (uint8_t)y;
+				rgba[2] = (uint8_t)mip;
+				rgba[3] = (uint8_t)i;
+			}));
+	}
+
+	std::vector<DDSFileView> views(files.size());
+	for(size_t i = 0; i < files.size(); ++i)
+	{
+		views[i].Data = files[i].data();
+		views[i].Size = files[i].size();
+	}
+
+	std::vector<uint8_t> output;
+	CHECK(PackDDSTextureArray(views.data(), views.size(), output) == DDS_RESULT_OK);
+
+	DDSTextureDesc desc;
+	CHECK(ParseDDSTexture(output.data(), output.size(), desc) == DDS_RESULT_OK);
+	CHECK(desc.format == DXGI_FORMAT_R8G8B8A8_UNORM);
+	CHECK(desc.width == 32 && desc.height == 16);
+	CHECK(desc.mipCount == 6);
+	CHECK(desc.arraySize == 3);
+	CHECK(!desc.isCubeMap);
+
+	std::vector<DDSSubresourceLayout> layouts(desc.mipCount * desc.arraySize);
+	DDSLayoutInfo info;
+	CHECK(GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info) == DDS_RESULT_OK);
+
+	std::vector<DDSSubresourceLayout> sourceLayouts(desc.mipCount);
+	for(uint32_t slice = 0; slice < 3; ++slice)
+	{
+		DDSTextureDesc source;
+		CHECK(ParseDDSTexture(files[slice].data(), files[slice].size(), source) == DDS_RESULT_OK);
+		CHECK(GetDDSSubresourceLayout(source, 0, sourceLayouts.data(), sourceLayouts.size(), info) == DDS_RESULT_OK);
+
+		for(uint32_t mip = 0; mip < desc.mipCount; ++mip)
+		{
+			const DDSSubresourceLayout& packed = layouts[slice * desc.mipCount + mip];
+			CHECK(packed.slicePitch == sourceLayouts[mip].slicePitch);
+			CHECK(std::memcmp(output.data() + packed.offset, files[slice].data() + sourceLayouts[mip].offset,
+				packed.slicePitch) == 0);
+		}
+	}
+}
+
+TEST(TextureArrayPacker, RejectsFilesThatDontMatch)
+{
+	std::vector<uint8_t> a = MakeDDSFile(MakeTexture(DXGI_FORMAT_BC1_UNORM, 64, 64, 7));
+	std::vector<uint8_t> b = MakeDDSFile(MakeTexture(DXGI_FORMAT_BC1_UNORM, 32, 32, 6));
+
+	DDSFileView views[2];
+	views[0].Data = a.data();
+	views[0].Size = a.size();
+	views[1].Data = b.data();
+	views[1].Size = b.size();
+
+	std::vector<uint8_t> output;
+	CHECK(PackDDSTextureArray(views, 2, output) == DDS_RESULT_NOT_SUPPORTED);
+	CHECK(output.empty());
+
+	CHECK(PackDDSTextureArray(nullptr, 2, output) == DDS_RESULT_INVALID_ARG);
+	CHECK(PackDDSTextureArray(views, 0, output) == DDS_RESULT_INVALID_ARG);
+
+	// Cut off inside the last mip.
+	views[1].Data = a.data();
+	views[1].Size = a.size() - 1;
+	CHECK(PackDDSTextureArray(views, 2, output) != DDS_RESULT_OK);
+}
@@ -0,0 +1,185 @@
+//***************************************************************************************
+// TextureCompressorTests.cpp
+//
+// Checks BCnEncoder's blocks against what they decode to, and that CompressDDSTexture
+// turns whole files into BC files with the same mips and slices.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSTestFiles.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const BCFormat gFormats[] = { BCFormat::BC1, BCFormat::BC3, BCFormat::BC7 };
+
+	// Smooth gradients with a soft alpha ramp, like most of the demo's textures.
+	std::vector<uint8_t> MakeGradient(uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> pixels(width * height * 4);
+		for(uint32_t y = 0; y < height; ++y)
+		{
+			for(uint32_t x = 0; x < width; ++x)
+			{
+				uint8_t* p = &pixels[(y * width + x) * 4];
+				p[0] = (uint8_t)(255 * x / (width - 1));
+				p[1] = (uint8_t)(255 * y / (height - 1));
+				p[2] = (uint8_t)(128 + 100 * std::sin(0.1f * (x + y)));
+				p[3] = (uint8_t)(255 - 128 * x / (width - 1));
+			}
+		}
+		return pixels;
+	}
+
+	double CompressAndMeasure(BCFormat format, BCQuality quality, const BCImage& image, ThreadPool* pool,
+		std::vector<uint8_t>& blocks)
+	{
+		blocks.assign(GetBCImageBytes(format, image.Width, image.Height), 0);
+		CompressBCImage(format, quality, image, blocks.data(), pool);
+
+		BCErrorStats error;
+		AccumulateBCError(format, image, blocks.data(), error);
+		return error.GetPsnr();
+	}
+}
+
+TEST(TextureCompressor, FlatBlocksDecodeToTheirColour)
+{
+	// Channels of 0 and 255 survive the BC1 and BC3 endpoints exactly.  BC7 mode 6 shares
+	// one low bit between the channels of an endpoint, so it can be 1 off.
+	uint8_t rgba[64];
+	for(int i = 0; i < 16; ++i)
+	{
+		rgba[i * 4 + 0] = 255;
+		rgba[i * 4 + 1] = 0;
+		rgba[i * 4 + 2] = 255;
+		rgba[i * 4 + 3] = 255;
+	}
+
+	for(BCFormat format : gFormats)
+	{
+		for(BCQuality quality : { BCQuality::Fast, BCQuality::Normal, BCQuality::High })
+		{
+			uint8_t block[16] = {};
+			uint8_t decoded[64] = {};
+			EncodeBCBlock(format, quality, rgba, block);
+			DecodeBCBlock(format, block, decoded);
+
+			int maxError = 0;
+			for(int i = 0; i < 64; ++i)
+				maxError = std::max(maxError, std::abs(rgba[i] - decoded[i]));
+			CHECK(maxError <= (format == BCFormat::BC7 ? 1 : 0));
+		}
+	}
+}
+
+TEST(TextureCompressor, GradientsKeepTheirQuality)
+{
+	const uint32_t width = 64;
+	const uint32_t height = 48;
+	std::vector<uint8_t> pixels = MakeGradient(width, height);
+
+	BCImage image;
+	image.Pixels = pixels.data();
+	image.Width = width;
+	image.Height = height;
+	image.RowPitch = width * 4;
+
+	// Lower bounds with some headroom below what the encoder reaches today.
+	const double minPsnr[] = { 35.0, 36.0, 38.0 };
+	for(int f = 0; f < 3; ++f)
+	{
+		std::vector<uint8_t> blocks;
+		double fast = CompressAndMeasure(gFormats[f], BCQuality::Fast, image, nullptr, blocks);
+		double normal = CompressAndMeasure(gFormats[f], BCQuality::Normal, image, nullptr, blocks);
+		double high = CompressAndMeasure(gFormats[f], BCQuality::High, image, nullptr, blocks);
+
+		CHECK(normal >= minPsnr[f]);
+		CHECK(normal >= fast);
+		CHECK(high >= normal - 0.01);
+	}
+}
+
+TEST(TextureCompressor, PoolMatchesTheCallingThread)
+{
+	// Sizes that aren't whole blocks exercise the edge padding too.
+	const uint32_t width = 70;
+	const uint32_t height = 37;
+	std::vector<uint8_t> pixels = MakeGradient(width, height);
+
+	BCImage image;
+	image.Pixels = pixels.data();
+	image.Width = width;
+	image.Height = height;
+	image.RowPitch = width * 4;
+
+	ThreadPool pool;
+	for(BCFormat format : gFormats)
+	{
+		std::vector<uint8_t> serial;
+		std::vector<uint8_t> pooled;
+		CompressAndMeasure(format, BCQuality::Normal, image, nullptr, serial);
+		CompressAndMeasure(format, BCQuality::Normal, image, &pool, pooled);
+		CHECK(serial == pooled);
+		CHECK(serial.size() == GetBCRowPitch(format, width) * ((height + 3) / 4));
+	}
+}
+
+TEST(TextureCompressor, CompressesEveryMipAndSlice)
+{
+	std::vector<uint8_t> file = MakeRGBA8DDSFile(64, 32, 7, 3,
+		[](uint32_t x, uint32_t y, uint32_t mip, uint32_t slice, uint8_t* rgba)
+		{
+			rgba[0] = (uint8_t)(x * 4 << mip);
+			rgba[1] = (uint8_t)(y * 8 << mip);
+			rgba[2] = (uint8_t)(slice * 80);
+			rgba[3] = 255;
+		});
+
+	ThreadPool pool;
+	for(BCFormat format : gFormats)
+	{
+		std::vector<uint8_t> output;
+		TextureCompressStats stats;
+		CHECK(CompressDDSTexture(file.data(), file.size(), format, BCQuality::Fast, &pool, output, stats) == DDS_RESULT_OK);
+
+		DDSTextureDesc desc;
+		CHECK(ParseDDSTexture(output.data(), output.size(), desc) == DDS_RESULT_OK);
+		CHECK(desc.format == GetBCDXGIFormat(format, false));
+		CHECK(desc.width == 64 && desc.height == 32);
+		CHECK(desc.mipCount == 7);
+		CHECK(desc.arraySize == 3);
+		CHECK(desc.dataSize == GetDDSSurfaceBytes(desc));
+		CHECK(stats.OutputBytes == desc.dataSize);
+		CHECK(stats.InputBytes == file.size() - DDS_DX10_HEADERS_SIZE);
+		CHECK(stats.Psnr > 30.0);
+	}
+}
+
+TEST(TextureCompressor, RejectsWhatItCantCompress)
+{
+	std::vector<uint8_t> output;
+	TextureCompressStats stats;
+
+	std::vector<uint8_t> halfFloat = MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE2D,
+		DXGI_FORMAT_R16G16B16A16_FLOAT, 16, 16, 1, 1, 1, false));
+	CHECK(CompressDDSTexture(halfFloat.data(), halfFloat.size(), BCFormat::BC7, BCQuality::Fast, nullptr,
+		output, stats) == DDS_RESULT_NOT_SUPPORTED);
+
+	std::vector<uint8_t> volume = MakeDDSFile(MakeDDSDesc(DDS_DIMENSION_TEXTURE3D,
+		DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 8, 1, 1, false));
+	CHECK(CompressDDSTexture(volume.data(), volume.size(), BCFormat::BC7, BCQuality::Fast, nullptr,
+		output, stats) == DDS_RESULT_NOT_SUPPORTED);
+
+	CHECK(CompressDDSTexture(halfFloat.data(), 16, BCFormat::BC7, BCQuality::Fast, nullptr,
+		output, stats) == DDS_RESULT_TOO_SMALL);
+	CHECK(output.empty());
+}
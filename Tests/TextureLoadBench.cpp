@@ -0,0 +1,118 @@
+//***************************************************************************************
+// TextureLoadBench.cpp
+//
+// CommonBench TextureLoading [directory]
+// Loads 9, 100 and 1000 textures, cycling through the .dds files in directory
+// (Textures by default), once serially and once spread over a ThreadPool, and prints
+// both times.  Each load is what a TextureLoader worker does: map the file, validate
+// the headers, lay out the subresources, then copy them out as the upload would.
+// Creating the resources needs a device and isn't timed.  After the first pass the
+// files come from the file cache, so this measures the CPU side of loading.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "DDSParser.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <future>
+
+using namespace DirectX;
+
+namespace
+{
+	// Returns the bytes copied, or 0 if the file didn't load.
+	uint64_t LoadTexture(const std::wstring& fileName)
+	{
+		MappedFile file;
+		if(!file.Open(fileName.c_str()))
+			return 0;
+
+		DDSTextureDesc desc;
+		if(ParseDDSTexture(file.GetData(), (size_t)file.GetSize(), desc) != DDS_RESULT_OK)
+			return 0;
+
+		std::vector<DDSSubresourceLayout> layouts((size_t)desc.mipCount * desc.arraySize);
+		DDSLayoutInfo info;
+		if(GetDDSSubresourceLayout(desc, 0, layouts.data(), layouts.size(), info) != DDS_RESULT_OK)
+			return 0;
+
+		std::vector<uint8_t> upload(desc.dataSize);
+		uint64_t copied = 0;
+		for(size_t i = 0; i < info.subresourceCount; ++i)
+		{
+			size_t size = std::min(layouts[i].slicePitch, upload.size() - (size_t)copied);
+			std::memcpy(upload.data() + copied, file.GetData() + layouts[i].offset, size);
+			copied += size;
+		}
+		return copied;
+	}
+}
+
+BENCHMARK(TextureLoading)
+{
+	std::filesystem::path directory = args.empty() ? "Textures" : args[0];
+
+	std::vector<std::wstring> files;
+	std::error_code error;
+	for(const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if(entry.path().extension() == ".dds")
+			files.push_back(entry.path().wstring());
+	}
+	if(files.empty())
+	{
+		std::printf("No .dds files in %s.\n", directory.string().c_str());
+		return 1;
+	}
+
+	ThreadPool pool;
+	std::printf("%zu files, %u worker threads\n", files.size(), pool.GetThreadCount());
+	std::printf("%10s %12s %12s %10s %12s\n", "textures", "serial ms", "pool ms", "speedup", "MB");
+
+	int failures = 0;
+	for(size_t count : { 9, 100, 1000 })
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		// Once to warm the file cache.
+		for(size_t i = 0; i < std::min(count, files.size()); ++i)
+			LoadTexture(files[i]);
+
+		Clock::time_point start = Clock::now();
+		uint64_t serialBytes = 0;
+		for(size_t i = 0; i < count; ++i)
+			serialBytes += LoadTexture(files[i % files.size()]);
+		double serialMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		start = Clock::now();
+		std::vector<uint64_t> bytes(count, 0);
+		std::vector<std::future<void>> done;
+		done.reserve(count);
+		for(size_t i = 0; i < count; ++i)
+		{
+			const std::wstring* fileName = &files[i % files.size()];
+			uint64_t* result = &bytes[i];
+			done.push_back(pool.Submit([fileName, result]() { *result = LoadTexture(*fileName); }));
+		}
+		uint64_t poolBytes = 0;
+		for(size_t i = 0; i < count; ++i)
+		{
+			done[i].get();
+			poolBytes += bytes[i];
+		}
+		double poolMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		if(poolBytes != serialBytes)
+			failures++;
+
+		std::printf("%10zu %12.2f %12.2f %10.2f %12.1f\n", count, serialMs, poolMs, serialMs / poolMs,
+			serialBytes / (1024.0 * 1024.0));
+	}
+	return failures;
+}
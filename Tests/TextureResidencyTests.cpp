@@ -0,0 +1,284 @@
+//***************************************************************************************
+// TextureResidencyTests.cpp
+//
+// Drives TextureResidencyManager with simulated access traces: which textures each frame
+// draws and which mips the streamer asks for.  Checks the eviction order, the protection
+// of recently drawn textures and of mip tails, and that the committed bytes always match
+// the resident mips and stay within the budget.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// A 1024x1024 texture with 11 mips and a 64x64 tail, 4 bytes a texel.
+	std::vector<uint64_t> MakeMipBytes()
+	{
+		std::vector<uint64_t> bytes;
+		for(uint64_t size = 1024; size > 0; size /= 2)
+			bytes.push_back(size * size * 4);
+		return bytes;
+	}
+
+	const uint32_t gTailMip = 4;
+
+	uint64_t Sum(const std::vector<uint64_t>& bytes, uint32_t firstMip)
+	{
+		uint64_t sum = 0;
+		for(uint32_t mip = firstMip; mip < (uint32_t)bytes.size(); ++mip)
+			sum += bytes[mip];
+		return sum;
+	}
+
+	void Apply(TextureResidencyManager& residency, const std::vector<TextureEviction>& evictions)
+	{
+		for(const TextureEviction& e : evictions)
+			residency.SetResidentMip(e.Texture, e.Mip);
+	}
+
+	// One run of a random trace.  Returns the evictions in the order they were applied.
+	std::vector<TextureEviction> RunTrace(uint32_t seed, uint32_t textureCount, uint32_t frameCount,
+		uint64_t budget, bool& withinBudget, bool& bytesMatch)
+	{
+		TextureResidencySettings settings;
+		settings.BudgetBytes = budget;
+		settings.MinIdleFrames = 2;
+		TextureResidencyManager residency(settings);
+
+		std::vector<uint64_t> mipBytes = MakeMipBytes();
+		for(uint32_t i = 0; i < textureCount; ++i)
+			residency.AddTexture(mipBytes, gTailMip);
+
+		std::mt19937 rng(seed);
+		std::vector<TextureEviction> applied;
+		std::vector<TextureEviction> evictions;
+		withinBudget = true;
+		bytesMatch = true;
+		for(uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			residency.BeginFrame();
+
+			// A few textures drawn each frame, and each wanting its next mip.
+			uint32_t drawn = 1 + rng() % 4;
+			for(uint32_t d = 0; d < drawn; ++d)
+			{
+				uint32_t texture = rng() % textureCount;
+				residency.MarkUsed(texture);
+
+				uint32_t resident = residency.GetResidentMip(texture);
+				if(resident == 0)
+					continue;
+
+				if(residency.PlanEvictions(texture, resident - 1, evictions))
+				{
+					Apply(residency, evictions);
+					applied.insert(applied.end(), evictions.begin(), evictions.end());
+					residency.SetResidentMip(texture, resident - 1);
+				}
+			}
+
+			uint64_t expected = 0;
+			for(uint32_t i = 0; i < textureCount; ++i)
+				expected += Sum(mipBytes, residency.GetResidentMip(i));
+
+			bytesMatch = bytesMatch && residency.GetStats().CommittedBytes == expected;
+			withinBudget = withinBudget && expected <= budget;
+		}
+		return applied;
+	}
+}
+
+TEST(TextureResidency, EvictsLeastRecentlyUsedFirstAndTiesByID)
+{
+	TextureResidencySettings settings;
+	settings.MinIdleFrames = 1;
+	TextureResidencyManager residency(settings);
+
+	std::vector<uint64_t> mipBytes = MakeMipBytes();
+	for(int i = 0; i < 4; ++i)
+	{
+		residency.AddTexture(mipBytes, gTailMip);
+		residency.SetResidentMip(i, 0);
+	}
+
+	// Frame 1 draws 3 and 1, frame 2 draws 2, frame 3 draws nothing: 0 is the oldest,
+	// then 1 and 3 tie, then 2.
+	residency.BeginFrame();
+	residency.MarkUsed(3);
+	residency.MarkUsed(1);
+	residency.BeginFrame();
+	residency.MarkUsed(2);
+	residency.BeginFrame();
+
+	// Just over three top mips: a texture gives up mips down to its tail before the next
+	// one is touched, so 0 and 1 go whole and 3 loses its top mip.  2 keeps everything.
+	uint64_t total = residency.GetStats().CommittedBytes;
+	residency.SetBudget(total - 3 * mipBytes[0] - 1);
+
+	std::vector<TextureEviction> evictions;
+	CHECK(residency.PlanEvictions(evictions));
+	CHECK(evictions.size() == 3);
+	if(evictions.size() == 3)
+	{
+		CHECK(evictions[0].Texture == 0 && evictions[0].Mip == gTailMip);
+		CHECK(evictions[1].Texture == 1 && evictions[1].Mip == gTailMip);
+		CHECK(evictions[2].Texture == 3 && evictions[2].Mip == 1);
+	}
+
+	Apply(residency, evictions);
+	CHECK(residency.GetStats().CommittedBytes <= residency.GetBudget());
+	CHECK(residency.GetStats().MipsEvicted == 2 * gTailMip + 1);
+	CHECK(residency.GetStats().TexturesEvicted == 2);
+	CHECK(residency.GetResidentMip(2) == 0);
+}
+
+TEST(TextureResidency, KeepsRecentlyDrawnTexturesAndTails)
+{
+	TextureResidencySettings settings;
+	settings.MinIdleFrames = 2;
+	TextureResidencyManager residency(settings);
+
+	std::vector<uint64_t> mipBytes = MakeMipBytes();
+	residency.AddTexture(mipBytes, gTailMip);
+	residency.AddTexture(mipBytes, gTailMip);
+	residency.SetResidentMip(0, 0);
+	residency.SetResidentMip(1, 0);
+
+	// Texture 1 was drawn last frame; 0 two frames ago.
+	residency.BeginFrame();
+	residency.MarkUsed(0);
+	residency.BeginFrame();
+	residency.MarkUsed(1);
+	residency.BeginFrame();
+
+	// Only both tails fit, but only 0 may go, and no further than its tail.
+	residency.SetBudget(2 * Sum(mipBytes, gTailMip));
+	std::vector<TextureEviction> evictions;
+	CHECK(!residency.PlanEvictions(evictions));
+	CHECK(evictions.size() == 1);
+	CHECK(evictions[0].Texture == 0 && evictions[0].Mip == gTailMip);
+
+	Apply(residency, evictions);
+	CHECK(residency.GetResidentMip(0) == gTailMip);
+	CHECK(residency.GetStats().TexturesEvicted == 1);
+
+	// The tail stays even if asked for.
+	residency.SetResidentMip(0, 10);
+	CHECK(residency.GetResidentMip(0) == gTailMip);
+
+	// An upload for texture 1 can't evict texture 1 itself.
+	CHECK(!residency.PlanEvictions(1, 0, evictions));
+	for(const TextureEviction& e : evictions)
+		CHECK(e.Texture != 1);
+
+	// Once texture 1 has been idle long enough it goes too and the budget is met.
+	residency.BeginFrame();
+	residency.BeginFrame();
+	CHECK(residency.PlanEvictions(evictions));
+	Apply(residency, evictions);
+	CHECK(residency.GetStats().CommittedBytes == 2 * Sum(mipBytes, gTailMip));
+}
+
+TEST(TextureResidency, TracesStayWithinTheBudget)
+{
+	std::vector<uint64_t> mipBytes = MakeMipBytes();
+	const uint32_t textureCount = 24;
+
+	for(uint32_t seed = 1; seed <= 5; ++seed)
+	{
+		// Room for the tails and about four whole textures.
+		uint64_t budget = textureCount * Sum(mipBytes, gTailMip) + 4 * Sum(mipBytes, 0);
+
+		bool withinBudget = false;
+		bool bytesMatch = false;
+		std::vector<TextureEviction> first = RunTrace(seed, textureCount, 400, budget, withinBudget, bytesMatch);
+		CHECK(withinBudget);
+		CHECK(bytesMatch);
+		CHECK(!first.empty());
+
+		// The same trace evicts the same mips.
+		std::vector<TextureEviction> second = RunTrace(seed, textureCount, 400, budget, withinBudget, bytesMatch);
+		CHECK(first.size() == second.size());
+		CHECK(std::equal(first.begin(), first.end(), second.begin(), second.end(),
+			[](const TextureEviction& a, const TextureEviction& b) { return a.Texture == b.Texture && a.Mip == b.Mip; }));
+	}
+}
+
+TEST(TextureResidency, ConvergesWhenTheBudgetIsLowered)
+{
+	TextureResidencySettings settings;
+	settings.MinIdleFrames = 3;
+	TextureResidencyManager residency(settings);
+
+	std::vector<uint64_t> mipBytes = MakeMipBytes();
+	for(uint32_t i = 0; i < 8; ++i)
+	{
+		residency.AddTexture(mipBytes, gTailMip);
+		residency.SetResidentMip(i, i % 3);
+	}
+
+	// Texture 5 keeps being drawn; the rest stop.
+	uint64_t budget = 8 * Sum(mipBytes, gTailMip) + Sum(mipBytes, 1);
+	residency.SetBudget(budget);
+
+	std::vector<TextureEviction> evictions;
+	uint32_t framesOver = 0;
+	for(int frame = 0; frame < 10; ++frame)
+	{
+		residency.BeginFrame();
+		residency.MarkUsed(5);
+		residency.PlanEvictions(evictions);
+		Apply(residency, evictions);
+		if(residency.GetStats().CommittedBytes > budget)
+			framesOver++;
+	}
+
+	// Nothing idle may go for the first MinIdleFrames frames, then the budget holds.
+	CHECK(framesOver == settings.MinIdleFrames - 1);
+	CHECK(residency.GetStats().CommittedBytes <= budget);
+	CHECK(residency.GetResidentMip(5) == 5 % 3);
+}
+
+TEST(TextureResidency, CountsTheMipsKeptForWholeBlocks)
+{
+	// A 208x256 BC texture: mip 3 is 26 texels wide, so a resource holding it has to start
+	// at mip 2 (52 wide); mips 5 and up are whole blocks again only at 4x4 and smaller.
+	const std::vector<uint64_t> mipBytes = { 4096, 1024, 256, 64, 16, 16, 16, 16, 16 };
+	const std::vector<uint32_t> baseMips = { 0, 1, 2, 2, 4, 4, 4, 4, 4 };
+	const uint32_t tailMip = 5;
+
+	TextureResidencyManager residency;
+	residency.AddTexture(mipBytes, tailMip, baseMips);
+	residency.AddTexture(mipBytes, tailMip);
+
+	// The first keeps mip 4 with its tail; the second holds only the tail.
+	CHECK(residency.GetStats().CommittedBytes == Sum(mipBytes, 4) + Sum(mipBytes, 5));
+
+	residency.SetResidentMip(0, 3);
+	CHECK(residency.GetStats().CommittedBytes == Sum(mipBytes, 2) + Sum(mipBytes, 5));
+
+	// Bringing in mip 2 costs nothing more; it was already held for mip 3.
+	std::vector<TextureEviction> evictions;
+	residency.SetBudget(residency.GetStats().CommittedBytes);
+	CHECK(residency.PlanEvictions(0, 2, evictions));
+	CHECK(evictions.empty());
+
+	residency.SetResidentMip(0, 2);
+	residency.SetResidentMip(0, tailMip);
+	CHECK(residency.GetStats().CommittedBytes == Sum(mipBytes, 4) + Sum(mipBytes, 5));
+
+	// Evicting mip 2 alone frees nothing, so the plan goes on down to the next base mip.
+	residency.SetBudget(0);
+	residency.SetResidentMip(0, 2);
+	residency.SetBudget(Sum(mipBytes, 2) + Sum(mipBytes, 5) - 1);
+	residency.BeginFrame();
+	residency.BeginFrame();
+	CHECK(residency.PlanEvictions(evictions));
+	CHECK(evictions.size() == 1);
+	CHECK(evictions[0].Texture == 0 && evictions[0].Mip == 4);
+}
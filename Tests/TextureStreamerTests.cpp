@@ -0,0 +1,205 @@
+//***************************************************************************************
+// TextureStreamerTests.cpp
+//
+// Drives TextureStreamer with a fake backend that records every call and completes
+// uploads only when the test says so.
+//***************************************************************************************
+
+#include "TestFramework.h"
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	class FakeStreamingBackend : public TextureStreamingBackend
+	{
+	public:
+		bool BeginMipUpload(uint32_t texture, uint32_t mip)override
+		{
+			if(RefuseUploads)
+				return false;
+			Started.push_back({ texture, mip });
+			return true;
+		}
+
+		bool IsMipUploadComplete(uint32_t texture, uint32_t mip)override
+		{
+			return std::find(Completed.begin(), Completed.end(), std::make_pair(texture, mip)) != Completed.end();
+		}
+
+		bool SetMinResidentMip(uint32_t texture, uint32_t mip)override
+		{
+			if(RefuseClamps)
+				return false;
+			Clamps.push_back({ texture, mip });
+			return true;
+		}
+
+		// Completes every upload started so far.
+		void CompleteAll()
+		{
+			Completed.insert(Completed.end(), Started.begin(), Started.end());
+		}
+
+		bool RefuseUploads = false;
+		bool RefuseClamps = false;
+
+		std::vector<std::pair<uint32_t, uint32_t>> Started;
+		std::vector<std::pair<uint32_t, uint32_t>> Completed;
+		std::vector<std::pair<uint32_t, uint32_t>> Clamps;
+	};
+
+	// A 1024x1024 texture with 11 mips, loaded down to its 64x64 tail.
+	StreamedTextureDesc MakeDesc(uint32_t size = 1024)
+	{
+		StreamedTextureDesc desc;
+		desc.Width = size;
+		desc.Height = size;
+		desc.MipCount = 1;
+		while((size >> desc.MipCount) > 0)
+			desc.MipCount++;
+		desc.ResidentMip = desc.MipCount - 7;
+		return desc;
+	}
+}
+
+TEST(TextureStreamer, StartsWithTheTailAndWantsTheFootprint)
+{
+	FakeStreamingBackend backend;
+	TextureStreamer streamer(backend);
+	uint32_t texture = streamer.AddTexture(MakeDesc());
+
+	CHECK(streamer.GetResidentMip(texture) == 4);
+
+	// Not drawn: keeps what it has and asks for nothing.
+	streamer.BeginFrame();
+	streamer.Update();
+	CHECK(streamer.GetWantedMip(texture) == 4);
+	CHECK(backend.Started.empty());
+
+	streamer.BeginFrame();
+	streamer.AddFootprint(texture, 300.0f);
+	streamer.AddFootprint(texture, 200.0f);
+	CHECK(streamer.GetWantedMip(texture) == 1);
+
+	streamer.BeginFrame();
+	streamer.AddFootprint(texture, 5000.0f);
+	CHECK(streamer.GetWantedMip(texture) == 0);
+}
+
+TEST(TextureStreamer, ClampsOnlyAfterTheUploadCompletes)
+{
+	FakeStreamingBackend backend;
+	TextureStreamer streamer(backend);
+	uint32_t texture = streamer.AddTexture(MakeDesc());
+
+	streamer.BeginFrame();
+	streamer.AddFootprint(texture, 1024.0f);
+	streamer.Update();
+
+	// The next level is on its way, but the GPU may not sample it yet.
+	CHECK(backend.Started.size() == 1);
+	CHECK(backend.Started[0] == std::make_pair(texture, 3u));
+	CHECK(streamer.GetResidentMip(texture) == 4);
+	CHECK(streamer.GetStats().UploadsInFlight == 1);
+
+	// Nothing more for this texture until the upload lands.
+	streamer.Update();
+	CHECK(backend.Started.size() == 1);
+	CHECK(backend.Clamps.empty());
+
+	// Once it has, the clamp drops to it and the level after it starts.
+	backend.CompleteAll();
+	streamer.Update();
+	CHECK(backend.Clamps.size() == 1);
+	CHECK(backend.Clamps[0] == std::make_pair(texture, 3u));
+	CHECK(streamer.GetResidentMip(texture) == 3);
+	CHECK(backend.Started.size() == 2);
+	CHECK(backend.Started[1] == std::make_pair(texture, 2u));
+}
+
+TEST(TextureStreamer, ReachesTheWantedMipThroughEveryLevel)
+{
+	FakeStreamingBackend backend;
+	TextureStreamer streamer(backend);
+	uint32_t texture = streamer.AddTexture(MakeDesc());
+
+	for(int frame = 0; frame < 20; ++frame)
+	{
+		streamer.BeginFrame();
+		streamer.AddFootprint(texture, 1024.0f);
+		streamer.Update();
+		backend.CompleteAll();
+	}
+
+	CHECK(streamer.GetResidentMip(texture) == 0);
+	CHECK(streamer.GetStats().UploadsCompleted == 4);
+	CHECK(streamer.GetStats().TexturesWaiting == 0);
+
+	// Every level once, most detailed last, and each clamp after its upload.
+	std::vector<std::pair<uint32_t, uint32_t>> levels = { { texture, 3 }, { texture, 2 }, { texture, 1 }, { texture, 0 } };
+	CHECK(backend.Started == levels);
+	CHECK(backend.Clamps == levels);
+}
+
+TEST(TextureStreamer, LargestFootprintGetsTheUploadSlots)
+{
+	FakeStreamingBackend backend;
+	TextureStreamer streamer(backend, 2);
+
+	uint32_t small = streamer.AddTexture(MakeDesc());
+	uint32_t large = streamer.AddTexture(MakeDesc());
+	uint32_t medium = streamer.AddTexture(MakeDesc());
+	uint32_t hidden = streamer.AddTexture(MakeDesc());
+
+	streamer.BeginFrame();
+	streamer.AddFootprint(small, 200.0f);
+	streamer.AddFootprint(large, 900.0f);
+	streamer.AddFootprint(medium, 500.0f);
+	streamer.Update();
+
+	CHECK(backend.Started.size() == 2);
+	CHECK(backend.Started[0].first == large);
+	CHECK(backend.Started[1].first == medium);
+	CHECK(streamer.GetStats().TexturesWaiting == 3);
+
+	// A slot frees up and the small one gets it; the hidden one never asks.
+	backend.CompleteAll();
+	streamer.BeginFrame();
+	streamer.AddFootprint(small, 200.0f);
+	streamer.Update();
+	CHECK(backend.Started.size() == 3);
+	CHECK(backend.Started[2].first == small);
+	CHECK(streamer.GetResidentMip(hidden) == 4);
+}
+
+TEST(TextureStreamer, RetriesWhatTheBackendRefuses)
+{
+	FakeStreamingBackend backend;
+	TextureStreamer streamer(backend);
+	uint32_t texture = streamer.AddTexture(MakeDesc());
+
+	backend.RefuseUploads = true;
+	streamer.BeginFrame();
+	streamer.AddFootprint(texture, 1024.0f);
+	streamer.Update();
+	CHECK(streamer.GetStats().UploadsStarted == 0);
+	CHECK(streamer.GetStats().TexturesWaiting == 1);
+
+	backend.RefuseUploads = false;
+	streamer.Update();
+	CHECK(streamer.GetStats().UploadsStarted == 1);
+
+	// The upload lands, but the view can't change yet: the old clamp stays.
+	backend.RefuseClamps = true;
+	backend.CompleteAll();
+	streamer.Update();
+	CHECK(streamer.GetResidentMip(texture) == 4);
+
+	backend.RefuseClamps = false;
+	streamer.Update();
+	CHECK(streamer.GetResidentMip(texture) == 3);
+}
@@ -0,0 +1,354 @@
+//***************************************************************************************
+// AssetTool.cpp
+//
+// The offline asset steps, run from the command line rather than by the demo:
+//   AssetTool -convert IN OUT
+//       expand the legacy 24-bit, packed 8/16-bit or luminance DDS file IN to RGBA8 in
+//       OUT.  The scalar reference converts it as well; both must agree, and both
+//       speeds are reported.
+//   AssetTool -mips FILTER SPACE IN OUT
+//       rebuild the mip chain of the uncompressed DDS file IN into OUT.  FILTER is box or
+//       kaiser; SPACE is srgb for colour textures or linear for data such as normal maps.
+//   AssetTool -compress FORMAT QUALITY IN OUT
+//       block compress the uncompressed DDS file IN into OUT.  FORMAT is bc1, bc3 or
+//       bc7, QUALITY is fast, normal or high.
+//   AssetTool -pack FILE
+//       pack everything under Textures, Shaders and ShaderCache into the asset archive
+//       FILE and check it.  Run it where the demo runs, after a run of the demo so the
+//       shader cache is current; the demo reads Assets.pak.
+// The texture options can be repeated to process a batch of files.  Convert jobs run
+// first, then mip jobs, then compress jobs, so a file can be converted, given mips and
+// compressed in one batch; -pack runs last, so it packs what the batch wrote.  Prints a
+// line per file and returns the number of files that failed.
+//***************************************************************************************
+
+#include "AssetArchive.h"
+#include "BinaryFile.h"
+#include "DDSParser.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "PixelFormatConverter.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// One -compress request.
+	struct TextureCompressJob
+	{
+		std::filesystem::path InputFile;
+		std::filesystem::path OutputFile;
+		BCFormat Format = BCFormat::BC7;
+		BCQuality Quality = BCQuality::Normal;
+	};
+
+	// One -convert request.
+	struct TextureConvertJob
+	{
+		std::filesystem::path InputFile;
+		std::filesystem::path OutputFile;
+	};
+
+	// One -mips request.
+	struct TextureMipJob
+	{
+		std::filesystem::path InputFile;
+		std::filesystem::path OutputFile;
+		MipFilter Filter = MipFilter::Box;
+		bool TreatAsSrgb = true;
+	};
+
+	struct AssetToolOptions
+	{
+		std::vector<TextureConvertJob> ConvertJobs;
+		std::vector<TextureMipJob> MipJobs;
+		std::vector<TextureCompressJob> CompressJobs;
+
+		// Empty unless -pack was given.
+		std::filesystem::path PackFile;
+	};
+
+	const char* const gUsage =
+		"Usage: AssetTool OPTION ...\n"
+		"  -convert IN OUT\n"
+		"  -mips box|kaiser srgb|linear IN OUT\n"
+		"  -compress bc1|bc3|bc7 fast|normal|high IN OUT\n"
+		"  -pack FILE\n";
+
+	// The directories the demo reads its assets from.  ShaderCache holds the bytecode of
+	// the last run, so a demo started from a pack made after a run compiles nothing.
+	const char* const gAssetDirectories[] = { "Textures", "Shaders", "ShaderCache" };
+
+	// Returns false, having said why, if an option is unknown or is missing arguments.
+	bool ParseArguments(int argc, char* argv[], AssetToolOptions& options)
+	{
+		for(int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			int remaining = argc - i - 1;
+			if(arg == "-convert" && remaining >= 2)
+			{
+				TextureConvertJob job;
+				job.InputFile = argv[i + 1];
+				job.OutputFile = argv[i + 2];
+				options.ConvertJobs.push_back(job);
+				i += 2;
+			}
+			else if(arg == "-mips" && remaining >= 4)
+			{
+				TextureMipJob job;
+				job.Filter = std::string(argv[i + 1]) == "kaiser" ? MipFilter::Kaiser : MipFilter::Box;
+				job.TreatAsSrgb = std::string(argv[i + 2]) != "linear";
+				job.InputFile = argv[i + 3];
+				job.OutputFile = argv[i + 4];
+				options.MipJobs.push_back(job);
+				i += 4;
+			}
+			else if(arg == "-compress" && remaining >= 4)
+			{
+				std::string format = argv[i + 1];
+				std::string quality = argv[i + 2];
+
+				TextureCompressJob job;
+				job.Format = format == "bc1" ? BCFormat::BC1 : (format == "bc3" ? BCFormat::BC3 : BCFormat::BC7);
+				job.Quality = quality == "fast" ? BCQuality::Fast : (quality == "high" ? BCQuality::High : BCQuality::Normal);
+				job.InputFile = argv[i + 3];
+				job.OutputFile = argv[i + 4];
+				options.CompressJobs.push_back(job);
+				i += 4;
+			}
+			else if(arg == "-pack" && remaining >= 1)
+			{
+				options.PackFile = argv[i + 1];
+				i += 1;
+			}
+			else
+			{
+				std::printf("Unknown option or missing arguments: %s\n", argv[i]);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WriteFile(const std::filesystem::path& fileName, const std::vector<uint8_t>& data)
+	{
+		std::ofstream out(fileName, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(data.data()), data.size());
+		return !out.fail();
+	}
+
+	// Runs the -convert jobs.  Every file is converted twice, by the fastest path this CPU
+	// has and by the scalar reference, and the two must agree.  Returns the number of
+	// files that failed.
+	int ConvertTextures(const std::vector<TextureConvertJob>& jobs, ThreadPool& pool)
+	{
+		// Offline conversion writes files for any device, so nothing is left packed.
+		PixelConvertOptions options;
+		options.ExpandPacked16 = true;
+
+		PixelConvertOptions reference = options;
+		reference.Path = PixelConvertPath::Scalar;
+
+		int failures = 0;
+		for(const auto& job : jobs)
+		{
+			MappedFile file;
+			std::vector<uint8_t> output;
+			std::vector<uint8_t> referenceOutput;
+			PixelConvertStats stats;
+			PixelConvertStats referenceStats;
+			DDS_RESULT result = DDS_RESULT_INVALID_ARG;
+			if(file.Open(job.InputFile.wstring().c_str()))
+			{
+				result = ConvertLegacyDDS(file.GetData(), (size_t)file.GetSize(), options, &pool, output, stats);
+				if(result == DDS_RESULT_OK)
+				{
+					ConvertLegacyDDS(file.GetData(), (size_t)file.GetSize(), reference, &pool,
+						referenceOutput, referenceStats);
+				}
+			}
+
+			bool matches = result == DDS_RESULT_OK && output == referenceOutput;
+			bool written = matches && WriteFile(job.OutputFile, output);
+
+			std::printf("%s: ", job.InputFile.string().c_str());
+			if(!file.IsOpen())
+				std::printf("can't open the file\n");
+			else if(result != DDS_RESULT_OK)
+				std::printf("not a legacy layout that needs converting (DDS error %d)\n", (int)result);
+			else if(!matches)
+				std::printf("%s output differs from the scalar reference\n", GetPixelConvertPathName(stats.Path));
+			else if(!written)
+				std::printf("can't write %s\n", job.OutputFile.string().c_str());
+			else
+			{
+				std::printf("%s %ux%u, %u mips, %u slices in %.2f ms (%s %.1f MP/s, scalar %.1f MP/s)\n",
+					stats.SourceLayout, stats.Width, stats.Height, stats.MipCount, stats.ArraySize,
+					stats.Seconds * 1000.0, GetPixelConvertPathName(stats.Path), stats.MegapixelsPerSecond,
+					referenceStats.MegapixelsPerSecond);
+			}
+
+			if(!written)
+				failures++;
+		}
+		return failures;
+	}
+
+	// Runs the -mips jobs.  Returns the number of files that failed.
+	int GenerateTextureMips(const std::vector<TextureMipJob>& jobs, ThreadPool& pool)
+	{
+		int failures = 0;
+		for(const auto& job : jobs)
+		{
+			MappedFile file;
+			std::vector<uint8_t> output;
+			MipGenerateStats stats;
+			DDS_RESULT result = DDS_RESULT_INVALID_ARG;
+			if(file.Open(job.InputFile.wstring().c_str()))
+			{
+				result = GenerateDDSMips(file.GetData(), (size_t)file.GetSize(), job.Filter, job.TreatAsSrgb,
+					&pool, output, stats);
+			}
+
+			bool written = result == DDS_RESULT_OK && WriteFile(job.OutputFile, output);
+
+			std::printf("%s: ", job.InputFile.string().c_str());
+			if(!file.IsOpen())
+				std::printf("can't open the file\n");
+			else if(result != DDS_RESULT_OK)
+				std::printf("not an uncompressed 32-bit 2D texture (DDS error %d)\n", (int)result);
+			else if(!written)
+				std::printf("can't write %s\n", job.OutputFile.string().c_str());
+			else
+			{
+				std::printf("%ux%u, %u slices, %u mips in %.2f ms (%.1f MP/s)\n", stats.Width, stats.Height,
+					stats.ArraySize, stats.MipCount, stats.Seconds * 1000.0, stats.MegapixelsPerSecond);
+			}
+
+			if(!written)
+				failures++;
+		}
+		return failures;
+	}
+
+	// Runs the -compress jobs.  Returns the number of files that failed.
+	int CompressTextures(const std::vector<TextureCompressJob>& jobs, ThreadPool& pool)
+	{
+		int failures = 0;
+		for(const auto& job : jobs)
+		{
+			MappedFile file;
+			std::vector<uint8_t> output;
+			TextureCompressStats stats;
+			DDS_RESULT result = DDS_RESULT_INVALID_ARG;
+			if(file.Open(job.InputFile.wstring().c_str()))
+			{
+				result = CompressDDSTexture(file.GetData(), (size_t)file.GetSize(), job.Format, job.Quality,
+					&pool, output, stats);
+			}
+
+			bool written = result == DDS_RESULT_OK && WriteFile(job.OutputFile, output);
+
+			std::printf("%s: ", job.InputFile.string().c_str());
+			if(!file.IsOpen())
+				std::printf("can't open the file\n");
+			else if(result != DDS_RESULT_OK)
+				std::printf("not an uncompressed 32-bit 2D texture (DDS error %d)\n", (int)result);
+			else if(!written)
+				std::printf("can't write %s\n", job.OutputFile.string().c_str());
+			else
+			{
+				std::printf("%ux%u, %u mips, %u slices, %llu KB to %llu KB in %.2f ms (%.1f MP/s), PSNR %.2f dB\n",
+					stats.Width, stats.Height, stats.MipCount, stats.ArraySize,
+					(unsigned long long)(stats.InputBytes / 1024), (unsigned long long)(stats.OutputBytes / 1024),
+					stats.Seconds * 1000.0, stats.MegapixelsPerSecond, stats.Psnr);
+			}
+
+			if(!written)
+				failures++;
+		}
+		return failures;
+	}
+
+	// Runs -pack: packs the asset directories into archiveFile, then opens it again and
+	// checks every entry against its checksum.  Entries are named by their path from the
+	// working directory.  Returns the number of failures.
+	int PackAssets(const std::filesystem::path& archiveFile, ThreadPool& pool)
+	{
+		int failures = 0;
+		AssetArchiveWriter writer;
+		for(const char* directory : gAssetDirectories)
+		{
+			// A missing directory leaves the iterator at its end.
+			std::error_code error;
+			std::filesystem::recursive_directory_iterator it(directory, error);
+			for(; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+			{
+				// .tmp files are shader cache entries still being written.
+				const std::filesystem::path& file = it->path();
+				if(!it->is_regular_file(error) || file.extension() == ".tmp")
+					continue;
+
+				std::vector<uint8_t> data;
+				BinaryFileResult result = ReadBinaryFile(file.wstring().c_str(), data);
+				if(result != BinaryFileResult::Ok)
+				{
+					std::printf("%s: %s\n", file.string().c_str(), GetBinaryFileResultName(result));
+					failures++;
+					continue;
+				}
+
+				writer.Add(file.wstring(), std::move(data));
+			}
+		}
+
+		AssetArchive archive;
+		AssetArchiveResult result = writer.Write(archiveFile.wstring().c_str(), &pool);
+		if(result == AssetArchiveResult::Ok)
+			result = archive.Open(archiveFile.wstring().c_str());
+		if(result == AssetArchiveResult::Ok)
+			result = archive.Verify(&pool);
+
+		std::printf("%s: ", archiveFile.string().c_str());
+		if(result != AssetArchiveResult::Ok)
+		{
+			std::printf("%s\n", GetAssetArchiveResultName(result));
+			failures++;
+		}
+		else
+		{
+			const AssetArchiveStats& stats = writer.GetStats();
+			std::printf("%u files (%u compressed), %llu KB to %llu KB in %.2f ms\n", stats.EntryCount,
+				stats.CompressedCount, (unsigned long long)(stats.Size / 1024),
+				(unsigned long long)(stats.StoredSize / 1024), stats.Seconds * 1000.0);
+		}
+
+		return failures;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	AssetToolOptions options;
+	if(argc < 2 || !ParseArguments(argc, argv, options))
+	{
+		std::printf("%s", gUsage);
+		return 1;
+	}
+
+	ThreadPool pool;
+	int failures = ConvertTextures(options.ConvertJobs, pool) + GenerateTextureMips(options.MipJobs, pool) +
+		CompressTextures(options.CompressJobs, pool);
+	if(!options.PackFile.empty())
+		failures += PackAssets(options.PackFile, pool);
+	return failures;
+}
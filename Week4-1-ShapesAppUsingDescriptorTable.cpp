@@ -9,6 +9,32 @@
 #include "Common/UploadBuffer.h"
 #include "Common/GeometryGenerator.h"
 #include "Common/FrameResource.h"
+#include "Common/FramePacer.h"
+#include "Common/FrameLatencyController.h"
+#include "Common/LightClusterGrid.h"
+#include "Common/LightStore.h"
+#include "Common/PassConstantsBuilder.h"
+#include "Common/MaterialAnimator.h"
+#include "Common/ThreadPool.h"
+#include "Common/TextureLoader.h"
+#include "Common/TextureCompressor.h"
+#include "Common/MipGenerator.h"
+#include "Common/TextureStreamer.h"
+#include "Common/TextureStreamUploader.h"
+#include "Common/TextureResidency.h"
+#include "Common/TextureArrayPacker.h"
+#include "Common/BindlessTable.h"
+#include "Common/ShaderPermutations.h"
+#include "Common/PipelineStateCache.h"
+#include "Common/TaskGraph.h"
+#include "Common/AssetArchive.h"
+#include "Common/RenderGraph.h"
+#include "Common/RenderGraphRecorder.h"
+#include "Common/FilteredCommandList.h"
+#include "Common/DescriptorHeapAllocator.h"
+#include "Common/IndirectDrawBuilder.h"
+
+#include <chrono>
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -19,10 +45,15 @@ using namespace DirectX::PackedVector;
 #pragma comment(lib, "D3D12.lib")
 
 
-const int gNumFrameResources = 3;
+int gNumFrameResources = 3;
 const float width = 50;
 const float depth = 50;
 
+// Slots in the shader-visible SRV heap.  The persistent ones are the shaders' texture
+// table; the transient ones are for views only one frame uses.
+const UINT gSrvHeapPersistentCount = 1024;
+const UINT gSrvHeapTransientCount = 256;
+
 
 enum class RenderLayer : int
 {
@@ -55,12 +86,21 @@ struct RenderItem
 	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
 	int NumFramesDirty = gNumFrameResources;
 
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
+	// Index into the object buffer corresponding to this render item.
 	UINT ObjCBIndex = -1;
 
+	// Object and material index packed into the draw's root constant (see BindlessTable.h).
+	UINT DrawIndex = 0;
+
+	// Streamed texture the material samples, or -1.
+	int StreamedTexture = -1;
+
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+	// Local space bounds of the submesh, used to estimate the item's size on screen.
+	BoundingBox Bounds;
+
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -78,6 +118,18 @@ public:
     ShapesApp& operator=(const ShapesApp& rhs) = delete;
     ~ShapesApp();
 
+    // Lets the frame latency controller lower or raise the queue depth at runtime.
+    // Must be called before Initialize.
+    void SetAdaptiveLatency(bool enable);
+
+    // Memory budget for the streamed textures; 0 for none.  Must be called before
+    // Initialize.
+    void SetTextureBudget(UINT64 bytes);
+
+    // Archive to read the textures and shaders from when it exists; empty to always read
+    // the loose files.  Must be called before Initialize.
+    void SetAssetArchive(const std::wstring& filename);
+
     virtual bool Initialize()override;
 
 private:
@@ -94,20 +146,31 @@ private:
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
+	void UpdateLightClusters(bool cameraChanged);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void UpdateTextureStreaming();
 
 	void LoadTextures();
+	void FinishTextures();
 	void BuildRootSignature();
 	void BuildDescriptorHeaps();
 
 	void BuildShadersAndInputLayout();
+	D3D12_SHADER_BYTECODE GetShader(const std::string& name)const;
 	void BuildShapeGeometry();
 	void BuildTreeSpritesGeometry();
+	void UploadGeometry();
 	void BuildPSOs();
 	void BuildFrameResources();
 	void BuildMaterials();
+	void BuildMaterialAnimations();
 	void BuildRenderItems();
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void BuildDrawIndices();
+	void BuildLights();
+	void BuildFrameGraph();
+	void BuildIndirectDraws();
+	void DrawOpaqueIndirect();
+	void DrawRenderItems(FilteredCommandList& cmdList, const std::vector<RenderItem*>& ritems);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -121,18 +184,88 @@ private:
 	FrameResource* mCurrFrameResource = nullptr;
 	int mCurrFrameResourceIndex = 0;
 
-	UINT mCbvSrvDescriptorSize = 0;
+	std::unique_ptr<ThreadPool> mThreadPool;
+
+	// Pipelines are named by a hash of their description and kept between runs; mPSOs
+	// holds their indices in the cache.
+	std::unique_ptr<PipelineStateCache> mPipelineCache;
+
+	// Large textures start with only their mip tail and stream the rest in by how much
+	// of the screen they cover.  Textures that could share a texture array were packed
+	// into one, so several names can map to the same streamed texture.
+	struct StreamedTextureSlice
+	{
+		uint32_t Id = 0;
+		UINT ArraySlice = 0;
+	};
+
+	std::unique_ptr<TextureStreamUploader> mTextureUploader;
+	std::unique_ptr<TextureStreamer> mTextureStreamer;
+	std::unique_ptr<TextureResidencyManager> mTextureResidency;
+
+	// Reads, converts and compresses the loaded (not streamed) textures on the pool
+	// between LoadTextures and FinishTextures.
+	std::unique_ptr<TextureLoader> mTextureLoader;
+	UINT64 mTextureBudget = 0;
+
+	// Open for the app's lifetime: the shader cache can read from it whenever a shader is
+	// compiled.  Null when there is no archive.
+	std::wstring mAssetArchiveFile = L"Assets.pak";
+	std::unique_ptr<AssetArchive> mAssetArchive;
+	std::unordered_map<std::string, StreamedTextureSlice> mStreamedTextures;
+	UINT mStreamedTextureCount = 0;
+	std::unordered_map<Material*, uint32_t> mStreamedMaterials;
+
+	// The frame's passes and the barriers between them, compiled once.  The back buffer
+	// and depth buffer are imported; the recorder is pointed at the current back buffer
+	// each frame.
+	RenderGraph mFrameGraph;
+	std::unique_ptr<RenderGraphRecorder> mGraphRecorder;
+	RenderGraph::ResourceId mBackBufferResource = RenderGraph::InvalidResource;
+	RenderGraph::ResourceId mDepthResource = RenderGraph::InvalidResource;
+
+	// Binds for Draw and the passes, dropping bindings that repeat what is already bound.
+	// Its counts cover the last frame recorded.
+	FilteredCommandList mDrawList;
+	bool mBindingStatsReported = false;
+
+	// The opaque layer is drawn with one ExecuteIndirect.  Each frame its items are culled
+	// and their arguments written to the frame resource's IndirectDrawBuffer; items that
+	// aren't triangle lists are drawn one by one after it.  mIndirectDrawRitems are the
+	// render items of mIndirectDrawItems, in the same order.
+	ComPtr<ID3D12CommandSignature> mDrawSignature;
+	IndirectDrawBuilder mIndirectDrawBuilder;
+	std::vector<IndirectDrawItem> mIndirectDrawItems;
+	std::vector<RenderItem*> mIndirectDrawRitems;
+	std::vector<RenderItem*> mOpaqueDirectRitems;
+
+	std::unique_ptr<FramePacer> mFramePacer;
+	std::unique_ptr<FrameLatencyController> mLatencyController;
+	bool mAdaptiveLatency = false;
 
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 	//  ComPtr<ID3D12DescriptorHeap> mCbvHeap = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	// Textures get their SRV slots from it as their views are created.
+	std::unique_ptr<DescriptorHeapAllocator> mSrvHeap;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
+
+	// The geometry builders add to mGeometries from worker threads during Initialize.
+	std::mutex mGeometryMutex;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
+	MaterialAnimator mMaterialAnimator;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
-	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+	// Every shader variant is a permutation of one of these programs, compiled up front
+	// on the thread pool; mShaders names the ones the PSOs use.
+	enum ShaderProgram
+	{
+		ColorProgram = 0,
+		TreeSpriteProgram
+	};
+	std::unique_ptr<ShaderLibrary> mShaderLibrary;
+	std::unordered_map<std::string, ShaderPermutationKey> mShaders;
+	std::unordered_map<std::string, uint32_t> mPSOs;
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mStdInputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mTreeSpriteInputLayout;
@@ -145,7 +278,19 @@ private:
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
 
-	PassConstants mMainPassCB;
+	PassConstantsBuilder mMainPassBuilder;
+
+	// Scene lights, loaded from Scenes/Lights.txt.
+	LightStore mLightStore;
+
+	// Point and spot lights are binned into clusters; there is no cap on their number.
+	// The clusters are only rebuilt when the camera or a light changed.
+	std::vector<Light> mPointLights;
+	std::vector<Light> mSpotLights;
+	LightClusterGrid mLightClusters;
+	UINT64 mClusterLightVersion = 0;
+	int mClusterFramesDirty = 0;
+	bool mClusterGridResized = true;
 
 	UINT mPassCbvOffset = 0;
 
@@ -164,6 +309,56 @@ private:
 	UINT objCBIndex = 0;
 };
 
+// What the command line asked for.
+struct ShapesAppOptions
+{
+    int NumFrameResources = 3;
+    bool AdaptiveLatency = false;
+    UINT64 TextureBudget = 0;
+
+    // Empty with -loose.
+    std::wstring ArchiveFile = L"Assets.pak";
+};
+
+// Recognized options:
+//   -frames N    number of frame resources, 1 to gMaxNumFrameResources (default 3).
+//   -adaptive    let the latency controller adjust the queue depth at runtime.
+//   -texbudget MB
+//                keep the streamed textures within MB megabytes by evicting the mips of
+//                the least recently drawn ones (default: no budget).
+//   -loose       read the textures and shaders from their own files even when Assets.pak
+//                exists.  The startup timings compare the two.
+// The offline asset steps are run by AssetTool (Tools/AssetTool.cpp), and the benchmarks
+// by CommonBench (Tests/CMakeLists.txt), instead.
+static void ParseCommandLine(PSTR cmdLine, ShapesAppOptions& options)
+{
+    std::istringstream args(cmdLine != nullptr ? cmdLine : "");
+    std::string arg;
+    while(args >> arg)
+    {
+        if(arg == "-frames")
+        {
+            int count = 0;
+            if(args >> count)
+                options.NumFrameResources = MathHelper::Clamp(count, 1, gMaxNumFrameResources);
+        }
+        else if(arg == "-adaptive")
+        {
+            options.AdaptiveLatency = true;
+        }
+        else if(arg == "-texbudget")
+        {
+            UINT64 megabytes = 0;
+            if(args >> megabytes)
+                options.TextureBudget = megabytes * 1024 * 1024;
+        }
+        else if(arg == "-loose")
+        {
+            options.ArchiveFile.clear();
+        }
+    }
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     PSTR cmdLine, int showCmd)
 {
@@ -172,9 +367,17 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+    ShapesAppOptions options;
+    options.NumFrameResources = gNumFrameResources;
+    ParseCommandLine(cmdLine, options);
+    gNumFrameResources = options.NumFrameResources;
+
     try
     {
         ShapesApp theApp(hInstance);
+        theApp.SetAdaptiveLatency(options.AdaptiveLatency);
+        theApp.SetTextureBudget(options.TextureBudget);
+        theApp.SetAssetArchive(options.ArchiveFile);
         if(!theApp.Initialize())
             return 0;
 
@@ -196,6 +399,27 @@ ShapesApp::~ShapesApp()
 {
     if(md3dDevice != nullptr)
         FlushCommandQueue();
+
+    // Only writes the library if a pipeline had to be compiled this run.
+    if(mPipelineCache != nullptr)
+        mPipelineCache->Save();
+
+    d3dUtil::SetAssetArchive(nullptr);
+}
+
+void ShapesApp::SetAdaptiveLatency(bool enable)
+{
+	mAdaptiveLatency = enable;
+}
+
+void ShapesApp::SetTextureBudget(UINT64 bytes)
+{
+	mTextureBudget = bytes;
+}
+
+void ShapesApp::SetAssetArchive(const std::wstring& filename)
+{
+	mAssetArchiveFile = filename;
 }
 
 bool ShapesApp::Initialize()
@@ -206,18 +430,96 @@ bool ShapesApp::Initialize()
 	// Reset the command list to prep for initialization commands.
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
-	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	mThreadPool = std::make_unique<ThreadPool>();
+	mSrvHeap = std::make_unique<DescriptorHeapAllocator>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		gSrvHeapPersistentCount, gSrvHeapTransientCount, true);
+	mPipelineCache = std::make_unique<PipelineStateCache>(md3dDevice.Get(), L"PipelineCache.bin");
+	mTextureUploader = std::make_unique<TextureStreamUploader>(md3dDevice.Get(), mCommandQueue.Get(), *mThreadPool);
+	mTextureStreamer = std::make_unique<TextureStreamer>(*mTextureUploader);
+
+	TextureResidencySettings residencySettings;
+	residencySettings.BudgetBytes = mTextureBudget;
+	residencySettings.MinIdleFrames = (uint32_t)gNumFrameResources;
+	mTextureResidency = std::make_unique<TextureResidencyManager>(residencySettings);
+	mTextureStreamer->SetResidencyManager(mTextureResidency.get());
+
+	mFramePacer = std::make_unique<FramePacer>(gNumFrameResources);
+
+	if (mAdaptiveLatency)
+	{
+		FrameLatencySettings latencySettings;
+		latencySettings.MaxLatency = gNumFrameResources;
+		mLatencyController = std::make_unique<FrameLatencyController>(gNumFrameResources, latencySettings);
+	}
 
-	LoadTextures();
-	BuildRootSignature();
-	BuildShadersAndInputLayout();
-	BuildShapeGeometry();
-	BuildTreeSpritesGeometry();
-	BuildMaterials();
-	BuildRenderItems();
-	BuildFrameResources();
-	BuildDescriptorHeaps();
-	BuildPSOs();
+	// With an archive, the textures, shader sources and cached bytecode it holds are read
+	// from it, one mapping for all of them.  A missing archive just means loose files.
+	if (!mAssetArchiveFile.empty())
+	{
+		mAssetArchive = std::make_unique<AssetArchive>();
+		AssetArchiveResult result = mAssetArchive->Open(mAssetArchiveFile.c_str());
+		if (result != AssetArchiveResult::Ok)
+		{
+			if (result != AssetArchiveResult::OpenFailed)
+				OutputDebugString((mAssetArchiveFile + L" is " + AnsiToWString(GetAssetArchiveResultName(result)) +
+					L"; reading the loose files\n").c_str());
+			mAssetArchive = nullptr;
+		}
+	}
+	d3dUtil::SetAssetArchive(mAssetArchive.get());
+
+	// Shaders are only compiled when they, or a file they include, have changed since
+	// the last run.
+	d3dUtil::SetShaderCacheDirectory(L"ShaderCache");
+
+	// The build steps run as a task graph.  Steps that record on mCommandList, or wait on
+	// the thread pool themselves, run here in turn; the rest run on the pool alongside
+	// them, so texture loading, shader compiling and geometry generation overlap.
+	// Worker tasks only read what other tasks built, once an edge orders them after it.
+	// They look maps up with at() or find(), never operator[], which may insert: tasks
+	// with no edge between them can be reading the same map at once.
+	TaskGraph init;
+	TaskGraph::TaskId textures = init.AddTask("LoadTextures", TaskThread::Main, {}, [this]() { LoadTextures(); });
+	TaskGraph::TaskId shaders = init.AddTask("BuildShadersAndInputLayout", TaskThread::Main, {},
+		[this]() { BuildShadersAndInputLayout(); });
+	TaskGraph::TaskId shapeGeometry = init.AddTask("BuildShapeGeometry", TaskThread::Worker, {},
+		[this]() { BuildShapeGeometry(); });
+	TaskGraph::TaskId treeGeometry = init.AddTask("BuildTreeSpritesGeometry", TaskThread::Worker, {},
+		[this]() { BuildTreeSpritesGeometry(); });
+	TaskGraph::TaskId materials = init.AddTask("BuildMaterials", TaskThread::Worker, {}, [this]() { BuildMaterials(); });
+	init.AddTask("BuildLights", TaskThread::Worker, {}, [this]() { BuildLights(); });
+
+	TaskGraph::TaskId rootSignature = init.AddTask("BuildRootSignature", TaskThread::Worker, {},
+		[this]() { BuildRootSignature(); });
+	TaskGraph::TaskId geometryUpload = init.AddTask("UploadGeometry", TaskThread::Main, { shapeGeometry, treeGeometry },
+		[this]() { UploadGeometry(); });
+	TaskGraph::TaskId texturesDone = init.AddTask("FinishTextures", TaskThread::Main, { textures },
+		[this]() { FinishTextures(); });
+	TaskGraph::TaskId animations = init.AddTask("BuildMaterialAnimations", TaskThread::Worker, { materials },
+		[this]() { BuildMaterialAnimations(); });
+	TaskGraph::TaskId renderItems = init.AddTask("BuildRenderItems", TaskThread::Worker,
+		{ shapeGeometry, treeGeometry, materials }, [this]() { BuildRenderItems(); });
+	init.AddTask("BuildFrameResources", TaskThread::Worker, { renderItems }, [this]() { BuildFrameResources(); });
+
+	// Rewrites the materials' texture slots, so it waits for everything that reads them.
+	TaskGraph::TaskId descriptorHeaps = init.AddTask("BuildDescriptorHeaps", TaskThread::Main,
+		{ texturesDone, animations, renderItems }, [this]() { BuildDescriptorHeaps(); });
+	TaskGraph::TaskId drawIndices = init.AddTask("BuildDrawIndices", TaskThread::Worker, { descriptorHeaps },
+		[this]() { BuildDrawIndices(); });
+	init.AddTask("BuildIndirectDraws", TaskThread::Worker, { rootSignature, geometryUpload, drawIndices },
+		[this]() { BuildIndirectDraws(); });
+	init.AddTask("BuildPSOs", TaskThread::Main, { shaders, rootSignature }, [this]() { BuildPSOs(); });
+	init.AddTask("BuildFrameGraph", TaskThread::Worker, {}, [this]() { BuildFrameGraph(); });
+
+	init.Run(mThreadPool.get());
+
+	std::wstring timings = L"Initialized in " + std::to_wstring(init.GetTotalMs()) + L" ms:\n";
+	for (const TaskTiming& timing : init.GetTimings())
+	{
+		timings += L"  " + AnsiToWString(timing.Name) + (timing.Thread == TaskThread::Main ? L" (main)" : L" (worker)") +
+			L" at " + std::to_wstring(timing.StartMs) + L" ms for " + std::to_wstring(timing.Ms) + L" ms\n";
+	}
+	OutputDebugString(timings.c_str());
 
 	// Execute the initialization commands.
 	ThrowIfFailed(mCommandList->Close());
@@ -227,6 +529,10 @@ bool ShapesApp::Initialize()
 	// Wait until initialization is complete.
 	FlushCommandQueue();
 
+	// The initial uploads have executed.
+	for (auto& tex : mTextures)
+		tex.second->UploadHeap = nullptr;
+
 	return true;
 }
  
@@ -237,6 +543,9 @@ void ShapesApp::OnResize()
     // The window resized, so update the aspect ratio and recompute the projection matrix.
     XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
     XMStoreFloat4x4(&mProj, P);
+
+    mLightClusters.Resize(mClientWidth, mClientHeight, mProj, 1.0f, 1000.0f);
+    mClusterGridResized = true;
 }
 
 void ShapesApp::Update(const GameTimer& gt)
@@ -250,14 +559,21 @@ void ShapesApp::Update(const GameTimer& gt)
 
 	// Has the GPU finished processing the commands of the current frame resource?
 	// If not, wait until the GPU has completed commands up to this fence point.
-	if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
+	// The pacer reuses its wait events and records how long we were blocked.
+	mFramePacer->WaitForFrame(mFence.Get(), mCurrFrameResource->Fence, mCurrentFence);
+
+	// The queue depth may only shrink below the number of frame resources, so
+	// the per-frame-resource dirty counts stay valid whatever the controller picks.
+	if (mLatencyController != nullptr)
 	{
-		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
+		int latency = mLatencyController->AddFrame(mFramePacer->GetLastFrameStats().CpuWaitMs);
+		mFramePacer->SetMaxFrameLatency((UINT)latency);
 	}
 
+	// Descriptors freed, or taken for one frame, by frames that have retired are free again.
+	mSrvHeap->BeginFrame(mFence->GetCompletedValue());
+
+	UpdateTextureStreaming();
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
@@ -274,45 +590,61 @@ void ShapesApp::Draw(const GameTimer& gt)
 
 	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
 	// Reusing the command list reuses memory.
-	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+	// The pipeline is set through the filter, so it knows what is bound.
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), nullptr));
+	mDrawList.Begin(mCommandList.Get());
+	mDrawList.SetPipelineState(mPipelineCache->Get(mPSOs["opaque"]));
 
 	mCommandList->RSSetViewports(1, &mScreenViewport);
 	mCommandList->RSSetScissorRects(1, &mScissorRect);
 
-	// Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-	// Clear the back buffer and depth buffer.
-	mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::Black, 0, nullptr);
-	mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-
 	// Specify the buffers we are going to render to.
 	mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->GetHeap() };
+	mDrawList.SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+	mDrawList.SetGraphicsRootSignature(mRootSignature.Get());
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+	// Every texture, material and object is reachable from these, so they are bound once
+	// per frame and each draw only sets its root constant.
+	mDrawList.SetGraphicsRootDescriptorTable(0, mSrvHeap->GetGpuHandle(0));
 
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	auto passCB = mCurrFrameResource->PassCB->Resource();
+	mDrawList.SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
-	mCommandList->SetPipelineState(mPSOs["alphaTested"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
+	mDrawList.SetGraphicsRootShaderResourceView(3, mCurrFrameResource->MaterialBuffer->Resource()->GetGPUVirtualAddress());
+	mDrawList.SetGraphicsRootShaderResourceView(7, mCurrFrameResource->ObjectBuffer->Resource()->GetGPUVirtualAddress());
 
-	mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+	mDrawList.SetGraphicsRootShaderResourceView(4, mCurrFrameResource->ClusterLightBuffer->Resource()->GetGPUVirtualAddress());
+	mDrawList.SetGraphicsRootShaderResourceView(5, mCurrFrameResource->ClusterRangeBuffer->Resource()->GetGPUVirtualAddress());
+	mDrawList.SetGraphicsRootShaderResourceView(6, mCurrFrameResource->ClusterIndexBuffer->Resource()->GetGPUVirtualAddress());
 
-	
-	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
+	// The passes draw the layers; the graph records the back buffer's transitions around them.
+	mGraphRecorder->SetResource(mBackBufferResource, CurrentBackBuffer());
+	mGraphRecorder->SetResource(mDepthResource, mDepthStencilBuffer.Get());
+	mGraphRecorder->Record(mFrameGraph, mCommandList.Get());
 
-	// Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	if (!mBindingStatsReported)
+	{
+		const BindingStats& bindingStats = mDrawList.GetStats();
+		std::wstring text = L"Bindings in the first frame: " + std::to_wstring(bindingStats.GetIssuedCount()) +
+			L" issued, " + std::to_wstring(bindingStats.GetElidedCount()) + L" elided\n";
+		for (int i = 0; i < (int)BindingCall::Count; ++i)
+		{
+			if (bindingStats.Issued[i] + bindingStats.Elided[i] == 0)
+				continue;
+			text += L"  " + AnsiToWString(GetBindingCallName((BindingCall)i)) + L": " + std::to_wstring(bindingStats.Issued[i]) +
+				L" issued, " + std::to_wstring(bindingStats.Elided[i]) + L" elided\n";
+		}
+		const IndirectDrawStats& indirectStats = mIndirectDrawBuilder.GetStats();
+		text += L"Indirect draws in the first frame: " + std::to_wstring(indirectStats.DrawCount) + L" of " +
+			std::to_wstring(indirectStats.ItemCount) + L" opaque items in one ExecuteIndirect, " +
+			std::to_wstring(indirectStats.CulledCount) + L" culled, built in " +
+			std::to_wstring(indirectStats.Seconds*1000.0) + L" ms\n";
+		OutputDebugString(text.c_str());
+		mBindingStatsReported = true;
+	}
 
 	// Done recording commands.
 	ThrowIfFailed(mCommandList->Close());
@@ -332,6 +664,62 @@ void ShapesApp::Draw(const GameTimer& gt)
 	// Because we are on the GPU timeline, the new fence point won't be 
 	// set until the GPU finishes processing all the commands prior to this Signal().
 	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	mSrvHeap->EndFrame(mCurrentFence);
+}
+
+// Each layer is a pass drawing into the back buffer and depth buffer.  Draw sets the
+// pipeline state for the first pass and binds everything they share before recording them.
+void ShapesApp::BuildFrameGraph()
+{
+	mGraphRecorder = std::make_unique<RenderGraphRecorder>(md3dDevice.Get());
+
+	mBackBufferResource = mFrameGraph.ImportResource("BackBuffer", RenderState_Present, RenderState_Present);
+	mDepthResource = mFrameGraph.ImportResource("DepthStencil", RenderState_DepthWrite, RenderState_DepthWrite);
+
+	RenderGraph::PassId opaque = mFrameGraph.AddPass("Opaque", [this]()
+	{
+		mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::Black, 0, nullptr);
+		mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+
+		DrawOpaqueIndirect();
+	});
+
+	RenderGraph::PassId alphaTested = mFrameGraph.AddPass("AlphaTested", [this]()
+	{
+		mDrawList.SetPipelineState(mPipelineCache->Get(mPSOs["alphaTested"]));
+		DrawRenderItems(mDrawList, mRitemLayer[(int)RenderLayer::AlphaTested]);
+	});
+
+	RenderGraph::PassId treeSprites = mFrameGraph.AddPass("TreeSprites", [this]()
+	{
+		mDrawList.SetPipelineState(mPipelineCache->Get(mPSOs["treeSprites"]));
+		DrawRenderItems(mDrawList, mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+	});
+
+	RenderGraph::PassId transparent = mFrameGraph.AddPass("Transparent", [this]()
+	{
+		mDrawList.SetPipelineState(mPipelineCache->Get(mPSOs["transparent"]));
+		DrawRenderItems(mDrawList, mRitemLayer[(int)RenderLayer::Transparent]);
+	});
+
+	for (RenderGraph::PassId pass : { opaque, alphaTested, treeSprites, transparent })
+	{
+		mFrameGraph.Write(pass, mBackBufferResource, RenderState_RenderTarget);
+		mFrameGraph.Write(pass, mDepthResource, RenderState_DepthWrite);
+	}
+
+	RenderGraphResult result = mFrameGraph.Compile();
+	if (result != RenderGraphResult::Ok)
+		ThrowIfFailed(E_INVALIDARG);
+
+	mGraphRecorder->Allocate(mFrameGraph);
+
+	const RenderGraphStats& stats = mFrameGraph.GetStats();
+	OutputDebugString((L"Frame graph: " + std::to_wstring(stats.PassCount - stats.CulledPassCount) + L" of " +
+		std::to_wstring(stats.PassCount) + L" passes, " + std::to_wstring(stats.BarrierCount) + L" barriers in " +
+		std::to_wstring(stats.BatchCount) + L" batches, " + std::to_wstring(stats.TransientCount) + L" transients in " +
+		std::to_wstring(stats.TransientHeapSize / 1024) + L" KB (" + std::to_wstring(stats.UnaliasedSize / 1024) +
+		L" KB unaliased)\n").c_str());
 }
 
 void ShapesApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -405,47 +793,12 @@ void ShapesApp::UpdateCamera(const GameTimer& gt)
 
 void ShapesApp::AnimateMaterials(const GameTimer& gt)
 {
-	// Scroll the water material texture coordinates.
-	auto waterMat = mMaterials["water0"].get();
-
-	float& tu = waterMat->MatTransform(3, 0);
-	float& tv = waterMat->MatTransform(3, 1);
-
-	tu -= 0.1f * gt.DeltaTime();
-	//tv -= 0.5f * gt.DeltaTime();
-
-	/*if (tu <= 0.0f)
-		tu += 1.0f;*/
-
-	if (tv <= 0.0f)
-		tv += 0.5f;
-
-	waterMat->MatTransform(3, 0) = tu;
-	waterMat->MatTransform(3, 1) = tv;
-
-	// Material has changed, so need to update cbuffer.
-	waterMat->NumFramesDirty = gNumFrameResources;
-
-	auto gutsymat = mMaterials["gutsy"].get();
-
-	float& tu2 = gutsymat->MatTransform(3, 0);
-	float& tv2 = gutsymat->MatTransform(3, 1);
-
-	tu2 += 0.1f  * gt.DeltaTime();
-	tv2 += 0.1f * gt.DeltaTime();
-
-
-
-	gutsymat->MatTransform(3, 0) = tu2;
-	gutsymat->MatTransform(3, 1) = tv2;
-
-	// Material has changed, so need to update cbuffer.
-	gutsymat->NumFramesDirty = gNumFrameResources;
+	mMaterialAnimator.Evaluate(gt.TotalTime());
 }
 
 void ShapesApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	auto currObjectBuffer = mCurrFrameResource->ObjectBuffer.get();
 	for (auto& e : mAllRitems)
 	{
 		// Only update the cbuffer data if the constants have changed.  
@@ -462,7 +815,7 @@ void ShapesApp::UpdateObjectCBs(const GameTimer& gt)
 			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
 
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+			currObjectBuffer->CopyData(e->ObjCBIndex, objConstants);
 
 			// Next FrameResource need to be updated too.
 			e->NumFramesDirty--;
@@ -472,7 +825,7 @@ void ShapesApp::UpdateObjectCBs(const GameTimer& gt)
 
 void ShapesApp::UpdateMaterialCBs(const GameTimer& gt)
 {
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
+	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for (auto& e : mMaterials)
 	{
 		// Only update the cbuffer data if the constants have changed.  If the cbuffer
@@ -487,8 +840,10 @@ void ShapesApp::UpdateMaterialCBs(const GameTimer& gt)
 			matConstants.FresnelR0 = mat->FresnelR0;
 			matConstants.Roughness = mat->Roughness;
 			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+			matConstants.DiffuseSrvIndex = (UINT)mat->DiffuseSrvHeapIndex;
+			matConstants.DiffuseArraySlice = (UINT)mat->DiffuseArraySlice;
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+			currMaterialBuffer->CopyData(mat->MatCBIndex, matConstants);
 
 			// Next FrameResource need to be updated too.
 			mat->NumFramesDirty--;
@@ -498,248 +853,317 @@ void ShapesApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void ShapesApp::UpdateMainPassCB(const GameTimer& gt)
 {
-	XMMATRIX view = XMLoadFloat4x4(&mView);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
-
-	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
-	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
-	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
-	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-
-	mMainPassCB.EyePosW = mEyePos;
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
-	mMainPassCB.TotalTime = gt.TotalTime();
-	mMainPassCB.DeltaTime = gt.DeltaTime();
-
-	//lights
-	mMainPassCB.AmbientLight = { 0.2f, 0.2f, 0.2f, 0.5f };
-	//directional light
-	mMainPassCB.Lights[0].Direction = { -0.5f, -0.35f, 0.5f };
-	mMainPassCB.Lights[0].Strength = { 0.8f, 0.5, 0.3f };
-	//pointlights
-	mMainPassCB.Lights[1].Position = { -25.0f, 5.5f, -25.0f };
-	mMainPassCB.Lights[1].Strength = { 2.0f, 1.0f, 0.0f };
-	mMainPassCB.Lights[2].Position = { 25.0f, 5.5f, -25.0f };
-	mMainPassCB.Lights[2].Strength = { 2.0f, 1.0f, 0.0f };
-	mMainPassCB.Lights[3].Position = { -26.0f, 5.5f, 25.0f };
-	mMainPassCB.Lights[3].Strength = { 2.0f, 1.0f, 0.0f };
-	mMainPassCB.Lights[4].Position = { 26.0f, 5.5f, 25.0f };
-	mMainPassCB.Lights[4].Strength = { 1.0, 0.0f, 0.0f };
-	mMainPassCB.Lights[5].Position = { 0.0f, 5.5f, -25.0f };
-	mMainPassCB.Lights[5].Strength = { 1.0, 0.0f, 0.0f };
-	mMainPassCB.Lights[6].Position = { -26.0f, 5.5f, 0.5f };
-	mMainPassCB.Lights[6].Strength = { 1.0, 0.0f, 0.0f };
-	mMainPassCB.Lights[7].Position = { 26.0f, 5.5f, 0.0f };
-	mMainPassCB.Lights[7].Strength = { 1.0, 0.0f, 0.0f };
-	mMainPassCB.Lights[8].Position = { 0.0f, 5.5f, 25.0f };
-	mMainPassCB.Lights[8].Strength = { 1.0, 0.0f, 0.0f };
-	//spotlight
-	mMainPassCB.Lights[9].Position = { 0.0f, 5.0f, 00.0f };
-	mMainPassCB.Lights[9].Direction = { 0.0f, 0.0f, 0.0f };
-	mMainPassCB.Lights[9].SpotPower = 3.0f;
-	mMainPassCB.Lights[9].Strength = { 2.1f, 2.1f, 2.1f };
-	mMainPassCB.Lights[9].FalloffEnd = 20.0f;
+	mMainPassBuilder.BeginFrame();
 
+	bool cameraChanged = mMainPassBuilder.SetCamera(mView, mProj, mEyePos);
+	mMainPassBuilder.SetRenderTarget((float)mClientWidth, (float)mClientHeight, 1.0f, 1000.0f);
+	mMainPassBuilder.SetTime(gt.TotalTime(), gt.DeltaTime());
+	mMainPassBuilder.SetLights(mLightStore);
+
+	UpdateLightClusters(cameraChanged);
+	mMainPassBuilder.SetClusters(mLightClusters);
 
-	
 	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	mMainPassBuilder.Upload(currPassCB, 0);
+
+	// Every thousand frames, what keeping the pass constants current costs and how
+	// often the camera and light blocks actually had to move.
+	const PassConstantsStats& passStats = mMainPassBuilder.GetStats();
+	if (passStats.Frames % 1000 == 0)
+	{
+		OutputDebugString((L"Pass constants: " + std::to_wstring(passStats.LastUpdateMs) + L" ms last frame; over " +
+			std::to_wstring(passStats.Frames) + L" frames the camera block was rebuilt " +
+			std::to_wstring(passStats.CameraRebuilds) + L" times and uploaded " + std::to_wstring(passStats.CameraUploads) +
+			L", the light block rebuilt " + std::to_wstring(passStats.LightRebuilds) + L" and uploaded " +
+			std::to_wstring(passStats.LightUploads) + L"\n").c_str());
+	}
 }
 
-void ShapesApp::LoadTextures()
+void ShapesApp::UpdateLightClusters(bool cameraChanged)
 {
-	auto bricksTex = std::make_unique<Texture>();
-	bricksTex->Name = "bricksTex";
-	bricksTex->Filename = L"Textures/BloodWall.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), bricksTex->Filename.c_str(),
-		bricksTex->Resource, bricksTex->UploadHeap));
-
-	auto stoneTex = std::make_unique<Texture>();
-	stoneTex->Name = "stoneTex";
-	stoneTex->Filename = L"Textures/bricks.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), stoneTex->Filename.c_str(),
-		stoneTex->Resource, stoneTex->UploadHeap));
-
-	auto sandTex = std::make_unique<Texture>();
-	sandTex->Name = "sandTex";
-	sandTex->Filename = L"Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), sandTex->Filename.c_str(),
-		sandTex->Resource, sandTex->UploadHeap));
-
-	auto waterTex = std::make_unique<Texture>();
-	waterTex->Name = "waterTex";
-	waterTex->Filename = L"Textures/lava.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), waterTex->Filename.c_str(),
-		waterTex->Resource, waterTex->UploadHeap));
-
-	auto iceTex = std::make_unique<Texture>();
-	iceTex->Name = "iceTex";
-	iceTex->Filename = L"Textures/corona.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), iceTex->Filename.c_str(),
-		iceTex->Resource, iceTex->UploadHeap));
-
-	auto redTex = std::make_unique<Texture>();
-	redTex->Name = "redTex";
-	redTex->Filename = L"Textures/gutsy.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), redTex->Filename.c_str(),
-		redTex->Resource, redTex->UploadHeap));
-
-	auto flagTex = std::make_unique<Texture>();
-	flagTex->Name = "flagTex";
-	flagTex->Filename = L"Textures/Dragon1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), flagTex->Filename.c_str(),
-		flagTex->Resource, flagTex->UploadHeap));
-
-	auto boneTex = std::make_unique<Texture>();
-	boneTex->Name = "boneTex";
-	boneTex->Filename = L"Textures/door.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), boneTex->Filename.c_str(),
-		boneTex->Resource, boneTex->UploadHeap));
-
-	auto treeArrayTex = std::make_unique<Texture>();
-	treeArrayTex->Name = "treeArrayTex";
-	treeArrayTex->Filename = L"Textures/treeArray.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), treeArrayTex->Filename.c_str(),
-		treeArrayTex->Resource, treeArrayTex->UploadHeap));
-
-
-
-	mTextures[bricksTex->Name] = std::move(bricksTex);
-	mTextures[stoneTex->Name] = std::move(stoneTex);
-	mTextures[sandTex->Name] = std::move(sandTex);
-	mTextures[waterTex->Name] = std::move(waterTex);
-	mTextures[iceTex->Name] = std::move(iceTex);
-	mTextures[redTex->Name] = std::move(redTex);
-	mTextures[flagTex->Name] = std::move(flagTex);
-	mTextures[boneTex->Name] = std::move(boneTex);
-	mTextures[treeArrayTex->Name] = std::move(treeArrayTex);
-	
+	bool lightsChanged = mLightStore.GetVersion() != mClusterLightVersion;
+	if (lightsChanged)
+	{
+		mPointLights.clear();
+		mSpotLights.clear();
+		mLightStore.Gather(LightType::Point, mPointLights);
+		mLightStore.Gather(LightType::Spot, mSpotLights);
+		mClusterLightVersion = mLightStore.GetVersion();
+	}
+
+	if (cameraChanged || lightsChanged || mClusterGridResized)
+	{
+		mLightClusters.Build(mView,
+			mPointLights.data(), (UINT)mPointLights.size(),
+			mSpotLights.data(), (UINT)mSpotLights.size());
+
+		mClusterFramesDirty = gNumFrameResources;
+		mClusterGridResized = false;
+	}
+
+	// The GPU is done with this frame resource, so the buffers can be regrown if needed.
+	const auto& lights = mLightClusters.GetLights();
+	const auto& ranges = mLightClusters.GetClusterRanges();
+	const auto& indices = mLightClusters.GetLightIndices();
 
+	mCurrFrameResource->ReserveClusterBuffers(md3dDevice.Get(),
+		(UINT)lights.size(), (UINT)ranges.size(), (UINT)indices.size());
 
+	// Like NumFramesDirty, each frame resource needs its own copy of a rebuild.
+	if (mClusterFramesDirty > 0)
+	{
+		if (!lights.empty())
+			mCurrFrameResource->ClusterLightBuffer->CopyData(0, lights.data(), (UINT)lights.size());
+		if (!ranges.empty())
+			mCurrFrameResource->ClusterRangeBuffer->CopyData(0, ranges.data(), (UINT)ranges.size());
+		if (!indices.empty())
+			mCurrFrameResource->ClusterIndexBuffer->CopyData(0, indices.data(), (UINT)indices.size());
+
+		mClusterFramesDirty--;
+	}
 }
-//If we have 3 frame resources and n render items, then we have three 3n object constant
-//buffers and 3 pass constant buffers.Hence we need 3(n + 1) constant buffer views(CBVs).
-//Thus we will need to modify our CBV heap to include the additional descriptors :
 
-void ShapesApp::BuildDescriptorHeaps()
+void ShapesApp::UpdateTextureStreaming()
 {
-	//
-	 // Create the SRV heap.
-	 //
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 10;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
+	mTextureStreamer->BeginFrame();
+	mTextureResidency->BeginFrame();
 
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto bricksTex = mTextures["bricksTex"]->Resource;
-	auto stoneTex = mTextures["stoneTex"]->Resource;
-	auto sandTex = mTextures["sandTex"]->Resource;
-	auto redTex = mTextures["redTex"]->Resource;
-	auto waterTex = mTextures["waterTex"]->Resource;
-	auto iceTex = mTextures["iceTex"]->Resource;
-	auto flagTex = mTextures["flagTex"]->Resource;
-	auto boneTex = mTextures["boneTex"]->Resource;
-	auto treeArrayTex = mTextures["treeArrayTex"]->Resource;
-	
+	// Screen pixels covered by one world unit at a view distance of one.
+	float pixelsPerUnit = 0.5f * mProj(1, 1) * (float)mClientHeight;
 
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = bricksTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = bricksTex->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	md3dDevice->CreateShaderResourceView(bricksTex.Get(), &srvDesc, hDescriptor);
+	XMVECTOR eyePos = XMLoadFloat3(&mEyePos);
+	for (auto& ri : mAllRitems)
+	{
+		auto it = mStreamedMaterials.find(ri->Mat);
+		if (it == mStreamedMaterials.end())
+			continue;
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+		BoundingBox bounds;
+		ri->Bounds.Transform(bounds, XMLoadFloat4x4(&ri->World));
 
-	srvDesc.Format = stoneTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = stoneTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(stoneTex.Get(), &srvDesc, hDescriptor);
+		// Diameter of the bounds in pixels.  Close up, treat the item as filling the screen.
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - eyePos));
+		float pixels = 2.0f * radius * pixelsPerUnit / MathHelper::Max(distance - radius, 1.0f);
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+		// A texture tiled n times across the item needs n times the texels.
+		XMFLOAT4X4 texTransform;
+		XMStoreFloat4x4(&texTransform, XMLoadFloat4x4(&ri->TexTransform) * XMLoadFloat4x4(&ri->Mat->MatTransform));
+		float tiling = MathHelper::Max(fabsf(texTransform(0, 0)), fabsf(texTransform(1, 1)));
 
-	srvDesc.Format = sandTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = sandTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(sandTex.Get(), &srvDesc, hDescriptor);
+		mTextureStreamer->AddFootprint(it->second, pixels * MathHelper::Max(tiling, 1.0f));
+	}
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	mTextureUploader->SetFrameFence(mFence.Get(), mCurrentFence);
+	mTextureStreamer->Update();
+	mTextureUploader->Flush();
+}
 
-	srvDesc.Format = redTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = redTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(redTex.Get(), &srvDesc, hDescriptor);
+void ShapesApp::LoadTextures()
+{
+	struct TextureFile
+	{
+		std::string Name;
+		std::wstring Filename;
+		bool Streamed;
+	};
 
-	//// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	const TextureFile textureFiles[] =
+	{
+		{ "bricksTex", L"Textures/BloodWall.dds", true },
+		{ "stoneTex", L"Textures/bricks.dds", true },
+		{ "sandTex", L"Textures/grass.dds", true },
+		{ "waterTex", L"Textures/lava.dds", true },
+		{ "iceTex", L"Textures/corona.dds", true },
+		{ "redTex", L"Textures/gutsy.dds", true },
+		{ "flagTex", L"Textures/Dragon1.dds", true },
+		{ "boneTex", L"Textures/door.dds", true },
+		{ "treeArrayTex", L"Textures/treeArray.dds", false }
+	};
+
+	// The files are read and parsed on the thread pool; only the resource creation
+	// and upload recording in Finish happen on this thread.  Uncompressed textures
+	// (treeArray) get a full mip chain and are then converted to BC7 as they load;
+	// legacy layouts the device can't sample are expanded to RGBA8 before that.
+	mTextureLoader = std::make_unique<TextureLoader>(*mThreadPool);
+	mTextureLoader->SetPixelConversion(md3dDevice.Get());
+	mTextureLoader->SetMipGeneration(MipFilter::Kaiser, true);
+	mTextureLoader->SetCompression(BCFormat::BC7, BCQuality::Normal);
+	mTextureLoader->SetAssetArchive(mAssetArchive.get());
+
+	// Streamed textures only load their mip tail here, which is small enough to do
+	// inline.  Those with the same size, format and mip count are packed into a
+	// texture array first, so their materials share one descriptor table.
+	std::vector<const TextureFile*> streamedFiles;
+	for (const auto& file : textureFiles)
+	{
+		if (file.Streamed)
+		{
+			streamedFiles.push_back(&file);
+		}
+		else
+		{
+			auto tex = std::make_unique<Texture>();
+			tex->Name = file.Name;
+			tex->Filename = file.Filename;
+			mTextureLoader->Enqueue(tex.get());
+			mTextures[tex->Name] = std::move(tex);
+		}
+	}
+
+	// The files the archive holds are decompressed together on the pool; the rest are
+	// mapped.  Unreadable files end up in groups of one and fail in LoadTexture with the
+	// reason.
+	std::vector<int32_t> archiveEntries(streamedFiles.size(), -1);
+	std::vector<uint32_t> archived;
+	for (size_t i = 0; i < streamedFiles.size() && mAssetArchive != nullptr; ++i)
+	{
+		archiveEntries[i] = mAssetArchive->Find(streamedFiles[i]->Filename);
+		if (archiveEntries[i] >= 0)
+			archived.push_back((uint32_t)archiveEntries[i]);
+	}
+
+	std::vector<std::vector<uint8_t>> archivedData;
+	if (!archived.empty() && mAssetArchive->ReadEntries(archived, archivedData, mThreadPool.get()) != AssetArchiveResult::Ok)
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT));
+
+	std::vector<std::unique_ptr<MappedFile>> mappedFiles;
+	std::vector<DDSFileView> fileViews(streamedFiles.size());
+	std::vector<DDSTextureDesc> descs(streamedFiles.size());
+	for (size_t i = 0, nextArchived = 0; i < streamedFiles.size(); ++i)
+	{
+		if (archiveEntries[i] >= 0)
+		{
+			const std::vector<uint8_t>& data = archivedData[nextArchived++];
+			fileViews[i] = { data.data(), data.size() };
+		}
+		else
+		{
+			auto file = std::make_unique<MappedFile>();
+			if (file->Open(streamedFiles[i]->Filename.c_str()))
+				fileViews[i] = { file->GetData(), (size_t)file->GetSize() };
+			mappedFiles.push_back(std::move(file));
+		}
+
+		if (fileViews[i].Data != nullptr)
+			ParseDDSTexture(fileViews[i].Data, fileViews[i].Size, descs[i]);
+	}
 
-	srvDesc.Format = waterTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = waterTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(waterTex.Get(), &srvDesc, hDescriptor);
+	for (const auto& group : GroupDDSTexturesForArrays(descs.data(), descs.size()))
+	{
+		auto tex = std::make_unique<Texture>();
+		uint32_t id = 0;
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+		if (group.size() == 1)
+		{
+			tex->Name = streamedFiles[group[0]]->Name;
+			tex->Filename = streamedFiles[group[0]]->Filename;
+			if (archiveEntries[group[0]] >= 0)
+			{
+				const DDSFileView& view = fileViews[group[0]];
+				id = mTextureUploader->LoadTexture(mCommandList.Get(), tex.get(), view.Data, view.Size, 64);
+			}
+			else
+			{
+				id = mTextureUploader->LoadTexture(mCommandList.Get(), tex.get(), 64);
+			}
+		}
+		else
+		{
+			std::vector<DDSFileView> views;
+			for (size_t i : group)
+			{
+				tex->Name += (tex->Name.empty() ? "" : "+") + streamedFiles[i]->Name;
+				views.push_back(fileViews[i]);
+			}
+
+			std::vector<uint8_t> packed;
+			if (PackDDSTextureArray(views.data(), views.size(), packed) != DDS_RESULT_OK)
+				ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+			id = mTextureUploader->LoadTexture(mCommandList.Get(), tex.get(), packed.data(), packed.size(), 64);
+		}
 
-	srvDesc.Format = iceTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = iceTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(iceTex.Get(), &srvDesc, hDescriptor);
+		uint32_t streamerId = mTextureStreamer->AddTexture(mTextureUploader->GetDesc(id));
+		uint32_t residencyId = mTextureResidency->AddTexture(mTextureUploader->GetMipBytes(id),
+			mTextureUploader->GetDesc(id).ResidentMip, mTextureUploader->GetResourceBaseMips(id));
+		assert(id == streamerId && id == residencyId);
+		mStreamedTextureCount = id + 1;
 
+		for (size_t slice = 0; slice < group.size(); ++slice)
+			mStreamedTextures[streamedFiles[group[slice]]->Name] = { id, (UINT)slice };
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+		mTextures[tex->Name] = std::move(tex);
+	}
 
-	srvDesc.Format = flagTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = flagTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(flagTex.Get(), &srvDesc, hDescriptor);
+	OutputDebugString((L"Packed " + std::to_wstring(streamedFiles.size()) + L" streamed textures into " +
+		std::to_wstring(mStreamedTextureCount) + L" texture resources\n").c_str());
+}
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+void ShapesApp::FinishTextures()
+{
+	mTextureLoader->Finish(md3dDevice.Get(), mCommandList.Get());
+
+	const TextureLoadStats& stats = mTextureLoader->GetStats();
+	std::wstring text = L"Loaded " + std::to_wstring(stats.TextureCount) + L" textures in " +
+		std::to_wstring(stats.TotalMs) + L" ms (load " + std::to_wstring(stats.LoadMs) +
+		L" ms, create " + std::to_wstring(stats.CreateMs) + L" ms, " +
+		std::to_wstring(stats.ConvertedCount) + L" converted in " + std::to_wstring(stats.ConvertMs) + L" ms, " +
+		std::to_wstring(stats.MipGeneratedCount) + L" mipmapped in " + std::to_wstring(stats.MipGenerateMs) + L" ms, " +
+		std::to_wstring(stats.CompressedCount) + L" compressed in " + std::to_wstring(stats.CompressMs) + L" ms)\n";
+	OutputDebugString(text.c_str());
+
+	mTextureLoader = nullptr;
+}
 
-	srvDesc.Format = boneTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(boneTex.Get(), &srvDesc, hDescriptor);
+//If we have 3 frame resources and n render items, then we have three 3n object constant
+//buffers and 3 pass constant buffers.Hence we need 3(n + 1) constant buffer views(CBVs).
+//Thus we will need to modify our CBV heap to include the additional descriptors :
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+void ShapesApp::BuildDescriptorHeaps()
+{
+	// The persistent part of the heap is the shaders' texture table.  Each streamed texture
+	// (a single texture or a packed array) gets a current slot and a spare one, so its mip
+	// clamp can change without rewriting a descriptor an in-flight frame may be reading.
+	// Materials store their texture's slot in DiffuseSrvHeapIndex.
+	auto& treeArrayTex = mTextures["treeArrayTex"];
+	auto treeArrayResource = treeArrayTex->Resource;
 
-	auto desc = treeArrayTex->GetDesc();
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-	srvDesc.Format = treeArrayTex->GetDesc().Format;
+	srvDesc.Format = treeArrayResource->GetDesc().Format;
 	srvDesc.Texture2DArray.MostDetailedMip = 0;
 	srvDesc.Texture2DArray.MipLevels = -1;
 	srvDesc.Texture2DArray.FirstArraySlice = 0;
-	srvDesc.Texture2DArray.ArraySize = treeArrayTex->GetDesc().DepthOrArraySize;
-	md3dDevice->CreateShaderResourceView(treeArrayTex.Get(), &srvDesc, hDescriptor);
+	srvDesc.Texture2DArray.ArraySize = treeArrayResource->GetDesc().DepthOrArraySize;
+	treeArrayTex->SrvHeapIndex = (int)mSrvHeap->CreateSrv(treeArrayResource.Get(), &srvDesc);
 
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	mTextureUploader->SetSrvHeap(mSrvHeap.get());
+	for (UINT id = 0; id < mStreamedTextureCount; ++id)
+		mTextureUploader->CreateSrvs(id);
 
-	
+	for (auto& m : mMaterials)
+	{
+		Material* mat = m.second.get();
+
+		auto it = mStreamedTextures.find(mat->DiffuseTexture);
+		if (it == mStreamedTextures.end())
+		{
+			mat->DiffuseSrvHeapIndex = mTextures[mat->DiffuseTexture]->SrvHeapIndex;
+			mat->NumFramesDirty = gNumFrameResources;
+			continue;
+		}
+
+		mat->DiffuseArraySlice = (int)it->second.ArraySlice;
+		mTextureUploader->BindMaterial(it->second.Id, mat);
+		mStreamedMaterials[mat] = it->second.Id;
+	}
+
+	DescriptorAllocatorStats stats = mSrvHeap->GetStats();
+	OutputDebugString((L"SRV heap: " + std::to_wstring(stats.PersistentAllocated) + L" of " +
+		std::to_wstring(stats.PersistentCapacity) + L" slots, " + std::to_wstring(stats.FreeRangeCount) +
+		L" free ranges, fragmentation " + std::to_wstring(stats.Fragmentation) + L"\n").c_str());
 }
 
 
@@ -747,25 +1171,35 @@ void ShapesApp::BuildDescriptorHeaps()
 //how those resources get mapped to shader input registers. there is a limit of 64 DWORDs that can be put in a root signature.
 void ShapesApp::BuildRootSignature()
 {
+	// Every texture in one range; the pixel shader picks one with its material's
+	// DiffuseSrvIndex.
 	CD3DX12_DESCRIPTOR_RANGE texTable;
 	texTable.Init(
 		D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
-		1,  // number of descriptors
-		0); // register t0
+		gSrvHeapPersistentCount,  // number of descriptors
+		0,  // register t0
+		1); // space1
 
 	// Root parameter can be a table, root descriptor or root constants.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[8];
 
 	// Performance TIP: Order from most frequent to least frequent.
 	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-	slotRootParameter[1].InitAsConstantBufferView(0); // register b0
+	slotRootParameter[1].InitAsConstants(1, 0); // register b0, the draw index
 	slotRootParameter[2].InitAsConstantBufferView(1); // register b1
-	slotRootParameter[3].InitAsConstantBufferView(2); // register b2
+	slotRootParameter[3].InitAsShaderResourceView(4); // register t4, materials
+
+	// Clustered lighting: light list, per-cluster ranges and light indices.
+	slotRootParameter[4].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_PIXEL); // register t1
+	slotRootParameter[5].InitAsShaderResourceView(2, 0, D3D12_SHADER_VISIBILITY_PIXEL); // register t2
+	slotRootParameter[6].InitAsShaderResourceView(3, 0, D3D12_SHADER_VISIBILITY_PIXEL); // register t3
+
+	slotRootParameter[7].InitAsShaderResourceView(5, 0, D3D12_SHADER_VISIBILITY_VERTEX); // register t5, objects
 
 	auto staticSamplers = GetStaticSamplers();
 
 	// A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(8, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -786,30 +1220,77 @@ void ShapesApp::BuildRootSignature()
 		serializedRootSig->GetBufferPointer(),
 		serializedRootSig->GetBufferSize(),
 		IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+
+	mPipelineCache->AddRootSignature(mRootSignature.Get(), serializedRootSig.Get());
 }
 
 void ShapesApp::BuildShadersAndInputLayout()
 {
-
-	const D3D_SHADER_MACRO defines[] =
+	mShaderLibrary = std::make_unique<ShaderLibrary>(
+		std::vector<std::wstring>{ L"Shaders\\color.hlsl", L"Shaders\\TreeSprite.hlsl" }, "5_1");
+
+	// The light counts are the ones each shader defaults to; they are passed explicitly
+	// so every variant is named by its key.
+	ShaderPermutation colorShader;
+	colorShader.Program = ColorProgram;
+	colorShader.NumDirLights = 1;
+
+	ShaderPermutation treeSpriteShader;
+	treeSpriteShader.Program = TreeSpriteProgram;
+	treeSpriteShader.NumDirLights = 1;
+
+	std::vector<std::pair<std::string, ShaderPermutation>> permutations;
+
+	colorShader.Stage = ShaderStage::Vertex;
+	permutations.push_back({ "standardVS", colorShader });
+	colorShader.Stage = ShaderStage::Pixel;
+	colorShader.Fog = true;
+	permutations.push_back({ "opaquePS", colorShader });
+	colorShader.AlphaTest = true;
+	permutations.push_back({ "alphaTestedPS", colorShader });
+
+	treeSpriteShader.Stage = ShaderStage::Vertex;
+	permutations.push_back({ "treeSpriteVS", treeSpriteShader });
+	treeSpriteShader.Stage = ShaderStage::Geometry;
+	permutations.push_back({ "treeSpriteGS", treeSpriteShader });
+	treeSpriteShader.Stage = ShaderStage::Pixel;
+	treeSpriteShader.Fog = true;
+	treeSpriteShader.AlphaTest = true;
+	permutations.push_back({ "treeSpritePS", treeSpriteShader });
+
+	std::vector<ShaderPermutationKey> manifest;
+	for(const auto& permutation : permutations)
 	{
-		"FOG", "1",
-		NULL, NULL
-	};
+		ShaderPermutationKey key = 0;
+		if(!MakePermutationKey(permutation.second, key))
+			ThrowIfFailed(E_INVALIDARG);
 
-	const D3D_SHADER_MACRO alphaTestDefines[] =
-	{
-		"FOG", "1",
-		"ALPHA_TEST", "1",
-		NULL, NULL
-	};
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\color.hlsl", defines, "PS", "ps_5_1");
-	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\color.hlsl", alphaTestDefines, "PS", "ps_5_1");
+		mShaders[permutation.first] = key;
+		manifest.push_back(key);
+	}
 
-	mShaders["treeSpriteVS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["treeSpriteGS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_1");
-	mShaders["treeSpritePS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_1");
+	// d3dUtil::CompileShader throws on a compile error; Build waits for every task before
+	// letting it out.
+	bool built = mShaderLibrary->Build(manifest,
+		[](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+		{
+			d3dUtil::CompileShader(request, bytecode);
+			return true;
+		},
+		mThreadPool.get());
+	if(!built)
+		ThrowIfFailed(E_FAIL);
+
+	const ShaderLibraryStats& libraryStats = mShaderLibrary->GetStats();
+	OutputDebugString((L"Shader permutations: " + std::to_wstring(libraryStats.PermutationCount) + L" (" +
+		std::to_wstring(libraryStats.UniqueCount) + L" unique) in " +
+		std::to_wstring(libraryStats.Seconds * 1000.0) + L" ms\n").c_str());
+
+	ShaderCacheStats cacheStats = d3dUtil::GetShaderCacheStats();
+	OutputDebugString((L"Shaders: " + std::to_wstring(cacheStats.Hits) + L" cached, " +
+		std::to_wstring(cacheStats.Misses + cacheStats.Uncached) + L" compiled (preprocess " +
+		std::to_wstring(cacheStats.PreprocessMs) + L" ms, load " + std::to_wstring(cacheStats.LoadMs) +
+		L" ms, compile " + std::to_wstring(cacheStats.CompileMs) + L" ms)\n").c_str());
 
 	mStdInputLayout =
 	{
@@ -825,6 +1306,12 @@ void ShapesApp::BuildShadersAndInputLayout()
 	};
 }
 
+D3D12_SHADER_BYTECODE ShapesApp::GetShader(const std::string& name)const
+{
+	ShaderBytecodeView view = mShaderLibrary->GetBytecode(mShaders.at(name));
+	return { view.Data, view.Size };
+}
+
 void ShapesApp::BuildShapeGeometry()
 {
     GeometryGenerator geoGen;
@@ -1085,12 +1572,6 @@ void ShapesApp::BuildShapeGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -1110,6 +1591,26 @@ void ShapesApp::BuildShapeGeometry()
 	geo->DrawArgs["water"] = waterSubmesh;
 	geo->DrawArgs["grid2"] = grid2Submesh;
 
+	// Bounds of each submesh, from the vertices it actually draws.
+	for (auto& e : geo->DrawArgs)
+	{
+		SubmeshGeometry& submesh = e.second;
+
+		XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+		XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+		for (UINT i = 0; i < submesh.IndexCount; ++i)
+		{
+			const Vertex& v = vertices[submesh.BaseVertexLocation + indices[submesh.StartIndexLocation + i]];
+			XMVECTOR P = XMLoadFloat3(&v.Pos);
+			vMin = XMVectorMin(vMin, P);
+			vMax = XMVectorMax(vMax, P);
+		}
+
+		if (submesh.IndexCount > 0)
+			BoundingBox::CreateFromPoints(submesh.Bounds, vMin, vMax);
+	}
+
+	std::lock_guard<std::mutex> lock(mGeometryMutex);
 	mGeometries[geo->Name] = std::move(geo);
 }
 void ShapesApp::BuildTreeSpritesGeometry()
@@ -1177,12 +1678,6 @@ void ShapesApp::BuildTreeSpritesGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof(TreeSpriteVertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -1195,9 +1690,32 @@ void ShapesApp::BuildTreeSpritesGeometry()
 
 	geo->DrawArgs["points"] = submesh;
 
+	std::lock_guard<std::mutex> lock(mGeometryMutex);
 	mGeometries["treeSpritesGeo"] = std::move(geo);
 }
 
+// The builders only fill in the CPU copies; the GPU buffers are created here, on the
+// thread that owns mCommandList, and made readable together by one barrier batch.
+void ShapesApp::UploadGeometry()
+{
+	std::vector<D3D12_RESOURCE_BARRIER> readBarriers;
+	for (auto& e : mGeometries)
+	{
+		MeshGeometry* geo = e.second.get();
+
+		geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+			geo->VertexBufferCPU->GetBufferPointer(), geo->VertexBufferByteSize, geo->VertexBufferUploader,
+			readBarriers);
+
+		geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+			geo->IndexBufferCPU->GetBufferPointer(), geo->IndexBufferByteSize, geo->IndexBufferUploader,
+			readBarriers);
+	}
+
+	if (!readBarriers.empty())
+		mCommandList->ResourceBarrier((UINT)readBarriers.size(), readBarriers.data());
+}
+
 void ShapesApp::BuildPSOs()
 {
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
@@ -1208,16 +1726,8 @@ void ShapesApp::BuildPSOs()
 	ZeroMemory(&opaquePsoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	opaquePsoDesc.InputLayout = { mStdInputLayout.data(), (UINT)mStdInputLayout.size() };
 	opaquePsoDesc.pRootSignature = mRootSignature.Get();
-	opaquePsoDesc.VS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()),
-		mShaders["standardVS"]->GetBufferSize()
-	};
-	opaquePsoDesc.PS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()),
-		mShaders["opaquePS"]->GetBufferSize()
-	};
+	opaquePsoDesc.VS = GetShader("standardVS");
+	opaquePsoDesc.PS = GetShader("opaquePS");
 	opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
@@ -1233,7 +1743,7 @@ void ShapesApp::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+	mPSOs["opaque"] = mPipelineCache->Request(opaquePsoDesc);
 
 	//
 	// PSO for transparent objects
@@ -1256,46 +1766,40 @@ void ShapesApp::BuildPSOs()
 	//transparentPsoDesc.BlendState.AlphaToCoverageEnable = true;
 
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&mPSOs["transparent"])));
+	mPSOs["transparent"] = mPipelineCache->Request(transparentPsoDesc, true);
 
 	//
 	// PSO for alpha tested objects
 	//
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaTestedPsoDesc = opaquePsoDesc;
-	alphaTestedPsoDesc.PS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["alphaTestedPS"]->GetBufferPointer()),
-		mShaders["alphaTestedPS"]->GetBufferSize()
-	};
+	alphaTestedPsoDesc.PS = GetShader("alphaTestedPS");
 	alphaTestedPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&alphaTestedPsoDesc, IID_PPV_ARGS(&mPSOs["alphaTested"])));
+	mPSOs["alphaTested"] = mPipelineCache->Request(alphaTestedPsoDesc, true);
 
 	//
 	// PSO for tree sprites
 	//
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC treeSpritePsoDesc = opaquePsoDesc;
-	treeSpritePsoDesc.VS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["treeSpriteVS"]->GetBufferPointer()),
-		mShaders["treeSpriteVS"]->GetBufferSize()
-	};
-	treeSpritePsoDesc.GS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["treeSpriteGS"]->GetBufferPointer()),
-		mShaders["treeSpriteGS"]->GetBufferSize()
-	};
-	treeSpritePsoDesc.PS =
-	{
-		reinterpret_cast<BYTE*>(mShaders["treeSpritePS"]->GetBufferPointer()),
-		mShaders["treeSpritePS"]->GetBufferSize()
-	};
+	treeSpritePsoDesc.VS = GetShader("treeSpriteVS");
+	treeSpritePsoDesc.GS = GetShader("treeSpriteGS");
+	treeSpritePsoDesc.PS = GetShader("treeSpritePS");
 	//step1
 	treeSpritePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
 	treeSpritePsoDesc.InputLayout = { mTreeSpriteInputLayout.data(), (UINT)mTreeSpriteInputLayout.size() };
 	treeSpritePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&treeSpritePsoDesc, IID_PPV_ARGS(&mPSOs["treeSprites"])));
+	mPSOs["treeSprites"] = mPipelineCache->Request(treeSpritePsoDesc, true);
+
+	// Only the opaque pipeline is needed to start recording; the rest finish on the pool
+	// while the initialization commands execute, and Draw waits for any that haven't.
+	mPipelineCache->CreatePipelines(mThreadPool.get());
+
+	PipelineCacheStats pipelineStats = mPipelineCache->GetStats();
+	OutputDebugString((L"Pipelines: " + std::to_wstring(pipelineStats.Pipelines) + L" for " +
+		std::to_wstring(pipelineStats.Requests) + L" requests, " + std::to_wstring(pipelineStats.Deferred) +
+		L" deferred, " + std::to_wstring(pipelineStats.Loaded) + L" loaded from the library so far, " +
+		std::to_wstring(pipelineStats.ImmediateMs) + L" ms waiting\n").c_str());
 }
 
 void ShapesApp::BuildFrameResources()
@@ -1311,7 +1815,7 @@ void ShapesApp::BuildMaterials()
 	auto bricks0 = std::make_unique<Material>();
 	bricks0->Name = "bricks0";
 	bricks0->MatCBIndex = 0;
-	bricks0->DiffuseSrvHeapIndex = 0;
+	bricks0->DiffuseTexture = "bricksTex";
 	bricks0->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	bricks0->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	bricks0->Roughness = 0.9f;
@@ -1319,7 +1823,7 @@ void ShapesApp::BuildMaterials()
 	auto stone0 = std::make_unique<Material>();
 	stone0->Name = "stone0";
 	stone0->MatCBIndex = 1;
-	stone0->DiffuseSrvHeapIndex = 1;
+	stone0->DiffuseTexture = "stoneTex";
 	stone0->DiffuseAlbedo = XMFLOAT4(0.8f, 0.8f, 1.0f, 1.0f);
 	stone0->FresnelR0 = XMFLOAT3(0.2f, 0.2f, 0.2f);
 	stone0->Roughness = 0.9f;
@@ -1327,7 +1831,7 @@ void ShapesApp::BuildMaterials()
 	auto sand0 = std::make_unique<Material>();
 	sand0->Name = "sand0";
 	sand0->MatCBIndex = 2;
-	sand0->DiffuseSrvHeapIndex = 2;
+	sand0->DiffuseTexture = "sandTex";
 	sand0->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	sand0->FresnelR0 = XMFLOAT3(0.6f, 0.6f, 0.6f);
 	sand0->Roughness = 0.95f;
@@ -1335,7 +1839,7 @@ void ShapesApp::BuildMaterials()
 	auto gutsy = std::make_unique<Material>();
 	gutsy->Name = "gutsy";
 	gutsy->MatCBIndex = 3;
-	gutsy->DiffuseSrvHeapIndex = 3;
+	gutsy->DiffuseTexture = "redTex";
 	gutsy->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	gutsy->FresnelR0 = XMFLOAT3(0.6f, 0.6f, 0.6f);
 	gutsy->Roughness = 0.3f;
@@ -1343,7 +1847,7 @@ void ShapesApp::BuildMaterials()
 	auto Water0 = std::make_unique<Material>();
 	Water0->Name = "water0";
 	Water0->MatCBIndex = 4;
-	Water0->DiffuseSrvHeapIndex = 4;
+	Water0->DiffuseTexture = "waterTex";
 	Water0->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.5f);
 	Water0->FresnelR0 = XMFLOAT3(1.0f, 1.0f, 1.0f);
 	Water0->Roughness = 1.0f;
@@ -1351,7 +1855,7 @@ void ShapesApp::BuildMaterials()
 	auto Ice0 = std::make_unique<Material>();
 	Ice0->Name = "ice0";
 	Ice0->MatCBIndex = 5;
-	Ice0->DiffuseSrvHeapIndex = 5;
+	Ice0->DiffuseTexture = "iceTex";
 	Ice0->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.8f);
 	Ice0->FresnelR0 = XMFLOAT3(1.0f, 1.0f, 1.0f);
 	Ice0->Roughness = 0.1f;
@@ -1359,7 +1863,7 @@ void ShapesApp::BuildMaterials()
 	auto flag0 = std::make_unique<Material>();
 	flag0->Name = "flag0";
 	flag0->MatCBIndex = 6;
-	flag0->DiffuseSrvHeapIndex = 6;
+	flag0->DiffuseTexture = "flagTex";
 	flag0->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	flag0->FresnelR0 = XMFLOAT3(0.2f, 0.2f, 0.2f);
 	flag0->Roughness = 0.7f;
@@ -1367,7 +1871,7 @@ void ShapesApp::BuildMaterials()
 	auto door = std::make_unique<Material>();
 	door->Name = "door";
 	door->MatCBIndex = 7;
-	door->DiffuseSrvHeapIndex = 7;
+	door->DiffuseTexture = "boneTex";
 	door->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	door->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
 	door->Roughness = 0.25f;
@@ -1375,7 +1879,7 @@ void ShapesApp::BuildMaterials()
 	auto treeSprites = std::make_unique<Material>();
 	treeSprites->Name = "treeSprites";
 	treeSprites->MatCBIndex = 8;
-	treeSprites->DiffuseSrvHeapIndex = 8;
+	treeSprites->DiffuseTexture = "treeArrayTex";
 	treeSprites->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	treeSprites->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
 	treeSprites->Roughness = 0.125f;
@@ -1394,6 +1898,16 @@ void ShapesApp::BuildMaterials()
 
 
 }
+void ShapesApp::BuildMaterialAnimations()
+{
+	// Scroll the water material texture coordinates.
+	mMaterialAnimator.AddLinearTrack(mMaterials.at("water0").get(), MaterialChannel::TexOffset,
+		XMFLOAT4(0.0f, 0.5f, 0.0f, 0.0f), XMFLOAT4(-0.1f, 0.0f, 0.0f, 0.0f));
+
+	mMaterialAnimator.AddLinearTrack(mMaterials.at("gutsy").get(), MaterialChannel::TexOffset,
+		XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f), XMFLOAT4(0.1f, 0.1f, 0.0f, 0.0f));
+}
+
 void ShapesApp::BuildRenderItems()
 {
 
@@ -1401,9 +1915,9 @@ void ShapesApp::BuildRenderItems()
 	XMStoreFloat4x4(&gridRitem->World, XMMatrixScaling(5.00f, 1.50f, 1.50f) * XMMatrixRotationX(-0.55f) * XMMatrixTranslation(0.0f, 10.0f, 100.0f));
     
 	gridRitem->ObjCBIndex = 0;
-	gridRitem->Mat = mMaterials["sand0"].get();
+	gridRitem->Mat = mMaterials.at("sand0").get();
 	gridRitem->Mat->NormalSrvHeapIndex = 1;
-	gridRitem->Geo = mGeometries["shapeGeo"].get();
+	gridRitem->Geo = mGeometries.at("shapeGeo").get();
 	gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
     gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
@@ -1416,9 +1930,9 @@ void ShapesApp::BuildRenderItems()
 	auto gridRitem2 = std::make_unique<RenderItem>();
 	gridRitem2->World = MathHelper::Identity4x4();
 	gridRitem2->ObjCBIndex = objCBIndex++;
-	gridRitem2->Mat = mMaterials["sand0"].get();
+	gridRitem2->Mat = mMaterials.at("sand0").get();
 	gridRitem2->Mat->NormalSrvHeapIndex = 1;
-	gridRitem2->Geo = mGeometries["shapeGeo"].get();
+	gridRitem2->Geo = mGeometries.at("shapeGeo").get();
 	gridRitem2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	gridRitem2->IndexCount = gridRitem2->Geo->DrawArgs["grid2"].IndexCount;
 	gridRitem2->StartIndexLocation = gridRitem2->Geo->DrawArgs["grid2"].StartIndexLocation;
@@ -1439,9 +1953,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&leftwallRitem->World, XMMatrixScaling(1.0f, 15.0f, 50.0f) * XMMatrixTranslation(25.0f, 4.0f, 0.0f));
 		leftwallRitem->ObjCBIndex = objCBIndex++;
-		leftwallRitem->Mat = mMaterials["bricks0"].get();
+		leftwallRitem->Mat = mMaterials.at("bricks0").get();
 		leftwallRitem->Mat->NormalSrvHeapIndex = 1;
-		leftwallRitem->Geo = mGeometries["shapeGeo"].get();
+		leftwallRitem->Geo = mGeometries.at("shapeGeo").get();
 		leftwallRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftwallRitem->IndexCount = leftwallRitem->Geo->DrawArgs["box"].IndexCount;
 		leftwallRitem->StartIndexLocation = leftwallRitem->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1450,9 +1964,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&rightwallRitem->World, XMMatrixScaling(1.0f, 15.0f, 50.0f) * XMMatrixTranslation(-25.0f, 4.0f, 0.0f));
 		rightwallRitem->ObjCBIndex = objCBIndex++;
-		rightwallRitem->Mat = mMaterials["bricks0"].get();
+		rightwallRitem->Mat = mMaterials.at("bricks0").get();
 		rightwallRitem->Mat->NormalSrvHeapIndex = 1;
-		rightwallRitem->Geo = mGeometries["shapeGeo"].get();
+		rightwallRitem->Geo = mGeometries.at("shapeGeo").get();
 		rightwallRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightwallRitem->IndexCount = rightwallRitem->Geo->DrawArgs["box"].IndexCount;
 		rightwallRitem->StartIndexLocation = rightwallRitem->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1461,9 +1975,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&upperwallRitem->World, XMMatrixScaling(1.0f, 15.0f, 50.0f)  *XMMatrixRotationY(1.57f) * XMMatrixTranslation(0.0f, 4.0f, 25.0f));
 		upperwallRitem->ObjCBIndex = objCBIndex++;
-		upperwallRitem->Mat = mMaterials["bricks0"].get();
+		upperwallRitem->Mat = mMaterials.at("bricks0").get();
 		upperwallRitem->Mat->NormalSrvHeapIndex = 1;
-		upperwallRitem->Geo = mGeometries["shapeGeo"].get();
+		upperwallRitem->Geo = mGeometries.at("shapeGeo").get();
 		upperwallRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		upperwallRitem->IndexCount = upperwallRitem->Geo->DrawArgs["box"].IndexCount;
 		upperwallRitem->StartIndexLocation = upperwallRitem->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1472,9 +1986,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&lowerwallRitem1->World, XMMatrixScaling(1.0f, 15.0f, 20.0f) * XMMatrixRotationY(1.57f) * XMMatrixTranslation(15.0f, 4.0f, -25.0f));
 		lowerwallRitem1->ObjCBIndex = objCBIndex++;
-		lowerwallRitem1->Mat = mMaterials["bricks0"].get();
+		lowerwallRitem1->Mat = mMaterials.at("bricks0").get();
 		lowerwallRitem1->Mat->NormalSrvHeapIndex = 1;
-		lowerwallRitem1->Geo = mGeometries["shapeGeo"].get();
+		lowerwallRitem1->Geo = mGeometries.at("shapeGeo").get();
 		lowerwallRitem1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		lowerwallRitem1->IndexCount = lowerwallRitem1->Geo->DrawArgs["box"].IndexCount;
 		lowerwallRitem1->StartIndexLocation = lowerwallRitem1->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1483,9 +1997,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&lowerwallRitem2->World, XMMatrixScaling(1.0f, 15.0f, 20.0f) * XMMatrixRotationY(1.57f) * XMMatrixTranslation(-15.0f, 4.0f, -25.0f));
 		lowerwallRitem2->ObjCBIndex = objCBIndex++;
-		lowerwallRitem2->Mat = mMaterials["bricks0"].get();
+		lowerwallRitem2->Mat = mMaterials.at("bricks0").get();
 		lowerwallRitem2->Mat->NormalSrvHeapIndex = 1;
-		lowerwallRitem2->Geo = mGeometries["shapeGeo"].get();
+		lowerwallRitem2->Geo = mGeometries.at("shapeGeo").get();
 		lowerwallRitem2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		lowerwallRitem2->IndexCount = lowerwallRitem2->Geo->DrawArgs["box"].IndexCount;
 		lowerwallRitem2->StartIndexLocation = lowerwallRitem2->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1494,9 +2008,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&lowerwallRitem3->World, XMMatrixScaling(1.0f, 4.0f, 10.0f) * XMMatrixRotationY(1.57f) * XMMatrixTranslation(0.0f, 9.5f, -25.0f));
 		lowerwallRitem3->ObjCBIndex = objCBIndex++;
-		lowerwallRitem3->Mat = mMaterials["bricks0"].get();
+		lowerwallRitem3->Mat = mMaterials.at("bricks0").get();
 		lowerwallRitem3->Mat->NormalSrvHeapIndex = 1;
-		lowerwallRitem3->Geo = mGeometries["shapeGeo"].get();
+		lowerwallRitem3->Geo = mGeometries.at("shapeGeo").get();
 		lowerwallRitem3->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		lowerwallRitem3->IndexCount = lowerwallRitem3->Geo->DrawArgs["box"].IndexCount;
 		lowerwallRitem3->StartIndexLocation = lowerwallRitem3->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1520,9 +2034,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&leftCylRitem->World, XMMatrixScaling(5.0f, 8.3f, 5.0f) * XMMatrixTranslation(-25.0f, 9.5f, -25.0f));
 		leftCylRitem->ObjCBIndex = objCBIndex++;
-		leftCylRitem->Mat = mMaterials["stone0"].get();
+		leftCylRitem->Mat = mMaterials.at("stone0").get();
 		leftCylRitem->Mat->NormalSrvHeapIndex = 1;
-		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
+		leftCylRitem->Geo = mGeometries.at("shapeGeo").get();
 		leftCylRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
 		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
@@ -1532,9 +2046,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&rightCylRitem->World, XMMatrixScaling(5.0f, 8.3f, 5.0f) * XMMatrixTranslation(25.0f, 9.5f, 25.0f));
 		rightCylRitem->ObjCBIndex = objCBIndex++;
-		rightCylRitem->Mat = mMaterials["stone0"].get();
+		rightCylRitem->Mat = mMaterials.at("stone0").get();
 		rightCylRitem->Mat->NormalSrvHeapIndex = 1;
-		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
+		rightCylRitem->Geo = mGeometries.at("shapeGeo").get();
 		rightCylRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
 		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
@@ -1544,9 +2058,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&lowerCylRitem->World, XMMatrixScaling(5.0f, 8.0f, 5.0f) * XMMatrixTranslation(25.0f, 9.0f, -25.0f));
 		lowerCylRitem->ObjCBIndex = objCBIndex++;
-		lowerCylRitem->Mat = mMaterials["stone0"].get();
+		lowerCylRitem->Mat = mMaterials.at("stone0").get();
 		lowerCylRitem->Mat->NormalSrvHeapIndex = 1;
-		lowerCylRitem->Geo = mGeometries["shapeGeo"].get();
+		lowerCylRitem->Geo = mGeometries.at("shapeGeo").get();
 		lowerCylRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		lowerCylRitem->IndexCount = lowerCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
 		lowerCylRitem->StartIndexLocation = lowerCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
@@ -1556,9 +2070,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&lowerrihtCylRitem->World, XMMatrixScaling(5.0f, 8.0f, 5.0f) * XMMatrixTranslation(-25.0f, 9.0f, 25.0f));
 		lowerrihtCylRitem->ObjCBIndex = objCBIndex++;
-		lowerrihtCylRitem->Mat = mMaterials["stone0"].get();
+		lowerrihtCylRitem->Mat = mMaterials.at("stone0").get();
 		lowerrihtCylRitem->Mat->NormalSrvHeapIndex = 1;
-		lowerrihtCylRitem->Geo = mGeometries["shapeGeo"].get();
+		lowerrihtCylRitem->Geo = mGeometries.at("shapeGeo").get();
 		lowerrihtCylRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		lowerrihtCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
 		lowerrihtCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
@@ -1583,9 +2097,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&leftConeRitem->World, XMMatrixScaling(5.0f, 7.0f, 5.0f)* XMMatrixTranslation(-25.0f, 25.0f, -25.0f));
 		leftConeRitem->ObjCBIndex = objCBIndex++;
-		leftConeRitem->Mat = mMaterials["bricks0"].get();
+		leftConeRitem->Mat = mMaterials.at("bricks0").get();
 		leftConeRitem->Mat->NormalSrvHeapIndex = 1;
-		leftConeRitem->Geo = mGeometries["shapeGeo"].get();
+		leftConeRitem->Geo = mGeometries.at("shapeGeo").get();
 		leftConeRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		leftConeRitem->IndexCount = leftConeRitem->Geo->DrawArgs["cone"].IndexCount;
 		leftConeRitem->StartIndexLocation = leftConeRitem->Geo->DrawArgs["cone"].StartIndexLocation;
@@ -1594,9 +2108,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&rightConelRitem->World, XMMatrixScaling(5.0f, 7.0f, 5.0f)* XMMatrixTranslation(25.0f, 25.0f, 25.0f));
 		rightConelRitem->ObjCBIndex = objCBIndex++;
-		rightConelRitem->Mat = mMaterials["bricks0"].get();
+		rightConelRitem->Mat = mMaterials.at("bricks0").get();
 		rightConelRitem->Mat->NormalSrvHeapIndex = 1;
-		rightConelRitem->Geo = mGeometries["shapeGeo"].get();
+		rightConelRitem->Geo = mGeometries.at("shapeGeo").get();
 		rightConelRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		rightConelRitem->IndexCount = rightConelRitem->Geo->DrawArgs["cone"].IndexCount;
 		rightConelRitem->StartIndexLocation = rightConelRitem->Geo->DrawArgs["cone"].StartIndexLocation;
@@ -1605,9 +2119,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&lowerConeRitem->World, XMMatrixScaling(5.0f, 7.0f, 5.0f)* XMMatrixTranslation(25.0f, 25.0f, -25.0f));
 		lowerConeRitem->ObjCBIndex = objCBIndex++;
-		lowerConeRitem->Mat = mMaterials["bricks0"].get();
+		lowerConeRitem->Mat = mMaterials.at("bricks0").get();
 		lowerConeRitem->Mat->NormalSrvHeapIndex = 1;
-		lowerConeRitem->Geo = mGeometries["shapeGeo"].get();
+		lowerConeRitem->Geo = mGeometries.at("shapeGeo").get();
 		lowerConeRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		lowerConeRitem->IndexCount = lowerConeRitem->Geo->DrawArgs["cone"].IndexCount;
 		lowerConeRitem->StartIndexLocation = lowerConeRitem->Geo->DrawArgs["cone"].StartIndexLocation;
@@ -1616,9 +2130,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&lowerrihtConeRitem->World, XMMatrixScaling(5.0f, 7.0f, 5.0f)* XMMatrixTranslation(-25.0f, 25.0f, 25.0f));
 		lowerrihtConeRitem->ObjCBIndex = objCBIndex++;
-		lowerrihtConeRitem->Mat = mMaterials["bricks0"].get();
+		lowerrihtConeRitem->Mat = mMaterials.at("bricks0").get();
 		lowerrihtConeRitem->Mat->NormalSrvHeapIndex = 1;
-		lowerrihtConeRitem->Geo = mGeometries["shapeGeo"].get();
+		lowerrihtConeRitem->Geo = mGeometries.at("shapeGeo").get();
 		lowerrihtConeRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		lowerrihtConeRitem->IndexCount = rightConelRitem->Geo->DrawArgs["cone"].IndexCount;
 		lowerrihtConeRitem->StartIndexLocation = rightConelRitem->Geo->DrawArgs["cone"].StartIndexLocation;
@@ -1638,9 +2152,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&building->World, XMMatrixScaling(2.0f, 5.0f, 5.0f)* XMMatrixTranslation(0.0f, 2.0f, 0.0f));
 		building->ObjCBIndex = objCBIndex++;
-		building->Mat = mMaterials["gutsy"].get();
+		building->Mat = mMaterials.at("gutsy").get();
 		building->Mat->NormalSrvHeapIndex = 1;
-		building->Geo = mGeometries["shapeGeo"].get();
+		building->Geo = mGeometries.at("shapeGeo").get();
 		building->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		building->IndexCount = building->Geo->DrawArgs["building"].IndexCount;
 		building->StartIndexLocation = building->Geo->DrawArgs["building"].StartIndexLocation;
@@ -1654,9 +2168,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&torus->World, XMMatrixScaling(2.2f, 2.2f, 2.2f)* XMMatrixRotationY(3.5f)* XMMatrixRotationX(3.0f)* XMMatrixTranslation(0.0f, 10.0f, 0.0f));
 		torus->ObjCBIndex = objCBIndex++;
-		torus->Mat = mMaterials["water0"].get();
+		torus->Mat = mMaterials.at("water0").get();
 		torus->Mat->NormalSrvHeapIndex = 1;
-		torus->Geo = mGeometries["shapeGeo"].get();
+		torus->Geo = mGeometries.at("shapeGeo").get();
 		torus->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		torus->IndexCount = torus->Geo->DrawArgs["torus"].IndexCount;
 		torus->StartIndexLocation = torus->Geo->DrawArgs["torus"].StartIndexLocation;
@@ -1668,9 +2182,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&torus1->World, XMMatrixScaling(2.0f, 2.0f, 2.0f)*XMMatrixRotationX(0.75f)* XMMatrixRotationY(0.75f)* XMMatrixTranslation(0.0f, 10.0f, 0.0f));
 		torus1->ObjCBIndex = objCBIndex++;
-		torus1->Mat = mMaterials["water0"].get();
+		torus1->Mat = mMaterials.at("water0").get();
 		torus1->Mat->NormalSrvHeapIndex = 1;
-		torus1->Geo = mGeometries["shapeGeo"].get();
+		torus1->Geo = mGeometries.at("shapeGeo").get();
 		torus1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		torus1->IndexCount = torus1->Geo->DrawArgs["torus"].IndexCount;
 		torus1->StartIndexLocation = torus1->Geo->DrawArgs["torus"].StartIndexLocation;
@@ -1682,9 +2196,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&torus2->World, XMMatrixScaling(1.8f, 1.8f, 1.8f)* XMMatrixRotationX(1.5f)* XMMatrixRotationY(1.5f)* XMMatrixTranslation(0.0f, 10.0f, 0.0f));
 		torus2->ObjCBIndex = objCBIndex++;
-		torus2->Mat = mMaterials["water0"].get();
+		torus2->Mat = mMaterials.at("water0").get();
 		torus2->Mat->NormalSrvHeapIndex = 1;
-		torus2->Geo = mGeometries["shapeGeo"].get();
+		torus2->Geo = mGeometries.at("shapeGeo").get();
 		torus2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		torus2->IndexCount = torus2->Geo->DrawArgs["torus"].IndexCount;
 		torus2->StartIndexLocation = torus2->Geo->DrawArgs["torus"].StartIndexLocation;
@@ -1696,9 +2210,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&torus3->World, XMMatrixScaling(2.6f, 2.6f, 2.6f)* XMMatrixRotationX(2.25f)* XMMatrixRotationY(2.25f)* XMMatrixTranslation(0.0f, 10.0f, 0.0f));
 		torus3->ObjCBIndex = objCBIndex++;
-		torus3->Mat = mMaterials["water0"].get();
+		torus3->Mat = mMaterials.at("water0").get();
 		torus3->Mat->NormalSrvHeapIndex = 1;
-		torus3->Geo = mGeometries["shapeGeo"].get();
+		torus3->Geo = mGeometries.at("shapeGeo").get();
 		torus3->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		torus3->IndexCount = torus3->Geo->DrawArgs["torus"].IndexCount;
 		torus3->StartIndexLocation = torus3->Geo->DrawArgs["torus"].StartIndexLocation;
@@ -1712,9 +2226,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&diamond->World, XMMatrixScaling(2.0f, 2.0f, 2.0f)* XMMatrixTranslation(0.0f, 10.0f, 0.0f));
 		diamond->ObjCBIndex = objCBIndex++;
-		diamond->Mat = mMaterials["ice0"].get();
+		diamond->Mat = mMaterials.at("ice0").get();
 		diamond->Mat->NormalSrvHeapIndex = 1;
-		diamond->Geo = mGeometries["shapeGeo"].get();
+		diamond->Geo = mGeometries.at("shapeGeo").get();
 		diamond->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		diamond->IndexCount = diamond->Geo->DrawArgs["diamond"].IndexCount;
 		diamond->StartIndexLocation = diamond->Geo->DrawArgs["diamond"].StartIndexLocation;
@@ -1727,9 +2241,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&door->World, XMMatrixScaling(10.0f, 5.0f, 2.0f)* XMMatrixTranslation(0.0f, 10.0f,-27.3f));
 		door->ObjCBIndex = objCBIndex++;
-		door->Mat = mMaterials["door"].get();
+		door->Mat = mMaterials.at("door").get();
 		door->Mat->NormalSrvHeapIndex = 1;
-		door->Geo = mGeometries["shapeGeo"].get();
+		door->Geo = mGeometries.at("shapeGeo").get();
 		door->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		door->IndexCount = door->Geo->DrawArgs["door"].IndexCount;
 		door->StartIndexLocation = door->Geo->DrawArgs["door"].StartIndexLocation;
@@ -1741,9 +2255,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&wedge1->World, XMMatrixScaling(8.0f, 2.0f, 10.0f)* XMMatrixRotationRollPitchYaw(0.0f, -1.57f,0.0f)* XMMatrixTranslation(0.0f, 1.0f, -28.0f));
 		wedge1->ObjCBIndex = objCBIndex++;
-		wedge1->Mat = mMaterials["door"].get();
+		wedge1->Mat = mMaterials.at("door").get();
 		wedge1->Mat->NormalSrvHeapIndex = 1;
-		wedge1->Geo = mGeometries["shapeGeo"].get();
+		wedge1->Geo = mGeometries.at("shapeGeo").get();
 		wedge1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		wedge1->IndexCount = wedge1->Geo->DrawArgs["wedge"].IndexCount;
 		wedge1->StartIndexLocation = wedge1->Geo->DrawArgs["wedge"].StartIndexLocation;
@@ -1758,9 +2272,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&prism->World, XMMatrixScaling(4.0f, 4.0f, 4.0f)* XMMatrixTranslation(0.0f, 5.5f, 0.0f));
 		prism->ObjCBIndex = objCBIndex++;
-		prism->Mat = mMaterials["gutsy"].get();
+		prism->Mat = mMaterials.at("gutsy").get();
 		prism->Mat->NormalSrvHeapIndex = 1;
-		prism->Geo = mGeometries["shapeGeo"].get();
+		prism->Geo = mGeometries.at("shapeGeo").get();
 		prism->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		prism->IndexCount = prism->Geo->DrawArgs["prism"].IndexCount;
 		prism->StartIndexLocation = prism->Geo->DrawArgs["prism"].StartIndexLocation;
@@ -1772,9 +2286,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&water->World, XMMatrixScaling(0.5f, 0.5f, 0.5f)* XMMatrixTranslation(0.0f, 1.5f, 0.0f));
 		water->ObjCBIndex = objCBIndex++;
-		water->Mat = mMaterials["water0"].get();
+		water->Mat = mMaterials.at("water0").get();
 		water->Mat->NormalSrvHeapIndex = 1;
-		water->Geo = mGeometries["shapeGeo"].get();
+		water->Geo = mGeometries.at("shapeGeo").get();
 		water->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		water->IndexCount = water->Geo->DrawArgs["water"].IndexCount;
 		water->StartIndexLocation = water->Geo->DrawArgs["water"].StartIndexLocation;
@@ -1790,9 +2304,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze1->World, XMMatrixScaling(1.0f, 7.0f, 8.0f)* XMMatrixTranslation(-5.0f, 2.0f, -18.0f));
 		maze1->ObjCBIndex = objCBIndex++;
-		maze1->Mat = mMaterials["door"].get();
+		maze1->Mat = mMaterials.at("door").get();
 		maze1->Mat->NormalSrvHeapIndex = 1;
-		maze1->Geo = mGeometries["shapeGeo"].get();
+		maze1->Geo = mGeometries.at("shapeGeo").get();
 		maze1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze1->IndexCount = maze1->Geo->DrawArgs["box"].IndexCount;
 		maze1->StartIndexLocation = maze1->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1805,9 +2319,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze2->World, XMMatrixScaling(1.0f, 7.0f, 8.0f)* XMMatrixTranslation(5.0f, 2.0f, -18.0f));
 		maze2->ObjCBIndex = objCBIndex++;
-		maze2->Mat = mMaterials["door"].get();
+		maze2->Mat = mMaterials.at("door").get();
 		maze2->Mat->NormalSrvHeapIndex = 1;
-		maze2->Geo = mGeometries["shapeGeo"].get();
+		maze2->Geo = mGeometries.at("shapeGeo").get();
 		maze2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze2->IndexCount = maze2->Geo->DrawArgs["box"].IndexCount;
 		maze2->StartIndexLocation = maze2->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1820,9 +2334,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze3->World, XMMatrixScaling(10.0f, 7.0f, 3.0f)* XMMatrixTranslation(0.0f, 2.0f, -8.0f));
 		maze3->ObjCBIndex = objCBIndex++;
-		maze3->Mat = mMaterials["door"].get();
+		maze3->Mat = mMaterials.at("door").get();
 		maze3->Mat->NormalSrvHeapIndex = 1;
-		maze3->Geo = mGeometries["shapeGeo"].get();
+		maze3->Geo = mGeometries.at("shapeGeo").get();
 		maze3->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze3->IndexCount = maze3->Geo->DrawArgs["box"].IndexCount;
 		maze3->StartIndexLocation = maze3->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1834,9 +2348,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze4->World, XMMatrixScaling(6.8f, 7.0f, 3.0f)* XMMatrixTranslation(-13.7f, 2.0f, -13.0f));
 		maze4->ObjCBIndex = objCBIndex++;
-		maze4->Mat = mMaterials["door"].get();
+		maze4->Mat = mMaterials.at("door").get();
 		maze4->Mat->NormalSrvHeapIndex = 1;
-		maze4->Geo = mGeometries["shapeGeo"].get();
+		maze4->Geo = mGeometries.at("shapeGeo").get();
 		maze4->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze4->IndexCount = maze4->Geo->DrawArgs["box"].IndexCount;
 		maze4->StartIndexLocation = maze4->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1848,9 +2362,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze5->World, XMMatrixScaling(6.8f, 7.0f, 3.0f)* XMMatrixTranslation(13.7f, 2.0f, -12.9f));
 		maze5->ObjCBIndex = objCBIndex++;
-		maze5->Mat = mMaterials["door"].get();
+		maze5->Mat = mMaterials.at("door").get();
 		maze5->Mat->NormalSrvHeapIndex = 1;
-		maze5->Geo = mGeometries["shapeGeo"].get();
+		maze5->Geo = mGeometries.at("shapeGeo").get();
 		maze5->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze5->IndexCount = maze5->Geo->DrawArgs["box"].IndexCount;
 		maze5->StartIndexLocation = maze5->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1863,9 +2377,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze6->World, XMMatrixScaling(1.0f, 7.0f, 13.0f)* XMMatrixTranslation(-13.5f, 2.0f, 0.0f));
 		maze6->ObjCBIndex = objCBIndex++;
-		maze6->Mat = mMaterials["door"].get();
+		maze6->Mat = mMaterials.at("door").get();
 		maze6->Mat->NormalSrvHeapIndex = 1;
-		maze6->Geo = mGeometries["shapeGeo"].get();
+		maze6->Geo = mGeometries.at("shapeGeo").get();
 		maze6->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze6->IndexCount = maze6->Geo->DrawArgs["box"].IndexCount;
 		maze6->StartIndexLocation = maze6->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1879,9 +2393,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze7->World, XMMatrixScaling(1.0f, 7.0f, 13.0f)* XMMatrixTranslation(13.5f, 2.0f, 0.0f));
 		maze7->ObjCBIndex = objCBIndex++;
-		maze7->Mat = mMaterials["door"].get();
+		maze7->Mat = mMaterials.at("door").get();
 		maze7->Mat->NormalSrvHeapIndex = 1;
-		maze7->Geo = mGeometries["shapeGeo"].get();
+		maze7->Geo = mGeometries.at("shapeGeo").get();
 		maze7->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze7->IndexCount = maze7->Geo->DrawArgs["box"].IndexCount;
 		maze7->StartIndexLocation = maze7->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1893,9 +2407,9 @@ void ShapesApp::BuildRenderItems()
 		auto maze8 = std::make_unique<RenderItem>();
 		XMStoreFloat4x4(&maze8->World, XMMatrixScaling(3.8f, 7.0f, 3.0f)* XMMatrixTranslation(9.3f, 2.0f, 7.9f));
 		maze8->ObjCBIndex = objCBIndex++;
-		maze8->Mat = mMaterials["door"].get();
+		maze8->Mat = mMaterials.at("door").get();
 		maze8->Mat->NormalSrvHeapIndex = 1;
-		maze8->Geo = mGeometries["shapeGeo"].get();
+		maze8->Geo = mGeometries.at("shapeGeo").get();
 		maze8->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze8->IndexCount = maze8->Geo->DrawArgs["box"].IndexCount;
 		maze8->StartIndexLocation = maze8->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1907,9 +2421,9 @@ void ShapesApp::BuildRenderItems()
 		auto maze9 = std::make_unique<RenderItem>();
 		XMStoreFloat4x4(&maze9->World, XMMatrixScaling(3.8f, 7.0f, 3.0f)* XMMatrixTranslation(-9.3f, 2.0f, 7.9f));
 		maze9->ObjCBIndex = objCBIndex++;
-		maze9->Mat = mMaterials["door"].get();
+		maze9->Mat = mMaterials.at("door").get();
 		maze9->Mat->NormalSrvHeapIndex = 1;
-		maze9->Geo = mGeometries["shapeGeo"].get();
+		maze9->Geo = mGeometries.at("shapeGeo").get();
 		maze9->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze9->IndexCount = maze9->Geo->DrawArgs["box"].IndexCount;
 		maze9->StartIndexLocation = maze9->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1922,9 +2436,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze10->World, XMMatrixScaling(1.0f, 7.0f, 8.0f)* XMMatrixTranslation(-5.1f, 2.0f, 13.0f));
 		maze10->ObjCBIndex = objCBIndex++;
-		maze10->Mat = mMaterials["door"].get();
+		maze10->Mat = mMaterials.at("door").get();
 		maze10->Mat->NormalSrvHeapIndex = 1;
-		maze10->Geo = mGeometries["shapeGeo"].get();
+		maze10->Geo = mGeometries.at("shapeGeo").get();
 		maze10->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze10->IndexCount = maze10->Geo->DrawArgs["box"].IndexCount;
 		maze10->StartIndexLocation = maze10->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1937,9 +2451,9 @@ void ShapesApp::BuildRenderItems()
 		auto maze11 = std::make_unique<RenderItem>();
 		XMStoreFloat4x4(&maze11->World, XMMatrixScaling(5.0f, 7.0f, 3.0f)* XMMatrixTranslation(11.2f, 2.0f, 17.0f));
 		maze11->ObjCBIndex = objCBIndex++;
-		maze11->Mat = mMaterials["door"].get();
+		maze11->Mat = mMaterials.at("door").get();
 		maze11->Mat->NormalSrvHeapIndex = 1;
-		maze11->Geo = mGeometries["shapeGeo"].get();
+		maze11->Geo = mGeometries.at("shapeGeo").get();
 		maze11->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze11->IndexCount = maze11->Geo->DrawArgs["box"].IndexCount;
 		maze11->StartIndexLocation = maze11->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1952,9 +2466,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze12->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(-16.5f, 2.0f, -8.0f));
 		maze12->ObjCBIndex = objCBIndex++;
-		maze12->Mat = mMaterials["door"].get();
+		maze12->Mat = mMaterials.at("door").get();
 		maze12->Mat->NormalSrvHeapIndex = 1;
-		maze12->Geo = mGeometries["shapeGeo"].get();
+		maze12->Geo = mGeometries.at("shapeGeo").get();
 		maze12->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze12->IndexCount = maze12->Geo->DrawArgs["box"].IndexCount;
 		maze12->StartIndexLocation = maze12->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1966,9 +2480,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze13->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(16.5f, 2.0f, -8.0f));
 		maze13->ObjCBIndex = objCBIndex++;
-		maze13->Mat = mMaterials["door"].get();
+		maze13->Mat = mMaterials.at("door").get();
 		maze13->Mat->NormalSrvHeapIndex = 1;
-		maze13->Geo = mGeometries["shapeGeo"].get();
+		maze13->Geo = mGeometries.at("shapeGeo").get();
 		maze13->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze13->IndexCount = maze13->Geo->DrawArgs["box"].IndexCount;
 		maze13->StartIndexLocation = maze13->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1981,9 +2495,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze14->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(22.0f, 2.0f, -3.0f));
 		maze14->ObjCBIndex = objCBIndex++;
-		maze14->Mat = mMaterials["door"].get();
+		maze14->Mat = mMaterials.at("door").get();
 		maze14->Mat->NormalSrvHeapIndex = 1;
-		maze14->Geo = mGeometries["shapeGeo"].get();
+		maze14->Geo = mGeometries.at("shapeGeo").get();
 		maze14->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze14->IndexCount = maze14->Geo->DrawArgs["box"].IndexCount;
 		maze14->StartIndexLocation = maze14->Geo->DrawArgs["box"].StartIndexLocation;
@@ -1995,9 +2509,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze15->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(16.5f, 2.0f, 2.0f));
 		maze15->ObjCBIndex = objCBIndex++;
-		maze15->Mat = mMaterials["door"].get();
+		maze15->Mat = mMaterials.at("door").get();
 		maze15->Mat->NormalSrvHeapIndex = 1;
-		maze15->Geo = mGeometries["shapeGeo"].get();
+		maze15->Geo = mGeometries.at("shapeGeo").get();
 		maze15->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze15->IndexCount = maze15->Geo->DrawArgs["box"].IndexCount;
 		maze15->StartIndexLocation = maze15->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2009,9 +2523,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze16->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(22.0f, 2.0f, 7.0f));
 		maze16->ObjCBIndex = objCBIndex++;
-		maze16->Mat = mMaterials["door"].get();
+		maze16->Mat = mMaterials.at("door").get();
 		maze16->Mat->NormalSrvHeapIndex = 1;
-		maze16->Geo = mGeometries["shapeGeo"].get();
+		maze16->Geo = mGeometries.at("shapeGeo").get();
 		maze16->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze16->IndexCount = maze16->Geo->DrawArgs["box"].IndexCount;
 		maze16->StartIndexLocation = maze16->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2025,9 +2539,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze17->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(-22.0f, 2.0f, -3.0f));
 		maze17->ObjCBIndex = objCBIndex++;
-		maze17->Mat = mMaterials["door"].get();
+		maze17->Mat = mMaterials.at("door").get();
 		maze17->Mat->NormalSrvHeapIndex = 1;
-		maze17->Geo = mGeometries["shapeGeo"].get();
+		maze17->Geo = mGeometries.at("shapeGeo").get();
 		maze17->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze17->IndexCount = maze17->Geo->DrawArgs["box"].IndexCount;
 		maze17->StartIndexLocation = maze17->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2039,9 +2553,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze18->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(-16.5f, 2.0f, 2.0f));
 		maze18->ObjCBIndex = objCBIndex++;
-		maze18->Mat = mMaterials["door"].get();
+		maze18->Mat = mMaterials.at("door").get();
 		maze18->Mat->NormalSrvHeapIndex = 1;
-		maze18->Geo = mGeometries["shapeGeo"].get();
+		maze18->Geo = mGeometries.at("shapeGeo").get();
 		maze18->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze18->IndexCount = maze18->Geo->DrawArgs["box"].IndexCount;
 		maze18->StartIndexLocation = maze18->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2053,9 +2567,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze19->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(-22.0f, 2.0f, 7.0f));
 		maze19->ObjCBIndex = objCBIndex++;
-		maze19->Mat = mMaterials["door"].get();
+		maze19->Mat = mMaterials.at("door").get();
 		maze19->Mat->NormalSrvHeapIndex = 1;
-		maze19->Geo = mGeometries["shapeGeo"].get();
+		maze19->Geo = mGeometries.at("shapeGeo").get();
 		maze19->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze19->IndexCount = maze19->Geo->DrawArgs["box"].IndexCount;
 		maze19->StartIndexLocation = maze19->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2067,9 +2581,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze20->World, XMMatrixScaling(1.0f, 7.0f, 8.0f)* XMMatrixTranslation(5.1f, 2.0f, 13.0f));
 		maze20->ObjCBIndex = objCBIndex++;
-		maze20->Mat = mMaterials["door"].get();
+		maze20->Mat = mMaterials.at("door").get();
 		maze20->Mat->NormalSrvHeapIndex = 1;
-		maze20->Geo = mGeometries["shapeGeo"].get();
+		maze20->Geo = mGeometries.at("shapeGeo").get();
 		maze20->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze20->IndexCount = maze20->Geo->DrawArgs["box"].IndexCount;
 		maze20->StartIndexLocation = maze20->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2081,9 +2595,9 @@ void ShapesApp::BuildRenderItems()
 		auto maze21 = std::make_unique<RenderItem>();
 		XMStoreFloat4x4(&maze21->World, XMMatrixScaling(5.0f, 7.0f, 3.0f)* XMMatrixTranslation(-11.2f, 2.0f, 17.0f));
 		maze21->ObjCBIndex = objCBIndex++;
-		maze21->Mat = mMaterials["door"].get();
+		maze21->Mat = mMaterials.at("door").get();
 		maze21->Mat->NormalSrvHeapIndex = 1;
-		maze21->Geo = mGeometries["shapeGeo"].get();
+		maze21->Geo = mGeometries.at("shapeGeo").get();
 		maze21->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze21->IndexCount = maze21->Geo->DrawArgs["box"].IndexCount;
 		maze21->StartIndexLocation = maze21->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2095,9 +2609,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze22->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(-2.2f, 2.0f, 17.0f));
 		maze22->ObjCBIndex = objCBIndex++;
-		maze22->Mat = mMaterials["door"].get();
+		maze22->Mat = mMaterials.at("door").get();
 		maze22->Mat->NormalSrvHeapIndex = 1;
-		maze22->Geo = mGeometries["shapeGeo"].get();
+		maze22->Geo = mGeometries.at("shapeGeo").get();
 		maze22->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze22->IndexCount = maze22->Geo->DrawArgs["box"].IndexCount;
 		maze22->StartIndexLocation = maze22->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2109,9 +2623,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze23->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(2.2f, 2.0f, 12.45f));
 		maze23->ObjCBIndex = objCBIndex++;
-		maze23->Mat = mMaterials["door"].get();
+		maze23->Mat = mMaterials.at("door").get();
 		maze23->Mat->NormalSrvHeapIndex = 1;
-		maze23->Geo = mGeometries["shapeGeo"].get();
+		maze23->Geo = mGeometries.at("shapeGeo").get();
 		maze23->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze23->IndexCount = maze23->Geo->DrawArgs["box"].IndexCount;
 		maze23->StartIndexLocation = maze23->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2123,9 +2637,9 @@ void ShapesApp::BuildRenderItems()
 
 		XMStoreFloat4x4(&maze24->World, XMMatrixScaling(1.0f, 7.0f, 3.0f)* XMMatrixTranslation(-2.2f, 2.0f, 7.9f));
 		maze24->ObjCBIndex = objCBIndex++;
-		maze24->Mat = mMaterials["door"].get();
+		maze24->Mat = mMaterials.at("door").get();
 		maze24->Mat->NormalSrvHeapIndex = 1;
-		maze24->Geo = mGeometries["shapeGeo"].get();
+		maze24->Geo = mGeometries.at("shapeGeo").get();
 		maze24->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		maze24->IndexCount = maze24->Geo->DrawArgs["box"].IndexCount;
 		maze24->StartIndexLocation = maze24->Geo->DrawArgs["box"].StartIndexLocation;
@@ -2138,8 +2652,8 @@ void ShapesApp::BuildRenderItems()
 		auto treeSpritesRitem = std::make_unique<RenderItem>();
 		treeSpritesRitem->World = MathHelper::Identity4x4();
 		treeSpritesRitem->ObjCBIndex = objCBIndex++;
-		treeSpritesRitem->Mat = mMaterials["treeSprites"].get();
-		treeSpritesRitem->Geo = mGeometries["treeSpritesGeo"].get();
+		treeSpritesRitem->Mat = mMaterials.at("treeSprites").get();
+		treeSpritesRitem->Geo = mGeometries.at("treeSpritesGeo").get();
 		treeSpritesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
 		treeSpritesRitem->IndexCount = treeSpritesRitem->Geo->DrawArgs["points"].IndexCount;
 		treeSpritesRitem->StartIndexLocation = treeSpritesRitem->Geo->DrawArgs["points"].StartIndexLocation;
@@ -2147,39 +2661,147 @@ void ShapesApp::BuildRenderItems()
 		mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites].push_back(treeSpritesRitem.get());
 		mAllRitems.push_back(std::move(treeSpritesRitem));
 
+	// Pick up the bounds of the submesh each item draws.
+	for (auto& ri : mAllRitems)
+	{
+		for (const auto& e : ri->Geo->DrawArgs)
+		{
+			const SubmeshGeometry& submesh = e.second;
+			if (submesh.StartIndexLocation == ri->StartIndexLocation &&
+				submesh.BaseVertexLocation == ri->BaseVertexLocation &&
+				submesh.IndexCount == ri->IndexCount)
+			{
+				ri->Bounds = submesh.Bounds;
+				break;
+			}
+		}
+	}
+}
+
 
+void ShapesApp::BuildDrawIndices()
+{
+	for (auto& ri : mAllRitems)
+	{
+		if (!PackDrawIndex(ri->ObjCBIndex, (uint32_t)ri->Mat->MatCBIndex, ri->DrawIndex))
+			ThrowIfFailed(E_INVALIDARG);
 
-	
+		auto it = mStreamedMaterials.find(ri->Mat);
+		if (it != mStreamedMaterials.end())
+			ri->StreamedTexture = (int)it->second;
+	}
 }
 
+// The opaque items' bounds and buffers don't change, so the builder's inputs are made
+// once.  The command signature sets the vertex and index buffers per draw, as the items
+// use several geometries, and the draw index root constant.
+void ShapesApp::BuildIndirectDraws()
+{
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[4] = {};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+	arguments[0].VertexBuffer.Slot = 0;
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+	arguments[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	arguments[2].Constant.RootParameterIndex = 1;
+	arguments[2].Constant.DestOffsetIn32BitValues = 0;
+	arguments[2].Constant.Num32BitValuesToSet = 1;
+	arguments[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+	signatureDesc.ByteStride = sizeof(IndirectDrawCommand);
+	signatureDesc.NumArgumentDescs = _countof(arguments);
+	signatureDesc.pArgumentDescs = arguments;
+	ThrowIfFailed(md3dDevice->CreateCommandSignature(&signatureDesc, mRootSignature.Get(),
+		IID_PPV_ARGS(mDrawSignature.GetAddressOf())));
+
+	for (RenderItem* ri : mRitemLayer[(int)RenderLayer::Opaque])
+	{
+		if (ri->PrimitiveType != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+		{
+			mOpaqueDirectRitems.push_back(ri);
+			continue;
+		}
 
-//The DrawRenderItems method is invoked in the main Draw call:
-void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+		BoundingBox bounds;
+		ri->Bounds.Transform(bounds, XMLoadFloat4x4(&ri->World));
+
+		IndirectDrawItem item;
+		memcpy(item.Center, &bounds.Center, sizeof(item.Center));
+		memcpy(item.Extents, &bounds.Extents, sizeof(item.Extents));
+		item.DrawIndex = ri->DrawIndex;
+
+		D3D12_VERTEX_BUFFER_VIEW vbv = ri->Geo->VertexBufferView();
+		D3D12_INDEX_BUFFER_VIEW ibv = ri->Geo->IndexBufferView();
+		item.VertexBuffer.Location = vbv.BufferLocation;
+		item.VertexBuffer.Size = vbv.SizeInBytes;
+		item.VertexBuffer.Stride = vbv.StrideInBytes;
+		item.IndexBuffer.Location = ibv.BufferLocation;
+		item.IndexBuffer.Size = ibv.SizeInBytes;
+		item.IndexBuffer.Format = (uint32_t)ibv.Format;
+
+		item.IndexCount = ri->IndexCount;
+		item.StartIndexLocation = ri->StartIndexLocation;
+		item.BaseVertexLocation = ri->BaseVertexLocation;
+
+		mIndirectDrawItems.push_back(item);
+		mIndirectDrawRitems.push_back(ri);
+	}
+}
+
+// Culls the opaque items, writes the arguments of the visible ones into the frame's
+// upload buffer and draws them all with one ExecuteIndirect.
+void ShapesApp::DrawOpaqueIndirect()
 {
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	mCurrFrameResource->ReserveIndirectDrawBuffer(md3dDevice.Get(), (UINT)mIndirectDrawItems.size());
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMLoadFloat4x4(&mView) * XMLoadFloat4x4(&mProj));
+	IndirectDrawFrustum frustum = IndirectDrawFrustum::FromViewProj(&viewProj.m[0][0]);
 
+	UINT drawCount = mIndirectDrawBuilder.Build(mIndirectDrawItems, &frustum, mThreadPool.get(),
+		mCurrFrameResource->IndirectDrawBuffer->MappedData());
+
+	for (uint32_t i : mIndirectDrawBuilder.GetDrawnItems())
+	{
+		if (mIndirectDrawRitems[i]->StreamedTexture >= 0)
+			mTextureResidency->MarkUsed((uint32_t)mIndirectDrawRitems[i]->StreamedTexture);
+	}
+
+	if (drawCount > 0)
+	{
+		mDrawList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		mCommandList->ExecuteIndirect(mDrawSignature.Get(), drawCount,
+			mCurrFrameResource->IndirectDrawBuffer->Resource(), 0, nullptr, 0);
+
+		// The commands set the buffers and root constant behind the filter's back.
+		mDrawList.Invalidate();
+	}
+
+	DrawRenderItems(mDrawList, mOpaqueDirectRitems);
+}
+
+void ShapesApp::BuildLights()
+{
+	mLightStore.LoadFromFile(L"Scenes/Lights.txt");
+}
+
+//The DrawRenderItems method is invoked in the main Draw call:
+void ShapesApp::DrawRenderItems(FilteredCommandList& cmdList, const std::vector<RenderItem*>& ritems)
+{
 	// For each render item...
 	for (size_t i = 0; i < ritems.size(); ++i)
 	{
 		auto ri = ritems[i];
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
-
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+		// Items sharing geometry and topology only set their draw index.
+		cmdList.IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+		cmdList.IASetIndexBuffer(&ri->Geo->IndexBufferView());
+		cmdList.IASetPrimitiveTopology(ri->PrimitiveType);
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
+		cmdList.SetGraphicsRoot32BitConstant(1, ri->DrawIndex, 0);
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-		cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+		if (ri->StreamedTexture >= 0)
+			mTextureResidency->MarkUsed((uint32_t)ri->StreamedTexture);
 
 		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
 	}